@@ -0,0 +1,358 @@
+#pragma once
+
+#include "compression.h"
+#include "cook_cache.h"
+
+//Asset database for hot reloading.
+//Each asset is a source file plus the files it depends on (includes, referenced textures). When the platform
+//file watcher reports a change, every asset that reads the changed file is marked dirty, along with any asset that
+//depends on a dirty asset's source. updateAssetDatabase is called once per frame between frames:
+//   - dirty assets are recooked as one batch on the database's own work queue, source read included
+//   - while a batch is in flight the main loop keeps running with the previous data
+//   - once every job in the batch is done, the cooked results are handed to each asset's swap callback, so a
+//     shader and the model that uses it never show up half updated
+//An asset whose source bytes hash the same as last time is not swapped, which filters out editors that save twice.
+//The queue must not be shared with code that calls completeWorkQueueEntries, that would block on the cooks.
+//Sources may be block compressed with compression.h, they are decoded before the cook sees them.
+//The platform watcher never blocks: readFileWatcherChanges writes the null terminated paths changed since the last
+//call, relative to the watched directory, and returns the number of bytes written.
+//Assets added with addCookedAsset cook to plain bytes and go through the database's cook cache when it has one, keyed
+//on their cooker name and version, the decoded source and the file bytes of every dependency, so a source cooked
+//before with the same includes, in this run or an earlier one, is read back from the cache instead of cooked again.
+
+#define ASSET_MAX_ASSETS 256
+#define ASSET_MAX_DEPENDENCIES 8
+#define ASSET_MAX_FILE_NAME 128
+#define ASSET_MAX_COOK_JOBS 16
+#define ASSET_CHANGE_BUFFER_SIZE 4096
+//room for a compressed source's chunk table on top of its bytes in a job's scratch
+#define ASSET_COOK_SCRATCH_OVERHEAD KILOBYTE(16)
+
+//the bytes a cookBytes cooker wrote, or the cache read back, in the job's scratch until swap returns
+struct CookedAsset {
+    void* data;
+    u32 size;
+};
+
+//cook runs on a worker thread and returns the runtime data through result, swap runs on the main thread between
+//frames and takes ownership of the result, releasing whatever it replaces. An asset with cookBytes instead writes at
+//most outCapacity bytes to out and returns how many, 0 on failure, and its swap gets a CookedAsset to copy from.
+struct Asset {
+    s8 fileName[ASSET_MAX_FILE_NAME];
+    u64 fileNameHash;
+    u64 dependencyHashes[ASSET_MAX_DEPENDENCIES];
+    //read by the cook job to key the cook cache on what the dependencies hold
+    s8 dependencyNames[ASSET_MAX_DEPENDENCIES][ASSET_MAX_FILE_NAME];
+    u64 sourceHash;
+    u64 changeTime;
+    bool (*cook)(void* userData, u8* source, u32 sourceSize, void** result);
+    u32 (*cookBytes)(void* userData, u8* source, u32 sourceSize, void* out, u32 outCapacity);
+    void (*swap)(void* userData, void* result);
+    void* userData;
+    const s8* cookerName;
+    u32 cookerVersion;
+    u32 totalDependencies;
+    u32 version;
+    bool dirty;
+    bool dependencyChanged;
+};
+
+struct AssetCookJob {
+    OSInterface* os;
+    CookCache* cookCache;
+    Asset* asset;
+    u8* staging;
+    u32 stagingSize;
+    MemoryArena scratch;
+    void* result;
+    CookedAsset cooked;
+    u32 sourceSize;
+    u64 sourceHash;
+    u64 changeTime;
+    bool dependencyChanged;
+    bool success;
+    bool unchanged;
+};
+
+struct AssetDatabase {
+    Asset assets[ASSET_MAX_ASSETS];
+    AssetCookJob jobs[ASSET_MAX_COOK_JOBS];
+    OSInterface* os;
+    WorkQueue* queue;
+    CookCache* cookCache;
+    void* watcher;
+    u8* staging;
+    u32 stagingSize;
+    u32 totalAssets;
+    u32 totalJobs;
+    bool batchInFlight;
+
+    u64 lastReloadLatency;
+    u64 maxReloadLatency;
+    u32 totalReloads;
+    u32 totalCookFailures;
+};
+
+//stagingSize is the largest source any asset may have, decoded, and every cook job gets as much again as scratch for
+//compressed sources. Passing a null queue cooks inline during updateAssetDatabase, which stalls the frame but keeps
+//the same swap order. A null cookCache cooks every addCookedAsset asset.
+static bool initializeAssetDatabase(AssetDatabase* database, OSInterface* os, const s8* watchDirectory, u32 stagingSize,
+                                    MemoryArena* arena, WorkQueue* queue = 0, CookCache* cookCache = 0){
+    setMemory(database, sizeof(AssetDatabase));
+    database->os = os;
+    database->queue = queue;
+    database->cookCache = cookCache;
+    database->stagingSize = stagingSize;
+    u64 jobSize = (u64)stagingSize * 2 + ASSET_COOK_SCRATCH_OVERHEAD;
+    database->staging = (u8*)pushSize(arena, jobSize * ASSET_MAX_COOK_JOBS);
+    if(!database->staging){
+        return false;
+    }
+    for(u32 i = 0; i < ASSET_MAX_COOK_JOBS; i++){
+        AssetCookJob* job = &database->jobs[i];
+        job->staging = database->staging + i * jobSize;
+        job->stagingSize = stagingSize;
+        job->scratch = createMemoryArena(job->staging + stagingSize, jobSize - stagingSize);
+    }
+    database->watcher = os->createFileWatcher ? os->createFileWatcher(watchDirectory) : 0;
+    return true;
+}
+
+static Asset* findAsset(AssetDatabase* database, const s8* fileName){
+    u64 hash = hashAssetFileName(fileName);
+    for(u32 i = 0; i < database->totalAssets; i++){
+        if(database->assets[i].fileNameHash == hash){
+            return &database->assets[i];
+        }
+    }
+    return 0;
+}
+
+//the asset is cooked and swapped on the next update, so the first load goes through the same path as a reload
+static Asset* addAsset(AssetDatabase* database, const s8* fileName, bool (*cook)(void*, u8*, u32, void**),
+                       void (*swap)(void*, void*), void* userData){
+    u32 length = 0;
+    while(fileName[length]) length++;
+    if(database->totalAssets == ASSET_MAX_ASSETS || length >= ASSET_MAX_FILE_NAME){
+        return 0;
+    }
+    Asset* asset = &database->assets[database->totalAssets++];
+    setMemory(asset, sizeof(Asset));
+    copyMemory(asset->fileName, (void*)fileName, length + 1);
+    asset->fileNameHash = hashAssetFileName(fileName);
+    asset->cook = cook;
+    asset->swap = swap;
+    asset->userData = userData;
+    asset->dirty = true;
+    asset->changeTime = database->os->getSystemTime ? database->os->getSystemTime() : 0;
+    return asset;
+}
+
+//bump cookerVersion whenever cookBytes' output changes for the same source, older cache entries are then never hit
+static Asset* addCookedAsset(AssetDatabase* database, const s8* fileName, const s8* cookerName, u32 cookerVersion,
+                             u32 (*cookBytes)(void*, u8*, u32, void*, u32), void (*swap)(void*, void*), void* userData){
+    Asset* asset = addAsset(database, fileName, 0, swap, userData);
+    if(asset){
+        asset->cookBytes = cookBytes;
+        asset->cookerName = cookerName;
+        asset->cookerVersion = cookerVersion;
+    }
+    return asset;
+}
+
+static bool addAssetDependency(Asset* asset, const s8* fileName){
+    u32 length = 0;
+    while(fileName[length]) length++;
+    if(asset->totalDependencies == ASSET_MAX_DEPENDENCIES || length >= ASSET_MAX_FILE_NAME){
+        return false;
+    }
+    copyMemory(asset->dependencyNames[asset->totalDependencies], (void*)fileName, length + 1);
+    asset->dependencyHashes[asset->totalDependencies++] = hashAssetFileName(fileName);
+    return true;
+}
+
+static bool assetReadsFile(Asset* asset, u64 fileNameHash){
+    if(asset->fileNameHash == fileNameHash){
+        return true;
+    }
+    for(u32 i = 0; i < asset->totalDependencies; i++){
+        if(asset->dependencyHashes[i] == fileNameHash){
+            return true;
+        }
+    }
+    return false;
+}
+
+//marks every asset reading the file, then keeps marking assets that depend on a newly dirty asset's source
+static void markAssetFileChanged(AssetDatabase* database, const s8* fileName, u64 time){
+    u64 hash = hashAssetFileName(fileName);
+    for(u32 i = 0; i < database->totalAssets; i++){
+        Asset* asset = &database->assets[i];
+        if(assetReadsFile(asset, hash)){
+            if(!asset->dirty) asset->changeTime = time;
+            asset->dirty = true;
+            asset->dependencyChanged |= asset->fileNameHash != hash;
+        }
+    }
+    bool marked = true;
+    while(marked){
+        marked = false;
+        for(u32 i = 0; i < database->totalAssets; i++){
+            Asset* source = &database->assets[i];
+            if(!source->dirty) continue;
+            for(u32 j = 0; j < database->totalAssets; j++){
+                Asset* asset = &database->assets[j];
+                if(!asset->dirty && assetReadsFile(asset, source->fileNameHash)){
+                    asset->dirty = true;
+                    asset->dependencyChanged = true;
+                    asset->changeTime = source->changeTime;
+                    marked = true;
+                }
+            }
+        }
+    }
+}
+
+static u32 cookAssetBytes(void* data, void* out, u32 outCapacity){
+    AssetCookJob* job = (AssetCookJob*)data;
+    Asset* asset = job->asset;
+    return asset->cookBytes(asset->userData, job->staging, job->sourceSize, out, outCapacity);
+}
+
+//Hashes the bytes of every dependency as they are on disk, read into buffer one after the other. false when one
+//cannot be read, the cook then skips the cache rather than key it on a dependency it never saw.
+static bool hashAssetDependencies(AssetCookJob* job, u8* buffer, u32 capacity, u64* hashes){
+    Asset* asset = job->asset;
+    for(u32 i = 0; i < asset->totalDependencies; i++){
+        u32 size = 0;
+        if(!job->os->readFileIntoBoundedBuffer(asset->dependencyNames[i], buffer, capacity, &size)){
+            return false;
+        }
+        hashes[i] = hashMemory(buffer, size);
+    }
+    return true;
+}
+
+static void cookAssetJob(void* data){
+    AssetCookJob* job = (AssetCookJob*)data;
+    Asset* asset = job->asset;
+    job->result = 0;
+    job->success = false;
+    job->unchanged = false;
+    job->sourceSize = 0;
+    //too large for the staging slot fails the cook like a missing file would
+    if(!readAssetIntoBuffer(job->os, asset->fileName, job->staging, job->stagingSize, &job->sourceSize, &job->scratch)){
+        return;
+    }
+    job->sourceHash = hashMemory(job->staging, job->sourceSize);
+    //a dependency may have changed under an identical source, so only own file changes can be skipped
+    if(asset->version && !job->dependencyChanged && job->sourceHash == asset->sourceHash){
+        job->unchanged = true;
+        job->success = true;
+        return;
+    }
+    if(!asset->cookBytes){
+        job->success = asset->cook(asset->userData, job->staging, job->sourceSize, &job->result);
+        return;
+    }
+    //the cooked bytes go in the scratch the source read is done with, left unclaimed since nothing else uses it
+    u64 scratchMark = job->scratch.used;
+    u8* out = (u8*)pushSize(&job->scratch, 0);
+    u64 capacity = out ? job->scratch.size - job->scratch.used : 0;
+    job->scratch.used = scratchMark;
+    if(capacity > MAX_U32) capacity = MAX_U32;
+    CookCache* cache = job->cookCache;
+    u32 size = 0;
+    u64 dependencyHashes[ASSET_MAX_DEPENDENCIES];
+    //the dependencies are read into out before the cook writes there
+    if(out && cache && hashAssetDependencies(job, out, (u32)capacity, dependencyHashes)){
+        u64 key = computeCookKey(asset->cookerName, asset->cookerVersion, dependencyHashes,
+                                 asset->totalDependencies * sizeof(u64), job->staging, job->sourceSize);
+        size = cookWithCache(cache, key, cookAssetBytes, job, out, (u32)capacity);
+    }else if(out){
+        size = cookAssetBytes(job, out, (u32)capacity);
+    }
+    job->cooked.data = out;
+    job->cooked.size = size;
+    job->result = &job->cooked;
+    job->success = size != 0;
+}
+
+static void applyAssetCookJobs(AssetDatabase* database){
+    u64 now = database->os->getSystemTime ? database->os->getSystemTime() : 0;
+    for(u32 i = 0; i < database->totalJobs; i++){
+        AssetCookJob* job = &database->jobs[i];
+        Asset* asset = job->asset;
+        if(!job->success){
+            database->totalCookFailures++;
+            continue;
+        }
+        asset->sourceHash = job->sourceHash;
+        if(job->unchanged){
+            continue;
+        }
+        asset->swap(asset->userData, job->result);
+        asset->version++;
+        database->totalReloads++;
+        database->lastReloadLatency = now - job->changeTime;
+        if(database->lastReloadLatency > database->maxReloadLatency){
+            database->maxReloadLatency = database->lastReloadLatency;
+        }
+    }
+    database->totalJobs = 0;
+}
+
+//Call once per frame, between frames. Swaps happen here and only here.
+static void updateAssetDatabase(AssetDatabase* database){
+    OSInterface* os = database->os;
+    WorkQueue* queue = database->queue;
+    u64 now = os->getSystemTime ? os->getSystemTime() : 0;
+
+    if(database->watcher){
+        s8 changes[ASSET_CHANGE_BUFFER_SIZE];
+        u32 changesSize = os->readFileWatcherChanges(database->watcher, changes, ASSET_CHANGE_BUFFER_SIZE);
+        for(u32 i = 0; i < changesSize;){
+            markAssetFileChanged(database, changes + i, now);
+            while(i < changesSize && changes[i]) i++;
+            i++;
+        }
+    }
+
+    if(database->batchInFlight){
+        if(queue->entriesCompleted != queue->entriesAdded){
+            return;
+        }
+        os->completeWorkQueueEntries(queue);
+        database->batchInFlight = false;
+        applyAssetCookJobs(database);
+    }
+
+    //assets dirtied while their batch was cooking are still dirty and go out with the next batch
+    for(u32 i = 0; i < database->totalAssets && database->totalJobs < ASSET_MAX_COOK_JOBS; i++){
+        Asset* asset = &database->assets[i];
+        if(!asset->dirty) continue;
+        AssetCookJob* job = &database->jobs[database->totalJobs];
+        job->os = os;
+        job->cookCache = database->cookCache;
+        job->asset = asset;
+        job->changeTime = asset->changeTime;
+        job->dependencyChanged = asset->dependencyChanged;
+        database->totalJobs++;
+        asset->dirty = false;
+        asset->dependencyChanged = false;
+    }
+    if(!database->totalJobs){
+        return;
+    }
+    if(!queue){
+        for(u32 i = 0; i < database->totalJobs; i++){
+            cookAssetJob(&database->jobs[i]);
+        }
+        applyAssetCookJobs(database);
+        return;
+    }
+    for(u32 i = 0; i < database->totalJobs; i++){
+        os->addWorkQueueEntry(queue, cookAssetJob, &database->jobs[i]);
+    }
+    database->batchInFlight = true;
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "os_interface.h"
+
+//Interned asset names and a reference counted registry of loaded assets.
+//Entries live in one open addressing table with linear probing, keyed on the 64 bit hashAssetFileName of the name, so
+//"Models/Tree.obj" and "models\tree.obj" are the same asset. The table and the name pool are fixed size and carved
+//from an arena at startup. Entries are never removed: an entry whose count drops to zero keeps its interned name, and
+//loading the same file again reuses it. Entry pointers therefore stay valid for the registry's lifetime.
+//   acquire  -> entry with the count incremented, asset is 0 until the caller has loaded it
+//   release  -> returns the asset when the count reaches zero, the caller frees it
+//Lookups by precomputed hash skip the string compare entirely. Not thread safe; acquire and release from one thread.
+
+struct AssetRegistryEntry {
+    u64 nameHash;
+    void* asset;
+    u32 nameOffset;
+    u32 referenceCount;
+};
+
+struct AssetRegistry {
+    AssetRegistryEntry* entries;
+    s8* names;
+    u32 capacity;
+    u32 totalEntries;
+    u32 namesCapacity;
+    u32 namesUsed;
+};
+
+//0 marks an empty slot, so a name that hashes to 0 is moved to 1
+static u64 hashAssetRegistryName(const s8* name){
+    u64 hash = hashAssetFileName(name);
+    return hash ? hash : 1;
+}
+
+static bool assetNamesEqual(const s8* a, const s8* b){
+    for(;; a++, b++){
+        s8 ca = *a >= 'A' && *a <= 'Z' ? *a + ('a' - 'A') : *a == '\\' ? '/' : *a;
+        s8 cb = *b >= 'A' && *b <= 'Z' ? *b + ('a' - 'A') : *b == '\\' ? '/' : *b;
+        if(ca != cb) return false;
+        if(!ca) return true;
+    }
+}
+
+//the table keeps at least a quarter of its slots empty so probe sequences stay short
+static bool initializeAssetRegistry(AssetRegistry* registry, u32 maxEntries, u32 namesCapacity, MemoryArena* arena){
+    setMemory(registry, sizeof(AssetRegistry));
+    registry->capacity = nextPowerOfTwo(maxEntries + maxEntries / 3 + 1);
+    registry->entries = pushArray(arena, AssetRegistryEntry, registry->capacity);
+    registry->names = pushArray(arena, s8, namesCapacity);
+    if(!registry->entries || !registry->names){
+        return false;
+    }
+    setMemory(registry->entries, sizeof(AssetRegistryEntry) * registry->capacity);
+    registry->namesCapacity = namesCapacity;
+    return true;
+}
+
+static const s8* getAssetName(AssetRegistry* registry, AssetRegistryEntry* entry){
+    return registry->names + entry->nameOffset;
+}
+
+static AssetRegistryEntry* findAssetByHash(AssetRegistry* registry, u64 nameHash){
+    u32 mask = registry->capacity - 1;
+    for(u32 i = (u32)nameHash & mask;; i = (i + 1) & mask){
+        AssetRegistryEntry* entry = &registry->entries[i];
+        if(entry->nameHash == nameHash) return entry;
+        if(!entry->nameHash) return 0;
+    }
+}
+
+//returns the entry for name, inserting it with a zero count when it is new. 0 when the table or name pool is full.
+static AssetRegistryEntry* internAssetName(AssetRegistry* registry, const s8* name, u64 nameHash){
+    u32 mask = registry->capacity - 1;
+    u32 i = (u32)nameHash & mask;
+    for(;; i = (i + 1) & mask){
+        AssetRegistryEntry* entry = &registry->entries[i];
+        if(!entry->nameHash) break;
+        if(entry->nameHash == nameHash && assetNamesEqual(registry->names + entry->nameOffset, name)){
+            return entry;
+        }
+    }
+    u32 length = 0;
+    while(name[length]) length++;
+    if(registry->totalEntries + 1 > registry->capacity - registry->capacity / 4 ||
+       registry->namesUsed + length + 1 > registry->namesCapacity){
+        return 0;
+    }
+    AssetRegistryEntry* entry = &registry->entries[i];
+    entry->nameHash = nameHash;
+    entry->asset = 0;
+    entry->referenceCount = 0;
+    entry->nameOffset = registry->namesUsed;
+    copyMemory(registry->names + registry->namesUsed, (void*)name, length + 1);
+    registry->namesUsed += length + 1;
+    registry->totalEntries++;
+    return entry;
+}
+
+static AssetRegistryEntry* acquireAsset(AssetRegistry* registry, const s8* name){
+    AssetRegistryEntry* entry = internAssetName(registry, name, hashAssetRegistryName(name));
+    if(entry){
+        entry->referenceCount++;
+    }
+    return entry;
+}
+
+static AssetRegistryEntry* acquireAssetByHash(AssetRegistry* registry, u64 nameHash){
+    AssetRegistryEntry* entry = findAssetByHash(registry, nameHash);
+    if(entry){
+        entry->referenceCount++;
+    }
+    return entry;
+}
+
+//returns the asset once the count reaches zero so the caller can free it, 0 while other users remain
+static void* releaseAsset(AssetRegistryEntry* entry){
+    if(!entry->referenceCount || --entry->referenceCount){
+        return 0;
+    }
+    void* asset = entry->asset;
+    entry->asset = 0;
+    return asset;
+}
+
+//Loaders through the registry, repeated loads of the same file share one copy. A load that fails, or a platform
+//layer without the hook, is not kept: the reference is dropped, the entry's asset stays 0 and the next acquire of the
+//file tries it again. The loaded structs are pushed on arena and stay there.
+static Model3D* acquireModel3D(AssetRegistry* registry, OSInterface* os, s8* fileName, MemoryArena* arena){
+    AssetRegistryEntry* entry = acquireAsset(registry, fileName);
+    if(!entry) return 0;
+    if(!entry->asset){
+        u64 arenaMark = arena->used;
+        Model3D* model = pushStruct(arena, Model3D);
+        bool loaded = model && os->createModel3DFromFile;
+        if(loaded){
+            *model = os->createModel3DFromFile(fileName);
+            loaded = model->totalIndices != 0;
+        }
+        if(!loaded){
+            arena->used = arenaMark;
+            entry->referenceCount--;
+            return 0;
+        }
+        entry->asset = model;
+    }
+    return (Model3D*)entry->asset;
+}
+
+static Texture2D* acquireTexture2D(AssetRegistry* registry, OSInterface* os, s8* fileName, MemoryArena* arena){
+    AssetRegistryEntry* entry = acquireAsset(registry, fileName);
+    if(!entry) return 0;
+    if(!entry->asset){
+        u64 arenaMark = arena->used;
+        Texture2D* texture = pushStruct(arena, Texture2D);
+        bool loaded = texture && os->createTexture2DFromFile;
+        if(loaded){
+            *texture = os->createTexture2DFromFile(fileName);
+            loaded = texture->data1 != 0;
+        }
+        if(!loaded){
+            arena->used = arenaMark;
+            entry->referenceCount--;
+            return 0;
+        }
+        entry->asset = texture;
+    }
+    return (Texture2D*)entry->asset;
+}
+
+static Skeleton* acquireSkeleton(AssetRegistry* registry, OSInterface* os, s8* fileName, MemoryArena* arena){
+    AssetRegistryEntry* entry = acquireAsset(registry, fileName);
+    if(!entry) return 0;
+    if(!entry->asset){
+        u64 arenaMark = arena->used;
+        Skeleton* skeleton = pushStruct(arena, Skeleton);
+        bool loaded = skeleton && os->loadSkeletonFromFile;
+        if(loaded){
+            *skeleton = os->loadSkeletonFromFile(fileName);
+            loaded = skeleton->totalBones != 0;
+        }
+        if(!loaded){
+            arena->used = arenaMark;
+            entry->referenceCount--;
+            return 0;
+        }
+        entry->asset = skeleton;
+    }
+    return (Skeleton*)entry->asset;
+}
+
+static Animation* acquireAnimation(AssetRegistry* registry, OSInterface* os, s8* fileName, MemoryArena* arena){
+    AssetRegistryEntry* entry = acquireAsset(registry, fileName);
+    if(!entry) return 0;
+    if(!entry->asset){
+        u64 arenaMark = arena->used;
+        Animation* animation = pushStruct(arena, Animation);
+        bool loaded = animation && os->loadAnimationFromFile;
+        if(loaded){
+            *animation = os->loadAnimationFromFile(fileName);
+            loaded = animation->totalPoses != 0;
+        }
+        if(!loaded){
+            arena->used = arenaMark;
+            entry->referenceCount--;
+            return 0;
+        }
+        entry->asset = animation;
+    }
+    return (Animation*)entry->asset;
+}
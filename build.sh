@@ -0,0 +1,9 @@
+#!/bin/sh
+flags="-std=c++14 -msse4.1 -pthread -fno-rtti -fno-exceptions -Wall -Wno-unused-function -Wno-unused-variable"
+if [ "$1" = "headless_build" ]; then
+g++ $flags -g -O2 headless.cpp -o headless
+fi
+if [ "$1" = "headless_run" ]; then
+shift
+./headless "$@"
+fi
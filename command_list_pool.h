@@ -0,0 +1,139 @@
+#pragma once
+
+#include "frame_pacing.h"
+
+//Parallel command recording.
+//A CommandListPool holds direct queue command lists for worker threads to record at the same time. Each frame
+//recordCommandListsInParallel cuts totalItems, draws or whatever the caller counts, into one contiguous slice per list
+//and queues a job per slice. A job resets its list with the frame's allocator slot, binds the frame's render target,
+//viewport, pipeline and the pool's descriptor heaps, since nothing carries over from the pacer's list, hands its slice
+//to record and closes the list. The calling thread works through jobs too while it waits for them, then adds the
+//lists to the frame in slice order, so the GPU runs the items in the order one list would have recorded them.
+//Lists belong to slices, not threads: while a job runs it is the only one touching its list and that list's
+//allocators, which is all D3D12 asks, and whichever thread runs a slice its place in the submission stays fixed.
+//Every list keeps one allocator per frame in flight, reset only once the frame pacer has waited for that slot, so
+//each allocator holds on to the memory it grew to instead of starting over every frame.
+//record is called from several threads at once and must only write through the list it is given.
+
+#define COMMAND_LIST_POOL_MAX_LISTS FRAME_PACING_MAX_LISTS
+
+struct CommandListPool;
+
+struct CommandListJob {
+    CommandListPool* pool;
+    RenderCommandList* list;
+    u32 firstItem;
+    u32 totalItems;
+};
+
+struct CommandListPoolStats {
+    u64 frames;
+    u64 lists;
+    u64 items;
+    //summed over every job, against wallTime from queueing the first job to the last list closing
+    volatile u32 jobTime;
+    u64 recordTime;
+    u64 wallTime;
+};
+
+struct CommandListPool {
+    FramePacer* pacer;
+    OSInterface* os;
+    WorkQueue* workQueue;
+    RenderCommandList lists[COMMAND_LIST_POOL_MAX_LISTS];
+    CommandListJob jobs[COMMAND_LIST_POOL_MAX_LISTS];
+    u32 totalLists;
+
+    //bound on every list when set
+    RenderDescriptorHeap* resources;
+    RenderDescriptorHeap* samplers;
+
+    RenderPipeline* pipeline;
+    void (*record)(RenderCommandList* list, u32 firstItem, u32 totalItems, void* userData);
+    void* userData;
+
+    CommandListPoolStats stats;
+};
+
+//totalLists caps how many slices a frame is cut into, more lists than worker threads only adds submission cost
+static bool initializeCommandListPool(CommandListPool* pool, FramePacer* pacer, OSInterface* os, WorkQueue* workQueue,
+                                      u32 totalLists){
+    RenderBackend* backend = pacer->backend;
+    setMemory(pool, sizeof(CommandListPool));
+    if(!totalLists || totalLists > COMMAND_LIST_POOL_MAX_LISTS){
+        return false;
+    }
+    pool->pacer = pacer;
+    pool->os = os;
+    pool->workQueue = workQueue;
+    for(u32 i = 0; i < totalLists; i++){
+        if(!backend->createCommandList(backend, RENDER_QUEUE_DIRECT, &pool->lists[i])){
+            return false;
+        }
+        pool->jobs[i].pool = pool;
+        pool->jobs[i].list = &pool->lists[i];
+    }
+    pool->totalLists = totalLists;
+    return true;
+}
+
+static void recordCommandListJob(void* data){
+    CommandListJob* job = (CommandListJob*)data;
+    CommandListPool* pool = job->pool;
+    FramePacer* pacer = pool->pacer;
+    RenderCommandList* list = job->list;
+    RenderBackend* backend = list->backend;
+    u64 start = backend->getMicroseconds(backend);
+    backend->resetCommandList(list, pacer->frameSlot, pool->pipeline);
+    if(pool->resources || pool->samplers){
+        backend->setDescriptorHeaps(list, pool->resources, pool->samplers);
+    }
+    backend->setViewport(list, 0, 0, (f32)backend->width, (f32)backend->height);
+    backend->setRenderTarget(list, pacer->backBuffer);
+    backend->setPipeline(list, pool->pipeline);
+    pool->record(list, job->firstItem, job->totalItems, pool->userData);
+    backend->closeCommandList(list);
+    atomicAdd(&pool->stats.jobTime, (u32)(backend->getMicroseconds(backend) - start));
+}
+
+//Call between beginRenderFrame and endRenderFrame, after whatever the frame records on the pacer's list first.
+//Slices get at least minItemsPerList items so small frames do not pay for lists they barely use.
+static bool recordCommandListsInParallel(CommandListPool* pool, RenderPipeline* pipeline, u32 totalItems,
+                                         u32 minItemsPerList,
+                                         void (*record)(RenderCommandList* list, u32 firstItem, u32 totalItems,
+                                                        void* userData),
+                                         void* userData){
+    RenderBackend* backend = pool->pacer->backend;
+    if(!totalItems){
+        return true;
+    }
+    if(!minItemsPerList){
+        minItemsPerList = 1;
+    }
+    u32 totalSlices = (totalItems + minItemsPerList - 1) / minItemsPerList;
+    if(totalSlices > pool->totalLists){
+        totalSlices = pool->totalLists;
+    }
+    u64 start = backend->getMicroseconds(backend);
+    pool->pipeline = pipeline;
+    pool->record = record;
+    pool->userData = userData;
+    pool->stats.jobTime = 0;
+    u32 firstItem = 0;
+    for(u32 i = 0; i < totalSlices; i++){
+        CommandListJob* job = &pool->jobs[i];
+        //the remainder is spread over the first slices, one item each
+        job->firstItem = firstItem;
+        job->totalItems = totalItems / totalSlices + (i < totalItems % totalSlices ? 1 : 0);
+        firstItem += job->totalItems;
+        pool->os->addWorkQueueEntry(pool->workQueue, recordCommandListJob, job);
+    }
+    pool->os->completeWorkQueueEntries(pool->workQueue);
+    CommandListPoolStats* stats = &pool->stats;
+    stats->frames++;
+    stats->lists += totalSlices;
+    stats->items += totalItems;
+    stats->recordTime += stats->jobTime;
+    stats->wallTime += backend->getMicroseconds(backend) - start;
+    return addRenderFrameLists(pool->pacer, pool->lists, totalSlices);
+}
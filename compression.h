@@ -0,0 +1,393 @@
+#pragma once
+
+#include "os_interface.h"
+
+// Block compressed assets are split into independent chunks so they can be decoded in parallel.
+// Each chunk is a stream of LZ4 style sequences:
+//   token (high 4 bits literal length, low 4 bits match length - 4, 15 means more length bytes follow)
+//   literals, 16 bit match offset, extra match length bytes
+// The final sequence of a chunk only has literals.
+
+#define LZ_ASSET_MAGIC 0x425A4C53
+#define LZ_DEFAULT_CHUNK_SIZE KILOBYTE(256)
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_SEARCH_LIMIT 12
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 12
+#define LZ_WILD_COPY_SIZE 16
+
+struct CompressedAssetHeader {
+    u32 magic;
+    u32 chunkSize;
+    u32 totalChunks;
+    u32 uncompressedSize;
+};
+
+struct LZDecompressJob {
+    u8* src;
+    u8* dst;
+    u32 srcSize;
+    u32 dstSize;
+    bool success;
+};
+
+static u32 lzRead32(u8* p){
+    return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static u32 lzHash(u32 sequence){
+    return (sequence * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+static u32 lzCompressBound(u32 srcSize){
+    return srcSize + (srcSize / 255) + 16;
+}
+
+static u32 compressAssetBound(u32 srcSize, u32 chunkSize = LZ_DEFAULT_CHUNK_SIZE){
+    u32 totalChunks = (srcSize + chunkSize - 1) / chunkSize;
+    return sizeof(CompressedAssetHeader) + totalChunks * sizeof(u32) + srcSize;
+}
+
+static u8* lzWriteLength(u8* op, u32 length){
+    while(length >= 255){
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (u8)length;
+    return op;
+}
+
+static u8* lzWriteSequence(u8* op, u8* literals, u32 literalLength, u32 offset, u32 matchLength){
+    u8* token = op++;
+    u8 tokenValue = 0;
+    if(literalLength >= 15){
+        tokenValue = 15 << 4;
+        op = lzWriteLength(op, literalLength - 15);
+    }else{
+        tokenValue = (u8)(literalLength << 4);
+    }
+    copyMemory(op, literals, literalLength);
+    op += literalLength;
+
+    if(matchLength){
+        op[0] = (u8)offset;
+        op[1] = (u8)(offset >> 8);
+        op += 2;
+        u32 ml = matchLength - LZ_MIN_MATCH;
+        if(ml >= 15){
+            tokenValue |= 15;
+            op = lzWriteLength(op, ml - 15);
+        }else{
+            tokenValue |= (u8)ml;
+        }
+    }
+    *token = tokenValue;
+    return op;
+}
+
+//returns 0 if the compressed chunk would not fit in dstCapacity
+static u32 lzCompressChunk(u8* src, u32 srcSize, u8* dst, u32 dstCapacity){
+    if(dstCapacity < lzCompressBound(srcSize)){
+        return 0;
+    }
+
+    u32 hashTable[1 << LZ_HASH_BITS];
+    setMemory(hashTable, sizeof(hashTable), 0xFF);
+
+    u8* op = dst;
+    u32 anchor = 0;
+    u32 ip = 0;
+    if(srcSize > LZ_MATCH_SEARCH_LIMIT){
+        u32 searchEnd = srcSize - LZ_MATCH_SEARCH_LIMIT;
+        u32 matchEnd = srcSize - LZ_LAST_LITERALS;
+        while(ip < searchEnd){
+            u32 sequence = lzRead32(src + ip);
+            u32 h = lzHash(sequence);
+            u32 candidate = hashTable[h];
+            hashTable[h] = ip;
+            if(candidate == MAX_U32 || ip - candidate > LZ_MAX_OFFSET || lzRead32(src + candidate) != sequence){
+                ip++;
+                continue;
+            }
+
+            while(ip > anchor && candidate > 0 && src[ip - 1] == src[candidate - 1]){
+                ip--;
+                candidate--;
+            }
+
+            u32 matchLength = LZ_MIN_MATCH;
+            while(ip + matchLength < matchEnd && src[ip + matchLength] == src[candidate + matchLength]){
+                matchLength++;
+            }
+
+            op = lzWriteSequence(op, src + anchor, ip - anchor, ip - candidate, matchLength);
+            ip += matchLength;
+            anchor = ip;
+            if(ip - 2 < searchEnd){
+                hashTable[lzHash(lzRead32(src + ip - 2))] = ip - 2;
+            }
+        }
+    }
+    op = lzWriteSequence(op, src + anchor, srcSize - anchor, 0, 0);
+    return (u32)(op - dst);
+}
+
+static bool lzReadLength(u8** ip, u8* iend, u32* length){
+    u8 b;
+    do{
+        if(*ip >= iend){
+            return false;
+        }
+        b = **ip;
+        (*ip)++;
+        *length += b;
+    }while(b == 255);
+    return true;
+}
+
+static void lzWildCopy16(u8* dst, u8* src, u8* dstEnd){
+    do{
+        _mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((__m128i*)src));
+        dst += 16;
+        src += 16;
+    }while(dst < dstEnd);
+}
+
+static bool lzDecompressChunk(u8* src, u32 srcSize, u8* dst, u32 dstSize){
+    u8* ip = src;
+    u8* iend = src + srcSize;
+    u8* op = dst;
+    u8* oend = dst + dstSize;
+
+    while(ip < iend){
+        u32 token = *ip++;
+        u32 literalLength = token >> 4;
+        if(literalLength == 15 && !lzReadLength(&ip, iend, &literalLength)){
+            return false;
+        }
+        if(literalLength > (u32)(iend - ip) || literalLength > (u32)(oend - op)){
+            return false;
+        }
+        if(op + literalLength + LZ_WILD_COPY_SIZE <= oend && ip + literalLength + LZ_WILD_COPY_SIZE <= iend){
+            lzWildCopy16(op, ip, op + literalLength);
+        }else{
+            copyMemory(op, ip, literalLength);
+        }
+        op += literalLength;
+        ip += literalLength;
+
+        if(ip == iend){
+            break;
+        }
+
+        if(iend - ip < 2){
+            return false;
+        }
+        u32 offset = (u32)ip[0] | ((u32)ip[1] << 8);
+        ip += 2;
+        u32 matchLength = token & 15;
+        if(matchLength == 15 && !lzReadLength(&ip, iend, &matchLength)){
+            return false;
+        }
+        matchLength += LZ_MIN_MATCH;
+        if(offset == 0 || offset > (u32)(op - dst) || matchLength > (u32)(oend - op)){
+            return false;
+        }
+
+        u8* match = op - offset;
+        if(offset >= LZ_WILD_COPY_SIZE && op + matchLength + LZ_WILD_COPY_SIZE <= oend){
+            lzWildCopy16(op, match, op + matchLength);
+        }else if(offset >= 8 && op + matchLength + 8 <= oend){
+            u8* copyEnd = op + matchLength;
+            u8* o = op;
+            while(o < copyEnd){
+                _mm_storel_epi64((__m128i*)o, _mm_loadl_epi64((__m128i*)match));
+                o += 8;
+                match += 8;
+            }
+        }else{
+            for(u32 i = 0; i < matchLength; i++){
+                op[i] = match[i];
+            }
+        }
+        op += matchLength;
+    }
+
+    return op == oend;
+}
+
+//returns the size of the compressed asset written to dst, or 0 if dstCapacity is smaller than compressAssetBound
+static u32 compressAsset(void* data, u32 dataSize, void* dst, u32 dstCapacity, MemoryArena* scratch, u32 chunkSize = LZ_DEFAULT_CHUNK_SIZE){
+    if(dstCapacity < compressAssetBound(dataSize, chunkSize)){
+        return 0;
+    }
+    u64 scratchMark = scratch->used;
+    u32 scratchCapacity = lzCompressBound(chunkSize);
+    u8* chunkScratch = (u8*)pushSize(scratch, scratchCapacity);
+    if(!chunkScratch){
+        return 0;
+    }
+
+    u8* src = (u8*)data;
+    CompressedAssetHeader* header = (CompressedAssetHeader*)dst;
+    header->magic = LZ_ASSET_MAGIC;
+    header->chunkSize = chunkSize;
+    header->totalChunks = (dataSize + chunkSize - 1) / chunkSize;
+    header->uncompressedSize = dataSize;
+    u32* chunkSizes = (u32*)(header + 1);
+    u8* op = (u8*)(chunkSizes + header->totalChunks);
+
+    for(u32 i = 0; i < header->totalChunks; i++){
+        u32 rawSize = dataSize - i * chunkSize;
+        if(rawSize > chunkSize) rawSize = chunkSize;
+        u32 compressedSize = lzCompressChunk(src + i * chunkSize, rawSize, chunkScratch, scratchCapacity);
+        if(compressedSize && compressedSize < rawSize){
+            copyMemory(op, chunkScratch, compressedSize);
+        }else{
+            compressedSize = rawSize;
+            copyMemory(op, src + i * chunkSize, rawSize);
+        }
+        chunkSizes[i] = compressedSize;
+        op += compressedSize;
+    }
+
+    scratch->used = scratchMark;
+    return (u32)(op - (u8*)dst);
+}
+
+static bool isCompressedAsset(void* data, u32 dataSize){
+    return dataSize >= sizeof(CompressedAssetHeader) && ((CompressedAssetHeader*)data)->magic == LZ_ASSET_MAGIC;
+}
+
+static u32 getUncompressedAssetSize(void* data, u32 dataSize){
+    if(!isCompressedAsset(data, dataSize)){
+        return dataSize;
+    }
+    return ((CompressedAssetHeader*)data)->uncompressedSize;
+}
+
+static f32 getAssetCompressionRatio(void* data, u32 dataSize){
+    return (f32)getUncompressedAssetSize(data, dataSize) / (f32)dataSize;
+}
+
+static void lzDecompressChunkJob(void* data){
+    LZDecompressJob* job = (LZDecompressJob*)data;
+    if(job->srcSize == job->dstSize){
+        copyMemory(job->dst, job->src, job->dstSize);
+        job->success = true;
+    }else{
+        job->success = lzDecompressChunk(job->src, job->srcSize, job->dst, job->dstSize);
+    }
+}
+
+//dst may be arena or mapped upload memory. If os and queue are given, chunks are decoded on the work queue.
+static bool decompressAsset(void* data, u32 dataSize, void* dst, u32 dstCapacity, MemoryArena* scratch, OSInterface* os = 0, WorkQueue* queue = 0){
+    if(!isCompressedAsset(data, dataSize)){
+        return false;
+    }
+    CompressedAssetHeader* header = (CompressedAssetHeader*)data;
+    if(header->uncompressedSize > dstCapacity || header->chunkSize == 0 ||
+       sizeof(CompressedAssetHeader) + (u64)header->totalChunks * sizeof(u32) > dataSize){
+        return false;
+    }
+
+    u64 scratchMark = scratch->used;
+    LZDecompressJob* jobs = pushArray(scratch, LZDecompressJob, header->totalChunks);
+    if(!jobs){
+        return false;
+    }
+
+    u32* chunkSizes = (u32*)(header + 1);
+    u8* ip = (u8*)(chunkSizes + header->totalChunks);
+    u8* iend = (u8*)data + dataSize;
+    u8* op = (u8*)dst;
+    u32 remaining = header->uncompressedSize;
+    bool success = true;
+    for(u32 i = 0; i < header->totalChunks; i++){
+        u32 rawSize = remaining < header->chunkSize ? remaining : header->chunkSize;
+        if(chunkSizes[i] > (u32)(iend - ip) || chunkSizes[i] > rawSize || rawSize == 0){
+            success = false;
+            break;
+        }
+        jobs[i].src = ip;
+        jobs[i].srcSize = chunkSizes[i];
+        jobs[i].dst = op;
+        jobs[i].dstSize = rawSize;
+        jobs[i].success = false;
+        ip += chunkSizes[i];
+        op += rawSize;
+        remaining -= rawSize;
+    }
+    //a header claiming more bytes than its chunks hold would leave the end of dst unwritten
+    if(remaining){
+        success = false;
+    }
+
+    if(success){
+        if(os && queue && header->totalChunks > 1){
+            for(u32 i = 0; i < header->totalChunks; i += WorkQueue::MAX_ENTRIES - 1){
+                u32 end = i + WorkQueue::MAX_ENTRIES - 1;
+                if(end > header->totalChunks) end = header->totalChunks;
+                for(u32 j = i; j < end; j++){
+                    os->addWorkQueueEntry(queue, lzDecompressChunkJob, &jobs[j]);
+                }
+                os->completeWorkQueueEntries(queue);
+            }
+        }else{
+            for(u32 i = 0; i < header->totalChunks; i++){
+                lzDecompressChunkJob(&jobs[i]);
+            }
+        }
+        for(u32 i = 0; i < header->totalChunks; i++){
+            success &= jobs[i].success;
+        }
+    }
+
+    scratch->used = scratchMark;
+    return success;
+}
+
+//Reads an asset that may or may not be block compressed into data, decoding it when it is. The file is read into
+//scratch first, since a compressed file can be larger than what it decodes to, so scratch has to hold the whole file.
+//dataLength receives the uncompressed size, and files or assets larger than their space fail.
+//Jobs pass no queue and decode on their own thread.
+static bool readAssetIntoBuffer(OSInterface* os, const s8* fileName, void* data, u32 dataCapacity, u32* dataLength,
+                                MemoryArena* scratch, WorkQueue* queue = 0){
+    u64 scratchMark = scratch->used;
+    u8* file = (u8*)pushSize(scratch, 0);
+    u64 fileCapacity = file ? scratch->size - scratch->used : 0;
+    if(fileCapacity > MAX_U32) fileCapacity = MAX_U32;
+    u32 fileLength = 0;
+    bool success = file && os->readFileIntoBoundedBuffer(fileName, file, (u32)fileCapacity, &fileLength);
+    if(success){
+        //claims what the read used so the decode's job table goes after it
+        scratch->used += fileLength;
+        if(!isCompressedAsset(file, fileLength)){
+            success = fileLength <= dataCapacity;
+            if(success){
+                copyMemory(data, file, fileLength);
+            }
+        }else{
+            success = decompressAsset(file, fileLength, data, dataCapacity, scratch, os, queue);
+            fileLength = success ? ((CompressedAssetHeader*)file)->uncompressedSize : 0;
+        }
+    }
+    *dataLength = success ? fileLength : 0;
+    scratch->used = scratchMark;
+    return success;
+}
+
+static bool writeCompressedAssetToFile(OSInterface* os, const s8* fileName, void* data, u32 dataSize, MemoryArena* scratch,
+                                       u32 chunkSize = LZ_DEFAULT_CHUNK_SIZE){
+    u64 scratchMark = scratch->used;
+    u32 capacity = compressAssetBound(dataSize, chunkSize);
+    u8* compressed = (u8*)pushSize(scratch, capacity);
+    if(!compressed){
+        return false;
+    }
+    u32 compressedSize = compressAsset(data, dataSize, compressed, capacity, scratch, chunkSize);
+    bool success = compressedSize && os->writeToFile(fileName, compressed, compressedSize);
+    scratch->used = scratchMark;
+    return success;
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include "os_interface.h"
+
+//Content addressed cache for cooked assets.
+//A cook is identified by a 64 bit key hashed from the cooker name and version, the cook settings and the source
+//bytes, so any change to one of them is a new key and nothing ever needs invalidating. cookWithCache looks the
+//key up in the local backend, then in the remote one, and only runs the cook when both miss. Fresh results are
+//written to both backends and remote hits are copied into the local one.
+//Backends are a pair of callbacks. The directory backend keeps one file per key plus an index of sizes and last use,
+//evicting the least recently used entries once the directory is over its byte budget. Pointing a second directory
+//backend at a shared folder stands in for a cache server until one exists.
+//All functions may be called from work queue jobs at the same time.
+
+#define COOK_CACHE_MAX_ENTRIES 4096
+#define COOK_CACHE_INDEX_MAGIC 0x58444943
+#define COOK_CACHE_INDEX_FILE "cook_index.bin"
+
+struct CookCacheBackend {
+    bool (*load)(void* userData, u64 key, void* data, u32 capacity, u32* size);
+    bool (*store)(void* userData, u64 key, void* data, u32 size);
+    void* userData;
+};
+
+struct CookCacheEntry {
+    u64 key;
+    u64 lastUse;
+    u32 size;
+    u32 padding;
+};
+
+struct CookCacheIndexHeader {
+    u32 magic;
+    u32 totalEntries;
+    u64 useCounter;
+};
+
+struct CookCacheDirectory {
+    OSInterface* os;
+    s8 path[192];
+    CookCacheEntry entries[COOK_CACHE_MAX_ENTRIES];
+    u64 totalBytes;
+    u64 budgetBytes;
+    u64 useCounter;
+    u32 totalEntries;
+    volatile u32 lock;
+    bool indexDirty;
+};
+
+struct CookCache {
+    CookCacheBackend local;
+    CookCacheBackend remote;
+    volatile u32 hits;
+    volatile u32 remoteHits;
+    volatile u32 misses;
+    volatile u32 failures;
+};
+
+//bump cookerVersion whenever a cooker's output changes for the same input
+static u64 computeCookKey(const s8* cookerName, u32 cookerVersion, void* settings, u32 settingsSize,
+                          void* source, u64 sourceSize){
+    u32 nameLength = 0;
+    while(cookerName[nameLength]) nameLength++;
+    u64 seed = hashMemory((void*)cookerName, nameLength, cookerVersion);
+    seed = hashMemory(settings, settingsSize, seed);
+    return hashMemory(source, sourceSize, seed);
+}
+
+static void getCookCacheFileName(CookCacheDirectory* directory, u64 key, s8* fileName){
+    u32 ctr = 0;
+    fileName[0] = '\0';
+    concatenateCharacterStrings(fileName, directory->path, &ctr);
+    for(s32 i = 15; i >= 0; i--){
+        fileName[ctr++] = "0123456789abcdef"[(key >> (i * 4)) & 15];
+    }
+    fileName[ctr] = '\0';
+    concatenateCharacterStrings(fileName, ".cook", &ctr);
+}
+
+static s32 findCookCacheEntry(CookCacheDirectory* directory, u64 key){
+    for(u32 i = 0; i < directory->totalEntries; i++){
+        if(directory->entries[i].key == key){
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void removeCookCacheEntry(CookCacheDirectory* directory, u32 index){
+    directory->totalBytes -= directory->entries[index].size;
+    directory->entries[index] = directory->entries[--directory->totalEntries];
+    directory->indexDirty = true;
+}
+
+//path ends with a slash. scratch only needs to hold the index while it is read.
+static bool initializeCookCacheDirectory(CookCacheDirectory* directory, OSInterface* os, const s8* path, u64 budgetBytes,
+                                         MemoryArena* scratch){
+    u32 pathLength = 0;
+    while(path[pathLength]) pathLength++;
+    if(pathLength + 24 > sizeof(directory->path)){
+        return false;
+    }
+    setMemory(directory, sizeof(CookCacheDirectory));
+    directory->os = os;
+    directory->budgetBytes = budgetBytes;
+    copyMemory(directory->path, (void*)path, pathLength + 1);
+
+    s8 fileName[256];
+    u32 ctr = 0;
+    fileName[0] = '\0';
+    concatenateCharacterStrings(fileName, path, &ctr);
+    concatenateCharacterStrings(fileName, COOK_CACHE_INDEX_FILE, &ctr);
+    u64 scratchMark = scratch->used;
+    u32 indexCapacity = sizeof(CookCacheIndexHeader) + sizeof(directory->entries);
+    u8* data = (u8*)pushSize(scratch, indexCapacity);
+    u32 fileLength = 0;
+    if(data && os->readFileIntoBoundedBuffer(fileName, data, indexCapacity, &fileLength) &&
+       fileLength >= sizeof(CookCacheIndexHeader)){
+        CookCacheIndexHeader* header = (CookCacheIndexHeader*)data;
+        if(header->magic == COOK_CACHE_INDEX_MAGIC && header->totalEntries <= COOK_CACHE_MAX_ENTRIES &&
+           fileLength == sizeof(CookCacheIndexHeader) + header->totalEntries * sizeof(CookCacheEntry)){
+            directory->totalEntries = header->totalEntries;
+            directory->useCounter = header->useCounter;
+            copyMemory(directory->entries, header + 1, header->totalEntries * sizeof(CookCacheEntry));
+            for(u32 i = 0; i < directory->totalEntries; i++){
+                directory->totalBytes += directory->entries[i].size;
+            }
+        }
+    }
+    scratch->used = scratchMark;
+    return true;
+}
+
+//the index is only written here, a crash before saving loses the use order and the entries added since the last save,
+//whose files are then simply cooked and written again
+static bool saveCookCacheDirectoryIndex(CookCacheDirectory* directory, MemoryArena* scratch){
+    beginSpinLock(&directory->lock);
+    if(!directory->indexDirty){
+        endSpinLock(&directory->lock);
+        return true;
+    }
+    u64 scratchMark = scratch->used;
+    u32 size = sizeof(CookCacheIndexHeader) + directory->totalEntries * sizeof(CookCacheEntry);
+    u8* data = (u8*)pushSize(scratch, size);
+    bool success = false;
+    if(data){
+        CookCacheIndexHeader* header = (CookCacheIndexHeader*)data;
+        header->magic = COOK_CACHE_INDEX_MAGIC;
+        header->totalEntries = directory->totalEntries;
+        header->useCounter = directory->useCounter;
+        copyMemory(header + 1, directory->entries, directory->totalEntries * sizeof(CookCacheEntry));
+        s8 fileName[256];
+        u32 ctr = 0;
+        fileName[0] = '\0';
+        concatenateCharacterStrings(fileName, directory->path, &ctr);
+        concatenateCharacterStrings(fileName, COOK_CACHE_INDEX_FILE, &ctr);
+        success = directory->os->writeToFile(fileName, data, size);
+        directory->indexDirty = !success;
+    }
+    scratch->used = scratchMark;
+    endSpinLock(&directory->lock);
+    return success;
+}
+
+static bool loadFromCookCacheDirectory(void* userData, u64 key, void* data, u32 capacity, u32* size){
+    CookCacheDirectory* directory = (CookCacheDirectory*)userData;
+    beginSpinLock(&directory->lock);
+    s32 index = findCookCacheEntry(directory, key);
+    if(index < 0 || directory->entries[index].size > capacity){
+        endSpinLock(&directory->lock);
+        return false;
+    }
+    u32 expectedSize = directory->entries[index].size;
+    directory->entries[index].lastUse = ++directory->useCounter;
+    directory->indexDirty = true;
+    endSpinLock(&directory->lock);
+
+    s8 fileName[256];
+    getCookCacheFileName(directory, key, fileName);
+    u32 fileLength = 0;
+    //the file may have been rewritten behind the index's back, so the read is bounded by the caller's buffer
+    if(!directory->os->readFileIntoBoundedBuffer(fileName, data, capacity, &fileLength) || fileLength != expectedSize){
+        //deleted, truncated or grown behind our back, forget it so the next store rewrites it
+        beginSpinLock(&directory->lock);
+        index = findCookCacheEntry(directory, key);
+        if(index >= 0) removeCookCacheEntry(directory, index);
+        endSpinLock(&directory->lock);
+        return false;
+    }
+    *size = fileLength;
+    return true;
+}
+
+static bool storeInCookCacheDirectory(void* userData, u64 key, void* data, u32 size){
+    CookCacheDirectory* directory = (CookCacheDirectory*)userData;
+    if(size > directory->budgetBytes){
+        return false;
+    }
+    s8 fileName[256];
+    getCookCacheFileName(directory, key, fileName);
+    if(!directory->os->writeToFile(fileName, data, size)){
+        return false;
+    }
+
+    beginSpinLock(&directory->lock);
+    s32 index = findCookCacheEntry(directory, key);
+    if(index >= 0){
+        removeCookCacheEntry(directory, index);
+    }
+    //evict least recently used entries until the new one fits in both the budget and the index
+    while(directory->totalEntries &&
+          (directory->totalBytes + size > directory->budgetBytes || directory->totalEntries == COOK_CACHE_MAX_ENTRIES)){
+        u32 oldest = 0;
+        for(u32 i = 1; i < directory->totalEntries; i++){
+            if(directory->entries[i].lastUse < directory->entries[oldest].lastUse){
+                oldest = i;
+            }
+        }
+        s8 evictedName[256];
+        getCookCacheFileName(directory, directory->entries[oldest].key, evictedName);
+        if(directory->os->deleteFile){
+            directory->os->deleteFile(evictedName);
+        }
+        removeCookCacheEntry(directory, oldest);
+    }
+    CookCacheEntry* entry = &directory->entries[directory->totalEntries++];
+    entry->key = key;
+    entry->size = size;
+    entry->lastUse = ++directory->useCounter;
+    directory->totalBytes += size;
+    directory->indexDirty = true;
+    endSpinLock(&directory->lock);
+    return true;
+}
+
+static CookCacheBackend createCookCacheDirectoryBackend(CookCacheDirectory* directory){
+    CookCacheBackend backend = {};
+    backend.load = loadFromCookCacheDirectory;
+    backend.store = storeInCookCacheDirectory;
+    backend.userData = directory;
+    return backend;
+}
+
+//Returns the cooked size, 0 on failure. cook writes at most outCapacity bytes to out and returns the size written,
+//0 on failure. On a hit the cooked bytes come straight from the cache and cook is never called.
+static u32 cookWithCache(CookCache* cache, u64 key, u32 (*cook)(void* userData, void* out, u32 outCapacity),
+                         void* userData, void* out, u32 outCapacity){
+    u32 size = 0;
+    if(cache->local.load && cache->local.load(cache->local.userData, key, out, outCapacity, &size)){
+        atomicAdd(&cache->hits, 1);
+        return size;
+    }
+    if(cache->remote.load && cache->remote.load(cache->remote.userData, key, out, outCapacity, &size)){
+        atomicAdd(&cache->remoteHits, 1);
+        if(cache->local.store) cache->local.store(cache->local.userData, key, out, size);
+        return size;
+    }
+    atomicAdd(&cache->misses, 1);
+    size = cook(userData, out, outCapacity);
+    if(!size){
+        atomicAdd(&cache->failures, 1);
+        return 0;
+    }
+    if(cache->local.store) cache->local.store(cache->local.userData, key, out, size);
+    if(cache->remote.store) cache->remote.store(cache->remote.userData, key, out, size);
+    return size;
+}
@@ -0,0 +1,606 @@
+#pragma once
+
+#include "texture_store.h"
+
+// Image based lighting bake for skybox cubemaps. From six RGBA8 faces it produces
+//   - a specular chain: level i is the radiance prefiltered with the GGX lobe of roughness i / (levels - 1)
+//   - SH9 coefficients of the irradiance, so evaluateSH9Irradiance(n) is the cosine weighted light around n
+// Faces are in D3D order +X -X +Y -Y +Z -Z; outputs are linear float RGBA, level by level, six faces per level.
+// Specular samples are importance sampled and read from a mip of the source chosen by the sample's solid angle,
+// which keeps the sample count low without fireflies. Sample directions and cube lookups run four at a time
+// in SSE, and every level is split over rows of all six faces on the work queue.
+// createStoredIBLEnvironment puts a bake in a texture store for the renderer: the specular chain as one texture the
+// platform layers' bindTextureCube hands out, and the irradiance as SH9 on the CPU, evaluated into draw constants.
+
+#define IBL_MAX_LEVELS 10
+#define IBL_BAKE_MAGIC 0x4C424249
+#define IBL_MAX_SAMPLES 1024
+#define IBL_SH_SOURCE_SIZE 64
+#define IBL_MAX_FILE_NAME 256
+#define IBL_SRGB_TABLE_SIZE 4096
+
+struct IBLBakeSettings {
+    u32 outputSize;
+    u32 totalLevels;
+    u32 sampleCount;
+    bool srgb;
+};
+
+static IBLBakeSettings defaultIBLBakeSettings(){
+    IBLBakeSettings settings;
+    settings.outputSize = 256;
+    settings.totalLevels = 6;
+    settings.sampleCount = 64;
+    settings.srgb = true;
+    return settings;
+}
+
+struct IBLBakeResult {
+    u64 sourceHash;
+    u32 size;
+    u32 totalLevels;
+    f32 roughness[IBL_MAX_LEVELS];
+    f32* levels[IBL_MAX_LEVELS];
+    Vector3 irradianceSH[9];
+};
+
+struct IBLBakeHeader {
+    u32 magic;
+    u32 size;
+    u32 totalLevels;
+    u32 sampleCount;
+    u64 sourceHash;
+    Vector3 irradianceSH[9];
+};
+
+//a float RGBA cube and its box filtered mip chain
+struct IBLSourceChain {
+    f32* levels[16];
+    u32 sizes[16];
+    u32 totalLevels;
+};
+
+//tangent space sample directions for one roughness, stored as structure of arrays padded to a multiple of 4
+struct IBLSampleSet {
+    f32 x[IBL_MAX_SAMPLES];
+    f32 y[IBL_MAX_SAMPLES];
+    f32 z[IBL_MAX_SAMPLES];
+    f32 weight[IBL_MAX_SAMPLES];
+    f32 lod[IBL_MAX_SAMPLES];
+    u32 count;
+};
+
+struct IBLFilterJob {
+    IBLSourceChain* source;
+    IBLSampleSet* samples;
+    f32* destination;
+    u32 size;
+    u32 firstRow;
+    u32 endRow;
+};
+
+static u32 getIBLLevelSize(IBLBakeSettings* settings, u32 level){
+    u32 size = settings->outputSize >> level;
+    return size ? size : 1;
+}
+
+static u64 getIBLBakeDataSize(IBLBakeSettings* settings){
+    u64 size = sizeof(IBLBakeHeader);
+    for(u32 i = 0; i < settings->totalLevels; i++){
+        u64 s = getIBLLevelSize(settings, i);
+        size += s * s * 6 * 4 * sizeof(f32);
+    }
+    return size;
+}
+
+//direction through the centre of texel (x, y) of face; u goes right and v down on every face
+static Vector3 cubeTexelDirection(u32 face, f32 u, f32 v){
+    switch(face){
+        case 0: return Vector3(1, -v, -u);
+        case 1: return Vector3(-1, -v, u);
+        case 2: return Vector3(u, 1, v);
+        case 3: return Vector3(u, -1, -v);
+        case 4: return Vector3(u, -v, 1);
+        default: return Vector3(-u, -v, -1);
+    }
+}
+
+static f32 cubeTexelSolidAngle(f32 u, f32 v, f32 texelSize){
+    f32 d = 1.0f + u * u + v * v;
+    return texelSize * texelSize / (d * sqrtf(d));
+}
+
+//Bilinear lookup of four directions in one level of the chain. Filtering stops at face edges, which is fine
+//for the blurred levels it is used on.
+static void sampleCube4(f32* level, u32 size, __m128 x, __m128 y, __m128 z, __m128* out){
+    __m128 ax = absoluteValue4(x);
+    __m128 ay = absoluteValue4(y);
+    __m128 az = absoluteValue4(z);
+    __m128 zero = _mm_setzero_ps();
+    __m128 isX = _mm_and_ps(_mm_cmpge_ps(ax, ay), _mm_cmpge_ps(ax, az));
+    __m128 isY = _mm_andnot_ps(isX, _mm_cmpge_ps(ay, az));
+
+    __m128 xPositive = _mm_cmpgt_ps(x, zero);
+    __m128 yPositive = _mm_cmpgt_ps(y, zero);
+    __m128 zPositive = _mm_cmpgt_ps(z, zero);
+    __m128 negZ = _mm_sub_ps(zero, z);
+    __m128 negY = _mm_sub_ps(zero, y);
+    __m128 negX = _mm_sub_ps(zero, x);
+
+    //numerators of u and v for each major axis, then the one that applies
+    __m128 uX = select4(xPositive, negZ, z);
+    __m128 uZ = select4(zPositive, x, negX);
+    __m128 vY = select4(yPositive, z, negZ);
+    __m128 u = select4(isX, uX, select4(isY, x, uZ));
+    __m128 v = select4(isY, vY, negY);
+    __m128 major = select4(isX, ax, select4(isY, ay, az));
+
+    __m128 faceX = select4(xPositive, zero, _mm_set1_ps(1));
+    __m128 faceY = select4(yPositive, _mm_set1_ps(2), _mm_set1_ps(3));
+    __m128 faceZ = select4(zPositive, _mm_set1_ps(4), _mm_set1_ps(5));
+    __m128 face = select4(isX, faceX, select4(isY, faceY, faceZ));
+
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 scale = _mm_set1_ps((f32)size);
+    __m128 inv = _mm_div_ps(half, major);
+    __m128 s = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(u, inv), half), scale), half);
+    __m128 t = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(v, inv), half), scale), half);
+    __m128 maxCoordinate = _mm_set1_ps((f32)size - 1);
+    s = _mm_min_ps(_mm_max_ps(s, zero), maxCoordinate);
+    t = _mm_min_ps(_mm_max_ps(t, zero), maxCoordinate);
+
+    __m128i s0 = _mm_cvttps_epi32(s);
+    __m128i t0 = _mm_cvttps_epi32(t);
+    __m128 fs = _mm_sub_ps(s, _mm_cvtepi32_ps(s0));
+    __m128 ft = _mm_sub_ps(t, _mm_cvtepi32_ps(t0));
+
+    s32 si[4], ti[4], fi[4];
+    f32 fsa[4], fta[4];
+    _mm_storeu_si128((__m128i*)si, s0);
+    _mm_storeu_si128((__m128i*)ti, t0);
+    _mm_storeu_si128((__m128i*)fi, _mm_cvttps_epi32(face));
+    _mm_storeu_ps(fsa, fs);
+    _mm_storeu_ps(fta, ft);
+    for(u32 i = 0; i < 4; i++){
+        f32* f = level + (u64)fi[i] * size * size * 4;
+        u32 s1 = si[i] + 1 < (s32)size ? si[i] + 1 : si[i];
+        u32 t1 = ti[i] + 1 < (s32)size ? ti[i] + 1 : ti[i];
+        __m128 a = _mm_loadu_ps(f + (ti[i] * size + si[i]) * 4);
+        __m128 b = _mm_loadu_ps(f + (ti[i] * size + s1) * 4);
+        __m128 c = _mm_loadu_ps(f + (t1 * size + si[i]) * 4);
+        __m128 d = _mm_loadu_ps(f + (t1 * size + s1) * 4);
+        __m128 wx = _mm_set1_ps(fsa[i]);
+        __m128 top = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), wx));
+        __m128 bottom = _mm_add_ps(c, _mm_mul_ps(_mm_sub_ps(d, c), wx));
+        out[i] = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), _mm_set1_ps(fta[i])));
+    }
+}
+
+static f32 radicalInverse(u32 bits){
+    bits = (bits << 16) | (bits >> 16);
+    bits = ((bits & 0x55555555) << 1) | ((bits & 0xAAAAAAAA) >> 1);
+    bits = ((bits & 0x33333333) << 2) | ((bits & 0xCCCCCCCC) >> 2);
+    bits = ((bits & 0x0F0F0F0F) << 4) | ((bits & 0xF0F0F0F0) >> 4);
+    bits = ((bits & 0x00FF00FF) << 8) | ((bits & 0xFF00FF00) >> 8);
+    return (f32)bits * 2.3283064365386963e-10f;
+}
+
+//GGX importance samples around n = v = (0, 0, 1). The source lod of each sample matches its solid angle
+//to the texel solid angle of the chain so every sample covers its share of the lobe.
+static void buildIBLSampleSet(IBLSampleSet* set, f32 roughness, u32 sampleCount, u32 sourceSize, u32 sourceLevels){
+    f32 a = roughness * roughness;
+    f32 a2 = a * a;
+    f32 texelSolidAngle = 4.0f * (f32)PI / (6.0f * sourceSize * sourceSize);
+    set->count = 0;
+    for(u32 i = 0; i < sampleCount && set->count < IBL_MAX_SAMPLES; i++){
+        f32 e1 = (f32)i / (f32)sampleCount;
+        f32 e2 = radicalInverse(i);
+        f32 phi = 2.0f * (f32)PI * e1;
+        f32 cosTheta = sqrtf((1.0f - e2) / (1.0f + (a2 - 1.0f) * e2));
+        f32 sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+        f32 hx = sinTheta * cosf(phi);
+        f32 hy = sinTheta * sinf(phi);
+        f32 hz = cosTheta;
+        //reflect v about h
+        f32 lz = 2.0f * hz * hz - 1.0f;
+        if(lz <= 0) continue;
+        f32 d = hz * hz * (a2 - 1.0f) + 1.0f;
+        f32 D = a2 / ((f32)PI * d * d);
+        f32 pdf = D * 0.25f;
+        f32 sampleSolidAngle = 1.0f / ((f32)sampleCount * pdf + 0.0001f);
+        f32 lod = roughness == 0 ? 0 : 0.5f * log2f(sampleSolidAngle / texelSolidAngle) + 1.0f;
+        lod = clamp(lod, 0, (f32)(sourceLevels - 1));
+
+        u32 n = set->count++;
+        set->x[n] = 2.0f * hz * hx;
+        set->y[n] = 2.0f * hz * hy;
+        set->z[n] = lz;
+        set->weight[n] = lz;
+        set->lod[n] = lod;
+    }
+    //sorted by lod so that each group of four, which shares one lookup level, holds similar lods
+    for(u32 i = 1; i < set->count; i++){
+        f32 x = set->x[i], y = set->y[i], z = set->z[i], weight = set->weight[i], lod = set->lod[i];
+        s32 j = (s32)i - 1;
+        for(; j >= 0 && set->lod[j] > lod; j--){
+            set->x[j + 1] = set->x[j];
+            set->y[j + 1] = set->y[j];
+            set->z[j + 1] = set->z[j];
+            set->weight[j + 1] = set->weight[j];
+            set->lod[j + 1] = set->lod[j];
+        }
+        set->x[j + 1] = x;
+        set->y[j + 1] = y;
+        set->z[j + 1] = z;
+        set->weight[j + 1] = weight;
+        set->lod[j + 1] = lod;
+    }
+    //pad to a multiple of four with zero weight copies of the first sample
+    while(set->count & 3){
+        u32 n = set->count++;
+        set->x[n] = set->x[0];
+        set->y[n] = set->y[0];
+        set->z[n] = set->z[0];
+        set->weight[n] = 0;
+        set->lod[n] = set->lod[0];
+    }
+}
+
+//rows run over all six faces: row r is row r % size of face r / size
+static void filterIBLRows(void* data){
+    IBLFilterJob* job = (IBLFilterJob*)data;
+    IBLSourceChain* source = job->source;
+    IBLSampleSet* samples = job->samples;
+    u32 size = job->size;
+    f32 texelSize = 2.0f / size;
+    for(u32 row = job->firstRow; row < job->endRow; row++){
+        u32 face = row / size;
+        u32 y = row % size;
+        f32* dst = job->destination + ((u64)face * size * size + y * size) * 4;
+        for(u32 x = 0; x < size; x++){
+            Vector3 n = cubeTexelDirection(face, (x + 0.5f) * texelSize - 1.0f, (y + 0.5f) * texelSize - 1.0f);
+            normalize(&n);
+            Vector3 up = absoluteValue(n.z) < 0.999f ? Vector3(0, 0, 1) : Vector3(1, 0, 0);
+            Vector3 tx = cross(up, n);
+            normalize(&tx);
+            Vector3 ty = cross(n, tx);
+
+            __m128 sum = _mm_setzero_ps();
+            f32 totalWeight = 0;
+            for(u32 i = 0; i < samples->count; i += 4){
+                __m128 sx = _mm_loadu_ps(samples->x + i);
+                __m128 sy = _mm_loadu_ps(samples->y + i);
+                __m128 sz = _mm_loadu_ps(samples->z + i);
+                __m128 lx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, _mm_set1_ps(tx.x)), _mm_mul_ps(sy, _mm_set1_ps(ty.x))), _mm_mul_ps(sz, _mm_set1_ps(n.x)));
+                __m128 ly = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, _mm_set1_ps(tx.y)), _mm_mul_ps(sy, _mm_set1_ps(ty.y))), _mm_mul_ps(sz, _mm_set1_ps(n.y)));
+                __m128 lz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, _mm_set1_ps(tx.z)), _mm_mul_ps(sy, _mm_set1_ps(ty.z))), _mm_mul_ps(sz, _mm_set1_ps(n.z)));
+
+                f32 lod = (samples->lod[i] + samples->lod[i + 1] + samples->lod[i + 2] + samples->lod[i + 3]) * 0.25f;
+                u32 lod0 = (u32)lod;
+                u32 lod1 = lod0 + 1 < source->totalLevels ? lod0 + 1 : lod0;
+                f32 t = lod - lod0;
+                __m128 c0[4], c1[4];
+                sampleCube4(source->levels[lod0], source->sizes[lod0], lx, ly, lz, c0);
+                if(t > 0.001f && lod1 != lod0){
+                    sampleCube4(source->levels[lod1], source->sizes[lod1], lx, ly, lz, c1);
+                }else{
+                    c1[0] = c0[0]; c1[1] = c0[1]; c1[2] = c0[2]; c1[3] = c0[3];
+                }
+                for(u32 j = 0; j < 4; j++){
+                    __m128 c = _mm_add_ps(c0[j], _mm_mul_ps(_mm_sub_ps(c1[j], c0[j]), _mm_set1_ps(t)));
+                    sum = _mm_add_ps(sum, _mm_mul_ps(c, _mm_set1_ps(samples->weight[i + j])));
+                    totalWeight += samples->weight[i + j];
+                }
+            }
+            _mm_storeu_ps(dst + x * 4, _mm_mul_ps(sum, _mm_set1_ps(1.0f / totalWeight)));
+        }
+    }
+}
+
+static void runIBLFilterJobs(IBLFilterJob* base, u32 rows, OSInterface* os, WorkQueue* queue){
+    if(!os || !queue || rows < 2){
+        base->firstRow = 0;
+        base->endRow = rows;
+        filterIBLRows(base);
+        return;
+    }
+    IBLFilterJob jobs[WorkQueue::MAX_ENTRIES - 1];
+    u32 totalJobs = rows < WorkQueue::MAX_ENTRIES - 1 ? rows : WorkQueue::MAX_ENTRIES - 1;
+    u32 rowsPerJob = (rows + totalJobs - 1) / totalJobs;
+    u32 jobCount = 0;
+    for(u32 row = 0; row < rows; row += rowsPerJob){
+        jobs[jobCount] = *base;
+        jobs[jobCount].firstRow = row;
+        jobs[jobCount].endRow = row + rowsPerJob < rows ? row + rowsPerJob : rows;
+        os->addWorkQueueEntry(queue, filterIBLRows, &jobs[jobCount]);
+        jobCount++;
+    }
+    os->completeWorkQueueEntries(queue);
+}
+
+static bool buildIBLSourceChain(u8* faces, u32 faceSize, bool srgb, IBLSourceChain* chain, MemoryArena* scratch){
+    f32 table[256];
+    for(u32 i = 0; i < 256; i++){
+        f32 c = i / 255.0f;
+        table[i] = !srgb ? c : c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    chain->totalLevels = findMostSignificantBit(faceSize) + 1;
+    if(chain->totalLevels > 16) return false;
+    for(u32 level = 0; level < chain->totalLevels; level++){
+        u32 size = faceSize >> level;
+        chain->sizes[level] = size;
+        chain->levels[level] = pushArray(scratch, f32, (u64)size * size * 6 * 4);
+        if(!chain->levels[level]) return false;
+        f32* dst = chain->levels[level];
+        if(level == 0){
+            for(u64 i = 0; i < (u64)size * size * 6; i++){
+                dst[i * 4 + 0] = table[faces[i * 4 + 0]];
+                dst[i * 4 + 1] = table[faces[i * 4 + 1]];
+                dst[i * 4 + 2] = table[faces[i * 4 + 2]];
+                dst[i * 4 + 3] = faces[i * 4 + 3] / 255.0f;
+            }
+            continue;
+        }
+        f32* src = chain->levels[level - 1];
+        u32 srcSize = size * 2;
+        __m128 quarter = _mm_set1_ps(0.25f);
+        for(u32 face = 0; face < 6; face++){
+            f32* s = src + (u64)face * srcSize * srcSize * 4;
+            f32* d = dst + (u64)face * size * size * 4;
+            for(u32 y = 0; y < size; y++){
+                for(u32 x = 0; x < size; x++){
+                    f32* p = s + ((y * 2) * srcSize + x * 2) * 4;
+                    __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(p), _mm_loadu_ps(p + 4)),
+                                            _mm_add_ps(_mm_loadu_ps(p + srcSize * 4), _mm_loadu_ps(p + srcSize * 4 + 4)));
+                    _mm_storeu_ps(d + (y * size + x) * 4, _mm_mul_ps(sum, quarter));
+                }
+            }
+        }
+    }
+    return true;
+}
+
+//projects the cube onto the first 3 SH bands and convolves with the clamped cosine lobe
+static void computeIrradianceSH9(IBLSourceChain* chain, Vector3* sh){
+    u32 level = 0;
+    while(level + 1 < chain->totalLevels && chain->sizes[level] > IBL_SH_SOURCE_SIZE) level++;
+    u32 size = chain->sizes[level];
+    f32* pixels = chain->levels[level];
+    f32 texelSize = 2.0f / size;
+    f32 accum[9][3] = {};
+    f32 totalSolidAngle = 0;
+    for(u32 face = 0; face < 6; face++){
+        for(u32 y = 0; y < size; y++){
+            for(u32 x = 0; x < size; x++){
+                f32 u = (x + 0.5f) * texelSize - 1.0f;
+                f32 v = (y + 0.5f) * texelSize - 1.0f;
+                Vector3 d = cubeTexelDirection(face, u, v);
+                normalize(&d);
+                f32 w = cubeTexelSolidAngle(u, v, texelSize);
+                f32 basis[9] = {
+                    0.282095f,
+                    0.488603f * d.y, 0.488603f * d.z, 0.488603f * d.x,
+                    1.092548f * d.x * d.y, 1.092548f * d.y * d.z, 0.315392f * (3.0f * d.z * d.z - 1.0f),
+                    1.092548f * d.x * d.z, 0.546274f * (d.x * d.x - d.y * d.y)
+                };
+                f32* c = pixels + (((u64)face * size + y) * size + x) * 4;
+                for(u32 i = 0; i < 9; i++){
+                    accum[i][0] += c[0] * basis[i] * w;
+                    accum[i][1] += c[1] * basis[i] * w;
+                    accum[i][2] += c[2] * basis[i] * w;
+                }
+                totalSolidAngle += w;
+            }
+        }
+    }
+    f32 normalization = 4.0f * (f32)PI / totalSolidAngle;
+    const f32 band[9] = {(f32)PI, 2.0f * (f32)PI / 3.0f, 2.0f * (f32)PI / 3.0f, 2.0f * (f32)PI / 3.0f,
+                         (f32)PI * 0.25f, (f32)PI * 0.25f, (f32)PI * 0.25f, (f32)PI * 0.25f, (f32)PI * 0.25f};
+    for(u32 i = 0; i < 9; i++){
+        f32 s = normalization * band[i];
+        sh[i] = Vector3(accum[i][0] * s, accum[i][1] * s, accum[i][2] * s);
+    }
+}
+
+static Vector3 evaluateSH9Irradiance(Vector3* sh, Vector3 n){
+    Vector3 result = sh[0] * 0.282095f;
+    result = result + sh[1] * (0.488603f * n.y) + sh[2] * (0.488603f * n.z) + sh[3] * (0.488603f * n.x);
+    result = result + sh[4] * (1.092548f * n.x * n.y) + sh[5] * (1.092548f * n.y * n.z);
+    result = result + sh[6] * (0.315392f * (3.0f * n.z * n.z - 1.0f)) + sh[7] * (1.092548f * n.x * n.z);
+    result = result + sh[8] * (0.546274f * (n.x * n.x - n.y * n.y));
+    return result;
+}
+
+static u64 hashIBLSource(u8* faces, u32 faceSize, IBLBakeSettings* settings){
+    u64 h = hashMemory(faces, (u64)faceSize * faceSize * 6 * 4);
+    return hashMemory(settings, sizeof(IBLBakeSettings), h);
+}
+
+static bool loadIBLBake(u8* data, u64 dataSize, IBLBakeResult* result){
+    IBLBakeHeader* header = (IBLBakeHeader*)data;
+    if(dataSize < sizeof(IBLBakeHeader) || header->magic != IBL_BAKE_MAGIC ||
+       header->totalLevels == 0 || header->totalLevels > IBL_MAX_LEVELS){
+        return false;
+    }
+    IBLBakeSettings settings = {};
+    settings.outputSize = header->size;
+    settings.totalLevels = header->totalLevels;
+    if(getIBLBakeDataSize(&settings) > dataSize){
+        return false;
+    }
+    result->sourceHash = header->sourceHash;
+    result->size = header->size;
+    result->totalLevels = header->totalLevels;
+    for(u32 i = 0; i < 9; i++){
+        result->irradianceSH[i] = header->irradianceSH[i];
+    }
+    f32* levels = (f32*)(header + 1);
+    for(u32 i = 0; i < header->totalLevels; i++){
+        u32 size = getIBLLevelSize(&settings, i);
+        result->levels[i] = levels;
+        result->roughness[i] = header->totalLevels > 1 ? (f32)i / (f32)(header->totalLevels - 1) : 0;
+        levels += (u64)size * size * 6 * 4;
+    }
+    return true;
+}
+
+//Bakes into data, which must hold getIBLBakeDataSize bytes and starts with an IBLBakeHeader, so the same block can
+//be written out and later loaded with loadIBLBake. The source chain lives in scratch (about 130 MB for 1024 faces).
+static bool bakeIBL(u8* faces, u32 faceSize, IBLBakeSettings* settings, u8* data, IBLBakeResult* result,
+                    MemoryArena* scratch, OSInterface* os = 0, WorkQueue* queue = 0){
+    if(settings->totalLevels == 0 || settings->totalLevels > IBL_MAX_LEVELS || settings->outputSize > faceSize ||
+       (faceSize & (faceSize - 1)) || (settings->outputSize & (settings->outputSize - 1))){
+        return false;
+    }
+    u64 scratchMark = scratch->used;
+    IBLSourceChain chain;
+    IBLSampleSet* samples = pushStruct(scratch, IBLSampleSet);
+    if(!samples || !buildIBLSourceChain(faces, faceSize, settings->srgb, &chain, scratch)){
+        scratch->used = scratchMark;
+        return false;
+    }
+
+    IBLBakeHeader* header = (IBLBakeHeader*)data;
+    header->magic = IBL_BAKE_MAGIC;
+    header->size = settings->outputSize;
+    header->totalLevels = settings->totalLevels;
+    header->sampleCount = settings->sampleCount;
+    header->sourceHash = hashIBLSource(faces, faceSize, settings);
+    computeIrradianceSH9(&chain, header->irradianceSH);
+
+    //the output sizes are in the source chain already, so level sizes map to a chain level directly
+    u32 baseLevel = findMostSignificantBit(faceSize) - findMostSignificantBit(settings->outputSize);
+    f32* dst = (f32*)(header + 1);
+    for(u32 level = 0; level < settings->totalLevels; level++){
+        u32 size = getIBLLevelSize(settings, level);
+        f32 roughness = settings->totalLevels > 1 ? (f32)level / (f32)(settings->totalLevels - 1) : 0;
+        if(level == 0){
+            copyMemory(dst, chain.levels[baseLevel], (u64)size * size * 6 * 4 * sizeof(f32));
+        }else{
+            buildIBLSampleSet(samples, roughness, settings->sampleCount, faceSize, chain.totalLevels);
+            IBLFilterJob job = {};
+            job.source = &chain;
+            job.samples = samples;
+            job.destination = dst;
+            job.size = size;
+            runIBLFilterJobs(&job, size * 6, os, queue);
+        }
+        dst += (u64)size * size * 6 * 4;
+    }
+
+    scratch->used = scratchMark;
+    return loadIBLBake(data, getIBLBakeDataSize(settings), result);
+}
+
+//fileName has to hold IBL_MAX_FILE_NAME, cacheDirectory ends in a separator or is empty for the working directory
+static void getIBLBakeFileName(const s8* cacheDirectory, u64 hash, s8* fileName){
+    u32 ctr = 0;
+    fileName[0] = '\0';
+    concatenateCharacterStrings(fileName, cacheDirectory, &ctr);
+    concatenateCharacterStrings(fileName, "ibl_", &ctr);
+    for(s32 i = 15; i >= 0; i--){
+        fileName[ctr++] = "0123456789abcdef"[(hash >> (i * 4)) & 15];
+    }
+    fileName[ctr] = '\0';
+    concatenateCharacterStrings(fileName, ".bin", &ctr);
+}
+
+//Reuses cacheDirectory/ibl_<source hash>.bin if it exists, otherwise bakes and writes it. The bake data is pushed
+//onto arena and result points into it.
+static bool bakeIBLCached(OSInterface* os, u8* faces, u32 faceSize, IBLBakeSettings* settings, const s8* cacheDirectory,
+                          IBLBakeResult* result, MemoryArena* arena, MemoryArena* scratch, WorkQueue* queue = 0){
+    u64 dataSize = getIBLBakeDataSize(settings);
+    u8* data = (u8*)pushSize(arena, dataSize);
+    if(!data){
+        return false;
+    }
+    u64 hash = hashIBLSource(faces, faceSize, settings);
+    s8 fileName[IBL_MAX_FILE_NAME];
+    getIBLBakeFileName(cacheDirectory, hash, fileName);
+
+    u32 fileLength = 0;
+    if(os->readFileIntoBoundedBuffer(fileName, data, (u32)dataSize, &fileLength) && fileLength == dataSize &&
+       loadIBLBake(data, dataSize, result) && result->sourceHash == hash){
+        return true;
+    }
+    if(!bakeIBL(faces, faceSize, settings, data, result, scratch, os, queue)){
+        return false;
+    }
+    os->writeToFile(fileName, data, (u32)dataSize);
+    return true;
+}
+
+//The specular chain is one RGBA8 texture whose level i is the six faces of bake level i stacked top to bottom in face
+//order, which is the order the bake keeps them in, so the chain halves like any other. It is encoded back to sRGB when
+//the source was sRGB, shaders decode it the way they decode the source.
+struct StoredIBLEnvironment {
+    StoredTexture* specular;
+    u32 size;
+    u32 totalLevels;
+    Vector3 irradianceSH[9];
+};
+
+//linear float RGBA levels to RGBA8, alpha stays linear
+static void encodeIBLLevels(f32* levels, u64 totalTexels, bool srgb, u8* output){
+    u8 table[IBL_SRGB_TABLE_SIZE];
+    for(u32 i = 0; i < IBL_SRGB_TABLE_SIZE; i++){
+        f32 c = i / (f32)(IBL_SRGB_TABLE_SIZE - 1);
+        if(srgb){
+            c = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+        }
+        table[i] = (u8)(c * 255.0f + 0.5f);
+    }
+    for(u64 i = 0; i < totalTexels * 4; i++){
+        f32 c = clamp(levels[i], 0, 1);
+        output[i] = (i & 3) == 3 ? (u8)(c * 255.0f + 0.5f) : table[(u32)(c * (IBL_SRGB_TABLE_SIZE - 1) + 0.5f)];
+    }
+}
+
+//Bakes, through the cache when cacheDirectory is given, and creates the specular texture in the store. Everything is
+//worked on in the store's scratch, which has to hold the bake, its RGBA8 copy and the source chain.
+static bool createStoredIBLEnvironment(StoredIBLEnvironment* environment, TextureStore* store, OSInterface* os,
+                                       u8* faces, u32 faceSize, IBLBakeSettings* settings, const s8* cacheDirectory,
+                                       WorkQueue* queue = 0){
+    //past the level where a face is a single texel the stacked faces would stop halving with the texture
+    if(settings->totalLevels > findMostSignificantBit(settings->outputSize) + 1){
+        return false;
+    }
+    MemoryArena* scratch = &store->scratch;
+    u64 scratchMark = scratch->used;
+    IBLBakeResult result;
+    bool baked = false;
+    if(cacheDirectory){
+        baked = bakeIBLCached(os, faces, faceSize, settings, cacheDirectory, &result, scratch, scratch, queue);
+    }else{
+        u8* data = (u8*)pushSize(scratch, getIBLBakeDataSize(settings));
+        baked = data && bakeIBL(faces, faceSize, settings, data, &result, scratch, os, queue);
+    }
+    u32 size = settings->outputSize;
+    u64 totalTexels = (getIBLBakeDataSize(settings) - sizeof(IBLBakeHeader)) / (4 * sizeof(f32));
+    u8* pixels = baked ? pushArray(scratch, u8, totalTexels * 4) : 0;
+    StoredTexture* specular = 0;
+    if(pixels){
+        //the levels follow each other in the bake
+        encodeIBLLevels(result.levels[0], totalTexels, settings->srgb, pixels);
+        specular = createStoredTexture2D(store, pixels, size, size * 6, RENDER_FORMAT_R8G8B8A8_UNORM,
+                                         settings->totalLevels);
+    }
+    scratch->used = scratchMark;
+    if(!specular){
+        return false;
+    }
+    environment->specular = specular;
+    environment->size = size;
+    environment->totalLevels = settings->totalLevels;
+    for(u32 i = 0; i < 9; i++){
+        environment->irradianceSH[i] = result.irradianceSH[i];
+    }
+    return true;
+}
+
+//the light a white lambertian surface facing n reflects, irradiance over pi
+static Vector3 getIBLAmbient(StoredIBLEnvironment* environment, Vector3 n){
+    Vector3 irradiance = evaluateSH9Irradiance(environment->irradianceSH, n);
+    return Vector3(irradiance.x > 0 ? irradiance.x : 0, irradiance.y > 0 ? irradiance.y : 0,
+                   irradiance.z > 0 ? irradiance.z : 0) * (1.0f / (f32)PI);
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "upload_ring.h"
+
+//Descriptor allocator.
+//Hands out slots of one descriptor heap, split in two ranges. Slots [0, persistentCount) live until they are given
+//back and are the bindless indices shaders use to reach a resource; slots from persistentCount on are transient,
+//handed out in contiguous runs for one frame's tables and taken back all at once when the frame's fence passes.
+//Persistent slots come from a free list kept as a lock-free stack: allocating pops its head and freeing pushes onto it
+//with one compare exchange on a 64 bit head holding the slot index and a tag bumped on every change, so a head that
+//was popped and pushed again in between is not mistaken for the one that was read. The links live in one array of the
+//next free slot per slot. Any thread can allocate and free at any time, nothing takes a lock.
+//A slot the GPU may still read is retired instead of freed. Retired slots collect on a list that endDescriptorFrame
+//tags with the fence value the frame will signal, and beginDescriptorFrame moves every list the fence has reached back
+//onto the free list, so a slot is never rewritten while a frame in flight still uses it.
+//Transient runs are an UploadRing over the transient range, with offsets counted in descriptors instead of bytes.
+//Every thread must be done allocating transient runs and retiring slots before endDescriptorFrame.
+
+#define DESCRIPTOR_ALLOCATOR_MAX_FRAMES 16
+#define DESCRIPTOR_INDEX_NONE MAX_U32
+
+struct DescriptorFrame {
+    u64 fenceValue;
+    u32 firstRetired;
+};
+
+struct DescriptorAllocatorStats {
+    u64 frames;
+    u64 retiredDescriptors;
+    u64 failedAllocations;
+};
+
+struct DescriptorAllocator {
+    RenderDescriptorHeap heap;
+    u32 persistentCount;
+    u32* nextFree;
+
+    //low 32 bits are the first free slot, high 32 bits the tag
+    volatile u64 freeHead;
+    volatile u32 retiredHead;
+    volatile u32 retiredCount;
+    volatile u32 failures;
+
+    DescriptorFrame frames[DESCRIPTOR_ALLOCATOR_MAX_FRAMES];
+    u32 firstFrame;
+    u32 totalFrames;
+
+    UploadRing transient;
+    DescriptorAllocatorStats stats;
+};
+
+//splits an existing heap, the links for the free list come from the arena
+static bool initializeDescriptorAllocatorHeap(DescriptorAllocator* allocator, RenderDescriptorHeap* heap,
+                                              u32 persistentCount, MemoryArena* arena){
+    setMemory(allocator, sizeof(DescriptorAllocator));
+    if(persistentCount > heap->capacity || persistentCount == DESCRIPTOR_INDEX_NONE){
+        return false;
+    }
+    allocator->nextFree = persistentCount ? pushArray(arena, u32, persistentCount) : 0;
+    if(persistentCount && !allocator->nextFree){
+        return false;
+    }
+    for(u32 i = 0; i < persistentCount; i++){
+        allocator->nextFree[i] = i + 1 < persistentCount ? i + 1 : DESCRIPTOR_INDEX_NONE;
+    }
+    allocator->heap = *heap;
+    allocator->persistentCount = persistentCount;
+    allocator->freeHead = persistentCount ? 0 : DESCRIPTOR_INDEX_NONE;
+    allocator->retiredHead = DESCRIPTOR_INDEX_NONE;
+    initializeUploadRingMemory(&allocator->transient, 0, 0, heap->capacity - persistentCount);
+    beginUploadRingFrame(&allocator->transient, 0);
+    return true;
+}
+
+static bool initializeDescriptorAllocator(DescriptorAllocator* allocator, RenderBackend* backend, u32 type,
+                                          u32 persistentCount, u32 transientCount, MemoryArena* arena){
+    RenderDescriptorHeap heap;
+    if(!backend->createDescriptorHeap(backend, type, persistentCount + transientCount, &heap)){
+        setMemory(allocator, sizeof(DescriptorAllocator));
+        return false;
+    }
+    return initializeDescriptorAllocatorHeap(allocator, &heap, persistentCount, arena);
+}
+
+//returns DESCRIPTOR_INDEX_NONE when every persistent slot is taken or waiting on the gpu
+static u32 allocateDescriptor(DescriptorAllocator* allocator){
+    for(;;){
+        u64 head = allocator->freeHead;
+        u32 index = (u32)head;
+        if(index == DESCRIPTOR_INDEX_NONE){
+            atomicAdd(&allocator->failures, 1);
+            return DESCRIPTOR_INDEX_NONE;
+        }
+        u64 next = (((head >> 32) + 1) << 32) | allocator->nextFree[index];
+        if(atomicCompareExchange64(&allocator->freeHead, next, head) == head){
+            return index;
+        }
+    }
+}
+
+//pushes the chain first to last, already linked through nextFree, onto the free list in one exchange
+static void pushFreeDescriptors(DescriptorAllocator* allocator, u32 first, u32 last){
+    for(;;){
+        u64 head = allocator->freeHead;
+        allocator->nextFree[last] = (u32)head;
+        u64 next = (((head >> 32) + 1) << 32) | first;
+        if(atomicCompareExchange64(&allocator->freeHead, next, head) == head){
+            return;
+        }
+    }
+}
+
+//for slots the gpu has never read, or is known to be done with
+static void freeDescriptor(DescriptorAllocator* allocator, u32 index){
+    pushFreeDescriptors(allocator, index, index);
+}
+
+//the slot goes back to the free list once the fence passes the frame being recorded
+static void retireDescriptor(DescriptorAllocator* allocator, u32 index){
+    for(;;){
+        u32 head = allocator->retiredHead;
+        allocator->nextFree[index] = head;
+        if(atomicCompareExchange(&allocator->retiredHead, index, head) == head){
+            break;
+        }
+    }
+    atomicAdd(&allocator->retiredCount, 1);
+}
+
+//returns the first of count contiguous slots valid for this frame, or DESCRIPTOR_INDEX_NONE
+static u32 allocateTransientDescriptors(DescriptorAllocator* allocator, u32 count){
+    UploadAllocation allocation;
+    if(!allocateUploadRing(&allocator->transient, count, 1, &allocation)){
+        atomicAdd(&allocator->failures, 1);
+        return DESCRIPTOR_INDEX_NONE;
+    }
+    return allocator->persistentCount + allocation.offset;
+}
+
+static u32 getLastRetiredDescriptor(DescriptorAllocator* allocator, u32 first){
+    u32 last = first;
+    while(allocator->nextFree[last] != DESCRIPTOR_INDEX_NONE){
+        last = allocator->nextFree[last];
+    }
+    return last;
+}
+
+//frees the slots of every frame the fence has reached and opens a new transient frame
+static void beginDescriptorFrame(DescriptorAllocator* allocator, u64 completedFenceValue){
+    while(allocator->totalFrames){
+        DescriptorFrame* frame = &allocator->frames[allocator->firstFrame];
+        if(frame->fenceValue > completedFenceValue){
+            break;
+        }
+        pushFreeDescriptors(allocator, frame->firstRetired, getLastRetiredDescriptor(allocator, frame->firstRetired));
+        allocator->firstFrame = (allocator->firstFrame + 1) % DESCRIPTOR_ALLOCATOR_MAX_FRAMES;
+        allocator->totalFrames--;
+    }
+    beginUploadRingFrame(&allocator->transient, completedFenceValue);
+}
+
+//hands the frame's retired slots and transient runs to fenceValue, a full frame list folds into the newest frame
+static void endDescriptorFrame(DescriptorAllocator* allocator, u64 fenceValue){
+    DescriptorAllocatorStats* stats = &allocator->stats;
+    endUploadRingFrame(&allocator->transient, fenceValue);
+    stats->frames++;
+    stats->retiredDescriptors += allocator->retiredCount;
+    stats->failedAllocations += allocator->failures;
+    allocator->retiredCount = 0;
+    allocator->failures = 0;
+    u32 first = allocator->retiredHead;
+    if(first == DESCRIPTOR_INDEX_NONE){
+        return;
+    }
+    allocator->retiredHead = DESCRIPTOR_INDEX_NONE;
+    if(allocator->totalFrames == DESCRIPTOR_ALLOCATOR_MAX_FRAMES){
+        DescriptorFrame* newest = &allocator->frames[(allocator->firstFrame + allocator->totalFrames - 1) %
+                                                     DESCRIPTOR_ALLOCATOR_MAX_FRAMES];
+        allocator->nextFree[getLastRetiredDescriptor(allocator, first)] = newest->firstRetired;
+        newest->fenceValue = fenceValue;
+        newest->firstRetired = first;
+        return;
+    }
+    DescriptorFrame* frame = &allocator->frames[(allocator->firstFrame + allocator->totalFrames) %
+                                                DESCRIPTOR_ALLOCATOR_MAX_FRAMES];
+    frame->fenceValue = fenceValue;
+    frame->firstRetired = first;
+    allocator->totalFrames++;
+}
+
+static u64 getDescriptorCpuHandle(DescriptorAllocator* allocator, u32 index){
+    return allocator->heap.cpuStart + (u64)index * allocator->heap.increment;
+}
+
+//0 for heaps shaders cannot see
+static u64 getDescriptorGpuHandle(DescriptorAllocator* allocator, u32 index){
+    if(!allocator->heap.gpuStart){
+        return 0;
+    }
+    return allocator->heap.gpuStart + (u64)index * allocator->heap.increment;
+}
@@ -6,13 +6,442 @@
 #include <xaudio2.h>
 #include <xinput.h>
 #include "os_interface.h"
+#include "asset_database.h"
+#include "frame_pacing.h"
+#include "model_store.h"
+#include "texture_store.h"
+#include "scratch_scene.h"
+#include "descriptor_allocator.h"
+#include "command_list_pool.h"
+#include "pipeline_cache.h"
+#include "vertex_quantization.h"
 
 #define WinAssert(x) \
     if (FAILED(x)) *(int*)0 = 0
 
+#define D3D12_MAX_COMMAND_LISTS 64
+#define D3D12_UPLOAD_STAGING_SIZE MEGABYTE(8)
+#define D3D12_UPLOAD_BUDGET MEGABYTE(2)
+#define D3D12_PERSISTENT_DESCRIPTORS 8192
+#define D3D12_TRANSIENT_DESCRIPTORS 8192
+#define D3D12_SAMPLER_DESCRIPTORS 64
+#define D3D12_RENDER_TARGET_DESCRIPTORS 64
+#define D3D12_MIN_DRAWS_PER_LIST 64
+#define D3D12_MAX_BATCHED_BARRIERS 64
+#define D3D12_PIPELINE_LIBRARY_FILE "dx12_pipelines.bin"
+#define D3D12_PIPELINE_LIBRARY_SIZE MEGABYTE(16)
+#define D3D12_MODEL_VERTEX_CHUNK MEGABYTE(16)
+#define D3D12_MODEL_INDEX_CHUNK MEGABYTE(8)
+#define D3D12_MAX_MODELS 4096
+#define D3D12_MODEL_SOURCE_SIZE MEGABYTE(8)
+#define D3D12_MODEL_SCRATCH_SIZE MEGABYTE(8)
+#define D3D12_QUANTIZE_MODELS true
+#define D3D12_MAX_TEXTURES 4096
+#define D3D12_TEXTURE_SOURCE_SIZE MEGABYTE(16)
+#define D3D12_TEXTURE_SCRATCH_SIZE MEGABYTE(64)
+#define D3D12_TEXTURE_COMPRESSION BLOCK_COMPRESSION_BC1
+#define D3D12_STREAMED_TEXTURES 8
+#define D3D12_STREAMING_BUDGET MEGABYTE(64)
+#define D3D12_STREAMING_READ_SIZE MEGABYTE(16)
+#define D3D12_MAX_TEXTURE_CUBES 16
+#define D3D12_IBL_CACHE_DIRECTORY ""
+#define D3D12_COOK_CACHE_DIRECTORY "cook/"
+#define D3D12_COOK_CACHE_BUDGET MEGABYTE(256)
+#define D3D12_REGISTRY_ASSETS 4096
+#define D3D12_REGISTRY_NAMES KILOBYTE(256)
+
 u32 width = 1280;
 u32 height = 720;
 
+static OSInterface os;
+static AssetDatabase assetDatabase;
+static CookCacheDirectory cookDirectory;
+static CookCache cookCache;
+static AssetRegistry assetRegistry;
+static ModelStore modelStore;
+static TextureStore textureStore;
+static TextureStreamingManager textureStreaming;
+static TextureStreamingStore textureStreamingStore;
+static WorkQueue assetQueue;
+static WorkQueue bakeQueue;
+static StoredIBLEnvironment textureCubes[D3D12_MAX_TEXTURE_CUBES];
+static u32 totalTextureCubes;
+
+struct Win32FileWatcher {
+    HANDLE directory;
+    OVERLAPPED overlapped;
+    DWORD buffer[8192];
+};
+
+struct D3D12Backend {
+    ID3D12Device* device;
+    ID3D12CommandQueue* queues[RENDER_TOTAL_QUEUES];
+    IDXGISwapChain3* swapChain;
+    RenderResource backBuffers[RENDER_MAX_BACK_BUFFERS];
+    HANDLE fenceEvent;
+    HANDLE frameLatencyWaitable;
+    ID3D12QueryHeap* timestampHeap;
+    RenderResource timestampBuffer;
+    u64* timestamps;
+    u64 timestampFrequency;
+    u64 calibrationGpuTime;
+    u64 calibrationCpuTime;
+    u64 cpuFrequency;
+    //pipeline libraries are not documented as free threaded, every call on one takes this
+    volatile u32 pipelineLibraryLock;
+};
+
+struct D3D12CommandList {
+    ID3D12GraphicsCommandList* list;
+    ID3D12CommandAllocator* allocators[RENDER_MAX_FRAMES_IN_FLIGHT];
+};
+
+static D3D12Backend d3d12Backend;
+static D3D12CommandList d3d12CommandLists[D3D12_MAX_COMMAND_LISTS];
+static u32 d3d12TotalCommandLists;
+
+//the shaders are compiled by cookShader and handed to swapShader, pipeline is the handle of the newest source's
+//pipeline and fallback of the last one known to be ready
+//what cookShader writes and the cook cache keeps: the header, then the vertex and pixel shader bytecode back to back
+struct CookedShaderHeader {
+    u32 vertexShaderSize;
+    u32 pixelShaderSize;
+};
+
+struct ShaderAsset {
+    PipelineCache* cache;
+    RenderPipelineDesc desc;
+    u32 pipeline;
+    u32 fallback;
+    s8 error[1024];
+};
+
+static bool win32ReadFileIntoBoundedBuffer(const s8* fileName, void* data, u32 capacity, u32* fileLength) {
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    DWORD bytesRead = 0;
+    bool success = GetFileSizeEx(file, &size) && (u64)size.QuadPart <= capacity &&
+                   ReadFile(file, data, (DWORD)size.QuadPart, &bytesRead, 0) && bytesRead == size.QuadPart;
+    CloseHandle(file);
+    *fileLength = success ? bytesRead : 0;
+    return success;
+}
+
+static bool win32ReadFileIntoBuffer(const s8* fileName, void* data, u32* fileLength) {
+    return win32ReadFileIntoBoundedBuffer(fileName, data, MAX_U32, fileLength);
+}
+
+static bool win32WriteToFile(const s8* fileName, void* data, u32 dataSize) {
+    HANDLE file = CreateFileA(fileName, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    DWORD bytesWritten = 0;
+    bool success = WriteFile(file, data, dataSize, &bytesWritten, 0) && bytesWritten == dataSize;
+    CloseHandle(file);
+    return success;
+}
+
+static bool win32DeleteFile(const s8* fileName) {
+    return DeleteFileA(fileName) != 0;
+}
+
+//the handle is INVALID_HANDLE_VALUE when the file cannot be opened, reads and seeks on it fail
+static FileHandle win32GetFileHandleForReading(s8* fileName) {
+    FileHandle handle;
+    handle.handle = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    return handle;
+}
+
+static void win32SetFileHandlePointer(FileHandle* handle, u32 amount) {
+    SetFilePointer((HANDLE)handle->handle, (LONG)amount, 0, FILE_BEGIN);
+}
+
+static void win32ReadFromFileHandle(FileHandle* handle, u8* buffer, u32 amount) {
+    DWORD bytesRead = 0;
+    ReadFile((HANDLE)handle->handle, buffer, amount, &bytesRead, 0);
+}
+
+static void win32CloseFileHandle(FileHandle* handle) {
+    if (handle->handle != INVALID_HANDLE_VALUE) {
+        CloseHandle((HANDLE)handle->handle);
+        handle->handle = INVALID_HANDLE_VALUE;
+    }
+}
+
+static u64 win32GetSystemTime() {
+    static LARGE_INTEGER frequency;
+    if (!frequency.QuadPart) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (u64)(counter.QuadPart * 1000 / frequency.QuadPart);
+}
+
+static bool doNextWorkQueueEntry(WorkQueue* queue) {
+    u32 startPos = queue->entryStartPos;
+    if (startPos == queue->entryAddPos) {
+        return false;
+    }
+    u32 nextPos = (startPos + 1) % WorkQueue::MAX_ENTRIES;
+    if (InterlockedCompareExchange((LONG volatile*)&queue->entryStartPos, nextPos, startPos) == startPos) {
+        WorkEntry entry = queue->entries[startPos];
+        entry.function(entry.data);
+        InterlockedIncrement((LONG volatile*)&queue->entriesCompleted);
+    }
+    return true;
+}
+
+static DWORD WINAPI workQueueThreadProc(LPVOID parameter) {
+    WorkQueue* queue = (WorkQueue*)parameter;
+    for (;;) {
+        if (!doNextWorkQueueEntry(queue)) {
+            WaitForSingleObjectEx(queue->semaphore, INFINITE, false);
+        }
+    }
+}
+
+static void win32InitializeWorkQueue(WorkQueue* queue, u32 totalThreads) {
+    queue->entryAddPos = 0;
+    queue->entryStartPos = 0;
+    queue->entriesAdded = 0;
+    queue->entriesCompleted = 0;
+    queue->semaphore = CreateSemaphoreEx(0, 0, WorkQueue::MAX_ENTRIES, 0, 0, SEMAPHORE_ALL_ACCESS);
+    for (u32 i = 0; i < totalThreads; i++) {
+        CloseHandle(CreateThread(0, 0, workQueueThreadProc, queue, 0, 0));
+    }
+}
+
+//only the main thread adds entries, workers claim them through entryStartPos
+static void win32AddWorkQueueEntry(WorkQueue* queue, void (*function)(void*), void* data) {
+    u32 addPos = queue->entryAddPos;
+    queue->entries[addPos].function = function;
+    queue->entries[addPos].data = data;
+    queue->entriesAdded++;
+    _WriteBarrier();
+    queue->entryAddPos = (addPos + 1) % WorkQueue::MAX_ENTRIES;
+    ReleaseSemaphore(queue->semaphore, 1, 0);
+}
+
+static void win32CompleteWorkQueueEntries(WorkQueue* queue) {
+    while (queue->entriesCompleted != queue->entriesAdded) {
+        doNextWorkQueueEntry(queue);
+    }
+    queue->entriesAdded = 0;
+    queue->entriesCompleted = 0;
+}
+
+static Model3D win32CreateModel3D(f32* vData, u32 vDataSize, u16* iData, u32 iDataSize) {
+    return createStoredModel3D(&modelStore, vData, vDataSize, iData, iDataSize, MODEL3D_VERTEX_SIZE, sizeof(u16));
+}
+
+static Model3D win32CreateModel3D32(f32* vData, u32 vDataSize, u32* iData, u32 iDataSize) {
+    return createStoredModel3D(&modelStore, vData, vDataSize, iData, iDataSize, MODEL3D_VERTEX_SIZE, sizeof(u32));
+}
+
+static void win32DestroyModel3D(Model3D* model) {
+    destroyStoredModel3D(&modelStore, model);
+}
+
+static Texture2D win32CreateTexture2DMipmapped(void* data, u32 width, u32 height, u32 format, u32 mipLevels) {
+    Texture2D texture = {};
+    texture.data1 = createStoredTexture2D(&textureStore, data, width, height, format, mipLevels);
+    texture.data2 = &textureStore;
+    texture.format = format;
+    return texture;
+}
+
+static Texture2D win32CreateTexture2D(void* data, u32 width, u32 height, u32 format) {
+    return win32CreateTexture2DMipmapped(data, width, height, format, 1);
+}
+
+static void win32UpdateTexture2D(Texture2D* texture, void* data, u32 x, u32 y, u32 width, u32 height) {
+    if (texture->data1) {
+        updateStoredTexture2D((TextureStore*)texture->data2, (StoredTexture*)texture->data1, data, x, y, width, height);
+    }
+}
+
+//files with levels to stream are streamed
+static Texture2D win32CreateTexture2DFromFile(s8* fileName) {
+    return createStreamedTexture2DFromFile(&textureStreaming, &textureStreamingStore, &os, fileName,
+                                           &textureStore.scratch, 0, 0, D3D12_TEXTURE_COMPRESSION);
+}
+
+//Square RGBA8 faces are baked into an environment in the texture store, an unchanged sky loads its bake from the
+//working directory instead of filtering again
+static TextureCube win32CreateTextureCube(void* data, u32 width, u32 height, u32 format) {
+    TextureCube cube = {};
+    if (width != height || format != RENDER_FORMAT_R8G8B8A8_UNORM || totalTextureCubes == D3D12_MAX_TEXTURE_CUBES) {
+        return cube;
+    }
+    IBLBakeSettings settings = defaultIBLBakeSettings();
+    if (width < settings.outputSize) {
+        settings.outputSize = width;
+    }
+    if (settings.totalLevels > findMostSignificantBit(settings.outputSize) + 1) {
+        settings.totalLevels = findMostSignificantBit(settings.outputSize) + 1;
+    }
+    StoredIBLEnvironment* environment = &textureCubes[totalTextureCubes];
+    if (createStoredIBLEnvironment(environment, &textureStore, &os, (u8*)data, width, &settings,
+                                   D3D12_IBL_CACHE_DIRECTORY, &bakeQueue)) {
+        totalTextureCubes++;
+        cube.data1 = environment;
+        cube.data2 = &textureStore;
+        cube.format = format;
+    }
+    return cube;
+}
+
+//the bindless index of the specular chain
+static u32 win32BindTextureCube(TextureCube* cube) {
+    return ((StoredIBLEnvironment*)cube->data1)->specular->descriptor;
+}
+
+static void issueFileWatcherRead(Win32FileWatcher* watcher) {
+    ReadDirectoryChangesW(watcher->directory, watcher->buffer, sizeof(watcher->buffer), true,
+                          FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, 0, &watcher->overlapped, 0);
+}
+
+static void* win32CreateFileWatcher(const s8* directory) {
+    HANDLE handle = CreateFileA(directory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0,
+                                OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, 0);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    Win32FileWatcher* watcher = (Win32FileWatcher*)VirtualAlloc(0, sizeof(Win32FileWatcher), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    watcher->directory = handle;
+    watcher->overlapped.hEvent = CreateEvent(0, true, false, 0);
+    issueFileWatcherRead(watcher);
+    return watcher;
+}
+
+//a zero byte completion means the notification buffer overflowed and the changes were dropped
+static u32 win32ReadFileWatcherChanges(void* data, s8* names, u32 capacity) {
+    Win32FileWatcher* watcher = (Win32FileWatcher*)data;
+    DWORD bytes = 0;
+    if (!GetOverlappedResult(watcher->directory, &watcher->overlapped, &bytes, false)) {
+        return 0;
+    }
+    u32 used = 0;
+    u8* entry = (u8*)watcher->buffer;
+    while (bytes) {
+        FILE_NOTIFY_INFORMATION* info = (FILE_NOTIFY_INFORMATION*)entry;
+        if (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME) {
+            s32 length = WideCharToMultiByte(CP_UTF8, 0, info->FileName, info->FileNameLength / sizeof(WCHAR),
+                                             names + used, capacity - used - 1, 0, 0);
+            if (length > 0) {
+                used += length;
+                names[used++] = '\0';
+            }
+        }
+        if (!info->NextEntryOffset || capacity - used < MAX_PATH) {
+            break;
+        }
+        entry += info->NextEntryOffset;
+    }
+    ResetEvent(watcher->overlapped.hEvent);
+    issueFileWatcherRead(watcher);
+    return used;
+}
+
+static void recordShaderError(ShaderAsset* shader, ID3DBlob* error) {
+    u32 length = (u32)error->GetBufferSize();
+    if (length > sizeof(shader->error) - 1) {
+        length = sizeof(shader->error) - 1;
+    }
+    memcpy(shader->error, error->GetBufferPointer(), length);
+    shader->error[length] = '\0';
+    OutputDebugString(shader->error);
+    error->Release();
+}
+
+static u32 cookShader(void* userData, u8* source, u32 sourceSize, void* out, u32 outCapacity) {
+    ShaderAsset* shader = (ShaderAsset*)userData;
+    u32 d3d12CompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+    ID3DBlob* vertexShader = 0;
+    ID3DBlob* pixelShader = 0;
+    ID3DBlob* error = 0;
+    shader->error[0] = '\0';
+
+    //the vertex shader decodes the layout the model store keeps its vertices in
+    const s8* vertexMain = D3D12_QUANTIZE_MODELS ? "VSMainQuantized" : "VSMain";
+    D3DCompile(source, sourceSize, "shader.hlsl", 0, D3D_COMPILE_STANDARD_FILE_INCLUDE, vertexMain, "vs_5_0",
+               d3d12CompileFlags, 0, &vertexShader, &error);
+    if (error) {
+        recordShaderError(shader, error);
+        error = 0;
+    }
+    D3DCompile(source, sourceSize, "shader.hlsl", 0, D3D_COMPILE_STANDARD_FILE_INCLUDE, "PSMain", "ps_5_0",
+               d3d12CompileFlags, 0, &pixelShader, &error);
+    if (error) {
+        recordShaderError(shader, error);
+    }
+
+    u32 size = 0;
+    if (vertexShader && pixelShader) {
+        CookedShaderHeader header;
+        header.vertexShaderSize = (u32)vertexShader->GetBufferSize();
+        header.pixelShaderSize = (u32)pixelShader->GetBufferSize();
+        u64 totalSize = sizeof(header) + (u64)header.vertexShaderSize + header.pixelShaderSize;
+        if (totalSize <= outCapacity) {
+            u8* bytes = (u8*)out;
+            memcpy(bytes, &header, sizeof(header));
+            memcpy(bytes + sizeof(header), vertexShader->GetBufferPointer(), header.vertexShaderSize);
+            memcpy(bytes + sizeof(header) + header.vertexShaderSize, pixelShader->GetBufferPointer(),
+                   header.pixelShaderSize);
+            size = (u32)totalSize;
+        }
+    }
+    if (vertexShader) vertexShader->Release();
+    if (pixelShader) pixelShader->Release();
+    return size;
+}
+
+//The pipeline is compiled by the pipeline cache, the old one is drawn with until the new one is ready. Only the first
+//pipeline has nothing to fall back on and is waited for. The pipeline a reload supersedes is retired, the cache
+//destroys it once the frames in flight are done with it. The cache copies the bytecode, so it can point into the
+//cooked bytes.
+static void swapShader(void* userData, void* result) {
+    ShaderAsset* shader = (ShaderAsset*)userData;
+    CookedAsset* cooked = (CookedAsset*)result;
+    CookedShaderHeader header;
+    memcpy(&header, cooked->data, sizeof(header));
+    u8* bytecode = (u8*)cooked->data + sizeof(header);
+    shader->desc.vertexShader.code = bytecode;
+    shader->desc.vertexShader.size = header.vertexShaderSize;
+    shader->desc.pixelShader.code = bytecode + header.vertexShaderSize;
+    shader->desc.pixelShader.size = header.pixelShaderSize;
+    bool first = shader->pipeline == PIPELINE_CACHE_NONE;
+    u32 pipeline = requestPipeline(shader->cache, &shader->desc, first);
+    if (pipeline == PIPELINE_CACHE_NONE) {
+        OutputDebugString("shader reload dropped, the pipeline cache is full\n");
+        return;
+    }
+    if (pipeline == shader->pipeline) {
+        return;
+    }
+    //the old fallback gives way to a ready pipeline, a pipeline still compiling is just replaced
+    u32 superseded = shader->fallback;
+    if (isPipelineReady(shader->cache, shader->pipeline)) {
+        shader->fallback = shader->pipeline;
+    } else {
+        superseded = shader->pipeline;
+    }
+    if (superseded != pipeline) {
+        retirePipeline(shader->cache, superseded);
+    }
+    if (shader->fallback == pipeline) {
+        shader->fallback = PIPELINE_CACHE_NONE;
+    }
+    shader->pipeline = pipeline;
+}
+
 static void getD3D12HardwareAdapter(IDXGIFactory1* pFactory, IDXGIAdapter1** ppAdapter) {
     *ppAdapter = 0;
     IDXGIAdapter1* adapter;
@@ -48,11 +477,777 @@ static void getD3D12HardwareAdapter(IDXGIFactory1* pFactory, IDXGIAdapter1** ppA
     *ppAdapter = adapter;
 }
 
+static const D3D12_RESOURCE_STATES d3d12ResourceStates[RENDER_TOTAL_STATES] = {
+    D3D12_RESOURCE_STATE_COMMON,
+    D3D12_RESOURCE_STATE_PRESENT,
+    D3D12_RESOURCE_STATE_RENDER_TARGET,
+    D3D12_RESOURCE_STATE_GENERIC_READ,
+    D3D12_RESOURCE_STATE_COPY_SOURCE,
+    D3D12_RESOURCE_STATE_COPY_DEST,
+    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+};
+
+static const D3D12_HEAP_TYPE d3d12HeapTypes[] = {
+    D3D12_HEAP_TYPE_DEFAULT,
+    D3D12_HEAP_TYPE_UPLOAD,
+    D3D12_HEAP_TYPE_READBACK,
+};
+
+static const D3D12_COMMAND_LIST_TYPE d3d12CommandListTypes[RENDER_TOTAL_QUEUES] = {
+    D3D12_COMMAND_LIST_TYPE_DIRECT,
+    D3D12_COMMAND_LIST_TYPE_COPY,
+};
+
+static const D3D12_DESCRIPTOR_HEAP_TYPE d3d12DescriptorHeapTypes[RENDER_TOTAL_DESCRIPTOR_TYPES] = {
+    D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+    D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,
+    D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
+};
+
+static const D3D12_FILTER d3d12Filters[] = {
+    D3D12_FILTER_MIN_MAG_MIP_POINT,
+    D3D12_FILTER_MIN_MAG_MIP_LINEAR,
+};
+
+static const D3D12_TEXTURE_ADDRESS_MODE d3d12AddressModes[] = {
+    D3D12_TEXTURE_ADDRESS_MODE_WRAP,
+    D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+};
+
+static bool d3d12CreateBuffer(RenderBackend* backend, u64 size, u32 heap, u32 initialState, RenderResource* buffer) {
+    D3D12_HEAP_PROPERTIES bufHeapProp = {};
+    bufHeapProp.Type = d3d12HeapTypes[heap];
+    bufHeapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    bufHeapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+    bufHeapProp.CreationNodeMask = 1;
+    bufHeapProp.VisibleNodeMask = 1;
+
+    D3D12_RESOURCE_DESC bufResDesc = {};
+    bufResDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    bufResDesc.Alignment = 0;
+    bufResDesc.Width = size;
+    bufResDesc.Height = 1;
+    bufResDesc.DepthOrArraySize = 1;
+    bufResDesc.MipLevels = 1;
+    bufResDesc.Format = DXGI_FORMAT_UNKNOWN;
+    bufResDesc.SampleDesc.Count = 1;
+    bufResDesc.SampleDesc.Quality = 0;
+    bufResDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    bufResDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+    ID3D12Resource* resource = 0;
+    if (FAILED(d3d12Backend.device->CreateCommittedResource(&bufHeapProp, D3D12_HEAP_FLAG_NONE, &bufResDesc,
+                                                            d3d12ResourceStates[initialState], 0, IID_PPV_ARGS(&resource)))) {
+        return false;
+    }
+    buffer->handle = resource;
+    buffer->gpuAddress = resource->GetGPUVirtualAddress();
+    buffer->descriptor = 0;
+    buffer->size = size;
+    buffer->heap = heap;
+    return true;
+}
+
+//heaps only hold buffers, so every buffer can alias every other one
+static bool d3d12CreateMemoryHeap(RenderBackend* backend, u64 size, RenderMemoryHeap* heap) {
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.SizeInBytes = size;
+    heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+    heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+    heapDesc.Properties.CreationNodeMask = 1;
+    heapDesc.Properties.VisibleNodeMask = 1;
+    heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    ID3D12Heap* memoryHeap = 0;
+    if (FAILED(d3d12Backend.device->CreateHeap(&heapDesc, IID_PPV_ARGS(&memoryHeap)))) {
+        return false;
+    }
+    heap->handle = memoryHeap;
+    heap->size = size;
+    return true;
+}
+
+static bool d3d12CreatePlacedBuffer(RenderBackend* backend, RenderMemoryHeap* heap, u64 offset, u64 size, u32 initialState,
+                                    RenderResource* buffer) {
+    D3D12_RESOURCE_DESC bufResDesc = {};
+    bufResDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    bufResDesc.Alignment = 0;
+    bufResDesc.Width = size;
+    bufResDesc.Height = 1;
+    bufResDesc.DepthOrArraySize = 1;
+    bufResDesc.MipLevels = 1;
+    bufResDesc.Format = DXGI_FORMAT_UNKNOWN;
+    bufResDesc.SampleDesc.Count = 1;
+    bufResDesc.SampleDesc.Quality = 0;
+    bufResDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    bufResDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+    ID3D12Resource* resource = 0;
+    if (FAILED(d3d12Backend.device->CreatePlacedResource((ID3D12Heap*)heap->handle, offset, &bufResDesc,
+                                                         d3d12ResourceStates[initialState], 0, IID_PPV_ARGS(&resource)))) {
+        return false;
+    }
+    buffer->handle = resource;
+    buffer->gpuAddress = resource->GetGPUVirtualAddress();
+    buffer->descriptor = 0;
+    buffer->size = size;
+    buffer->heap = RENDER_HEAP_DEFAULT;
+    return true;
+}
+
+static void d3d12DestroyMemoryHeap(RenderBackend* backend, RenderMemoryHeap* heap) {
+    if (heap->handle) {
+        ((ID3D12Heap*)heap->handle)->Release();
+    }
+    heap->handle = 0;
+}
+
+static const DXGI_FORMAT d3d12Formats[RENDER_TOTAL_FORMATS] = {
+    DXGI_FORMAT_UNKNOWN,
+    DXGI_FORMAT_R8G8B8A8_UNORM,
+    DXGI_FORMAT_R16G16B16A16_FLOAT,
+    DXGI_FORMAT_R32G32_FLOAT,
+    DXGI_FORMAT_R32G32B32_FLOAT,
+    DXGI_FORMAT_D32_FLOAT,
+    DXGI_FORMAT_R16G16B16A16_UNORM,
+    DXGI_FORMAT_R16G16_SNORM,
+    DXGI_FORMAT_R16G16_FLOAT,
+    DXGI_FORMAT_R8G8B8A8_SNORM,
+    DXGI_FORMAT_R8_UNORM,
+    DXGI_FORMAT_R8G8_UNORM,
+    DXGI_FORMAT_R32_FLOAT,
+    DXGI_FORMAT_BC1_UNORM,
+    DXGI_FORMAT_BC4_UNORM,
+    DXGI_FORMAT_BC4_SNORM,
+    DXGI_FORMAT_BC5_UNORM,
+};
+
+static bool d3d12CreateTexture2D(RenderBackend* backend, u32 width, u32 height, u32 format, u32 mipLevels,
+                                 u32 initialState, RenderResource* texture) {
+    D3D12_HEAP_PROPERTIES texHeapProp = {};
+    texHeapProp.Type = D3D12_HEAP_TYPE_DEFAULT;
+    texHeapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+    texHeapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+    texHeapProp.CreationNodeMask = 1;
+    texHeapProp.VisibleNodeMask = 1;
+
+    D3D12_RESOURCE_DESC texResDesc = {};
+    texResDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    texResDesc.Alignment = 0;
+    texResDesc.Width = width;
+    texResDesc.Height = height;
+    texResDesc.DepthOrArraySize = 1;
+    texResDesc.MipLevels = (UINT16)mipLevels;
+    texResDesc.Format = d3d12Formats[format];
+    texResDesc.SampleDesc.Count = 1;
+    texResDesc.SampleDesc.Quality = 0;
+    texResDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    texResDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+    ID3D12Resource* resource = 0;
+    if (FAILED(d3d12Backend.device->CreateCommittedResource(&texHeapProp, D3D12_HEAP_FLAG_NONE, &texResDesc,
+                                                            d3d12ResourceStates[initialState], 0, IID_PPV_ARGS(&resource)))) {
+        return false;
+    }
+    texture->handle = resource;
+    texture->gpuAddress = 0;
+    texture->descriptor = 0;
+    texture->size = getRenderTextureSize(format, width, height, mipLevels);
+    texture->heap = RENDER_HEAP_DEFAULT;
+    return true;
+}
+
+static const D3D12_CULL_MODE d3d12CullModes[] = {
+    D3D12_CULL_MODE_NONE,
+    D3D12_CULL_MODE_FRONT,
+    D3D12_CULL_MODE_BACK,
+};
+
+static const D3D12_COMPARISON_FUNC d3d12CompareFuncs[] = {
+    D3D12_COMPARISON_FUNC_LESS,
+    D3D12_COMPARISON_FUNC_LESS_EQUAL,
+    D3D12_COMPARISON_FUNC_GREATER,
+    D3D12_COMPARISON_FUNC_ALWAYS,
+};
+
+//loading a pipeline from a library needs the exact desc it was stored with, so both build it here
+static void fillD3D12PipelineDesc(RenderPipelineDesc* desc, D3D12_INPUT_ELEMENT_DESC* inputElementDescs,
+                                  D3D12_GRAPHICS_PIPELINE_STATE_DESC* psoDesc) {
+    *psoDesc = {};
+    for (u32 i = 0; i < desc->totalAttributes; i++) {
+        RenderVertexAttribute* attribute = &desc->attributes[i];
+        inputElementDescs[i] = {attribute->semantic, attribute->semanticIndex, d3d12Formats[attribute->format], 0,
+                                attribute->offset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0};
+    }
+    psoDesc->InputLayout = {inputElementDescs, desc->totalAttributes};
+    psoDesc->pRootSignature = (ID3D12RootSignature*)desc->rootSignature;
+    psoDesc->VS.pShaderBytecode = desc->vertexShader.code;
+    psoDesc->VS.BytecodeLength = desc->vertexShader.size;
+    psoDesc->PS.pShaderBytecode = desc->pixelShader.code;
+    psoDesc->PS.BytecodeLength = desc->pixelShader.size;
+    psoDesc->RasterizerState.FillMode = desc->wireframe ? D3D12_FILL_MODE_WIREFRAME : D3D12_FILL_MODE_SOLID;
+    psoDesc->RasterizerState.CullMode = d3d12CullModes[desc->cullMode];
+    psoDesc->RasterizerState.FrontCounterClockwise = desc->frontCounterClockwise;
+    psoDesc->RasterizerState.DepthBias = D3D12_DEFAULT_DEPTH_BIAS;
+    psoDesc->RasterizerState.DepthBiasClamp = D3D12_DEFAULT_DEPTH_BIAS_CLAMP;
+    psoDesc->RasterizerState.SlopeScaledDepthBias = D3D12_DEFAULT_SLOPE_SCALED_DEPTH_BIAS;
+    psoDesc->RasterizerState.DepthClipEnable = true;
+    psoDesc->RasterizerState.MultisampleEnable = false;
+    psoDesc->RasterizerState.AntialiasedLineEnable = false;
+    psoDesc->RasterizerState.ForcedSampleCount = 0;
+    psoDesc->RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
+    D3D12_RENDER_TARGET_BLEND_DESC renderTargetBlendDesc = {
+        desc->blendMode != RENDER_BLEND_NONE,
+        false,
+        desc->blendMode == RENDER_BLEND_ADDITIVE ? D3D12_BLEND_ONE : D3D12_BLEND_SRC_ALPHA,
+        desc->blendMode == RENDER_BLEND_ADDITIVE ? D3D12_BLEND_ONE : D3D12_BLEND_INV_SRC_ALPHA,
+        D3D12_BLEND_OP_ADD,
+        D3D12_BLEND_ONE,
+        D3D12_BLEND_ZERO,
+        D3D12_BLEND_OP_ADD,
+        D3D12_LOGIC_OP_NOOP,
+        D3D12_COLOR_WRITE_ENABLE_ALL,
+    };
+    for (UINT i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) {
+        psoDesc->BlendState.RenderTarget[i] = renderTargetBlendDesc;
+    }
+    psoDesc->DepthStencilState.DepthEnable = desc->depthTest;
+    psoDesc->DepthStencilState.DepthWriteMask = desc->depthTest && !desc->depthWrite ? D3D12_DEPTH_WRITE_MASK_ZERO :
+                                                D3D12_DEPTH_WRITE_MASK_ALL;
+    psoDesc->DepthStencilState.DepthFunc = desc->depthTest ? d3d12CompareFuncs[desc->depthCompare] :
+                                           D3D12_COMPARISON_FUNC_LESS_EQUAL;
+    psoDesc->DepthStencilState.StencilEnable = false;
+    psoDesc->DSVFormat = d3d12Formats[desc->depthFormat];
+    psoDesc->SampleMask = UINT_MAX;
+    psoDesc->PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    psoDesc->NumRenderTargets = desc->totalRenderTargets;
+    for (u32 i = 0; i < desc->totalRenderTargets; i++) {
+        psoDesc->RTVFormats[i] = d3d12Formats[desc->renderTargetFormats[i]];
+    }
+    psoDesc->SampleDesc.Count = desc->sampleCount ? desc->sampleCount : 1;
+}
+
+static bool d3d12CreatePipeline(RenderBackend* backend, RenderPipelineDesc* desc, RenderPipeline* pipeline) {
+    D3D12_INPUT_ELEMENT_DESC inputElementDescs[RENDER_MAX_VERTEX_ATTRIBUTES];
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc;
+    fillD3D12PipelineDesc(desc, inputElementDescs, &psoDesc);
+    ID3D12PipelineState* pipelineState = 0;
+    if (FAILED(d3d12Backend.device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState)))) {
+        return false;
+    }
+    pipeline->handle = pipelineState;
+    pipeline->rootSignature = desc->rootSignature;
+    return true;
+}
+
+static void d3d12DestroyPipeline(RenderBackend* backend, RenderPipeline* pipeline) {
+    if (pipeline->handle) {
+        ((ID3D12PipelineState*)pipeline->handle)->Release();
+    }
+    pipeline->handle = 0;
+}
+
+//needs ID3D12Device1, and fails for data written by another driver or adapter
+static bool d3d12CreatePipelineLibrary(RenderBackend* backend, void* data, u64 size, RenderPipelineLibrary* library) {
+    ID3D12Device1* device1 = 0;
+    if (FAILED(d3d12Backend.device->QueryInterface(IID_PPV_ARGS(&device1)))) {
+        return false;
+    }
+    ID3D12PipelineLibrary* pipelineLibrary = 0;
+    HRESULT result = device1->CreatePipelineLibrary(data, (SIZE_T)size, IID_PPV_ARGS(&pipelineLibrary));
+    device1->Release();
+    if (FAILED(result)) {
+        return false;
+    }
+    library->handle = pipelineLibrary;
+    return true;
+}
+
+static u64 d3d12SerializePipelineLibrary(RenderBackend* backend, RenderPipelineLibrary* library, void* data,
+                                         u64 capacity) {
+    ID3D12PipelineLibrary* pipelineLibrary = (ID3D12PipelineLibrary*)library->handle;
+    beginSpinLock(&d3d12Backend.pipelineLibraryLock);
+    u64 size = pipelineLibrary->GetSerializedSize();
+    if (data && (capacity < size || FAILED(pipelineLibrary->Serialize(data, (SIZE_T)size)))) {
+        size = 0;
+    }
+    endSpinLock(&d3d12Backend.pipelineLibraryLock);
+    return size;
+}
+
+static void d3d12DestroyPipelineLibrary(RenderBackend* backend, RenderPipelineLibrary* library) {
+    if (library->handle) {
+        ((ID3D12PipelineLibrary*)library->handle)->Release();
+    }
+    library->handle = 0;
+}
+
+//pipelines are stored under their key in hex
+static void getD3D12PipelineName(u64 key, WCHAR* name) {
+    for (s32 i = 15; i >= 0; i--) {
+        name[15 - i] = L"0123456789abcdef"[(key >> (i * 4)) & 15];
+    }
+    name[16] = L'\0';
+}
+
+static bool d3d12LoadPipeline(RenderBackend* backend, RenderPipelineLibrary* library, u64 key, RenderPipelineDesc* desc,
+                              RenderPipeline* pipeline) {
+    D3D12_INPUT_ELEMENT_DESC inputElementDescs[RENDER_MAX_VERTEX_ATTRIBUTES];
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc;
+    fillD3D12PipelineDesc(desc, inputElementDescs, &psoDesc);
+    WCHAR name[17];
+    getD3D12PipelineName(key, name);
+    ID3D12PipelineState* pipelineState = 0;
+    beginSpinLock(&d3d12Backend.pipelineLibraryLock);
+    HRESULT result = ((ID3D12PipelineLibrary*)library->handle)->LoadGraphicsPipeline(name, &psoDesc,
+                                                                                      IID_PPV_ARGS(&pipelineState));
+    endSpinLock(&d3d12Backend.pipelineLibraryLock);
+    if (FAILED(result)) {
+        return false;
+    }
+    pipeline->handle = pipelineState;
+    pipeline->rootSignature = desc->rootSignature;
+    return true;
+}
+
+static bool d3d12StorePipeline(RenderBackend* backend, RenderPipelineLibrary* library, u64 key,
+                               RenderPipeline* pipeline) {
+    WCHAR name[17];
+    getD3D12PipelineName(key, name);
+    beginSpinLock(&d3d12Backend.pipelineLibraryLock);
+    HRESULT result = ((ID3D12PipelineLibrary*)library->handle)->StorePipeline(name,
+                                                                              (ID3D12PipelineState*)pipeline->handle);
+    endSpinLock(&d3d12Backend.pipelineLibraryLock);
+    return SUCCEEDED(result);
+}
+
+static void d3d12DestroyResource(RenderBackend* backend, RenderResource* resource) {
+    if (resource->handle) {
+        ((ID3D12Resource*)resource->handle)->Release();
+    }
+    resource->handle = 0;
+}
+
+static void* d3d12MapResource(RenderBackend* backend, RenderResource* resource) {
+    void* data = 0;
+    if (FAILED(((ID3D12Resource*)resource->handle)->Map(0, 0, &data))) {
+        return 0;
+    }
+    return data;
+}
+
+static void d3d12UnmapResource(RenderBackend* backend, RenderResource* resource) {
+    ((ID3D12Resource*)resource->handle)->Unmap(0, 0);
+}
+
+static bool d3d12CreateFence(RenderBackend* backend, u64 initialValue, RenderFence* fence) {
+    ID3D12Fence* fenceObject = 0;
+    if (FAILED(d3d12Backend.device->CreateFence(initialValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fenceObject)))) {
+        return false;
+    }
+    fence->handle = fenceObject;
+    return true;
+}
+
+//lists are closed after creation, the first resetCommandList opens them
+static bool d3d12CreateCommandList(RenderBackend* backend, u32 queue, RenderCommandList* list) {
+    if (d3d12TotalCommandLists == D3D12_MAX_COMMAND_LISTS) {
+        return false;
+    }
+    D3D12CommandList* commandList = &d3d12CommandLists[d3d12TotalCommandLists];
+    D3D12_COMMAND_LIST_TYPE type = d3d12CommandListTypes[queue];
+    for (u32 i = 0; i < RENDER_MAX_FRAMES_IN_FLIGHT; i++) {
+        if (FAILED(d3d12Backend.device->CreateCommandAllocator(type, IID_PPV_ARGS(&commandList->allocators[i])))) {
+            return false;
+        }
+    }
+    if (FAILED(d3d12Backend.device->CreateCommandList(0, type, commandList->allocators[0], 0, IID_PPV_ARGS(&commandList->list)))) {
+        return false;
+    }
+    WinAssert(commandList->list->Close());
+    d3d12TotalCommandLists++;
+    list->handle = commandList;
+    list->backend = backend;
+    list->queue = queue;
+    return true;
+}
+
+static RenderResource* d3d12GetBackBuffer(RenderBackend* backend, u32 index) {
+    return &d3d12Backend.backBuffers[index];
+}
+
+static u32 d3d12GetCurrentBackBufferIndex(RenderBackend* backend) {
+    return d3d12Backend.swapChain->GetCurrentBackBufferIndex();
+}
+
+//resource and sampler heaps are shader visible, render target heaps never can be
+static bool d3d12CreateDescriptorHeap(RenderBackend* backend, u32 type, u32 capacity, RenderDescriptorHeap* heap) {
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+    heapDesc.NumDescriptors = capacity;
+    heapDesc.Type = d3d12DescriptorHeapTypes[type];
+    heapDesc.Flags = type == RENDER_DESCRIPTORS_RENDER_TARGET ? D3D12_DESCRIPTOR_HEAP_FLAG_NONE :
+                                                                D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    ID3D12DescriptorHeap* descriptorHeap = 0;
+    if (FAILED(d3d12Backend.device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
+        return false;
+    }
+    heap->handle = descriptorHeap;
+    heap->cpuStart = descriptorHeap->GetCPUDescriptorHandleForHeapStart().ptr;
+    heap->gpuStart = type == RENDER_DESCRIPTORS_RENDER_TARGET ? 0 : descriptorHeap->GetGPUDescriptorHandleForHeapStart().ptr;
+    heap->increment = d3d12Backend.device->GetDescriptorHandleIncrementSize(heapDesc.Type);
+    heap->capacity = capacity;
+    heap->type = type;
+    return true;
+}
+
+static D3D12_CPU_DESCRIPTOR_HANDLE getD3D12DescriptorHandle(RenderDescriptorHeap* heap, u32 index) {
+    D3D12_CPU_DESCRIPTOR_HANDLE handle;
+    handle.ptr = (SIZE_T)(heap->cpuStart + (u64)index * heap->increment);
+    return handle;
+}
+
+static void d3d12CreateConstantBufferView(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index, u64 gpuAddress,
+                                          u32 size) {
+    D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+    cbvDesc.BufferLocation = gpuAddress;
+    cbvDesc.SizeInBytes = size;
+    d3d12Backend.device->CreateConstantBufferView(&cbvDesc, getD3D12DescriptorHandle(heap, index));
+}
+
+static void d3d12CreateBufferShaderView(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index,
+                                        RenderResource* buffer, u64 firstElement, u32 totalElements, u32 stride) {
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Buffer.FirstElement = firstElement;
+    srvDesc.Buffer.NumElements = totalElements;
+    srvDesc.Buffer.StructureByteStride = stride;
+    srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+    d3d12Backend.device->CreateShaderResourceView((ID3D12Resource*)buffer->handle, &srvDesc,
+                                                  getD3D12DescriptorHandle(heap, index));
+}
+
+static void d3d12CreateTextureShaderView(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index,
+                                         RenderResource* texture, u32 mostDetailedMip) {
+    ID3D12Resource* resource = (ID3D12Resource*)texture->handle;
+    D3D12_RESOURCE_DESC resourceDesc = resource->GetDesc();
+    D3D12_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+    viewDesc.Format = resourceDesc.Format;
+    viewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    viewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    viewDesc.Texture2D.MostDetailedMip = mostDetailedMip;
+    viewDesc.Texture2D.MipLevels = resourceDesc.MipLevels - mostDetailedMip;
+    d3d12Backend.device->CreateShaderResourceView(resource, &viewDesc, getD3D12DescriptorHandle(heap, index));
+}
+
+static void d3d12CreateRenderTargetView(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index,
+                                        RenderResource* target) {
+    d3d12Backend.device->CreateRenderTargetView((ID3D12Resource*)target->handle, 0, getD3D12DescriptorHandle(heap, index));
+}
+
+static void d3d12CreateSampler(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index, u32 filter, u32 addressMode) {
+    D3D12_SAMPLER_DESC samplerDesc = {};
+    samplerDesc.Filter = d3d12Filters[filter];
+    samplerDesc.AddressU = d3d12AddressModes[addressMode];
+    samplerDesc.AddressV = d3d12AddressModes[addressMode];
+    samplerDesc.AddressW = d3d12AddressModes[addressMode];
+    samplerDesc.MaxAnisotropy = 1;
+    samplerDesc.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+    samplerDesc.MaxLOD = D3D12_FLOAT32_MAX;
+    d3d12Backend.device->CreateSampler(&samplerDesc, getD3D12DescriptorHandle(heap, index));
+}
+
+//all lists have to be for the same queue
+static void d3d12ExecuteCommandLists(RenderBackend* backend, RenderCommandList** lists, u32 totalLists) {
+    ID3D12CommandList* ppCommandLists[D3D12_MAX_COMMAND_LISTS];
+    for (u32 i = 0; i < totalLists; i++) {
+        ppCommandLists[i] = ((D3D12CommandList*)lists[i]->handle)->list;
+    }
+    d3d12Backend.queues[lists[0]->queue]->ExecuteCommandLists(totalLists, ppCommandLists);
+}
+
+static void d3d12SignalFence(RenderBackend* backend, u32 queue, RenderFence* fence, u64 value) {
+    WinAssert(d3d12Backend.queues[queue]->Signal((ID3D12Fence*)fence->handle, value));
+}
+
+static u64 d3d12GetCompletedFenceValue(RenderBackend* backend, RenderFence* fence) {
+    return ((ID3D12Fence*)fence->handle)->GetCompletedValue();
+}
+
+static void d3d12WaitForFence(RenderBackend* backend, RenderFence* fence, u64 value) {
+    WinAssert(((ID3D12Fence*)fence->handle)->SetEventOnCompletion(value, d3d12Backend.fenceEvent));
+    WaitForSingleObjectEx(d3d12Backend.fenceEvent, INFINITE, FALSE);
+}
+
+static void d3d12WaitForFenceOnQueue(RenderBackend* backend, u32 queue, RenderFence* fence, u64 value) {
+    WinAssert(d3d12Backend.queues[queue]->Wait((ID3D12Fence*)fence->handle, value));
+}
+
+static bool d3d12Present(RenderBackend* backend, u32 syncInterval) {
+    WinAssert(d3d12Backend.swapChain->Present(syncInterval, 0));
+    return true;
+}
+
+static void d3d12SetMaximumFrameLatency(RenderBackend* backend, u32 maxLatency) {
+    WinAssert(d3d12Backend.swapChain->SetMaximumFrameLatency(maxLatency));
+}
+
+static void d3d12WaitForPresent(RenderBackend* backend) {
+    WaitForSingleObjectEx(d3d12Backend.frameLatencyWaitable, 1000, TRUE);
+}
+
+static u64 d3d12GetMicroseconds(RenderBackend* backend) {
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (u64)((f64)counter.QuadPart * 1000000.0 / (f64)d3d12Backend.cpuFrequency);
+}
+
+//Sleep only has millisecond granularity, the last millisecond is spun
+static void d3d12SleepMicroseconds(RenderBackend* backend, u64 microseconds) {
+    u64 end = d3d12GetMicroseconds(backend) + microseconds;
+    if (microseconds > 2000) {
+        Sleep((DWORD)(microseconds / 1000 - 1));
+    }
+    while (d3d12GetMicroseconds(backend) < end) {
+        YieldProcessor();
+    }
+}
+
+//gpu ticks are moved onto the cpu clock through the calibration taken at startup
+static u64 d3d12ReadTimestamp(RenderBackend* backend, u32 index) {
+    f64 gpuTime = (f64)d3d12Backend.timestamps[index] - (f64)d3d12Backend.calibrationGpuTime;
+    f64 cpuTime = (f64)d3d12Backend.calibrationCpuTime / (f64)d3d12Backend.cpuFrequency;
+    return (u64)((cpuTime + gpuTime / (f64)d3d12Backend.timestampFrequency) * 1000000.0);
+}
+
+static void d3d12ResetCommandList(RenderCommandList* list, u32 allocatorIndex, RenderPipeline* pipeline) {
+    D3D12CommandList* commandList = (D3D12CommandList*)list->handle;
+    WinAssert(commandList->allocators[allocatorIndex]->Reset());
+    WinAssert(commandList->list->Reset(commandList->allocators[allocatorIndex],
+                                       pipeline ? (ID3D12PipelineState*)pipeline->handle : 0));
+}
+
+static void d3d12WriteTimestamp(RenderCommandList* list, u32 index) {
+    ID3D12GraphicsCommandList* commandList = ((D3D12CommandList*)list->handle)->list;
+    commandList->EndQuery(d3d12Backend.timestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, index);
+    commandList->ResolveQueryData(d3d12Backend.timestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, index, 1,
+                                  (ID3D12Resource*)d3d12Backend.timestampBuffer.handle, index * sizeof(u64));
+}
+
+static void d3d12CloseCommandList(RenderCommandList* list) {
+    WinAssert(((D3D12CommandList*)list->handle)->list->Close());
+}
+
+static void d3d12TransitionResource(RenderCommandList* list, RenderResource* resource, u32 before, u32 after) {
+    D3D12_RESOURCE_BARRIER resBarrier = {};
+    resBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    resBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    resBarrier.Transition.pResource = (ID3D12Resource*)resource->handle;
+    resBarrier.Transition.StateBefore = d3d12ResourceStates[before];
+    resBarrier.Transition.StateAfter = d3d12ResourceStates[after];
+    resBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    ((D3D12CommandList*)list->handle)->list->ResourceBarrier(1, &resBarrier);
+}
+
+static const D3D12_RESOURCE_BARRIER_FLAGS d3d12SplitFlags[] = {
+    D3D12_RESOURCE_BARRIER_FLAG_NONE,
+    D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY,
+    D3D12_RESOURCE_BARRIER_FLAG_END_ONLY,
+};
+
+//one ResourceBarrier call per D3D12_MAX_BATCHED_BARRIERS barriers
+static void d3d12InsertBarriers(RenderCommandList* list, RenderBarrier* barriers, u32 totalBarriers) {
+    D3D12_RESOURCE_BARRIER resBarriers[D3D12_MAX_BATCHED_BARRIERS];
+    u32 totalResBarriers = 0;
+    for (u32 i = 0; i < totalBarriers; i++) {
+        RenderBarrier* barrier = &barriers[i];
+        D3D12_RESOURCE_BARRIER* resBarrier = &resBarriers[totalResBarriers++];
+        *resBarrier = {};
+        if (barrier->type == RENDER_BARRIER_ALIASING) {
+            //no resource before, whatever used the memory last gives it up
+            resBarrier->Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+            resBarrier->Aliasing.pResourceAfter = (ID3D12Resource*)barrier->resource->handle;
+        } else {
+            resBarrier->Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            resBarrier->Flags = d3d12SplitFlags[barrier->split];
+            resBarrier->Transition.pResource = (ID3D12Resource*)barrier->resource->handle;
+            resBarrier->Transition.StateBefore = d3d12ResourceStates[barrier->before];
+            resBarrier->Transition.StateAfter = d3d12ResourceStates[barrier->after];
+            resBarrier->Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+        }
+        if (totalResBarriers == D3D12_MAX_BATCHED_BARRIERS || i + 1 == totalBarriers) {
+            ((D3D12CommandList*)list->handle)->list->ResourceBarrier(totalResBarriers, resBarriers);
+            totalResBarriers = 0;
+        }
+    }
+}
+
+static void d3d12SetDescriptorHeaps(RenderCommandList* list, RenderDescriptorHeap* resources, RenderDescriptorHeap* samplers) {
+    ID3D12DescriptorHeap* heaps[2];
+    u32 totalHeaps = 0;
+    if (resources) {
+        heaps[totalHeaps++] = (ID3D12DescriptorHeap*)resources->handle;
+    }
+    if (samplers) {
+        heaps[totalHeaps++] = (ID3D12DescriptorHeap*)samplers->handle;
+    }
+    ((D3D12CommandList*)list->handle)->list->SetDescriptorHeaps(totalHeaps, heaps);
+}
+
+//the scissor always covers the viewport
+static void d3d12SetViewport(RenderCommandList* list, f32 x, f32 y, f32 width, f32 height) {
+    D3D12_VIEWPORT d3d12Viewport = {};
+    D3D12_RECT d3d12ScissorRect = {};
+    d3d12Viewport.TopLeftX = x;
+    d3d12Viewport.TopLeftY = y;
+    d3d12Viewport.Width = width;
+    d3d12Viewport.Height = height;
+    d3d12Viewport.MinDepth = 0;
+    d3d12Viewport.MaxDepth = 1;
+    d3d12ScissorRect.left = (LONG)x;
+    d3d12ScissorRect.top = (LONG)y;
+    d3d12ScissorRect.right = (LONG)(x + width);
+    d3d12ScissorRect.bottom = (LONG)(y + height);
+    ID3D12GraphicsCommandList* commandList = ((D3D12CommandList*)list->handle)->list;
+    commandList->RSSetViewports(1, &d3d12Viewport);
+    commandList->RSSetScissorRects(1, &d3d12ScissorRect);
+}
+
+static void d3d12SetRenderTarget(RenderCommandList* list, RenderResource* target) {
+    D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle;
+    rtvHandle.ptr = (SIZE_T)target->descriptor;
+    ((D3D12CommandList*)list->handle)->list->OMSetRenderTargets(1, &rtvHandle, false, 0);
+}
+
+static void d3d12ClearRenderTarget(RenderCommandList* list, RenderResource* target, Vector4 color) {
+    D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle;
+    rtvHandle.ptr = (SIZE_T)target->descriptor;
+    ((D3D12CommandList*)list->handle)->list->ClearRenderTargetView(rtvHandle, color.va, 0, 0);
+}
+
+static void d3d12SetPipeline(RenderCommandList* list, RenderPipeline* pipeline) {
+    ID3D12GraphicsCommandList* commandList = ((D3D12CommandList*)list->handle)->list;
+    commandList->SetPipelineState((ID3D12PipelineState*)pipeline->handle);
+    commandList->SetGraphicsRootSignature((ID3D12RootSignature*)pipeline->rootSignature);
+    commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+static void d3d12SetVertexBuffer(RenderCommandList* list, RenderResource* buffer, u32 stride) {
+    D3D12_VERTEX_BUFFER_VIEW d3d12VertexBufferView = {};
+    d3d12VertexBufferView.BufferLocation = buffer->gpuAddress;
+    d3d12VertexBufferView.StrideInBytes = stride;
+    d3d12VertexBufferView.SizeInBytes = (UINT)buffer->size;
+    ((D3D12CommandList*)list->handle)->list->IASetVertexBuffers(0, 1, &d3d12VertexBufferView);
+}
+
+static void d3d12SetIndexBuffer(RenderCommandList* list, RenderResource* buffer, u32 indexFormat) {
+    D3D12_INDEX_BUFFER_VIEW d3d12IndexBufferView = {};
+    d3d12IndexBufferView.BufferLocation = buffer->gpuAddress;
+    d3d12IndexBufferView.Format = indexFormat == RENDER_INDEX_U32 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+    d3d12IndexBufferView.SizeInBytes = (UINT)buffer->size;
+    ((D3D12CommandList*)list->handle)->list->IASetIndexBuffer(&d3d12IndexBufferView);
+}
+
+static void d3d12SetGraphicsConstants(RenderCommandList* list, u32 firstConstant, u32 totalConstants, void* data) {
+    ((D3D12CommandList*)list->handle)->list->SetGraphicsRoot32BitConstants(0, totalConstants, data, firstConstant);
+}
+
+static void d3d12DrawIndexed(RenderCommandList* list, u32 totalIndices, u32 totalInstances, u32 firstIndex, s32 baseVertex) {
+    ((D3D12CommandList*)list->handle)->list->DrawIndexedInstanced(totalIndices, totalInstances, firstIndex, baseVertex, 0);
+}
+
+static void d3d12CopyBuffer(RenderCommandList* list, RenderResource* dst, u64 dstOffset, RenderResource* src, u64 srcOffset,
+                            u64 size) {
+    ((D3D12CommandList*)list->handle)->list->CopyBufferRegion((ID3D12Resource*)dst->handle, dstOffset,
+                                                              (ID3D12Resource*)src->handle, srcOffset, size);
+}
+
+//the footprint is rounded up to whole blocks, a compressed level's edge blocks hang past its size
+static void d3d12CopyBufferToTexture(RenderCommandList* list, RenderResource* dst, u32 mipLevel, u32 x, u32 y, u32 width,
+                                     u32 height, RenderResource* src, u64 srcOffset, u32 srcRowPitch) {
+    ID3D12Resource* texture = (ID3D12Resource*)dst->handle;
+    D3D12_RESOURCE_DESC desc = texture->GetDesc();
+    bool compressed = desc.Format >= DXGI_FORMAT_BC1_TYPELESS && desc.Format <= DXGI_FORMAT_BC5_SNORM;
+    D3D12_TEXTURE_COPY_LOCATION dstLocation = {};
+    dstLocation.pResource = texture;
+    dstLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+    dstLocation.SubresourceIndex = mipLevel;
+    D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
+    srcLocation.pResource = (ID3D12Resource*)src->handle;
+    srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+    srcLocation.PlacedFootprint.Offset = srcOffset;
+    srcLocation.PlacedFootprint.Footprint.Format = desc.Format;
+    srcLocation.PlacedFootprint.Footprint.Width = compressed ? (width + 3) & ~3 : width;
+    srcLocation.PlacedFootprint.Footprint.Height = compressed ? (height + 3) & ~3 : height;
+    srcLocation.PlacedFootprint.Footprint.Depth = 1;
+    srcLocation.PlacedFootprint.Footprint.RowPitch = srcRowPitch;
+    ((D3D12CommandList*)list->handle)->list->CopyTextureRegion(&dstLocation, x, y, 0, &srcLocation, 0);
+}
+
+static void initializeD3D12RenderBackend(RenderBackend* backend) {
+    backend->createBuffer = d3d12CreateBuffer;
+    backend->destroyResource = d3d12DestroyResource;
+    backend->mapResource = d3d12MapResource;
+    backend->unmapResource = d3d12UnmapResource;
+    backend->createFence = d3d12CreateFence;
+    backend->createCommandList = d3d12CreateCommandList;
+    backend->getBackBuffer = d3d12GetBackBuffer;
+    backend->getCurrentBackBufferIndex = d3d12GetCurrentBackBufferIndex;
+    backend->createDescriptorHeap = d3d12CreateDescriptorHeap;
+    backend->createConstantBufferView = d3d12CreateConstantBufferView;
+    backend->createBufferShaderView = d3d12CreateBufferShaderView;
+    backend->createRenderTargetView = d3d12CreateRenderTargetView;
+    backend->createSampler = d3d12CreateSampler;
+    backend->createTexture2D = d3d12CreateTexture2D;
+    backend->createTextureShaderView = d3d12CreateTextureShaderView;
+    backend->createMemoryHeap = d3d12CreateMemoryHeap;
+    backend->createPlacedBuffer = d3d12CreatePlacedBuffer;
+    backend->destroyMemoryHeap = d3d12DestroyMemoryHeap;
+    backend->createPipeline = d3d12CreatePipeline;
+    backend->destroyPipeline = d3d12DestroyPipeline;
+    backend->createPipelineLibrary = d3d12CreatePipelineLibrary;
+    backend->serializePipelineLibrary = d3d12SerializePipelineLibrary;
+    backend->destroyPipelineLibrary = d3d12DestroyPipelineLibrary;
+    backend->loadPipeline = d3d12LoadPipeline;
+    backend->storePipeline = d3d12StorePipeline;
+    backend->executeCommandLists = d3d12ExecuteCommandLists;
+    backend->signalFence = d3d12SignalFence;
+    backend->getCompletedFenceValue = d3d12GetCompletedFenceValue;
+    backend->waitForFence = d3d12WaitForFence;
+    backend->waitForFenceOnQueue = d3d12WaitForFenceOnQueue;
+    backend->present = d3d12Present;
+    backend->setMaximumFrameLatency = d3d12SetMaximumFrameLatency;
+    backend->waitForPresent = d3d12WaitForPresent;
+    backend->readTimestamp = d3d12ReadTimestamp;
+    backend->getMicroseconds = d3d12GetMicroseconds;
+    backend->sleepMicroseconds = d3d12SleepMicroseconds;
+    backend->resetCommandList = d3d12ResetCommandList;
+    backend->writeTimestamp = d3d12WriteTimestamp;
+    backend->closeCommandList = d3d12CloseCommandList;
+    backend->transitionResource = d3d12TransitionResource;
+    backend->insertBarriers = d3d12InsertBarriers;
+    backend->setDescriptorHeaps = d3d12SetDescriptorHeaps;
+    backend->setViewport = d3d12SetViewport;
+    backend->setRenderTarget = d3d12SetRenderTarget;
+    backend->clearRenderTarget = d3d12ClearRenderTarget;
+    backend->setPipeline = d3d12SetPipeline;
+    backend->setVertexBuffer = d3d12SetVertexBuffer;
+    backend->setIndexBuffer = d3d12SetIndexBuffer;
+    backend->setGraphicsConstants = d3d12SetGraphicsConstants;
+    backend->drawIndexed = d3d12DrawIndexed;
+    backend->copyBuffer = d3d12CopyBuffer;
+    backend->copyBufferToTexture = d3d12CopyBufferToTexture;
+    backend->data = &d3d12Backend;
+}
+
 LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
     switch (message) {
-        case WM_QUIT:
+        //the frame loop ends on the quit message so it can save the pipeline library on the way out
         case WM_CLOSE: {
-            exit(0);
+            PostQuitMessage(0);
+            return 0;
         }
     }
     return DefWindowProc(hWnd, message, wParam, lParam);
@@ -82,18 +1277,6 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
                                 windowRect.bottom - windowRect.top, 0, 0, hInstance, 0);
     //WINDOW SETUP ***********************************************************************************************************
     //D3D12 PIPELINE SETUP ////////////////////////////////////////////////////////////////////////////////////////////////////
-    D3D12_VIEWPORT d3d12Viewport = {};
-    D3D12_RECT d3d12ScissorRect = {};
-    d3d12Viewport.TopLeftX = 0;
-    d3d12Viewport.TopLeftY = 0;
-    d3d12Viewport.Width = width;
-    d3d12Viewport.Height = height;
-    d3d12Viewport.MinDepth = 0;
-    d3d12Viewport.MaxDepth = 1;
-    d3d12ScissorRect.left = 0;
-    d3d12ScissorRect.top = 0;
-    d3d12ScissorRect.right = width;
-    d3d12ScissorRect.bottom = height;
     WinAssert(DXGIDeclareAdapterRemovalSupport());
 
     u32 dxgiFactoryFlags = 0;
@@ -126,6 +1309,10 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
     queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
     WinAssert(d3d12Device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&d3d12CommandQueue)));
 
+    ID3D12CommandQueue* d3d12CopyQueue = 0;
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    WinAssert(d3d12Device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&d3d12CopyQueue)));
+
     u32 d3d12FrameCount = 2;
     DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
     swapChainDesc.BufferCount = d3d12FrameCount;
@@ -135,37 +1322,93 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
     swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
     swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
     swapChainDesc.SampleDesc.Count = 1;
+    swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
     IDXGISwapChain1* swapChain = 0;
     WinAssert(factory->CreateSwapChainForHwnd(d3d12CommandQueue, windowHandle, &swapChainDesc, 0, 0, &swapChain));
     WinAssert(factory->MakeWindowAssociation(windowHandle, DXGI_MWA_NO_ALT_ENTER));
     IDXGISwapChain3* d3d12SwapChain = (IDXGISwapChain3*)swapChain;
-    u32 d3d12FrameIndex = d3d12SwapChain->GetCurrentBackBufferIndex();
-    
-    ID3D12DescriptorHeap* d3d12RTVHeap = 0;
-    D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-    rtvHeapDesc.NumDescriptors = d3d12FrameCount;
-    rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-    rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    WinAssert(d3d12Device->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&d3d12RTVHeap)));
-    u32 d3d12RTVDescriptorSize = d3d12Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-
-    ID3D12GraphicsCommandList* d3d12CommandList;
-    ID3D12Resource* d3d12RenderTargets[2] = {};
-    ID3D12CommandAllocator* d3d12CommandAllocators[2] = {};
-    D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle(d3d12RTVHeap->GetCPUDescriptorHandleForHeapStart());
+
+    d3d12Backend.device = d3d12Device;
+    d3d12Backend.queues[RENDER_QUEUE_DIRECT] = d3d12CommandQueue;
+    d3d12Backend.queues[RENDER_QUEUE_COPY] = d3d12CopyQueue;
+    d3d12Backend.swapChain = d3d12SwapChain;
+    d3d12Backend.fenceEvent = CreateEvent(0, false, false, 0);
+    if (d3d12Backend.fenceEvent == 0) {
+        WinAssert(HRESULT_FROM_WIN32(GetLastError()));
+    }
+    d3d12Backend.frameLatencyWaitable = d3d12SwapChain->GetFrameLatencyWaitableObject();
+
+    D3D12_QUERY_HEAP_DESC timestampHeapDesc = {};
+    timestampHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    timestampHeapDesc.Count = RENDER_MAX_TIMESTAMPS;
+    WinAssert(d3d12Device->CreateQueryHeap(&timestampHeapDesc, IID_PPV_ARGS(&d3d12Backend.timestampHeap)));
+    WinAssert(d3d12CommandQueue->GetTimestampFrequency(&d3d12Backend.timestampFrequency));
+    WinAssert(d3d12CommandQueue->GetClockCalibration(&d3d12Backend.calibrationGpuTime, &d3d12Backend.calibrationCpuTime));
+    LARGE_INTEGER cpuFrequency;
+    QueryPerformanceFrequency(&cpuFrequency);
+    d3d12Backend.cpuFrequency = (u64)cpuFrequency.QuadPart;
+
+    RenderBackend backend = {};
+    initializeD3D12RenderBackend(&backend);
+    backend.totalBackBuffers = d3d12FrameCount;
+    backend.width = width;
+    backend.height = height;
+
+    u32 renderMemorySize = MEGABYTE(1);
+    MemoryArena renderArena = createMemoryArena(VirtualAlloc(0, renderMemorySize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE), renderMemorySize);
+    DescriptorAllocator renderTargetDescriptors;
+    DescriptorAllocator resourceDescriptors;
+    DescriptorAllocator samplerDescriptors;
+    if (!initializeDescriptorAllocator(&renderTargetDescriptors, &backend, RENDER_DESCRIPTORS_RENDER_TARGET,
+                                       D3D12_RENDER_TARGET_DESCRIPTORS, 0, &renderArena) ||
+        !initializeDescriptorAllocator(&resourceDescriptors, &backend, RENDER_DESCRIPTORS_RESOURCE,
+                                       D3D12_PERSISTENT_DESCRIPTORS, D3D12_TRANSIENT_DESCRIPTORS, &renderArena) ||
+        !initializeDescriptorAllocator(&samplerDescriptors, &backend, RENDER_DESCRIPTORS_SAMPLER,
+                                       D3D12_SAMPLER_DESCRIPTORS, 0, &renderArena)) {
+        MessageBox(0, "could not create the descriptor heaps", "ERROR", 0);
+        exit(1);
+    }
     for (UINT n = 0; n < d3d12FrameCount; n++) {
-        WinAssert(d3d12SwapChain->GetBuffer(n, IID_PPV_ARGS(&d3d12RenderTargets[n])));
-        d3d12Device->CreateRenderTargetView(d3d12RenderTargets[n], 0, rtvHandle);
-        rtvHandle.ptr += d3d12RTVDescriptorSize;
-        WinAssert(d3d12Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&d3d12CommandAllocators[n])));
+        ID3D12Resource* renderTarget = 0;
+        WinAssert(d3d12SwapChain->GetBuffer(n, IID_PPV_ARGS(&renderTarget)));
+        RenderResource* backBuffer = &d3d12Backend.backBuffers[n];
+        u32 descriptor = allocateDescriptor(&renderTargetDescriptors);
+        backBuffer->handle = renderTarget;
+        backBuffer->descriptor = getDescriptorCpuHandle(&renderTargetDescriptors, descriptor);
+        backBuffer->heap = RENDER_HEAP_DEFAULT;
+        d3d12CreateRenderTargetView(&backend, &renderTargetDescriptors.heap, descriptor, backBuffer);
+    }
+    for (u32 filter = RENDER_FILTER_POINT; filter <= RENDER_FILTER_LINEAR; filter++) {
+        for (u32 addressMode = RENDER_ADDRESS_WRAP; addressMode <= RENDER_ADDRESS_CLAMP; addressMode++) {
+            d3d12CreateSampler(&backend, &samplerDescriptors.heap, allocateDescriptor(&samplerDescriptors), filter, addressMode);
+        }
+    }
+    //the readback buffer stays mapped, a frame's timestamps are read once its fence completes
+    if (!d3d12CreateBuffer(&backend, RENDER_MAX_TIMESTAMPS * sizeof(u64), RENDER_HEAP_READBACK, RENDER_STATE_COPY_DEST,
+                           &d3d12Backend.timestampBuffer)) {
+        MessageBox(0, "could not create the timestamp buffer", "ERROR", 0);
+        exit(1);
     }
-    WinAssert(d3d12Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, d3d12CommandAllocators[d3d12FrameIndex], 0, IID_PPV_ARGS(&d3d12CommandList)));
+    d3d12Backend.timestamps = (u64*)d3d12MapResource(&backend, &d3d12Backend.timestampBuffer);
 
-    WinAssert(d3d12CommandList->Close());
+    FramePacer framePacer;
+    if (!d3d12Backend.timestamps || !initializeFramePacer(&framePacer, &backend, 2)) {
+        MessageBox(0, "could not create the frame pacer", "ERROR", 0);
+        exit(1);
+    }
 
     ID3D12RootSignature* d3d12GraphicsRootSignature = 0;
+    //parameter 0 is the graphics constants at b0
+    D3D12_ROOT_PARAMETER rootParameters[1] = {};
+    rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    rootParameters[0].Constants.ShaderRegister = 0;
+    rootParameters[0].Constants.RegisterSpace = 0;
+    rootParameters[0].Constants.Num32BitValues = RENDER_MAX_GRAPHICS_CONSTANTS;
+    rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
     D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
+    rootSignatureDesc.NumParameters = 1;
+    rootSignatureDesc.pParameters = rootParameters;
     rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
     ID3DBlob* signature = 0;
     ID3DBlob* error = 0;
@@ -176,203 +1419,210 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 
 
     //D3D12 RENDER SETUP /////////////////////////////////////////////////////////////////////////////////////////////////////
-    u32 d3d12CompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-    ID3DBlob* vertexShader = 0;
-    ID3DBlob* pixelShader = 0;
-
-    D3DCompileFromFile(L"shader.hlsl", 0, 0, "VSMain", "vs_5_0", d3d12CompileFlags, 0, &vertexShader, &error);
-    if(error){
-        MessageBox(0, (LPCSTR)error->GetBufferPointer(), "ERROR", 0);
-        exit(1);
-    }
-
-    D3DCompileFromFile(L"shader.hlsl", 0, 0, "PSMain", "ps_5_0", d3d12CompileFlags, 0, &pixelShader, &error);
-    if(error){
-        MessageBox(0, (LPCSTR)error->GetBufferPointer(), "ERROR", 0);
-        exit(1);
+    RenderPipelineDesc pipelineDesc = {};
+    pipelineDesc.rootSignature = d3d12GraphicsRootSignature;
+    if (D3D12_QUANTIZE_MODELS) {
+        VertexAttributeLayout modelLayout = getModel3DVertexLayout();
+        pipelineDesc.totalAttributes = getQuantizedVertexAttributes(&modelLayout, pipelineDesc.attributes);
+    } else {
+        pipelineDesc.attributes[0].semantic = "POSITION";
+        pipelineDesc.attributes[0].format = RENDER_FORMAT_R32G32B32_FLOAT;
+        pipelineDesc.totalAttributes = 1;
     }
-    D3D12_INPUT_ELEMENT_DESC inputElementDescs[] = {
-        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-    };
+    pipelineDesc.cullMode = RENDER_CULL_BACK;
+    pipelineDesc.blendMode = RENDER_BLEND_ALPHA;
+    pipelineDesc.renderTargetFormats[0] = RENDER_FORMAT_R8G8B8A8_UNORM;
+    pipelineDesc.totalRenderTargets = 1;
+    pipelineDesc.depthFormat = RENDER_FORMAT_D32_FLOAT;
+    pipelineDesc.sampleCount = 1;
 
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-    psoDesc.InputLayout = {inputElementDescs, _countof(inputElementDescs)};
-    psoDesc.pRootSignature = d3d12GraphicsRootSignature;
-    psoDesc.VS.BytecodeLength = vertexShader->GetBufferSize();
-    psoDesc.VS.pShaderBytecode = vertexShader->GetBufferPointer();
-    psoDesc.PS.BytecodeLength = pixelShader->GetBufferSize();
-    psoDesc.PS.pShaderBytecode = pixelShader->GetBufferPointer();
-    psoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
-    psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
-    psoDesc.RasterizerState.FrontCounterClockwise = false;
-    psoDesc.RasterizerState.DepthBias = D3D12_DEFAULT_DEPTH_BIAS;
-    psoDesc.RasterizerState.DepthBiasClamp = D3D12_DEFAULT_DEPTH_BIAS_CLAMP;
-    psoDesc.RasterizerState.SlopeScaledDepthBias = D3D12_DEFAULT_SLOPE_SCALED_DEPTH_BIAS;
-    psoDesc.RasterizerState.DepthClipEnable = true;
-    psoDesc.RasterizerState.MultisampleEnable = false;
-    psoDesc.RasterizerState.AntialiasedLineEnable = false;
-    psoDesc.RasterizerState.ForcedSampleCount = 0;
-    psoDesc.RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
-    const D3D12_RENDER_TARGET_BLEND_DESC defaultRenderTargetBlendDesc = {
-        true,
-        false,
-        D3D12_BLEND_SRC_ALPHA,
-        D3D12_BLEND_INV_SRC_ALPHA,
-        D3D12_BLEND_OP_ADD,
-        D3D12_BLEND_ONE,
-        D3D12_BLEND_ZERO,
-        D3D12_BLEND_OP_ADD,
-        D3D12_LOGIC_OP_NOOP,
-        D3D12_COLOR_WRITE_ENABLE_ALL,
-    };
-    for (UINT i = 0; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) {
-        psoDesc.BlendState.RenderTarget[i] = defaultRenderTargetBlendDesc;
-    }
-    psoDesc.DepthStencilState.DepthEnable = false;
-    psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
-    psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
-    psoDesc.DepthStencilState.StencilEnable = false;
-    psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-    psoDesc.SampleMask = UINT_MAX;
-    psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-    psoDesc.NumRenderTargets = 1;
-    psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-    psoDesc.SampleDesc.Count = 1;
-    ID3D12PipelineState* d3d12PipelineState;
-    WinAssert(d3d12Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&d3d12PipelineState)));
-
-    ID3D12Resource* d3d12VertexBuffer = 0;
-    ID3D12Resource* d3d12IndexBuffer = 0;
-    D3D12_VERTEX_BUFFER_VIEW d3d12VertexBufferView = {};
-    D3D12_INDEX_BUFFER_VIEW d3d12IndexBufferView = {};
-
-    D3D12_HEAP_PROPERTIES bufHeapProp = {};
-    bufHeapProp.Type = D3D12_HEAP_TYPE_UPLOAD;
-    bufHeapProp.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-    bufHeapProp.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-    bufHeapProp.CreationNodeMask = 1;
-    bufHeapProp.VisibleNodeMask = 1;
+    //shader.hlsl is compiled by the asset database on a worker thread and recompiled whenever it is saved
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    os.totalCores = systemInfo.dwNumberOfProcessors;
+    os.readFileIntoBuffer = win32ReadFileIntoBuffer;
+    os.readFileIntoBoundedBuffer = win32ReadFileIntoBoundedBuffer;
+    os.writeToFile = win32WriteToFile;
+    os.deleteFile = win32DeleteFile;
+    os.getFileHandleForReading = win32GetFileHandleForReading;
+    os.setFileHandlePointer = win32SetFileHandlePointer;
+    os.readFromFileHandle = win32ReadFromFileHandle;
+    os.closeFileHandle = win32CloseFileHandle;
+    os.getSystemTime = win32GetSystemTime;
+    os.initializeWorkQueue = win32InitializeWorkQueue;
+    os.addWorkQueueEntry = win32AddWorkQueueEntry;
+    os.completeWorkQueueEntries = win32CompleteWorkQueueEntries;
+    os.createFileWatcher = win32CreateFileWatcher;
+    os.readFileWatcherChanges = win32ReadFileWatcherChanges;
+    os.createModel3D = win32CreateModel3D;
+    os.createModel3D32 = win32CreateModel3D32;
+    os.destroyModel3D = win32DestroyModel3D;
+    os.model3DVertexBufferPool = &modelStore.pools[MODEL_STORE_VERTICES].pool;
+    os.model3DIndexBufferPool = &modelStore.pools[MODEL_STORE_INDICES].pool;
+    os.createTexture2D = win32CreateTexture2D;
+    os.updateTexture2D = win32UpdateTexture2D;
+    os.createTexture2DMipmapped = win32CreateTexture2DMipmapped;
+    os.createTexture2DFromFile = win32CreateTexture2DFromFile;
+    os.createTextureCube = win32CreateTextureCube;
+    os.bindTextureCube = win32BindTextureCube;
+    os.TEXTURE_FORMAT_R8 = RENDER_FORMAT_R8_UNORM;
+    os.TEXTURE_FORMAT_RG8 = RENDER_FORMAT_R8G8_UNORM;
+    os.TEXTURE_FORMAT_RGBA8 = RENDER_FORMAT_R8G8B8A8_UNORM;
+    os.TEXTURE_FORMAT_R32F = RENDER_FORMAT_R32_FLOAT;
+    os.TEXTURE_FORMAT_BC1 = RENDER_FORMAT_BC1_UNORM;
+    os.TEXTURE_FORMAT_BC4S = RENDER_FORMAT_BC4_SNORM;
+    os.TEXTURE_FORMAT_BC4U = RENDER_FORMAT_BC4_UNORM;
+    os.TEXTURE_FORMAT_BC5 = RENDER_FORMAT_BC5_UNORM;
+    os.initializeWorkQueue(&assetQueue, os.totalCores > 1 ? os.totalCores - 1 : 1);
+    os.initializeWorkQueue(&bakeQueue, os.totalCores > 1 ? os.totalCores - 1 : 1);
 
-    D3D12_RESOURCE_DESC bufResDesc = {};
-    bufResDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    bufResDesc.Alignment = 0;
-    bufResDesc.Width = MEGABYTE(1);
-    bufResDesc.Height = 1;
-    bufResDesc.DepthOrArraySize = 1;
-    bufResDesc.MipLevels = 1;
-    bufResDesc.Format = DXGI_FORMAT_UNKNOWN;
-    bufResDesc.SampleDesc.Count = 1;
-    bufResDesc.SampleDesc.Quality = 0;
-    bufResDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-    bufResDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+    u32 assetMemorySize = MEGABYTE(40);
+    MemoryArena assetArena = createMemoryArena(VirtualAlloc(0, assetMemorySize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE), assetMemorySize);
+    //cooks are kept between runs, a directory that cannot be made only costs the cooks
+    CreateDirectoryA(D3D12_COOK_CACHE_DIRECTORY, 0);
+    initializeCookCacheDirectory(&cookDirectory, &os, D3D12_COOK_CACHE_DIRECTORY, D3D12_COOK_CACHE_BUDGET, &assetArena);
+    cookCache.local = createCookCacheDirectoryBackend(&cookDirectory);
+    initializeAssetDatabase(&assetDatabase, &os, ".", MEGABYTE(1), &assetArena, &assetQueue, &cookCache);
 
-    WinAssert(d3d12Device->CreateCommittedResource(&bufHeapProp, D3D12_HEAP_FLAG_NONE, &bufResDesc,
-                                                   D3D12_RESOURCE_STATE_GENERIC_READ, 0, IID_PPV_ARGS(&d3d12VertexBuffer)));
+    //pipelines compile on their own queue and are kept in a pipeline library between runs
+    WorkQueue pipelineQueue;
+    os.initializeWorkQueue(&pipelineQueue, os.totalCores > 1 ? os.totalCores - 1 : 1);
+    u32 pipelineMemorySize = D3D12_PIPELINE_LIBRARY_SIZE + MEGABYTE(4);
+    MemoryArena pipelineArena = createMemoryArena(VirtualAlloc(0, pipelineMemorySize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE), pipelineMemorySize);
+    PipelineCache pipelineCache;
+    initializePipelineCache(&pipelineCache, &backend, &os, &pipelineQueue, &pipelineArena, D3D12_PIPELINE_LIBRARY_FILE,
+                            D3D12_PIPELINE_LIBRARY_SIZE);
 
-    d3d12VertexBufferView.BufferLocation = d3d12VertexBuffer->GetGPUVirtualAddress();
-    d3d12VertexBufferView.StrideInBytes = sizeof(f32) * 3;
-    d3d12VertexBufferView.SizeInBytes = bufResDesc.Width;
+    ShaderAsset shaderAsset = {};
+    shaderAsset.cache = &pipelineCache;
+    shaderAsset.desc = pipelineDesc;
+    shaderAsset.pipeline = PIPELINE_CACHE_NONE;
+    shaderAsset.fallback = PIPELINE_CACHE_NONE;
+    addCookedAsset(&assetDatabase, "shader.hlsl", "d3d12 shader", 1, cookShader, swapShader, &shaderAsset);
+    while (shaderAsset.pipeline == PIPELINE_CACHE_NONE) {
+        updateAssetDatabase(&assetDatabase);
+        if (assetDatabase.totalCookFailures) {
+            MessageBox(0, shaderAsset.error, "ERROR", 0);
+            exit(1);
+        }
+        Sleep(1);
+    }
+    if (!isPipelineReady(&pipelineCache, shaderAsset.pipeline)) {
+        MessageBox(0, "could not create the shader pipeline", "ERROR", 0);
+        exit(1);
+    }
 
-    WinAssert(d3d12Device->CreateCommittedResource(&bufHeapProp, D3D12_HEAP_FLAG_NONE, &bufResDesc,
-                                                   D3D12_RESOURCE_STATE_GENERIC_READ, 0, IID_PPV_ARGS(&d3d12IndexBuffer)));
+    UploadScheduler uploadScheduler;
+    if (!initializeUploadScheduler(&uploadScheduler, &backend, D3D12_UPLOAD_STAGING_SIZE, D3D12_UPLOAD_BUDGET)) {
+        MessageBox(0, "could not create the upload scheduler", "ERROR", 0);
+        exit(1);
+    }
 
-    d3d12IndexBufferView.BufferLocation = d3d12IndexBuffer->GetGPUVirtualAddress();
-    d3d12IndexBufferView.Format = DXGI_FORMAT_R16_UINT;
-    d3d12IndexBufferView.SizeInBytes = bufResDesc.Width;
+    //models share a few default heap buffers, their data is copied aside and optimized until the copy queue has taken it
+    u32 modelMemorySize = D3D12_MODEL_SOURCE_SIZE + D3D12_MODEL_SCRATCH_SIZE + MEGABYTE(2);
+    MemoryArena modelArena = createMemoryArena(VirtualAlloc(0, modelMemorySize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE), modelMemorySize);
+    if (!initializeModelStore(&modelStore, &backend, &uploadScheduler, D3D12_MODEL_VERTEX_CHUNK, D3D12_MODEL_INDEX_CHUNK,
+                              D3D12_MAX_MODELS, D3D12_MODEL_SOURCE_SIZE, D3D12_MODEL_SCRATCH_SIZE, &modelArena)) {
+        MessageBox(0, "could not create the model store", "ERROR", 0);
+        exit(1);
+    }
+    modelStore.quantize = D3D12_QUANTIZE_MODELS;
 
-    f32 triVerts[] = {
-        -0.5, -0.5, 0,
-        0.0, 0.5, 0,
-        0.5, -0.5, 0,
-    };
-    u16 triElms[] = { 0, 1, 2 };
-    f32* vPtr = 0;
-    u16* ePtr = 0;
-    WinAssert(d3d12VertexBuffer->Map(0, 0, (void**)&vPtr));
-    WinAssert(d3d12IndexBuffer->Map(0, 0, (void**)&ePtr));
-    memcpy(vPtr, triVerts, sizeof(triVerts));
-    memcpy(ePtr, triElms, sizeof(triElms));
-    d3d12VertexBuffer->Unmap(0, 0);
-    d3d12IndexBuffer->Unmap(0, 0);
+    //textures get a bindless slot each, their levels are copied aside like the models' data
+    u32 textureMemorySize = D3D12_TEXTURE_SOURCE_SIZE + D3D12_TEXTURE_SCRATCH_SIZE + D3D12_STREAMING_READ_SIZE + MEGABYTE(3);
+    MemoryArena textureArena = createMemoryArena(VirtualAlloc(0, textureMemorySize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE), textureMemorySize);
+    if (!initializeTextureStore(&textureStore, &backend, &uploadScheduler, &resourceDescriptors, D3D12_MAX_TEXTURES,
+                                D3D12_TEXTURE_SOURCE_SIZE, D3D12_TEXTURE_SCRATCH_SIZE, &textureArena)) {
+        MessageBox(0, "could not create the texture store", "ERROR", 0);
+        exit(1);
+    }
+    //streamed levels are read on their own queue, nothing completes it every frame
+    WorkQueue streamingQueue;
+    os.initializeWorkQueue(&streamingQueue, 1);
+    if (!initializeTextureStreamingManager(&textureStreaming, D3D12_MAX_TEXTURES, D3D12_STREAMING_BUDGET, &textureArena,
+                                           &os, &streamingQueue) ||
+        !initializeTextureStreamingStore(&textureStreamingStore, &textureStreaming, &textureStore,
+                                         D3D12_STREAMING_READ_SIZE, &textureArena)) {
+        MessageBox(0, "could not create the texture streaming manager", "ERROR", 0);
+        exit(1);
+    }
 
+    ScratchScene scene;
+    if (!initializeScratchScene(&scene, &os, &modelStore, &textureStore.scratch)) {
+        MessageBox(0, "could not create the scene models", "ERROR", 0);
+        exit(1);
+    }
+    if (!initializeAssetRegistry(&assetRegistry, D3D12_REGISTRY_ASSETS, D3D12_REGISTRY_NAMES, &textureArena)) {
+        MessageBox(0, "could not create the asset registry", "ERROR", 0);
+        exit(1);
+    }
+    addScratchStreamedModels(&scene, &os, &assetRegistry, D3D12_STREAMED_TEXTURES, &textureArena,
+                             &textureStore.scratch);
+    u64 frame = 0;
 
+    //the main thread records alongside the workers
+    WorkQueue recordQueue;
+    os.initializeWorkQueue(&recordQueue, os.totalCores > 1 ? os.totalCores - 1 : 0);
+    CommandListPool commandLists;
+    u32 totalRecordingLists = os.totalCores < COMMAND_LIST_POOL_MAX_LISTS ? os.totalCores : COMMAND_LIST_POOL_MAX_LISTS;
+    if (!initializeCommandListPool(&commandLists, &framePacer, &os, &recordQueue, totalRecordingLists)) {
+        MessageBox(0, "could not create the recording command lists", "ERROR", 0);
+        exit(1);
+    }
+    commandLists.resources = &resourceDescriptors.heap;
+    commandLists.samplers = &samplerDescriptors.heap;
 
     //D3D12 RENDER SETUP *****************************************************************************************************
 
-    ID3D12Fence* d3d12Fence = 0;
-    HANDLE d3d12FenceEvent;
-    u64 d3d12FenceValues[2] = {};
-    WinAssert(d3d12Device->CreateFence(d3d12FenceValues[d3d12FrameIndex], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&d3d12Fence)));
-    d3d12FenceValues[d3d12FrameIndex]++;
-
-    d3d12FenceEvent = CreateEvent(0, false, false, 0);
-    if (d3d12FenceEvent == 0) {
-        WinAssert(HRESULT_FROM_WIN32(GetLastError()));
-    }
-    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
     ShowWindow(windowHandle, nCmdShow);
     bool running = true;
     while(running) {
         MSG msg = {};
         while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+            if (msg.message == WM_QUIT) {
+                running = false;
+            }
             TranslateMessage(&msg);
             DispatchMessage(&msg);
         }
 
-        WinAssert(d3d12CommandAllocators[d3d12FrameIndex]->Reset());
-        WinAssert(d3d12CommandList->Reset(d3d12CommandAllocators[d3d12FrameIndex], d3d12PipelineState));
-
-        D3D12_RESOURCE_BARRIER resBarrier = {};
-        resBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-        resBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-        resBarrier.Transition.pResource = d3d12RenderTargets[d3d12FrameIndex];
-        resBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-        resBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-        resBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-
-        d3d12CommandList->ResourceBarrier(1, &resBarrier);
-
-        rtvHandle = d3d12RTVHeap->GetCPUDescriptorHandleForHeapStart();
-        rtvHandle.ptr += d3d12FrameIndex * d3d12RTVDescriptorSize;
-        d3d12CommandList->RSSetViewports(1, &d3d12Viewport);
-        d3d12CommandList->RSSetScissorRects(1, &d3d12ScissorRect);
-        d3d12CommandList->OMSetRenderTargets(1, &rtvHandle, false, 0);
-        Vector4 cc(0, 1, 0, 1);
-        d3d12CommandList->ClearRenderTargetView(rtvHandle, cc.va, 0, 0);
-        d3d12CommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        d3d12CommandList->SetGraphicsRootSignature(d3d12GraphicsRootSignature);
-        d3d12CommandList->IASetVertexBuffers(0, 1, &d3d12VertexBufferView);
-        d3d12CommandList->IASetIndexBuffer(&d3d12IndexBufferView);
-
-        d3d12CommandList->DrawIndexedInstanced(3, 1, 0, 0, 0);
-
-        resBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-        resBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-        d3d12CommandList->ResourceBarrier(1, &resBarrier);
+        updateAssetDatabase(&assetDatabase);
 
-        WinAssert(d3d12CommandList->Close());
-
-        ID3D12CommandList* ppCommandList[] = {d3d12CommandList};
-        d3d12CommandQueue->ExecuteCommandLists(_countof(ppCommandList), ppCommandList);
-
-        WinAssert(d3d12SwapChain->Present(1, 0));
-
-        const UINT64 currentFenceValue = d3d12FenceValues[d3d12FrameIndex];
-        
-        WinAssert(d3d12CommandQueue->Signal(d3d12Fence, currentFenceValue));
-        d3d12FrameIndex = d3d12SwapChain->GetCurrentBackBufferIndex();        
-
-        if (d3d12Fence->GetCompletedValue() < d3d12FenceValues[d3d12FrameIndex]) {
-            WinAssert(d3d12Fence->SetEventOnCompletion(d3d12FenceValues[d3d12FrameIndex], d3d12FenceEvent));
-            WaitForSingleObjectEx(d3d12FenceEvent, INFINITE, false);
+        RenderPipeline* pipeline = getPipeline(&pipelineCache, shaderAsset.pipeline, shaderAsset.fallback);
+        RenderCommandList* commandList = beginRenderFrame(&framePacer, pipeline);
+        beginDescriptorFrame(&resourceDescriptors, framePacer.completedFrames);
+        beginModelStoreFrame(&modelStore, framePacer.completedFrames);
+        beginPipelineCacheFrame(&pipelineCache, framePacer.completedFrames);
+        streamScratchScene(&scene, &textureStreaming, frame++, (f32)height);
+        updateTextureStreaming(&textureStreaming, &textureStore.scratch);
+        beginTextureStoreFrame(&textureStore);
+        backend.setDescriptorHeaps(commandList, &resourceDescriptors.heap, &samplerDescriptors.heap);
+        updateUploadScheduler(&uploadScheduler);
+        if (prepareScratchScene(&scene, commandList, framePacer.backBuffer)) {
+            recordCommandListsInParallel(&commandLists, pipeline, scene.totalDraws, D3D12_MIN_DRAWS_PER_LIST,
+                                         recordScratchDraws, &scene);
         }
-        d3d12FenceValues[d3d12FrameIndex] = currentFenceValue + 1;
-
-        WinAssert(d3d12CommandQueue->Signal(d3d12Fence, d3d12FenceValues[d3d12FrameIndex]));
-        WinAssert(d3d12Fence->SetEventOnCompletion(d3d12FenceValues[d3d12FrameIndex], d3d12FenceEvent));
-        WaitForSingleObjectEx(d3d12FenceEvent, INFINITE, FALSE);
-        d3d12FenceValues[d3d12FrameIndex]++;
+        endDescriptorFrame(&resourceDescriptors, framePacer.frameNumber + 1);
+        endModelStoreFrame(&modelStore, framePacer.frameNumber + 1);
+        endPipelineCacheFrame(&pipelineCache, framePacer.frameNumber + 1);
+        endRenderFrame(&framePacer);
+    }
+    flushFramePacer(&framePacer);
+    //reads still in flight finish before their files go
+    os.completeWorkQueueEntries(&streamingQueue);
+    flushUploadScheduler(&uploadScheduler);
+    os.destroyModel3D(&scene.triangle);
+    destroyModelStore(&modelStore);
+    destroyTextureStore(&textureStore);
+    for (u32 i = 0; i < D3D12_STREAMED_TEXTURES; i++) {
+        s8 name[sizeof(SCRATCH_STREAMED_NAME)];
+        getScratchStreamedTextureName(i, name);
+        DeleteFileA(name);
     }
+    savePipelineCache(&pipelineCache, D3D12_PIPELINE_LIBRARY_FILE, &pipelineArena);
+    //a batch still cooking stores into the directory, it finishes before the index is written
+    os.completeWorkQueueEntries(&assetQueue);
+    saveCookCacheDirectoryIndex(&cookDirectory, &assetArena);
+    destroyPipelineCache(&pipelineCache);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,697 @@
+#pragma once
+
+#include "glyph_cache.h"
+
+//Offline signed distance field font atlas generator.
+//Glyph outlines come from a callback as closed contours of line and quadratic segments in em units, y up from the
+//baseline; cubic outlines have to be split into quadratics by the caller. Every glyph is turned into a distance field
+//at settings.emSize pixels per em, so one atlas draws text at any size: the shader maps the encoded distance through
+//distanceRange instead of reading coverage.
+//   single channel -> R8 true signed distance
+//   multi channel  -> RGBA8, RGB hold per channel distances to differently colored edges whose median keeps corners
+//                     sharp under magnification, A holds the true signed distance
+//Inside is above 0.5 in every channel. Outlines are fetched, edge colored and packed on the calling thread, then the
+//fields are generated in parallel on the work queue, each job writing straight into its glyphs' atlas rectangles.
+//The output is one block: a FontAtlasHeader, the glyph records and the atlas texels. Write it with
+//writeCompressedAssetToFile and hand what readAssetIntoBuffer gives back to loadFontAtlas, which fills a GlyphCache
+//that FontMap.glyphCache can point at.
+
+#define FONT_ATLAS_MAGIC 0x41464453
+#define FONT_ATLAS_VERSION 1
+#define FONT_ATLAS_MAX_SEGMENTS 1024
+
+#define FONT_SEGMENT_LINE 0
+#define FONT_SEGMENT_QUADRATIC 1
+
+#define FONT_CHANNEL_RED 1
+#define FONT_CHANNEL_GREEN 2
+#define FONT_CHANNEL_BLUE 4
+#define FONT_CHANNEL_YELLOW (FONT_CHANNEL_RED | FONT_CHANNEL_GREEN)
+#define FONT_CHANNEL_MAGENTA (FONT_CHANNEL_RED | FONT_CHANNEL_BLUE)
+#define FONT_CHANNEL_CYAN (FONT_CHANNEL_GREEN | FONT_CHANNEL_BLUE)
+#define FONT_CHANNEL_WHITE (FONT_CHANNEL_RED | FONT_CHANNEL_GREEN | FONT_CHANNEL_BLUE)
+
+//lines run p0 to p1, quadratics p0 to p2 with p1 as the control point. Segments of one contour are consecutive.
+struct FontOutlineSegment {
+    Vector2 p0;
+    Vector2 p1;
+    Vector2 p2;
+    u32 type;
+    u32 contour;
+    u32 channels;
+};
+
+struct FontAtlasSettings {
+    f32 emSize;
+    f32 distanceRange;
+    f32 ascender;
+    f32 lineHeight;
+    u32 atlasWidth;
+    u32 maxAtlasHeight;
+    u32 missingCodepoint;
+    bool multiChannel;
+};
+
+struct FontAtlasHeader {
+    u32 magic;
+    u32 version;
+    u32 atlasWidth;
+    u32 atlasHeight;
+    u32 atlasChannels;
+    u32 totalGlyphs;
+    u32 missingCodepoint;
+    u32 padding;
+    f32 emSize;
+    f32 distanceRange;
+    f32 lineHeight;
+    f32 padding2;
+};
+
+struct FontAtlasGlyph {
+    FontOutlineSegment* segments;
+    Vector4* bounds;
+    u32 totalSegments;
+    f32 orientation;
+    f32 left;
+    f32 top;
+};
+
+struct FontAtlasJob {
+    FontAtlasGlyph* glyphs;
+    GlyphRecord* records;
+    u32* order;
+    u8* atlas;
+    f32* crossings;
+    u32* rowSegments;
+    u32* activeSegments;
+    u32 firstGlyph;
+    u32 glyphStride;
+    u32 totalGlyphs;
+    u32 atlasWidth;
+    u32 atlasChannels;
+    f32 emSize;
+    f32 distanceRange;
+};
+
+static Vector2 getFontSegmentEnd(FontOutlineSegment* segment){
+    return segment->type == FONT_SEGMENT_LINE ? segment->p1 : segment->p2;
+}
+
+static Vector2 getFontSegmentPoint(FontOutlineSegment* segment, f32 t){
+    if(segment->type == FONT_SEGMENT_LINE){
+        return segment->p0 + (segment->p1 - segment->p0) * t;
+    }
+    f32 s = 1 - t;
+    return segment->p0 * (s * s) + segment->p1 * (2 * s * t) + segment->p2 * (t * t);
+}
+
+//a quadratic whose control point sits on an end point still has a direction there, along the chord
+static Vector2 getFontSegmentDirection(FontOutlineSegment* segment, f32 t){
+    if(segment->type == FONT_SEGMENT_LINE){
+        return segment->p1 - segment->p0;
+    }
+    Vector2 direction = (segment->p1 - segment->p0) * (2 * (1 - t)) + (segment->p2 - segment->p1) * (2 * t);
+    if(direction.x == 0 && direction.y == 0){
+        return segment->p2 - segment->p0;
+    }
+    return direction;
+}
+
+//real roots of a t^3 + b t^2 + c t + d, degenerating to the quadratic and linear cases
+static u32 solveCubic(f64* roots, f64 a, f64 b, f64 c, f64 d){
+    if(fabs(a) < 1e-12){
+        if(fabs(b) < 1e-12){
+            if(fabs(c) < 1e-12) return 0;
+            roots[0] = -d / c;
+            return 1;
+        }
+        f64 discriminant = c * c - 4 * b * d;
+        if(discriminant < 0) return 0;
+        discriminant = sqrt(discriminant);
+        roots[0] = (-c + discriminant) / (2 * b);
+        roots[1] = (-c - discriminant) / (2 * b);
+        return 2;
+    }
+    b /= a;
+    c /= a;
+    d /= a;
+    f64 q = (b * b - 3 * c) / 9;
+    f64 r = (b * (2 * b * b - 9 * c) + 27 * d) / 54;
+    f64 offset = b / 3;
+    if(r * r < q * q * q){
+        f64 theta = acos(r / sqrt(q * q * q)) / 3;
+        f64 m = -2 * sqrt(q);
+        roots[0] = m * cos(theta) - offset;
+        roots[1] = m * cos(theta + TAU / 3) - offset;
+        roots[2] = m * cos(theta - TAU / 3) - offset;
+        return 3;
+    }
+    f64 u = -(r < 0 ? -1 : 1) * cbrt(fabs(r) + sqrt(r * r - q * q * q));
+    f64 v = u == 0 ? 0 : q / u;
+    roots[0] = u + v - offset;
+    return 1;
+}
+
+//Unsigned distance from p to the segment and the parameter of the closest point. alignment is how far the segment
+//runs towards p there, 0 when it is perpendicular; two segments meeting at the closest point tie on distance and the
+//more perpendicular one is the one whose side p is really on. Pass 0 for alignment when only the distance matters.
+static f32 getFontSegmentDistance(FontOutlineSegment* segment, Vector2 p, f32* t, f32* alignment){
+    f32 bestT;
+    f32 bestDistance;
+    if(segment->type == FONT_SEGMENT_LINE){
+        Vector2 ab = segment->p1 - segment->p0;
+        f32 lengthSquared = dot(ab, ab);
+        bestT = lengthSquared > 0 ? clamp(dot(p - segment->p0, ab) / lengthSquared, 0, 1) : 0;
+        bestDistance = length(p - getFontSegmentPoint(segment, bestT));
+    }else{
+        Vector2 qa = segment->p0 - p;
+        Vector2 ab = segment->p1 - segment->p0;
+        Vector2 br = segment->p2 - segment->p1 - ab;
+        f64 roots[3];
+        u32 totalRoots = solveCubic(roots, dot(br, br), 3 * dot(ab, br), 2 * dot(ab, ab) + dot(qa, br), dot(qa, ab));
+        bestT = 0;
+        bestDistance = length(qa);
+        f32 endDistance = length(segment->p2 - p);
+        if(endDistance < bestDistance){
+            bestT = 1;
+            bestDistance = endDistance;
+        }
+        for(u32 i = 0; i < totalRoots; i++){
+            if(roots[i] <= 0 || roots[i] >= 1) continue;
+            f32 distance = length(getFontSegmentPoint(segment, (f32)roots[i]) - p);
+            if(distance < bestDistance){
+                bestT = (f32)roots[i];
+                bestDistance = distance;
+            }
+        }
+    }
+    *t = bestT;
+    if(!alignment){
+        return bestDistance;
+    }
+    *alignment = 0;
+    if(bestDistance > 0){
+        Vector2 direction = normalOf(getFontSegmentDirection(segment, bestT));
+        *alignment = absoluteValue(dot(direction, (getFontSegmentPoint(segment, bestT) - p) * (1.0f / bestDistance)));
+    }
+    return bestDistance;
+}
+
+//Signed distance to the segment, positive on its inner side. Past either end the distance to the end tangent's line
+//is used when it is shorter, which keeps the channels of a corner straight instead of rounding it off.
+static f32 getFontSegmentPseudoDistance(FontOutlineSegment* segment, Vector2 p, f32 t, f32 orientation){
+    Vector2 q = getFontSegmentPoint(segment, t);
+    f32 distance = length(p - q);
+    f32 side = cross(getFontSegmentDirection(segment, t), p - q) * orientation;
+    f32 signedDistance = side < 0 ? -distance : distance;
+    if(t <= 0){
+        Vector2 direction = normalOf(getFontSegmentDirection(segment, 0));
+        Vector2 toP = p - segment->p0;
+        if(dot(toP, direction) < 0){
+            f32 pseudo = cross(direction, toP) * orientation;
+            if(absoluteValue(pseudo) <= distance) signedDistance = pseudo;
+        }
+    }else if(t >= 1){
+        Vector2 direction = normalOf(getFontSegmentDirection(segment, 1));
+        Vector2 toP = p - getFontSegmentEnd(segment);
+        if(dot(toP, direction) > 0){
+            f32 pseudo = cross(direction, toP) * orientation;
+            if(absoluteValue(pseudo) <= distance) signedDistance = pseudo;
+        }
+    }
+    return signedDistance;
+}
+
+//control point box of the segment as min x, min y, max x, max y, which the curve never leaves
+static Vector4 getFontSegmentBounds(FontOutlineSegment* segment){
+    Vector2 end = getFontSegmentEnd(segment);
+    Vector4 bounds(fminf(segment->p0.x, end.x), fminf(segment->p0.y, end.y), fmaxf(segment->p0.x, end.x),
+                   fmaxf(segment->p0.y, end.y));
+    if(segment->type == FONT_SEGMENT_QUADRATIC){
+        bounds.x = fminf(bounds.x, segment->p1.x);
+        bounds.y = fminf(bounds.y, segment->p1.y);
+        bounds.z = fmaxf(bounds.z, segment->p1.x);
+        bounds.w = fmaxf(bounds.w, segment->p1.y);
+    }
+    return bounds;
+}
+
+//a lower bound on the squared distance from p to a segment inside bounds
+static f32 getFontBoundsDistanceSquared(Vector4 bounds, Vector2 p){
+    f32 dx = p.x < bounds.x ? bounds.x - p.x : p.x > bounds.z ? p.x - bounds.z : 0;
+    f32 dy = p.y < bounds.y ? bounds.y - p.y : p.y > bounds.w ? p.y - bounds.w : 0;
+    return dx * dx + dy * dy;
+}
+
+//Corners are where the direction turns by more than about 3 degrees. A contour without corners is white in every
+//channel, one corner splits its segments in three, and more corners switch color at each one so the two edges meeting
+//at a corner only share one channel.
+static void colorFontContourEdges(FontOutlineSegment* segments, u32 totalSegments){
+    const f32 cornerThreshold = 0.05f;
+    const u32 palette[3] = {FONT_CHANNEL_CYAN, FONT_CHANNEL_MAGENTA, FONT_CHANNEL_YELLOW};
+    u32 corners[FONT_ATLAS_MAX_SEGMENTS];
+    u32 totalCorners = 0;
+    for(u32 i = 0; i < totalSegments; i++){
+        FontOutlineSegment* previous = &segments[(i + totalSegments - 1) % totalSegments];
+        Vector2 a = normalOf(getFontSegmentDirection(previous, 1));
+        Vector2 b = normalOf(getFontSegmentDirection(&segments[i], 0));
+        if(dot(a, b) <= 0 || absoluteValue(cross(a, b)) > cornerThreshold){
+            corners[totalCorners++] = i;
+        }
+    }
+    if(!totalCorners || (totalCorners == 1 && totalSegments < 3)){
+        for(u32 i = 0; i < totalSegments; i++){
+            segments[i].channels = FONT_CHANNEL_WHITE;
+        }
+        return;
+    }
+    if(totalCorners == 1){
+        const u32 teardrop[3] = {FONT_CHANNEL_MAGENTA, FONT_CHANNEL_WHITE, FONT_CHANNEL_YELLOW};
+        for(u32 i = 0; i < totalSegments; i++){
+            segments[(corners[0] + i) % totalSegments].channels = teardrop[i * 3 / totalSegments];
+        }
+        return;
+    }
+    //with one spline over a multiple of three the last would match the first across the starting corner
+    u32 totalSplines = totalCorners;
+    u32 spline = 0;
+    for(u32 i = 0; i < totalSegments; i++){
+        u32 index = (corners[0] + i) % totalSegments;
+        if(spline + 1 < totalSplines && index == corners[spline + 1]){
+            spline++;
+        }
+        u32 color = palette[spline % 3];
+        if(spline == totalSplines - 1 && totalSplines % 3 == 1){
+            color = palette[1];
+        }
+        segments[index].channels = color;
+    }
+}
+
+//Copies an outline into dst, splitting quadratics at their vertical extremes so every segment crosses a scanline at
+//most once. dst needs room for twice the segments.
+static u32 prepareFontOutline(FontOutlineSegment* src, u32 totalSegments, FontOutlineSegment* dst){
+    u32 total = 0;
+    for(u32 i = 0; i < totalSegments; i++){
+        FontOutlineSegment segment = src[i];
+        if(segment.type == FONT_SEGMENT_QUADRATIC){
+            f32 denominator = segment.p0.y - 2 * segment.p1.y + segment.p2.y;
+            f32 t = denominator != 0 ? (segment.p0.y - segment.p1.y) / denominator : 0;
+            if(t > 0 && t < 1){
+                Vector2 a = segment.p0 + (segment.p1 - segment.p0) * t;
+                Vector2 b = segment.p1 + (segment.p2 - segment.p1) * t;
+                Vector2 middle = a + (b - a) * t;
+                FontOutlineSegment* first = &dst[total++];
+                *first = segment;
+                first->p1 = a;
+                first->p2 = middle;
+                segment.p0 = middle;
+                segment.p1 = b;
+            }
+        }
+        dst[total++] = segment;
+    }
+    return total;
+}
+
+//+1 when the outer contours wind counter clockwise, -1 for clockwise outlines like TrueType's
+static f32 getFontOutlineOrientation(FontOutlineSegment* segments, u32 totalSegments){
+    f32 area = 0;
+    for(u32 i = 0; i < totalSegments; i++){
+        FontOutlineSegment* segment = &segments[i];
+        if(segment->type == FONT_SEGMENT_QUADRATIC){
+            area += cross(segment->p0, segment->p1) + cross(segment->p1, segment->p2);
+        }else{
+            area += cross(segment->p0, segment->p1);
+        }
+    }
+    return area < 0 ? -1.0f : 1.0f;
+}
+
+//x of every crossing of the scanline at y with its winding direction folded into the sign bit of a second entry,
+//sorted by x. Ends follow a half open rule so a crossing shared by two segments counts once.
+static u32 findFontScanlineCrossings(FontOutlineSegment* segments, u32 totalSegments, f32 y, f32* crossings){
+    u32 total = 0;
+    for(u32 i = 0; i < totalSegments; i++){
+        FontOutlineSegment* segment = &segments[i];
+        Vector2 end = getFontSegmentEnd(segment);
+        bool upward = end.y > segment->p0.y;
+        f32 low = upward ? segment->p0.y : end.y;
+        f32 high = upward ? end.y : segment->p0.y;
+        if(y < low || y >= high) continue;
+        f32 x;
+        if(segment->type == FONT_SEGMENT_LINE){
+            x = segment->p0.x + (y - segment->p0.y) * (end.x - segment->p0.x) / (end.y - segment->p0.y);
+        }else{
+            f32 a = segment->p0.y - 2 * segment->p1.y + segment->p2.y;
+            f32 b = 2 * (segment->p1.y - segment->p0.y);
+            f32 c = segment->p0.y - y;
+            f32 t;
+            if(absoluteValue(a) < 1e-9f){
+                t = -c / b;
+            }else{
+                f32 root = sqrt(fmaxf(b * b - 4 * a * c, 0));
+                t = (-b + root) / (2 * a);
+                if(t < 0 || t > 1) t = (-b - root) / (2 * a);
+            }
+            x = getFontSegmentPoint(segment, clamp(t, 0, 1)).x;
+        }
+        u32 j = total;
+        for(; j > 0 && crossings[(j - 1) * 2] > x; j--){
+            crossings[j * 2] = crossings[(j - 1) * 2];
+            crossings[j * 2 + 1] = crossings[(j - 1) * 2 + 1];
+        }
+        crossings[j * 2] = x;
+        crossings[j * 2 + 1] = upward ? 1.0f : -1.0f;
+        total++;
+    }
+    return total;
+}
+
+static u8 encodeFontDistance(f32 distance, f32 scale){
+    return (u8)(clamp(distance * scale + 0.5f, 0, 1) * 255.0f + 0.5f);
+}
+
+static void generateFontGlyphField(FontAtlasJob* job, FontAtlasGlyph* glyph, GlyphRecord* record){
+    u32 width = record->atlasWidth;
+    u32 height = record->atlasHeight;
+    u32 channels = job->atlasChannels;
+    f32 texel = 1.0f / job->emSize;
+    //distances past half the range saturate, so nothing further than that needs finding
+    f32 limit = job->distanceRange * 0.5f * texel + texel;
+    f32 scale = job->emSize / job->distanceRange;
+    FontOutlineSegment* segments = glyph->segments;
+    Vector4* bounds = glyph->bounds;
+    u32* rowSegments = job->rowSegments;
+    u32* active = job->activeSegments;
+    for(u32 y = 0; y < height; y++){
+        f32 py = (glyph->top - y - 0.5f) * texel;
+        u32 totalCrossings = findFontScanlineCrossings(segments, glyph->totalSegments, py, job->crossings);
+        //Only segments within reach of the row can be nearest to one of its texels. Sorted by left edge they join the
+        //active set as the texels sweep right and leave it once they are out of reach behind.
+        u32 totalRowSegments = 0;
+        for(u32 i = 0; i < glyph->totalSegments; i++){
+            if(bounds[i].y - limit > py || bounds[i].w + limit < py) continue;
+            u32 j = totalRowSegments++;
+            for(; j > 0 && bounds[rowSegments[j - 1]].x > bounds[i].x; j--){
+                rowSegments[j] = rowSegments[j - 1];
+            }
+            rowSegments[j] = i;
+        }
+        u32 nextSegment = 0;
+        u32 totalActive = 0;
+        u32 crossing = 0;
+        s32 winding = 0;
+        u8* row = job->atlas + ((u64)(record->atlasY + y) * job->atlasWidth + record->atlasX) * channels;
+        for(u32 x = 0; x < width; x++){
+            Vector2 p((glyph->left + x + 0.5f) * texel, py);
+            while(crossing < totalCrossings && job->crossings[crossing * 2] < p.x){
+                winding += (s32)job->crossings[crossing * 2 + 1];
+                crossing++;
+            }
+            f32 inside = winding ? 1.0f : -1.0f;
+            while(nextSegment < totalRowSegments && bounds[rowSegments[nextSegment]].x - limit <= p.x){
+                active[totalActive++] = rowSegments[nextSegment++];
+            }
+            for(u32 i = 0; i < totalActive;){
+                if(bounds[active[i]].z + limit < p.x){
+                    active[i] = active[--totalActive];
+                }else{
+                    i++;
+                }
+            }
+
+            f32 nearest = limit;
+            f32 channelDistance[3] = {limit, limit, limit};
+            f32 channelAlignment[3] = {1, 1, 1};
+            FontOutlineSegment* channelSegment[3] = {};
+            f32 channelT[3] = {};
+            for(u32 i = 0; i < totalActive; i++){
+                FontOutlineSegment* segment = &segments[active[i]];
+                f32 reach = nearest;
+                if(channels == 4){
+                    for(u32 c = 0; c < 3; c++){
+                        if(channelDistance[c] > reach) reach = channelDistance[c];
+                    }
+                }
+                if(getFontBoundsDistanceSquared(bounds[active[i]], p) > reach * reach) continue;
+                f32 t;
+                f32 alignment;
+                f32 distance = getFontSegmentDistance(segment, p, &t, channels == 4 ? &alignment : 0);
+                if(distance < nearest) nearest = distance;
+                if(channels != 4) continue;
+                for(u32 c = 0; c < 3; c++){
+                    if(!(segment->channels & (1 << c))) continue;
+                    if(distance < channelDistance[c] - 1e-7f ||
+                       (distance <= channelDistance[c] + 1e-7f && alignment < channelAlignment[c])){
+                        channelDistance[c] = distance;
+                        channelAlignment[c] = alignment;
+                        channelSegment[c] = segment;
+                        channelT[c] = t;
+                    }
+                }
+            }
+            f32 trueDistance = nearest * inside;
+            if(channels != 4){
+                row[x] = encodeFontDistance(trueDistance, scale);
+                continue;
+            }
+            f32 field[3];
+            for(u32 c = 0; c < 3; c++){
+                field[c] = channelSegment[c] ?
+                           getFontSegmentPseudoDistance(channelSegment[c], p, channelT[c], glyph->orientation) :
+                           trueDistance;
+            }
+            //where the channels disagree with the winding test the median would open a hole, fall back to the
+            //true distance for that texel
+            f32 median = fmaxf(fminf(field[0], field[1]), fminf(fmaxf(field[0], field[1]), field[2]));
+            if((median > 0) != (inside > 0)){
+                field[0] = field[1] = field[2] = trueDistance;
+            }
+            u8* out = row + x * 4;
+            out[0] = encodeFontDistance(field[0], scale);
+            out[1] = encodeFontDistance(field[1], scale);
+            out[2] = encodeFontDistance(field[2], scale);
+            out[3] = encodeFontDistance(trueDistance, scale);
+        }
+    }
+}
+
+static void generateFontAtlasJob(void* data){
+    FontAtlasJob* job = (FontAtlasJob*)data;
+    for(u32 i = job->firstGlyph; i < job->totalGlyphs; i += job->glyphStride){
+        u32 index = job->order[i];
+        if(job->glyphs[index].totalSegments){
+            generateFontGlyphField(job, &job->glyphs[index], &job->records[index]);
+        }
+    }
+}
+
+//Builds the atlas for every codepoint the font has into out and returns the size written, 0 when the glyphs do not
+//fit in atlasWidth x maxAtlasHeight or out is too small. The atlas height is trimmed to what the glyphs use.
+static u32 buildFontAtlas(FontAtlasSettings* settings, u32* codepoints, u32 totalCodepoints,
+                          bool (*getGlyphOutline)(void* userData, u32 codepoint, FontOutlineSegment* segments, u32 capacity,
+                                                  u32* totalSegments, f32* advance),
+                          void* userData, void* out, u32 outCapacity, MemoryArena* scratch, OSInterface* os = 0,
+                          WorkQueue* queue = 0){
+    if(totalCodepoints > GLYPH_MAX_GLYPHS){
+        return 0;
+    }
+    u64 scratchMark = scratch->used;
+    FontOutlineSegment* outline = pushArray(scratch, FontOutlineSegment, FONT_ATLAS_MAX_SEGMENTS);
+    FontAtlasGlyph* glyphs = pushArray(scratch, FontAtlasGlyph, totalCodepoints);
+    GlyphRecord* records = pushArray(scratch, GlyphRecord, totalCodepoints);
+    f32* heights = pushArray(scratch, f32, totalCodepoints);
+    u32* order = pushArray(scratch, u32, totalCodepoints);
+    SkylinePacker packer;
+    if(!outline || !glyphs || !records || !heights || !order ||
+       !initializeSkylinePacker(&packer, settings->atlasWidth, settings->maxAtlasHeight, scratch)){
+        scratch->used = scratchMark;
+        return 0;
+    }
+
+    f32 padding = settings->distanceRange * 0.5f + 1;
+    u32 totalGlyphs = 0;
+    u32 maxSegments = 1;
+    for(u32 i = 0; i < totalCodepoints; i++){
+        u32 totalSegments = 0;
+        f32 advance = 0;
+        if(!getGlyphOutline(userData, codepoints[i], outline, FONT_ATLAS_MAX_SEGMENTS, &totalSegments, &advance)){
+            continue;
+        }
+        FontAtlasGlyph* glyph = &glyphs[totalGlyphs];
+        GlyphRecord* record = &records[totalGlyphs];
+        setMemory(glyph, sizeof(FontAtlasGlyph));
+        setMemory(record, sizeof(GlyphRecord));
+        record->codepoint = codepoints[i];
+        record->advance = advance * settings->emSize;
+        if(totalSegments){
+            glyph->segments = pushArray(scratch, FontOutlineSegment, totalSegments * 2);
+            glyph->bounds = pushArray(scratch, Vector4, totalSegments * 2);
+            if(!glyph->segments || !glyph->bounds){
+                scratch->used = scratchMark;
+                return 0;
+            }
+            for(u32 first = 0; first < totalSegments;){
+                u32 end = first + 1;
+                while(end < totalSegments && outline[end].contour == outline[first].contour) end++;
+                colorFontContourEdges(outline + first, end - first);
+                first = end;
+            }
+            glyph->totalSegments = prepareFontOutline(outline, totalSegments, glyph->segments);
+            glyph->orientation = getFontOutlineOrientation(glyph->segments, glyph->totalSegments);
+            if(glyph->totalSegments > maxSegments) maxSegments = glyph->totalSegments;
+
+            Vector2 minimum(MAX_F32);
+            Vector2 maximum(-MAX_F32);
+            for(u32 s = 0; s < glyph->totalSegments; s++){
+                Vector4 bounds = getFontSegmentBounds(&glyph->segments[s]);
+                glyph->bounds[s] = bounds;
+                minimum.x = fminf(minimum.x, bounds.x);
+                minimum.y = fminf(minimum.y, bounds.y);
+                maximum.x = fmaxf(maximum.x, bounds.z);
+                maximum.y = fmaxf(maximum.y, bounds.w);
+            }
+            glyph->left = floorf(minimum.x * settings->emSize - padding);
+            glyph->top = ceilf(maximum.y * settings->emSize + padding);
+            record->width = ceilf(maximum.x * settings->emSize + padding) - glyph->left;
+            record->height = glyph->top - floorf(minimum.y * settings->emSize - padding);
+            record->xOffset = glyph->left;
+            record->yOffset = settings->ascender * settings->emSize - glyph->top;
+        }
+        heights[totalGlyphs] = record->height;
+        order[totalGlyphs] = totalGlyphs;
+        totalGlyphs++;
+    }
+
+    //tallest first packs the skyline tighter
+    if(totalGlyphs) sortIndicesByKeyDescending(order, heights, 0, totalGlyphs - 1);
+    u32 atlasHeight = 0;
+    for(u32 i = 0; i < totalGlyphs; i++){
+        GlyphRecord* record = &records[order[i]];
+        if(!record->width) continue;
+        u32 x;
+        u32 y;
+        if(!packSkylineRect(&packer, (u32)record->width + GLYPH_ATLAS_PADDING, (u32)record->height + GLYPH_ATLAS_PADDING,
+                            &x, &y)){
+            scratch->used = scratchMark;
+            return 0;
+        }
+        record->atlasX = (u16)x;
+        record->atlasY = (u16)y;
+        record->atlasWidth = (u16)record->width;
+        record->atlasHeight = (u16)record->height;
+        if(y + (u32)record->height > atlasHeight) atlasHeight = y + (u32)record->height;
+    }
+    atlasHeight = (atlasHeight + 3) & ~3;
+
+    u32 channels = settings->multiChannel ? 4 : 1;
+    u64 atlasSize = (u64)settings->atlasWidth * atlasHeight * channels;
+    u64 size = sizeof(FontAtlasHeader) + sizeof(GlyphRecord) * totalGlyphs + atlasSize;
+    if(size > outCapacity){
+        scratch->used = scratchMark;
+        return 0;
+    }
+    FontAtlasHeader* header = (FontAtlasHeader*)out;
+    setMemory(header, sizeof(FontAtlasHeader));
+    header->magic = FONT_ATLAS_MAGIC;
+    header->version = FONT_ATLAS_VERSION;
+    header->atlasWidth = settings->atlasWidth;
+    header->atlasHeight = atlasHeight;
+    header->atlasChannels = channels;
+    header->totalGlyphs = totalGlyphs;
+    header->missingCodepoint = settings->missingCodepoint;
+    header->emSize = settings->emSize;
+    header->distanceRange = settings->distanceRange;
+    header->lineHeight = settings->lineHeight * settings->emSize;
+    copyMemory(header + 1, records, sizeof(GlyphRecord) * totalGlyphs);
+    u8* atlas = (u8*)(header + 1) + sizeof(GlyphRecord) * totalGlyphs;
+    setMemory(atlas, (u32)atlasSize);
+
+    FontAtlasJob base = {};
+    base.glyphs = glyphs;
+    base.records = records;
+    base.order = order;
+    base.atlas = atlas;
+    base.totalGlyphs = totalGlyphs;
+    base.atlasWidth = settings->atlasWidth;
+    base.atlasChannels = channels;
+    base.emSize = settings->emSize;
+    base.distanceRange = settings->distanceRange;
+    base.glyphStride = 1;
+
+    //jobs take every totalJobs-th glyph of the tallest first order so each gets a similar mix of sizes
+    FontAtlasJob jobs[WorkQueue::MAX_ENTRIES - 1];
+    u32 totalJobs = 1;
+    if(os && queue){
+        totalJobs = totalGlyphs < WorkQueue::MAX_ENTRIES - 1 ? totalGlyphs : WorkQueue::MAX_ENTRIES - 1;
+        if(!totalJobs) totalJobs = 1;
+    }
+    for(u32 i = 0; i < totalJobs; i++){
+        jobs[i] = base;
+        jobs[i].firstGlyph = i;
+        jobs[i].glyphStride = totalJobs;
+        jobs[i].crossings = pushArray(scratch, f32, maxSegments * 2);
+        jobs[i].rowSegments = pushArray(scratch, u32, maxSegments);
+        jobs[i].activeSegments = pushArray(scratch, u32, maxSegments);
+        if(!jobs[i].crossings || !jobs[i].rowSegments || !jobs[i].activeSegments){
+            scratch->used = scratchMark;
+            return 0;
+        }
+    }
+    if(os && queue){
+        for(u32 i = 0; i < totalJobs; i++){
+            os->addWorkQueueEntry(queue, generateFontAtlasJob, &jobs[i]);
+        }
+        os->completeWorkQueueEntries(queue);
+    }else{
+        generateFontAtlasJob(&jobs[0]);
+    }
+    scratch->used = scratchMark;
+    return (u32)size;
+}
+
+//Fills cache with every glyph of a built atlas. The cache never rasterizes or evicts; codepoints missing from the
+//atlas draw as missingCodepoint. Metrics are in pixels at emSize, draw at scale size / emSize.
+static bool loadFontAtlas(GlyphCache* cache, void* data, u32 dataSize, MemoryArena* arena){
+    FontAtlasHeader* header = (FontAtlasHeader*)data;
+    if(dataSize < sizeof(FontAtlasHeader) || header->magic != FONT_ATLAS_MAGIC || header->version != FONT_ATLAS_VERSION ||
+       header->totalGlyphs > GLYPH_MAX_GLYPHS || (header->atlasChannels != 1 && header->atlasChannels != 4)){
+        return false;
+    }
+    u64 atlasSize = (u64)header->atlasWidth * header->atlasHeight * header->atlasChannels;
+    if(dataSize != sizeof(FontAtlasHeader) + sizeof(GlyphRecord) * header->totalGlyphs + atlasSize){
+        return false;
+    }
+    cache->atlas = (u8*)pushSize(arena, atlasSize);
+    if(!cache->atlas || !initializeSkylinePacker(&cache->packer, header->atlasWidth, header->atlasHeight, arena)){
+        return false;
+    }
+    GlyphRecord* records = (GlyphRecord*)(header + 1);
+    copyMemory(cache->atlas, records + header->totalGlyphs, atlasSize);
+    cache->atlasWidth = header->atlasWidth;
+    cache->atlasHeight = header->atlasHeight;
+    cache->atlasChannels = header->atlasChannels;
+    cache->distanceRange = header->distanceRange;
+    cache->lineHeight = header->lineHeight;
+    cache->missingCodepoint = header->missingCodepoint;
+    cache->measureGlyph = 0;
+    cache->rasterizeGlyph = 0;
+    cache->kernGlyphs = 0;
+    cache->userData = 0;
+    cache->atlasTexture = {};
+    cache->atlasGeneration = 0;
+    for(u32 i = 0; i < GLYPH_DIRECT_RANGE; i++){
+        cache->direct[i] = GLYPH_NONE;
+    }
+    setMemory(cache->hashKeys, sizeof(cache->hashKeys));
+    cache->totalHashEntries = 0;
+    copyMemory(cache->records, records, sizeof(GlyphRecord) * header->totalGlyphs);
+    cache->totalRecords = header->totalGlyphs;
+    for(u32 i = 0; i < cache->totalRecords; i++){
+        mapGlyph(cache, cache->records[i].codepoint, (u16)i);
+    }
+    cache->dirtyMinY = 0;
+    cache->dirtyMaxY = cache->atlasHeight;
+    return true;
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include "render_backend.h"
+
+//Frame pacing with several frames in flight.
+//Frame n signals the pacer's fence with n + 1 and records into command allocator n % framesInFlight.
+//beginRenderFrame only waits for the frame that last used that allocator, so the CPU runs up to framesInFlight frames
+//ahead of the GPU instead of waiting for every frame to finish. It waits on the swap chain first, so the present at
+//the end of the frame does not block. Memory a frame writes from the CPU comes from an UploadRing, handed back once
+//the fence reaches the frame's value: completedFrames is the fence value as of beginRenderFrame, and the frame being
+//recorded signals frameNumber + 1.
+//Every frame's list is bracketed with GPU timestamps. Once a frame's fence completes its GPU start and end are
+//read back, giving exact GPU busy time, the time the GPU sat idle waiting for the CPU, and the latency from
+//beginRenderFrame returning (when the caller samples input) to the GPU finishing the frame, the earliest it can be
+//presented.
+//Low latency mode holds beginRenderFrame back until the frame can be recorded and submitted just as the GPU finishes
+//the previous one: from those timestamps it predicts when the GPU will go idle and starts the frame one CPU frame
+//time plus the submission delay earlier. Whatever targetLatency leaves above that shortest latency is spent starting
+//earlier still, as slack against CPU time jitter; a target of 0 asks for the shortest.
+//Lists recorded elsewhere, on worker threads for instance, join the frame through addRenderFrameLists. The frame is
+//submitted as one batch: the pacer's list, the added lists in the order they were added, then a closing list that
+//returns the back buffer to the present state, so the added lists run while it is the render target.
+//The pacer owns timestamps 0 to 2 * RENDER_MAX_FRAMES_IN_FLIGHT - 1.
+
+#define FRAME_PACING_ESTIMATE_WEIGHT 0.125f
+#define FRAME_PACING_MAX_LISTS 32
+
+struct FramePacingStats {
+    u64 frames;
+    u64 cpuWaitTime;
+    u64 presentWaitTime;
+    u64 lowLatencySleepTime;
+    u64 gpuBusyTime;
+    u64 gpuIdleTime;
+    u64 totalLatency;
+    u64 maxLatency;
+    u64 lastLatency;
+};
+
+struct FramePacer {
+    RenderBackend* backend;
+    RenderCommandList commandList;
+    RenderCommandList closingList;
+    RenderCommandList* frameLists[FRAME_PACING_MAX_LISTS];
+    u32 totalFrameLists;
+    RenderFence fence;
+    RenderResource* backBuffer;
+    u64 frameStarts[RENDER_MAX_FRAMES_IN_FLIGHT];
+    u64 submitTimes[RENDER_MAX_FRAMES_IN_FLIGHT];
+    u64 frameNumber;
+    u64 completedFrames;
+    u64 lastGpuEnd;
+    u64 targetLatency;
+    f32 cpuEstimate;
+    f32 gpuEstimate;
+    f32 submitDelayEstimate;
+    u32 framesInFlight;
+    u32 frameSlot;
+    u32 syncInterval;
+    bool lowLatency;
+    FramePacingStats stats;
+};
+
+static bool initializeFramePacer(FramePacer* pacer, RenderBackend* backend, u32 framesInFlight){
+    setMemory(pacer, sizeof(FramePacer));
+    if(!framesInFlight || framesInFlight > RENDER_MAX_FRAMES_IN_FLIGHT){
+        return false;
+    }
+    pacer->backend = backend;
+    pacer->framesInFlight = framesInFlight;
+    pacer->syncInterval = 1;
+    if(!backend->createCommandList(backend, RENDER_QUEUE_DIRECT, &pacer->commandList) ||
+       !backend->createCommandList(backend, RENDER_QUEUE_DIRECT, &pacer->closingList) ||
+       !backend->createFence(backend, 0, &pacer->fence)){
+        return false;
+    }
+    backend->setMaximumFrameLatency(backend, framesInFlight);
+    return true;
+}
+
+//a target of 0 asks for the shortest latency possible
+static void setFramePacerLowLatency(FramePacer* pacer, bool enabled, u64 targetLatency){
+    pacer->lowLatency = enabled;
+    pacer->targetLatency = targetLatency;
+}
+
+static f32 updateFramePacingEstimate(FramePacer* pacer, f32 estimate, f32 sample){
+    if(!pacer->stats.frames){
+        return sample;
+    }
+    return estimate + (sample - estimate) * FRAME_PACING_ESTIMATE_WEIGHT;
+}
+
+//reads back the gpu timing of every frame the fence says is done
+static void retireFramePacerFrames(FramePacer* pacer){
+    RenderBackend* backend = pacer->backend;
+    u64 completed = backend->getCompletedFenceValue(backend, &pacer->fence);
+    while(pacer->completedFrames < completed){
+        u32 slot = (u32)(pacer->completedFrames % pacer->framesInFlight);
+        u64 gpuStart = backend->readTimestamp(backend, slot * 2);
+        u64 gpuEnd = backend->readTimestamp(backend, slot * 2 + 1);
+        FramePacingStats* stats = &pacer->stats;
+        stats->gpuBusyTime += gpuEnd - gpuStart;
+        //a frame that did not queue behind the previous one shows how long submission takes to reach the gpu
+        if(!stats->frames || gpuStart > pacer->lastGpuEnd){
+            if(stats->frames){
+                stats->gpuIdleTime += gpuStart - pacer->lastGpuEnd;
+            }
+            u64 submit = pacer->submitTimes[slot];
+            pacer->submitDelayEstimate = updateFramePacingEstimate(pacer, pacer->submitDelayEstimate,
+                                                                   gpuStart > submit ? (f32)(gpuStart - submit) : 0);
+        }
+        pacer->gpuEstimate = updateFramePacingEstimate(pacer, pacer->gpuEstimate, (f32)(gpuEnd - gpuStart));
+        u64 frameStart = pacer->frameStarts[slot];
+        stats->lastLatency = gpuEnd > frameStart ? gpuEnd - frameStart : 0;
+        stats->totalLatency += stats->lastLatency;
+        if(stats->lastLatency > stats->maxLatency){
+            stats->maxLatency = stats->lastLatency;
+        }
+        pacer->lastGpuEnd = gpuEnd;
+        pacer->completedFrames++;
+        stats->frames++;
+    }
+}
+
+static void waitForFramePacerFrame(FramePacer* pacer, u64 frame){
+    RenderBackend* backend = pacer->backend;
+    if(backend->getCompletedFenceValue(backend, &pacer->fence) <= frame){
+        u64 start = backend->getMicroseconds(backend);
+        backend->waitForFence(backend, &pacer->fence, frame + 1);
+        pacer->stats.cpuWaitTime += backend->getMicroseconds(backend) - start;
+    }
+    retireFramePacerFrames(pacer);
+}
+
+//waits for every frame submitted so far, for when gpu resources in use are about to be released
+static void flushFramePacer(FramePacer* pacer){
+    if(pacer->frameNumber){
+        waitForFramePacerFrame(pacer, pacer->frameNumber - 1);
+    }
+}
+
+//sleeps until the frame can be recorded and submitted as the gpu finishes the previous one
+static void delayFramePacerStart(FramePacer* pacer){
+    RenderBackend* backend = pacer->backend;
+    u64 frameNumber = pacer->frameNumber;
+    if(frameNumber >= 2){
+        waitForFramePacerFrame(pacer, frameNumber - 2);
+    }
+    if(pacer->completedFrames == frameNumber){
+        return;
+    }
+    u32 previous = (u32)((frameNumber - 1) % pacer->framesInFlight);
+    f32 gpuStart = (f32)pacer->submitTimes[previous] + pacer->submitDelayEstimate;
+    if(gpuStart < (f32)pacer->lastGpuEnd){
+        gpuStart = (f32)pacer->lastGpuEnd;
+    }
+    f32 shortest = pacer->cpuEstimate + pacer->submitDelayEstimate + pacer->gpuEstimate;
+    f32 slack = (f32)pacer->targetLatency - shortest;
+    if(slack < 0){
+        slack = 0;
+    }
+    f32 wake = gpuStart + pacer->gpuEstimate - pacer->submitDelayEstimate - pacer->cpuEstimate - slack;
+    u64 now = backend->getMicroseconds(backend);
+    if(wake > (f32)now){
+        u64 sleep = (u64)(wake - (f32)now);
+        backend->sleepMicroseconds(backend, sleep);
+        pacer->stats.lowLatencySleepTime += backend->getMicroseconds(backend) - now;
+    }
+}
+
+//resets the frame's allocator and leaves the back buffer bound as the render target over the whole viewport
+static RenderCommandList* beginRenderFrame(FramePacer* pacer, RenderPipeline* pipeline){
+    RenderBackend* backend = pacer->backend;
+    RenderCommandList* list = &pacer->commandList;
+    u64 start = backend->getMicroseconds(backend);
+    backend->waitForPresent(backend);
+    u64 presentWait = backend->getMicroseconds(backend) - start;
+    pacer->stats.presentWaitTime += presentWait;
+    pacer->stats.cpuWaitTime += presentWait;
+
+    if(pacer->frameNumber >= pacer->framesInFlight){
+        waitForFramePacerFrame(pacer, pacer->frameNumber - pacer->framesInFlight);
+    }else{
+        retireFramePacerFrames(pacer);
+    }
+    if(pacer->lowLatency){
+        delayFramePacerStart(pacer);
+    }
+
+    pacer->frameSlot = (u32)(pacer->frameNumber % pacer->framesInFlight);
+    pacer->totalFrameLists = 0;
+    pacer->frameStarts[pacer->frameSlot] = backend->getMicroseconds(backend);
+    pacer->backBuffer = backend->getBackBuffer(backend, backend->getCurrentBackBufferIndex(backend));
+    backend->resetCommandList(list, pacer->frameSlot, pipeline);
+    backend->writeTimestamp(list, pacer->frameSlot * 2);
+    backend->transitionResource(list, pacer->backBuffer, RENDER_STATE_PRESENT, RENDER_STATE_RENDER_TARGET);
+    backend->setViewport(list, 0, 0, (f32)backend->width, (f32)backend->height);
+    backend->setRenderTarget(list, pacer->backBuffer);
+    return list;
+}
+
+//closed lists for the direct queue, recorded with the frame's allocator slot; false when the frame has no room left
+static bool addRenderFrameLists(FramePacer* pacer, RenderCommandList* lists, u32 totalLists){
+    if(pacer->totalFrameLists + totalLists > FRAME_PACING_MAX_LISTS){
+        return false;
+    }
+    for(u32 i = 0; i < totalLists; i++){
+        pacer->frameLists[pacer->totalFrameLists++] = &lists[i];
+    }
+    return true;
+}
+
+//submits and presents without waiting for the gpu
+static void endRenderFrame(FramePacer* pacer){
+    RenderBackend* backend = pacer->backend;
+    RenderCommandList* lists[FRAME_PACING_MAX_LISTS + 2];
+    u32 totalLists = 0;
+    u32 slot = pacer->frameSlot;
+    RenderCommandList* list = &pacer->commandList;
+    lists[totalLists++] = list;
+    //without added lists the frame closes on its own list and goes out as a single list
+    if(pacer->totalFrameLists){
+        backend->closeCommandList(list);
+        for(u32 i = 0; i < pacer->totalFrameLists; i++){
+            lists[totalLists++] = pacer->frameLists[i];
+        }
+        list = &pacer->closingList;
+        lists[totalLists++] = list;
+        backend->resetCommandList(list, slot, 0);
+    }
+    backend->transitionResource(list, pacer->backBuffer, RENDER_STATE_RENDER_TARGET, RENDER_STATE_PRESENT);
+    backend->writeTimestamp(list, slot * 2 + 1);
+    backend->closeCommandList(list);
+    backend->executeCommandLists(backend, lists, totalLists);
+    pacer->submitTimes[slot] = backend->getMicroseconds(backend);
+    pacer->cpuEstimate = updateFramePacingEstimate(pacer, pacer->cpuEstimate,
+                                                   (f32)(pacer->submitTimes[slot] - pacer->frameStarts[slot]));
+    backend->present(backend, pacer->syncInterval);
+    backend->signalFence(backend, RENDER_QUEUE_DIRECT, &pacer->fence, pacer->frameNumber + 1);
+    pacer->frameNumber++;
+}
@@ -0,0 +1,401 @@
+#pragma once
+
+#include "os_interface.h"
+
+//Glyph cache for Unicode text.
+//Every glyph's metrics and atlas rectangle sit in one 32 byte GlyphRecord. Codepoints below GLYPH_DIRECT_RANGE
+//(ASCII and Latin-1) index a direct table, and everything else goes through a small open addressing hash. Glyphs are
+//rasterized on first use by the platform callbacks into an R8 atlas packed with a skyline bottom-left packer.
+//When the atlas or the record table is full the cache starts over empty and bumps atlasGeneration, so anything
+//holding atlas coordinates (laid out text) knows to rebuild. flushGlyphAtlas uploads the dirty part of the atlas.
+//   measureGlyph   -> fills width, height, xOffset, yOffset and advance in pixels, false if the font lacks it
+//   rasterizeGlyph -> writes width x height coverage bytes at pixels, rows pitch bytes apart
+//   kernGlyphs     -> optional, pixels to add to the advance between two codepoints
+//A cache filled by loadFontAtlas from a prebuilt distance field atlas has no callbacks and holds every glyph up front;
+//atlasChannels is 4 for multi channel fields and distanceRange, 0 for coverage, tells the shader how to read it.
+
+#define GLYPH_DIRECT_RANGE 256
+#define GLYPH_MAX_GLYPHS 8192
+#define GLYPH_HASH_BITS 14
+#define GLYPH_HASH_CAPACITY (1 << GLYPH_HASH_BITS)
+#define GLYPH_NONE 0xFFFF
+#define GLYPH_ATLAS_PADDING 1
+
+struct GlyphRecord {
+    f32 width;
+    f32 height;
+    f32 xOffset;
+    f32 yOffset;
+    f32 advance;
+    u16 atlasX;
+    u16 atlasY;
+    u16 atlasWidth;
+    u16 atlasHeight;
+    u32 codepoint;
+};
+
+struct SkylineNode {
+    u16 x;
+    u16 y;
+    u16 width;
+};
+
+//nodes holds width + 1 entries, enough for one node per column plus the split
+struct SkylinePacker {
+    SkylineNode* nodes;
+    u32 totalNodes;
+    u32 width;
+    u32 height;
+};
+
+struct GlyphCache {
+    GlyphRecord records[GLYPH_MAX_GLYPHS];
+    u16 direct[GLYPH_DIRECT_RANGE];
+    u32 hashKeys[GLYPH_HASH_CAPACITY];
+    u16 hashValues[GLYPH_HASH_CAPACITY];
+
+    bool (*measureGlyph)(void* userData, u32 codepoint, GlyphRecord* metrics);
+    void (*rasterizeGlyph)(void* userData, u32 codepoint, u8* pixels, u32 pitch);
+    f32 (*kernGlyphs)(void* userData, u32 left, u32 right);
+    void* userData;
+
+    u8* atlas;
+    SkylinePacker packer;
+    Texture2D atlasTexture;
+    u32 atlasWidth;
+    u32 atlasHeight;
+    u32 dirtyMinY;
+    u32 dirtyMaxY;
+
+    u32 totalRecords;
+    u32 totalHashEntries;
+    u32 missingCodepoint;
+    u32 atlasGeneration;
+    u32 atlasChannels;
+    f32 distanceRange;
+    f32 lineHeight;
+};
+
+static void resetSkylinePacker(SkylinePacker* packer){
+    packer->nodes[0].x = 0;
+    packer->nodes[0].y = 0;
+    packer->nodes[0].width = (u16)packer->width;
+    packer->totalNodes = 1;
+}
+
+//dimensions are at most 65535
+static bool initializeSkylinePacker(SkylinePacker* packer, u32 width, u32 height, MemoryArena* arena){
+    if(width > 0xFFFF || height > 0xFFFF){
+        return false;
+    }
+    packer->nodes = pushArray(arena, SkylineNode, width + 1);
+    packer->width = width;
+    packer->height = height;
+    if(!packer->nodes){
+        return false;
+    }
+    resetSkylinePacker(packer);
+    return true;
+}
+
+//lowest y a width wide rectangle can sit at when its left edge is at node index, MAX_U32 if it does not fit
+static u32 fitSkyline(SkylinePacker* packer, u32 index, u32 width, u32 height){
+    u32 x = packer->nodes[index].x;
+    if(x + width > packer->width){
+        return MAX_U32;
+    }
+    u32 y = 0;
+    u32 remaining = width;
+    for(u32 i = index; remaining; i++){
+        SkylineNode* node = &packer->nodes[i];
+        if(node->y > y) y = node->y;
+        if(y + height > packer->height){
+            return MAX_U32;
+        }
+        remaining = node->width >= remaining ? 0 : remaining - node->width;
+    }
+    return y;
+}
+
+//bottom left: the placement with the lowest top edge wins, then the one wasting the narrowest node
+static bool packSkylineRect(SkylinePacker* packer, u32 width, u32 height, u32* outX, u32* outY){
+    u32 bestIndex = MAX_U32;
+    u32 bestY = MAX_U32;
+    u32 bestWidth = MAX_U32;
+    for(u32 i = 0; i < packer->totalNodes; i++){
+        u32 y = fitSkyline(packer, i, width, height);
+        if(y == MAX_U32) continue;
+        if(y + height < bestY || (y + height == bestY && packer->nodes[i].width < bestWidth)){
+            bestIndex = i;
+            bestY = y + height;
+            bestWidth = packer->nodes[i].width;
+        }
+    }
+    if(bestIndex == MAX_U32){
+        return false;
+    }
+
+    u32 x = packer->nodes[bestIndex].x;
+    *outX = x;
+    *outY = bestY - height;
+    for(u32 i = packer->totalNodes; i > bestIndex; i--){
+        packer->nodes[i] = packer->nodes[i - 1];
+    }
+    packer->nodes[bestIndex].x = (u16)x;
+    packer->nodes[bestIndex].y = (u16)bestY;
+    packer->nodes[bestIndex].width = (u16)width;
+    packer->totalNodes++;
+
+    //trim or drop the nodes the new one now covers
+    u32 end = x + width;
+    u32 i = bestIndex + 1;
+    while(i < packer->totalNodes && packer->nodes[i].x < end){
+        SkylineNode* node = &packer->nodes[i];
+        u32 nodeEnd = node->x + node->width;
+        if(nodeEnd <= end){
+            for(u32 j = i; j + 1 < packer->totalNodes; j++){
+                packer->nodes[j] = packer->nodes[j + 1];
+            }
+            packer->totalNodes--;
+        }else{
+            node->width = (u16)(nodeEnd - end);
+            node->x = (u16)end;
+            break;
+        }
+    }
+    for(u32 j = 0; j + 1 < packer->totalNodes;){
+        if(packer->nodes[j].y == packer->nodes[j + 1].y){
+            packer->nodes[j].width += packer->nodes[j + 1].width;
+            for(u32 k = j + 1; k + 1 < packer->totalNodes; k++){
+                packer->nodes[k] = packer->nodes[k + 1];
+            }
+            packer->totalNodes--;
+        }else{
+            j++;
+        }
+    }
+    return true;
+}
+
+static void resetGlyphCache(GlyphCache* cache){
+    for(u32 i = 0; i < GLYPH_DIRECT_RANGE; i++){
+        cache->direct[i] = GLYPH_NONE;
+    }
+    setMemory(cache->hashKeys, sizeof(cache->hashKeys));
+    setMemory(cache->atlas, cache->atlasWidth * cache->atlasHeight * cache->atlasChannels);
+    resetSkylinePacker(&cache->packer);
+    cache->totalRecords = 0;
+    cache->totalHashEntries = 0;
+    cache->dirtyMinY = 0;
+    cache->dirtyMaxY = cache->atlasHeight;
+    cache->atlasGeneration++;
+}
+
+//atlas dimensions are at most 65535. missingCodepoint is drawn in place of glyphs the font does not have.
+static bool initializeGlyphCache(GlyphCache* cache, u32 atlasWidth, u32 atlasHeight, f32 lineHeight,
+                                 bool (*measureGlyph)(void*, u32, GlyphRecord*), void (*rasterizeGlyph)(void*, u32, u8*, u32),
+                                 void* userData, MemoryArena* arena, u32 missingCodepoint = '?'){
+    cache->atlas = (u8*)pushSize(arena, (u64)atlasWidth * atlasHeight);
+    if(!cache->atlas || !initializeSkylinePacker(&cache->packer, atlasWidth, atlasHeight, arena)){
+        return false;
+    }
+    cache->atlasWidth = atlasWidth;
+    cache->atlasHeight = atlasHeight;
+    cache->measureGlyph = measureGlyph;
+    cache->rasterizeGlyph = rasterizeGlyph;
+    cache->kernGlyphs = 0;
+    cache->userData = userData;
+    cache->missingCodepoint = missingCodepoint;
+    cache->lineHeight = lineHeight;
+    cache->atlasTexture = {};
+    cache->atlasGeneration = 0;
+    cache->atlasChannels = 1;
+    cache->distanceRange = 0;
+    resetGlyphCache(cache);
+    return true;
+}
+
+static u32 hashCodepoint(u32 codepoint){
+    return (codepoint * 2654435761u) >> (32 - GLYPH_HASH_BITS);
+}
+
+//a full hash leaves the codepoint unmapped, it is measured again on its next use
+static void mapGlyph(GlyphCache* cache, u32 codepoint, u16 index){
+    if(codepoint < GLYPH_DIRECT_RANGE){
+        cache->direct[codepoint] = index;
+        return;
+    }
+    if(cache->totalHashEntries >= GLYPH_HASH_CAPACITY - GLYPH_HASH_CAPACITY / 4){
+        return;
+    }
+    cache->totalHashEntries++;
+    for(u32 i = hashCodepoint(codepoint) & (GLYPH_HASH_CAPACITY - 1);; i = (i + 1) & (GLYPH_HASH_CAPACITY - 1)){
+        if(!cache->hashKeys[i]){
+            cache->hashKeys[i] = codepoint + 1;
+            cache->hashValues[i] = index;
+            return;
+        }
+    }
+}
+
+static u16 findGlyph(GlyphCache* cache, u32 codepoint){
+    if(codepoint < GLYPH_DIRECT_RANGE){
+        return cache->direct[codepoint];
+    }
+    u32 key = codepoint + 1;
+    for(u32 i = hashCodepoint(codepoint) & (GLYPH_HASH_CAPACITY - 1);; i = (i + 1) & (GLYPH_HASH_CAPACITY - 1)){
+        if(cache->hashKeys[i] == key) return cache->hashValues[i];
+        if(!cache->hashKeys[i]) return GLYPH_NONE;
+    }
+}
+
+//measures, packs and rasterizes a glyph that is not cached yet. Returns GLYPH_NONE only when the font lacks it.
+static u16 addGlyph(GlyphCache* cache, u32 codepoint){
+    GlyphRecord metrics = {};
+    if(!cache->measureGlyph || !cache->measureGlyph(cache->userData, codepoint, &metrics)){
+        return GLYPH_NONE;
+    }
+    u32 width = (u32)metrics.width;
+    u32 height = (u32)metrics.height;
+    u32 x = 0;
+    u32 y = 0;
+    if(width && height){
+        if(cache->totalRecords == GLYPH_MAX_GLYPHS ||
+           !packSkylineRect(&cache->packer, width + GLYPH_ATLAS_PADDING, height + GLYPH_ATLAS_PADDING, &x, &y)){
+            resetGlyphCache(cache);
+            if(!packSkylineRect(&cache->packer, width + GLYPH_ATLAS_PADDING, height + GLYPH_ATLAS_PADDING, &x, &y)){
+                return GLYPH_NONE;
+            }
+        }
+        cache->rasterizeGlyph(cache->userData, codepoint, cache->atlas + (u64)y * cache->atlasWidth + x, cache->atlasWidth);
+        if(y < cache->dirtyMinY) cache->dirtyMinY = y;
+        if(y + height > cache->dirtyMaxY) cache->dirtyMaxY = y + height;
+    }else if(cache->totalRecords == GLYPH_MAX_GLYPHS){
+        resetGlyphCache(cache);
+    }
+    u16 index = (u16)cache->totalRecords++;
+    GlyphRecord* record = &cache->records[index];
+    *record = metrics;
+    record->atlasX = (u16)x;
+    record->atlasY = (u16)y;
+    record->atlasWidth = (u16)width;
+    record->atlasHeight = (u16)height;
+    record->codepoint = codepoint;
+    mapGlyph(cache, codepoint, index);
+    return index;
+}
+
+//Glyphs missing from the font resolve to missingCodepoint's record. The pointer is only valid until the next call that
+//can add a glyph, since a full atlas starts over.
+static GlyphRecord* getGlyph(GlyphCache* cache, u32 codepoint){
+    u16 index = findGlyph(cache, codepoint);
+    if(index == GLYPH_NONE){
+        index = addGlyph(cache, codepoint);
+        if(index == GLYPH_NONE){
+            index = findGlyph(cache, cache->missingCodepoint);
+            if(index == GLYPH_NONE){
+                index = addGlyph(cache, cache->missingCodepoint);
+                if(index == GLYPH_NONE){
+                    return 0;
+                }
+            }
+            mapGlyph(cache, codepoint, index);
+        }
+    }
+    return &cache->records[index];
+}
+
+//invalid or truncated sequences decode to U+FFFD and consume one byte
+static u32 decodeUTF8(const u8** text){
+    const u8* c = *text;
+    u32 codepoint = 0xFFFD;
+    u32 length = 1;
+    if(c[0] < 0x80){
+        codepoint = c[0];
+    }else if((c[0] & 0xE0) == 0xC0 && (c[1] & 0xC0) == 0x80){
+        codepoint = ((c[0] & 0x1F) << 6) | (c[1] & 0x3F);
+        length = codepoint >= 0x80 ? 2 : 1;
+    }else if((c[0] & 0xF0) == 0xE0 && (c[1] & 0xC0) == 0x80 && (c[2] & 0xC0) == 0x80){
+        codepoint = ((c[0] & 0x0F) << 12) | ((c[1] & 0x3F) << 6) | (c[2] & 0x3F);
+        length = codepoint >= 0x800 ? 3 : 1;
+    }else if((c[0] & 0xF8) == 0xF0 && (c[1] & 0xC0) == 0x80 && (c[2] & 0xC0) == 0x80 && (c[3] & 0xC0) == 0x80){
+        codepoint = ((c[0] & 0x07) << 18) | ((c[1] & 0x3F) << 12) | ((c[2] & 0x3F) << 6) | (c[3] & 0x3F);
+        length = codepoint >= 0x10000 && codepoint <= 0x10FFFF ? 4 : 1;
+    }
+    if(length == 1 && c[0] >= 0x80){
+        codepoint = 0xFFFD;
+    }
+    *text = c + length;
+    return codepoint;
+}
+
+struct GlyphQuad {
+    Vector4 bounds;
+    Vector4 uvs;
+};
+
+//Lays out UTF-8 text starting at x, y with y growing down, one quad per visible glyph. Returns the number of quads
+//written; text past maxQuads visible glyphs is dropped. If the atlas starts over part way, layout restarts once so
+//every quad points at the new atlas; text with more distinct glyphs than one atlas holds cannot be fully correct.
+static u32 layoutText(GlyphCache* cache, const s8* text, f32 x, f32 y, f32 scale, GlyphQuad* quads, u32 maxQuads){
+    f32 invWidth = 1.0f / cache->atlasWidth;
+    f32 invHeight = 1.0f / cache->atlasHeight;
+    u32 generation = cache->atlasGeneration;
+    f32 startX = x;
+    f32 startY = y;
+    bool restarted = false;
+    u32 previous = 0;
+    u32 totalQuads = 0;
+    const u8* c = (const u8*)text;
+    while(*c && totalQuads < maxQuads){
+        u32 codepoint = decodeUTF8(&c);
+        if(codepoint == '\n'){
+            x = startX;
+            y += cache->lineHeight * scale;
+            previous = 0;
+            continue;
+        }
+        if(previous && cache->kernGlyphs){
+            x += cache->kernGlyphs(cache->userData, previous, codepoint) * scale;
+        }
+        previous = codepoint;
+        GlyphRecord* glyph = getGlyph(cache, codepoint);
+        if(!glyph) continue;
+        if(cache->atlasGeneration != generation && !restarted){
+            generation = cache->atlasGeneration;
+            restarted = true;
+            c = (const u8*)text;
+            x = startX;
+            y = startY;
+            previous = 0;
+            totalQuads = 0;
+            continue;
+        }
+        if(glyph->atlasWidth){
+            GlyphQuad* quad = &quads[totalQuads++];
+            f32 left = x + glyph->xOffset * scale;
+            f32 top = y + glyph->yOffset * scale;
+            quad->bounds = Vector4(left, top, left + glyph->width * scale, top + glyph->height * scale);
+            quad->uvs = Vector4(glyph->atlasX * invWidth, glyph->atlasY * invHeight,
+                                (glyph->atlasX + glyph->atlasWidth) * invWidth, (glyph->atlasY + glyph->atlasHeight) * invHeight);
+        }
+        x += glyph->advance * scale;
+    }
+    return totalQuads;
+}
+
+//uploads the rows touched since the last flush, creating the atlas texture on first use
+static void flushGlyphAtlas(GlyphCache* cache, OSInterface* os){
+    if(cache->dirtyMinY >= cache->dirtyMaxY){
+        return;
+    }
+    if(!cache->atlasTexture.data1 || !os->updateTexture2D){
+        u32 format = cache->atlasChannels == 4 ? os->TEXTURE_FORMAT_RGBA8 : os->TEXTURE_FORMAT_R8;
+        cache->atlasTexture = os->createTexture2D(cache->atlas, cache->atlasWidth, cache->atlasHeight, format);
+    }else{
+        os->updateTexture2D(&cache->atlasTexture, cache->atlas + (u64)cache->dirtyMinY * cache->atlasWidth * cache->atlasChannels,
+                            0, cache->dirtyMinY, cache->atlasWidth, cache->dirtyMaxY - cache->dirtyMinY);
+    }
+    cache->dirtyMinY = cache->atlasHeight;
+    cache->dirtyMaxY = 0;
+}
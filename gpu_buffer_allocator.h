@@ -0,0 +1,440 @@
+#pragma once
+
+#include "utilities.h"
+
+// Backend agnostic suballocator for vertex/index memory. A pool owns up to GPU_BUFFER_POOL_MAX_CHUNKS equally
+// sized chunks (one GPU buffer each) and places allocations inside them with a two level segregated fit (TLSF)
+// allocator. Only offsets are tracked here; the backend creates, copies and releases chunks through the pool's
+// callbacks, so the whole thing runs without a GPU.
+// Callers hold allocation ids rather than offsets because defragmentation may relocate allocations.
+
+#define GPU_BUFFER_POOL_MAX_CHUNKS 16
+#define TLSF_MIN_BLOCK_SIZE 16
+#define TLSF_SECOND_LEVEL_BITS 4
+#define TLSF_SECOND_LEVEL_COUNT (1 << TLSF_SECOND_LEVEL_BITS)
+#define TLSF_FIRST_LEVEL_COUNT 60
+#define TLSF_NULL_NODE MAX_U32
+#define GPU_ALLOCATION_INVALID MAX_U32
+
+struct TLSFNode {
+    u64 offset;
+    u64 size;
+    u32 prevPhysical;
+    u32 nextPhysical;
+    u32 prevFree;
+    u32 nextFree;
+    u32 allocationId;
+    bool free;
+};
+
+struct TLSFAllocator {
+    u64 firstLevelBitmap;
+    u16 secondLevelBitmaps[TLSF_FIRST_LEVEL_COUNT];
+    u32 freeHeads[TLSF_FIRST_LEVEL_COUNT][TLSF_SECOND_LEVEL_COUNT];
+    u32 firstNode;
+    u64 size;
+    u64 usedBytes;
+    u32 allocationCount;
+};
+
+struct GpuAllocationRecord {
+    u64 offset;
+    u64 size;
+    u64 alignment;
+    u32 chunkIndex;
+    u32 node;
+    u32 nextFree;
+};
+
+struct GpuAllocationMove {
+    u32 allocationId;
+    u32 sourceChunk;
+    u32 destinationChunk;
+    u64 sourceOffset;
+    u64 destinationOffset;
+    u64 size;
+};
+
+struct GpuBufferPool {
+    TLSFAllocator chunks[GPU_BUFFER_POOL_MAX_CHUNKS];
+    void* chunkHandles[GPU_BUFFER_POOL_MAX_CHUNKS];
+    u64 chunkSize;
+
+    TLSFNode* nodes;
+    u32 maxNodes;
+    u32 firstFreeNode;
+
+    GpuAllocationRecord* allocations;
+    u32 maxAllocations;
+    u32 firstFreeAllocation;
+
+    void* (*createChunk)(u64 size, void* userData);
+    void (*destroyChunk)(void* chunk, void* userData);
+    void (*copyRange)(void* sourceChunk, u64 sourceOffset, void* destinationChunk, u64 destinationOffset, u64 size, void* userData);
+    void* userData;
+};
+
+struct GpuBufferPoolStatistics {
+    u64 reservedBytes;
+    u64 usedBytes;
+    u64 largestFreeBlock;
+    u32 totalChunks;
+    u32 totalAllocations;
+    u32 freeBlocks;
+};
+
+static u32 allocateTLSFNode(GpuBufferPool* pool){
+    u32 node = pool->firstFreeNode;
+    if(node != TLSF_NULL_NODE){
+        pool->firstFreeNode = pool->nodes[node].nextFree;
+    }
+    return node;
+}
+
+static void releaseTLSFNode(GpuBufferPool* pool, u32 node){
+    pool->nodes[node].nextFree = pool->firstFreeNode;
+    pool->firstFreeNode = node;
+}
+
+static void mapTLSFSize(u64 size, u32* firstLevel, u32* secondLevel){
+    u32 fl = findMostSignificantBit(size);
+    *secondLevel = (u32)(size >> (fl - TLSF_SECOND_LEVEL_BITS)) & (TLSF_SECOND_LEVEL_COUNT - 1);
+    *firstLevel = fl - TLSF_SECOND_LEVEL_BITS;
+}
+
+static void insertFreeTLSFBlock(GpuBufferPool* pool, TLSFAllocator* tlsf, u32 node){
+    u32 fl, sl;
+    mapTLSFSize(pool->nodes[node].size, &fl, &sl);
+    u32 head = tlsf->freeHeads[fl][sl];
+    pool->nodes[node].free = true;
+    pool->nodes[node].prevFree = TLSF_NULL_NODE;
+    pool->nodes[node].nextFree = head;
+    if(head != TLSF_NULL_NODE){
+        pool->nodes[head].prevFree = node;
+    }
+    tlsf->freeHeads[fl][sl] = node;
+    tlsf->firstLevelBitmap |= 1ULL << fl;
+    tlsf->secondLevelBitmaps[fl] |= (u16)(1 << sl);
+}
+
+static void removeFreeTLSFBlock(GpuBufferPool* pool, TLSFAllocator* tlsf, u32 node){
+    u32 fl, sl;
+    mapTLSFSize(pool->nodes[node].size, &fl, &sl);
+    TLSFNode* n = &pool->nodes[node];
+    if(n->prevFree != TLSF_NULL_NODE){
+        pool->nodes[n->prevFree].nextFree = n->nextFree;
+    }else{
+        tlsf->freeHeads[fl][sl] = n->nextFree;
+        if(n->nextFree == TLSF_NULL_NODE){
+            tlsf->secondLevelBitmaps[fl] &= (u16)~(1 << sl);
+            if(tlsf->secondLevelBitmaps[fl] == 0){
+                tlsf->firstLevelBitmap &= ~(1ULL << fl);
+            }
+        }
+    }
+    if(n->nextFree != TLSF_NULL_NODE){
+        pool->nodes[n->nextFree].prevFree = n->prevFree;
+    }
+    n->free = false;
+}
+
+//good fit: rounds the request up to the next size class so any block found there is large enough
+static u32 findFreeTLSFBlock(GpuBufferPool* pool, TLSFAllocator* tlsf, u64 size){
+    u64 rounded = size + (1ULL << (findMostSignificantBit(size) - TLSF_SECOND_LEVEL_BITS)) - 1;
+    u32 fl, sl;
+    mapTLSFSize(rounded, &fl, &sl);
+    if(fl >= TLSF_FIRST_LEVEL_COUNT) return TLSF_NULL_NODE;
+
+    u32 slMap = tlsf->secondLevelBitmaps[fl] & (~0U << sl);
+    if(slMap == 0){
+        u64 flMap = fl + 1 < 64 ? tlsf->firstLevelBitmap & (~0ULL << (fl + 1)) : 0;
+        if(flMap == 0) return TLSF_NULL_NODE;
+        fl = findLeastSignificantBit(flMap);
+        slMap = tlsf->secondLevelBitmaps[fl];
+    }
+    sl = findLeastSignificantBit(slMap);
+    return tlsf->freeHeads[fl][sl];
+}
+
+//splits size bytes off the front of node; the remainder becomes a new free block
+static void splitTLSFBlock(GpuBufferPool* pool, TLSFAllocator* tlsf, u32 node, u64 size){
+    TLSFNode* n = &pool->nodes[node];
+    if(n->size - size < TLSF_MIN_BLOCK_SIZE) return;
+    u32 rest = allocateTLSFNode(pool);
+    if(rest == TLSF_NULL_NODE) return;
+    n = &pool->nodes[node];
+    TLSFNode* r = &pool->nodes[rest];
+    r->offset = n->offset + size;
+    r->size = n->size - size;
+    r->prevPhysical = node;
+    r->nextPhysical = n->nextPhysical;
+    r->allocationId = GPU_ALLOCATION_INVALID;
+    if(n->nextPhysical != TLSF_NULL_NODE){
+        pool->nodes[n->nextPhysical].prevPhysical = rest;
+    }
+    n->nextPhysical = rest;
+    n->size = size;
+    insertFreeTLSFBlock(pool, tlsf, rest);
+}
+
+static void mergeTLSFBlockWithNext(GpuBufferPool* pool, u32 node){
+    TLSFNode* n = &pool->nodes[node];
+    u32 next = n->nextPhysical;
+    n->size += pool->nodes[next].size;
+    n->nextPhysical = pool->nodes[next].nextPhysical;
+    if(n->nextPhysical != TLSF_NULL_NODE){
+        pool->nodes[n->nextPhysical].prevPhysical = node;
+    }
+    releaseTLSFNode(pool, next);
+}
+
+static bool initializeTLSFAllocator(GpuBufferPool* pool, TLSFAllocator* tlsf, u64 size){
+    setMemory(tlsf, sizeof(TLSFAllocator), 0);
+    setMemory(tlsf->freeHeads, sizeof(tlsf->freeHeads), 0xFF);
+    u32 node = allocateTLSFNode(pool);
+    if(node == TLSF_NULL_NODE) return false;
+    TLSFNode* n = &pool->nodes[node];
+    n->offset = 0;
+    n->size = size & ~(u64)(TLSF_MIN_BLOCK_SIZE - 1);
+    n->prevPhysical = TLSF_NULL_NODE;
+    n->nextPhysical = TLSF_NULL_NODE;
+    n->allocationId = GPU_ALLOCATION_INVALID;
+    tlsf->firstNode = node;
+    tlsf->size = n->size;
+    insertFreeTLSFBlock(pool, tlsf, node);
+    return true;
+}
+
+//returns the node holding the allocation, whose offset is aligned to alignment (a power of two)
+static u32 allocateTLSFBlock(GpuBufferPool* pool, TLSFAllocator* tlsf, u64 size, u64 alignment){
+    if(alignment < TLSF_MIN_BLOCK_SIZE) alignment = TLSF_MIN_BLOCK_SIZE;
+    size = (size + TLSF_MIN_BLOCK_SIZE - 1) & ~(u64)(TLSF_MIN_BLOCK_SIZE - 1);
+    if(size == 0) size = TLSF_MIN_BLOCK_SIZE;
+    u32 node = findFreeTLSFBlock(pool, tlsf, size + alignment - TLSF_MIN_BLOCK_SIZE);
+    if(node == TLSF_NULL_NODE) return TLSF_NULL_NODE;
+    removeFreeTLSFBlock(pool, tlsf, node);
+
+    u64 gap = ((pool->nodes[node].offset + alignment - 1) & ~(alignment - 1)) - pool->nodes[node].offset;
+    if(gap){
+        //the alignment gap is handed back as its own free block in front of the allocation
+        u32 front = node;
+        splitTLSFBlock(pool, tlsf, front, gap);
+        node = pool->nodes[front].nextPhysical;
+        if(node == TLSF_NULL_NODE || pool->nodes[node].offset != pool->nodes[front].offset + gap){
+            insertFreeTLSFBlock(pool, tlsf, front);
+            return TLSF_NULL_NODE;
+        }
+        removeFreeTLSFBlock(pool, tlsf, node);
+        insertFreeTLSFBlock(pool, tlsf, front);
+    }
+    splitTLSFBlock(pool, tlsf, node, size);
+    tlsf->usedBytes += pool->nodes[node].size;
+    tlsf->allocationCount++;
+    return node;
+}
+
+static void freeTLSFBlock(GpuBufferPool* pool, TLSFAllocator* tlsf, u32 node){
+    tlsf->usedBytes -= pool->nodes[node].size;
+    tlsf->allocationCount--;
+    pool->nodes[node].allocationId = GPU_ALLOCATION_INVALID;
+    u32 prev = pool->nodes[node].prevPhysical;
+    if(prev != TLSF_NULL_NODE && pool->nodes[prev].free){
+        removeFreeTLSFBlock(pool, tlsf, prev);
+        mergeTLSFBlockWithNext(pool, prev);
+        node = prev;
+    }
+    u32 next = pool->nodes[node].nextPhysical;
+    if(next != TLSF_NULL_NODE && pool->nodes[next].free){
+        removeFreeTLSFBlock(pool, tlsf, next);
+        mergeTLSFBlockWithNext(pool, node);
+    }
+    insertFreeTLSFBlock(pool, tlsf, node);
+}
+
+//nodes and allocation records come from arena; maxAllocations bounds the number of live allocations
+static bool initializeGpuBufferPool(GpuBufferPool* pool, u64 chunkSize, u32 maxAllocations, MemoryArena* arena){
+    setMemory(pool, sizeof(GpuBufferPool), 0);
+    pool->chunkSize = chunkSize;
+    pool->maxNodes = maxAllocations * 2 + GPU_BUFFER_POOL_MAX_CHUNKS;
+    pool->nodes = pushArray(arena, TLSFNode, pool->maxNodes);
+    pool->maxAllocations = maxAllocations;
+    pool->allocations = pushArray(arena, GpuAllocationRecord, maxAllocations);
+    if(!pool->nodes || !pool->allocations) return false;
+
+    for(u32 i = 0; i < pool->maxNodes; i++){
+        pool->nodes[i].nextFree = i + 1 < pool->maxNodes ? i + 1 : TLSF_NULL_NODE;
+    }
+    pool->firstFreeNode = 0;
+    for(u32 i = 0; i < maxAllocations; i++){
+        pool->allocations[i].nextFree = i + 1 < maxAllocations ? i + 1 : GPU_ALLOCATION_INVALID;
+        pool->allocations[i].node = TLSF_NULL_NODE;
+    }
+    pool->firstFreeAllocation = maxAllocations ? 0 : GPU_ALLOCATION_INVALID;
+    return true;
+}
+
+static bool createGpuBufferChunk(GpuBufferPool* pool, u32 chunkIndex){
+    void* handle = pool->createChunk ? pool->createChunk(pool->chunkSize, pool->userData) : (void*)(u64)(chunkIndex + 1);
+    if(!handle) return false;
+    if(!initializeTLSFAllocator(pool, &pool->chunks[chunkIndex], pool->chunkSize)){
+        if(pool->destroyChunk) pool->destroyChunk(handle, pool->userData);
+        return false;
+    }
+    pool->chunkHandles[chunkIndex] = handle;
+    return true;
+}
+
+static void destroyGpuBufferChunk(GpuBufferPool* pool, u32 chunkIndex){
+    releaseTLSFNode(pool, pool->chunks[chunkIndex].firstNode);
+    if(pool->destroyChunk) pool->destroyChunk(pool->chunkHandles[chunkIndex], pool->userData);
+    pool->chunkHandles[chunkIndex] = 0;
+    setMemory(&pool->chunks[chunkIndex], sizeof(TLSFAllocator), 0);
+}
+
+//tries the existing chunks first and only creates a new chunk when none of them has room.
+//excludedChunk lets defragmentation keep allocations out of the chunk being emptied.
+static u32 allocateGpuBufferInternal(GpuBufferPool* pool, u64 size, u64 alignment, u32 excludedChunk){
+    if(pool->firstFreeAllocation == GPU_ALLOCATION_INVALID || size > pool->chunkSize) return GPU_ALLOCATION_INVALID;
+
+    u32 chunkIndex = 0;
+    u32 node = TLSF_NULL_NODE;
+    for(; chunkIndex < GPU_BUFFER_POOL_MAX_CHUNKS && node == TLSF_NULL_NODE; chunkIndex++){
+        if(!pool->chunkHandles[chunkIndex] || chunkIndex == excludedChunk) continue;
+        node = allocateTLSFBlock(pool, &pool->chunks[chunkIndex], size, alignment);
+    }
+    if(node == TLSF_NULL_NODE){
+        for(chunkIndex = 0; chunkIndex < GPU_BUFFER_POOL_MAX_CHUNKS; chunkIndex++){
+            if(pool->chunkHandles[chunkIndex]) continue;
+            if(!createGpuBufferChunk(pool, chunkIndex)) return GPU_ALLOCATION_INVALID;
+            node = allocateTLSFBlock(pool, &pool->chunks[chunkIndex], size, alignment);
+            // a request the empty chunk cannot hold (size plus alignment) would leave it created for nothing
+            if(node == TLSF_NULL_NODE){
+                destroyGpuBufferChunk(pool, chunkIndex);
+                return GPU_ALLOCATION_INVALID;
+            }
+            chunkIndex++;
+            break;
+        }
+        if(node == TLSF_NULL_NODE) return GPU_ALLOCATION_INVALID;
+    }
+    chunkIndex--;
+
+    u32 id = pool->firstFreeAllocation;
+    GpuAllocationRecord* record = &pool->allocations[id];
+    pool->firstFreeAllocation = record->nextFree;
+    record->offset = pool->nodes[node].offset;
+    record->size = size;
+    record->alignment = alignment;
+    record->chunkIndex = chunkIndex;
+    record->node = node;
+    pool->nodes[node].allocationId = id;
+    return id;
+}
+
+static u32 allocateGpuBuffer(GpuBufferPool* pool, u64 size, u64 alignment = TLSF_MIN_BLOCK_SIZE){
+    return allocateGpuBufferInternal(pool, size, alignment, GPU_ALLOCATION_INVALID);
+}
+
+static void freeGpuBuffer(GpuBufferPool* pool, u32 allocationId){
+    GpuAllocationRecord* record = &pool->allocations[allocationId];
+    if(record->node == TLSF_NULL_NODE) return;
+    freeTLSFBlock(pool, &pool->chunks[record->chunkIndex], record->node);
+    record->node = TLSF_NULL_NODE;
+    record->nextFree = pool->firstFreeAllocation;
+    pool->firstFreeAllocation = allocationId;
+}
+
+static GpuAllocationRecord* getGpuAllocation(GpuBufferPool* pool, u32 allocationId){
+    return &pool->allocations[allocationId];
+}
+
+static void* getGpuAllocationChunk(GpuBufferPool* pool, u32 allocationId){
+    return pool->chunkHandles[pool->allocations[allocationId].chunkIndex];
+}
+
+//Evacuates the least occupied chunk into the others, copying through the pool's copyRange callback, and
+//releases it once empty. Moves at most maxBytes per call and records every relocation in moves.
+static u32 defragmentGpuBufferPool(GpuBufferPool* pool, u64 maxBytes, GpuAllocationMove* moves, u32 maxMoves){
+    u32 sourceChunk = GPU_ALLOCATION_INVALID;
+    u32 liveChunks = 0;
+    for(u32 i = 0; i < GPU_BUFFER_POOL_MAX_CHUNKS; i++){
+        if(!pool->chunkHandles[i]) continue;
+        liveChunks++;
+        if(sourceChunk == GPU_ALLOCATION_INVALID || pool->chunks[i].usedBytes < pool->chunks[sourceChunk].usedBytes){
+            sourceChunk = i;
+        }
+    }
+    if(sourceChunk == GPU_ALLOCATION_INVALID) return 0;
+    if(pool->chunks[sourceChunk].allocationCount == 0){
+        if(liveChunks > 1) destroyGpuBufferChunk(pool, sourceChunk);
+        return 0;
+    }
+    if(liveChunks < 2) return 0;
+
+    u32 moveCount = 0;
+    u64 movedBytes = 0;
+    u32 node = pool->chunks[sourceChunk].firstNode;
+    while(node != TLSF_NULL_NODE && moveCount < maxMoves && movedBytes < maxBytes){
+        u32 next = pool->nodes[node].nextPhysical;
+        if(!pool->nodes[node].free){
+            u32 id = pool->nodes[node].allocationId;
+            GpuAllocationRecord old = pool->allocations[id];
+            //never grow the pool while defragmenting it
+            u32 chunkIndex = 0;
+            u32 newNode = TLSF_NULL_NODE;
+            for(; chunkIndex < GPU_BUFFER_POOL_MAX_CHUNKS; chunkIndex++){
+                if(!pool->chunkHandles[chunkIndex] || chunkIndex == sourceChunk) continue;
+                newNode = allocateTLSFBlock(pool, &pool->chunks[chunkIndex], old.size, old.alignment);
+                if(newNode != TLSF_NULL_NODE) break;
+            }
+            if(newNode == TLSF_NULL_NODE) break;
+
+            if(pool->copyRange){
+                pool->copyRange(pool->chunkHandles[sourceChunk], old.offset, pool->chunkHandles[chunkIndex],
+                                pool->nodes[newNode].offset, old.size, pool->userData);
+            }
+            GpuAllocationMove* move = &moves[moveCount++];
+            move->allocationId = id;
+            move->sourceChunk = sourceChunk;
+            move->destinationChunk = chunkIndex;
+            move->sourceOffset = old.offset;
+            move->destinationOffset = pool->nodes[newNode].offset;
+            move->size = old.size;
+            movedBytes += old.size;
+
+            //the successor of node may get merged away when node is freed, so re-read it afterwards
+            u32 prev = pool->nodes[node].prevPhysical;
+            freeTLSFBlock(pool, &pool->chunks[sourceChunk], node);
+            next = prev != TLSF_NULL_NODE && pool->nodes[prev].free ? pool->nodes[prev].nextPhysical : pool->nodes[node].nextPhysical;
+
+            GpuAllocationRecord* record = &pool->allocations[id];
+            record->chunkIndex = chunkIndex;
+            record->node = newNode;
+            record->offset = pool->nodes[newNode].offset;
+            pool->nodes[newNode].allocationId = id;
+        }
+        node = next;
+    }
+
+    if(pool->chunks[sourceChunk].allocationCount == 0){
+        destroyGpuBufferChunk(pool, sourceChunk);
+    }
+    return moveCount;
+}
+
+static GpuBufferPoolStatistics getGpuBufferPoolStatistics(GpuBufferPool* pool){
+    GpuBufferPoolStatistics stats = {};
+    for(u32 i = 0; i < GPU_BUFFER_POOL_MAX_CHUNKS; i++){
+        if(!pool->chunkHandles[i]) continue;
+        stats.totalChunks++;
+        stats.reservedBytes += pool->chunks[i].size;
+        stats.usedBytes += pool->chunks[i].usedBytes;
+        stats.totalAllocations += pool->chunks[i].allocationCount;
+        for(u32 node = pool->chunks[i].firstNode; node != TLSF_NULL_NODE; node = pool->nodes[node].nextPhysical){
+            if(!pool->nodes[node].free) continue;
+            stats.freeBlocks++;
+            if(pool->nodes[node].size > stats.largestFreeBlock) stats.largestFreeBlock = pool->nodes[node].size;
+        }
+    }
+    return stats;
+}
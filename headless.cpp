@@ -0,0 +1,1029 @@
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "os_interface.h"
+#include "asset_database.h"
+#include "null_render_backend.h"
+#include "frame_pacing.h"
+#include "model_store.h"
+#include "texture_store.h"
+#include "scratch_scene.h"
+#include "descriptor_allocator.h"
+#include "command_list_pool.h"
+#include "render_graph.h"
+#include "pipeline_cache.h"
+#include "headless_checks.h"
+
+//Runs the dx12_scratch frame loop on the null render backend, with no window and no gpu, prints what each renderer
+//module measured and exits with 1 if the backend caught any invalid command.
+//usage: headless [key=value ...]
+//       headless help
+//       headless check [names]
+//The options and their defaults are in headlessOptions, which headless help lists. headless check runs the named
+//checks from headless_checks.h, or all of them, and exits with 1 if one fails.
+
+#define HEADLESS_MAX_WORK_QUEUES 6
+#define HEADLESS_UPLOAD_JOBS 16
+#define HEADLESS_UPLOAD_RING_SIZE MEGABYTE(16)
+#define HEADLESS_STAGING_SIZE MEGABYTE(4)
+#define HEADLESS_COPY_BUDGET MEGABYTE(1)
+#define HEADLESS_GEOMETRY_SIZE MEGABYTE(8)
+#define HEADLESS_GEOMETRY_SOURCE_SIZE MEGABYTE(1)
+#define HEADLESS_GEOMETRY_PIECE KILOBYTE(4)
+#define HEADLESS_PERSISTENT_DESCRIPTORS 65536
+#define HEADLESS_TRANSIENT_DESCRIPTORS 65536
+#define HEADLESS_SAMPLER_DESCRIPTORS 16
+#define HEADLESS_DESCRIPTOR_TABLE_SIZE 8
+#define HEADLESS_MAX_PERMUTATIONS 64
+#define HEADLESS_PIPELINE_LIBRARY "headless_pipelines.bin"
+#define HEADLESS_PIPELINE_LIBRARY_SIZE MEGABYTE(1)
+#define HEADLESS_MODEL_VERTEX_CHUNK MEGABYTE(4)
+#define HEADLESS_MODEL_INDEX_CHUNK MEGABYTE(2)
+#define HEADLESS_MAX_MODELS 1024
+#define HEADLESS_MODEL_SOURCE_SIZE MEGABYTE(2)
+#define HEADLESS_MODEL_SCRATCH_SIZE MEGABYTE(2)
+#define HEADLESS_QUANTIZE_MODELS true
+#define HEADLESS_MAX_TEXTURES 256
+#define HEADLESS_TEXTURE_SOURCE_SIZE MEGABYTE(4)
+#define HEADLESS_TEXTURE_SCRATCH_SIZE MEGABYTE(8)
+#define HEADLESS_TEXTURE_COMPRESSION BLOCK_COMPRESSION_BC1
+#define HEADLESS_CHECK_DESCRIPTORS 256
+#define HEADLESS_STREAMED_TEXTURES 8
+#define HEADLESS_STREAMING_BUDGET KILOBYTE(160)
+#define HEADLESS_STREAMING_READ_SIZE KILOBYTE(256)
+#define HEADLESS_MAX_TEXTURE_CUBES 4
+#define HEADLESS_RELOAD_INTERVAL 20
+#define HEADLESS_RELOAD_SHADER "headless_reload.hlsl"
+#define HEADLESS_RELOAD_SOURCE_SIZE KILOBYTE(64)
+#define HEADLESS_WATCHER_BUFFER_SIZE 4096
+#define HEADLESS_COOK_CACHE_DIRECTORY "headless_cook/"
+#define HEADLESS_COOK_CACHE_BUDGET MEGABYTE(1)
+#define HEADLESS_REGISTRY_ASSETS 256
+#define HEADLESS_REGISTRY_NAMES KILOBYTE(16)
+
+u32 width = 1280;
+u32 height = 720;
+
+static OSInterface os;
+static AssetDatabase assetDatabase;
+static CookCacheDirectory cookDirectory;
+static CookCache cookCache;
+static AssetRegistry assetRegistry;
+static ModelStore modelStore;
+static TextureStore textureStore;
+static TextureStreamingManager textureStreaming;
+static TextureStreamingStore textureStreamingStore;
+static WorkQueue assetQueue;
+static WorkQueue bakeQueue;
+static StoredIBLEnvironment textureCubes[HEADLESS_MAX_TEXTURE_CUBES];
+static u32 totalTextureCubes;
+static sem_t workQueueSemaphores[HEADLESS_MAX_WORK_QUEUES];
+static u32 totalWorkQueueSemaphores;
+
+//pipeline is the handle of the newest source's pipeline, fallback of the last one known to be ready
+struct HeadlessShader {
+    PipelineCache* cache;
+    RenderPipelineDesc desc;
+    u64 bytecode;
+    u32 pipeline;
+    u32 fallback;
+};
+
+//inotify on the watched directory alone, not its subdirectories
+struct LinuxFileWatcher {
+    int descriptor;
+    u8 buffer[HEADLESS_WATCHER_BUFFER_SIZE] __attribute__((aligned(__alignof__(inotify_event))));
+};
+
+struct HeadlessUploadJob {
+    UploadRing* ring;
+    u32 totalBlocks;
+};
+
+struct HeadlessDescriptorJob {
+    RenderBackend* backend;
+    DescriptorAllocator* descriptors;
+    UploadRing* ring;
+    u32 totalChurn;
+};
+
+static bool linuxReadFileIntoBoundedBuffer(const s8* fileName, void* data, u32 capacity, u32* fileLength) {
+    FILE* file = fopen(fileName, "rb");
+    if (!file) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    bool success = size >= 0 && (u64)size <= capacity && fread(data, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+    *fileLength = success ? (u32)size : 0;
+    return success;
+}
+
+static bool linuxReadFileIntoBuffer(const s8* fileName, void* data, u32* fileLength) {
+    return linuxReadFileIntoBoundedBuffer(fileName, data, MAX_U32, fileLength);
+}
+
+static bool linuxWriteToFile(const s8* fileName, void* data, u32 dataSize) {
+    FILE* file = fopen(fileName, "wb");
+    if (!file) {
+        return false;
+    }
+    bool success = fwrite(data, 1, dataSize, file) == dataSize;
+    return fclose(file) == 0 && success;
+}
+
+static bool linuxDeleteFile(const s8* fileName) {
+    return unlink(fileName) == 0;
+}
+
+//the handle is 0 when the file cannot be opened, reads and seeks on it do nothing
+static FileHandle linuxGetFileHandleForReading(s8* fileName) {
+    FileHandle handle;
+    handle.handle = fopen(fileName, "rb");
+    return handle;
+}
+
+static void linuxSetFileHandlePointer(FileHandle* handle, u32 amount) {
+    if (handle->handle) {
+        fseek((FILE*)handle->handle, (long)amount, SEEK_SET);
+    }
+}
+
+static void linuxReadFromFileHandle(FileHandle* handle, u8* buffer, u32 amount) {
+    if (handle->handle) {
+        fread(buffer, 1, amount, (FILE*)handle->handle);
+    }
+}
+
+static void linuxCloseFileHandle(FileHandle* handle) {
+    if (handle->handle) {
+        fclose((FILE*)handle->handle);
+        handle->handle = 0;
+    }
+}
+
+//a write shows up once the writer closes the file, a save through a temporary file once it is renamed into place
+static void* linuxCreateFileWatcher(const s8* directory) {
+    int descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (descriptor < 0) {
+        return 0;
+    }
+    LinuxFileWatcher* watcher = (LinuxFileWatcher*)malloc(sizeof(LinuxFileWatcher));
+    if (!watcher || inotify_add_watch(descriptor, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        free(watcher);
+        close(descriptor);
+        return 0;
+    }
+    watcher->descriptor = descriptor;
+    return watcher;
+}
+
+//every pending event is read, names that do not fit in capacity are dropped like an overflowed win32 watcher's
+static u32 linuxReadFileWatcherChanges(void* data, s8* names, u32 capacity) {
+    LinuxFileWatcher* watcher = (LinuxFileWatcher*)data;
+    u32 used = 0;
+    for (;;) {
+        ssize_t bytes = read(watcher->descriptor, watcher->buffer, sizeof(watcher->buffer));
+        if (bytes <= 0) {
+            break;
+        }
+        for (ssize_t offset = 0; offset < bytes;) {
+            inotify_event* event = (inotify_event*)(watcher->buffer + offset);
+            u32 length = event->len ? (u32)strlen(event->name) : 0;
+            if (length && used + length + 1 <= capacity) {
+                copyMemory(names + used, event->name, length + 1);
+                used += length + 1;
+            }
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+    return used;
+}
+
+static u64 linuxGetMicroseconds() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000 + (u64)now.tv_nsec / 1000;
+}
+
+static u64 linuxGetSystemTime() {
+    return linuxGetMicroseconds() / 1000;
+}
+
+static void linuxSleepMicroseconds(u64 microseconds) {
+    timespec duration;
+    duration.tv_sec = (time_t)(microseconds / 1000000);
+    duration.tv_nsec = (long)(microseconds % 1000000) * 1000;
+    nanosleep(&duration, 0);
+}
+
+static bool doNextWorkQueueEntry(WorkQueue* queue) {
+    u32 startPos = queue->entryStartPos;
+    if (startPos == queue->entryAddPos) {
+        return false;
+    }
+    u32 nextPos = (startPos + 1) % WorkQueue::MAX_ENTRIES;
+    if (atomicCompareExchange(&queue->entryStartPos, nextPos, startPos) == startPos) {
+        WorkEntry entry = queue->entries[startPos];
+        entry.function(entry.data);
+        atomicAdd(&queue->entriesCompleted, 1);
+    }
+    return true;
+}
+
+static void* workQueueThreadProc(void* parameter) {
+    WorkQueue* queue = (WorkQueue*)parameter;
+    for (;;) {
+        if (!doNextWorkQueueEntry(queue)) {
+            sem_wait((sem_t*)queue->semaphore);
+        }
+    }
+    return 0;
+}
+
+static void linuxInitializeWorkQueue(WorkQueue* queue, u32 totalThreads) {
+    queue->entryAddPos = 0;
+    queue->entryStartPos = 0;
+    queue->entriesAdded = 0;
+    queue->entriesCompleted = 0;
+    if (totalWorkQueueSemaphores == HEADLESS_MAX_WORK_QUEUES) {
+        *(int*)0 = 0;
+    }
+    sem_t* semaphore = &workQueueSemaphores[totalWorkQueueSemaphores++];
+    sem_init(semaphore, 0, 0);
+    queue->semaphore = semaphore;
+    for (u32 i = 0; i < totalThreads; i++) {
+        pthread_t thread;
+        pthread_create(&thread, 0, workQueueThreadProc, queue);
+        pthread_detach(thread);
+    }
+}
+
+//only the main thread adds entries, workers claim them through entryStartPos
+static void linuxAddWorkQueueEntry(WorkQueue* queue, void (*function)(void*), void* data) {
+    u32 addPos = queue->entryAddPos;
+    queue->entries[addPos].function = function;
+    queue->entries[addPos].data = data;
+    queue->entriesAdded++;
+    __sync_synchronize();
+    queue->entryAddPos = (addPos + 1) % WorkQueue::MAX_ENTRIES;
+    sem_post((sem_t*)queue->semaphore);
+}
+
+static void linuxCompleteWorkQueueEntries(WorkQueue* queue) {
+    while (queue->entriesCompleted != queue->entriesAdded) {
+        doNextWorkQueueEntry(queue);
+    }
+    queue->entriesAdded = 0;
+    queue->entriesCompleted = 0;
+}
+
+//there is no shader compiler here, the bytecode is a hash of the source so it only changes when the source does
+static u32 cookShader(void* userData, u8* source, u32 sourceSize, void* out, u32 outCapacity) {
+    if (outCapacity < sizeof(u64)) {
+        return 0;
+    }
+    u64 bytecode = hashMemory(source, sourceSize) | 1;
+    copyMemory(out, &bytecode, sizeof(u64));
+    return sizeof(u64);
+}
+
+static void swapShader(void* userData, void* result) {
+    HeadlessShader* shader = (HeadlessShader*)userData;
+    CookedAsset* cooked = (CookedAsset*)result;
+    copyMemory(&shader->bytecode, cooked->data, sizeof(u64));
+    shader->desc.vertexShader.code = &shader->bytecode;
+    shader->desc.vertexShader.size = sizeof(shader->bytecode);
+    shader->desc.pixelShader = shader->desc.vertexShader;
+    //only the first pipeline has nothing to fall back on
+    bool first = shader->pipeline == PIPELINE_CACHE_NONE;
+    u32 pipeline = requestPipeline(shader->cache, &shader->desc, first);
+    if (pipeline == PIPELINE_CACHE_NONE) {
+        printf("shader reload dropped, the pipeline cache is full\n");
+        return;
+    }
+    if (pipeline == shader->pipeline) {
+        return;
+    }
+    //the old fallback gives way to a ready pipeline, a pipeline still compiling is just replaced
+    u32 superseded = shader->fallback;
+    if (isPipelineReady(shader->cache, shader->pipeline)) {
+        shader->fallback = shader->pipeline;
+    } else {
+        superseded = shader->pipeline;
+    }
+    if (superseded != pipeline) {
+        retirePipeline(shader->cache, superseded);
+    }
+    if (shader->fallback == pipeline) {
+        shader->fallback = PIPELINE_CACHE_NONE;
+    }
+    shader->pipeline = pipeline;
+}
+
+//stands in for systems writing per object constants from worker threads
+static void writeUploadConstants(void* data) {
+    HeadlessUploadJob* job = (HeadlessUploadJob*)data;
+    Matrix4 world(1);
+    for (u32 i = 0; i < job->totalBlocks; i++) {
+        UploadAllocation allocation;
+        if (!allocateUploadConstants(job->ring, sizeof(Matrix4), &allocation)) {
+            return;
+        }
+        copyMemory(allocation.data, &world, sizeof(Matrix4));
+    }
+}
+
+//every persistent descriptor is retired in the frame it is made, so the free list turns over as fast as it can
+static void churnDescriptors(void* data) {
+    HeadlessDescriptorJob* job = (HeadlessDescriptorJob*)data;
+    RenderBackend* backend = job->backend;
+    DescriptorAllocator* descriptors = job->descriptors;
+    UploadAllocation constants;
+    if (!allocateUploadConstants(job->ring, sizeof(Matrix4), &constants)) {
+        return;
+    }
+    for (u32 i = 0; i < job->totalChurn; i++) {
+        u32 index = allocateDescriptor(descriptors);
+        if (index == DESCRIPTOR_INDEX_NONE) {
+            return;
+        }
+        backend->createConstantBufferView(backend, &descriptors->heap, index, constants.gpuAddress, constants.size);
+        retireDescriptor(descriptors, index);
+        if (i % HEADLESS_DESCRIPTOR_TABLE_SIZE == 0) {
+            u32 table = allocateTransientDescriptors(descriptors, HEADLESS_DESCRIPTOR_TABLE_SIZE);
+            if (table == DESCRIPTOR_INDEX_NONE) {
+                return;
+            }
+            for (u32 j = 0; j < HEADLESS_DESCRIPTOR_TABLE_SIZE; j++) {
+                backend->createConstantBufferView(backend, &descriptors->heap, table + j, constants.gpuAddress,
+                                                  constants.size);
+            }
+        }
+    }
+}
+
+static void printRenderGraphStats(const s8* name, RenderGraphStats* stats) {
+    printf("%s graph %u passes, %u culled, %u barriers in %u batches, %u split, %u aliasing\n", name, stats->passes,
+           stats->culledPasses, stats->barriers, stats->batches, stats->splitBarriers, stats->aliasingBarriers);
+    printf("%s graph %u transients, %llu KB placed in %llu KB, %llu KB saved\n", name, stats->transients,
+           stats->transientBytes / 1024, stats->heapBytes / 1024, (stats->transientBytes - stats->heapBytes) / 1024);
+}
+
+static Model3D linuxCreateModel3D(f32* vData, u32 vDataSize, u16* iData, u32 iDataSize) {
+    return createStoredModel3D(&modelStore, vData, vDataSize, iData, iDataSize, MODEL3D_VERTEX_SIZE, sizeof(u16));
+}
+
+static Model3D linuxCreateModel3D32(f32* vData, u32 vDataSize, u32* iData, u32 iDataSize) {
+    return createStoredModel3D(&modelStore, vData, vDataSize, iData, iDataSize, MODEL3D_VERTEX_SIZE, sizeof(u32));
+}
+
+static void linuxDestroyModel3D(Model3D* model) {
+    destroyStoredModel3D(&modelStore, model);
+}
+
+static Texture2D linuxCreateTexture2DMipmapped(void* data, u32 width, u32 height, u32 format, u32 mipLevels) {
+    Texture2D texture = {};
+    texture.data1 = createStoredTexture2D(&textureStore, data, width, height, format, mipLevels);
+    texture.data2 = &textureStore;
+    texture.format = format;
+    return texture;
+}
+
+static Texture2D linuxCreateTexture2D(void* data, u32 width, u32 height, u32 format) {
+    return linuxCreateTexture2DMipmapped(data, width, height, format, 1);
+}
+
+static void linuxUpdateTexture2D(Texture2D* texture, void* data, u32 x, u32 y, u32 width, u32 height) {
+    if (texture->data1) {
+        updateStoredTexture2D((TextureStore*)texture->data2, (StoredTexture*)texture->data1, data, x, y, width, height);
+    }
+}
+
+//files with levels to stream are streamed once the streaming manager is set up, the check run has none
+static Texture2D linuxCreateTexture2DFromFile(s8* fileName) {
+    if (textureStreaming.textures) {
+        return createStreamedTexture2DFromFile(&textureStreaming, &textureStreamingStore, &os, fileName,
+                                               &textureStore.scratch, 0, 0, HEADLESS_TEXTURE_COMPRESSION);
+    }
+    return createTexture2DFromImageFile(&os, fileName, &textureStore.scratch, 0, 0, HEADLESS_TEXTURE_COMPRESSION);
+}
+
+//Square RGBA8 faces are baked into an environment in the texture store. There is no cache directory, so runs leave no
+//bakes behind.
+static TextureCube linuxCreateTextureCube(void* data, u32 width, u32 height, u32 format) {
+    TextureCube cube = {};
+    if (width != height || format != RENDER_FORMAT_R8G8B8A8_UNORM || totalTextureCubes == HEADLESS_MAX_TEXTURE_CUBES) {
+        return cube;
+    }
+    IBLBakeSettings settings = defaultIBLBakeSettings();
+    if (width < settings.outputSize) {
+        settings.outputSize = width;
+    }
+    if (settings.totalLevels > findMostSignificantBit(settings.outputSize) + 1) {
+        settings.totalLevels = findMostSignificantBit(settings.outputSize) + 1;
+    }
+    StoredIBLEnvironment* environment = &textureCubes[totalTextureCubes];
+    if (createStoredIBLEnvironment(environment, &textureStore, &os, (u8*)data, width, &settings, 0, &bakeQueue)) {
+        totalTextureCubes++;
+        cube.data1 = environment;
+        cube.data2 = &textureStore;
+        cube.format = format;
+    }
+    return cube;
+}
+
+//the bindless index of the specular chain
+static u32 linuxBindTextureCube(TextureCube* cube) {
+    return ((StoredIBLEnvironment*)cube->data1)->specular->descriptor;
+}
+
+static void initializeHeadlessOS() {
+    os.totalCores = (u32)sysconf(_SC_NPROCESSORS_ONLN);
+    os.readFileIntoBuffer = linuxReadFileIntoBuffer;
+    os.readFileIntoBoundedBuffer = linuxReadFileIntoBoundedBuffer;
+    os.writeToFile = linuxWriteToFile;
+    os.deleteFile = linuxDeleteFile;
+    os.getFileHandleForReading = linuxGetFileHandleForReading;
+    os.setFileHandlePointer = linuxSetFileHandlePointer;
+    os.readFromFileHandle = linuxReadFromFileHandle;
+    os.closeFileHandle = linuxCloseFileHandle;
+    os.getSystemTime = linuxGetSystemTime;
+    os.initializeWorkQueue = linuxInitializeWorkQueue;
+    os.addWorkQueueEntry = linuxAddWorkQueueEntry;
+    os.completeWorkQueueEntries = linuxCompleteWorkQueueEntries;
+    os.createFileWatcher = linuxCreateFileWatcher;
+    os.readFileWatcherChanges = linuxReadFileWatcherChanges;
+    os.initializeWorkQueue(&bakeQueue, os.totalCores > 1 ? os.totalCores - 1 : 1);
+    os.createModel3D = linuxCreateModel3D;
+    os.createModel3D32 = linuxCreateModel3D32;
+    os.destroyModel3D = linuxDestroyModel3D;
+    os.model3DVertexBufferPool = &modelStore.pools[MODEL_STORE_VERTICES].pool;
+    os.model3DIndexBufferPool = &modelStore.pools[MODEL_STORE_INDICES].pool;
+    os.createTexture2D = linuxCreateTexture2D;
+    os.createTexture2DMipmapped = linuxCreateTexture2DMipmapped;
+    os.createTexture2DFromFile = linuxCreateTexture2DFromFile;
+    os.updateTexture2D = linuxUpdateTexture2D;
+    os.createTextureCube = linuxCreateTextureCube;
+    os.bindTextureCube = linuxBindTextureCube;
+    os.TEXTURE_FORMAT_R8 = RENDER_FORMAT_R8_UNORM;
+    os.TEXTURE_FORMAT_RG8 = RENDER_FORMAT_R8G8_UNORM;
+    os.TEXTURE_FORMAT_RGBA8 = RENDER_FORMAT_R8G8B8A8_UNORM;
+    os.TEXTURE_FORMAT_R32F = RENDER_FORMAT_R32_FLOAT;
+    os.TEXTURE_FORMAT_BC1 = RENDER_FORMAT_BC1_UNORM;
+    os.TEXTURE_FORMAT_BC4S = RENDER_FORMAT_BC4_SNORM;
+    os.TEXTURE_FORMAT_BC4U = RENDER_FORMAT_BC4_UNORM;
+    os.TEXTURE_FORMAT_BC5 = RENDER_FORMAT_BC5_UNORM;
+}
+
+static int runHeadlessChecks(u32 totalNames, char** names) {
+    initializeHeadlessOS();
+    WorkQueue checkQueue;
+    os.initializeWorkQueue(&checkQueue, os.totalCores > 1 ? os.totalCores - 1 : 1);
+    u32 memorySize = MEGABYTE(128);
+    void* memory = mmap(0, memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return 1;
+    }
+    MemoryArena arena = createMemoryArena(memory, memorySize);
+    //the os texture hooks create in a store on a null backend of its own, which the checks read back
+    RenderBackend backend;
+    UploadScheduler scheduler;
+    DescriptorAllocator resourceDescriptors;
+    if (!initializeCheckBackend(&backend, &arena) ||
+        !initializeUploadScheduler(&scheduler, &backend, HEADLESS_STAGING_SIZE, HEADLESS_COPY_BUDGET) ||
+        !initializeDescriptorAllocator(&resourceDescriptors, &backend, RENDER_DESCRIPTORS_RESOURCE,
+                                       HEADLESS_CHECK_DESCRIPTORS, 0, &arena) ||
+        !initializeTextureStore(&textureStore, &backend, &scheduler, &resourceDescriptors, HEADLESS_MAX_TEXTURES,
+                                HEADLESS_TEXTURE_SOURCE_SIZE, HEADLESS_TEXTURE_SCRATCH_SIZE, &arena)) {
+        printf("texture store setup failed\n");
+        return 1;
+    }
+    HeadlessCheckContext context = {&os, &checkQueue, &arena, linuxGetMicroseconds, &textureStore};
+    u32 failed = 0;
+    u32 run = 0;
+    for (u32 i = 0; i < sizeof(headlessChecks) / sizeof(headlessChecks[0]); i++) {
+        bool named = !totalNames;
+        for (u32 j = 0; j < totalNames; j++) {
+            named |= !strcmp(names[j], headlessChecks[i].name);
+        }
+        if (!named) {
+            continue;
+        }
+        run++;
+        if (!headlessChecks[i].run(&context)) {
+            printf("check %s FAILED\n", headlessChecks[i].name);
+            failed++;
+        }
+    }
+    printf("%u checks run, %u failed\n", run, failed);
+    return failed || !run ? 1 : 0;
+}
+
+//a key=value option of the frame loop, value holding its default until the command line sets it
+struct HeadlessOption {
+    const s8* key;
+    u64 value;
+    const s8* usage;
+};
+
+static HeadlessOption headlessOptions[] = {
+    {"frames", 600, "frames to run"},
+    {"framesInFlight", 2, "frames the cpu records ahead of the gpu"},
+    {"cpuCost", 1000, "us spun on the main thread each frame, standing in for game work"},
+    {"gpuCost", 2000, "us of gpu time each frame, split over the draws"},
+    {"submitLatency", 500, "us from a submission to the gpu starting it"},
+    {"lowLatency", 0, "low latency pacing target in us, 0 paces without it"},
+    {"constantBlocks", 0, "constant blocks every worker thread allocates from the upload ring at once each frame"},
+    {"copyBandwidth", 4000, "copy bandwidth in bytes per us"},
+    {"geometryKB", 0, "static geometry requested from the upload scheduler each frame, in small adjacent pieces"},
+    {"descriptorChurn", 0, "persistent descriptors the worker threads allocate, write and retire each frame"},
+    {"draws", 1, "draws the scene is split into"},
+    {"recordingThreads", 0, "threads recording the draws on command lists of their own, 0 for the frame's list"},
+    {"renderGraph", 0, "1 runs a sample deferred frame through the render graph before the scene"},
+    {"permutations", 0, "pipeline permutations requested at startup and drawn in turn, kept in the pipeline library"},
+    {"compileCost", 20000, "us a pipeline compile takes"},
+    {"streamedTextures", HEADLESS_STREAMED_TEXTURES, "DDS textures streamed in as the camera flies past them"},
+    {"editInterval", HEADLESS_RELOAD_INTERVAL, "frames between edits of the scene's shader on disk, 0 for none"},
+};
+
+static void printHeadlessUsage() {
+    printf("usage: headless [key=value ...] | headless help | headless check [names]\n");
+    for (u32 i = 0; i < sizeof(headlessOptions) / sizeof(headlessOptions[0]); i++) {
+        s8 option[64];
+        snprintf(option, sizeof(option), "%s=%llu", headlessOptions[i].key, headlessOptions[i].value);
+        printf("  %-24s %s\n", option, headlessOptions[i].usage);
+    }
+}
+
+//false for an argument that is not key=value with a known key and a number
+static bool parseHeadlessOptions(u32 totalArguments, char** arguments) {
+    for (u32 i = 0; i < totalArguments; i++) {
+        const s8* separator = strchr(arguments[i], '=');
+        HeadlessOption* option = 0;
+        for (u32 j = 0; separator && j < sizeof(headlessOptions) / sizeof(headlessOptions[0]); j++) {
+            const s8* key = headlessOptions[j].key;
+            if (strlen(key) == (size_t)(separator - arguments[i]) && !strncmp(key, arguments[i], strlen(key))) {
+                option = &headlessOptions[j];
+            }
+        }
+        s8* end = 0;
+        u64 value = option ? strtoull(separator + 1, &end, 10) : 0;
+        if (!option || end == separator + 1 || *end) {
+            printf("unknown option %s\n", arguments[i]);
+            return false;
+        }
+        option->value = value;
+    }
+    return true;
+}
+
+static u64 getHeadlessOption(const s8* key) {
+    for (u32 i = 0; i < sizeof(headlessOptions) / sizeof(headlessOptions[0]); i++) {
+        if (!strcmp(headlessOptions[i].key, key)) {
+            return headlessOptions[i].value;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && !strcmp(argv[1], "check")) {
+        return runHeadlessChecks((u32)argc - 2, argv + 2);
+    }
+    if (argc > 1 && !strcmp(argv[1], "help")) {
+        printHeadlessUsage();
+        return 0;
+    }
+    if (!parseHeadlessOptions((u32)argc - 1, argv + 1)) {
+        printHeadlessUsage();
+        return 1;
+    }
+    u32 totalFrames = (u32)getHeadlessOption("frames");
+    u32 framesInFlight = (u32)getHeadlessOption("framesInFlight");
+    u64 cpuCost = getHeadlessOption("cpuCost");
+    u32 constantBlocks = (u32)getHeadlessOption("constantBlocks");
+    u32 geometryBytes = (u32)getHeadlessOption("geometryKB") * 1024;
+    u32 descriptorChurn = (u32)getHeadlessOption("descriptorChurn");
+    u32 totalDraws = (u32)getHeadlessOption("draws");
+    u32 recordingThreads = (u32)getHeadlessOption("recordingThreads");
+    bool useRenderGraph = getHeadlessOption("renderGraph");
+    u32 totalPermutations = (u32)getHeadlessOption("permutations");
+    u32 streamedTextures = (u32)getHeadlessOption("streamedTextures");
+    u32 editInterval = (u32)getHeadlessOption("editInterval");
+    if (totalPermutations > HEADLESS_MAX_PERMUTATIONS) {
+        totalPermutations = HEADLESS_MAX_PERMUTATIONS;
+    }
+    if (!totalDraws) {
+        totalDraws = 1;
+    }
+
+    initializeHeadlessOS();
+    os.initializeWorkQueue(&assetQueue, os.totalCores > 1 ? os.totalCores - 1 : 1);
+    WorkQueue uploadQueue;
+    os.initializeWorkQueue(&uploadQueue, os.totalCores > 1 ? os.totalCores - 1 : 1);
+    //the main thread records alongside the workers
+    WorkQueue recordQueue;
+    if (recordingThreads) {
+        os.initializeWorkQueue(&recordQueue, recordingThreads - 1);
+    }
+    WorkQueue pipelineQueue;
+    os.initializeWorkQueue(&pipelineQueue, os.totalCores > 1 ? os.totalCores - 1 : 1);
+    WorkQueue streamingQueue;
+    os.initializeWorkQueue(&streamingQueue, 1);
+
+    u32 memorySize = MEGABYTE(128);
+    void* memory = mmap(0, memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return 1;
+    }
+    MemoryArena arena = createMemoryArena(memory, memorySize);
+
+    NullRenderSettings settings = {};
+    settings.getMicroseconds = linuxGetMicroseconds;
+    settings.sleepMicroseconds = linuxSleepMicroseconds;
+    settings.totalBackBuffers = 2;
+    settings.width = width;
+    settings.height = height;
+    settings.submitLatency = getHeadlessOption("submitLatency");
+    settings.commandCost = 1;
+    //the scene is a single draw, it carries the gpu frame cost so the frame's timestamps measure it
+    settings.drawCost = getHeadlessOption("gpuCost") / totalDraws;
+    settings.copyBandwidth = getHeadlessOption("copyBandwidth");
+    settings.pipelineCompileCost = getHeadlessOption("compileCost");
+
+    RenderBackend backend;
+    FramePacer pacer;
+    UploadRing uploads;
+    UploadScheduler scheduler;
+    ScratchScene scene;
+    RenderResource geometry;
+    DescriptorAllocator resourceDescriptors;
+    DescriptorAllocator samplerDescriptors;
+    CommandListPool commandLists;
+    RenderResource graphSource;
+    PipelineCache pipelineCache;
+    u8* geometrySource = (u8*)pushSize(&arena, HEADLESS_GEOMETRY_SOURCE_SIZE);
+    if (!geometrySource || !initializeNullRenderBackend(&backend, &settings, &arena) ||
+        !initializeFramePacer(&pacer, &backend, framesInFlight) ||
+        !initializeUploadRing(&uploads, &backend, HEADLESS_UPLOAD_RING_SIZE) ||
+        !initializeUploadScheduler(&scheduler, &backend, HEADLESS_STAGING_SIZE, HEADLESS_COPY_BUDGET) ||
+        !initializeModelStore(&modelStore, &backend, &scheduler, HEADLESS_MODEL_VERTEX_CHUNK,
+                              HEADLESS_MODEL_INDEX_CHUNK, HEADLESS_MAX_MODELS, HEADLESS_MODEL_SOURCE_SIZE,
+                              HEADLESS_MODEL_SCRATCH_SIZE, &arena) ||
+        !backend.createBuffer(&backend, HEADLESS_GEOMETRY_SIZE, RENDER_HEAP_DEFAULT, RENDER_STATE_COMMON, &geometry) ||
+        !initializeDescriptorAllocator(&resourceDescriptors, &backend, RENDER_DESCRIPTORS_RESOURCE,
+                                       HEADLESS_PERSISTENT_DESCRIPTORS, HEADLESS_TRANSIENT_DESCRIPTORS, &arena) ||
+        !initializeTextureStore(&textureStore, &backend, &scheduler, &resourceDescriptors, HEADLESS_MAX_TEXTURES,
+                                HEADLESS_TEXTURE_SOURCE_SIZE, HEADLESS_TEXTURE_SCRATCH_SIZE, &arena) ||
+        !initializeTextureStreamingManager(&textureStreaming, HEADLESS_MAX_TEXTURES, HEADLESS_STREAMING_BUDGET, &arena,
+                                           &os, &streamingQueue) ||
+        !initializeTextureStreamingStore(&textureStreamingStore, &textureStreaming, &textureStore,
+                                         HEADLESS_STREAMING_READ_SIZE, &arena) ||
+        !initializeDescriptorAllocator(&samplerDescriptors, &backend, RENDER_DESCRIPTORS_SAMPLER,
+                                       HEADLESS_SAMPLER_DESCRIPTORS, 0, &arena) ||
+        (recordingThreads && !initializeCommandListPool(&commandLists, &pacer, &os, &recordQueue, recordingThreads)) ||
+        !backend.createBuffer(&backend, SAMPLE_GRAPH_COPY_SIZE, RENDER_HEAP_DEFAULT, RENDER_STATE_COPY_SOURCE,
+                              &graphSource) ||
+        !initializePipelineCache(&pipelineCache, &backend, &os, &pipelineQueue, &arena,
+                                 totalPermutations ? HEADLESS_PIPELINE_LIBRARY : 0, HEADLESS_PIPELINE_LIBRARY_SIZE)) {
+        printf("backend setup failed\n");
+        return 1;
+    }
+    if (getHeadlessOption("lowLatency")) {
+        setFramePacerLowLatency(&pacer, true, getHeadlessOption("lowLatency"));
+    }
+    NullRenderDevice* device = (NullRenderDevice*)backend.data;
+    //models are drawn with the quantized input layout below
+    modelStore.quantize = HEADLESS_QUANTIZE_MODELS;
+    if (!initializeScratchScene(&scene, &os, &modelStore, &textureStore.scratch)) {
+        printf("scene setup failed\n");
+        return 1;
+    }
+    scene.totalDraws = totalDraws;
+    if (!initializeAssetRegistry(&assetRegistry, HEADLESS_REGISTRY_ASSETS, HEADLESS_REGISTRY_NAMES, &arena)) {
+        printf("asset registry setup failed\n");
+        return 1;
+    }
+    addScratchStreamedModels(&scene, &os, &assetRegistry, streamedTextures, &arena, &textureStore.scratch);
+    commandLists.resources = &resourceDescriptors.heap;
+    commandLists.samplers = &samplerDescriptors.heap;
+    for (u32 filter = RENDER_FILTER_POINT; filter <= RENDER_FILTER_LINEAR; filter++) {
+        for (u32 addressMode = RENDER_ADDRESS_WRAP; addressMode <= RENDER_ADDRESS_CLAMP; addressMode++) {
+            backend.createSampler(&backend, &samplerDescriptors.heap, allocateDescriptor(&samplerDescriptors), filter,
+                                  addressMode);
+        }
+    }
+
+    //the shader goes through the same asset path as the windowed build, with edits the copy is watched instead
+    const s8* shaderFile = "shader.hlsl";
+    u8* editSource = 0;
+    u32 editSourceSize = 0;
+    if (editInterval) {
+        editSource = (u8*)pushSize(&arena, HEADLESS_RELOAD_SOURCE_SIZE);
+        if (!editSource ||
+            !os.readFileIntoBoundedBuffer(shaderFile, editSource, HEADLESS_RELOAD_SOURCE_SIZE / 2, &editSourceSize) ||
+            !os.writeToFile(HEADLESS_RELOAD_SHADER, editSource, editSourceSize)) {
+            printf("could not copy shader.hlsl\n");
+            return 1;
+        }
+        shaderFile = HEADLESS_RELOAD_SHADER;
+    }
+    //a directory that cannot be made leaves every cache load and store failing, which only costs the cooks
+    mkdir(HEADLESS_COOK_CACHE_DIRECTORY, 0755);
+    initializeCookCacheDirectory(&cookDirectory, &os, HEADLESS_COOK_CACHE_DIRECTORY, HEADLESS_COOK_CACHE_BUDGET,
+                                 &arena);
+    cookCache.local = createCookCacheDirectoryBackend(&cookDirectory);
+    initializeAssetDatabase(&assetDatabase, &os, ".", MEGABYTE(1), &arena, &assetQueue, &cookCache);
+    if (editInterval && !assetDatabase.watcher) {
+        printf("could not watch the working directory\n");
+        return 1;
+    }
+    //the same pipeline state dx12_scratch asks for
+    HeadlessShader shader = {};
+    shader.cache = &pipelineCache;
+    shader.pipeline = PIPELINE_CACHE_NONE;
+    shader.fallback = PIPELINE_CACHE_NONE;
+    if (modelStore.quantize) {
+        VertexAttributeLayout modelLayout = getModel3DVertexLayout();
+        shader.desc.totalAttributes = getQuantizedVertexAttributes(&modelLayout, shader.desc.attributes);
+    } else {
+        shader.desc.attributes[0].semantic = "POSITION";
+        shader.desc.attributes[0].format = RENDER_FORMAT_R32G32B32_FLOAT;
+        shader.desc.totalAttributes = 1;
+    }
+    shader.desc.cullMode = RENDER_CULL_BACK;
+    shader.desc.blendMode = RENDER_BLEND_ALPHA;
+    shader.desc.renderTargetFormats[0] = RENDER_FORMAT_R8G8B8A8_UNORM;
+    shader.desc.totalRenderTargets = 1;
+    shader.desc.depthFormat = RENDER_FORMAT_D32_FLOAT;
+    shader.desc.sampleCount = 1;
+    addCookedAsset(&assetDatabase, shaderFile, "headless shader", 1, cookShader, swapShader, &shader);
+    while (shader.pipeline == PIPELINE_CACHE_NONE) {
+        updateAssetDatabase(&assetDatabase);
+        if (assetDatabase.totalCookFailures) {
+            printf("could not read %s\n", shaderFile);
+            return 1;
+        }
+        linuxSleepMicroseconds(1000);
+    }
+
+    //the chain graph is only compiled, for its numbers
+    RenderGraph* frameGraph = pushArray(&arena, RenderGraph, 1);
+    RenderGraph* chainGraph = pushArray(&arena, RenderGraph, 1);
+    SampleGraphPass framePasses[RENDER_GRAPH_MAX_PASSES];
+    SampleGraphPass chainPasses[SAMPLE_CHAIN_PASSES + 1];
+    u32 graphBackBuffer;
+    if (!frameGraph || !chainGraph ||
+        !buildSampleFrameGraph(frameGraph, framePasses, &graphSource, backend.getBackBuffer(&backend, 0),
+                               &graphBackBuffer) ||
+        !buildSampleChainGraph(chainGraph, chainPasses, backend.getBackBuffer(&backend, 0))) {
+        printf("render graph compile failed\n");
+        return 1;
+    }
+
+    if (!isPipelineReady(&pipelineCache, shader.pipeline)) {
+        printf("shader pipeline could not be created: %s\n", device->lastError);
+        return 1;
+    }
+    u32 permutations[HEADLESS_MAX_PERMUTATIONS];
+    for (u32 i = 0; i < totalPermutations; i++) {
+        RenderPipelineDesc desc = shader.desc;
+        desc.cullMode = i % 3;
+        desc.blendMode = i / 3 % 3;
+        desc.wireframe = i / 9 % 2;
+        permutations[i] = requestPipeline(&pipelineCache, &desc);
+    }
+
+    HeadlessUploadJob uploadJobs[HEADLESS_UPLOAD_JOBS];
+    HeadlessDescriptorJob descriptorJobs[HEADLESS_UPLOAD_JOBS];
+    u64 uploadTime = 0;
+    u64 descriptorTime = 0;
+    u64 recordTime = 0;
+    u64 geometryOffset = 0;
+    u64 droppedGeometry = 0;
+    //the edit waiting to be seen was written at editTime, while shader.pipeline was editPipeline
+    u64 editTime = 0;
+    u32 editPipeline = PIPELINE_CACHE_NONE;
+    u32 totalEdits = 0;
+    u32 visibleEdits = 0;
+    u64 totalEditLatency = 0;
+    u64 maxEditLatency = 0;
+    u64 runStart = linuxGetMicroseconds();
+    for (u32 frame = 0; frame < totalFrames; frame++) {
+        if (editInterval && !editTime && frame % editInterval == editInterval - 1) {
+            s8* edit = (s8*)editSource + editSourceSize;
+            u32 editLength = (u32)snprintf(edit, HEADLESS_RELOAD_SOURCE_SIZE / 2, "//edit %u\n", totalEdits);
+            u32 editSize = editSourceSize + editLength;
+            editPipeline = shader.pipeline;
+            editTime = linuxGetMicroseconds();
+            if (os.writeToFile(HEADLESS_RELOAD_SHADER, editSource, editSize)) {
+                totalEdits++;
+            } else {
+                editTime = 0;
+            }
+        }
+        updateAssetDatabase(&assetDatabase);
+        bool editVisible =
+            editTime && shader.pipeline != editPipeline && isPipelineReady(&pipelineCache, shader.pipeline);
+
+        RenderPipeline* pipeline = getPipeline(&pipelineCache, shader.pipeline, shader.fallback);
+        RenderPipeline* drawPipeline = pipeline;
+        if (totalPermutations) {
+            drawPipeline = getPipeline(&pipelineCache, permutations[frame % totalPermutations], shader.pipeline);
+        }
+        RenderCommandList* list = beginRenderFrame(&pacer, pipeline);
+        beginUploadRingFrame(&uploads, pacer.completedFrames);
+        beginDescriptorFrame(&resourceDescriptors, pacer.completedFrames);
+        beginModelStoreFrame(&modelStore, pacer.completedFrames);
+        beginPipelineCacheFrame(&pipelineCache, pacer.completedFrames);
+        streamScratchScene(&scene, &textureStreaming, frame, (f32)height);
+        updateTextureStreaming(&textureStreaming, &textureStore.scratch);
+        beginTextureStoreFrame(&textureStore);
+        backend.setDescriptorHeaps(list, &resourceDescriptors.heap, &samplerDescriptors.heap);
+        for (u32 requested = 0; requested < geometryBytes; requested += HEADLESS_GEOMETRY_PIECE) {
+            u8* source = geometrySource + geometryOffset % HEADLESS_GEOMETRY_SOURCE_SIZE;
+            if (!requestUpload(&scheduler, &geometry, geometryOffset, source, HEADLESS_GEOMETRY_PIECE)) {
+                droppedGeometry++;
+            }
+            geometryOffset = (geometryOffset + HEADLESS_GEOMETRY_PIECE) % HEADLESS_GEOMETRY_SIZE;
+        }
+        updateUploadScheduler(&scheduler);
+        u64 workStart = linuxGetMicroseconds();
+        while (linuxGetMicroseconds() - workStart < cpuCost) {
+        }
+        if (constantBlocks) {
+            u64 uploadStart = linuxGetMicroseconds();
+            for (u32 i = 0; i < HEADLESS_UPLOAD_JOBS; i++) {
+                uploadJobs[i].ring = &uploads;
+                uploadJobs[i].totalBlocks = constantBlocks / HEADLESS_UPLOAD_JOBS;
+                os.addWorkQueueEntry(&uploadQueue, writeUploadConstants, &uploadJobs[i]);
+            }
+            os.completeWorkQueueEntries(&uploadQueue);
+            uploadTime += linuxGetMicroseconds() - uploadStart;
+        }
+        if (descriptorChurn) {
+            u64 descriptorStart = linuxGetMicroseconds();
+            for (u32 i = 0; i < HEADLESS_UPLOAD_JOBS; i++) {
+                descriptorJobs[i].backend = &backend;
+                descriptorJobs[i].descriptors = &resourceDescriptors;
+                descriptorJobs[i].ring = &uploads;
+                descriptorJobs[i].totalChurn = descriptorChurn / HEADLESS_UPLOAD_JOBS;
+                os.addWorkQueueEntry(&uploadQueue, churnDescriptors, &descriptorJobs[i]);
+            }
+            os.completeWorkQueueEntries(&uploadQueue);
+            descriptorTime += linuxGetMicroseconds() - descriptorStart;
+        }
+        if (useRenderGraph) {
+            setRenderGraphImport(frameGraph, graphBackBuffer, pacer.backBuffer);
+            if (!executeRenderGraph(frameGraph, list)) {
+                printf("render graph transients could not be created\n");
+                return 1;
+            }
+        }
+        u64 recordStart = linuxGetMicroseconds();
+        if (!recordingThreads) {
+            drawScratchScene(&scene, list, pacer.backBuffer, drawPipeline);
+        } else if (prepareScratchScene(&scene, list, pacer.backBuffer)) {
+            recordCommandListsInParallel(&commandLists, drawPipeline, scene.totalDraws, 1, recordScratchDraws, &scene);
+        }
+        recordTime += linuxGetMicroseconds() - recordStart;
+        endDescriptorFrame(&resourceDescriptors, pacer.frameNumber + 1);
+        endModelStoreFrame(&modelStore, pacer.frameNumber + 1);
+        endPipelineCacheFrame(&pipelineCache, pacer.frameNumber + 1);
+        endUploadRingFrame(&uploads, pacer.frameNumber + 1);
+        endRenderFrame(&pacer);
+        if (editVisible) {
+            u64 latency = linuxGetMicroseconds() - editTime;
+            totalEditLatency += latency;
+            maxEditLatency = latency > maxEditLatency ? latency : maxEditLatency;
+            visibleEdits++;
+            editTime = 0;
+        }
+    }
+    flushFramePacer(&pacer);
+    //reads still in flight finish before their files go
+    os.completeWorkQueueEntries(&streamingQueue);
+    flushUploadScheduler(&scheduler);
+    destroyRenderGraph(frameGraph, &backend);
+    bool savedPipelines = !totalPermutations || savePipelineCache(&pipelineCache, HEADLESS_PIPELINE_LIBRARY, &arena);
+    u32 usedPipelineEntries = pipelineCache.totalEntries;
+    destroyPipelineCache(&pipelineCache);
+    //a batch still cooking stores into the directory, it finishes before the index is written
+    os.completeWorkQueueEntries(&assetQueue);
+    bool savedCooks = saveCookCacheDirectoryIndex(&cookDirectory, &arena);
+    GpuBufferPoolStatistics vertexPool = getModelStoreStatistics(&modelStore, MODEL_STORE_VERTICES);
+    GpuBufferPoolStatistics indexPool = getModelStoreStatistics(&modelStore, MODEL_STORE_INDICES);
+    os.destroyModel3D(&scene.triangle);
+    destroyModelStore(&modelStore);
+    destroyTextureStore(&textureStore);
+    for (u32 i = 0; i < streamedTextures && i < SCRATCH_MAX_STREAMED_MODELS; i++) {
+        s8 name[sizeof(SCRATCH_STREAMED_NAME)];
+        getScratchStreamedTextureName(i, name);
+        remove(name);
+    }
+    if (editInterval) {
+        remove(HEADLESS_RELOAD_SHADER);
+    }
+    u64 runTime = linuxGetMicroseconds() - runStart;
+
+    NullRenderStats* stats = &device->stats;
+    FramePacingStats* pacing = &pacer.stats;
+    u32 frames = totalFrames ? totalFrames : 1;
+    u64 retired = pacing->frames ? pacing->frames : 1;
+    printf("frames %u, %u in flight, %.1f us per frame\n", totalFrames, framesInFlight, (f64)runTime / frames);
+    printf("cpu wait %.1f us per frame, %.1f us of it on present\n", (f64)pacing->cpuWaitTime / frames,
+           (f64)pacing->presentWaitTime / frames);
+    if (pacer.lowLatency) {
+        printf("low latency sleep %.1f us per frame\n", (f64)pacing->lowLatencySleepTime / frames);
+    }
+    printf("gpu busy %.1f us, idle %.1f us per frame\n", (f64)pacing->gpuBusyTime / retired,
+           (f64)pacing->gpuIdleTime / retired);
+    printf("latency %.1f us average, %llu us max\n", (f64)pacing->totalLatency / retired, pacing->maxLatency);
+    UploadRingStats* uploadStats = &uploads.stats;
+    printf("upload ring %u KB peak frame, %u KB peak in flight, %llu failed allocations\n",
+           uploadStats->peakFrameBytes / 1024, uploadStats->peakUsedBytes / 1024, uploadStats->failedAllocations);
+    if (uploadTime) {
+        u32 blocksPerFrame = constantBlocks / HEADLESS_UPLOAD_JOBS * HEADLESS_UPLOAD_JOBS;
+        printf("constants %.1f million allocations per second across %u threads\n",
+               (f64)blocksPerFrame * totalFrames / uploadTime, os.totalCores);
+    }
+    UploadSchedulerStats* schedulerStats = &scheduler.stats;
+    u64 completedUploads = schedulerStats->completedRequests ? schedulerStats->completedRequests : 1;
+    printf("upload scheduler %llu requests, %llu dropped, %.1f KB per frame in %llu batches\n",
+           schedulerStats->requests, droppedGeometry, (f64)schedulerStats->uploadedBytes / 1024 / frames,
+           schedulerStats->batches);
+    printf("%llu copies after merging %llu, %.2f frames from request to copied\n", schedulerStats->copies,
+           schedulerStats->mergedCopies, (f64)schedulerStats->totalLatencyFrames / completedUploads);
+    printf("%llu frames held back by the budget, %llu by a busy copy queue\n", schedulerStats->budgetLimitedFrames,
+           schedulerStats->copyQueueBusyFrames);
+    if (descriptorTime) {
+        DescriptorAllocatorStats* descriptorStats = &resourceDescriptors.stats;
+        printf("descriptors %llu retired, %llu failed allocations, %.1f million per second across %u threads\n",
+               descriptorStats->retiredDescriptors, descriptorStats->failedAllocations,
+               (f64)descriptorStats->retiredDescriptors / descriptorTime, os.totalCores);
+    }
+    if (recordingThreads) {
+        CommandListPoolStats* recordStats = &commandLists.stats;
+        printf("recording %u draws on %u threads in %.1f us per frame, %.1f us of it in jobs\n", totalDraws,
+               recordingThreads, (f64)recordTime / frames, (f64)recordStats->recordTime / frames);
+    } else {
+        printf("recording %u draws on the main thread in %.1f us per frame\n", totalDraws, (f64)recordTime / frames);
+    }
+    PipelineCacheStats* pipelineStats = &pipelineCache.stats;
+    u32 builtPipelines = pipelineStats->compiled + pipelineStats->loaded;
+    printf("pipelines %llu requested, %llu deduplicated, %u compiled, %u loaded from the library, %u failed\n",
+           pipelineStats->requests, pipelineStats->deduplicated, pipelineStats->compiled, pipelineStats->loaded,
+           pipelineStats->failed);
+    printf("pipelines %llu retired, %llu refused, %u of %u entries used\n", pipelineStats->retired,
+           pipelineStats->refused, usedPipelineEntries, PIPELINE_CACHE_MAX_PIPELINES);
+    printf("%.1f us per pipeline, %llu fallbacks to a pipeline still compiling, library %s\n",
+           (f64)pipelineStats->compileTime / (builtPipelines ? builtPipelines : 1), pipelineStats->fallbacks,
+           !totalPermutations ? "not used" : savedPipelines ? "saved" : "could not be saved");
+    if (editInterval) {
+        printf("shader edits %u, %u drawn, %.1f ms average and %.1f ms max from the write to the frame drawing them\n",
+               totalEdits, visibleEdits, (f64)totalEditLatency / 1000 / (visibleEdits ? visibleEdits : 1),
+               (f64)maxEditLatency / 1000);
+        printf("shader reloads %u, %llu ms max from the change being seen to the swap, %u failed cooks\n",
+               assetDatabase.totalReloads, assetDatabase.maxReloadLatency, assetDatabase.totalCookFailures);
+    }
+    printf("cook cache %u hits, %u misses, %u entries in %llu KB, index %s\n", cookCache.hits, cookCache.misses,
+           cookDirectory.totalEntries, cookDirectory.totalBytes / 1024, savedCooks ? "saved" : "could not be saved");
+    ModelStoreStats* modelStats = &modelStore.stats;
+    printf("models %llu created, %llu failed, %llu destroyed, %llu KB uploaded\n", modelStats->models,
+           modelStats->failedModels, modelStats->retiredModels, modelStats->uploadedBytes / 1024);
+    printf("model vertices %llu KB in %u chunks, indices %llu KB in %u chunks\n", vertexPool.usedBytes / 1024,
+           vertexPool.totalChunks, indexPool.usedBytes / 1024, indexPool.totalChunks);
+    TextureStoreStats* textureStats = &textureStore.stats;
+    printf("textures %llu created, %llu failed, %llu KB uploaded, %llu source flushes\n", textureStats->textures,
+           textureStats->failedTextures, textureStats->uploadedBytes / 1024, textureStats->sourceFlushes);
+    TextureStreamingStatistics* streamingStats = &textureStreaming.stats;
+    printf("streaming %u textures in %llu KB, %.1f%% hit rate, %llu KB streamed, %llu KB evicted, "
+           "%llu loads deferred\n",
+           textureStreaming.totalTextures, textureStreaming.budgetBytes / 1024,
+           100.0 * getTextureStreamingHitRate(&textureStreaming), streamingStats->bytesStreamed / 1024,
+           streamingStats->bytesEvicted / 1024, streamingStats->loadsDeferred);
+    printf("streaming %llu level updates, %llu view changes, %llu failed\n", textureStats->levelUpdates,
+           textureStats->viewChanges, textureStats->failedViewChanges + textureStreamingStore.failedUpdates);
+    printf("sky %u cubes baked, ambient %.3f %.3f %.3f\n", totalTextureCubes, scene.ambient.x, scene.ambient.y,
+           scene.ambient.z);
+    printRenderGraphStats("frame", &frameGraph->stats);
+    printRenderGraphStats("chain", &chainGraph->stats);
+    printf("submissions %llu, commands %llu, draws %llu, barriers %llu, presents %llu\n", stats->submissions,
+           stats->commands, stats->draws, stats->barriers, stats->presents);
+    printf("%llu split barriers, %llu aliasing barriers\n", stats->splitBarriers, stats->aliasingBarriers);
+    if (stats->errors) {
+        printf("%u invalid commands, last: %s\n", stats->errors, device->lastError);
+        return 1;
+    }
+    return 0;
+}
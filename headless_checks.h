@@ -0,0 +1,3445 @@
+#pragma once
+
+#include "compression.h"
+#include "asset_database.h"
+#include "null_render_backend.h"
+#include "model_store.h"
+#include "texture_store.h"
+#include "image_loaders.h"
+#include "texture_streaming.h"
+#include "meshlets.h"
+#include "cubemap_prefilter.h"
+#include "asset_registry.h"
+#include "text_layout.h"
+#include "font_atlas.h"
+#include "descriptor_allocator.h"
+#include "render_graph.h"
+#include "pipeline_cache.h"
+#include "command_list_pool.h"
+
+//Checks for the asset and renderer modules, run by headless check.
+//Each check drives one module on data it knows the answer for, prints what it measured and returns false when a
+//result is wrong, so a run of all of them is a regression test as well as a report. Checks only use the platform
+//layer, the work queue and the arena they are given, and leave the arena as they found it. Checks that need a GPU make
+//their own null render backend in the arena, on its virtual clock so they run the same every time. The platform layer's
+//texture store, which os's texture hooks create in, is on a null backend too, so what the hooks made can be read back.
+
+#define HEADLESS_CHECK_FILE "headless_check.bin"
+
+struct HeadlessCheckContext {
+    OSInterface* os;
+    WorkQueue* queue;
+    MemoryArena* arena;
+    u64 (*getMicroseconds)();
+    TextureStore* textures;
+};
+
+struct HeadlessCheck {
+    const s8* name;
+    bool (*run)(HeadlessCheckContext* context);
+};
+
+//round trips a buffer through compressAsset and decompressAsset, and through a file and readAssetIntoBuffer
+static bool checkCompressionRoundTrip(HeadlessCheckContext* context, const s8* name, u8* data, u32 dataSize,
+                                      u32 chunkSize){
+    OSInterface* os = context->os;
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 capacity = compressAssetBound(dataSize, chunkSize);
+    u8* compressed = (u8*)pushSize(arena, capacity);
+    u8* decompressed = (u8*)pushSize(arena, dataSize + 1);
+    if(!compressed || !decompressed){
+        printf("compression %s: out of memory\n", name);
+        arena->used = arenaMark;
+        return false;
+    }
+    u64 start = context->getMicroseconds();
+    u32 compressedSize = compressAsset(data, dataSize, compressed, capacity, arena, chunkSize);
+    u64 compressTime = context->getMicroseconds() - start;
+    start = context->getMicroseconds();
+    bool decoded = compressedSize &&
+                   decompressAsset(compressed, compressedSize, decompressed, dataSize, arena, os, context->queue);
+    u64 decompressTime = context->getMicroseconds() - start;
+    bool success = decoded;
+    for(u32 i = 0; success && i < dataSize; i++){
+        success = decompressed[i] == data[i];
+    }
+
+    //a buffer one byte short has to be refused, and the file path decodes in place over the bytes it read
+    u32 readSize = 0;
+    success = success && writeCompressedAssetToFile(os, HEADLESS_CHECK_FILE, data, dataSize, arena, chunkSize) &&
+              (!dataSize || !readAssetIntoBuffer(os, HEADLESS_CHECK_FILE, decompressed, dataSize - 1, &readSize,
+                                                 arena)) &&
+              readAssetIntoBuffer(os, HEADLESS_CHECK_FILE, decompressed, dataSize + 1, &readSize, arena,
+                                  context->queue) && readSize == dataSize;
+    for(u32 i = 0; success && i < dataSize; i++){
+        success = decompressed[i] == data[i];
+    }
+    remove(HEADLESS_CHECK_FILE);
+
+    printf("compression %s: %u KB to %u KB, ratio %.2f, compress %.1f MB/s, decompress %.1f MB/s%s\n", name,
+           dataSize / 1024, compressedSize / 1024, compressedSize ? (f64)dataSize / compressedSize : 0.0,
+           (f64)dataSize / (compressTime ? compressTime : 1), (f64)dataSize / (decompressTime ? decompressTime : 1),
+           success ? "" : ", ROUND TRIP FAILED");
+    arena->used = arenaMark;
+    return success;
+}
+
+//headers that do not add up to the chunks behind them must be refused before anything is decoded into dst
+static bool checkCompressionRejectsCorruptAssets(HeadlessCheckContext* context, u8* data, u32 dataSize){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 chunkSize = KILOBYTE(16);
+    u32 capacity = compressAssetBound(dataSize, chunkSize);
+    u8* compressed = (u8*)pushSize(arena, capacity);
+    u8* decompressed = (u8*)pushSize(arena, dataSize * 2);
+    u32 compressedSize = compressed ? compressAsset(data, dataSize, compressed, capacity, arena, chunkSize) : 0;
+    if(!compressedSize || !decompressed){
+        arena->used = arenaMark;
+        return false;
+    }
+    CompressedAssetHeader* header = (CompressedAssetHeader*)compressed;
+    bool success = true;
+    //claims more bytes than its chunks produce, which used to leave the tail of dst as it was
+    header->uncompressedSize += chunkSize;
+    success &= !decompressAsset(compressed, compressedSize, decompressed, dataSize * 2, arena);
+    header->uncompressedSize -= chunkSize;
+    //the last chunk cut off
+    success &= !decompressAsset(compressed, compressedSize - 1, decompressed, dataSize, arena);
+    //no room for the whole asset
+    success &= !decompressAsset(compressed, compressedSize, decompressed, dataSize - 1, arena);
+    //more chunks listed than the data holds
+    header->totalChunks += 1;
+    success &= !decompressAsset(compressed, compressedSize, decompressed, dataSize * 2, arena);
+    header->totalChunks -= 1;
+    success &= decompressAsset(compressed, compressedSize, decompressed, dataSize, arena);
+    printf("compression corrupt headers %s\n", success ? "rejected" : "NOT REJECTED");
+    arena->used = arenaMark;
+    return success;
+}
+
+//the repo's own sources stand in for text assets, next to buffers at both ends of what compresses and a float grid
+//like the vertex data models carry
+static bool checkCompression(HeadlessCheckContext* context){
+    OSInterface* os = context->os;
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 bufferSize = MEGABYTE(1);
+    u8* buffer = (u8*)pushSize(arena, bufferSize);
+    if(!buffer){
+        return false;
+    }
+    bool success = true;
+    const s8* sources[] = {"shader.hlsl", "mathematics.h", "null_render_backend.h", "headless.cpp"};
+    for(u32 i = 0; i < sizeof(sources) / sizeof(sources[0]); i++){
+        u32 size = 0;
+        if(!os->readFileIntoBoundedBuffer(sources[i], buffer, bufferSize, &size)){
+            printf("compression %s: could not be read\n", sources[i]);
+            success = false;
+            continue;
+        }
+        success &= checkCompressionRoundTrip(context, sources[i], buffer, size, KILOBYTE(16));
+    }
+
+    setMemory(buffer, bufferSize);
+    success &= checkCompressionRoundTrip(context, "zeros", buffer, bufferSize, LZ_DEFAULT_CHUNK_SIZE);
+    u32 seed = 0x2545F491;
+    for(u32 i = 0; i < bufferSize; i++){
+        seed = xorshift(seed);
+        buffer[i] = (u8)(seed >> 24);
+    }
+    success &= checkCompressionRoundTrip(context, "noise", buffer, bufferSize, LZ_DEFAULT_CHUNK_SIZE);
+    f32* grid = (f32*)buffer;
+    u32 gridSide = 128;
+    for(u32 i = 0; i < gridSide * gridSide; i++){
+        f32* vertex = grid + i * 8;
+        vertex[0] = (f32)(i % gridSide) / gridSide;
+        vertex[1] = 0;
+        vertex[2] = (f32)(i / gridSide) / gridSide;
+        vertex[3] = vertex[0];
+        vertex[4] = vertex[2];
+        vertex[5] = 0;
+        vertex[6] = 1;
+        vertex[7] = 0;
+    }
+    success &= checkCompressionRoundTrip(context, "vertex grid", buffer, gridSide * gridSide * 8 * sizeof(f32),
+                                         LZ_DEFAULT_CHUNK_SIZE);
+    success &= checkCompressionRoundTrip(context, "empty", buffer, 0, LZ_DEFAULT_CHUNK_SIZE);
+    success &= checkCompressionRejectsCorruptAssets(context, buffer, gridSide * gridSide * 8 * sizeof(f32));
+    arena->used = arenaMark;
+    return success;
+}
+
+static bool initializeCheckBackend(RenderBackend* backend, MemoryArena* arena){
+    NullRenderSettings settings = {};
+    settings.totalBackBuffers = 2;
+    settings.width = 64;
+    settings.height = 64;
+    settings.copyBandwidth = 4000;
+    return initializeNullRenderBackend(backend, &settings, arena);
+}
+
+//the null backend's gpu addresses are its memory, so a range's bytes can be read back as they landed
+static bool isModelStoreRangeEqual(ModelStore* store, u32 pool, u32 allocation, void* data, u32 size){
+    RenderResource range = getModelStoreRange(&store->pools[pool], allocation);
+    u8* bytes = (u8*)range.gpuAddress;
+    for(u32 i = 0; i < size; i++){
+        if(bytes[i] != ((u8*)data)[i]){
+            return false;
+        }
+    }
+    return range.size >= size;
+}
+
+//A pool asked for a block an empty chunk cannot hold once aligned must not keep the chunk it made for it, and models
+//retired from the store go back to its pools only once the fence passes the frame that retired them.
+static bool checkModelStore(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    bool success = true;
+
+    GpuBufferPool* bare = pushStruct(arena, GpuBufferPool);
+    success &= bare && initializeGpuBufferPool(bare, KILOBYTE(1), 16, arena) &&
+               allocateGpuBuffer(bare, KILOBYTE(1), 64) == GPU_ALLOCATION_INVALID &&
+               getGpuBufferPoolStatistics(bare).totalChunks == 0;
+    printf("model store unfit allocation %s its chunk\n", success ? "released" : "KEPT");
+
+    RenderBackend* backend = pushStruct(arena, RenderBackend);
+    UploadScheduler* uploads = pushStruct(arena, UploadScheduler);
+    ModelStore* store = pushStruct(arena, ModelStore);
+    u32 totalModels = 96;
+    Model3D* models = pushArray(arena, Model3D, totalModels);
+    u32* vertexCounts = pushArray(arena, u32, totalModels);
+    u32 maxVertices = 512;
+    f32* vertices = pushArray(arena, f32, maxVertices * 8);
+    u16* indices = pushArray(arena, u16, maxVertices * 3);
+    if(!bare || !backend || !uploads || !store || !models || !vertexCounts || !vertices || !indices || !initializeCheckBackend(backend, arena) ||
+       !initializeUploadScheduler(uploads, backend, MEGABYTE(1), MEGABYTE(1)) ||
+       !initializeModelStore(store, backend, uploads, KILOBYTE(64), KILOBYTE(32), totalModels, KILOBYTE(128), 0, arena)){
+        printf("model store: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+
+    u32 seed = 0x9E3779B9;
+    for(u32 i = 0; i < maxVertices * 8; i++){
+        seed = xorshift(seed);
+        vertices[i] = (f32)(seed & 0xFFFF) / 0xFFFF;
+    }
+    //every model has at least 16 vertices, so these indices are valid for all of them
+    for(u32 i = 0; i < maxVertices * 3; i++){
+        indices[i] = (u16)(i % 16);
+    }
+    //no scratch for the optimizer, so the ranges hold the bytes as given
+    //sizes vary so the ranges interleave, and the copies fill up and flush more than once
+    for(u32 i = 0; i < totalModels; i++){
+        seed = xorshift(seed);
+        u32 vertexCount = 16 + seed % (maxVertices - 16);
+        models[i] = createStoredModel3D(store, vertices, vertexCount * MODEL3D_VERTEX_SIZE, indices,
+                                        vertexCount * 3 * sizeof(u16), MODEL3D_VERTEX_SIZE, sizeof(u16));
+        success &= isStoredModel3DValid(&models[i]);
+    }
+    flushUploadScheduler(uploads);
+    for(u32 i = 0; success && i < totalModels; i++){
+        success = isModelStoreRangeEqual(store, MODEL_STORE_VERTICES, models[i].vertexAllocation, vertices,
+                                         models[i].totalIndices / 3 * MODEL3D_VERTEX_SIZE) &&
+                  isModelStoreRangeEqual(store, MODEL_STORE_INDICES, models[i].indexAllocation, indices,
+                                         models[i].totalIndices * sizeof(u16));
+    }
+    GpuBufferPoolStatistics full = getModelStoreStatistics(store, MODEL_STORE_VERTICES);
+
+    for(u32 i = 0; i < totalModels; i += 2){
+        vertexCounts[i] = models[i].totalIndices / 3;
+        destroyStoredModel3D(store, &models[i]);
+    }
+    endModelStoreFrame(store, 1);
+    beginModelStoreFrame(store, 0);
+    bool heldBack = getModelStoreStatistics(store, MODEL_STORE_VERTICES).usedBytes == full.usedBytes;
+    beginModelStoreFrame(store, 1);
+    GpuBufferPoolStatistics half = getModelStoreStatistics(store, MODEL_STORE_VERTICES);
+    success &= heldBack && half.usedBytes < full.usedBytes && half.totalAllocations == totalModels / 2;
+    //the freed ranges take most of the same models again, only what no longer fits their holes needs new chunks
+    for(u32 i = 0; i < totalModels; i += 2){
+        u32 vertexCount = vertexCounts[i];
+        models[i] = createStoredModel3D(store, vertices, vertexCount * MODEL3D_VERTEX_SIZE, indices,
+                                        vertexCount * 3 * sizeof(u16), MODEL3D_VERTEX_SIZE, sizeof(u16));
+        success &= isStoredModel3DValid(&models[i]);
+    }
+    flushUploadScheduler(uploads);
+    GpuBufferPoolStatistics refilled = getModelStoreStatistics(store, MODEL_STORE_VERTICES);
+    success &= refilled.usedBytes == full.usedBytes &&
+               refilled.reservedBytes - full.reservedBytes < (full.usedBytes - half.usedBytes) / 2;
+    //Each copy fits the sources on its own and its pool's chunk, both together do not fit the sources, so the model is
+    //refused before either is pushed instead of having the copies land on each other.
+    ModelStore* tight = pushStruct(arena, ModelStore);
+    u32 bigVertices = KILOBYTE(40) / MODEL3D_VERTEX_SIZE;
+    u32 bigIndices = KILOBYTE(30) / sizeof(u16);
+    f32* bigVertexData = pushArray(arena, f32, bigVertices * 8);
+    u16* bigIndexData = pushArray(arena, u16, bigIndices);
+    bool refused = false;
+    if(tight && bigVertexData && bigIndexData &&
+       initializeModelStore(tight, backend, uploads, KILOBYTE(64), KILOBYTE(32), 4, KILOBYTE(64), 0, arena)){
+        setMemory(bigVertexData, bigVertices * MODEL3D_VERTEX_SIZE);
+        for(u32 i = 0; i < bigIndices; i++){
+            bigIndexData[i] = (u16)(i % bigVertices);
+        }
+        Model3D big = createStoredModel3D(tight, bigVertexData, bigVertices * MODEL3D_VERTEX_SIZE, bigIndexData,
+                                          bigIndices * sizeof(u16), MODEL3D_VERTEX_SIZE, sizeof(u16));
+        refused = !isStoredModel3DValid(&big) && tight->stats.failedModels == 1;
+        destroyModelStore(tight);
+    }
+    success &= refused;
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    success &= !device->stats.errors;
+    printf("model store copies too big to share the sources %s\n", refused ? "refused" : "NOT REFUSED");
+    printf("model store %u models, %llu KB in %u chunks, %llu KB after retiring half%s, %llu KB in %u chunks refilled, "
+           "%llu source flushes%s\n", totalModels, full.usedBytes / 1024, full.totalChunks, half.usedBytes / 1024,
+           heldBack ? "" : " (FREED EARLY)", refilled.usedBytes / 1024, refilled.totalChunks,
+           store->stats.sourceFlushes, success ? "" : ", FAILED");
+    destroyModelStore(store);
+    arena->used = arenaMark;
+    return success;
+}
+
+#define CHECK_POOL_CHUNK_SIZE KILOBYTE(4)
+#define CHECK_POOL_ALLOCATIONS 96
+
+//chunks of a pool run on the cpu, arena memory the handles point at, never given back
+struct CheckPoolChunks {
+    MemoryArena* arena;
+    void* destroyed[GPU_BUFFER_POOL_MAX_CHUNKS * 2];
+    u32 totalDestroyed;
+    u32 totalCopies;
+};
+
+static void* createCheckPoolChunk(u64 size, void* userData){
+    CheckPoolChunks* chunks = (CheckPoolChunks*)userData;
+    return pushSize(chunks->arena, size);
+}
+
+static void destroyCheckPoolChunk(void* chunk, void* userData){
+    CheckPoolChunks* chunks = (CheckPoolChunks*)userData;
+    if(chunks->totalDestroyed < GPU_BUFFER_POOL_MAX_CHUNKS * 2){
+        chunks->destroyed[chunks->totalDestroyed++] = chunk;
+    }
+}
+
+static void copyCheckPoolRange(void* sourceChunk, u64 sourceOffset, void* destinationChunk, u64 destinationOffset,
+                               u64 size, void* userData){
+    CheckPoolChunks* chunks = (CheckPoolChunks*)userData;
+    copyMemory((u8*)destinationChunk + destinationOffset, (u8*)sourceChunk + sourceOffset, size);
+    chunks->totalCopies++;
+}
+
+static u8 getCheckPoolByte(u32 allocation, u64 i){
+    return (u8)(allocation * 31 + i * 7 + 1);
+}
+
+//every live allocation holds its own bytes, at its alignment, without overlapping another in its chunk
+static bool isCheckPoolIntact(GpuBufferPool* pool, u32* allocations, u32 totalAllocations){
+    for(u32 i = 0; i < totalAllocations; i++){
+        if(allocations[i] == GPU_ALLOCATION_INVALID) continue;
+        GpuAllocationRecord* record = getGpuAllocation(pool, allocations[i]);
+        u8* bytes = (u8*)getGpuAllocationChunk(pool, allocations[i]) + record->offset;
+        if(!pool->chunkHandles[record->chunkIndex] || record->offset % record->alignment ||
+           record->offset + record->size > pool->chunkSize){
+            return false;
+        }
+        for(u64 j = 0; j < record->size; j++){
+            if(bytes[j] != getCheckPoolByte(allocations[i], j)) return false;
+        }
+        for(u32 k = i + 1; k < totalAllocations; k++){
+            if(allocations[k] == GPU_ALLOCATION_INVALID) continue;
+            GpuAllocationRecord* other = getGpuAllocation(pool, allocations[k]);
+            if(other->chunkIndex == record->chunkIndex && other->offset < record->offset + record->size &&
+               record->offset < other->offset + other->size){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//Defragmentation has to move what the least used chunk holds into the holes of the others, copy the bytes through
+//copyRange, report each move as the records now read, and release the chunk it emptied. Models with 32 bit indices
+//are stored as given, and read back the same.
+static bool checkGpuBufferPool(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    GpuBufferPool* pool = pushStruct(arena, GpuBufferPool);
+    CheckPoolChunks* chunks = pushStruct(arena, CheckPoolChunks);
+    u32* allocations = pushArray(arena, u32, CHECK_POOL_ALLOCATIONS);
+    GpuAllocationMove* moves = pushArray(arena, GpuAllocationMove, CHECK_POOL_ALLOCATIONS);
+    if(!pool || !chunks || !allocations || !moves ||
+       !initializeGpuBufferPool(pool, CHECK_POOL_CHUNK_SIZE, CHECK_POOL_ALLOCATIONS, arena)){
+        printf("pool: out of memory\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    setMemory(chunks, sizeof(CheckPoolChunks));
+    chunks->arena = arena;
+    pool->createChunk = createCheckPoolChunk;
+    pool->destroyChunk = destroyCheckPoolChunk;
+    pool->copyRange = copyCheckPoolRange;
+    pool->userData = chunks;
+
+    //mixed sizes and alignments over several chunks
+    const u64 alignments[] = {16, 64, 256, 32};
+    u32 seed = 0x6A09E667;
+    bool filled = true;
+    for(u32 i = 0; i < CHECK_POOL_ALLOCATIONS && filled; i++){
+        seed = xorshift(seed);
+        u64 size = 24 + seed % 360;
+        allocations[i] = allocateGpuBuffer(pool, size, alignments[i % 4]);
+        filled = allocations[i] != GPU_ALLOCATION_INVALID;
+        if(filled){
+            GpuAllocationRecord* record = getGpuAllocation(pool, allocations[i]);
+            u8* bytes = (u8*)getGpuAllocationChunk(pool, allocations[i]) + record->offset;
+            for(u64 j = 0; j < size; j++){
+                bytes[j] = getCheckPoolByte(allocations[i], j);
+            }
+        }
+    }
+    GpuBufferPoolStatistics full = getGpuBufferPoolStatistics(pool);
+    filled &= full.totalChunks >= 4 && isCheckPoolIntact(pool, allocations, CHECK_POOL_ALLOCATIONS);
+    for(u32 i = 0; filled && i < CHECK_POOL_ALLOCATIONS; i += 2){
+        freeGpuBuffer(pool, allocations[i]);
+        allocations[i] = GPU_ALLOCATION_INVALID;
+    }
+
+    //each call empties the least used chunk into the others' holes, until nothing more moves
+    bool movesRight = filled;
+    u32 totalMoves = 0;
+    u32 passes = 0;
+    for(; movesRight && passes < GPU_BUFFER_POOL_MAX_CHUNKS; passes++){
+        void* handles[GPU_BUFFER_POOL_MAX_CHUNKS];
+        copyMemory(handles, pool->chunkHandles, sizeof(handles));
+        u32 destroyedBefore = chunks->totalDestroyed;
+        u32 copiesBefore = chunks->totalCopies;
+        u32 chunksBefore = getGpuBufferPoolStatistics(pool).totalChunks;
+        u32 moveCount = defragmentGpuBufferPool(pool, MAX_U64, moves, CHECK_POOL_ALLOCATIONS);
+        u32 chunksAfter = getGpuBufferPoolStatistics(pool).totalChunks;
+        if(!moveCount){
+            break;
+        }
+        //a chunk the others cannot take all of keeps what did not fit, and stays
+        u32 sourceChunk = moves[0].sourceChunk;
+        bool emptied = !pool->chunkHandles[sourceChunk];
+        movesRight = chunks->totalCopies == copiesBefore + moveCount &&
+                     (emptied ? chunksAfter == chunksBefore - 1 && chunks->totalDestroyed == destroyedBefore + 1 &&
+                                chunks->destroyed[destroyedBefore] == handles[sourceChunk]
+                              : chunksAfter == chunksBefore && chunks->totalDestroyed == destroyedBefore);
+        for(u32 i = 0; movesRight && i < moveCount; i++){
+            GpuAllocationMove* move = &moves[i];
+            GpuAllocationRecord* record = getGpuAllocation(pool, move->allocationId);
+            movesRight = move->sourceChunk == sourceChunk && move->destinationChunk != sourceChunk &&
+                         record->chunkIndex == move->destinationChunk && record->offset == move->destinationOffset &&
+                         record->size == move->size && handles[move->destinationChunk];
+        }
+        movesRight &= isCheckPoolIntact(pool, allocations, CHECK_POOL_ALLOCATIONS);
+        totalMoves += moveCount;
+    }
+    GpuBufferPoolStatistics packed = getGpuBufferPoolStatistics(pool);
+    movesRight &= totalMoves && packed.totalChunks < full.totalChunks &&
+                  packed.totalAllocations == CHECK_POOL_ALLOCATIONS / 2;
+    printf("pool %u allocations in %u chunks, half freed, %u moves in %u passes to %u chunks%s\n",
+           CHECK_POOL_ALLOCATIONS, full.totalChunks, totalMoves, passes, packed.totalChunks,
+           movesRight ? "" : ", FAILED");
+
+    //32 bit indices are neither optimized nor given levels, they land as given
+    RenderBackend* backend = pushStruct(arena, RenderBackend);
+    UploadScheduler* uploads = pushStruct(arena, UploadScheduler);
+    ModelStore* store = pushStruct(arena, ModelStore);
+    u32 vertexCount = 300;
+    u32 indexCount = vertexCount * 3;
+    f32* vertices = pushArray(arena, f32, vertexCount * 8);
+    u32* indices = pushArray(arena, u32, indexCount);
+    bool wide = false;
+    if(backend && uploads && store && vertices && indices && initializeCheckBackend(backend, arena) &&
+       initializeUploadScheduler(uploads, backend, MEGABYTE(1), MEGABYTE(1)) &&
+       initializeModelStore(store, backend, uploads, KILOBYTE(64), KILOBYTE(32), 4, KILOBYTE(128), KILOBYTE(256),
+                            arena)){
+        for(u32 i = 0; i < vertexCount * 8; i++){
+            seed = xorshift(seed);
+            vertices[i] = (f32)(seed & 0xFFFF) / 0xFFFF;
+        }
+        for(u32 i = 0; i < indexCount; i++){
+            indices[i] = (i * 7) % vertexCount;
+        }
+        Model3D model = createStoredModel3D(store, vertices, vertexCount * MODEL3D_VERTEX_SIZE, indices,
+                                            indexCount * sizeof(u32), MODEL3D_VERTEX_SIZE, sizeof(u32));
+        flushUploadScheduler(uploads);
+        wide = isStoredModel3DValid(&model) && model.indexSize == sizeof(u32) && model.totalIndices == indexCount &&
+               model.totalLods == 1 &&
+               isModelStoreRangeEqual(store, MODEL_STORE_VERTICES, model.vertexAllocation, vertices,
+                                      vertexCount * MODEL3D_VERTEX_SIZE) &&
+               isModelStoreRangeEqual(store, MODEL_STORE_INDICES, model.indexAllocation, indices,
+                                      indexCount * sizeof(u32));
+        indices[indexCount / 2] = vertexCount;
+        Model3D bad = createStoredModel3D(store, vertices, vertexCount * MODEL3D_VERTEX_SIZE, indices,
+                                          indexCount * sizeof(u32), MODEL3D_VERTEX_SIZE, sizeof(u32));
+        NullRenderDevice* device = (NullRenderDevice*)backend->data;
+        wide &= !isStoredModel3DValid(&bad) && !device->stats.errors;
+        destroyModelStore(store);
+    }
+    printf("pool 32 bit index model %s\n", wide ? "stored as given, bad index refused" : "FAILED");
+    arena->used = arenaMark;
+    return movesRight && wide;
+}
+
+#define CHECK_MODEL_SPHERE 0
+#define CHECK_MODEL_TORUS 1
+#define CHECK_MODEL_TERRAIN 2
+#define CHECK_MODEL_TOTAL_SHAPES 3
+
+//A (segments + 1)^2 vertex grid wrapped into the shape, in the Model3D vertex layout, with every triangle wound
+//clockwise seen from outside like the pipelines' front faces. Returns the index count.
+static u32 generateCheckModel(u32 shape, u32 segments, f32* vertices, u16* indices){
+    u32 side = segments + 1;
+    for(u32 j = 0; j < side; j++){
+        for(u32 i = 0; i < side; i++){
+            f32 u = (f32)i / segments;
+            f32 v = (f32)j / segments;
+            Vector3 position;
+            Vector3 normal;
+            if(shape == CHECK_MODEL_SPHERE){
+                normal = Vector3(cosine(u * TAU) * sine(v * PI), cosine(v * PI), sine(u * TAU) * sine(v * PI));
+                position = normal;
+            }else if(shape == CHECK_MODEL_TORUS){
+                Vector3 ring = Vector3(cosine(u * TAU), 0, sine(u * TAU));
+                normal = ring * cosine(v * TAU) + Vector3(0, sine(v * TAU), 0);
+                position = ring + normal * 0.35f;
+            }else{
+                //hills that hide each other seen from the side
+                normal = Vector3(0, 1, 0);
+                position = Vector3(u * 2 - 1, 0.3f * sine(u * TAU * 2) * cosine(v * TAU * 2), v * 2 - 1);
+            }
+            f32* vertex = vertices + (j * side + i) * 8;
+            vertex[0] = position.x;
+            vertex[1] = position.y;
+            vertex[2] = position.z;
+            vertex[3] = normal.x;
+            vertex[4] = normal.y;
+            vertex[5] = normal.z;
+            vertex[6] = u;
+            vertex[7] = v;
+        }
+    }
+    u32 indexCount = 0;
+    for(u32 j = 0; j < segments; j++){
+        for(u32 i = 0; i < segments; i++){
+            u16 quad[6] = {(u16)(j * side + i), (u16)(j * side + i + 1), (u16)((j + 1) * side + i),
+                           (u16)(j * side + i + 1), (u16)((j + 1) * side + i + 1), (u16)((j + 1) * side + i)};
+            for(u32 t = 0; t < 6; t += 3){
+                u16* triangle = indices + indexCount;
+                copyMemory(triangle, quad + t, 3 * sizeof(u16));
+                Vector3 a = Vector3(vertices[triangle[0] * 8], vertices[triangle[0] * 8 + 1], vertices[triangle[0] * 8 + 2]);
+                Vector3 b = Vector3(vertices[triangle[1] * 8], vertices[triangle[1] * 8 + 1], vertices[triangle[1] * 8 + 2]);
+                Vector3 c = Vector3(vertices[triangle[2] * 8], vertices[triangle[2] * 8 + 1], vertices[triangle[2] * 8 + 2]);
+                Vector3 outward = Vector3(vertices[triangle[0] * 8 + 3], vertices[triangle[0] * 8 + 4],
+                                          vertices[triangle[0] * 8 + 5]);
+                //clockwise front faces have the cross product pointing in
+                if(dot(cross(b - a, c - a), outward) > 0){
+                    u16 swap = triangle[1];
+                    triangle[1] = triangle[2];
+                    triangle[2] = swap;
+                }
+                indexCount += 3;
+            }
+        }
+    }
+    return indexCount;
+}
+
+//models exported without any care for the cache come in triangle soup order
+static void shuffleCheckTriangles(u16* indices, u32 indexCount, u32 seed){
+    u32 triangleCount = indexCount / 3;
+    for(u32 i = triangleCount - 1; i > 0; i--){
+        seed = xorshift(seed);
+        u32 j = seed % (i + 1);
+        for(u32 k = 0; k < 3; k++){
+            u16 swap = indices[i * 3 + k];
+            indices[i * 3 + k] = indices[j * 3 + k];
+            indices[j * 3 + k] = swap;
+        }
+    }
+}
+
+//Sums a hash of every triangle's positions, taken at the rotation hashing lowest so that the order of the triangles
+//and where each starts do not matter but a flipped winding or a lost triangle does.
+static u64 hashCheckTriangles(u16* indices, u32 indexCount, f32* vertices){
+    u64 sum = 0;
+    for(u32 t = 0; t < indexCount; t += 3){
+        u64 lowest = MAX_U64;
+        for(u32 r = 0; r < 3; r++){
+            f32 positions[9];
+            for(u32 k = 0; k < 3; k++){
+                copyMemory(positions + k * 3, vertices + indices[t + (r + k) % 3] * 8, 3 * sizeof(f32));
+            }
+            u64 hash = hashMemory(positions, sizeof(positions));
+            lowest = hash < lowest ? hash : lowest;
+        }
+        sum += lowest;
+    }
+    return sum;
+}
+
+//Stores shuffled procedural models, the repo ships no model files, through the model store, which optimizes them on
+//the way in, and measures the ranges that landed on the null backend against the input: the cache miss ratio has to
+//drop, overdraw may not grow past noise and every triangle has to arrive with its winding.
+static bool checkMeshOptimizer(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 segments = 48;
+    u32 maxVertices = (segments + 1) * (segments + 1);
+    u32 maxIndices = segments * segments * 6;
+    RenderBackend* backend = pushStruct(arena, RenderBackend);
+    UploadScheduler* uploads = pushStruct(arena, UploadScheduler);
+    ModelStore* store = pushStruct(arena, ModelStore);
+    f32* vertices = pushArray(arena, f32, maxVertices * 8);
+    u16* indices = pushArray(arena, u16, maxIndices);
+    if(!backend || !uploads || !store || !vertices || !indices || !initializeCheckBackend(backend, arena) ||
+       !initializeUploadScheduler(uploads, backend, MEGABYTE(1), MEGABYTE(1)) ||
+       !initializeModelStore(store, backend, uploads, MEGABYTE(1), KILOBYTE(512), CHECK_MODEL_TOTAL_SHAPES, MEGABYTE(1),
+                             MEGABYTE(1), arena)){
+        printf("mesh optimizer: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+
+    bool success = true;
+    const s8* names[CHECK_MODEL_TOTAL_SHAPES] = {"sphere", "torus", "terrain"};
+    for(u32 shape = 0; shape < CHECK_MODEL_TOTAL_SHAPES; shape++){
+        u32 indexCount = generateCheckModel(shape, segments, vertices, indices);
+        shuffleCheckTriangles(indices, indexCount, 0x2545F491 + shape);
+        bool frontCounterClockwise = store->optimize.frontCounterClockwise;
+        VertexCacheStatistics cacheBefore = analyzeVertexCache(indices, indexCount, maxVertices,
+                                                               MESH_OPTIMIZER_DEFAULT_CACHE_SIZE, arena);
+        OverdrawStatistics overdrawBefore = analyzeOverdraw(indices, indexCount, vertices, maxVertices, 8,
+                                                            frontCounterClockwise, arena);
+        u64 trianglesBefore = hashCheckTriangles(indices, indexCount, vertices);
+
+        Model3D model = createStoredModel3D(store, vertices, maxVertices * MODEL3D_VERTEX_SIZE, indices,
+                                            indexCount * sizeof(u16), MODEL3D_VERTEX_SIZE, sizeof(u16));
+        if(!isStoredModel3DValid(&model)){
+            printf("mesh optimizer %s: could not be stored\n", names[shape]);
+            success = false;
+            continue;
+        }
+        flushUploadScheduler(uploads);
+        //the null backend's gpu addresses are its memory
+        RenderResource vertexRange = getModelStoreRange(&store->pools[MODEL_STORE_VERTICES], model.vertexAllocation);
+        RenderResource indexRange = getModelStoreRange(&store->pools[MODEL_STORE_INDICES], model.indexAllocation);
+        f32* storedVertices = (f32*)vertexRange.gpuAddress;
+        u16* storedIndices = (u16*)indexRange.gpuAddress;
+        u32 storedVertexCount = (u32)(vertexRange.size / MODEL3D_VERTEX_SIZE);
+        VertexCacheStatistics cacheAfter = analyzeVertexCache(storedIndices, model.totalIndices, storedVertexCount,
+                                                              MESH_OPTIMIZER_DEFAULT_CACHE_SIZE, arena);
+        OverdrawStatistics overdrawAfter = analyzeOverdraw(storedIndices, model.totalIndices, storedVertices,
+                                                           storedVertexCount, 8, frontCounterClockwise, arena);
+        bool sameTriangles = model.totalIndices == indexCount &&
+                             hashCheckTriangles(storedIndices, model.totalIndices, storedVertices) == trianglesBefore;
+        bool passed = sameTriangles && cacheAfter.acmr < cacheBefore.acmr &&
+                      overdrawAfter.overdraw <= overdrawBefore.overdraw * 1.01f;
+        printf("mesh optimizer %s: %u triangles, %u -> %u vertices, acmr %.3f -> %.3f, overdraw %.3f -> %.3f%s%s\n",
+               names[shape], indexCount / 3, maxVertices, storedVertexCount, cacheBefore.acmr, cacheAfter.acmr,
+               overdrawBefore.overdraw, overdrawAfter.overdraw, sameTriangles ? "" : ", TRIANGLES CHANGED",
+               passed ? "" : ", FAILED");
+        success &= passed;
+        destroyStoredModel3D(store, &model);
+    }
+    //an index past the vertices, then a triangle cut short, leave the data alone and are not stored
+    u32 badVertexCount = 3 * 16;
+    u32 badIndexCount = 3 * 16;
+    for(u32 i = 0; i < badIndexCount; i++){
+        indices[i] = (u16)i;
+    }
+    indices[badIndexCount / 2] = (u16)(badVertexCount + 100);
+    u32 badVertexSize = badVertexCount * MODEL3D_VERTEX_SIZE;
+    u64 badHash = hashMemory(indices, badIndexCount * sizeof(u16));
+    bool badRefused = !optimizeModel3DData(vertices, &badVertexSize, indices, badIndexCount * sizeof(u16),
+                                           MODEL3D_VERTEX_SIZE, &store->optimize, arena) &&
+                      badVertexSize == badVertexCount * MODEL3D_VERTEX_SIZE &&
+                      hashMemory(indices, badIndexCount * sizeof(u16)) == badHash;
+    u64 failedModels = store->stats.failedModels;
+    Model3D bad = createStoredModel3D(store, vertices, badVertexCount * MODEL3D_VERTEX_SIZE, indices,
+                                      badIndexCount * sizeof(u16), MODEL3D_VERTEX_SIZE, sizeof(u16));
+    badRefused &= !isStoredModel3DValid(&bad);
+    indices[badIndexCount / 2] = 0;
+    bad = createStoredModel3D(store, vertices, badVertexCount * MODEL3D_VERTEX_SIZE, indices,
+                              (badIndexCount - 1) * sizeof(u16), MODEL3D_VERTEX_SIZE, sizeof(u16));
+    badRefused &= !isStoredModel3DValid(&bad) && store->stats.failedModels == failedModels + 2;
+    printf("mesh optimizer bad indices %s\n", badRefused ? "refused" : "NOT REFUSED");
+    success &= badRefused;
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    success &= !device->stats.errors;
+    destroyModelStore(store);
+    arena->used = arenaMark;
+    return success;
+}
+
+//Ericson's closest point on a triangle, by the voronoi region p falls in
+static Vector3 closestPointOnTriangle(Vector3 p, Vector3 a, Vector3 b, Vector3 c){
+    Vector3 ab = b - a;
+    Vector3 ac = c - a;
+    Vector3 ap = p - a;
+    f32 d1 = dot(ab, ap);
+    f32 d2 = dot(ac, ap);
+    if(d1 <= 0 && d2 <= 0) return a;
+    Vector3 bp = p - b;
+    f32 d3 = dot(ab, bp);
+    f32 d4 = dot(ac, bp);
+    if(d3 >= 0 && d4 <= d3) return b;
+    f32 vc = d1 * d4 - d3 * d2;
+    if(vc <= 0 && d1 >= 0 && d3 <= 0) return a + ab * (d1 / (d1 - d3));
+    Vector3 cp = p - c;
+    f32 d5 = dot(ab, cp);
+    f32 d6 = dot(ac, cp);
+    if(d6 >= 0 && d5 <= d6) return c;
+    f32 vb = d5 * d2 - d1 * d6;
+    if(vb <= 0 && d2 >= 0 && d6 <= 0) return a + ac * (d2 / (d2 - d6));
+    f32 va = d3 * d6 - d5 * d4;
+    if(va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    f32 denominator = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+//the farthest any of every step'th vertex lies from the triangles, how far a level strays from the source surface
+static f32 measureCheckLodDistance(u16* indices, u32 indexCount, f32* vertices, u32 vertexCount, u32 step){
+    f32 farthest = 0;
+    for(u32 v = 0; v < vertexCount; v += step){
+        Vector3 p = Vector3(vertices[v * 8], vertices[v * 8 + 1], vertices[v * 8 + 2]);
+        f32 nearest = MAX_F32;
+        for(u32 t = 0; t < indexCount; t += 3){
+            f32* a = vertices + indices[t] * 8;
+            f32* b = vertices + indices[t + 1] * 8;
+            f32* c = vertices + indices[t + 2] * 8;
+            Vector3 closest = closestPointOnTriangle(p, Vector3(a[0], a[1], a[2]), Vector3(b[0], b[1], b[2]),
+                                                     Vector3(c[0], c[1], c[2]));
+            f32 distance = length(p - closest);
+            nearest = distance < nearest ? distance : nearest;
+        }
+        farthest = nearest > farthest ? nearest : farthest;
+    }
+    return farthest;
+}
+
+//Stores the procedural models through the model store, which appends a LOD chain to each, and reads the levels back
+//from the null backend. Every level has to have fewer triangles than the one before and only index the model's
+//vertices, and a camera backing away has to walk the levels down to the last. The error the simplifier reports is
+//printed next to the distance the level's surface actually strays from the source vertices.
+static bool checkMeshSimplifier(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 segments = 48;
+    u32 maxVertices = (segments + 1) * (segments + 1);
+    u32 maxIndices = segments * segments * 6;
+    RenderBackend* backend = pushStruct(arena, RenderBackend);
+    UploadScheduler* uploads = pushStruct(arena, UploadScheduler);
+    ModelStore* store = pushStruct(arena, ModelStore);
+    f32* vertices = pushArray(arena, f32, maxVertices * 8);
+    u16* indices = pushArray(arena, u16, maxIndices);
+    if(!backend || !uploads || !store || !vertices || !indices || !initializeCheckBackend(backend, arena) ||
+       !initializeUploadScheduler(uploads, backend, MEGABYTE(1), MEGABYTE(1)) ||
+       !initializeModelStore(store, backend, uploads, MEGABYTE(1), MEGABYTE(1), CHECK_MODEL_TOTAL_SHAPES, MEGABYTE(1),
+                             MEGABYTE(2), arena)){
+        printf("mesh simplifier: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+
+    Camera camera;
+    camera.projection = createPerspectiveProjection(60, 16.0f / 9.0f, 0.1f, 1000);
+    f32 viewportHeight = 720;
+    bool success = true;
+    const s8* names[CHECK_MODEL_TOTAL_SHAPES] = {"sphere", "torus", "terrain"};
+    for(u32 shape = 0; shape < CHECK_MODEL_TOTAL_SHAPES; shape++){
+        u32 indexCount = generateCheckModel(shape, segments, vertices, indices);
+        Model3D model = createStoredModel3D(store, vertices, maxVertices * MODEL3D_VERTEX_SIZE, indices,
+                                            indexCount * sizeof(u16), MODEL3D_VERTEX_SIZE, sizeof(u16));
+        if(!isStoredModel3DValid(&model)){
+            printf("mesh simplifier %s: could not be stored\n", names[shape]);
+            success = false;
+            continue;
+        }
+        flushUploadScheduler(uploads);
+        RenderResource vertexRange = getModelStoreRange(&store->pools[MODEL_STORE_VERTICES], model.vertexAllocation);
+        RenderResource indexRange = getModelStoreRange(&store->pools[MODEL_STORE_INDICES], model.indexAllocation);
+        f32* storedVertices = (f32*)vertexRange.gpuAddress;
+        u16* storedIndices = (u16*)indexRange.gpuAddress;
+        u32 storedVertexCount = (u32)(vertexRange.size / MODEL3D_VERTEX_SIZE);
+        bool passed = model.totalLods > 1;
+        for(u32 lod = 0; lod < model.totalLods; lod++){
+            u16* lodIndices = storedIndices + model.lodIndexOffsets[lod];
+            u32 lodIndexCount = model.lodTotalIndices[lod];
+            bool inRange = (model.lodIndexOffsets[lod] + lodIndexCount) * sizeof(u16) <= indexRange.size;
+            for(u32 i = 0; inRange && i < lodIndexCount; i++){
+                inRange = lodIndices[i] < storedVertexCount;
+            }
+            bool fewer = lod == 0 || lodIndexCount < model.lodTotalIndices[lod - 1];
+            f32 distance = inRange ? measureCheckLodDistance(lodIndices, lodIndexCount, storedVertices,
+                                                              storedVertexCount, 7) : 0;
+            printf("mesh simplifier %s lod %u: %u triangles, %.1f%% fewer, error %.4f, %.4f from the source%s\n",
+                   names[shape], lod, lodIndexCount / 3, 100.0f * (1.0f - (f32)lodIndexCount / model.lodTotalIndices[0]),
+                   model.lodErrors[lod], distance, inRange && fewer ? "" : ", FAILED");
+            passed &= inRange && fewer;
+        }
+        //the model spans about 2 units, so at 1000 every level's error is well under a pixel
+        u32 previous = 0;
+        for(f32 distance = 1; distance <= 1000; distance *= 2){
+            camera.position = Vector3(0, 0, -distance);
+            u32 lod = selectModel3DLod(&model, &camera, viewportHeight, 1);
+            passed &= lod >= previous;
+            previous = lod;
+        }
+        passed &= previous == model.totalLods - 1;
+        success &= passed;
+        if(!passed){
+            printf("mesh simplifier %s: FAILED\n", names[shape]);
+        }
+        destroyStoredModel3D(store, &model);
+    }
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    success &= !device->stats.errors;
+    destroyModelStore(store);
+    arena->used = arenaMark;
+    return success;
+}
+
+//Whether any triangle of the meshlet faces position, front faces winding as frontCounterClockwise says
+static bool isMeshletFacing(MeshletData* data, u32 meshlet, f32* vertices, bool frontCounterClockwise, Vector3 position){
+    Meshlet* m = &data->meshlets[meshlet];
+    for(u32 t = 0; t < m->triangleCount; t++){
+        u8* triangle = data->triangles + (m->triangleOffset + t) * 3;
+        Vector3 p[3];
+        for(u32 k = 0; k < 3; k++){
+            f32* vertex = vertices + data->vertices[m->vertexOffset + triangle[k]] * 8;
+            p[k] = Vector3(vertex[0], vertex[1], vertex[2]);
+        }
+        Vector3 outward = frontCounterClockwise ? cross(p[1] - p[0], p[2] - p[0]) : cross(p[2] - p[0], p[1] - p[0]);
+        if(dot(outward, position - p[0]) > 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+//every meshlet missing from the visible list has to have all its triangles turned away from position
+static bool areCulledMeshletsFacingAway(MeshletData* data, u32* visible, u32 visibleCount, f32* vertices,
+                                        bool frontCounterClockwise, Vector3 position){
+    for(u32 i = 0, next = 0; i < data->totalMeshlets; i++){
+        if(next < visibleCount && visible[next] == i){
+            next++;
+        }else if(isMeshletFacing(data, i, vertices, frontCounterClockwise, position)){
+            return false;
+        }
+    }
+    return true;
+}
+
+//Builds meshlets for the procedural models with the winding a default pipeline desc draws, checks their limits and
+//bounds and that the serialized form loads back the same, then culls them from cameras circling the model, which it
+//fits in view. A meshlet the cone test drops may not have a triangle facing the camera, and the same holds for the model
+//wound the other way with the flag flipped. Culling is timed over all the cameras.
+static bool checkMeshlets(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 segments = 48;
+    u32 maxVertices = (segments + 1) * (segments + 1);
+    u32 maxIndices = segments * segments * 6;
+    f32* vertices = pushArray(arena, f32, maxVertices * 8);
+    u16* indices = pushArray(arena, u16, maxIndices);
+    u32* visible = pushArray(arena, u32, meshletCountBound(maxIndices));
+    u32* flippedVisible = pushArray(arena, u32, meshletCountBound(maxIndices));
+    u32 serializedSize = MEGABYTE(1);
+    u8* serialized = (u8*)pushSize(arena, serializedSize);
+    if(!vertices || !indices || !visible || !flippedVisible || !serialized){
+        arena->used = arenaMark;
+        return false;
+    }
+    RenderPipelineDesc pipeline = {};
+    Model3D model;
+    setMemory(&model, sizeof(Model3D));
+    model.position = Vector3(0);
+    model.scale = Vector3(1);
+    model.orientation = Quaternion();
+    Camera camera;
+    camera.projection = createPerspectiveProjection(60, 1, 0.1f, 100);
+    const u32 totalCameras = 16;
+    bool success = true;
+    const s8* names[CHECK_MODEL_TOTAL_SHAPES] = {"sphere", "torus", "terrain"};
+    for(u32 shape = 0; shape < CHECK_MODEL_TOTAL_SHAPES; shape++){
+        u32 indexCount = generateCheckModel(shape, segments, vertices, indices);
+        optimizeVertexCache(indices, indexCount, maxVertices, MESH_OPTIMIZER_DEFAULT_CACHE_SIZE, arena);
+        MeshletData data;
+        MeshletData flipped;
+        MeshletData loaded;
+        bool passed = buildMeshlets(&data, indices, indexCount, vertices, maxVertices, 8, pipeline.frontCounterClockwise,
+                                    arena, arena);
+        for(u32 t = 0; t < indexCount; t += 3){
+            u16 swap = indices[t + 1];
+            indices[t + 1] = indices[t + 2];
+            indices[t + 2] = swap;
+        }
+        passed = passed && buildMeshlets(&flipped, indices, indexCount, vertices, maxVertices, 8,
+                                         !pipeline.frontCounterClockwise, arena, arena);
+        if(!passed){
+            printf("meshlets %s: could not be built\n", names[shape]);
+            success = false;
+            continue;
+        }
+
+        bool bounded = data.totalTriangles * 3 == indexCount && data.totalMeshlets == flipped.totalMeshlets;
+        for(u32 i = 0; bounded && i < data.totalMeshlets; i++){
+            Meshlet* m = &data.meshlets[i];
+            MeshletBounds* b = &data.bounds[i];
+            bounded = m->vertexCount <= MESHLET_MAX_VERTICES && m->triangleCount <= MESHLET_MAX_TRIANGLES;
+            for(u32 v = 0; bounded && v < m->vertexCount; v++){
+                f32* vertex = vertices + data.vertices[m->vertexOffset + v] * 8;
+                Vector3 d = Vector3(vertex[0] - b->center[0], vertex[1] - b->center[1], vertex[2] - b->center[2]);
+                bounded = length(d) <= b->radius * 1.001f + 1e-5f;
+            }
+        }
+        u32 size = serializeMeshletData(&data, serialized, serializedSize);
+        bool serializes = size && loadMeshletData(serialized, size, &loaded) &&
+                          loaded.totalMeshlets == data.totalMeshlets && loaded.totalVertices == data.totalVertices &&
+                          loaded.totalTriangles == data.totalTriangles;
+        serializes = serializes && !memcmp(loaded.meshlets, data.meshlets, data.totalMeshlets * sizeof(Meshlet)) &&
+                     !memcmp(loaded.vertices, data.vertices, data.totalVertices * sizeof(u16)) &&
+                     !memcmp(loaded.bounds, data.bounds, data.totalMeshlets * sizeof(MeshletBounds)) &&
+                     !memcmp(loaded.triangles, data.triangles, data.totalTriangles * 3);
+        //a meshlet count whose size wraps 32 bits has to be refused, not pointed past the buffer
+        if(size){
+            MeshletDataHeader* header = (MeshletDataHeader*)serialized;
+            header->totalMeshlets = (u32)(0x100000000ull / (sizeof(Meshlet) + sizeof(MeshletBounds)) + 1);
+            serializes = serializes && !loadMeshletData(serialized, size, &loaded);
+        }
+
+        MeshletCullStatistics stats = {};
+        bool conesHold = true;
+        u64 cullTime = 0;
+        for(u32 c = 0; c < totalCameras; c++){
+            f32 angle = (f32)c / totalCameras;
+            camera.lookAt(Vector3(4 * cosine(angle * TAU), 2 * sine(angle * TAU * 3), 4 * sine(angle * TAU)), Vector3(0));
+            u64 start = context->getMicroseconds();
+            u32 visibleCount = cullMeshlets(&data, &model, &camera, visible, &stats);
+            cullTime += context->getMicroseconds() - start;
+            u32 flippedCount = cullMeshlets(&flipped, &model, &camera, flippedVisible);
+            conesHold &= areCulledMeshletsFacingAway(&data, visible, visibleCount, vertices,
+                                                     pipeline.frontCounterClockwise, camera.position) &&
+                         areCulledMeshletsFacingAway(&flipped, flippedVisible, flippedCount, vertices,
+                                                     !pipeline.frontCounterClockwise, camera.position);
+        }
+        //looking away from the model leaves nothing in view
+        camera.lookAt(Vector3(0, 0, 4), Vector3(0, 0, 8));
+        bool frustumHolds = cullMeshlets(&data, &model, &camera, visible) == 0 && !stats.frustumCulled;
+        passed = bounded && serializes && conesHold && frustumHolds &&
+                 (shape == CHECK_MODEL_TERRAIN || stats.backfaceCulled);
+        printf("meshlets %s: %u meshlets, %.1f triangles and %.1f vertices each, %u KB serialized, %.1f%% cone culled, "
+               "%.2f us per cull%s%s%s%s%s\n", names[shape], data.totalMeshlets, (f32)data.totalTriangles / data.totalMeshlets,
+               (f32)data.totalVertices / data.totalMeshlets, size / 1024, 100.0f * stats.backfaceCulled / stats.tested,
+               (f32)cullTime / totalCameras, bounded ? "" : ", OUT OF BOUNDS", serializes ? "" : ", SERIALIZED WRONG",
+               conesHold ? "" : ", CULLED FRONT FACES", frustumHolds ? "" : ", FRUSTUM WRONG", passed ? "" : ", FAILED");
+        success &= passed;
+    }
+    arena->used = arenaMark;
+    return success;
+}
+
+//the scalar decodes the shaders do, to hold the SSE kernels to
+static f32 decodeCheckHalf(u16 h){
+    u32 exponent = (h >> 10) & 0x1F;
+    u32 mantissa = h & 0x3FF;
+    f32 magnitude = exponent == 0 ? (f32)ldexp((f64)mantissa, -24) :
+                    exponent == 31 ? (f32)MAX_F32 * 2 : (f32)ldexp((f64)(mantissa | 0x400), (s32)exponent - 25);
+    return h & 0x8000 ? -magnitude : magnitude;
+}
+
+static Vector3 decodeCheckOctahedral(f32 x, f32 y){
+    x = x < -1 ? -1 : x;
+    y = y < -1 ? -1 : y;
+    f32 z = 1 - absoluteValue(x) - absoluteValue(y);
+    f32 t = z < 0 ? -z : 0;
+    x -= x < 0 ? -t : t;
+    y -= y < 0 ? -t : t;
+    return normalOf(Vector3(x, y, z));
+}
+
+//random codes through each decode kernel against the scalar decode, and every procedural model through the encode
+//and decode and through a store that quantizes, read back off the null backend
+static bool checkVertexQuantization(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 totalCodes = 1024;
+    u32* codes = pushArray(arena, u32, totalCodes * 2);
+    f32* decoded = pushArray(arena, f32, totalCodes * 4);
+    if(!codes || !decoded){
+        printf("vertex quantization: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    u32 seed = 0x6C8E9CF5;
+    for(u32 i = 0; i < totalCodes * 2; i++){
+        seed = xorshift(seed);
+        codes[i] = seed;
+    }
+    QuantizationBounds bounds = {{-3, 0.5f, 10}, {6, 0.25f, 1000}};
+    f32 kernelError[4] = {};
+    decodePositionsUnorm16((u16*)codes, 8, decoded, 16, totalCodes, &bounds);
+    for(u32 i = 0; i < totalCodes; i++){
+        u16* q = (u16*)(codes + i * 2);
+        for(u32 j = 0; j < 3; j++){
+            f32 e = absoluteValue(decoded[i * 4 + j] - (bounds.min[j] + q[j] * (bounds.extent[j] / 65535.0f)));
+            kernelError[0] = e / bounds.extent[j] > kernelError[0] ? e / bounds.extent[j] : kernelError[0];
+        }
+    }
+    decodeOctahedralSnorm16((s16*)codes, 8, decoded, 16, totalCodes);
+    for(u32 i = 0; i < totalCodes; i++){
+        s16* q = (s16*)(codes + i * 2);
+        Vector3 n = decodeCheckOctahedral(q[0] / 32767.0f, q[1] / 32767.0f);
+        f32 e = length(n - Vector3(decoded[i * 4], decoded[i * 4 + 1], decoded[i * 4 + 2]));
+        kernelError[1] = e > kernelError[1] ? e : kernelError[1];
+    }
+    //NaN codes aside, halves decode exactly
+    decodeUVsHalf((u16*)codes, 8, decoded, 16, totalCodes);
+    for(u32 i = 0; i < totalCodes; i++){
+        u16* q = (u16*)(codes + i * 2);
+        for(u32 j = 0; j < 2; j++){
+            if((q[j] & 0x7C00) == 0x7C00 && (q[j] & 0x3FF)) continue;
+            if(decoded[i * 4 + j] != decodeCheckHalf(q[j])) kernelError[2] = 1;
+        }
+    }
+    decodeWeightsUnorm8((u8*)codes, 8, decoded, 16, totalCodes);
+    for(u32 i = 0; i < totalCodes; i++){
+        u8* q = (u8*)(codes + i * 2);
+        for(u32 j = 0; j < 4; j++){
+            f32 e = absoluteValue(decoded[i * 4 + j] - q[j] / 255.0f);
+            kernelError[3] = e > kernelError[3] ? e : kernelError[3];
+        }
+    }
+    bool success = kernelError[0] < 1e-6f && kernelError[1] < 1e-5f && kernelError[2] == 0 && kernelError[3] < 1e-6f;
+    printf("vertex quantization kernels: position %.2g, normal %.2g, uv %s, weight %.2g%s\n", kernelError[0],
+           kernelError[1], kernelError[2] == 0 ? "exact" : "WRONG", kernelError[3], success ? "" : ", FAILED");
+    arena->used = arenaMark;
+
+    u32 segments = 48;
+    u32 maxVertices = (segments + 1) * (segments + 1);
+    u32 maxIndices = segments * segments * 6;
+    RenderBackend* backend = pushStruct(arena, RenderBackend);
+    UploadScheduler* uploads = pushStruct(arena, UploadScheduler);
+    ModelStore* store = pushStruct(arena, ModelStore);
+    f32* vertices = pushArray(arena, f32, maxVertices * 8);
+    f32* stored = pushArray(arena, f32, maxVertices * 8);
+    u16* indices = pushArray(arena, u16, maxIndices);
+    if(!backend || !uploads || !store || !vertices || !stored || !indices || !initializeCheckBackend(backend, arena) ||
+       !initializeUploadScheduler(uploads, backend, MEGABYTE(1), MEGABYTE(1)) ||
+       !initializeModelStore(store, backend, uploads, MEGABYTE(1), KILOBYTE(512), CHECK_MODEL_TOTAL_SHAPES, MEGABYTE(1),
+                             MEGABYTE(1), arena)){
+        printf("vertex quantization: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    //the vertices stay in the order given, so the stored ones line up with the source
+    setMemory(&store->optimize, sizeof(MeshOptimizeSettings));
+    store->totalLods = 1;
+    store->quantize = true;
+
+    const s8* names[CHECK_MODEL_TOTAL_SHAPES] = {"sphere", "torus", "terrain"};
+    VertexAttributeLayout layout = getModel3DVertexLayout();
+    for(u32 shape = 0; shape < CHECK_MODEL_TOTAL_SHAPES; shape++){
+        u32 indexCount = generateCheckModel(shape, segments, vertices, indices);
+        QuantizationBounds modelBounds = computeQuantizationBounds(vertices, maxVertices, MODEL3D_VERTEX_SIZE);
+        QuantizationReport report = measureQuantization(vertices, maxVertices, &layout, &modelBounds, arena);
+        //half a step on every axis at worst
+        f32 positionStep = length(Vector3(modelBounds.extent[0], modelBounds.extent[1], modelBounds.extent[2])) / 65535;
+        bool accurate = report.maxPositionError <= positionStep && report.maxNormalErrorDegrees < 0.05f &&
+                        report.maxUVError <= 1.0f / 1024;
+
+        Model3D model = createStoredModel3D(store, vertices, maxVertices * MODEL3D_VERTEX_SIZE, indices,
+                                            indexCount * sizeof(u16), MODEL3D_VERTEX_SIZE, sizeof(u16));
+        bool storedMatches = isStoredModel3DValid(&model) && model.vertexSize == report.quantizedBytesPerVertex;
+        if(storedMatches){
+            flushUploadScheduler(uploads);
+            RenderResource range = getModelStoreRange(&store->pools[MODEL_STORE_VERTICES], model.vertexAllocation);
+            storedMatches = range.size >= (u64)maxVertices * model.vertexSize;
+            QuantizationBounds storedBounds;
+            for(u32 i = 0; i < 3; i++){
+                storedBounds.min[i] = model.positionMin.va[i];
+                storedBounds.extent[i] = model.positionExtent.va[i];
+            }
+            dequantizeVertices((u8*)range.gpuAddress, maxVertices, &layout, &storedBounds, stored);
+            for(u32 i = 0; storedMatches && i < maxVertices; i++){
+                f32* a = vertices + i * 8;
+                f32* b = stored + i * 8;
+                storedMatches = length(Vector3(a[0], a[1], a[2]) - Vector3(b[0], b[1], b[2])) <= positionStep &&
+                                angleBetweenDegrees(a + 3, b + 3) < 0.05f &&
+                                absoluteValue(a[6] - b[6]) <= 1.0f / 1024 && absoluteValue(a[7] - b[7]) <= 1.0f / 1024;
+            }
+            destroyStoredModel3D(store, &model);
+        }
+        bool passed = accurate && storedMatches;
+        printf("vertex quantization %s: %u -> %u bytes per vertex, position %.2g (step %.2g), normal %.4f deg, "
+               "uv %.2g%s%s\n", names[shape], report.sourceBytesPerVertex, report.quantizedBytesPerVertex,
+               report.maxPositionError, positionStep, report.maxNormalErrorDegrees, report.maxUVError,
+               storedMatches ? "" : ", STORED WRONG", passed ? "" : ", FAILED");
+        success &= passed;
+    }
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    success &= !device->stats.errors;
+    destroyModelStore(store);
+    arena->used = arenaMark;
+    return success;
+}
+
+//the null backend's textures keep their levels packed in their memory, as createStoredTexture2D was given them
+static bool isStoredTextureEqual(StoredTexture* texture, void* data){
+    u64 size = getRenderTextureSize(texture->format, texture->width, texture->height, texture->mipLevels);
+    return !memcmp((void*)texture->resource.gpuAddress, data, size);
+}
+
+//Levels bigger than the staging ring go over in row bands across several batches, and block compressed levels whose
+//edges are not on a block boundary go over in block rows, and both have to land exactly as given. A TGA loaded through
+//os->createTexture2DFromFile has to come out with every level of the chain generateMipChain makes of it.
+static bool checkTextures(HeadlessCheckContext* context){
+    OSInterface* os = context->os;
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 size = 256;
+    u32 rgbaLevels = getMipLevelCount(size, size);
+    u32 rgbaSize = (u32)getRenderTextureSize(RENDER_FORMAT_R8G8B8A8_UNORM, size, size, rgbaLevels);
+    u32 bcWidth = 20;
+    u32 bcHeight = 12;
+    u32 bcLevels = 3;
+    u32 bcSize = (u32)getRenderTextureSize(RENDER_FORMAT_BC1_UNORM, bcWidth, bcHeight, bcLevels);
+    RenderBackend* backend = pushStruct(arena, RenderBackend);
+    UploadScheduler* uploads = pushStruct(arena, UploadScheduler);
+    DescriptorAllocator* descriptors = pushStruct(arena, DescriptorAllocator);
+    TextureStore* store = pushStruct(arena, TextureStore);
+    u8* data = pushArray(arena, u8, rgbaSize);
+    if(!backend || !uploads || !descriptors || !store || !data || !initializeCheckBackend(backend, arena) ||
+       !initializeUploadScheduler(uploads, backend, KILOBYTE(16), KILOBYTE(8)) ||
+       !initializeDescriptorAllocator(descriptors, backend, RENDER_DESCRIPTORS_RESOURCE, 16, 0, arena) ||
+       !initializeTextureStore(store, backend, uploads, descriptors, 16, KILOBYTE(64), 0, arena)){
+        printf("textures: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    u32 seed = 0x2545F491;
+    for(u32 i = 0; i < rgbaSize; i++){
+        seed = xorshift(seed);
+        data[i] = (u8)seed;
+    }
+    //the chain is bigger than the sources, so it is uploaded straight from data
+    StoredTexture* rgba = createStoredTexture2D(store, data, size, size, RENDER_FORMAT_R8G8B8A8_UNORM, rgbaLevels);
+    StoredTexture* bc = createStoredTexture2D(store, data, bcWidth, bcHeight, RENDER_FORMAT_BC1_UNORM, bcLevels);
+    flushUploadScheduler(uploads);
+    bool banded = rgba && isStoredTextureEqual(rgba, data) && uploads->stats.batches > rgbaSize / KILOBYTE(16);
+    bool blocks = bc && isStoredTextureEqual(bc, data);
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    bool success = banded && blocks && !device->stats.errors;
+    printf("textures %u KB in %u levels over %llu batches%s, bc1 %ux%u in %u levels%s\n", rgbaSize / 1024, rgbaLevels,
+           uploads->stats.batches, banded ? "" : " WRONG", bcWidth, bcHeight, bcLevels, blocks ? "" : " WRONG");
+    destroyTextureStore(store);
+
+    //odd sizes, so every level of the chain rounds down
+    u32 width = 37;
+    u32 height = 20;
+    u32 tgaSize = sizeof(TGAHeader) + width * height * 4;
+    u8* tga = pushArray(arena, u8, tgaSize);
+    u8* chain = pushArray(arena, u8, getMipChainSize(width, height));
+    MipChainSettings settings = defaultMipChainSettings();
+    if(!tga || !chain || !generateMipChain(data, width, height, &settings, chain, arena)){
+        printf("textures: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    TGAHeader* header = (TGAHeader*)tga;
+    setMemory(header, sizeof(TGAHeader));
+    header->imageType = 2;
+    header->width = (u16)width;
+    header->height = (u16)height;
+    header->bitsPerPixel = 32;
+    header->descriptor = 0x20 | 8;
+    for(u32 i = 0; i < width * height; i++){
+        u8* pixel = data + i * 4;
+        u8* bgra = tga + sizeof(TGAHeader) + i * 4;
+        bgra[0] = pixel[2];
+        bgra[1] = pixel[1];
+        bgra[2] = pixel[0];
+        bgra[3] = pixel[3];
+    }
+    Texture2D loaded = {};
+    if(os->writeToFile(HEADLESS_CHECK_FILE, tga, tgaSize)){
+        loaded = os->createTexture2DFromFile((s8*)HEADLESS_CHECK_FILE);
+    }
+    remove(HEADLESS_CHECK_FILE);
+    TextureStore* textures = context->textures;
+    flushUploadScheduler(textures->uploads);
+    StoredTexture* stored = (StoredTexture*)loaded.data1;
+    bool chained = stored && stored->mipLevels == getMipLevelCount(width, height) &&
+                   stored->format == os->TEXTURE_FORMAT_RGBA8 && isStoredTextureEqual(stored, chain);
+    NullRenderDevice* platformDevice = (NullRenderDevice*)textures->backend->data;
+    success &= chained && !platformDevice->stats.errors;
+    printf("textures %ux%u tga loaded with %u mip levels%s%s\n", width, height, stored ? stored->mipLevels : 0,
+           chained ? "" : ", CHAIN WRONG", success ? "" : ", FAILED");
+    arena->used = arenaMark;
+    return success;
+}
+
+static void writeCheckBigEndian(u8* p, u32 v){
+    p[0] = (u8)(v >> 24);
+    p[1] = (u8)(v >> 16);
+    p[2] = (u8)(v >> 8);
+    p[3] = (u8)v;
+}
+
+//Every PNG filter, one per row in turn, has to undo to the pixels it was made from, the 4 byte Paeth rows read and
+//written at the odd offsets scanlines sit at. The decoder has to leave the arena just past the pixels, and a dynamic
+//block declaring more literal codes than deflate has must be refused rather than overflow the code lengths.
+static bool checkPNGDecoder(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 width = 37;
+    u32 height = 10;
+    u32 rowBytes = width * 4;
+    u32 filteredSize = (rowBytes + 1) * height;
+    u32 fileSize = 8 + 25 + 12 + 2 + 5 + filteredSize + 4 + 12;
+    u8* pixels = pushArray(arena, u8, rowBytes * height);
+    u8* file = pushArray(arena, u8, fileSize);
+    if(!pixels || !file){
+        printf("png: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    u32 seed = 0x1B873593;
+    for(u32 i = 0; i < rowBytes * height; i++){
+        seed = xorshift(seed);
+        //smooth enough that the predictors pick different neighbours
+        pixels[i] = (u8)((i % rowBytes) + (seed & 15));
+    }
+    static const u8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    copyMemory(file, (void*)signature, 8);
+    u8* ip = file + 8;
+    writeCheckBigEndian(ip, 13);
+    writeCheckBigEndian(ip + 4, 0x49484452);
+    writeCheckBigEndian(ip + 8, width);
+    writeCheckBigEndian(ip + 12, height);
+    ip[16] = 8;
+    ip[17] = 6;
+    ip[18] = ip[19] = ip[20] = 0;
+    ip += 25;
+    //one stored deflate block, the decoder does not check crcs or the adler sum
+    writeCheckBigEndian(ip, 2 + 5 + filteredSize + 4);
+    writeCheckBigEndian(ip + 4, 0x49444154);
+    ip += 8;
+    ip[0] = 0x78;
+    ip[1] = 0x01;
+    ip[2] = 1;
+    ip[3] = (u8)filteredSize;
+    ip[4] = (u8)(filteredSize >> 8);
+    ip[5] = (u8)~filteredSize;
+    ip[6] = (u8)(~filteredSize >> 8);
+    ip += 7;
+    for(u32 y = 0; y < height; y++){
+        u8 filter = (u8)(y % 5);
+        u8* row = pixels + y * rowBytes;
+        u8* prior = y ? row - rowBytes : 0;
+        *ip++ = filter;
+        for(u32 i = 0; i < rowBytes; i++){
+            s32 a = i >= 4 ? row[i - 4] : 0;
+            s32 b = prior ? prior[i] : 0;
+            s32 c = prior && i >= 4 ? prior[i - 4] : 0;
+            s32 predictor = filter == 1 ? a : filter == 2 ? b : filter == 3 ? (a + b) >> 1 :
+                            filter == 4 ? paethPredictor(a, b, c) : 0;
+            *ip++ = (u8)(row[i] - predictor);
+        }
+    }
+    setMemory(ip, 8);
+    ip += 8;
+    writeCheckBigEndian(ip, 0);
+    writeCheckBigEndian(ip + 4, 0x49454E44);
+    setMemory(ip + 8, 4);
+
+    ImageData image;
+    u64 decodeMark = arena->used;
+    bool decoded = decodePNG(file, fileSize, &image, arena) && image.width == width && image.height == height &&
+                   !memcmp(image.levelData[0][0], pixels, rowBytes * height);
+    bool released = decoded && arena->used == (u64)(image.levelData[0][0] - arena->base) + rowBytes * height &&
+                    arena->used - decodeMark < rowBytes * height + 64;
+    arena->used = decodeMark;
+
+    //a dynamic block with 288 literal codes, then a code length code that would fill them all
+    u8* zlib = file + 8 + 25 + 8;
+    zlib[2] = 1 | (2 << 1) | (31 << 3);
+    zlib[3] = 0xFF;
+    zlib[4] = 0xFF;
+    setMemory(zlib + 5, 16, 0x92);
+    bool refused = !decodePNG(file, fileSize, &image, arena) && arena->used == decodeMark;
+    bool success = decoded && released && refused;
+    printf("png %ux%u with every filter %s, arena %s, oversized code counts %s%s\n", width, height,
+           decoded ? "decoded" : "WRONG", released ? "released" : "KEPT", refused ? "refused" : "ACCEPTED",
+           success ? "" : ", FAILED");
+    arena->used = arenaMark;
+    return success;
+}
+
+#define CHECK_IMAGE_GRADIENT 0
+#define CHECK_IMAGE_DETAIL 1
+#define CHECK_IMAGE_EDGES 2
+#define CHECK_IMAGE_TOTAL_KINDS 3
+
+//RGBA8 images standing in for the kinds of texture the encoder meets: a smooth gradient, detail from summed sines
+//in every channel, and flat coloured squares with hard edges between them
+static void generateCheckImage(u32 kind, u32 width, u32 height, u8* pixels){
+    for(u32 y = 0; y < height; y++){
+        for(u32 x = 0; x < width; x++){
+            u8* p = pixels + (y * width + x) * 4;
+            f32 u = (f32)x / width;
+            f32 v = (f32)y / height;
+            if(kind == CHECK_IMAGE_GRADIENT){
+                p[0] = (u8)(u * 255);
+                p[1] = (u8)(v * 255);
+                p[2] = (u8)((1 - u * v) * 255);
+            }else if(kind == CHECK_IMAGE_DETAIL){
+                for(u32 c = 0; c < 3; c++){
+                    f32 t = sinf(u * (13 + c * 7)) * cosf(v * (11 + c * 5)) + 0.5f * sinf((u + v) * (41 + c * 3));
+                    p[c] = (u8)(127.5f + t * 84);
+                }
+            }else{
+                u32 square = (x / 12) * 7 + (y / 12) * 3;
+                p[0] = (u8)(square * 53);
+                p[1] = (u8)(square * 97);
+                p[2] = (u8)(square * 29);
+            }
+            p[3] = 255;
+        }
+    }
+}
+
+//Every format at every quality, on every kind of image, has to decode back above a floor that sits a couple of dB
+//under what the encoder reaches, and quality must not make it worse. A TGA loaded through os->createTexture2DFromFile
+//has to come out as the BC1 blocks of its generated chain, the way the platform layers store RGBA8 files.
+static bool checkBlockCompression(HeadlessCheckContext* context){
+    OSInterface* os = context->os;
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 size = 256;
+    u8* source = pushArray(arena, u8, size * size * 4);
+    u8* blocks = pushArray(arena, u8, getBlockCompressedSize(BLOCK_COMPRESSION_BC5, size, size));
+    u8* decoded = pushArray(arena, u8, size * size * 4);
+    if(!source || !blocks || !decoded){
+        printf("block compression: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    const s8* kinds[CHECK_IMAGE_TOTAL_KINDS] = {"gradient", "detail", "edges"};
+    const s8* formats[] = {"bc1", "bc4u", "bc4s", "bc5"};
+    //dB floors by format and image kind
+    f32 floors[4][CHECK_IMAGE_TOTAL_KINDS] = {{42, 27, 39}, {60, 44, 60}, {60, 44, 60}, {60, 44, 60}};
+    bool success = true;
+    for(u32 format = BLOCK_COMPRESSION_BC1; format <= BLOCK_COMPRESSION_BC5; format++){
+        f32 psnr[CHECK_IMAGE_TOTAL_KINDS][3];
+        f64 megapixels = 0;
+        u64 encodeTime = 0;
+        bool passed = true;
+        for(u32 kind = 0; kind < CHECK_IMAGE_TOTAL_KINDS; kind++){
+            generateCheckImage(kind, size, size, source);
+            for(u32 quality = BLOCK_COMPRESSION_QUALITY_FAST; quality <= BLOCK_COMPRESSION_QUALITY_HIGH; quality++){
+                u64 start = context->getMicroseconds();
+                compressTexture(source, size, size, format, quality, blocks, os, context->queue);
+                encodeTime += context->getMicroseconds() - start;
+                megapixels += size * size / 1e6;
+                decompressTexture(blocks, size, size, format, decoded, os, context->queue);
+                psnr[kind][quality] = computeTextureCompressionPSNR(source, decoded, size, size, format);
+                passed &= psnr[kind][quality] >= floors[format][kind] &&
+                          (!quality || psnr[kind][quality] >= psnr[kind][quality - 1] - 0.01f);
+            }
+        }
+        printf("block compression %s: %.1f MP/s, psnr fast/normal/high %.1f/%.1f/%.1f gradient, %.1f/%.1f/%.1f detail, "
+               "%.1f/%.1f/%.1f edges%s\n", formats[format], megapixels / (encodeTime ? encodeTime : 1) * 1e6,
+               psnr[0][0], psnr[0][1], psnr[0][2], psnr[1][0], psnr[1][1], psnr[1][2], psnr[2][0], psnr[2][1],
+               psnr[2][2], passed ? "" : ", FAILED");
+        success &= passed;
+    }
+
+    u32 width = 64;
+    u32 height = 32;
+    u32 tgaSize = sizeof(TGAHeader) + width * height * 4;
+    u8* tga = pushArray(arena, u8, tgaSize);
+    u8* chain = pushArray(arena, u8, getMipChainSize(width, height));
+    MipChainSettings settings = defaultMipChainSettings();
+    generateCheckImage(CHECK_IMAGE_EDGES, width, height, source);
+    u64 chainMark = arena->used;
+    u8* expected = tga && chain && generateMipChain(source, width, height, &settings, chain, arena) ?
+        compressImageChain(chain, width, height, getMipLevelCount(width, height), BLOCK_COMPRESSION_BC1,
+                           BLOCK_COMPRESSION_QUALITY_NORMAL, arena) : 0;
+    if(!expected){
+        printf("block compression: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    TGAHeader* header = (TGAHeader*)tga;
+    setMemory(header, sizeof(TGAHeader));
+    header->imageType = 2;
+    header->width = (u16)width;
+    header->height = (u16)height;
+    header->bitsPerPixel = 32;
+    header->descriptor = 0x20 | 8;
+    swizzleBGRAToRGBA(tga + sizeof(TGAHeader), source, width * height);
+    Texture2D loaded = {};
+    if(os->writeToFile(HEADLESS_CHECK_FILE, tga, tgaSize)){
+        loaded = os->createTexture2DFromFile((s8*)HEADLESS_CHECK_FILE);
+    }
+    remove(HEADLESS_CHECK_FILE);
+    TextureStore* textures = context->textures;
+    flushUploadScheduler(textures->uploads);
+    StoredTexture* stored = (StoredTexture*)loaded.data1;
+    bool encoded = stored && stored->format == os->TEXTURE_FORMAT_BC1 &&
+                   stored->mipLevels == getMipLevelCount(width, height) && isStoredTextureEqual(stored, expected);
+    f32 loadedPSNR = 0;
+    if(encoded){
+        decompressTexture((u8*)stored->resource.gpuAddress, width, height, BLOCK_COMPRESSION_BC1, decoded);
+        loadedPSNR = computeTextureCompressionPSNR(source, decoded, width, height, BLOCK_COMPRESSION_BC1);
+    }
+    arena->used = chainMark;
+    NullRenderDevice* device = (NullRenderDevice*)textures->backend->data;
+    encoded &= loadedPSNR >= floors[BLOCK_COMPRESSION_BC1][CHECK_IMAGE_EDGES] && !device->stats.errors;
+    printf("block compression %ux%u tga loaded as bc1 in %u levels, %u KB instead of %u KB, psnr %.1f%s\n", width,
+           height, stored ? stored->mipLevels : 0, stored ? (u32)stored->resource.size / 1024 : 0,
+           getMipChainSize(width, height) / 1024, loadedPSNR, encoded ? "" : ", FAILED");
+    success &= encoded;
+    arena->used = arenaMark;
+    return success;
+}
+
+#define CHECK_STREAMING_TEXTURES 64
+#define CHECK_STREAMING_SIZE 2048
+#define CHECK_STREAMING_SPACING 4.0f
+#define CHECK_STREAMING_FRAMES 1200
+#define CHECK_STREAMING_FILES 4
+#define CHECK_STREAMING_FILE_SIZE 128
+
+//the policy run's loads only pretend, nothing is read and the levels count as in memory from the next update
+static u8* beginCheckStreamingLoad(StreamedTexture* texture, u32 firstLevel, u32 endLevel, u64 size, void* userData){
+    return (u8*)userData;
+}
+
+static void readCheckStreamingLevels(TextureLoadRequest* request){
+    request->complete = 1;
+}
+
+//the bytes the manager counts have to be the levels in memory plus the ones being read
+static bool isTextureStreamingAccounted(TextureStreamingManager* manager){
+    u64 bytes = 0;
+    for(u32 i = 0; i < manager->totalTextures; i++){
+        StreamedTexture* texture = &manager->textures[i];
+        if(texture->residentLevel > getStreamedTextureCoarsestLevel(manager, texture)){
+            return false;
+        }
+        bytes += getStreamedTextureBytes(texture, texture->residentLevel, texture->totalLevels);
+    }
+    for(u32 i = 0; i < TEXTURE_STREAMING_MAX_PENDING_LOADS; i++){
+        bytes += manager->loads[i].active ? manager->loads[i].size : 0;
+    }
+    return bytes == manager->residentBytes && bytes <= manager->budgetBytes;
+}
+
+//A camera flies along a row of textures and back, each one's projected size as a model's is its feedback. The budget
+//never goes over, the texture the camera ends up parked in front of has to get its finest level, and the hit rate is
+//what the budget allows. Loads pretend to finish on the next update, so the run is the same every time.
+static bool checkTextureStreamingPolicy(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    TextureStreamingManager* manager = pushStruct(arena, TextureStreamingManager);
+    u64 budget = MEGABYTE(16);
+    if(!manager || !initializeTextureStreamingManager(manager, CHECK_STREAMING_TEXTURES, budget, arena)){
+        printf("streaming: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    manager->beginLevelLoad = beginCheckStreamingLoad;
+    manager->readLevels = readCheckStreamingLevels;
+    manager->userData = arena->base;
+    //the levels are never read, their offsets only have to be the ones a DDS file would have
+    ImageData image = {};
+    image.width = CHECK_STREAMING_SIZE;
+    image.height = CHECK_STREAMING_SIZE;
+    image.format = BLOCK_COMPRESSION_BC1;
+    image.totalLevels = getMipLevelCount(CHECK_STREAMING_SIZE, CHECK_STREAMING_SIZE);
+    image.totalFaces = 1;
+    setImageLevelsFaceMajor(&image, arena->base, MEGABYTE(16));
+    Model3D models[CHECK_STREAMING_TEXTURES];
+    for(u32 i = 0; i < CHECK_STREAMING_TEXTURES; i++){
+        addStreamedTexture(manager, (s8*)"", &image, arena->base);
+        setMemory(&models[i], sizeof(Model3D));
+        models[i].position = Vector3((f32)i * CHECK_STREAMING_SPACING, 0, 0);
+        models[i].scale = Vector3(1);
+    }
+    u64 fullBytes = getStreamedTextureBytes(&manager->textures[0], 0, image.totalLevels) * CHECK_STREAMING_TEXTURES;
+    Camera camera;
+    camera.projection = createPerspectiveProjection(60, 16.0f / 9.0f, 0.1f, 100.0f);
+    f32 rowLength = (CHECK_STREAMING_TEXTURES - 1) * CHECK_STREAMING_SPACING;
+    bool accounted = true;
+    u64 start = context->getMicroseconds();
+    for(u32 frame = 0; frame < CHECK_STREAMING_FRAMES; frame++){
+        //there and back, then parked in front of the middle texture for the last frames
+        f32 x = frame < CHECK_STREAMING_FRAMES / 2 ? rowLength * frame / (CHECK_STREAMING_FRAMES / 2) :
+                frame < CHECK_STREAMING_FRAMES - 60 ?
+                rowLength * (CHECK_STREAMING_FRAMES - 60 - frame) / (CHECK_STREAMING_FRAMES / 2 - 60) :
+                (CHECK_STREAMING_TEXTURES / 2) * CHECK_STREAMING_SPACING;
+        camera.position = Vector3(x, 0, -1.5f);
+        beginTextureStreamingFrame(manager);
+        for(u32 i = 0; i < CHECK_STREAMING_TEXTURES; i++){
+            requestStreamedTextureForModel(manager, i, &models[i], &camera, 1080);
+        }
+        updateTextureStreaming(manager, arena);
+        accounted &= isTextureStreamingAccounted(manager);
+    }
+    u64 updateTime = context->getMicroseconds() - start;
+    StreamedTexture* parked = &manager->textures[CHECK_STREAMING_TEXTURES / 2];
+    bool sharp = parked->residentLevel == 0;
+    f32 hitRate = getTextureStreamingHitRate(manager);
+    bool success = accounted && sharp && hitRate > 0.6f;
+    TextureStreamingStatistics* stats = &manager->stats;
+    printf("streaming %u textures past a camera in %llu MB instead of %llu MB, %.1f%% hit rate, %llu MB streamed, "
+           "%llu MB evicted, %.1f us per update%s%s%s\n", CHECK_STREAMING_TEXTURES, budget / MEGABYTE(1),
+           fullBytes / MEGABYTE(1), 100.0f * hitRate, stats->bytesStreamed / MEGABYTE(1),
+           stats->bytesEvicted / MEGABYTE(1), (f64)updateTime / CHECK_STREAMING_FRAMES,
+           accounted ? "" : ", OVER BUDGET", sharp ? "" : ", PARKED TEXTURE BLURRY", success ? "" : ", FAILED");
+    arena->used = arenaMark;
+    return success;
+}
+
+static bool isStreamedTextureViewing(RenderBackend* backend, TextureStore* store, StoredTexture* texture, u32 level){
+    NullRenderDescriptor* descriptor = getNullRenderDescriptor(backend, &store->descriptors->heap, texture->descriptor,
+                                                               RENDER_DESCRIPTORS_RESOURCE);
+    return texture->viewLevel == level && descriptor && descriptor->firstLevel == level;
+}
+
+//runs updates until no load is in flight and every view has moved onto the levels that were loaded
+static void settleCheckStreaming(HeadlessCheckContext* context, TextureStreamingManager* manager,
+                                 TextureStore* store, u32 firstRequested, u32 endRequested){
+    for(u32 frame = 0; frame < 16; frame++){
+        beginTextureStreamingFrame(manager);
+        for(u32 i = firstRequested; i < endRequested; i++){
+            requestStreamedTexture(manager, i, CHECK_STREAMING_FILE_SIZE);
+        }
+        updateTextureStreaming(manager, context->arena);
+        context->os->completeWorkQueueEntries(context->queue);
+        flushUploadScheduler(store->uploads);
+        beginTextureStoreFrame(store);
+    }
+}
+
+//BC1 DDS files go through createStreamedTexture2DFromFile into a texture store with only their coarsest levels, and
+//their finer levels are read through the os file handles on the work queue. With room for two of them at full size,
+//the two asked for have to end up with every level in memory as the file has them and their views on the finest,
+//and asking for the other two has to move the first two's views back to their coarsest levels.
+static bool checkTextureStreamingStore(HeadlessCheckContext* context){
+    OSInterface* os = context->os;
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 size = CHECK_STREAMING_FILE_SIZE;
+    u32 levels = getMipLevelCount(size, size);
+    u32 chainSize = (u32)getRenderTextureSize(RENDER_FORMAT_BC1_UNORM, size, size, levels);
+    RenderBackend* backend = pushStruct(arena, RenderBackend);
+    UploadScheduler* uploads = pushStruct(arena, UploadScheduler);
+    DescriptorAllocator* descriptors = pushStruct(arena, DescriptorAllocator);
+    TextureStore* store = pushStruct(arena, TextureStore);
+    TextureStreamingManager* manager = pushStruct(arena, TextureStreamingManager);
+    TextureStreamingStore* streaming = pushStruct(arena, TextureStreamingStore);
+    u8* chains = pushArray(arena, u8, chainSize * CHECK_STREAMING_FILES);
+    if(!backend || !uploads || !descriptors || !store || !manager || !streaming || !chains ||
+       !initializeCheckBackend(backend, arena) || !initializeUploadScheduler(uploads, backend, KILOBYTE(64), KILOBYTE(64)) ||
+       !initializeDescriptorAllocator(descriptors, backend, RENDER_DESCRIPTORS_RESOURCE, 64, 0, arena) ||
+       !initializeTextureStore(store, backend, uploads, descriptors, 16, KILOBYTE(64), KILOBYTE(256), arena) ||
+       !initializeTextureStreamingManager(manager, CHECK_STREAMING_FILES, 0, arena, os, context->queue) ||
+       !initializeTextureStreamingStore(streaming, manager, store, KILOBYTE(64), arena)){
+        printf("streaming: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    u32 seed = 0x68E31DA4;
+    for(u32 i = 0; i < chainSize * CHECK_STREAMING_FILES; i++){
+        seed = xorshift(seed);
+        chains[i] = (u8)seed;
+    }
+    StoredTexture* textures[CHECK_STREAMING_FILES] = {};
+    bool created = true;
+    for(u32 i = 0; i < CHECK_STREAMING_FILES; i++){
+        s8 name[] = "headless_check_0.dds";
+        name[15] = (s8)('0' + i);
+        if(writeDDSFile(os, name, size, size, BLOCK_COMPRESSION_BC1, levels, chains + i * chainSize, arena)){
+            Texture2D texture = createStreamedTexture2DFromFile(manager, streaming, os, name, &store->scratch);
+            textures[i] = (StoredTexture*)texture.data1;
+        }
+        created &= textures[i] && textures[i]->streamedTexture == i;
+    }
+    u32 coarsest = created ? getStreamedTextureCoarsestLevel(manager, &manager->textures[0]) : 0;
+    u64 coarseBytes = manager->residentBytes;
+    u64 fullBytes = created ? getStreamedTextureBytes(&manager->textures[0], 0, coarsest) : 0;
+    manager->budgetBytes = coarseBytes + 2 * fullBytes;
+    flushUploadScheduler(uploads);
+    beginTextureStoreFrame(store);
+
+    bool loaded = created;
+    if(created){
+        settleCheckStreaming(context, manager, store, 0, 2);
+        for(u32 i = 0; i < 2; i++){
+            loaded &= isStoredTextureEqual(textures[i], chains + i * chainSize) &&
+                      isStreamedTextureViewing(backend, store, textures[i], 0);
+        }
+        for(u32 i = 2; i < CHECK_STREAMING_FILES; i++){
+            loaded &= isStreamedTextureViewing(backend, store, textures[i], coarsest);
+        }
+    }
+    bool evicted = loaded;
+    if(loaded){
+        settleCheckStreaming(context, manager, store, 2, CHECK_STREAMING_FILES);
+        for(u32 i = 0; i < CHECK_STREAMING_FILES; i++){
+            evicted &= isStreamedTextureViewing(backend, store, textures[i], i < 2 ? coarsest : 0);
+        }
+        for(u32 i = 2; i < CHECK_STREAMING_FILES; i++){
+            evicted &= isStoredTextureEqual(textures[i], chains + i * chainSize);
+        }
+        evicted &= manager->residentBytes <= manager->budgetBytes;
+    }
+    for(u32 i = 0; i < CHECK_STREAMING_FILES; i++){
+        s8 name[] = "headless_check_0.dds";
+        name[15] = (s8)('0' + i);
+        remove(name);
+    }
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    bool success = loaded && evicted && !streaming->failedUpdates && !device->stats.errors;
+    printf("streaming %u dds files through the texture store, finest levels %s, evicted views %s%s\n",
+           CHECK_STREAMING_FILES, loaded ? "loaded" : "WRONG", evicted ? "moved back" : "WRONG",
+           success ? "" : ", FAILED");
+    destroyTextureStore(store);
+    arena->used = arenaMark;
+    return success;
+}
+
+static bool checkTextureStreaming(HeadlessCheckContext* context){
+    bool policy = checkTextureStreamingPolicy(context);
+    return checkTextureStreamingStore(context) && policy;
+}
+
+#define CHECK_PREFILTER_SIZE 32
+#define CHECK_PREFILTER_OUTPUT 16
+#define CHECK_PREFILTER_LEVELS 4
+#define CHECK_PREFILTER_BENCHMARK_SIZE 256
+
+//the irradiance around n summed texel by texel over the source, what the SH9 projection approximates
+static Vector3 computeCheckIrradiance(u8* faces, u32 size, bool srgb, Vector3 n){
+    f32 texelSize = 2.0f / size;
+    Vector3 sum(0);
+    for(u32 face = 0; face < 6; face++){
+        for(u32 y = 0; y < size; y++){
+            for(u32 x = 0; x < size; x++){
+                f32 u = (x + 0.5f) * texelSize - 1.0f;
+                f32 v = (y + 0.5f) * texelSize - 1.0f;
+                Vector3 d = cubeTexelDirection(face, u, v);
+                normalize(&d);
+                f32 cosine = dot(d, n);
+                if(cosine <= 0) continue;
+                u8* c = faces + (((u64)face * size + y) * size + x) * 4;
+                f32 w = cosine * cubeTexelSolidAngle(u, v, texelSize);
+                for(u32 i = 0; i < 3; i++){
+                    f32 l = c[i] / 255.0f;
+                    l = !srgb ? l : l <= 0.04045f ? l / 12.92f : powf((l + 0.055f) / 1.055f, 2.4f);
+                    sum.va[i] += l * w;
+                }
+            }
+        }
+    }
+    return sum;
+}
+
+//the mean of the red channel over one face of one level of a bake
+static f32 getCheckBakeFaceMean(IBLBakeResult* result, u32 level, u32 face){
+    u32 size = result->size >> level;
+    f32* texels = result->levels[level] + (u64)face * size * size * 4;
+    f32 sum = 0;
+    for(u32 i = 0; i < size * size; i++){
+        sum += texels[i * 4];
+    }
+    return sum / (size * size);
+}
+
+//A constant environment has to come out of every level and of the irradiance as itself, pi times itself for the
+//irradiance. With only the +Y face lit, the SH9 irradiance has to follow a reference summed over the source, the
+//unfiltered level has to keep the face's edges, and as the lobe widens level by level the lit face has to dim and the
+//faces next to it brighten, while the opposite face, which no lobe reaches, stays dark. A second cached bake has to load what the first wrote, and os->createTextureCube
+//has to put the sRGB encoded chain in the platform layer's texture store.
+static bool checkCubemapPrefilter(HeadlessCheckContext* context){
+    OSInterface* os = context->os;
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 size = CHECK_PREFILTER_SIZE;
+    u32 faceBytes = size * size * 4;
+    IBLBakeSettings settings = defaultIBLBakeSettings();
+    settings.outputSize = CHECK_PREFILTER_OUTPUT;
+    settings.totalLevels = CHECK_PREFILTER_LEVELS;
+    u64 bakeSize = getIBLBakeDataSize(&settings);
+    u8* constant = pushArray(arena, u8, faceBytes * 6);
+    u8* lit = pushArray(arena, u8, faceBytes * 6);
+    u8* constantBake = pushArray(arena, u8, bakeSize);
+    u8* litBake = pushArray(arena, u8, bakeSize);
+    if(!constant || !lit || !constantBake || !litBake){
+        printf("prefilter: could not be created\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    u8 color[4] = {200, 120, 40, 255};
+    for(u32 i = 0; i < size * size * 6; i++){
+        copyMemory(constant + i * 4, color, 4);
+        u8 l = i / (size * size) == 2 ? 255 : 0;
+        lit[i * 4 + 0] = lit[i * 4 + 1] = lit[i * 4 + 2] = l;
+        lit[i * 4 + 3] = 255;
+    }
+
+    IBLBakeResult result;
+    bool constantBaked = bakeIBL(constant, size, &settings, constantBake, &result, arena, os, context->queue);
+    Vector3 linear;
+    for(u32 i = 0; i < 3; i++){
+        f32 c = color[i] / 255.0f;
+        linear.va[i] = powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    f32 levelError = 0;
+    f32 irradianceError = 0;
+    if(constantBaked){
+        for(u32 level = 0; level < result.totalLevels; level++){
+            u32 levelSize = result.size >> level;
+            for(u64 i = 0; i < (u64)levelSize * levelSize * 6; i++){
+                for(u32 c = 0; c < 3; c++){
+                    f32 e = absoluteValue(result.levels[level][i * 4 + c] - linear.va[c]);
+                    levelError = e > levelError ? e : levelError;
+                }
+            }
+        }
+        Vector3 normals[4] = {Vector3(1, 0, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0.577f, 0.577f, -0.577f)};
+        for(u32 i = 0; i < 4; i++){
+            Vector3 irradiance = evaluateSH9Irradiance(result.irradianceSH, normals[i]);
+            for(u32 c = 0; c < 3; c++){
+                f32 e = absoluteValue(irradiance.va[c] / ((f32)PI * linear.va[c]) - 1.0f);
+                irradianceError = e > irradianceError ? e : irradianceError;
+            }
+        }
+    }
+    bool constantPassed = constantBaked && levelError < 0.0005f && irradianceError < 0.01f;
+    printf("prefilter constant %u^2 to %u^2 in %u levels, largest error %.5f, irradiance %.2f%% off%s\n", size,
+           settings.outputSize, settings.totalLevels, levelError, 100.0f * irradianceError,
+           constantPassed ? "" : ", FAILED");
+
+    settings.srgb = false;
+    bool litBaked = bakeIBL(lit, size, &settings, litBake, &result, arena, os, context->queue);
+    f32 shError = 0;
+    bool lobes = litBaked;
+    if(litBaked){
+        //against the irradiance straight above the lit face, the largest there is
+        Vector3 normals[4] = {Vector3(0, 1, 0), Vector3(1, 0, 0), Vector3(0, -1, 0), Vector3(0.707f, 0.707f, 0)};
+        f32 peak = computeCheckIrradiance(lit, size, false, normals[0]).x;
+        for(u32 i = 0; i < 4; i++){
+            f32 reference = computeCheckIrradiance(lit, size, false, normals[i]).x;
+            f32 e = absoluteValue(evaluateSH9Irradiance(result.irradianceSH, normals[i]).x - reference) / peak;
+            shError = e > shError ? e : shError;
+        }
+        lobes &= getCheckBakeFaceMean(&result, 0, 2) == 1.0f && getCheckBakeFaceMean(&result, 0, 0) == 0.0f;
+        for(u32 level = 1; level < result.totalLevels; level++){
+            lobes &= getCheckBakeFaceMean(&result, level, 2) < getCheckBakeFaceMean(&result, level - 1, 2) &&
+                     getCheckBakeFaceMean(&result, level, 0) > getCheckBakeFaceMean(&result, level - 1, 0) &&
+                     getCheckBakeFaceMean(&result, level, 3) < 0.0001f;
+        }
+    }
+    bool litPassed = litBaked && lobes && shError < 0.05f;
+    u32 roughest = settings.totalLevels - 1;
+    printf("prefilter lit face irradiance %.2f%% off the reference, roughest level %.3f on the face, %.3f beside it%s\n",
+           100.0f * shError, litBaked ? getCheckBakeFaceMean(&result, roughest, 2) : 0,
+           litBaked ? getCheckBakeFaceMean(&result, roughest, 0) : 0, litPassed ? "" : ", FAILED");
+
+    //the second bake is read from the file the first wrote, the two have to agree byte for byte
+    settings.srgb = true;
+    u64 cacheMark = arena->used;
+    IBLBakeResult cached;
+    bool bakedFirst = bakeIBLCached(os, constant, size, &settings, "", &result, arena, arena, context->queue);
+    u64 loadStart = context->getMicroseconds();
+    bool bakedSecond = bakeIBLCached(os, constant, size, &settings, "", &cached, arena, arena, context->queue);
+    u64 loadTime = context->getMicroseconds() - loadStart;
+    s8 fileName[IBL_MAX_FILE_NAME];
+    getIBLBakeFileName("", result.sourceHash, fileName);
+    u32 fileLength = 0;
+    bool written = os->readFileIntoBoundedBuffer(fileName, litBake, (u32)bakeSize, &fileLength) &&
+                   fileLength == bakeSize;
+    remove(fileName);
+    bool cachePassed = bakedFirst && bakedSecond && written && cached.sourceHash == result.sourceHash &&
+                       !memcmp(cached.levels[0], result.levels[0], bakeSize - sizeof(IBLBakeHeader));
+    arena->used = cacheMark;
+    printf("prefilter cache %s, loaded in %llu us%s\n", fileName, loadTime, cachePassed ? "" : ", FAILED");
+
+    TextureStore* textures = context->textures;
+    TextureCube cube = os->createTextureCube(constant, size, size, os->TEXTURE_FORMAT_RGBA8);
+    flushUploadScheduler(textures->uploads);
+    StoredIBLEnvironment* environment = (StoredIBLEnvironment*)cube.data1;
+    StoredTexture* specular = environment ? environment->specular : 0;
+    bool stored = specular && specular->width == size && specular->height == size * 6 &&
+                  specular->mipLevels == environment->totalLevels && os->bindTextureCube(&cube) == specular->descriptor;
+    if(stored){
+        u8* texels = (u8*)specular->resource.gpuAddress;
+        u64 totalTexels = getRenderTextureSize(specular->format, size, size * 6, specular->mipLevels) / 4;
+        for(u64 i = 0; i < totalTexels * 4; i++){
+            s32 d = (s32)texels[i] - color[i & 3];
+            stored &= d >= -1 && d <= 1;
+        }
+    }
+    NullRenderDevice* device = (NullRenderDevice*)textures->backend->data;
+    stored &= !device->stats.errors;
+    printf("prefilter cube %ux%u in %u levels through os->createTextureCube%s\n", size, size * 6,
+           specular ? specular->mipLevels : 0, stored ? "" : ", FAILED");
+
+    u32 benchmarkSize = CHECK_PREFILTER_BENCHMARK_SIZE;
+    IBLBakeSettings benchmarkSettings = defaultIBLBakeSettings();
+    benchmarkSettings.outputSize = benchmarkSize / 2;
+    u8* faces = pushArray(arena, u8, benchmarkSize * benchmarkSize * 4 * 6);
+    u8* benchmarkBake = pushArray(arena, u8, getIBLBakeDataSize(&benchmarkSettings));
+    bool benchmarked = faces && benchmarkBake;
+    u64 bakeTime = 0;
+    if(benchmarked){
+        for(u32 face = 0; face < 6; face++){
+            generateCheckImage(face % CHECK_IMAGE_TOTAL_KINDS, benchmarkSize, benchmarkSize,
+                               faces + (u64)face * benchmarkSize * benchmarkSize * 4);
+        }
+        u64 start = context->getMicroseconds();
+        benchmarked = bakeIBL(faces, benchmarkSize, &benchmarkSettings, benchmarkBake, &result, arena, os,
+                              context->queue);
+        bakeTime = context->getMicroseconds() - start;
+    }
+    printf("prefilter %u^2 cube to %u^2 in %u levels at %u samples in %.1f ms%s\n", benchmarkSize,
+           benchmarkSettings.outputSize, benchmarkSettings.totalLevels, benchmarkSettings.sampleCount,
+           bakeTime / 1000.0, benchmarked ? "" : ", FAILED");
+    arena->used = arenaMark;
+    return constantPassed && litPassed && cachePassed && stored && benchmarked;
+}
+
+#define CHECK_REGISTRY_NAMES (1 << 20)
+#define CHECK_REGISTRY_NAME_SIZE 20
+
+//"assets/" and the index in 7 digits, then ".obj"
+static void getCheckRegistryName(u32 index, s8* name){
+    u32 ctr = 0;
+    name[0] = '\0';
+    concatenateCharacterStrings(name, "assets/", &ctr);
+    for(u32 i = 0, divisor = 1000000; i < 7; i++, divisor /= 10){
+        name[ctr++] = (s8)('0' + index / divisor % 10);
+    }
+    name[ctr] = '\0';
+    concatenateCharacterStrings(name, ".obj", &ctr);
+}
+
+//A file acquired under two spellings of its name has to be loaded once and handed back as one copy, released to the
+//caller with the last reference, and a load that failed must not be kept, so acquiring the file once it exists loads
+//it. A million names are then interned, for the memory an entry takes, and looked up by name and by hash.
+static bool checkAssetRegistry(HeadlessCheckContext* context){
+    OSInterface* os = context->os;
+    MemoryArena* arena = context->arena;
+    TextureStore* textures = context->textures;
+    u64 arenaMark = arena->used;
+    AssetRegistry* registry = pushStruct(arena, AssetRegistry);
+    AssetRegistry* names = pushStruct(arena, AssetRegistry);
+    if(!registry || !names || !initializeAssetRegistry(registry, 16, 1024, arena)){
+        printf("registry: out of memory\n");
+        arena->used = arenaMark;
+        return false;
+    }
+
+    remove(HEADLESS_CHECK_FILE);
+    Texture2D* missing = acquireTexture2D(registry, os, (s8*)HEADLESS_CHECK_FILE, arena);
+    AssetRegistryEntry* entry = findAssetByHash(registry, hashAssetRegistryName(HEADLESS_CHECK_FILE));
+    bool retried = !missing && entry && !entry->referenceCount && !entry->asset;
+    u8 tga[sizeof(TGAHeader) + 2 * 2 * 4];
+    setMemory(tga, sizeof(tga));
+    TGAHeader* header = (TGAHeader*)tga;
+    header->imageType = 2;
+    header->width = 2;
+    header->height = 2;
+    header->bitsPerPixel = 32;
+    header->descriptor = 0x20 | 8;
+    u64 texturesBefore = textures->stats.textures;
+    Texture2D* first = 0;
+    Texture2D* second = 0;
+    if(os->writeToFile(HEADLESS_CHECK_FILE, tga, sizeof(tga))){
+        first = acquireTexture2D(registry, os, (s8*)HEADLESS_CHECK_FILE, arena);
+        //no such file on a case sensitive file system, only the registry can hand it back
+        second = acquireTexture2D(registry, os, (s8*)"HEADLESS_CHECK.BIN", arena);
+    }
+    remove(HEADLESS_CHECK_FILE);
+    flushUploadScheduler(textures->uploads);
+    retried &= first != 0;
+    bool deduplicated = first && first == second && entry->referenceCount == 2 &&
+                        textures->stats.textures == texturesBefore + 1 && registry->totalEntries == 1;
+    bool released = entry && !releaseAsset(entry) && releaseAsset(entry) == first && !entry->asset;
+    printf("registry failed load %s, 2 spellings %s, %s on the last release\n", retried ? "retried" : "KEPT",
+           deduplicated ? "loaded once" : "NOT DEDUPLICATED", released ? "freed" : "NOT FREED");
+
+    u32 totalNames = CHECK_REGISTRY_NAMES;
+    u64* hashes = pushArray(arena, u64, totalNames);
+    bool benchmarked = hashes && initializeAssetRegistry(names, totalNames, totalNames * CHECK_REGISTRY_NAME_SIZE, arena);
+    u64 internTime = 0;
+    u64 nameTime = 0;
+    u64 hashTime = 0;
+    if(benchmarked){
+        s8 name[CHECK_REGISTRY_NAME_SIZE];
+        u64 start = context->getMicroseconds();
+        for(u32 i = 0; benchmarked && i < totalNames; i++){
+            getCheckRegistryName(i, name);
+            AssetRegistryEntry* interned = acquireAsset(names, name);
+            benchmarked = interned != 0;
+            hashes[i] = benchmarked ? interned->nameHash : 0;
+        }
+        internTime = context->getMicroseconds() - start;
+        start = context->getMicroseconds();
+        for(u32 i = 0; benchmarked && i < totalNames; i++){
+            getCheckRegistryName(i, name);
+            AssetRegistryEntry* found = acquireAsset(names, name);
+            benchmarked = found && found->nameHash == hashes[i] && found->referenceCount == 2;
+        }
+        nameTime = context->getMicroseconds() - start;
+        start = context->getMicroseconds();
+        for(u32 i = 0; benchmarked && i < totalNames; i++){
+            benchmarked = findAssetByHash(names, hashes[i]) != 0;
+        }
+        hashTime = context->getMicroseconds() - start;
+        benchmarked &= names->totalEntries == totalNames;
+    }
+    f64 entryBytes = benchmarked ? ((f64)names->capacity * sizeof(AssetRegistryEntry) + names->namesUsed) / totalNames : 0;
+    printf("registry %u names at %.1f bytes each, interned in %.1f ms, %.1f M lookups/s by name and %.1f M by hash%s\n",
+           totalNames, entryBytes, internTime / 1000.0, (f64)totalNames / (nameTime ? nameTime : 1),
+           (f64)totalNames / (hashTime ? hashTime : 1), benchmarked ? "" : ", FAILED");
+    arena->used = arenaMark;
+    return retried && deduplicated && released && benchmarked;
+}
+
+#define CHECK_GLYPH_ATLAS_WIDTH 128
+#define CHECK_GLYPH_ATLAS_HEIGHT 64
+#define CHECK_GLYPH_BATCH 24
+
+//a font of boxes whose size and coverage follow from the codepoint, with no glyph for U+E000 and up
+static bool measureCheckGlyph(void* userData, u32 codepoint, GlyphRecord* metrics){
+    if(codepoint >= 0xE000){
+        return false;
+    }
+    bool space = codepoint == ' ';
+    metrics->width = space ? 0 : (f32)(3 + codepoint % 7);
+    metrics->height = space ? 0 : (f32)(5 + codepoint % 5);
+    metrics->xOffset = 0;
+    metrics->yOffset = -metrics->height;
+    metrics->advance = metrics->width + 1;
+    return true;
+}
+
+static void rasterizeCheckGlyph(void* userData, u32 codepoint, u8* pixels, u32 pitch){
+    u32 width = 3 + codepoint % 7;
+    u32 height = 5 + codepoint % 5;
+    for(u32 y = 0; y < height; y++){
+        for(u32 x = 0; x < width; x++){
+            pixels[y * pitch + x] = (u8)(codepoint * 7 + x + y * 3) | 1;
+        }
+    }
+}
+
+#define CHECK_COOK_SOURCE "headless_check_source.txt"
+#define CHECK_COOK_INCLUDE "headless_check_include.txt"
+#define CHECK_COOK_MAX_ENTRIES 8
+#define CHECK_COOK_MAX_SIZE 64
+
+//a cook cache backend in memory, the directory one is run by the headless loop
+struct CheckCookCache {
+    u64 keys[CHECK_COOK_MAX_ENTRIES];
+    u8 data[CHECK_COOK_MAX_ENTRIES][CHECK_COOK_MAX_SIZE];
+    u32 sizes[CHECK_COOK_MAX_ENTRIES];
+    u32 totalEntries;
+};
+
+struct CheckCookedAsset {
+    OSInterface* os;
+    u8 result[CHECK_COOK_MAX_SIZE];
+    u32 resultSize;
+    u32 cooks;
+};
+
+static bool loadCheckCook(void* userData, u64 key, void* data, u32 capacity, u32* size){
+    CheckCookCache* cache = (CheckCookCache*)userData;
+    for(u32 i = 0; i < cache->totalEntries; i++){
+        if(cache->keys[i] == key && cache->sizes[i] <= capacity){
+            copyMemory(data, cache->data[i], cache->sizes[i]);
+            *size = cache->sizes[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool storeCheckCook(void* userData, u64 key, void* data, u32 size){
+    CheckCookCache* cache = (CheckCookCache*)userData;
+    if(cache->totalEntries == CHECK_COOK_MAX_ENTRIES || size > CHECK_COOK_MAX_SIZE){
+        return false;
+    }
+    cache->keys[cache->totalEntries] = key;
+    copyMemory(cache->data[cache->totalEntries], data, size);
+    cache->sizes[cache->totalEntries++] = size;
+    return true;
+}
+
+//the cooked bytes are the source followed by the include, the way a shader compiler pulls its includes in
+static u32 cookCheckAsset(void* userData, u8* source, u32 sourceSize, void* out, u32 outCapacity){
+    CheckCookedAsset* asset = (CheckCookedAsset*)userData;
+    u32 includeSize = 0;
+    if(sourceSize > outCapacity ||
+       !asset->os->readFileIntoBoundedBuffer(CHECK_COOK_INCLUDE, (u8*)out + sourceSize, outCapacity - sourceSize,
+                                             &includeSize)){
+        return 0;
+    }
+    copyMemory(out, source, sourceSize);
+    asset->cooks++;
+    return sourceSize + includeSize;
+}
+
+static void swapCheckAsset(void* userData, void* result){
+    CheckCookedAsset* asset = (CheckCookedAsset*)userData;
+    CookedAsset* cooked = (CookedAsset*)result;
+    asset->resultSize = cooked->size <= CHECK_COOK_MAX_SIZE ? cooked->size : 0;
+    copyMemory(asset->result, cooked->data, asset->resultSize);
+}
+
+static bool isCheckCookResult(CheckCookedAsset* asset, const s8* expected){
+    u32 length = 0;
+    while(expected[length]) length++;
+    bool equal = asset->resultSize == length;
+    for(u32 i = 0; equal && i < length; i++){
+        equal = asset->result[i] == (u8)expected[i];
+    }
+    return equal;
+}
+
+//An asset going through the cook cache has to be cooked again when only its include changed, and read back from the
+//cache when the include goes back to what it was. The database cooks inline, with no watcher, and is told of each
+//edit the way the watcher would.
+static bool checkAssetCooks(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    OSInterface os = *context->os;
+    os.createFileWatcher = 0;
+    AssetDatabase* database = pushStruct(arena, AssetDatabase);
+    CheckCookCache* memory = pushStruct(arena, CheckCookCache);
+    CookCache cache = {};
+    CheckCookedAsset cooked = {};
+    cooked.os = &os;
+    if(!database || !memory || !initializeAssetDatabase(database, &os, ".", KILOBYTE(1), arena, 0, &cache)){
+        printf("cooks: out of memory\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    memory->totalEntries = 0;
+    cache.local.load = loadCheckCook;
+    cache.local.store = storeCheckCook;
+    cache.local.userData = memory;
+
+    bool written = os.writeToFile(CHECK_COOK_SOURCE, (void*)"source ", 7) &&
+                   os.writeToFile(CHECK_COOK_INCLUDE, (void*)"include 1", 9);
+    Asset* asset = written ? addCookedAsset(database, CHECK_COOK_SOURCE, "check cooker", 1, cookCheckAsset,
+                                            swapCheckAsset, &cooked) : 0;
+    bool success = asset && addAssetDependency(asset, CHECK_COOK_INCLUDE);
+    updateAssetDatabase(database);
+    bool first = success && isCheckCookResult(&cooked, "source include 1") && cooked.cooks == 1;
+
+    success &= os.writeToFile(CHECK_COOK_INCLUDE, (void*)"include 2", 9);
+    markAssetFileChanged(database, CHECK_COOK_INCLUDE, 0);
+    updateAssetDatabase(database);
+    bool recooked = success && isCheckCookResult(&cooked, "source include 2") && cooked.cooks == 2;
+
+    success &= os.writeToFile(CHECK_COOK_INCLUDE, (void*)"include 1", 9);
+    markAssetFileChanged(database, CHECK_COOK_INCLUDE, 0);
+    updateAssetDatabase(database);
+    bool hit = success && isCheckCookResult(&cooked, "source include 1") && cooked.cooks == 2 && cache.hits == 1 &&
+               cache.misses == 2;
+    remove(CHECK_COOK_SOURCE);
+    remove(CHECK_COOK_INCLUDE);
+    success &= first && recooked && hit && !database->totalCookFailures;
+    printf("cooks first cook %s, include edit %s, include reverted %s\n", first ? "stored" : "FAILED",
+           recooked ? "cooked again" : "READ STALE BYTES", hit ? "read back from the cache" : "NOT HIT");
+    arena->used = arenaMark;
+    return success;
+}
+
+//The glyph atlas has to reach the platform layer's texture store whole the first time and through os->updateTexture2D
+//after, one upload of the rows new glyphs touched per flush, and read back the same as the cache's copy each time,
+//through the atlas starting over when it fills.
+static bool checkGlyphCache(HeadlessCheckContext* context){
+    OSInterface* os = context->os;
+    MemoryArena* arena = context->arena;
+    TextureStore* textures = context->textures;
+    u64 arenaMark = arena->used;
+    GlyphCache* cache = pushStruct(arena, GlyphCache);
+    if(!cache || !initializeGlyphCache(cache, CHECK_GLYPH_ATLAS_WIDTH, CHECK_GLYPH_ATLAS_HEIGHT, 12,
+                                       measureCheckGlyph, rasterizeCheckGlyph, 0, arena)){
+        printf("glyphs: out of memory\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    u64 texturesBefore = textures->stats.textures;
+    u64 updatesBefore = textures->stats.regionUpdates;
+    bool success = true;
+    u32 flushes = 0;
+    u32 codepoint = ' ';
+    u32 generation = cache->atlasGeneration;
+    //ascii, then greek and cyrillic until the atlas has started over once, with the missing glyph in between
+    while(cache->atlasGeneration == generation){
+        for(u32 i = 0; i < CHECK_GLYPH_BATCH; i++, codepoint = codepoint == '~' ? 0x391 : codepoint + 1){
+            success &= getGlyph(cache, codepoint) != 0;
+        }
+        success &= getGlyph(cache, 0xE000) == getGlyph(cache, '?');
+        flushGlyphAtlas(cache, os);
+        flushUploadScheduler(textures->uploads);
+        flushes++;
+        StoredTexture* stored = (StoredTexture*)cache->atlasTexture.data1;
+        success &= stored && stored->format == os->TEXTURE_FORMAT_R8 && isStoredTextureEqual(stored, cache->atlas);
+    }
+    u32 created = (u32)(textures->stats.textures - texturesBefore);
+    u32 updates = (u32)(textures->stats.regionUpdates - updatesBefore);
+    success &= created == 1 && updates == flushes - 1;
+    NullRenderDevice* device = (NullRenderDevice*)textures->backend->data;
+    success &= !device->stats.errors;
+    printf("glyphs %u flushes of %u to a %ux%u atlas until it started over, %u texture and %u region uploads%s\n",
+           flushes, CHECK_GLYPH_BATCH, cache->atlasWidth, cache->atlasHeight, created, updates,
+           success ? "" : ", FAILED");
+    arena->used = arenaMark;
+    return success;
+}
+
+#define CHECK_TEXT_STRINGS 256
+#define CHECK_TEXT_CHANGING 16
+#define CHECK_TEXT_FRAMES 120
+#define CHECK_TEXT_GLYPHS 16384
+
+static f32 kernCheckGlyphs(void* userData, u32 left, u32 right){
+    return left == 'A' && right == 'V' ? -2.0f : 0;
+}
+
+//"item ", the item, ": " and the value, in decimal
+static void writeCheckTextLine(s8* line, u32 item, u32 value){
+    u32 ctr = 0;
+    line[0] = '\0';
+    concatenateCharacterStrings(line, "item ", &ctr);
+    u32 numbers[2] = {item, value};
+    for(u32 n = 0; n < 2; n++){
+        if(n) line[ctr++] = ':', line[ctr++] = ' ';
+        s8 digits[10];
+        u32 totalDigits = 0;
+        do{
+            digits[totalDigits++] = (s8)('0' + numbers[n] % 10);
+            numbers[n] /= 10;
+        }while(numbers[n]);
+        while(totalDigits) line[ctr++] = digits[--totalDigits];
+    }
+    line[ctr] = '\0';
+}
+
+static bool isCheckGlyphMoved(TextGlyphInstance* a, TextGlyphInstance* b, f32 x, f32 y){
+    f32 e = 0.001f;
+    return fabsf(a->left + x - b->left) < e && fabsf(a->right + x - b->right) < e && fabsf(a->top + y - b->top) < e &&
+           fabsf(a->bottom + y - b->bottom) < e && a->atlasLeft == b->atlasLeft && a->atlasTop == b->atlasTop;
+}
+
+//A string drawn again has to come from the run cache, placed where it is drawn this time, wrapped text has to stay
+//inside its width on more than one line, and kerning has to move the glyph after the pair. Then a HUD of mostly static
+//strings, a few changing every frame, is drawn for a number of frames for the glyphs laid out per millisecond, cold
+//and once the runs are cached, and the bytes the frame's one text draw reads.
+static bool checkTextLayout(HeadlessCheckContext* context){
+    OSInterface* os = context->os;
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    GlyphCache* font = pushStruct(arena, GlyphCache);
+    TextLayoutCache* cache = pushStruct(arena, TextLayoutCache);
+    TextBatch batch;
+    TextGlyphInstance* kerned = pushArray(arena, TextGlyphInstance, 2);
+    if(!font || !cache || !kerned ||
+       !initializeGlyphCache(font, 256, 256, 12, measureCheckGlyph, rasterizeCheckGlyph, 0, arena) ||
+       !initializeTextLayoutCache(cache, CHECK_TEXT_GLYPHS, arena) ||
+       !initializeTextBatch(&batch, CHECK_TEXT_GLYPHS, arena)){
+        printf("text: out of memory\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    Vector4 white(1, 1, 1, 1);
+
+    beginTextFrame(cache, &batch);
+    TextRun* first = drawText(&batch, cache, font, "Hello, world", 10, 20, 1, white);
+    u32 firstGlyphs = batch.totalInstances;
+    beginTextFrame(cache, &batch);
+    u32 misses = cache->misses;
+    TextGlyphInstance* firstInstances = cache->glyphs + (first ? first->firstGlyph : 0);
+    TextRun* second = drawText(&batch, cache, font, "Hello, world", 30, 40, 1, white);
+    bool cached = first && second == first && cache->misses == misses && batch.totalInstances == firstGlyphs &&
+                  firstGlyphs == 11;
+    for(u32 i = 0; cached && i < batch.totalInstances; i++){
+        cached = isCheckGlyphMoved(&firstInstances[i], &batch.instances[i], 30, 40);
+    }
+
+    beginTextFrame(cache, &batch);
+    f32 wrapWidth = 40;
+    TextRun* wrapped = drawText(&batch, cache, font, "the quick brown fox jumps over the lazy dog", 0, 0, 1, white,
+                                wrapWidth);
+    bool wraps = wrapped && wrapped->height > font->lineHeight * 2;
+    for(u32 i = 0; wraps && i < batch.totalInstances; i++){
+        wraps = batch.instances[i].right <= wrapWidth + 0.001f;
+    }
+
+    f32 width;
+    f32 height;
+    font->kernGlyphs = kernCheckGlyphs;
+    bool kerns = layoutTextRun(font, "AV", 1, 0, kerned, 2, &width, &height) == 2;
+    f32 kernedLeft = kerned[1].left;
+    font->kernGlyphs = 0;
+    kerns &= layoutTextRun(font, "AV", 1, 0, kerned, 2, &width, &height) == 2;
+    kerns &= fabsf(kerned[1].left - kernedLeft - 2.0f) < 0.001f;
+    printf("text cached run %s, wrapped %s, kerned %s\n", cached ? "placed" : "WRONG", wraps ? "inside its width" : "WRONG",
+           kerns ? "pair moved" : "WRONG");
+
+    u32 hits = cache->hits;
+    misses = cache->misses;
+    u64 coldTime = 0;
+    u64 warmTime = 0;
+    u32 coldGlyphs = 0;
+    u64 warmGlyphs = 0;
+    u32 bytes = 0;
+    bool drawn = true;
+    s8 line[32];
+    for(u32 frame = 0; frame < CHECK_TEXT_FRAMES; frame++){
+        u64 start = context->getMicroseconds();
+        beginTextFrame(cache, &batch);
+        for(u32 i = 0; i < CHECK_TEXT_STRINGS; i++){
+            //the first few show a value that changes every frame, the rest stay as they are
+            writeCheckTextLine(line, i, i < CHECK_TEXT_CHANGING ? frame * 7919 + i : i * 31);
+            drawn &= drawText(&batch, cache, font, line, 8, 8 + (f32)i * font->lineHeight, 1, white) != 0;
+        }
+        bytes = finishTextBatch(&batch, font, os);
+        u64 time = context->getMicroseconds() - start;
+        if(!frame){
+            coldTime = time;
+            coldGlyphs = batch.totalInstances;
+        }else{
+            warmTime += time;
+            warmGlyphs += batch.totalInstances;
+        }
+    }
+    u32 frameHits = cache->hits - hits;
+    u32 frameMisses = cache->misses - misses;
+    drawn &= font->atlasTexture.data1 != 0 && bytes == batch.totalInstances * sizeof(TextGlyphInstance);
+    printf("text %u strings, %u glyphs and %.1f KB a frame, %.0f glyphs/ms cold and %.0f cached, %.1f%% run hits%s\n",
+           CHECK_TEXT_STRINGS, batch.totalInstances, bytes / 1024.0, coldGlyphs * 1000.0 / (coldTime ? coldTime : 1),
+           warmGlyphs * 1000.0 / (warmTime ? warmTime : 1), 100.0 * frameHits / (frameHits + frameMisses),
+           drawn ? "" : ", FAILED");
+    arena->used = arenaMark;
+    return cached && wraps && kerns && drawn;
+}
+
+#define CHECK_FONT_EM_SIZE 32.0f
+#define CHECK_FONT_RANGE 4.0f
+#define CHECK_FONT_CJK_FIRST 0x4E00
+#define CHECK_FONT_CJK_GLYPHS 3500
+#define CHECK_FONT_MAX_CODEPOINTS 4096
+#define CHECK_FONT_OUTPUT_SIZE MEGABYTE(16)
+
+//the box Latin glyphs are drawn around, in em units: left, bottom, right, top
+static Vector4 getCheckFontBox(u32 codepoint){
+    f32 width = 0.3f + (f32)(codepoint % 5) * 0.05f;
+    return Vector4(0.1f, 0, 0.1f + width, 0.7f);
+}
+
+static void addCheckFontRect(FontOutlineSegment* segments, u32* total, Vector4 box, u32 contour, bool hole){
+    Vector2 corners[4] = {Vector2(box.x, box.y), Vector2(box.x, box.w), Vector2(box.z, box.w), Vector2(box.z, box.y)};
+    for(u32 i = 0; i < 4; i++){
+        FontOutlineSegment* segment = &segments[(*total)++];
+        setMemory(segment, sizeof(FontOutlineSegment));
+        segment->type = FONT_SEGMENT_LINE;
+        segment->contour = contour;
+        segment->p0 = hole ? corners[(4 - i) & 3] : corners[i];
+        segment->p1 = hole ? corners[3 - i] : corners[(i + 1) & 3];
+    }
+}
+
+//Latin glyphs are boxes, rings for odd codepoints and bowls with quadratic sides for multiples of 3, CJK ones two to
+//four bars across and one or two down. U+3000 to U+4DFF are missing, space has no outline.
+static bool getCheckGlyphOutline(void* userData, u32 codepoint, FontOutlineSegment* segments, u32 capacity,
+                                 u32* totalSegments, f32* advance){
+    *totalSegments = 0;
+    if(codepoint >= 0x3000 && codepoint < CHECK_FONT_CJK_FIRST){
+        return false;
+    }
+    if(codepoint >= CHECK_FONT_CJK_FIRST){
+        *advance = 1;
+        u32 across = 2 + codepoint % 3;
+        u32 down = 1 + (codepoint / 3) % 2;
+        for(u32 i = 0; i < across; i++){
+            f32 y = 0.05f + (f32)i * 0.8f / across;
+            addCheckFontRect(segments, totalSegments, Vector4(0.05f, y, 0.95f, y + 0.08f), i, false);
+        }
+        for(u32 i = 0; i < down; i++){
+            f32 x = 0.3f + (f32)i * 0.35f;
+            addCheckFontRect(segments, totalSegments, Vector4(x, 0, x + 0.08f, 0.9f), across + i, false);
+        }
+        return true;
+    }
+    Vector4 box = getCheckFontBox(codepoint);
+    *advance = box.z + 0.1f;
+    if(codepoint == ' '){
+        return true;
+    }
+    if(codepoint % 3 == 0){
+        //a diamond whose sides bow outwards through control points past the box's edges
+        Vector2 centre((box.x + box.z) * 0.5f, (box.y + box.w) * 0.5f);
+        Vector2 points[4] = {Vector2(box.x, centre.y), Vector2(centre.x, box.w), Vector2(box.z, centre.y),
+                             Vector2(centre.x, box.y)};
+        Vector2 controls[4] = {Vector2(box.x, box.w), Vector2(box.z, box.w), Vector2(box.z, box.y),
+                               Vector2(box.x, box.y)};
+        for(u32 i = 0; i < 4; i++){
+            FontOutlineSegment* segment = &segments[(*totalSegments)++];
+            setMemory(segment, sizeof(FontOutlineSegment));
+            segment->type = FONT_SEGMENT_QUADRATIC;
+            segment->p0 = points[i];
+            segment->p1 = controls[i];
+            segment->p2 = points[(i + 1) & 3];
+        }
+        return true;
+    }
+    addCheckFontRect(segments, totalSegments, box, 0, false);
+    if(codepoint & 1){
+        f32 inset = 0.08f;
+        addCheckFontRect(segments, totalSegments, Vector4(box.x + inset, box.y + inset, box.z - inset, box.w - inset), 1,
+                         true);
+    }
+    return true;
+}
+
+//the texels the records cover over the atlas, padding left out
+static f32 getCheckFontPacking(void* atlas){
+    FontAtlasHeader* header = (FontAtlasHeader*)atlas;
+    GlyphRecord* records = (GlyphRecord*)(header + 1);
+    u64 used = 0;
+    for(u32 i = 0; i < header->totalGlyphs; i++){
+        used += (u64)records[i].atlasWidth * records[i].atlasHeight;
+    }
+    return (f32)used / ((f32)header->atlasWidth * header->atlasHeight);
+}
+
+//A Latin and CJK subset is built into a single channel atlas and its Latin part into a multi channel one, for the time
+//each takes, how tightly the skyline packs their glyphs and their size written with writeCompressedAssetToFile. The
+//distances of a box glyph have to be within 0.05 pixels of the analytic ones, past the 8 bit rounding, the multi
+//channel median has to agree with them about inside and outside, and the atlas loaded into a GlyphCache has to find
+//its glyphs, draw missing ones as its missing codepoint and reach the texture store whole through flushGlyphAtlas.
+static bool checkFontAtlas(HeadlessCheckContext* context){
+    OSInterface* os = context->os;
+    MemoryArena* arena = context->arena;
+    TextureStore* textures = context->textures;
+    u64 arenaMark = arena->used;
+    u32* codepoints = pushArray(arena, u32, CHECK_FONT_MAX_CODEPOINTS);
+    u8* sdf = (u8*)pushSize(arena, CHECK_FONT_OUTPUT_SIZE);
+    u8* msdf = (u8*)pushSize(arena, CHECK_FONT_OUTPUT_SIZE);
+    GlyphCache* cache = pushStruct(arena, GlyphCache);
+    if(!codepoints || !sdf || !msdf || !cache){
+        printf("fonts: out of memory\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    u32 totalLatin = 0;
+    for(u32 c = 0x20; c < 0x250; c++){
+        if(c < 0x7F || c >= 0xA0) codepoints[totalLatin++] = c;
+    }
+    for(u32 c = 0x1E00; c < 0x1E80; c++){
+        codepoints[totalLatin++] = c;
+    }
+    u32 totalCodepoints = totalLatin;
+    for(u32 i = 0; i < CHECK_FONT_CJK_GLYPHS; i++){
+        codepoints[totalCodepoints++] = CHECK_FONT_CJK_FIRST + i;
+    }
+    FontAtlasSettings settings = {};
+    settings.emSize = CHECK_FONT_EM_SIZE;
+    settings.distanceRange = CHECK_FONT_RANGE;
+    settings.ascender = 0.9f;
+    settings.lineHeight = 1.2f;
+    settings.atlasWidth = 4096;
+    settings.maxAtlasHeight = 4096;
+    settings.missingCodepoint = '?';
+
+    u64 start = context->getMicroseconds();
+    u32 sdfSize = buildFontAtlas(&settings, codepoints, totalCodepoints, getCheckGlyphOutline, 0, sdf,
+                                 CHECK_FONT_OUTPUT_SIZE, arena, os, context->queue);
+    u64 sdfTime = context->getMicroseconds() - start;
+    settings.multiChannel = true;
+    settings.atlasWidth = 1024;
+    start = context->getMicroseconds();
+    u32 msdfSize = buildFontAtlas(&settings, codepoints, totalLatin, getCheckGlyphOutline, 0, msdf,
+                                  CHECK_FONT_OUTPUT_SIZE, arena, os, context->queue);
+    u64 msdfTime = context->getMicroseconds() - start;
+    bool built = sdfSize && msdfSize;
+
+    //written the way the asset pipeline ships them, then dropped
+    u32 compressedSizes[2] = {};
+    u8* atlases[2] = {sdf, msdf};
+    u32 sizes[2] = {sdfSize, msdfSize};
+    for(u32 i = 0; built && i < 2; i++){
+        u64 scratchMark = arena->used;
+        u32 capacity = compressAssetBound(sizes[i], LZ_DEFAULT_CHUNK_SIZE);
+        u8* compressed = (u8*)pushSize(arena, capacity);
+        compressedSizes[i] = compressed ? compressAsset(atlases[i], sizes[i], compressed, capacity, arena) : 0;
+        arena->used = scratchMark;
+    }
+    for(u32 i = 0; built && i < 2; i++){
+        FontAtlasHeader* header = (FontAtlasHeader*)atlases[i];
+        printf("fonts %s %u glyphs in %.0f ms, %ux%u atlas %.1f%% packed, %.2f MB, %.2f MB compressed\n",
+               i ? "msdf" : "sdf", header->totalGlyphs, (i ? msdfTime : sdfTime) / 1000.0, header->atlasWidth,
+               header->atlasHeight, 100.0f * getCheckFontPacking(atlases[i]), sizes[i] / 1048576.0,
+               compressedSizes[i] / 1048576.0);
+    }
+
+    //'b' is a plain box, its texels decode to the distance from their centre to its edges
+    f32 maxError = 0;
+    bool insideAgrees = true;
+    for(u32 i = 0; built && i < 2; i++){
+        FontAtlasHeader* header = (FontAtlasHeader*)atlases[i];
+        GlyphRecord* records = (GlyphRecord*)(header + 1);
+        u8* texels = (u8*)(records + header->totalGlyphs);
+        GlyphRecord* record = 0;
+        for(u32 g = 0; g < header->totalGlyphs; g++){
+            if(records[g].codepoint == 'b') record = &records[g];
+        }
+        if(!record){
+            built = false;
+            break;
+        }
+        Vector4 box = getCheckFontBox('b');
+        f32 emSize = header->emSize;
+        f32 left = record->xOffset;
+        f32 top = settings.ascender * emSize - record->yOffset;
+        u32 channels = header->atlasChannels;
+        for(u32 y = 0; y < record->atlasHeight; y++){
+            for(u32 x = 0; x < record->atlasWidth; x++){
+                f32 px = (left + x + 0.5f) / emSize;
+                f32 py = (top - y - 0.5f) / emSize;
+                f32 dx = fmaxf(box.x - px, px - box.z);
+                f32 dy = fmaxf(box.y - py, py - box.w);
+                f32 outside = sqrtf(fmaxf(dx, 0) * fmaxf(dx, 0) + fmaxf(dy, 0) * fmaxf(dy, 0));
+                f32 expected = (outside > 0 ? -outside : -fmaxf(dx, dy)) * emSize;
+                u8* texel = texels + ((u64)(record->atlasY + y) * header->atlasWidth + record->atlasX + x) * channels;
+                f32 decoded = ((f32)texel[channels - 1] / 255.0f - 0.5f) * header->distanceRange;
+                //saturated texels only say which side they are on
+                if(fabsf(expected) < header->distanceRange * 0.5f - 0.1f){
+                    f32 error = fabsf(decoded - expected) - 0.5f / 255.0f * header->distanceRange;
+                    if(error > maxError) maxError = error;
+                }
+                if(channels == 4 && fabsf(expected) > 0.5f){
+                    u8 median = texel[0] < texel[1] ? (texel[1] < texel[2] ? texel[1] : texel[0] > texel[2] ? texel[0] :
+                                texel[2]) : (texel[0] < texel[2] ? texel[0] : texel[1] > texel[2] ? texel[1] : texel[2]);
+                    insideAgrees &= (median > 127) == (expected > 0);
+                }
+            }
+        }
+    }
+    bool accurate = built && maxError < 0.05f && insideAgrees;
+    printf("fonts box distances within %.3f px of analytic past the 8 bit rounding, msdf median %s\n", maxError,
+           insideAgrees ? "agrees on every side" : "DISAGREES");
+
+    u64 texturesBefore = textures->stats.textures;
+    bool loaded = built && loadFontAtlas(cache, sdf, sdfSize, arena);
+    if(loaded){
+        GlyphRecord* box = getGlyph(cache, 'b');
+        GlyphRecord* cjk = getGlyph(cache, CHECK_FONT_CJK_FIRST + 7);
+        GlyphRecord* missing = getGlyph(cache, 0x3001);
+        loaded = box && box->codepoint == 'b' && cjk && cjk->codepoint == CHECK_FONT_CJK_FIRST + 7 && missing &&
+                 missing->codepoint == '?' && cache->totalRecords == ((FontAtlasHeader*)sdf)->totalGlyphs;
+        flushGlyphAtlas(cache, os);
+        flushUploadScheduler(textures->uploads);
+        StoredTexture* stored = (StoredTexture*)cache->atlasTexture.data1;
+        loaded &= stored && textures->stats.textures == texturesBefore + 1 && stored->format == os->TEXTURE_FORMAT_R8 &&
+                  isStoredTextureEqual(stored, cache->atlas);
+    }
+    NullRenderDevice* device = (NullRenderDevice*)textures->backend->data;
+    loaded &= !device->stats.errors;
+    printf("fonts sdf atlas loaded into a glyph cache and uploaded%s\n", loaded ? "" : ", FAILED");
+    arena->used = arenaMark;
+    return built && accurate && loaded;
+}
+
+#define CHECK_RING_SIZE 1024
+#define CHECK_RING_JOBS 8
+#define CHECK_RING_JOB_ALLOCATIONS 96
+#define CHECK_RING_SHARED_SIZE KILOBYTE(256)
+
+struct CheckRingJob {
+    UploadRing* ring;
+    UploadAllocation allocations[CHECK_RING_JOB_ALLOCATIONS];
+    u32 alignments[CHECK_RING_JOB_ALLOCATIONS];
+    u32 totalAllocations;
+    u32 seed;
+};
+
+//sizes and alignments vary per allocation, the way constants, vertices and texture rows mix in a frame
+static void allocateCheckRing(void* data){
+    CheckRingJob* job = (CheckRingJob*)data;
+    job->totalAllocations = 0;
+    u32 seed = job->seed;
+    for(u32 i = 0; i < CHECK_RING_JOB_ALLOCATIONS; i++){
+        seed = xorshift(seed);
+        u32 alignment = 16u << (seed % 4);
+        if(allocateUploadRing(job->ring, 1 + (seed >> 8) % 128, alignment, &job->allocations[job->totalAllocations])){
+            job->alignments[job->totalAllocations++] = alignment;
+        }
+    }
+}
+
+//The ring is run on plain memory with a counter for the fence. A frame's memory comes back only once the counter
+//reaches the frame's fence value, a frame whose span runs into the end of the ring skips to its start, the frames in
+//flight holding the ring fail what does not fit and count it, frames past UPLOAD_RING_MAX_FRAMES fold into the newest,
+//and allocations made from the work queue at once never overlap.
+static bool checkUploadRing(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    UploadRing* ring = pushStruct(arena, UploadRing);
+    u8* memory = (u8*)pushSize(arena, CHECK_RING_SHARED_SIZE);
+    u8* coverage = (u8*)pushSize(arena, CHECK_RING_SHARED_SIZE);
+    CheckRingJob* jobs = pushArray(arena, CheckRingJob, CHECK_RING_JOBS);
+    if(!ring || !memory || !coverage || !jobs){
+        printf("ring: out of memory\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    initializeUploadRingMemory(ring, memory, 0, CHECK_RING_SIZE);
+    UploadAllocation a, b, c, d;
+    //frame 1 takes 800 bytes, frame 2 finds only the 224 after them while frame 1 is in flight
+    beginUploadRingFrame(ring, 0);
+    bool filled = allocateUploadRing(ring, 400, 16, &a) && allocateUploadRing(ring, 400, 16, &b) &&
+                  a.offset == 0 && b.offset == 400;
+    endUploadRingFrame(ring, 1);
+    beginUploadRingFrame(ring, 0);
+    bool full = !allocateUploadRing(ring, 300, 16, &c) && allocateUploadRing(ring, 200, 16, &c) && c.offset == 800;
+    endUploadRingFrame(ring, 2);
+    full &= ring->stats.failedAllocations == 1;
+    //the counter reaching 1 gives frame 1 back and nothing else, frame 3 skips the 24 bytes left at the end
+    beginUploadRingFrame(ring, 1);
+    bool reclaimed = ring->usedBytes == 200 && ring->totalFrames == 1;
+    bool wrapped = allocateUploadRing(ring, 100, 16, &a) && a.offset == 0 && allocateUploadRing(ring, 16, 256, &b) &&
+                   b.offset == 256 && !allocateUploadRing(ring, 600, 16, &d) && allocateUploadRing(ring, 500, 16, &d) &&
+                   d.offset == 272;
+    endUploadRingFrame(ring, 3);
+    wrapped &= ring->head == 772 && ring->usedBytes == 200 + 24 + 772;
+    beginUploadRingFrame(ring, 2);
+    reclaimed &= ring->usedBytes == 24 + 772 && ring->tail == 1000;
+    beginUploadRingFrame(ring, 3);
+    reclaimed &= !ring->usedBytes && !ring->totalFrames && ring->firstSpanSize == CHECK_RING_SIZE;
+    endUploadRingFrame(ring, 3);
+
+    //four more frames than the list holds, the last five end up as one frame with the last fence value
+    u32 totalFrames = UPLOAD_RING_MAX_FRAMES + 4;
+    bool folded = true;
+    for(u32 i = 0; i < totalFrames && folded; i++){
+        beginUploadRingFrame(ring, 3);
+        folded = allocateUploadRing(ring, 32, 16, &a) && a.offset == i * 32;
+        endUploadRingFrame(ring, 4 + i);
+    }
+    folded &= ring->totalFrames == UPLOAD_RING_MAX_FRAMES && ring->usedBytes == totalFrames * 32;
+    beginUploadRingFrame(ring, 3 + totalFrames - 1);
+    folded &= ring->totalFrames == 1 && ring->usedBytes == 5 * 32;
+    beginUploadRingFrame(ring, 3 + totalFrames);
+    folded &= !ring->usedBytes;
+    endUploadRingFrame(ring, 3 + totalFrames);
+
+    //every byte handed out from the queue is claimed once
+    initializeUploadRingMemory(ring, memory, 0, CHECK_RING_SHARED_SIZE);
+    beginUploadRingFrame(ring, 0);
+    for(u32 i = 0; i < CHECK_RING_JOBS; i++){
+        jobs[i].ring = ring;
+        jobs[i].seed = 0x510E527F + i * 0x9E3779B9;
+        context->os->addWorkQueueEntry(context->queue, allocateCheckRing, &jobs[i]);
+    }
+    context->os->completeWorkQueueEntries(context->queue);
+    endUploadRingFrame(ring, 1);
+    setMemory(coverage, CHECK_RING_SHARED_SIZE);
+    u32 totalAllocations = 0;
+    bool apart = !ring->stats.failedAllocations;
+    for(u32 i = 0; i < CHECK_RING_JOBS; i++){
+        for(u32 j = 0; j < jobs[i].totalAllocations && apart; j++){
+            UploadAllocation* allocation = &jobs[i].allocations[j];
+            apart = allocation->offset % jobs[i].alignments[j] == 0 &&
+                    allocation->offset + allocation->size <= CHECK_RING_SHARED_SIZE;
+            for(u32 k = 0; k < allocation->size && apart; k++){
+                apart = !coverage[allocation->offset + k]++;
+            }
+        }
+        totalAllocations += jobs[i].totalAllocations;
+    }
+    apart &= totalAllocations == CHECK_RING_JOBS * CHECK_RING_JOB_ALLOCATIONS;
+
+    bool success = filled && full && reclaimed && wrapped && folded && apart;
+    printf("ring fenced reclaim %s, full ring %s, wrap %s, %u frames %s\n", reclaimed ? "ok" : "FAILED",
+           full ? "refused and counted" : "NOT REFUSED", filled && wrapped ? "skipped to the start" : "FAILED",
+           totalFrames, folded ? "folded into the list" : "NOT FOLDED");
+    printf("ring %u allocations from %u jobs at once, %s\n", totalAllocations, CHECK_RING_JOBS,
+           apart ? "none overlap" : "OVERLAPPING OR REFUSED");
+    arena->used = arenaMark;
+    return success;
+}
+
+#define CHECK_DESCRIPTOR_JOBS 8
+#define CHECK_DESCRIPTOR_JOB_ALLOCATIONS 256
+#define CHECK_DESCRIPTOR_HELD 16
+#define CHECK_DESCRIPTOR_TABLE_SIZE 4
+#define CHECK_DESCRIPTOR_PERSISTENT 8192
+#define CHECK_DESCRIPTOR_TRANSIENT 4096
+#define CHECK_DESCRIPTOR_FRAMES 24
+#define CHECK_DESCRIPTOR_LAG 2
+
+//owners is the job holding each persistent slot plus one, fences the fence value of the frame that last retired a
+//persistent slot or took a transient one
+struct CheckDescriptorJob {
+    DescriptorAllocator* allocator;
+    volatile u32* owners;
+    volatile u64* fences;
+    u64 fenceValue;
+    u64 completedFenceValue;
+    u32 id;
+    u32 seed;
+    u32 allocations;
+    u32 conflicts;
+};
+
+//Holds up to CHECK_DESCRIPTOR_HELD slots at a time and gives one back at random, half of them freed at once and half
+//retired, taking a transient table every few slots. A slot another job holds, or one whose frame the gpu may still
+//be reading, is a conflict.
+static void churnCheckDescriptors(void* data){
+    CheckDescriptorJob* job = (CheckDescriptorJob*)data;
+    DescriptorAllocator* allocator = job->allocator;
+    u32 held[CHECK_DESCRIPTOR_HELD];
+    u32 totalHeld = 0;
+    u32 seed = job->seed;
+    for(u32 i = 0; i < CHECK_DESCRIPTOR_JOB_ALLOCATIONS; i++){
+        seed = xorshift(seed);
+        u32 index = allocateDescriptor(allocator);
+        if(index != DESCRIPTOR_INDEX_NONE){
+            job->allocations++;
+            if(atomicCompareExchange(&job->owners[index], job->id + 1, 0) != 0 ||
+               job->fences[index] > job->completedFenceValue){
+                job->conflicts++;
+            }
+            held[totalHeld++] = index;
+        }
+        if(totalHeld == CHECK_DESCRIPTOR_HELD || (totalHeld && seed % 3 == 0)){
+            u32 pick = (seed >> 8) % totalHeld;
+            u32 slot = held[pick];
+            held[pick] = held[--totalHeld];
+            job->fences[slot] = seed & 16 ? job->fenceValue : 0;
+            atomicCompareExchange(&job->owners[slot], 0, job->id + 1);
+            if(seed & 16){
+                retireDescriptor(allocator, slot);
+            }else{
+                freeDescriptor(allocator, slot);
+            }
+        }
+        if(i % 8 == 0){
+            u32 table = allocateTransientDescriptors(allocator, CHECK_DESCRIPTOR_TABLE_SIZE);
+            if(table == DESCRIPTOR_INDEX_NONE || table < allocator->persistentCount ||
+               table + CHECK_DESCRIPTOR_TABLE_SIZE > allocator->persistentCount + CHECK_DESCRIPTOR_TRANSIENT){
+                job->conflicts++;
+                continue;
+            }
+            for(u32 j = table; j < table + CHECK_DESCRIPTOR_TABLE_SIZE; j++){
+                u64 fence = job->fences[j];
+                if(fence > job->completedFenceValue ||
+                   atomicCompareExchange64(&job->fences[j], job->fenceValue, fence) != fence){
+                    job->conflicts++;
+                }
+            }
+        }
+    }
+    for(u32 i = 0; i < totalHeld; i++){
+        job->fences[held[i]] = job->fenceValue;
+        atomicCompareExchange(&job->owners[held[i]], 0, job->id + 1);
+        retireDescriptor(allocator, held[i]);
+    }
+}
+
+//takes every persistent slot the allocator will hand out and frees them again
+static u32 countFreeCheckDescriptors(DescriptorAllocator* allocator, u32* slots){
+    u32 total = 0;
+    while((slots[total] = allocateDescriptor(allocator)) != DESCRIPTOR_INDEX_NONE){
+        total++;
+    }
+    for(u32 i = 0; i < total; i++){
+        freeDescriptor(allocator, slots[i]);
+    }
+    return total;
+}
+
+//The allocator is run on a heap with no backend behind it and a counter for the fence. Retired slots and transient
+//tables come back once the counter reaches their frame's fence value and not before, transient tables are
+//contiguous runs of the transient range, frames past DESCRIPTOR_ALLOCATOR_MAX_FRAMES fold into the newest, and jobs
+//churning slots from the work queue with the gpu a few frames behind are never handed a slot twice.
+static bool checkDescriptorAllocator(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    u32 capacity = CHECK_DESCRIPTOR_PERSISTENT + CHECK_DESCRIPTOR_TRANSIENT;
+    DescriptorAllocator* allocator = pushStruct(arena, DescriptorAllocator);
+    u32* slots = pushArray(arena, u32, capacity + 1);
+    volatile u32* owners = pushArray(arena, u32, capacity);
+    volatile u64* fences = pushArray(arena, u64, capacity);
+    CheckDescriptorJob* jobs = pushArray(arena, CheckDescriptorJob, CHECK_DESCRIPTOR_JOBS);
+    if(!allocator || !slots || !owners || !fences || !jobs){
+        printf("descriptors: out of memory\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    RenderDescriptorHeap heap = {};
+    heap.type = RENDER_DESCRIPTORS_RESOURCE;
+
+    //frame 1 takes all four slots and all four tables, none comes back before the counter reaches 1
+    heap.capacity = 20;
+    bool reclaimed = initializeDescriptorAllocatorHeap(allocator, &heap, 4, arena);
+    for(u32 i = 0; i < 4 && reclaimed; i++){
+        slots[i] = allocateDescriptor(allocator);
+        u32 table = allocateTransientDescriptors(allocator, 4);
+        reclaimed = slots[i] != DESCRIPTOR_INDEX_NONE && table == 4 + i * 4;
+    }
+    reclaimed = reclaimed && allocateDescriptor(allocator) == DESCRIPTOR_INDEX_NONE &&
+                allocateTransientDescriptors(allocator, 1) == DESCRIPTOR_INDEX_NONE;
+    for(u32 i = 0; i < 4 && reclaimed; i++){
+        retireDescriptor(allocator, slots[i]);
+    }
+    endDescriptorFrame(allocator, 1);
+    beginDescriptorFrame(allocator, 0);
+    reclaimed = reclaimed && allocateDescriptor(allocator) == DESCRIPTOR_INDEX_NONE &&
+                allocateTransientDescriptors(allocator, 1) == DESCRIPTOR_INDEX_NONE;
+    endDescriptorFrame(allocator, 2);
+    beginDescriptorFrame(allocator, 1);
+    u32 table = allocateTransientDescriptors(allocator, 16);
+    reclaimed = reclaimed && countFreeCheckDescriptors(allocator, slots) == 4 && table == 4 &&
+                allocator->stats.failedAllocations == 4;
+    endDescriptorFrame(allocator, 3);
+
+    //four more frames than the list holds retiring a slot each, the last five go back together on the last fence
+    u32 totalFrames = DESCRIPTOR_ALLOCATOR_MAX_FRAMES + 4;
+    heap.capacity = totalFrames;
+    bool folded = initializeDescriptorAllocatorHeap(allocator, &heap, totalFrames, arena);
+    for(u32 i = 0; i < totalFrames && folded; i++){
+        u32 index = allocateDescriptor(allocator);
+        folded = index != DESCRIPTOR_INDEX_NONE;
+        if(folded){
+            retireDescriptor(allocator, index);
+        }
+        endDescriptorFrame(allocator, i + 1);
+    }
+    folded = folded && allocator->totalFrames == DESCRIPTOR_ALLOCATOR_MAX_FRAMES &&
+             countFreeCheckDescriptors(allocator, slots) == 0;
+    beginDescriptorFrame(allocator, totalFrames - 1);
+    folded = folded && allocator->totalFrames == 1 &&
+             countFreeCheckDescriptors(allocator, slots) == DESCRIPTOR_ALLOCATOR_MAX_FRAMES - 1;
+    beginDescriptorFrame(allocator, totalFrames);
+    folded = folded && !allocator->totalFrames && countFreeCheckDescriptors(allocator, slots) == totalFrames;
+
+    //the gpu finishes a frame CHECK_DESCRIPTOR_LAG frames after it is recorded
+    heap.capacity = capacity;
+    bool initialized = initializeDescriptorAllocatorHeap(allocator, &heap, CHECK_DESCRIPTOR_PERSISTENT, arena);
+    setMemory((void*)owners, sizeof(u32) * capacity);
+    setMemory((void*)fences, sizeof(u64) * capacity);
+    setMemory(jobs, sizeof(CheckDescriptorJob) * CHECK_DESCRIPTOR_JOBS);
+    u64 completed = 0;
+    for(u32 frame = 1; frame <= CHECK_DESCRIPTOR_FRAMES && initialized; frame++){
+        completed = frame > CHECK_DESCRIPTOR_LAG ? frame - CHECK_DESCRIPTOR_LAG - 1 : 0;
+        beginDescriptorFrame(allocator, completed);
+        for(u32 i = 0; i < CHECK_DESCRIPTOR_JOBS; i++){
+            jobs[i].allocator = allocator;
+            jobs[i].owners = owners;
+            jobs[i].fences = fences;
+            jobs[i].fenceValue = frame;
+            jobs[i].completedFenceValue = completed;
+            jobs[i].id = i;
+            jobs[i].seed = 0x6A09E667 + (frame * CHECK_DESCRIPTOR_JOBS + i) * 0x9E3779B9;
+            context->os->addWorkQueueEntry(context->queue, churnCheckDescriptors, &jobs[i]);
+        }
+        context->os->completeWorkQueueEntries(context->queue);
+        endDescriptorFrame(allocator, frame);
+    }
+    u32 allocations = 0;
+    u32 conflicts = 0;
+    for(u32 i = 0; i < CHECK_DESCRIPTOR_JOBS; i++){
+        allocations += jobs[i].allocations;
+        conflicts += jobs[i].conflicts;
+    }
+    //with every frame done every persistent slot is free again
+    beginDescriptorFrame(allocator, CHECK_DESCRIPTOR_FRAMES);
+    bool apart = initialized && !conflicts && !allocator->stats.failedAllocations &&
+                 allocations == CHECK_DESCRIPTOR_JOBS * CHECK_DESCRIPTOR_JOB_ALLOCATIONS * CHECK_DESCRIPTOR_FRAMES &&
+                 countFreeCheckDescriptors(allocator, slots) == CHECK_DESCRIPTOR_PERSISTENT;
+
+    bool success = reclaimed && folded && apart;
+    printf("descriptors fenced reclaim %s, %u frames %s\n", reclaimed ? "ok" : "FAILED", totalFrames,
+           folded ? "folded into the list" : "NOT FOLDED");
+    printf("descriptors %u allocations from %u jobs over %u frames, %s\n", allocations, CHECK_DESCRIPTOR_JOBS,
+           CHECK_DESCRIPTOR_FRAMES, apart ? "none handed out twice" : "HANDED OUT TWICE OR LOST");
+    arena->used = arenaMark;
+    return success;
+}
+
+#define SAMPLE_GRAPH_COPY_SIZE KILOBYTE(64)
+#define SAMPLE_GRAPH_MAX_READS 3
+#define SAMPLE_CHAIN_PASSES 8
+
+//reads and write are render graph handles, write RENDER_GRAPH_NONE for passes that only read
+struct SampleGraphPass {
+    RenderGraph* graph;
+    u32 reads[SAMPLE_GRAPH_MAX_READS];
+    u32 totalReads;
+    u32 write;
+};
+
+//copies a piece of every resource the pass reads into the one it writes
+static void executeSampleCopyPass(RenderCommandList* list, void* userData){
+    SampleGraphPass* pass = (SampleGraphPass*)userData;
+    RenderResource* dst = getRenderGraphBuffer(pass->graph, pass->write);
+    for(u32 i = 0; i < pass->totalReads; i++){
+        RenderResource* src = getRenderGraphBuffer(pass->graph, pass->reads[i]);
+        list->backend->copyBuffer(list, dst, i * SAMPLE_GRAPH_COPY_SIZE, src, 0, SAMPLE_GRAPH_COPY_SIZE);
+    }
+}
+
+//stands in for the full screen draw that combines the lighting and bloom
+static void executeSampleCompositePass(RenderCommandList* list, void* userData){
+    SampleGraphPass* pass = (SampleGraphPass*)userData;
+    list->backend->clearRenderTarget(list, getRenderGraphBuffer(pass->graph, pass->write), Vector4(0, 0, 0, 1));
+}
+
+static u32 addSampleGraphPass(RenderGraph* graph, SampleGraphPass* pass, const s8* name,
+                              void (*execute)(RenderCommandList* list, void* userData), u32 write, u32 writeState,
+                              u32 read0 = RENDER_GRAPH_NONE, u32 read1 = RENDER_GRAPH_NONE,
+                              u32 read2 = RENDER_GRAPH_NONE, u32 readState = RENDER_STATE_COPY_SOURCE){
+    u32 reads[SAMPLE_GRAPH_MAX_READS] = {read0, read1, read2};
+    u32 handle = addRenderGraphPass(graph, name, execute, pass);
+    pass->graph = graph;
+    pass->write = write;
+    pass->totalReads = 0;
+    for(u32 i = 0; i < SAMPLE_GRAPH_MAX_READS; i++){
+        if(reads[i] != RENDER_GRAPH_NONE){
+            pass->reads[pass->totalReads++] = reads[i];
+            readRenderGraphResource(graph, handle, reads[i], readState);
+        }
+    }
+    writeRenderGraphResource(graph, handle, write, writeState);
+    return handle;
+}
+
+//shadows, depth prepass, gbuffer, lighting, two bloom passes and a composite into the back buffer, plus a debug view
+//of the gbuffer that nothing reads
+static bool buildSampleFrameGraph(RenderGraph* graph, SampleGraphPass* passes, RenderResource* source,
+                                  RenderResource* backBuffer, u32* backBufferHandle){
+    initializeRenderGraph(graph);
+    u32 sourceHandle = importRenderGraphResource(graph, "source", source, RENDER_STATE_COPY_SOURCE,
+                                                 RENDER_STATE_COPY_SOURCE);
+    *backBufferHandle = importRenderGraphResource(graph, "back buffer", backBuffer, RENDER_STATE_RENDER_TARGET,
+                                                  RENDER_STATE_RENDER_TARGET);
+    u32 shadows = createRenderGraphBuffer(graph, "shadows", MEGABYTE(8));
+    u32 depth = createRenderGraphBuffer(graph, "depth", MEGABYTE(4));
+    u32 gbuffer = createRenderGraphBuffer(graph, "gbuffer", MEGABYTE(8));
+    u32 lighting = createRenderGraphBuffer(graph, "lighting", MEGABYTE(4));
+    u32 bloomDown = createRenderGraphBuffer(graph, "bloom down", MEGABYTE(2));
+    u32 bloomUp = createRenderGraphBuffer(graph, "bloom up", MEGABYTE(2));
+    u32 debug = createRenderGraphBuffer(graph, "debug", MEGABYTE(4));
+    addSampleGraphPass(graph, &passes[0], "shadows", executeSampleCopyPass, shadows, RENDER_STATE_COPY_DEST,
+                       sourceHandle);
+    addSampleGraphPass(graph, &passes[1], "depth", executeSampleCopyPass, depth, RENDER_STATE_COPY_DEST,
+                       sourceHandle);
+    addSampleGraphPass(graph, &passes[2], "gbuffer", executeSampleCopyPass, gbuffer, RENDER_STATE_COPY_DEST, depth);
+    addSampleGraphPass(graph, &passes[3], "debug", executeSampleCopyPass, debug, RENDER_STATE_COPY_DEST, gbuffer);
+    addSampleGraphPass(graph, &passes[4], "lighting", executeSampleCopyPass, lighting, RENDER_STATE_COPY_DEST,
+                       gbuffer, shadows, depth);
+    addSampleGraphPass(graph, &passes[5], "bloom down", executeSampleCopyPass, bloomDown, RENDER_STATE_COPY_DEST,
+                       lighting);
+    addSampleGraphPass(graph, &passes[6], "bloom up", executeSampleCopyPass, bloomUp, RENDER_STATE_COPY_DEST,
+                       bloomDown);
+    addSampleGraphPass(graph, &passes[7], "composite", executeSampleCompositePass, *backBufferHandle,
+                       RENDER_STATE_RENDER_TARGET, lighting, bloomUp, RENDER_GRAPH_NONE, RENDER_STATE_GENERIC_READ);
+    return compileRenderGraph(graph);
+}
+
+//a post process chain where every pass reads the one before, only ever two buffers are live at once
+static bool buildSampleChainGraph(RenderGraph* graph, SampleGraphPass* passes, RenderResource* backBuffer){
+    initializeRenderGraph(graph);
+    u32 backBufferHandle = importRenderGraphResource(graph, "back buffer", backBuffer, RENDER_STATE_RENDER_TARGET,
+                                                     RENDER_STATE_RENDER_TARGET);
+    u32 previous = RENDER_GRAPH_NONE;
+    for(u32 i = 0; i < SAMPLE_CHAIN_PASSES; i++){
+        u32 output = createRenderGraphBuffer(graph, "chain", MEGABYTE(4));
+        addSampleGraphPass(graph, &passes[i], "chain", executeSampleCopyPass, output, RENDER_STATE_COPY_DEST,
+                           previous);
+        previous = output;
+    }
+    addSampleGraphPass(graph, &passes[SAMPLE_CHAIN_PASSES], "composite", executeSampleCompositePass,
+                       backBufferHandle, RENDER_STATE_RENDER_TARGET, previous, RENDER_GRAPH_NONE, RENDER_GRAPH_NONE,
+                       RENDER_STATE_GENERIC_READ);
+    return compileRenderGraph(graph);
+}
+
+//the frame graph's transients in the order buildSampleFrameGraph creates them, after the source and the back buffer,
+//and the debug view's pass
+#define CHECK_GRAPH_SHADOWS 2
+#define CHECK_GRAPH_DEPTH 3
+#define CHECK_GRAPH_GBUFFER 4
+#define CHECK_GRAPH_LIGHTING 5
+#define CHECK_GRAPH_BLOOM_DOWN 6
+#define CHECK_GRAPH_BLOOM_UP 7
+#define CHECK_GRAPH_DEBUG 8
+#define CHECK_GRAPH_DEBUG_PASS 3
+
+//batch k is the one recorded before the k-th surviving pass
+struct CheckGraphBarrier {
+    u32 resource;
+    u32 type;
+    u32 split;
+    u32 batch;
+    u32 before;
+    u32 after;
+};
+
+//worked out by hand from the frame graph: a transition is split when a pass without the resource runs between its
+//last use and the pass that needs it, and an aliased transient cannot start one before its aliasing barrier
+static const CheckGraphBarrier checkFrameGraphBarriers[] = {
+    {CHECK_GRAPH_SHADOWS, RENDER_BARRIER_ALIASING, RENDER_SPLIT_NONE, 0, 0, 0},
+    {CHECK_GRAPH_SHADOWS, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_NONE, 0, RENDER_STATE_COPY_SOURCE,
+     RENDER_STATE_COPY_DEST},
+    {CHECK_GRAPH_SHADOWS, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_BEGIN, 1, RENDER_STATE_COPY_DEST,
+     RENDER_STATE_COPY_SOURCE},
+    {CHECK_GRAPH_SHADOWS, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_END, 3, RENDER_STATE_COPY_DEST,
+     RENDER_STATE_COPY_SOURCE},
+    {CHECK_GRAPH_DEPTH, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_BEGIN, 0, RENDER_STATE_COPY_SOURCE,
+     RENDER_STATE_COPY_DEST},
+    {CHECK_GRAPH_DEPTH, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_END, 1, RENDER_STATE_COPY_SOURCE,
+     RENDER_STATE_COPY_DEST},
+    {CHECK_GRAPH_DEPTH, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_NONE, 2, RENDER_STATE_COPY_DEST,
+     RENDER_STATE_COPY_SOURCE},
+    {CHECK_GRAPH_GBUFFER, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_BEGIN, 0, RENDER_STATE_COPY_SOURCE,
+     RENDER_STATE_COPY_DEST},
+    {CHECK_GRAPH_GBUFFER, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_END, 2, RENDER_STATE_COPY_SOURCE,
+     RENDER_STATE_COPY_DEST},
+    {CHECK_GRAPH_GBUFFER, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_NONE, 3, RENDER_STATE_COPY_DEST,
+     RENDER_STATE_COPY_SOURCE},
+    {CHECK_GRAPH_LIGHTING, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_BEGIN, 0, RENDER_STATE_GENERIC_READ,
+     RENDER_STATE_COPY_DEST},
+    {CHECK_GRAPH_LIGHTING, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_END, 3, RENDER_STATE_GENERIC_READ,
+     RENDER_STATE_COPY_DEST},
+    {CHECK_GRAPH_LIGHTING, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_NONE, 4, RENDER_STATE_COPY_DEST,
+     RENDER_STATE_COPY_SOURCE},
+    {CHECK_GRAPH_LIGHTING, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_BEGIN, 5, RENDER_STATE_COPY_SOURCE,
+     RENDER_STATE_GENERIC_READ},
+    {CHECK_GRAPH_LIGHTING, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_END, 6, RENDER_STATE_COPY_SOURCE,
+     RENDER_STATE_GENERIC_READ},
+    {CHECK_GRAPH_BLOOM_DOWN, RENDER_BARRIER_ALIASING, RENDER_SPLIT_NONE, 4, 0, 0},
+    {CHECK_GRAPH_BLOOM_DOWN, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_NONE, 4, RENDER_STATE_COPY_SOURCE,
+     RENDER_STATE_COPY_DEST},
+    {CHECK_GRAPH_BLOOM_DOWN, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_NONE, 5, RENDER_STATE_COPY_DEST,
+     RENDER_STATE_COPY_SOURCE},
+    {CHECK_GRAPH_BLOOM_UP, RENDER_BARRIER_ALIASING, RENDER_SPLIT_NONE, 5, 0, 0},
+    {CHECK_GRAPH_BLOOM_UP, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_NONE, 5, RENDER_STATE_GENERIC_READ,
+     RENDER_STATE_COPY_DEST},
+    {CHECK_GRAPH_BLOOM_UP, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_NONE, 6, RENDER_STATE_COPY_DEST,
+     RENDER_STATE_GENERIC_READ},
+};
+
+//largest first: shadows and gbuffer, then depth and lighting, with the bloom buffers reusing the shadow map's memory
+static const u64 checkFrameGraphOffsets[] = {MEGABYTE(0), MEGABYTE(16), MEGABYTE(8), MEGABYTE(20), MEGABYTE(0),
+                                             MEGABYTE(2)};
+
+static bool isCheckGraphBarrierPlanned(RenderGraph* graph, const CheckGraphBarrier* expected, bool* matched){
+    for(u32 i = graph->batchStarts[expected->batch]; i < graph->batchStarts[expected->batch + 1]; i++){
+        RenderGraphBarrier* barrier = &graph->barriers[i];
+        if(!matched[i] && barrier->resource == expected->resource && barrier->type == expected->type &&
+           barrier->split == expected->split && barrier->before == expected->before &&
+           barrier->after == expected->after){
+            matched[i] = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+//transients live at the same time never share memory, and every one that shares it with another starts with an
+//aliasing barrier before its first pass
+static bool isCheckGraphPlacementValid(RenderGraph* graph){
+    for(u32 r = 0; r < graph->totalResources; r++){
+        RenderGraphResource* resource = &graph->resources[r];
+        if(resource->imported || resource->firstUse == RENDER_GRAPH_NONE){
+            continue;
+        }
+        if(resource->heapOffset % RENDER_PLACEMENT_ALIGNMENT ||
+           resource->heapOffset + resource->size > graph->heapSize){
+            return false;
+        }
+        bool shared = false;
+        for(u32 o = 0; o < graph->totalResources; o++){
+            RenderGraphResource* other = &graph->resources[o];
+            if(o == r || other->imported || other->firstUse == RENDER_GRAPH_NONE){
+                continue;
+            }
+            bool liveTogether = other->firstUse <= resource->lastUse && resource->firstUse <= other->lastUse;
+            bool overlaps = other->heapOffset < resource->heapOffset + resource->size &&
+                            resource->heapOffset < other->heapOffset + other->size;
+            if(liveTogether && overlaps){
+                return false;
+            }
+            shared = shared || overlaps;
+        }
+        u32 aliasingBarriers = 0;
+        for(u32 i = graph->batchStarts[resource->firstUse]; i < graph->batchStarts[resource->firstUse + 1]; i++){
+            if(graph->barriers[i].resource == r && graph->barriers[i].type == RENDER_BARRIER_ALIASING){
+                aliasingBarriers++;
+            }
+        }
+        if(resource->aliased != shared || aliasingBarriers != (shared ? 1u : 0u)){
+            return false;
+        }
+    }
+    return graph->stats.heapBytes == graph->heapSize && graph->heapSize < graph->stats.transientBytes;
+}
+
+//compiles the sample graphs the headless run executes and compares them with what they were worked out to be;
+//compiling is CPU only, so the imported buffers are never touched
+static bool checkRenderGraph(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    RenderGraph* frame = pushStruct(arena, RenderGraph);
+    RenderGraph* chain = pushStruct(arena, RenderGraph);
+    SampleGraphPass* passes = pushArray(arena, SampleGraphPass, RENDER_GRAPH_MAX_PASSES);
+    bool* matched = pushArray(arena, bool, RENDER_GRAPH_MAX_BARRIERS);
+    if(!frame || !chain || !passes || !matched){
+        printf("graph: out of memory\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    RenderResource source = {};
+    RenderResource backBuffer = {};
+    u32 backBufferHandle;
+    bool frameCompiled = buildSampleFrameGraph(frame, passes, &source, &backBuffer, &backBufferHandle);
+
+    //only the debug view is culled, nothing reads what it writes
+    bool culled = frameCompiled && frame->stats.culledPasses == 1 && frame->totalOrder == frame->totalPasses - 1 &&
+                  frame->resources[CHECK_GRAPH_DEBUG].firstUse == RENDER_GRAPH_NONE;
+    for(u32 i = 0; i < frame->totalPasses && culled; i++){
+        culled = frame->passes[i].culled == (i == CHECK_GRAPH_DEBUG_PASS);
+    }
+
+    u32 totalExpected = sizeof(checkFrameGraphBarriers) / sizeof(checkFrameGraphBarriers[0]);
+    setMemory(matched, sizeof(bool) * RENDER_GRAPH_MAX_BARRIERS);
+    bool barriers = frameCompiled && frame->totalBarriers == totalExpected && frame->stats.barriers == 13 &&
+                    frame->stats.splitBarriers == 5 && frame->stats.aliasingBarriers == 3 &&
+                    frame->stats.batches == 7;
+    for(u32 i = 0; i < totalExpected && barriers; i++){
+        barriers = isCheckGraphBarrierPlanned(frame, &checkFrameGraphBarriers[i], matched);
+    }
+
+    bool framePlaced = frameCompiled && isCheckGraphPlacementValid(frame) && frame->heapSize == MEGABYTE(24) &&
+                       frame->stats.transientBytes == MEGABYTE(28);
+    for(u32 i = 0; i < sizeof(checkFrameGraphOffsets) / sizeof(checkFrameGraphOffsets[0]) && framePlaced; i++){
+        framePlaced = frame->resources[CHECK_GRAPH_SHADOWS + i].heapOffset == checkFrameGraphOffsets[i];
+    }
+
+    //each link is live for its own pass and the next, so two buffers take turns
+    bool chainCompiled = buildSampleChainGraph(chain, passes, &backBuffer);
+    bool chainPlaced = chainCompiled && chain->stats.culledPasses == 0 && isCheckGraphPlacementValid(chain) &&
+                       chain->stats.transients == SAMPLE_CHAIN_PASSES && chain->heapSize == MEGABYTE(8) &&
+                       chain->stats.aliasingBarriers == SAMPLE_CHAIN_PASSES && chain->stats.splitBarriers == 0;
+
+    bool success = culled && barriers && framePlaced && chainPlaced;
+    printf("graph frame %s, %u of %u barriers %s\n", frameCompiled ? "compiled" : "NOT COMPILED",
+           frame->totalBarriers, totalExpected, barriers ? "planned as expected" : "NOT AS EXPECTED");
+    printf("graph debug view %s, frame transients %s in %llu KB of %llu KB\n",
+           culled ? "culled alone" : "CULLING WRONG", framePlaced ? "placed apart while live" : "MISPLACED",
+           frame->heapSize / 1024, frame->stats.transientBytes / 1024);
+    printf("graph chain of %u %s in %llu KB\n", SAMPLE_CHAIN_PASSES,
+           chainPlaced ? "takes turns" : "MISPLACED", chain->heapSize / 1024);
+    arena->used = arenaMark;
+    return success;
+}
+
+#define CHECK_PIPELINE_VARIANTS 2048
+#define CHECK_PIPELINE_POLLS 64
+#define CHECK_PIPELINE_LIBRARY_SIZE KILOBYTE(64)
+
+//every check pipeline has the same state, they differ in their bytecode alone
+static void fillCheckPipelineDesc(RenderPipelineDesc* desc, u64* bytecode){
+    setMemory(desc, sizeof(RenderPipelineDesc));
+    desc->vertexShader.code = bytecode;
+    desc->vertexShader.size = sizeof(u64);
+    desc->pixelShader = desc->vertexShader;
+    desc->attributes[0].semantic = "POSITION";
+    desc->attributes[0].format = RENDER_FORMAT_R32G32B32_FLOAT;
+    desc->totalAttributes = 1;
+    desc->renderTargetFormats[0] = RENDER_FORMAT_R8G8B8A8_UNORM;
+    desc->totalRenderTargets = 1;
+    desc->sampleCount = 1;
+}
+
+//a pipeline in the table is found from its key, a retired one is not
+static bool isCheckPipelineFound(PipelineCache* cache, u32 handle, u64 key){
+    return cache->table[findPipelineCacheSlot(cache, key)] == handle;
+}
+
+//Four pipelines are picked whose keys collide, three on one home slot and one on the slot after, so retiring them
+//has to shift the others back over the hole. A compile is held on the null backend's pipeline lock to see the
+//fallback stand in while it runs, and a second cache loads what the first saved without compiling.
+static bool checkPipelineCache(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    OSInterface* os = context->os;
+    RenderBackend* backend = pushStruct(arena, RenderBackend);
+    PipelineCache* cache = pushStruct(arena, PipelineCache);
+    PipelineCache* reloaded = pushStruct(arena, PipelineCache);
+    u64* bytecodes = pushArray(arena, u64, CHECK_PIPELINE_VARIANTS);
+    u64* keys = pushArray(arena, u64, CHECK_PIPELINE_VARIANTS);
+    u32* handles = pushArray(arena, u32, CHECK_PIPELINE_VARIANTS);
+    if(!backend || !cache || !reloaded || !bytecodes || !keys || !handles || !initializeCheckBackend(backend, arena) ||
+       !initializePipelineCache(cache, backend, os, context->queue, arena, 0, 0)){
+        printf("pipelines: out of memory\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    RenderPipelineDesc desc;
+    u32 homes[PIPELINE_CACHE_TABLE_SIZE] = {};
+    for(u32 i = 0; i < CHECK_PIPELINE_VARIANTS; i++){
+        bytecodes[i] = i + 1;
+        fillCheckPipelineDesc(&desc, &bytecodes[i]);
+        keys[i] = hashRenderPipelineDesc(&desc);
+        homes[(u32)keys[i] & (PIPELINE_CACHE_TABLE_SIZE - 1)]++;
+    }
+    u32 mask = PIPELINE_CACHE_TABLE_SIZE - 1;
+    u32 home = 0;
+    while(home < mask && (homes[home] < 3 || !homes[home + 1])){
+        home++;
+    }
+    //a, b and c share the home slot and d's is the one after; the rest are homed clear of the slots the four fill,
+    //so nothing else moves when they are retired
+    u32 none = CHECK_PIPELINE_VARIANTS;
+    u32 a = none, b = none, c = none, d = none, repeated = none, compiling = none, reused = none;
+    for(u32 i = 0; i < CHECK_PIPELINE_VARIANTS; i++){
+        u32 distance = ((u32)keys[i] - home) & mask;
+        u32* variant = distance == 0 ? (a == none ? &a : b == none ? &b : &c) : distance == 1 ? &d :
+                       distance <= 4 ? 0 : repeated == none ? &repeated : compiling == none ? &compiling : &reused;
+        if(variant && *variant == none){
+            *variant = i;
+        }
+    }
+    if(home == mask || reused == none){
+        printf("pipelines: no colliding keys among %u variants\n", CHECK_PIPELINE_VARIANTS);
+        arena->used = arenaMark;
+        return false;
+    }
+
+    //inserted in this order they sit in consecutive slots, c probing past d
+    u32 order[4] = {a, b, d, c};
+    bool placed = true;
+    for(u32 i = 0; i < 4; i++){
+        fillCheckPipelineDesc(&desc, &bytecodes[order[i]]);
+        handles[order[i]] = requestPipeline(cache, &desc, true);
+        placed = placed && isPipelineReady(cache, handles[order[i]]) &&
+                 cache->table[(home + i) & mask] == handles[order[i]];
+    }
+
+    //a desc asked for three times before its compile ran is one entry and one compile
+    u64 createdBefore = device->stats.pipelinesCreated;
+    fillCheckPipelineDesc(&desc, &bytecodes[repeated]);
+    handles[repeated] = requestPipeline(cache, &desc);
+    bool deduplicated = requestPipeline(cache, &desc) == handles[repeated] &&
+                        requestPipeline(cache, &desc) == handles[repeated];
+    os->completeWorkQueueEntries(context->queue);
+    deduplicated = deduplicated && cache->stats.deduplicated == 2 && cache->stats.compiled == 5 &&
+                   device->stats.pipelinesCreated == createdBefore + 1 && isPipelineReady(cache, handles[repeated]);
+
+    //holding the lock the null backend's createPipeline takes keeps the job inside its compile
+    beginSpinLock(&device->pipelineLock);
+    fillCheckPipelineDesc(&desc, &bytecodes[compiling]);
+    handles[compiling] = requestPipeline(cache, &desc);
+    PipelineCacheEntry* entry = &cache->entries[handles[compiling]];
+    u64 start = context->getMicroseconds();
+    while(entry->state != PIPELINE_COMPILING && context->getMicroseconds() - start < 1000000){
+        spinPause();
+    }
+    RenderPipeline* fallback = &cache->entries[handles[repeated]].pipeline;
+    bool fellBack = entry->state == PIPELINE_COMPILING;
+    for(u32 i = 0; i < CHECK_PIPELINE_POLLS && fellBack; i++){
+        fellBack = getPipeline(cache, handles[compiling], handles[repeated]) == fallback &&
+                   !getPipeline(cache, handles[compiling]);
+    }
+    endSpinLock(&device->pipelineLock);
+    os->completeWorkQueueEntries(context->queue);
+    fellBack = fellBack && getPipeline(cache, handles[compiling], handles[repeated]) == &entry->pipeline;
+
+    //a leaves its home slot empty for b to shift into, then d leaves from between b and c
+    NullRenderPipeline* retiredA = (NullRenderPipeline*)cache->entries[handles[a]].pipeline.handle;
+    NullRenderPipeline* retiredD = (NullRenderPipeline*)cache->entries[handles[d]].pipeline.handle;
+    retirePipeline(cache, handles[a]);
+    bool shifted = !isCheckPipelineFound(cache, handles[a], keys[a]) && cache->table[home] == handles[b] &&
+                   isCheckPipelineFound(cache, handles[b], keys[b]) &&
+                   isCheckPipelineFound(cache, handles[c], keys[c]) &&
+                   isCheckPipelineFound(cache, handles[d], keys[d]);
+    retirePipeline(cache, handles[d]);
+    shifted = shifted && !isCheckPipelineFound(cache, handles[d], keys[d]) &&
+              isCheckPipelineFound(cache, handles[b], keys[b]) && isCheckPipelineFound(cache, handles[c], keys[c]) &&
+              cache->table[(home + 2) & mask] == PIPELINE_CACHE_NONE;
+    fillCheckPipelineDesc(&desc, &bytecodes[c]);
+    shifted = shifted && requestPipeline(cache, &desc) == handles[c] && cache->stats.compiled == 6;
+
+    //retired in the frame signalling fence 2, kept while the gpu has only passed 1
+    endPipelineCacheFrame(cache, 2);
+    beginPipelineCacheFrame(cache, 1);
+    bool fenced = retiredA->live && retiredD->live && cache->firstFree == PIPELINE_CACHE_NONE;
+    beginPipelineCacheFrame(cache, 2);
+    fenced = fenced && !retiredA->live && !retiredD->live && cache->entries[handles[a]].state == PIPELINE_FREE &&
+             cache->entries[handles[d]].state == PIPELINE_FREE;
+    fillCheckPipelineDesc(&desc, &bytecodes[reused]);
+    handles[reused] = requestPipeline(cache, &desc, true);
+    fenced = fenced && (handles[reused] == handles[a] || handles[reused] == handles[d]) &&
+             isPipelineReady(cache, handles[reused]) && cache->totalEntries == 6;
+
+    //the saved library holds what the cache still has, retired pipelines are left out
+    bool saved = savePipelineCache(cache, HEADLESS_CHECK_FILE, arena);
+    destroyPipelineCache(cache);
+    bool loaded = saved && initializePipelineCache(reloaded, backend, os, context->queue, arena, HEADLESS_CHECK_FILE,
+                                                   CHECK_PIPELINE_LIBRARY_SIZE) && reloaded->library.handle;
+    u32 kept[5] = {b, c, repeated, compiling, reused};
+    for(u32 i = 0; i < 5 && loaded; i++){
+        fillCheckPipelineDesc(&desc, &bytecodes[kept[i]]);
+        loaded = isPipelineReady(reloaded, requestPipeline(reloaded, &desc, true));
+    }
+    fillCheckPipelineDesc(&desc, &bytecodes[a]);
+    loaded = loaded && isPipelineReady(reloaded, requestPipeline(reloaded, &desc, true)) &&
+             reloaded->stats.loaded == 5 && reloaded->stats.compiled == 1;
+    destroyPipelineCache(reloaded);
+    os->deleteFile(HEADLESS_CHECK_FILE);
+
+    bool success = placed && deduplicated && fellBack && shifted && fenced && loaded && !device->stats.errors;
+    printf("pipelines repeated desc %s, fallback %s\n",
+           deduplicated ? "one handle and one compile" : "NOT DEDUPLICATED",
+           fellBack ? "stood in while compiling" : "NOT USED");
+    printf("pipelines colliding keys %s, retired %s\n", placed && shifted ? "reachable after removals" : "LOST",
+           fenced ? "freed after their fence" : "FREED EARLY OR KEPT");
+    printf("pipelines saved library %s\n", loaded ? "loaded by a second cache" : "NOT LOADED");
+    arena->used = arenaMark;
+    return success;
+}
+
+#define CHECK_PACING_FRAMES 64
+#define CHECK_PACING_SUBMIT_LATENCY 500
+
+//what a paced run measured, aheadOfGpu the most frames submitted and not yet done while a frame was recorded
+struct CheckPacingRun {
+    FramePacingStats stats;
+    u64 aheadOfGpu;
+    bool clean;
+};
+
+//A null backend on its virtual clock, where each frame spends cpuCost of clock before it is submitted and one copy
+//at a byte a microsecond makes the gpu take gpuCost between the frame's timestamps.
+static bool runCheckPacer(MemoryArena* arena, u32 framesInFlight, u64 cpuCost, u64 gpuCost, bool lowLatency,
+                          CheckPacingRun* run){
+    u64 arenaMark = arena->used;
+    setMemory(run, sizeof(CheckPacingRun));
+    NullRenderSettings settings = {};
+    settings.totalBackBuffers = 3;
+    settings.width = 64;
+    settings.height = 64;
+    settings.submitLatency = CHECK_PACING_SUBMIT_LATENCY;
+    settings.copyBandwidth = 1;
+    RenderBackend* backend = pushStruct(arena, RenderBackend);
+    FramePacer* pacer = pushStruct(arena, FramePacer);
+    RenderResource source;
+    RenderResource destination;
+    if(!backend || !pacer || !initializeNullRenderBackend(backend, &settings, arena) ||
+       !backend->createBuffer(backend, gpuCost, RENDER_HEAP_DEFAULT, RENDER_STATE_COPY_SOURCE, &source) ||
+       !backend->createBuffer(backend, gpuCost, RENDER_HEAP_DEFAULT, RENDER_STATE_COPY_DEST, &destination) ||
+       !initializeFramePacer(pacer, backend, framesInFlight)){
+        arena->used = arenaMark;
+        return false;
+    }
+    setFramePacerLowLatency(pacer, lowLatency, 0);
+    for(u32 frame = 0; frame < CHECK_PACING_FRAMES; frame++){
+        RenderCommandList* list = beginRenderFrame(pacer, 0);
+        u64 ahead = pacer->frameNumber - backend->getCompletedFenceValue(backend, &pacer->fence);
+        if(ahead > run->aheadOfGpu){
+            run->aheadOfGpu = ahead;
+        }
+        backend->copyBuffer(list, &destination, 0, &source, 0, gpuCost);
+        backend->sleepMicroseconds(backend, cpuCost);
+        endRenderFrame(pacer);
+    }
+    flushFramePacer(pacer);
+    run->stats = pacer->stats;
+    run->clean = !((NullRenderDevice*)backend->data)->stats.errors;
+    arena->used = arenaMark;
+    return true;
+}
+
+//true when measured is within tolerance of expected
+static bool isCheckPacingNear(u64 measured, u64 expected, u64 tolerance){
+    return measured + tolerance >= expected && measured <= expected + tolerance;
+}
+
+//With the gpu slower than the cpu the cpu waits out the difference every frame, gets framesInFlight - 1 frames ahead
+//and no further, and the gpu never idles; a single frame in flight waits for the whole submission and idles the gpu
+//while the next frame is recorded. With the cpu slower the gpu idles the difference instead. Low latency mode holds
+//the cpu back so a frame is sampled just in time to reach the gpu as it finishes the previous one, which cuts the
+//latency from framesInFlight gpu frames to one cpu frame, the submission and one gpu frame.
+static bool checkFramePacing(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 frames = CHECK_PACING_FRAMES;
+    u64 cpuCost = 1000;
+    u64 gpuCost = 2000;
+    u64 submit = CHECK_PACING_SUBMIT_LATENCY;
+    u64 shortestLatency = cpuCost + submit + gpuCost;
+    //the first frames fill the queue and the last is waited out, none of which the steady state has
+    u64 tolerance = submit + gpuCost;
+    bool gpuBound = true;
+    CheckPacingRun run;
+    for(u32 framesInFlight = 1; framesInFlight <= 3 && gpuBound; framesInFlight++){
+        gpuBound = runCheckPacer(arena, framesInFlight, cpuCost, gpuCost, false, &run);
+        u64 wait = framesInFlight == 1 ? frames * (submit + gpuCost) : frames * (gpuCost - cpuCost);
+        u64 idle = framesInFlight == 1 ? (frames - 1) * (cpuCost + submit) : 0;
+        u64 latency = framesInFlight == 1 ? shortestLatency : framesInFlight * gpuCost;
+        gpuBound = gpuBound && run.clean && run.aheadOfGpu == framesInFlight - 1 &&
+                   run.stats.gpuBusyTime == frames * gpuCost && run.stats.gpuIdleTime == idle &&
+                   isCheckPacingNear(run.stats.cpuWaitTime, wait, tolerance) && run.stats.lastLatency == latency;
+    }
+    u64 bufferedLatency = run.stats.lastLatency;
+
+    bool cpuBound = runCheckPacer(arena, 3, gpuCost, cpuCost, false, &run) && run.clean && run.aheadOfGpu <= 2 &&
+                    run.stats.cpuWaitTime <= tolerance && run.stats.gpuIdleTime == (frames - 1) * (gpuCost - cpuCost);
+
+    bool lowered = runCheckPacer(arena, 3, cpuCost, gpuCost, true, &run) && run.clean &&
+                   isCheckPacingNear(run.stats.lastLatency, shortestLatency, submit) &&
+                   run.stats.lastLatency < bufferedLatency && run.stats.lowLatencySleepTime;
+
+    printf("pacing gpu bound 1 to 3 frames in flight %s\n",
+           gpuBound ? "ahead by at most frames in flight - 1, waits and idle as costed" : "NOT AS COSTED");
+    printf("pacing cpu bound %s, low latency %llu us against %llu us buffered %s\n",
+           cpuBound ? "idles the gpu as costed" : "NOT AS COSTED", run.stats.lastLatency, bufferedLatency,
+           lowered ? "lowered" : "NOT LOWERED");
+    return gpuBound && cpuBound && lowered;
+}
+
+#define CHECK_RECORD_FIRST_TIMESTAMP (2 * RENDER_MAX_FRAMES_IN_FLIGHT)
+#define CHECK_RECORD_MAX_ITEMS (RENDER_MAX_TIMESTAMPS - CHECK_RECORD_FIRST_TIMESTAMP)
+
+struct CheckRecording {
+    volatile u32 recorded[CHECK_RECORD_MAX_ITEMS];
+};
+
+//each item is a timestamp of its own, the null backend stamps it with the time the gpu reached it
+static void recordCheckItems(RenderCommandList* list, u32 firstItem, u32 totalItems, void* userData){
+    CheckRecording* recording = (CheckRecording*)userData;
+    for(u32 i = firstItem; i < firstItem + totalItems; i++){
+        list->backend->writeTimestamp(list, CHECK_RECORD_FIRST_TIMESTAMP + i);
+        atomicAdd(&recording->recorded[i], 1);
+    }
+}
+
+//Items are recorded in slices on the work queue, on the check queue's threads and on the calling thread alone, over
+//item counts the slice counts do not divide. Every command costs the gpu a microsecond, so the items ran in order
+//when their timestamps rise with the item and all fall between the frame's own two.
+static bool checkParallelRecording(HeadlessCheckContext* context){
+    MemoryArena* arena = context->arena;
+    u64 arenaMark = arena->used;
+    NullRenderSettings settings = {};
+    settings.totalBackBuffers = 2;
+    settings.width = 64;
+    settings.height = 64;
+    settings.submitLatency = 100;
+    settings.commandCost = 1;
+    RenderBackend* backend = pushStruct(arena, RenderBackend);
+    FramePacer* pacer = pushStruct(arena, FramePacer);
+    CommandListPool* pools = pushArray(arena, CommandListPool, 8);
+    CheckRecording* recording = pushStruct(arena, CheckRecording);
+    //no threads of its own, completeWorkQueueEntries runs every slice on the calling thread
+    WorkQueue* callingThread = pushStruct(arena, WorkQueue);
+    if(!backend || !pacer || !pools || !recording || !callingThread){
+        printf("recording: out of memory\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    u64 bytecode = 1;
+    RenderPipelineDesc desc;
+    fillCheckPipelineDesc(&desc, &bytecode);
+    RenderPipeline pipeline;
+    if(!initializeNullRenderBackend(backend, &settings, arena) || !initializeFramePacer(pacer, backend, 2) ||
+       !backend->createPipeline(backend, &desc, &pipeline)){
+        printf("recording: could not be set up\n");
+        arena->used = arenaMark;
+        return false;
+    }
+    context->os->initializeWorkQueue(callingThread, 0);
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    WorkQueue* queues[2] = {context->queue, callingThread};
+    u32 listCounts[4] = {1, 3, 4, 7};
+    u32 itemCounts[3] = {1, 13, CHECK_RECORD_MAX_ITEMS};
+    u32 totalRuns = 0;
+    bool ordered = true;
+    for(u32 p = 0; p < 8 && ordered; p++){
+        CommandListPool* pool = &pools[p];
+        u32 totalLists = listCounts[p % 4];
+        ordered = initializeCommandListPool(pool, pacer, context->os, queues[p / 4], totalLists);
+        for(u32 n = 0; n < 3 && ordered; n++){
+            u32 totalItems = itemCounts[n];
+            u64 lists = pool->stats.lists;
+            setMemory((void*)recording, sizeof(CheckRecording));
+            setMemory(device->timestamps, sizeof(device->timestamps));
+            beginRenderFrame(pacer, &pipeline);
+            u32 slot = pacer->frameSlot;
+            ordered = recordCommandListsInParallel(pool, &pipeline, totalItems, 1, recordCheckItems, recording);
+            endRenderFrame(pacer);
+            flushFramePacer(pacer);
+            u64 previous = device->timestamps[slot * 2];
+            for(u32 i = 0; i < totalItems && ordered; i++){
+                u64 time = device->timestamps[CHECK_RECORD_FIRST_TIMESTAMP + i];
+                ordered = recording->recorded[i] == 1 && time > previous;
+                previous = time;
+            }
+            ordered = ordered && device->timestamps[slot * 2 + 1] > previous &&
+                      pool->stats.lists - lists == (totalItems < totalLists ? totalItems : totalLists);
+            totalRuns++;
+        }
+    }
+    bool success = ordered && !device->stats.errors;
+    printf("recording %u frames over 1 to 7 lists, on the queue and the calling thread, %s\n", totalRuns,
+           success ? "ran in item order" : "OUT OF ORDER");
+    arena->used = arenaMark;
+    return success;
+}
+
+static HeadlessCheck headlessChecks[] = {
+    {"compression", checkCompression},
+    {"models", checkModelStore},
+    {"pool", checkGpuBufferPool},
+    {"optimizer", checkMeshOptimizer},
+    {"simplifier", checkMeshSimplifier},
+    {"meshlets", checkMeshlets},
+    {"quantization", checkVertexQuantization},
+    {"textures", checkTextures},
+    {"bc", checkBlockCompression},
+    {"png", checkPNGDecoder},
+    {"streaming", checkTextureStreaming},
+    {"prefilter", checkCubemapPrefilter},
+    {"registry", checkAssetRegistry},
+    {"cooks", checkAssetCooks},
+    {"glyphs", checkGlyphCache},
+    {"text", checkTextLayout},
+    {"fonts", checkFontAtlas},
+    {"ring", checkUploadRing},
+    {"descriptors", checkDescriptorAllocator},
+    {"graph", checkRenderGraph},
+    {"pipelines", checkPipelineCache},
+    {"pacing", checkFramePacing},
+    {"recording", checkParallelRecording},
+};
@@ -0,0 +1,1010 @@
+#pragma once
+
+#include "texture_compression.h"
+#include "texture_mipmaps.h"
+
+// Image decoding for createTexture2DFromFile/createTextureCubeFromFile.
+// DDS and KTX2 files holding BC or RGBA8 data are parsed in place: the level pointers in ImageData point into the
+// file buffer, so reading the file straight into mapped upload memory needs no further copy.
+// TGA (truecolor/gray, raw or RLE) and PNG (8 bit, non interlaced) are decoded to RGBA8 into arena memory. PNG
+// IDAT chunks are inflated as a stream straight into the scanline buffer without being gathered first.
+// writeDDSFile writes a level chain out as a DX10 DDS file, for textures made at run time that are streamed from disk.
+
+#define IMAGE_FORMAT_RGBA8 (BLOCK_COMPRESSION_BC5 + 1)
+#define IMAGE_MAX_LEVELS 16
+#define IMAGE_MAX_FACES 6
+
+#define DDS_MAGIC 0x20534444
+#define DDS_FOURCC_DX10 0x30315844
+#define DDS_FLAG_FOURCC 0x4
+#define DDS_CAPS2_CUBEMAP 0x200
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x4
+#define DDS_FLAGS_TEXTURE 0xA1007
+#define DDS_CAPS_TEXTURE 0x401008
+#define DDS_DIMENSION_TEXTURE2D 3
+
+struct ImageData {
+    u32 width;
+    u32 height;
+    u32 format;
+    u32 totalLevels;
+    u32 totalFaces;
+    bool srgb;
+    u8* levelData[IMAGE_MAX_FACES][IMAGE_MAX_LEVELS];
+    u32 levelSizes[IMAGE_MAX_LEVELS];
+};
+
+struct DDSPixelFormat {
+    u32 size;
+    u32 flags;
+    u32 fourCC;
+    u32 rgbBitCount;
+    u32 rBitMask;
+    u32 gBitMask;
+    u32 bBitMask;
+    u32 aBitMask;
+};
+
+struct DDSHeader {
+    u32 magic;
+    u32 size;
+    u32 flags;
+    u32 height;
+    u32 width;
+    u32 pitchOrLinearSize;
+    u32 depth;
+    u32 mipMapCount;
+    u32 reserved1[11];
+    DDSPixelFormat pixelFormat;
+    u32 caps;
+    u32 caps2;
+    u32 caps3;
+    u32 caps4;
+    u32 reserved2;
+};
+
+struct DDSHeaderDX10 {
+    u32 dxgiFormat;
+    u32 resourceDimension;
+    u32 miscFlag;
+    u32 arraySize;
+    u32 miscFlags2;
+};
+
+struct KTX2Header {
+    u8 identifier[12];
+    u32 vkFormat;
+    u32 typeSize;
+    u32 pixelWidth;
+    u32 pixelHeight;
+    u32 pixelDepth;
+    u32 layerCount;
+    u32 faceCount;
+    u32 levelCount;
+    u32 supercompressionScheme;
+    u32 dfdByteOffset;
+    u32 dfdByteLength;
+    u32 kvdByteOffset;
+    u32 kvdByteLength;
+    u64 sgdByteOffset;
+    u64 sgdByteLength;
+};
+
+struct KTX2LevelIndex {
+    u64 byteOffset;
+    u64 byteLength;
+    u64 uncompressedByteLength;
+};
+
+#pragma pack(push, 1)
+struct TGAHeader {
+    u8 idLength;
+    u8 colorMapType;
+    u8 imageType;
+    u16 colorMapStart;
+    u16 colorMapLength;
+    u8 colorMapDepth;
+    u16 xOrigin;
+    u16 yOrigin;
+    u16 width;
+    u16 height;
+    u8 bitsPerPixel;
+    u8 descriptor;
+};
+#pragma pack(pop)
+
+struct ImageDecodeJob {
+    u8* fileData;
+    u32 fileSize;
+    MemoryArena arena;
+    ImageData image;
+    bool success;
+};
+
+static u32 getImageLevelSize(u32 format, u32 width, u32 height){
+    if(format == IMAGE_FORMAT_RGBA8){
+        return width * height * 4;
+    }
+    return getBlockCompressedSize(format, width, height);
+}
+
+static u32 getImageTextureFormat(OSInterface* os, u32 format){
+    if(format == IMAGE_FORMAT_RGBA8){
+        return os->TEXTURE_FORMAT_RGBA8;
+    }
+    return getBlockCompressionTextureFormat(os, format);
+}
+
+static u32 readBigEndianU32(u8* p){
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
+//points levels into data, laid out as in DDS: every level of face 0, then every level of face 1 and so on
+static bool setImageLevelsFaceMajor(ImageData* image, u8* data, u64 dataSize){
+    u64 offset = 0;
+    for(u32 face = 0; face < image->totalFaces; face++){
+        for(u32 level = 0; level < image->totalLevels; level++){
+            u32 size = getImageLevelSize(image->format, getMipLevelDimension(image->width, level), getMipLevelDimension(image->height, level));
+            if(offset + size > dataSize){
+                return false;
+            }
+            image->levelData[face][level] = data + offset;
+            image->levelSizes[level] = size;
+            offset += size;
+        }
+    }
+    return true;
+}
+
+static bool parseDDS(u8* data, u32 dataSize, ImageData* image){
+    if(dataSize < sizeof(DDSHeader)) return false;
+    DDSHeader* header = (DDSHeader*)data;
+    if(header->magic != DDS_MAGIC || header->size != 124) return false;
+
+    setMemory(image, sizeof(ImageData), 0);
+    image->width = header->width;
+    image->height = header->height;
+    image->totalLevels = header->mipMapCount ? header->mipMapCount : 1;
+    image->totalFaces = (header->caps2 & DDS_CAPS2_CUBEMAP) ? 6 : 1;
+    u8* pixels = data + sizeof(DDSHeader);
+
+    DDSPixelFormat* pf = &header->pixelFormat;
+    if((pf->flags & DDS_FLAG_FOURCC) && pf->fourCC == DDS_FOURCC_DX10){
+        if(dataSize < sizeof(DDSHeader) + sizeof(DDSHeaderDX10)) return false;
+        DDSHeaderDX10* dx10 = (DDSHeaderDX10*)pixels;
+        pixels += sizeof(DDSHeaderDX10);
+        switch(dx10->dxgiFormat){
+            case 71: image->format = BLOCK_COMPRESSION_BC1; break;
+            case 72: image->format = BLOCK_COMPRESSION_BC1; image->srgb = true; break;
+            case 80: image->format = BLOCK_COMPRESSION_BC4U; break;
+            case 81: image->format = BLOCK_COMPRESSION_BC4S; break;
+            case 83: image->format = BLOCK_COMPRESSION_BC5; break;
+            case 28: image->format = IMAGE_FORMAT_RGBA8; break;
+            case 29: image->format = IMAGE_FORMAT_RGBA8; image->srgb = true; break;
+            default: return false;
+        }
+        if(dx10->miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE){
+            image->totalFaces = 6;
+        }
+        if(dx10->arraySize > 1) return false;
+    }else if(pf->flags & DDS_FLAG_FOURCC){
+        switch(pf->fourCC){
+            case 0x31545844: image->format = BLOCK_COMPRESSION_BC1; break;   //DXT1
+            case 0x31495441: image->format = BLOCK_COMPRESSION_BC4U; break;  //ATI1
+            case 0x55344342: image->format = BLOCK_COMPRESSION_BC4U; break;  //BC4U
+            case 0x53344342: image->format = BLOCK_COMPRESSION_BC4S; break;  //BC4S
+            case 0x32495441: image->format = BLOCK_COMPRESSION_BC5; break;   //ATI2
+            case 0x55354342: image->format = BLOCK_COMPRESSION_BC5; break;   //BC5U
+            default: return false;
+        }
+    }else if(pf->rgbBitCount == 32 && pf->rBitMask == 0xFF && pf->gBitMask == 0xFF00 && pf->bBitMask == 0xFF0000){
+        image->format = IMAGE_FORMAT_RGBA8;
+    }else{
+        return false;
+    }
+    if(image->totalLevels > IMAGE_MAX_LEVELS) return false;
+    return setImageLevelsFaceMajor(image, pixels, dataSize - (u32)(pixels - data));
+}
+
+static bool parseKTX2(u8* data, u32 dataSize, ImageData* image){
+    static const u8 identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    if(dataSize < sizeof(KTX2Header)) return false;
+    KTX2Header* header = (KTX2Header*)data;
+    for(u32 i = 0; i < 12; i++){
+        if(header->identifier[i] != identifier[i]) return false;
+    }
+    //supercompressed levels can't be handed to the GPU as they are
+    if(header->supercompressionScheme != 0 || header->pixelDepth > 1 || header->layerCount > 1) return false;
+
+    setMemory(image, sizeof(ImageData), 0);
+    image->width = header->pixelWidth;
+    image->height = header->pixelHeight;
+    image->totalLevels = header->levelCount ? header->levelCount : 1;
+    image->totalFaces = header->faceCount;
+    switch(header->vkFormat){
+        case 131: case 133: image->format = BLOCK_COMPRESSION_BC1; break;
+        case 132: case 134: image->format = BLOCK_COMPRESSION_BC1; image->srgb = true; break;
+        case 139: image->format = BLOCK_COMPRESSION_BC4U; break;
+        case 140: image->format = BLOCK_COMPRESSION_BC4S; break;
+        case 141: image->format = BLOCK_COMPRESSION_BC5; break;
+        case 37: image->format = IMAGE_FORMAT_RGBA8; break;
+        case 43: image->format = IMAGE_FORMAT_RGBA8; image->srgb = true; break;
+        default: return false;
+    }
+    if(image->totalLevels > IMAGE_MAX_LEVELS || (image->totalFaces != 1 && image->totalFaces != 6)) return false;
+    if(sizeof(KTX2Header) + image->totalLevels * sizeof(KTX2LevelIndex) > dataSize) return false;
+
+    //each level holds all of its faces; levels may be stored in any order in the file
+    KTX2LevelIndex* levels = (KTX2LevelIndex*)(header + 1);
+    for(u32 level = 0; level < image->totalLevels; level++){
+        u32 size = getImageLevelSize(image->format, getMipLevelDimension(image->width, level), getMipLevelDimension(image->height, level));
+        if(levels[level].byteOffset + levels[level].byteLength > dataSize || levels[level].byteLength < (u64)size * image->totalFaces){
+            return false;
+        }
+        image->levelSizes[level] = size;
+        for(u32 face = 0; face < image->totalFaces; face++){
+            image->levelData[face][level] = data + levels[level].byteOffset + face * size;
+        }
+    }
+    return true;
+}
+
+//swaps the red and blue bytes of count 32 bit pixels, four at a time
+static void swizzleBGRAToRGBA(u8* dst, u8* src, u32 count){
+    __m128i greenAlpha = _mm_set1_epi32(0xFF00FF00);
+    __m128i lowByte = _mm_set1_epi32(0xFF);
+    u32 i = 0;
+    for(; i + 4 <= count; i += 4){
+        __m128i p = _mm_loadu_si128((__m128i*)(src + i * 4));
+        __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), lowByte);
+        __m128i b = _mm_slli_epi32(_mm_and_si128(p, lowByte), 16);
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_and_si128(p, greenAlpha), _mm_or_si128(r, b)));
+    }
+    for(; i < count; i++){
+        u8 b = src[i * 4 + 0];
+        dst[i * 4 + 0] = src[i * 4 + 2];
+        dst[i * 4 + 1] = src[i * 4 + 1];
+        dst[i * 4 + 2] = b;
+        dst[i * 4 + 3] = src[i * 4 + 3];
+    }
+}
+
+static void tgaPixelToRGBA(u8* src, u32 bytesPerPixel, u8* dst){
+    if(bytesPerPixel == 1){
+        dst[0] = dst[1] = dst[2] = src[0];
+        dst[3] = 255;
+    }else{
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst[3] = bytesPerPixel == 4 ? src[3] : 255;
+    }
+}
+
+static bool decodeTGA(u8* data, u32 dataSize, ImageData* image, MemoryArena* arena){
+    if(dataSize < sizeof(TGAHeader)) return false;
+    TGAHeader* header = (TGAHeader*)data;
+    u32 type = header->imageType;
+    if(header->colorMapType != 0 || (type != 2 && type != 3 && type != 10 && type != 11)) return false;
+    u32 bytesPerPixel = header->bitsPerPixel / 8;
+    bool gray = type == 3 || type == 11;
+    if((gray && bytesPerPixel != 1) || (!gray && bytesPerPixel != 3 && bytesPerPixel != 4)) return false;
+
+    u32 width = header->width;
+    u32 height = header->height;
+    u64 arenaMark = arena->used;
+    u8* pixels = pushArray(arena, u8, (u64)width * height * 4);
+    if(!pixels) return false;
+
+    u8* ip = data + sizeof(TGAHeader) + header->idLength;
+    u8* iend = data + dataSize;
+    //rows are decoded in file order and written bottom up unless the descriptor says the origin is the top
+    bool topDown = (header->descriptor & 0x20) != 0;
+    if(type == 2 || type == 3){
+        if((u64)(iend - ip) < (u64)width * height * bytesPerPixel){
+            arena->used = arenaMark;
+            return false;
+        }
+        for(u32 y = 0; y < height; y++){
+            u8* row = pixels + (topDown ? y : height - 1 - y) * width * 4;
+            if(bytesPerPixel == 4){
+                swizzleBGRAToRGBA(row, ip, width);
+                ip += width * 4;
+            }else{
+                for(u32 x = 0; x < width; x++, ip += bytesPerPixel){
+                    tgaPixelToRGBA(ip, bytesPerPixel, row + x * 4);
+                }
+            }
+        }
+    }else{
+        u32 total = width * height;
+        u32 i = 0;
+        while(i < total){
+            u32 count = ip < iend ? (*ip & 0x7F) + 1 : 0;
+            bool run = ip < iend && (*ip & 0x80) != 0;
+            ip++;
+            if(count == 0 || i + count > total || ip > iend || (u64)(iend - ip) < (run ? 1 : count) * bytesPerPixel){
+                arena->used = arenaMark;
+                return false;
+            }
+            u8 pixel[4];
+            if(run){
+                tgaPixelToRGBA(ip, bytesPerPixel, pixel);
+                ip += bytesPerPixel;
+            }
+            for(u32 j = 0; j < count; j++, i++){
+                u32 y = i / width;
+                u8* dst = pixels + ((topDown ? y : height - 1 - y) * width + i % width) * 4;
+                if(run){
+                    copyMemory(dst, pixel, 4);
+                }else{
+                    tgaPixelToRGBA(ip, bytesPerPixel, dst);
+                    ip += bytesPerPixel;
+                }
+            }
+        }
+    }
+
+    setMemory(image, sizeof(ImageData), 0);
+    image->width = width;
+    image->height = height;
+    image->format = IMAGE_FORMAT_RGBA8;
+    image->totalLevels = 1;
+    image->totalFaces = 1;
+    image->levelData[0][0] = pixels;
+    image->levelSizes[0] = width * height * 4;
+    return true;
+}
+
+struct HuffmanTable {
+    u16 fast[1 << 9];
+    u16 firstCode[17];
+    u16 firstSymbol[17];
+    u32 maxCode[18];
+    u8 sizes[288];
+    u16 values[288];
+};
+
+//Bit reader over the payload of consecutive PNG IDAT chunks. When one chunk runs out it steps over the chunk
+//crc and header of the next, so the zlib stream never has to be gathered into one buffer.
+struct InflateStream {
+    u8* ip;
+    u8* chunkEnd;
+    u8* fileEnd;
+    u64 bits;
+    u32 bitCount;
+    bool overrun;
+    u8* outStart;
+    u8* out;
+    u8* outEnd;
+    HuffmanTable lengths;
+    HuffmanTable distances;
+};
+
+static u32 reverseBits(u32 v, u32 count){
+    v = ((v & 0xAAAA) >> 1) | ((v & 0x5555) << 1);
+    v = ((v & 0xCCCC) >> 2) | ((v & 0x3333) << 2);
+    v = ((v & 0xF0F0) >> 4) | ((v & 0x0F0F) << 4);
+    v = ((v & 0xFF00) >> 8) | ((v & 0x00FF) << 8);
+    return v >> (16 - count);
+}
+
+static bool buildHuffmanTable(HuffmanTable* table, u8* codeLengths, u32 count){
+    u32 lengthCounts[17] = {};
+    u32 nextCode[16];
+    setMemory(table->fast, sizeof(table->fast), 0);
+    for(u32 i = 0; i < count; i++){
+        lengthCounts[codeLengths[i]]++;
+    }
+    lengthCounts[0] = 0;
+    u32 code = 0;
+    u32 symbol = 0;
+    for(u32 i = 1; i < 16; i++){
+        nextCode[i] = code;
+        table->firstCode[i] = (u16)code;
+        table->firstSymbol[i] = (u16)symbol;
+        code += lengthCounts[i];
+        if(lengthCounts[i] && code - 1 >= (1U << i)) return false;
+        table->maxCode[i] = code << (16 - i);
+        code <<= 1;
+        symbol += lengthCounts[i];
+    }
+    table->maxCode[16] = 0x10000;
+    table->maxCode[17] = MAX_U32;
+    for(u32 i = 0; i < count; i++){
+        u32 length = codeLengths[i];
+        if(!length) continue;
+        u32 index = nextCode[length] - table->firstCode[length] + table->firstSymbol[length];
+        table->sizes[index] = (u8)length;
+        table->values[index] = (u16)i;
+        if(length <= 9){
+            for(u32 j = reverseBits(nextCode[length], length); j < (1 << 9); j += 1 << length){
+                table->fast[j] = (u16)((length << 9) | i);
+            }
+        }
+        nextCode[length]++;
+    }
+    return true;
+}
+
+static void refillInflateBits(InflateStream* s){
+    while(s->bitCount <= 56){
+        while(s->ip == s->chunkEnd){
+            //crc of the finished chunk, then the length and type of the next one
+            u8* next = s->chunkEnd + 4;
+            //past the last IDAT; readers flag an overrun only if they actually need the missing bits
+            if(next + 8 > s->fileEnd || readBigEndianU32(next + 4) != 0x49444154 ||
+               next + 8 + readBigEndianU32(next) > s->fileEnd){
+                return;
+            }
+            s->ip = next + 8;
+            s->chunkEnd = s->ip + readBigEndianU32(next);
+        }
+        s->bits |= (u64)*s->ip++ << s->bitCount;
+        s->bitCount += 8;
+    }
+}
+
+static u32 readInflateBits(InflateStream* s, u32 count){
+    if(s->bitCount < count){
+        refillInflateBits(s);
+        if(s->bitCount < count){
+            s->overrun = true;
+            return 0;
+        }
+    }
+    u32 v = (u32)(s->bits & ((1ULL << count) - 1));
+    s->bits >>= count;
+    s->bitCount -= count;
+    return v;
+}
+
+static s32 decodeHuffmanSymbol(InflateStream* s, HuffmanTable* table){
+    if(s->bitCount < 16){
+        refillInflateBits(s);
+    }
+    u32 fast = table->fast[s->bits & 511];
+    u32 length;
+    u32 symbol;
+    if(fast){
+        length = fast >> 9;
+        symbol = fast & 511;
+    }else{
+        u32 k = reverseBits((u32)(s->bits & 0xFFFF), 16);
+        for(length = 10; k >= table->maxCode[length]; length++);
+        if(length >= 16) return -1;
+        u32 index = (k >> (16 - length)) - table->firstCode[length] + table->firstSymbol[length];
+        if(index >= 288 || table->sizes[index] != length) return -1;
+        symbol = table->values[index];
+    }
+    if(length > s->bitCount) return -1;
+    s->bits >>= length;
+    s->bitCount -= length;
+    return (s32)symbol;
+}
+
+static bool readDynamicHuffmanTables(InflateStream* s){
+    static const u8 lengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    u32 literalCount = readInflateBits(s, 5) + 257;
+    u32 distanceCount = readInflateBits(s, 5) + 1;
+    u32 codeLengthCount = readInflateBits(s, 4) + 4;
+    //the 5 bit counts reach 288 and 32, past the 286 and 30 codes deflate has
+    if(literalCount > 286 || distanceCount > 30) return false;
+    u8 codeLengthSizes[19] = {};
+    for(u32 i = 0; i < codeLengthCount; i++){
+        codeLengthSizes[lengthOrder[i]] = (u8)readInflateBits(s, 3);
+    }
+    HuffmanTable* codeLengths = &s->lengths;
+    if(!buildHuffmanTable(codeLengths, codeLengthSizes, 19)) return false;
+
+    u8 lengths[288 + 32];
+    u32 total = literalCount + distanceCount;
+    u32 n = 0;
+    while(n < total){
+        s32 c = decodeHuffmanSymbol(s, codeLengths);
+        if(c < 0 || s->overrun) return false;
+        if(c < 16){
+            lengths[n++] = (u8)c;
+            continue;
+        }
+        u32 repeat;
+        u8 fill = 0;
+        if(c == 16){
+            if(n == 0) return false;
+            repeat = readInflateBits(s, 2) + 3;
+            fill = lengths[n - 1];
+        }else if(c == 17){
+            repeat = readInflateBits(s, 3) + 3;
+        }else{
+            repeat = readInflateBits(s, 7) + 11;
+        }
+        if(n + repeat > total) return false;
+        setMemory(lengths + n, repeat, fill);
+        n += repeat;
+    }
+    return buildHuffmanTable(&s->lengths, lengths, literalCount) &&
+           buildHuffmanTable(&s->distances, lengths + literalCount, distanceCount);
+}
+
+static bool inflateHuffmanBlock(InflateStream* s){
+    static const u16 lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const u8 lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const u16 distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const u8 distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    for(;;){
+        s32 symbol = decodeHuffmanSymbol(s, &s->lengths);
+        if(symbol < 0) return false;
+        if(symbol < 256){
+            if(s->out >= s->outEnd) return false;
+            *s->out++ = (u8)symbol;
+            continue;
+        }
+        if(symbol == 256) return !s->overrun;
+        symbol -= 257;
+        if(symbol >= 29) return false;
+        u32 length = lengthBase[symbol] + readInflateBits(s, lengthExtra[symbol]);
+        s32 d = decodeHuffmanSymbol(s, &s->distances);
+        if(d < 0 || d >= 30) return false;
+        u32 distance = distanceBase[d] + readInflateBits(s, distanceExtra[d]);
+        //the output buffer is the whole image, so the window is everything decoded so far
+        if(s->overrun || distance > (u32)(s->out - s->outStart) || length > (u32)(s->outEnd - s->out)){
+            return false;
+        }
+        u8* src = s->out - distance;
+        for(u32 i = 0; i < length; i++){
+            s->out[i] = src[i];
+        }
+        s->out += length;
+    }
+}
+
+//inflates a zlib stream into out; returns the number of bytes written, or 0 on a malformed stream
+static u32 inflateZlibStream(InflateStream* s){
+    s->outStart = s->out;
+    u32 cmf = readInflateBits(s, 8);
+    u32 flags = readInflateBits(s, 8);
+    if((cmf & 15) != 8 || ((cmf << 8) | flags) % 31 != 0 || (flags & 0x20)) return 0;
+
+    u32 final = 0;
+    while(!final){
+        final = readInflateBits(s, 1);
+        u32 type = readInflateBits(s, 2);
+        if(type == 0){
+            readInflateBits(s, s->bitCount & 7);
+            u32 length = readInflateBits(s, 16);
+            u32 inverse = readInflateBits(s, 16);
+            if((length ^ 0xFFFF) != inverse || length > (u32)(s->outEnd - s->out)) return 0;
+            for(u32 i = 0; i < length; i++){
+                *s->out++ = (u8)readInflateBits(s, 8);
+            }
+        }else if(type == 1){
+            u8 lengths[288 + 32];
+            setMemory(lengths, 144, 8);
+            setMemory(lengths + 144, 112, 9);
+            setMemory(lengths + 256, 24, 7);
+            setMemory(lengths + 280, 8, 8);
+            setMemory(lengths + 288, 32, 5);
+            if(!buildHuffmanTable(&s->lengths, lengths, 288) || !buildHuffmanTable(&s->distances, lengths + 288, 32)) return 0;
+            if(!inflateHuffmanBlock(s)) return 0;
+        }else if(type == 2){
+            if(!readDynamicHuffmanTables(s) || !inflateHuffmanBlock(s)) return 0;
+        }else{
+            return 0;
+        }
+        if(s->overrun) return 0;
+    }
+    return (u32)(s->out - s->outStart);
+}
+
+static u8 paethPredictor(s32 a, s32 b, s32 c){
+    s32 p = a + b - c;
+    s32 pa = p > a ? p - a : a - p;
+    s32 pb = p > b ? p - b : b - p;
+    s32 pc = p > c ? p - c : c - p;
+    if(pa <= pb && pa <= pc) return (u8)a;
+    return pb <= pc ? (u8)b : (u8)c;
+}
+
+//Undoes the PNG filter of one scanline in place. prior is the already unfiltered previous line, or 0 for the
+//first. Up is done 16 bytes at a time; the others depend on the pixel to the left and go one pixel at a time,
+//with the 4 byte per pixel case kept in an SSE register.
+static bool unfilterPNGRow(u8 filter, u8* row, u8* prior, u32 rowBytes, u32 bytesPerPixel){
+    static u8 zeroRow[16] = {};
+    switch(filter){
+        case 0: break;
+        case 1:{
+            for(u32 i = bytesPerPixel; i < rowBytes; i++){
+                row[i] = (u8)(row[i] + row[i - bytesPerPixel]);
+            }
+            break;
+        }
+        case 2:{
+            if(!prior) break;
+            u32 i = 0;
+            for(; i + 16 <= rowBytes; i += 16){
+                __m128i r = _mm_loadu_si128((__m128i*)(row + i));
+                __m128i p = _mm_loadu_si128((__m128i*)(prior + i));
+                _mm_storeu_si128((__m128i*)(row + i), _mm_add_epi8(r, p));
+            }
+            for(; i < rowBytes; i++){
+                row[i] = (u8)(row[i] + prior[i]);
+            }
+            break;
+        }
+        case 3:{
+            for(u32 i = 0; i < rowBytes; i++){
+                u32 left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+                u32 up = prior ? prior[i] : 0;
+                row[i] = (u8)(row[i] + ((left + up) >> 1));
+            }
+            break;
+        }
+        case 4:{
+            if(bytesPerPixel == 4){
+                __m128i zero = _mm_setzero_si128();
+                __m128i a = zero;
+                __m128i c = zero;
+                //rows start one byte past their filter byte, so pixels are copied in and out rather than cast
+                for(u32 i = 0; i < rowBytes; i += 4){
+                    s32 up;
+                    s32 pixel;
+                    copyMemory(&up, prior ? prior + i : zeroRow, 4);
+                    copyMemory(&pixel, row + i, 4);
+                    __m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128(up), zero);
+                    __m128i x = _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero);
+                    __m128i pa = _mm_sub_epi16(b, c);
+                    __m128i pb = _mm_sub_epi16(a, c);
+                    __m128i pc = _mm_add_epi16(pa, pb);
+                    pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+                    pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+                    pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+                    __m128i useA = _mm_and_si128(_mm_cmpgt_epi16(_mm_add_epi16(pb, _mm_set1_epi16(1)), pa),
+                                                 _mm_cmpgt_epi16(_mm_add_epi16(pc, _mm_set1_epi16(1)), pa));
+                    __m128i useB = _mm_cmpgt_epi16(_mm_add_epi16(pc, _mm_set1_epi16(1)), pb);
+                    __m128i predictor = _mm_or_si128(_mm_and_si128(useB, b), _mm_andnot_si128(useB, c));
+                    predictor = _mm_or_si128(_mm_and_si128(useA, a), _mm_andnot_si128(useA, predictor));
+                    a = _mm_and_si128(_mm_add_epi16(x, predictor), _mm_set1_epi16(0xFF));
+                    c = b;
+                    pixel = _mm_cvtsi128_si32(_mm_packus_epi16(a, a));
+                    copyMemory(row + i, &pixel, 4);
+                }
+            }else{
+                for(u32 i = 0; i < rowBytes; i++){
+                    s32 a = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+                    s32 b = prior ? prior[i] : 0;
+                    s32 c = prior && i >= bytesPerPixel ? prior[i - bytesPerPixel] : 0;
+                    row[i] = (u8)(row[i] + paethPredictor(a, b, c));
+                }
+            }
+            break;
+        }
+        default: return false;
+    }
+    return true;
+}
+
+static bool decodePNG(u8* data, u32 dataSize, ImageData* image, MemoryArena* arena){
+    static const u8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if(dataSize < 8 + 25) return false;
+    for(u32 i = 0; i < 8; i++){
+        if(data[i] != signature[i]) return false;
+    }
+    u8* ip = data + 8;
+    u8* iend = data + dataSize;
+    if(readBigEndianU32(ip + 4) != 0x49484452) return false;   //IHDR
+    u32 width = readBigEndianU32(ip + 8);
+    u32 height = readBigEndianU32(ip + 12);
+    u8 bitDepth = ip[16];
+    u8 colorType = ip[17];
+    u8 interlace = ip[20];
+    if(bitDepth != 8 || interlace != 0 || width == 0 || height == 0) return false;
+    u32 channels;
+    switch(colorType){
+        case 0: channels = 1; break;
+        case 2: channels = 3; break;
+        case 3: channels = 1; break;
+        case 4: channels = 2; break;
+        case 6: channels = 4; break;
+        default: return false;
+    }
+
+    u8 palette[256 * 4];
+    setMemory(palette, sizeof(palette), 255);
+    u8* firstIDAT = 0;
+    ip += 8 + readBigEndianU32(ip) + 4;
+    while(ip + 12 <= iend){
+        u32 length = readBigEndianU32(ip);
+        u32 type = readBigEndianU32(ip + 4);
+        if(ip + 12 + length > iend) return false;
+        u8* payload = ip + 8;
+        if(type == 0x504C5445){   //PLTE
+            for(u32 i = 0; i < length / 3 && i < 256; i++){
+                palette[i * 4 + 0] = payload[i * 3 + 0];
+                palette[i * 4 + 1] = payload[i * 3 + 1];
+                palette[i * 4 + 2] = payload[i * 3 + 2];
+            }
+        }else if(type == 0x74524E53 && colorType == 3){   //tRNS
+            for(u32 i = 0; i < length && i < 256; i++){
+                palette[i * 4 + 3] = payload[i];
+            }
+        }else if(type == 0x49444154){   //IDAT
+            firstIDAT = ip;
+            break;
+        }
+        ip += 12 + length;
+    }
+    if(!firstIDAT) return false;
+
+    u64 arenaMark = arena->used;
+    u32 rowBytes = width * channels;
+    u64 filteredSize = (u64)(rowBytes + 1) * height;
+    u8* pixels = pushArray(arena, u8, (u64)width * height * 4);
+    //the stream and the scanlines come after the pixels so both can be dropped once the pixels are out
+    InflateStream* stream = pushStruct(arena, InflateStream);
+    u8* filtered = pushArray(arena, u8, filteredSize);
+    if(!pixels || !stream || !filtered){
+        arena->used = arenaMark;
+        return false;
+    }
+    setMemory(stream, sizeof(InflateStream), 0);
+    stream->ip = firstIDAT + 8;
+    stream->chunkEnd = stream->ip + readBigEndianU32(firstIDAT);
+    stream->fileEnd = iend;
+    stream->out = filtered;
+    stream->outEnd = filtered + filteredSize;
+    if(inflateZlibStream(stream) != filteredSize){
+        arena->used = arenaMark;
+        return false;
+    }
+
+    u8* prior = 0;
+    for(u32 y = 0; y < height; y++){
+        u8* row = filtered + y * (u64)(rowBytes + 1);
+        if(!unfilterPNGRow(row[0], row + 1, prior, rowBytes, channels)){
+            arena->used = arenaMark;
+            return false;
+        }
+        prior = row + 1;
+
+        u8* src = row + 1;
+        u8* dst = pixels + (u64)y * width * 4;
+        switch(colorType){
+            case 0:{
+                for(u32 x = 0; x < width; x++){
+                    dst[x * 4 + 0] = dst[x * 4 + 1] = dst[x * 4 + 2] = src[x];
+                    dst[x * 4 + 3] = 255;
+                }
+                break;
+            }
+            case 2:{
+                for(u32 x = 0; x < width; x++){
+                    dst[x * 4 + 0] = src[x * 3 + 0];
+                    dst[x * 4 + 1] = src[x * 3 + 1];
+                    dst[x * 4 + 2] = src[x * 3 + 2];
+                    dst[x * 4 + 3] = 255;
+                }
+                break;
+            }
+            case 3:{
+                for(u32 x = 0; x < width; x++){
+                    copyMemory(dst + x * 4, palette + src[x] * 4, 4);
+                }
+                break;
+            }
+            case 4:{
+                for(u32 x = 0; x < width; x++){
+                    dst[x * 4 + 0] = dst[x * 4 + 1] = dst[x * 4 + 2] = src[x * 2];
+                    dst[x * 4 + 3] = src[x * 2 + 1];
+                }
+                break;
+            }
+            case 6:{
+                copyMemory(dst, src, rowBytes);
+                break;
+            }
+        }
+    }
+    arena->used = (u64)(pixels - arena->base) + (u64)width * height * 4;
+
+    setMemory(image, sizeof(ImageData), 0);
+    image->width = width;
+    image->height = height;
+    image->format = IMAGE_FORMAT_RGBA8;
+    image->totalLevels = 1;
+    image->totalFaces = 1;
+    image->levelData[0][0] = pixels;
+    image->levelSizes[0] = width * height * 4;
+    return true;
+}
+
+//DDS and KTX2 are parsed in place and keep pointing into data; TGA and PNG are decoded into arena
+static bool decodeImage(u8* data, u32 dataSize, ImageData* image, MemoryArena* arena){
+    if(dataSize >= 4 && *(u32*)data == DDS_MAGIC){
+        return parseDDS(data, dataSize, image);
+    }
+    if(dataSize >= 12 && data[0] == 0xAB && data[1] == 'K'){
+        return parseKTX2(data, dataSize, image);
+    }
+    if(dataSize >= 8 && data[0] == 0x89 && data[1] == 'P'){
+        return decodePNG(data, dataSize, image, arena);
+    }
+    return decodeTGA(data, dataSize, image, arena);
+}
+
+static void decodeImageJob(void* data){
+    ImageDecodeJob* job = (ImageDecodeJob*)data;
+    job->success = decodeImage(job->fileData, job->fileSize, &job->image, &job->arena);
+}
+
+//Decodes several files at once, one per job. Every job needs its own arena since they run concurrently.
+static void decodeImages(ImageDecodeJob* jobs, u32 totalJobs, OSInterface* os = 0, WorkQueue* queue = 0){
+    if(!os || !queue){
+        for(u32 i = 0; i < totalJobs; i++){
+            decodeImageJob(&jobs[i]);
+        }
+        return;
+    }
+    for(u32 i = 0; i < totalJobs; i += WorkQueue::MAX_ENTRIES - 1){
+        u32 end = i + WorkQueue::MAX_ENTRIES - 1;
+        if(end > totalJobs) end = totalJobs;
+        for(u32 j = i; j < end; j++){
+            os->addWorkQueueEntry(queue, decodeImageJob, &jobs[j]);
+        }
+        os->completeWorkQueueEntries(queue);
+    }
+}
+
+//Encodes every level of an RGBA8 chain into the block compression format, back to back in scratch, as
+//createTexture2DMipmapped takes them. Returns 0 when scratch cannot hold them.
+static u8* compressImageChain(u8* chain, u32 width, u32 height, u32 levels, u32 format, u32 quality,
+                              MemoryArena* scratch, OSInterface* os = 0, WorkQueue* queue = 0){
+    u32 size = 0;
+    for(u32 i = 0; i < levels; i++){
+        size += getBlockCompressedSize(format, getMipLevelDimension(width, i), getMipLevelDimension(height, i));
+    }
+    u8* blocks = pushArray(scratch, u8, size);
+    if(!blocks){
+        return 0;
+    }
+    u8* source = chain;
+    u8* out = blocks;
+    for(u32 i = 0; i < levels; i++){
+        u32 w = getMipLevelDimension(width, i);
+        u32 h = getMipLevelDimension(height, i);
+        compressTexture(source, w, h, format, quality, out, os, queue);
+        source += w * h * 4;
+        out += getBlockCompressedSize(format, w, h);
+    }
+    return blocks;
+}
+
+//Creates the texture from face 0. A DDS level chain is already contiguous and is passed as is; KTX2 levels are
+//stored smallest first, so they are gathered into scratch. A single level RGBA8 image, as TGA and PNG decode to,
+//gets its whole mip chain generated into scratch with settings, the defaults when 0, and is created with the one
+//level when scratch cannot hold the chain. With compression a BLOCK_COMPRESSION format its levels are then encoded
+//in it at quality, if its size is a multiple of the block size as block compressed textures need, cutting the
+//texture's memory and upload to a quarter (BC5) or an eighth (BC1, BC4).
+static Texture2D createTexture2DFromImage(OSInterface* os, ImageData* image, MemoryArena* scratch,
+                                          MipChainSettings* settings = 0, WorkQueue* queue = 0,
+                                          u32 compression = IMAGE_FORMAT_RGBA8,
+                                          u32 quality = BLOCK_COMPRESSION_QUALITY_NORMAL){
+    u32 format = getImageTextureFormat(os, image->format);
+    u32 mipLevels = getMipLevelCount(image->width, image->height);
+    bool compress = compression != IMAGE_FORMAT_RGBA8 && image->width % 4 == 0 && image->height % 4 == 0;
+    if(image->totalLevels == 1 && image->format == IMAGE_FORMAT_RGBA8 && (mipLevels > 1 || compress)){
+        MipChainSettings defaults = defaultMipChainSettings();
+        u64 scratchMark = scratch->used;
+        u8* chain = pushArray(scratch, u8, getMipChainSize(image->width, image->height));
+        if(!chain || !generateMipChain(image->levelData[0][0], image->width, image->height,
+                                       settings ? settings : &defaults, chain, scratch, os, queue)){
+            chain = image->levelData[0][0];
+            mipLevels = 1;
+        }
+        u8* blocks = compress ? compressImageChain(chain, image->width, image->height, mipLevels, compression, quality,
+                                                   scratch, os, queue) : 0;
+        if(blocks){
+            chain = blocks;
+            format = getBlockCompressionTextureFormat(os, compression);
+        }
+        Texture2D texture = os->createTexture2DMipmapped(chain, image->width, image->height, format, mipLevels);
+        scratch->used = scratchMark;
+        return texture;
+    }
+    if(image->totalLevels == 1){
+        return os->createTexture2D(image->levelData[0][0], image->width, image->height, format);
+    }
+    u8* chain = image->levelData[0][0];
+    u32 chainSize = 0;
+    bool contiguous = true;
+    for(u32 i = 0; i < image->totalLevels; i++){
+        contiguous &= image->levelData[0][i] == chain + chainSize;
+        chainSize += image->levelSizes[i];
+    }
+    u64 scratchMark = scratch->used;
+    if(!contiguous){
+        chain = pushArray(scratch, u8, chainSize);
+        if(!chain){
+            return os->createTexture2D(image->levelData[0][0], image->width, image->height, format);
+        }
+        u8* p = chain;
+        for(u32 i = 0; i < image->totalLevels; i++){
+            copyMemory(p, image->levelData[0][i], image->levelSizes[i]);
+            p += image->levelSizes[i];
+        }
+    }
+    Texture2D texture = os->createTexture2DMipmapped(chain, image->width, image->height, format, image->totalLevels);
+    scratch->used = scratchMark;
+    return texture;
+}
+
+//Reads and decodes the file in scratch and creates its texture through createTexture2DFromImage, for the platform
+//layers' createTexture2DFromFile hooks. The file may take up to half of what scratch has left, the rest is for
+//decoding, the mip chain and its blocks. A texture with data1 0 is returned when the file cannot be read or decoded.
+static Texture2D createTexture2DFromImageFile(OSInterface* os, const s8* fileName, MemoryArena* scratch,
+                                              MipChainSettings* settings = 0, WorkQueue* queue = 0,
+                                              u32 compression = IMAGE_FORMAT_RGBA8,
+                                              u32 quality = BLOCK_COMPRESSION_QUALITY_NORMAL){
+    Texture2D texture = {};
+    u64 scratchMark = scratch->used;
+    u32 capacity = (u32)((scratch->size - scratch->used) / 2);
+    u8* data = (u8*)pushSize(scratch, capacity);
+    u32 fileLength = 0;
+    ImageData image = {};
+    if(data && os->readFileIntoBoundedBuffer(fileName, data, capacity, &fileLength)){
+        scratch->used = (u64)(data - scratch->base) + fileLength;
+        if(decodeImage(data, fileLength, &image, scratch)){
+            texture = createTexture2DFromImage(os, &image, scratch, settings, queue, compression, quality);
+        }
+    }
+    scratch->used = scratchMark;
+    return texture;
+}
+
+//Writes levels of a BLOCK_COMPRESSION format or IMAGE_FORMAT_RGBA8 image, back to back in data largest first, as a
+//DDS file parseDDS reads back. scratch holds the file while it is written.
+static bool writeDDSFile(OSInterface* os, const s8* fileName, u32 width, u32 height, u32 format, u32 levels, void* data,
+                         MemoryArena* scratch){
+    u32 dxgiFormat = 0;
+    switch(format){
+        case BLOCK_COMPRESSION_BC1: dxgiFormat = 71; break;
+        case BLOCK_COMPRESSION_BC4U: dxgiFormat = 80; break;
+        case BLOCK_COMPRESSION_BC4S: dxgiFormat = 81; break;
+        case BLOCK_COMPRESSION_BC5: dxgiFormat = 83; break;
+        case IMAGE_FORMAT_RGBA8: dxgiFormat = 28; break;
+        default: return false;
+    }
+    if(!levels || levels > IMAGE_MAX_LEVELS){
+        return false;
+    }
+    u32 dataSize = 0;
+    for(u32 i = 0; i < levels; i++){
+        dataSize += getImageLevelSize(format, getMipLevelDimension(width, i), getMipLevelDimension(height, i));
+    }
+    u64 scratchMark = scratch->used;
+    u32 fileSize = sizeof(DDSHeader) + sizeof(DDSHeaderDX10) + dataSize;
+    u8* file = pushArray(scratch, u8, fileSize);
+    if(!file){
+        return false;
+    }
+    DDSHeader* header = (DDSHeader*)file;
+    setMemory(header, sizeof(DDSHeader) + sizeof(DDSHeaderDX10));
+    header->magic = DDS_MAGIC;
+    header->size = 124;
+    header->flags = DDS_FLAGS_TEXTURE;
+    header->height = height;
+    header->width = width;
+    header->pitchOrLinearSize = getImageLevelSize(format, width, height);
+    header->mipMapCount = levels;
+    header->pixelFormat.size = sizeof(DDSPixelFormat);
+    header->pixelFormat.flags = DDS_FLAG_FOURCC;
+    header->pixelFormat.fourCC = DDS_FOURCC_DX10;
+    header->caps = DDS_CAPS_TEXTURE;
+    DDSHeaderDX10* dx10 = (DDSHeaderDX10*)(file + sizeof(DDSHeader));
+    dx10->dxgiFormat = dxgiFormat;
+    dx10->resourceDimension = DDS_DIMENSION_TEXTURE2D;
+    dx10->arraySize = 1;
+    copyMemory(file + sizeof(DDSHeader) + sizeof(DDSHeaderDX10), data, dataSize);
+    bool success = os->writeToFile(fileName, file, fileSize);
+    scratch->used = scratchMark;
+    return success;
+}
@@ -98,10 +98,13 @@ union Vector4 {
         f32 w;
     };
 
+    //anonymous structs of types with constructors are an msvc extension
+#ifdef _MSC_VER
     struct{
         Vector2 xy;
         Vector2 zw;
     };
+#endif
 
     Vector4(){}
     Vector4(__m128 a): v(a){}
@@ -477,6 +480,11 @@ static f32 dot(Quaternion q1, Quaternion q2){
     return v.x; 
 }
 
+//z of the 3d cross product, positive when v2 turns counter clockwise from v1
+static f32 cross(Vector2 v1, Vector2 v2){
+    return v1.x * v2.y - v1.y * v2.x;
+}
+
 static Vector3 cross(Vector3 v1, Vector3 v2){
     __m128 tmp0 = _mm_shuffle_ps(v1.v, v1.v, _MM_SHUFFLE(3, 0, 2, 1));
     __m128 tmp1 = _mm_shuffle_ps(v2.v, v2.v, _MM_SHUFFLE(3, 1, 0, 2));
@@ -570,7 +578,7 @@ static void rotate(Quaternion* q, Vector3 axis, f32 angle){
     normalize(q);
 }
 
-static Matrix4 operator*(Matrix4& m1, Matrix4& m2){
+static Matrix4 operator*(const Matrix4& m1, const Matrix4& m2){
     Matrix4 m;
     Vector4 m1c0(m1.m2[0][0], m1.m2[1][0], m1.m2[2][0], m1.m2[3][0]);
     Vector4 m1c1(m1.m2[0][1], m1.m2[1][1], m1.m2[2][1], m1.m2[3][1]);
@@ -895,4 +903,12 @@ static f32 clamp(f32 v, f32 min, f32 max){
     if(v < min) return min;
     if(v > max) return max;
     return v;
-}
\ No newline at end of file
+}
+
+static __m128 absoluteValue4(__m128 v){
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+static __m128 select4(__m128 mask, __m128 a, __m128 b){
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
@@ -0,0 +1,540 @@
+#pragma once
+
+#include "os_interface.h"
+
+// Index/vertex buffer optimizations for the data passed to createModel3D. The functions work on
+// interleaved float vertices whose first three floats are the position and on 16 bit triangle lists.
+// Every step works in place and can be run offline or at load time.
+// Front faces are clockwise unless frontCounterClockwise is set, the D3D12 default the pipelines use; the overdraw
+// order and analysis need to know which side of a triangle faces out.
+
+#define MESH_OPTIMIZER_DEFAULT_CACHE_SIZE 16
+#define MESH_OPTIMIZER_DEFAULT_OVERDRAW_THRESHOLD 1.05f
+#define MESH_OPTIMIZER_OVERDRAW_VIEWPORT 256
+
+struct VertexCacheStatistics {
+    u32 verticesTransformed;
+    f32 acmr;
+    f32 atvr;
+};
+
+struct OverdrawStatistics {
+    u32 pixelsCovered;
+    u32 pixelsShaded;
+    f32 overdraw;
+};
+
+struct MeshOptimizeSettings {
+    bool deduplicate;
+    bool optimizeVertexCache;
+    bool optimizeOverdraw;
+    bool optimizeVertexFetch;
+    bool frontCounterClockwise;
+    u32 cacheSize;
+    f32 overdrawThreshold;
+};
+
+static MeshOptimizeSettings defaultMeshOptimizeSettings(){
+    MeshOptimizeSettings settings;
+    settings.deduplicate = true;
+    settings.optimizeVertexCache = true;
+    settings.optimizeOverdraw = true;
+    settings.optimizeVertexFetch = true;
+    settings.frontCounterClockwise = false;
+    settings.cacheSize = MESH_OPTIMIZER_DEFAULT_CACHE_SIZE;
+    settings.overdrawThreshold = MESH_OPTIMIZER_DEFAULT_OVERDRAW_THRESHOLD;
+    return settings;
+}
+
+//FIFO post transform cache simulation. acmr is transformed vertices per triangle, atvr per unique vertex.
+static VertexCacheStatistics analyzeVertexCache(u16* indices, u32 indexCount, u32 vertexCount, u32 cacheSize, MemoryArena* scratch){
+    VertexCacheStatistics stats = {};
+    u64 scratchMark = scratch->used;
+    u32* timestamps = pushArray(scratch, u32, vertexCount);
+    if(!timestamps || indexCount == 0){
+        scratch->used = scratchMark;
+        return stats;
+    }
+    setMemory(timestamps, vertexCount * sizeof(u32), 0);
+
+    u32 usedVertices = 0;
+    u32 time = cacheSize + 1;
+    for(u32 i = 0; i < indexCount; i++){
+        u32 v = indices[i];
+        if(timestamps[v] == 0) usedVertices++;
+        if(time - timestamps[v] > cacheSize){
+            timestamps[v] = time++;
+            stats.verticesTransformed++;
+        }
+    }
+    stats.acmr = (f32)stats.verticesTransformed / (f32)(indexCount / 3);
+    stats.atvr = (f32)stats.verticesTransformed / (f32)usedVertices;
+    scratch->used = scratchMark;
+    return stats;
+}
+
+static Vector3 vertexPosition(f32* vertices, u32 vertexStride, u32 v){
+    f32* p = vertices + v * vertexStride;
+    return Vector3(p[0], p[1], p[2]);
+}
+
+//draws the front faces in index order into a depth buffer, counting every pixel that passes the depth test
+static void rasterizeOverdrawView(u16* indices, u32 indexCount, f32* vertices, u32 vertexStride, Vector3 boundsMin,
+                                  f32 scale, u32 axis, f32 direction, bool frontCounterClockwise, f32* depth,
+                                  OverdrawStatistics* stats){
+    const u32 size = MESH_OPTIMIZER_OVERDRAW_VIEWPORT;
+    u32 uAxis = (axis + 1) % 3;
+    u32 vAxis = (axis + 2) % 3;
+    const f32 empty = MAX_F32;
+    for(u32 i = 0; i < size * size; i++){
+        depth[i] = empty;
+    }
+    for(u32 t = 0; t + 2 < indexCount; t += 3){
+        f32 x[3], y[3], z[3];
+        for(u32 j = 0; j < 3; j++){
+            f32* p = vertices + indices[t + j] * vertexStride;
+            //looking from the negative side mirrors the view, so u runs the other way to keep the winding
+            x[j] = (p[uAxis] - boundsMin.va[uAxis]) * scale;
+            x[j] = direction > 0 ? x[j] : size - x[j];
+            y[j] = (p[vAxis] - boundsMin.va[vAxis]) * scale;
+            z[j] = -direction * p[axis];
+        }
+        f32 area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if(area == 0 || (area > 0) != frontCounterClockwise) continue;
+
+        s32 minX = (s32)floorf(fminf(x[0], fminf(x[1], x[2])));
+        s32 maxX = (s32)ceilf(fmaxf(x[0], fmaxf(x[1], x[2])));
+        s32 minY = (s32)floorf(fminf(y[0], fminf(y[1], y[2])));
+        s32 maxY = (s32)ceilf(fmaxf(y[0], fmaxf(y[1], y[2])));
+        if(minX < 0) minX = 0;
+        if(minY < 0) minY = 0;
+        if(maxX > (s32)size - 1) maxX = size - 1;
+        if(maxY > (s32)size - 1) maxY = size - 1;
+        f32 inverseArea = 1.0f / area;
+        for(s32 py = minY; py <= maxY; py++){
+            for(s32 px = minX; px <= maxX; px++){
+                f32 sx = px + 0.5f;
+                f32 sy = py + 0.5f;
+                f32 w0 = ((x[1] - sx) * (y[2] - sy) - (x[2] - sx) * (y[1] - sy)) * inverseArea;
+                f32 w1 = ((x[2] - sx) * (y[0] - sy) - (x[0] - sx) * (y[2] - sy)) * inverseArea;
+                f32 w2 = 1.0f - w0 - w1;
+                if(w0 < 0 || w1 < 0 || w2 < 0) continue;
+                f32 d = w0 * z[0] + w1 * z[1] + w2 * z[2];
+                f32* pixel = depth + py * size + px;
+                if(d < *pixel){
+                    *pixel = d;
+                    stats->pixelsShaded++;
+                }
+            }
+        }
+    }
+    for(u32 i = 0; i < size * size; i++){
+        if(depth[i] != empty) stats->pixelsCovered++;
+    }
+}
+
+//Software rasterizes the mesh from the six axis directions with back faces culled and a depth test, like
+//meshoptimizer's analyzer. overdraw is pixels shaded per pixel covered, 1 when nothing is drawn twice.
+static OverdrawStatistics analyzeOverdraw(u16* indices, u32 indexCount, f32* vertices, u32 vertexCount, u32 vertexStride,
+                                          bool frontCounterClockwise, MemoryArena* scratch){
+    OverdrawStatistics stats = {};
+    u64 scratchMark = scratch->used;
+    f32* depth = pushArray(scratch, f32, MESH_OPTIMIZER_OVERDRAW_VIEWPORT * MESH_OPTIMIZER_OVERDRAW_VIEWPORT);
+    if(!depth || vertexCount == 0){
+        scratch->used = scratchMark;
+        return stats;
+    }
+    Vector3 boundsMin = vertexPosition(vertices, vertexStride, 0);
+    Vector3 boundsMax = boundsMin;
+    for(u32 i = 1; i < vertexCount; i++){
+        Vector3 p = vertexPosition(vertices, vertexStride, i);
+        for(u32 j = 0; j < 3; j++){
+            if(p.va[j] < boundsMin.va[j]) boundsMin.va[j] = p.va[j];
+            if(p.va[j] > boundsMax.va[j]) boundsMax.va[j] = p.va[j];
+        }
+    }
+    f32 extent = 0;
+    for(u32 j = 0; j < 3; j++){
+        if(boundsMax.va[j] - boundsMin.va[j] > extent) extent = boundsMax.va[j] - boundsMin.va[j];
+    }
+    f32 scale = extent > 0 ? (MESH_OPTIMIZER_OVERDRAW_VIEWPORT - 1) / extent : 0;
+    for(u32 axis = 0; axis < 3; axis++){
+        rasterizeOverdrawView(indices, indexCount, vertices, vertexStride, boundsMin, scale, axis, 1,
+                              frontCounterClockwise, depth, &stats);
+        rasterizeOverdrawView(indices, indexCount, vertices, vertexStride, boundsMin, scale, axis, -1,
+                              frontCounterClockwise, depth, &stats);
+    }
+    stats.overdraw = stats.pixelsCovered ? (f32)stats.pixelsShaded / (f32)stats.pixelsCovered : 0;
+    scratch->used = scratchMark;
+    return stats;
+}
+
+static u32 hashVertex(f32* vertex, u32 vertexStride){
+    u32* words = (u32*)vertex;
+    u32 h = 2166136261U;
+    for(u32 i = 0; i < vertexStride; i++){
+        h = (h ^ words[i]) * 16777619U;
+    }
+    return h;
+}
+
+static bool verticesEqual(f32* a, f32* b, u32 vertexStride){
+    u32* wa = (u32*)a;
+    u32* wb = (u32*)b;
+    for(u32 i = 0; i < vertexStride; i++){
+        if(wa[i] != wb[i]) return false;
+    }
+    return true;
+}
+
+//Merges bitwise identical vertices and compacts the vertex data. Returns the new vertex count.
+static u32 deduplicateVertices(f32* vertices, u32 vertexCount, u32 vertexStride, u16* indices, u32 indexCount, MemoryArena* scratch){
+    u64 scratchMark = scratch->used;
+    u32 tableSize = nextPowerOfTwo(vertexCount * 2);
+    u32* table = pushArray(scratch, u32, tableSize);
+    u16* remap = pushArray(scratch, u16, vertexCount);
+    if(!table || !remap){
+        scratch->used = scratchMark;
+        return vertexCount;
+    }
+    setMemory(table, tableSize * sizeof(u32), 0xFF);
+
+    u32 uniqueCount = 0;
+    for(u32 i = 0; i < vertexCount; i++){
+        f32* vertex = vertices + i * vertexStride;
+        u32 slot = hashVertex(vertex, vertexStride) & (tableSize - 1);
+        while(table[slot] != MAX_U32 && !verticesEqual(vertices + table[slot] * vertexStride, vertex, vertexStride)){
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if(table[slot] == MAX_U32){
+            //unique vertices only ever move towards the front so the source is never overwritten early
+            if(uniqueCount != i){
+                copyMemory(vertices + uniqueCount * vertexStride, vertex, vertexStride * sizeof(f32));
+            }
+            table[slot] = uniqueCount;
+            remap[i] = (u16)uniqueCount++;
+        }else{
+            remap[i] = (u16)table[slot];
+        }
+    }
+
+    for(u32 i = 0; i < indexCount; i++){
+        indices[i] = remap[indices[i]];
+    }
+    scratch->used = scratchMark;
+    return uniqueCount;
+}
+
+//true when the indices make whole triangles naming only vertices below vertexCount, which every step here relies on
+//to stay inside the arrays it sizes by vertexCount
+static bool areTriangleIndicesValid(u16* indices, u32 indexCount, u32 vertexCount){
+    if(indexCount % 3){
+        return false;
+    }
+    for(u32 i = 0; i < indexCount; i++){
+        if(indices[i] >= vertexCount){
+            return false;
+        }
+    }
+    return true;
+}
+
+struct TriangleAdjacency {
+    u32* counts;
+    u32* offsets;
+    u32* triangles;
+};
+
+static bool buildTriangleAdjacency(TriangleAdjacency* adjacency, u16* indices, u32 indexCount, u32 vertexCount, MemoryArena* scratch){
+    adjacency->counts = pushArray(scratch, u32, vertexCount);
+    adjacency->offsets = pushArray(scratch, u32, vertexCount);
+    adjacency->triangles = pushArray(scratch, u32, indexCount);
+    if(!adjacency->counts || !adjacency->offsets || !adjacency->triangles){
+        return false;
+    }
+    setMemory(adjacency->counts, vertexCount * sizeof(u32), 0);
+    for(u32 i = 0; i < indexCount; i++){
+        adjacency->counts[indices[i]]++;
+    }
+    u32 offset = 0;
+    for(u32 i = 0; i < vertexCount; i++){
+        adjacency->offsets[i] = offset;
+        offset += adjacency->counts[i];
+    }
+    for(u32 i = 0; i < indexCount; i++){
+        u32 v = indices[i];
+        adjacency->triangles[adjacency->offsets[v]++] = i / 3;
+    }
+    for(u32 i = 0; i < vertexCount; i++){
+        adjacency->offsets[i] -= adjacency->counts[i];
+    }
+    return true;
+}
+
+//Tipsify (Sander et al. 2007). Triangles are fanned around the vertex that is most likely to still be in the cache.
+static void optimizeVertexCache(u16* indices, u32 indexCount, u32 vertexCount, u32 cacheSize, MemoryArena* scratch){
+    u32 triangleCount = indexCount / 3;
+    if(triangleCount == 0) return;
+
+    u64 scratchMark = scratch->used;
+    TriangleAdjacency adjacency;
+    u32* liveTriangles = pushArray(scratch, u32, vertexCount);
+    u32* cacheTimestamps = pushArray(scratch, u32, vertexCount);
+    u32* deadEndStack = pushArray(scratch, u32, indexCount);
+    u8* emitted = pushArray(scratch, u8, triangleCount);
+    u16* source = pushArray(scratch, u16, indexCount);
+    u32* candidates = pushArray(scratch, u32, indexCount);
+    if(!liveTriangles || !cacheTimestamps || !deadEndStack || !emitted || !source || !candidates ||
+       !buildTriangleAdjacency(&adjacency, indices, indexCount, vertexCount, scratch)){
+        scratch->used = scratchMark;
+        return;
+    }
+
+    copyMemory(source, indices, indexCount * sizeof(u16));
+    copyMemory(liveTriangles, adjacency.counts, vertexCount * sizeof(u32));
+    setMemory(cacheTimestamps, vertexCount * sizeof(u32), 0);
+    setMemory(emitted, triangleCount, 0);
+
+    u32 deadEndTop = 0;
+    u32 outputIndex = 0;
+    u32 time = cacheSize + 1;
+    u32 cursor = 0;
+    s32 fanningVertex = 0;
+    while(fanningVertex >= 0){
+        u32 candidateCount = 0;
+        u32 f = (u32)fanningVertex;
+        for(u32 i = 0; i < adjacency.counts[f]; i++){
+            u32 t = adjacency.triangles[adjacency.offsets[f] + i];
+            if(emitted[t]) continue;
+            emitted[t] = 1;
+            for(u32 j = 0; j < 3; j++){
+                u32 v = source[t * 3 + j];
+                indices[outputIndex++] = (u16)v;
+                deadEndStack[deadEndTop++] = v;
+                candidates[candidateCount++] = v;
+                liveTriangles[v]--;
+                if(time - cacheTimestamps[v] > cacheSize){
+                    cacheTimestamps[v] = time++;
+                }
+            }
+        }
+
+        fanningVertex = -1;
+        s32 bestPriority = -1;
+        for(u32 i = 0; i < candidateCount; i++){
+            u32 v = candidates[i];
+            if(liveTriangles[v] == 0) continue;
+            s32 priority = 0;
+            if(time - cacheTimestamps[v] + 2 * liveTriangles[v] <= cacheSize){
+                priority = (s32)(time - cacheTimestamps[v]);
+            }
+            if(priority > bestPriority){
+                bestPriority = priority;
+                fanningVertex = (s32)v;
+            }
+        }
+
+        if(fanningVertex < 0){
+            while(deadEndTop > 0){
+                u32 v = deadEndStack[--deadEndTop];
+                if(liveTriangles[v] > 0){
+                    fanningVertex = (s32)v;
+                    break;
+                }
+            }
+        }
+        while(fanningVertex < 0 && cursor < vertexCount){
+            if(liveTriangles[cursor] > 0){
+                fanningVertex = (s32)cursor;
+            }
+            cursor++;
+        }
+    }
+    scratch->used = scratchMark;
+}
+
+//Splits the cache optimized triangle list into clusters and orders them outside-in so that front facing
+//geometry is more likely to be drawn first. A cluster boundary is only inserted where restarting the cache
+//keeps the cluster ACMR within threshold times the ACMR of the whole mesh.
+static void optimizeOverdraw(u16* indices, u32 indexCount, f32* vertices, u32 vertexCount, u32 vertexStride,
+                             u32 cacheSize, f32 threshold, bool frontCounterClockwise, MemoryArena* scratch){
+    u32 triangleCount = indexCount / 3;
+    if(triangleCount == 0) return;
+
+    u64 scratchMark = scratch->used;
+    u32* timestamps = pushArray(scratch, u32, vertexCount);
+    u32* clusterStarts = pushArray(scratch, u32, triangleCount + 1);
+    u32* misses = pushArray(scratch, u32, triangleCount);
+    u16* source = pushArray(scratch, u16, indexCount);
+    if(!timestamps || !clusterStarts || !misses || !source){
+        scratch->used = scratchMark;
+        return;
+    }
+    copyMemory(source, indices, indexCount * sizeof(u16));
+
+    setMemory(timestamps, vertexCount * sizeof(u32), 0);
+    u32 time = cacheSize + 1;
+    u32 totalMisses = 0;
+    for(u32 t = 0; t < triangleCount; t++){
+        misses[t] = 0;
+        for(u32 j = 0; j < 3; j++){
+            u32 v = source[t * 3 + j];
+            if(time - timestamps[v] > cacheSize){
+                timestamps[v] = time++;
+                misses[t]++;
+            }
+        }
+        totalMisses += misses[t];
+    }
+    f32 meshACMR = (f32)totalMisses / (f32)triangleCount;
+
+    //a triangle with three misses means the cache was already cold, so a cluster may begin there for free
+    u32 clusterCount = 0;
+    for(u32 t = 0; t < triangleCount; t++){
+        if(t == 0 || misses[t] == 3){
+            clusterStarts[clusterCount++] = t;
+        }
+    }
+    clusterStarts[clusterCount] = triangleCount;
+
+    //split hard clusters further wherever a fresh cache would still stay under the threshold
+    u32 softCount = 0;
+    u32* softStarts = pushArray(scratch, u32, triangleCount + 1);
+    if(!softStarts){
+        scratch->used = scratchMark;
+        return;
+    }
+    for(u32 c = 0; c < clusterCount; c++){
+        u32 start = clusterStarts[c];
+        u32 end = clusterStarts[c + 1];
+        softStarts[softCount++] = start;
+        setMemory(timestamps, vertexCount * sizeof(u32), 0);
+        time = cacheSize + 1;
+        u32 clusterMisses = 0;
+        u32 clusterStart = start;
+        for(u32 t = start; t < end; t++){
+            for(u32 j = 0; j < 3; j++){
+                u32 v = source[t * 3 + j];
+                if(time - timestamps[v] > cacheSize){
+                    timestamps[v] = time++;
+                    clusterMisses++;
+                }
+            }
+            u32 clusterTriangles = t - clusterStart + 1;
+            if(t + 1 < end && clusterTriangles >= 8 && (f32)clusterMisses / (f32)clusterTriangles <= meshACMR * threshold){
+                softStarts[softCount++] = t + 1;
+                clusterStart = t + 1;
+                clusterMisses = 0;
+                setMemory(timestamps, vertexCount * sizeof(u32), 0);
+                time = cacheSize + 1;
+            }
+        }
+    }
+    softStarts[softCount] = triangleCount;
+
+    f32* keys = pushArray(scratch, f32, softCount);
+    u32* order = pushArray(scratch, u32, softCount);
+    if(!keys || !order){
+        scratch->used = scratchMark;
+        return;
+    }
+
+    Vector3 meshCenter(0);
+    f32 meshArea = 0;
+    for(u32 t = 0; t < triangleCount; t++){
+        Vector3 a = vertexPosition(vertices, vertexStride, source[t * 3]);
+        Vector3 b = vertexPosition(vertices, vertexStride, source[t * 3 + 1]);
+        Vector3 c = vertexPosition(vertices, vertexStride, source[t * 3 + 2]);
+        f32 area = length(cross(b - a, c - a));
+        meshCenter = meshCenter + (a + b + c) * (area / 3.0f);
+        meshArea += area;
+    }
+    if(meshArea > 0) meshCenter = meshCenter / meshArea;
+
+    for(u32 c = 0; c < softCount; c++){
+        Vector3 center(0);
+        Vector3 normal(0);
+        f32 clusterArea = 0;
+        for(u32 t = softStarts[c]; t < softStarts[c + 1]; t++){
+            Vector3 a = vertexPosition(vertices, vertexStride, source[t * 3]);
+            Vector3 b = vertexPosition(vertices, vertexStride, source[t * 3 + 1]);
+            Vector3 cc = vertexPosition(vertices, vertexStride, source[t * 3 + 2]);
+            Vector3 n = cross(b - a, cc - a);
+            f32 area = length(n);
+            center = center + (a + b + cc) * (area / 3.0f);
+            normal = normal + n;
+            clusterArea += area;
+        }
+        if(clusterArea > 0) center = center / clusterArea;
+        //the cross product points out of counter clockwise front faces and into clockwise ones
+        if(!frontCounterClockwise) normal = -normal;
+        keys[c] = dot(center - meshCenter, normalOf(normal));
+        order[c] = c;
+    }
+    sortIndicesByKeyDescending(order, keys, 0, (s32)softCount - 1);
+
+    u32 outputIndex = 0;
+    for(u32 i = 0; i < softCount; i++){
+        u32 c = order[i];
+        u32 count = (softStarts[c + 1] - softStarts[c]) * 3;
+        copyMemory(indices + outputIndex, source + softStarts[c] * 3, count * sizeof(u16));
+        outputIndex += count;
+    }
+    scratch->used = scratchMark;
+}
+
+//Renumbers vertices in the order the index buffer first touches them. Unreferenced vertices are dropped.
+//Returns the new vertex count.
+static u32 optimizeVertexFetch(f32* vertices, u32 vertexCount, u32 vertexStride, u16* indices, u32 indexCount, MemoryArena* scratch){
+    u64 scratchMark = scratch->used;
+    u32* remap = pushArray(scratch, u32, vertexCount);
+    f32* source = pushArray(scratch, f32, vertexCount * vertexStride);
+    if(!remap || !source){
+        scratch->used = scratchMark;
+        return vertexCount;
+    }
+    copyMemory(source, vertices, vertexCount * vertexStride * sizeof(f32));
+    setMemory(remap, vertexCount * sizeof(u32), 0xFF);
+
+    u32 nextVertex = 0;
+    for(u32 i = 0; i < indexCount; i++){
+        u32 v = indices[i];
+        if(remap[v] == MAX_U32){
+            remap[v] = nextVertex;
+            copyMemory(vertices + nextVertex * vertexStride, source + v * vertexStride, vertexStride * sizeof(f32));
+            nextVertex++;
+        }
+        indices[i] = (u16)remap[v];
+    }
+    scratch->used = scratchMark;
+    return nextVertex;
+}
+
+//Runs the enabled steps on data about to be passed to createModel3D. vDataSize and iDataSize are in bytes
+//and are updated to the optimized sizes; vertexSize is the vertex stride in bytes. Indices that are not whole
+//triangles of the given vertices leave the data as it is and return false.
+static bool optimizeModel3DData(f32* vData, u32* vDataSize, u16* iData, u32 iDataSize, u32 vertexSize,
+                                MeshOptimizeSettings* settings, MemoryArena* scratch){
+    u32 vertexStride = vertexSize / sizeof(f32);
+    u32 vertexCount = *vDataSize / vertexSize;
+    u32 indexCount = iDataSize / sizeof(u16);
+    if(iDataSize % sizeof(u16) || !areTriangleIndicesValid(iData, indexCount, vertexCount)){
+        return false;
+    }
+
+    if(settings->deduplicate){
+        vertexCount = deduplicateVertices(vData, vertexCount, vertexStride, iData, indexCount, scratch);
+    }
+    if(settings->optimizeVertexCache){
+        optimizeVertexCache(iData, indexCount, vertexCount, settings->cacheSize, scratch);
+    }
+    if(settings->optimizeOverdraw){
+        optimizeOverdraw(iData, indexCount, vData, vertexCount, vertexStride, settings->cacheSize, settings->overdrawThreshold,
+                         settings->frontCounterClockwise, scratch);
+    }
+    if(settings->optimizeVertexFetch){
+        vertexCount = optimizeVertexFetch(vData, vertexCount, vertexStride, iData, indexCount, scratch);
+    }
+    *vDataSize = vertexCount * vertexSize;
+    return true;
+}
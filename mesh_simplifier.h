@@ -0,0 +1,368 @@
+#pragma once
+
+#include "mesh_optimizer.h"
+
+// Quadric error edge collapse simplification (Garland & Heckbert). Vertices are only ever collapsed onto
+// other existing vertices so every LOD shares the vertex buffer of the source model.
+// Vertices that share a position with another vertex (uv/normal seams) are locked and border vertices
+// may only slide along the border.
+
+#define MESH_SIMPLIFIER_BORDER_WEIGHT 10.0f
+#define MESH_SIMPLIFIER_MAX_PASSES 64
+
+#define VERTEX_KIND_INTERIOR 0
+#define VERTEX_KIND_BORDER 1
+#define VERTEX_KIND_LOCKED 2
+
+struct Quadric {
+    f32 a00, a11, a22;
+    f32 a10, a20, a21;
+    f32 b0, b1, b2;
+    f32 c;
+    f32 w;
+};
+
+struct EdgeCollapse {
+    u32 from;
+    u32 to;
+};
+
+struct MeshLodChain {
+    u32 indexOffsets[MODEL3D_MAX_LODS];
+    u32 totalIndices[MODEL3D_MAX_LODS];
+    f32 errors[MODEL3D_MAX_LODS];
+    f32 triangleReductions[MODEL3D_MAX_LODS];
+    u32 totalLods;
+};
+
+static Quadric planeQuadric(Vector3 n, f32 d, f32 w){
+    Quadric q;
+    q.a00 = w * n.x * n.x;
+    q.a11 = w * n.y * n.y;
+    q.a22 = w * n.z * n.z;
+    q.a10 = w * n.y * n.x;
+    q.a20 = w * n.z * n.x;
+    q.a21 = w * n.z * n.y;
+    q.b0 = w * n.x * d;
+    q.b1 = w * n.y * d;
+    q.b2 = w * n.z * d;
+    q.c = w * d * d;
+    q.w = w;
+    return q;
+}
+
+static void addQuadric(Quadric* q, Quadric* r){
+    q->a00 += r->a00;
+    q->a11 += r->a11;
+    q->a22 += r->a22;
+    q->a10 += r->a10;
+    q->a20 += r->a20;
+    q->a21 += r->a21;
+    q->b0 += r->b0;
+    q->b1 += r->b1;
+    q->b2 += r->b2;
+    q->c += r->c;
+    q->w += r->w;
+}
+
+//squared distance, averaged over the planes accumulated in the quadric
+static f32 quadricError(Quadric* q, Vector3 p){
+    f32 ax = q->a00 * p.x + q->a10 * p.y + q->a20 * p.z;
+    f32 ay = q->a10 * p.x + q->a11 * p.y + q->a21 * p.z;
+    f32 az = q->a20 * p.x + q->a21 * p.y + q->a22 * p.z;
+    f32 r = p.x * ax + p.y * ay + p.z * az + 2 * (q->b0 * p.x + q->b1 * p.y + q->b2 * p.z) + q->c;
+    r = absoluteValue(r);
+    return q->w > 0 ? r / q->w : r;
+}
+
+static u64 edgeKey(u32 a, u32 b){
+    return a < b ? ((u64)a << 32) | b : ((u64)b << 32) | a;
+}
+
+static u32 hashEdgeKey(u64 key){
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    return (u32)key;
+}
+
+//empty slots have every bit set
+static u32 findEdgeSlot(u64* keys, u32 tableSize, u64 key){
+    u32 slot = hashEdgeKey(key) & (tableSize - 1);
+    while(keys[slot] != 0xFFFFFFFFFFFFFFFFULL && keys[slot] != key){
+        slot = (slot + 1) & (tableSize - 1);
+    }
+    return slot;
+}
+
+static bool collapseFlipsTriangle(u16* indices, TriangleAdjacency* adjacency, u32* remap, f32* vertices, u32 vertexStride, u32 from, u32 to){
+    Vector3 target = vertexPosition(vertices, vertexStride, to);
+    for(u32 i = 0; i < adjacency->counts[from]; i++){
+        u32 t = adjacency->triangles[adjacency->offsets[from] + i];
+        u32 a = remap[indices[t * 3]];
+        u32 b = remap[indices[t * 3 + 1]];
+        u32 c = remap[indices[t * 3 + 2]];
+        if(a == to || b == to || c == to || a == b || b == c || a == c) continue;
+
+        Vector3 pa = vertexPosition(vertices, vertexStride, a);
+        Vector3 pb = vertexPosition(vertices, vertexStride, b);
+        Vector3 pc = vertexPosition(vertices, vertexStride, c);
+        Vector3 before = cross(pb - pa, pc - pa);
+        if(a == from) pa = target;
+        if(b == from) pb = target;
+        if(c == from) pc = target;
+        Vector3 after = cross(pb - pa, pc - pa);
+        if(dot(before, after) <= 0) return true;
+    }
+    return false;
+}
+
+//Writes a simplified copy of indices to destination (which may alias indices) and returns its index count.
+//Stops once targetIndexCount is reached or the next collapse would exceed targetError (in model units).
+static u32 simplifyMesh(u16* destination, u16* indices, u32 indexCount, f32* vertices, u32 vertexCount, u32 vertexStride,
+                        u32 targetIndexCount, f32 targetError, f32* resultError, MemoryArena* scratch){
+    u64 scratchMark = scratch->used;
+    u32 tableSize = nextPowerOfTwo(indexCount * 2 > vertexCount * 2 ? indexCount * 2 : vertexCount * 2);
+    Quadric* quadrics = pushArray(scratch, Quadric, vertexCount);
+    u32* positionGroups = pushArray(scratch, u32, vertexCount);
+    u8* kinds = pushArray(scratch, u8, vertexCount);
+    u32* remap = pushArray(scratch, u32, vertexCount);
+    u8* touched = pushArray(scratch, u8, vertexCount);
+    u64* edgeKeys = pushArray(scratch, u64, tableSize);
+    u32* edgeCounts = pushArray(scratch, u32, tableSize);
+    u16* current = pushArray(scratch, u16, indexCount);
+    EdgeCollapse* collapses = pushArray(scratch, EdgeCollapse, indexCount);
+    f32* costs = pushArray(scratch, f32, indexCount);
+    u32* order = pushArray(scratch, u32, indexCount);
+    if(!quadrics || !positionGroups || !kinds || !remap || !touched || !edgeKeys || !edgeCounts || !current ||
+       !collapses || !costs || !order){
+        scratch->used = scratchMark;
+        copyMemory(destination, indices, indexCount * sizeof(u16));
+        if(resultError) *resultError = 0;
+        return indexCount;
+    }
+    copyMemory(current, indices, indexCount * sizeof(u16));
+
+    //vertices that share a position form one group, any group with more than one member is a seam
+    setMemory(edgeKeys, tableSize * sizeof(u64), 0xFF);
+    setMemory(kinds, vertexCount, VERTEX_KIND_INTERIOR);
+    for(u32 v = 0; v < vertexCount; v++){
+        f32* p = vertices + v * vertexStride;
+        u32 slot = hashVertex(p, 3) & (tableSize - 1);
+        while(edgeKeys[slot] != 0xFFFFFFFFFFFFFFFFULL && !verticesEqual(vertices + edgeKeys[slot] * vertexStride, p, 3)){
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if(edgeKeys[slot] == 0xFFFFFFFFFFFFFFFFULL){
+            edgeKeys[slot] = v;
+            positionGroups[v] = v;
+        }else{
+            positionGroups[v] = (u32)edgeKeys[slot];
+            kinds[v] = VERTEX_KIND_LOCKED;
+            kinds[edgeKeys[slot]] = VERTEX_KIND_LOCKED;
+        }
+    }
+
+    //border edges are the ones used by exactly one triangle
+    setMemory(edgeKeys, tableSize * sizeof(u64), 0xFF);
+    for(u32 i = 0; i < indexCount; i++){
+        u32 a = positionGroups[current[i]];
+        u32 b = positionGroups[current[i - i % 3 + (i + 1) % 3]];
+        u32 slot = findEdgeSlot(edgeKeys, tableSize, edgeKey(a, b));
+        if(edgeKeys[slot] == 0xFFFFFFFFFFFFFFFFULL){
+            edgeKeys[slot] = edgeKey(a, b);
+            edgeCounts[slot] = 0;
+        }
+        edgeCounts[slot]++;
+    }
+
+    setMemory(quadrics, vertexCount * sizeof(Quadric), 0);
+    for(u32 t = 0; t < indexCount / 3; t++){
+        u32 tv[3] = {current[t * 3], current[t * 3 + 1], current[t * 3 + 2]};
+        Vector3 p0 = vertexPosition(vertices, vertexStride, tv[0]);
+        Vector3 p1 = vertexPosition(vertices, vertexStride, tv[1]);
+        Vector3 p2 = vertexPosition(vertices, vertexStride, tv[2]);
+        Vector3 n = cross(p1 - p0, p2 - p0);
+        f32 area = length(n);
+        if(area == 0) continue;
+        n = n / area;
+        Quadric q = planeQuadric(n, -dot(n, p0), area);
+        for(u32 j = 0; j < 3; j++){
+            addQuadric(&quadrics[tv[j]], &q);
+        }
+
+        for(u32 j = 0; j < 3; j++){
+            u32 a = tv[j];
+            u32 b = tv[(j + 1) % 3];
+            u32 slot = findEdgeSlot(edgeKeys, tableSize, edgeKey(positionGroups[a], positionGroups[b]));
+            if(edgeCounts[slot] != 1) continue;
+            Vector3 pa = vertexPosition(vertices, vertexStride, a);
+            Vector3 pb = vertexPosition(vertices, vertexStride, b);
+            Vector3 edge = pb - pa;
+            f32 edgeLength = length(edge);
+            Vector3 bn = normalOf(cross(edge, n));
+            Quadric bq = planeQuadric(bn, -dot(bn, pa), edgeLength * edgeLength * MESH_SIMPLIFIER_BORDER_WEIGHT);
+            addQuadric(&quadrics[a], &bq);
+            addQuadric(&quadrics[b], &bq);
+            if(kinds[a] == VERTEX_KIND_INTERIOR) kinds[a] = VERTEX_KIND_BORDER;
+            if(kinds[b] == VERTEX_KIND_INTERIOR) kinds[b] = VERTEX_KIND_BORDER;
+        }
+    }
+
+    f32 maxError = 0;
+    f32 targetErrorSquared = targetError * targetError;
+    u32 currentCount = indexCount;
+    for(u32 pass = 0; pass < MESH_SIMPLIFIER_MAX_PASSES && currentCount > targetIndexCount; pass++){
+        u64 passMark = scratch->used;
+        TriangleAdjacency adjacency;
+        if(!buildTriangleAdjacency(&adjacency, current, currentCount, vertexCount, scratch)){
+            break;
+        }
+
+        u32 collapseCount = 0;
+        for(u32 i = 0; i < currentCount; i++){
+            u32 a = current[i];
+            u32 b = current[i - i % 3 + (i + 1) % 3];
+            bool borderEdge = edgeCounts[findEdgeSlot(edgeKeys, tableSize, edgeKey(positionGroups[a], positionGroups[b]))] == 1;
+            f32 bestCost = MAX_F32;
+            EdgeCollapse best = {};
+            for(u32 d = 0; d < 2; d++){
+                u32 from = d ? b : a;
+                u32 to = d ? a : b;
+                if(kinds[from] == VERTEX_KIND_LOCKED) continue;
+                if(kinds[from] == VERTEX_KIND_BORDER && !borderEdge) continue;
+                Quadric q = quadrics[from];
+                addQuadric(&q, &quadrics[to]);
+                f32 cost = quadricError(&q, vertexPosition(vertices, vertexStride, to));
+                if(cost < bestCost){
+                    bestCost = cost;
+                    best.from = from;
+                    best.to = to;
+                }
+            }
+            if(bestCost < MAX_F32){
+                collapses[collapseCount] = best;
+                costs[collapseCount] = -bestCost;
+                order[collapseCount] = collapseCount;
+                collapseCount++;
+            }
+        }
+        if(collapseCount == 0){
+            scratch->used = passMark;
+            break;
+        }
+        sortIndicesByKeyDescending(order, costs, 0, (s32)collapseCount - 1);
+
+        for(u32 v = 0; v < vertexCount; v++){
+            remap[v] = v;
+        }
+        setMemory(touched, vertexCount, 0);
+
+        //every interior collapse removes roughly two triangles
+        u32 trianglesToRemove = (currentCount - targetIndexCount) / 3;
+        u32 removed = 0;
+        u32 applied = 0;
+        for(u32 i = 0; i < collapseCount && removed < trianglesToRemove; i++){
+            EdgeCollapse* c = &collapses[order[i]];
+            f32 cost = -costs[order[i]];
+            if(cost > targetErrorSquared) break;
+            if(touched[c->from] || touched[c->to]) continue;
+            if(collapseFlipsTriangle(current, &adjacency, remap, vertices, vertexStride, c->from, c->to)) continue;
+
+            remap[c->from] = c->to;
+            addQuadric(&quadrics[c->to], &quadrics[c->from]);
+            touched[c->from] = 1;
+            touched[c->to] = 1;
+            removed += kinds[c->from] == VERTEX_KIND_BORDER ? 1 : 2;
+            if(cost > maxError) maxError = cost;
+            applied++;
+        }
+        scratch->used = passMark;
+        if(applied == 0){
+            break;
+        }
+
+        u32 writeCount = 0;
+        for(u32 t = 0; t < currentCount / 3; t++){
+            u32 a = remap[current[t * 3]];
+            u32 b = remap[current[t * 3 + 1]];
+            u32 c = remap[current[t * 3 + 2]];
+            if(a == b || b == c || a == c) continue;
+            current[writeCount++] = (u16)a;
+            current[writeCount++] = (u16)b;
+            current[writeCount++] = (u16)c;
+        }
+        currentCount = writeCount;
+    }
+
+    copyMemory(destination, current, currentCount * sizeof(u16));
+    if(resultError) *resultError = (f32)sqrt(maxError);
+    scratch->used = scratchMark;
+    return currentCount;
+}
+
+//Appends LODs 1..lodCount-1 after the source indices in iData, up to indexCapacity indices. Each level
+//targets reductionPerLevel of the previous level's triangles. Returns the total index count.
+static u32 generateLodChain(u16* iData, u32 indexCount, u32 indexCapacity, f32* vertices, u32 vertexCount, u32 vertexStride,
+                            u32 lodCount, f32 reductionPerLevel, f32 maxError, MeshLodChain* chain, MemoryArena* scratch){
+    if(lodCount > MODEL3D_MAX_LODS) lodCount = MODEL3D_MAX_LODS;
+    chain->indexOffsets[0] = 0;
+    chain->totalIndices[0] = indexCount;
+    chain->errors[0] = 0;
+    chain->triangleReductions[0] = 0;
+    chain->totalLods = 1;
+
+    u64 scratchMark = scratch->used;
+    u16* lodIndices = pushArray(scratch, u16, indexCount);
+    if(!lodIndices){
+        return indexCount;
+    }
+
+    u32 totalIndices = indexCount;
+    u32 targetCount = indexCount;
+    for(u32 lod = 1; lod < lodCount; lod++){
+        targetCount = (u32)(targetCount * reductionPerLevel) / 3 * 3;
+        if(targetCount < 3) break;
+
+        f32 error = 0;
+        u32 lodIndexCount = simplifyMesh(lodIndices, iData, indexCount, vertices, vertexCount, vertexStride,
+                                         targetCount, maxError, &error, scratch);
+        if(lodIndexCount >= chain->totalIndices[lod - 1] || totalIndices + lodIndexCount > indexCapacity) break;
+
+        copyMemory(iData + totalIndices, lodIndices, lodIndexCount * sizeof(u16));
+        chain->indexOffsets[lod] = totalIndices;
+        chain->totalIndices[lod] = lodIndexCount;
+        chain->errors[lod] = error > chain->errors[lod - 1] ? error : chain->errors[lod - 1];
+        chain->triangleReductions[lod] = 1.0f - (f32)lodIndexCount / (f32)indexCount;
+        chain->totalLods++;
+        totalIndices += lodIndexCount;
+    }
+    scratch->used = scratchMark;
+    return totalIndices;
+}
+
+static void setModel3DLodChain(Model3D* model, MeshLodChain* chain){
+    model->totalLods = chain->totalLods;
+    for(u32 i = 0; i < chain->totalLods; i++){
+        model->lodIndexOffsets[i] = model->indexOffset + chain->indexOffsets[i];
+        model->lodTotalIndices[i] = chain->totalIndices[i];
+        model->lodErrors[i] = chain->errors[i];
+    }
+}
+
+//Picks the coarsest LOD whose geometric error projects to at most pixelThreshold pixels on screen.
+static u32 selectModel3DLod(Model3D* model, Camera* camera, f32 viewportHeight, f32 pixelThreshold){
+    f32 distance = length(model->position - camera->position);
+    f32 scale = model->scale.x;
+    if(model->scale.y > scale) scale = model->scale.y;
+    if(model->scale.z > scale) scale = model->scale.z;
+    f32 projectionScale = camera->projection.m2[1][1] * 0.5f * viewportHeight;
+
+    u32 lod = 0;
+    for(u32 i = 1; i < model->totalLods; i++){
+        if(distance <= 0) break;
+        f32 pixelError = model->lodErrors[i] * scale * projectionScale / distance;
+        if(pixelError > pixelThreshold) break;
+        lod = i;
+    }
+    return lod;
+}
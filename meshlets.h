@@ -0,0 +1,344 @@
+#pragma once
+
+#include "mesh_optimizer.h"
+
+// Splits Model3D geometry into meshlets of at most 64 vertices and 124 triangles. Meshlet vertices index the
+// model's vertex buffer and meshlet triangles use 8 bit indices into the meshlet's vertex list.
+// Front faces wind the way the pipeline drawing the model says, RenderPipelineDesc::frontCounterClockwise, which is
+// passed to buildMeshlets so the normal cones point out of the faces the rasterizer keeps.
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+#define MESHLET_DATA_MAGIC 0x4C48534D
+
+struct Meshlet {
+    u32 vertexOffset;
+    u32 triangleOffset;
+    u32 vertexCount;
+    u32 triangleCount;
+};
+
+struct MeshletBounds {
+    f32 center[3];
+    f32 radius;
+    f32 coneAxis[3];
+    f32 coneCutoff;
+};
+
+struct MeshletData {
+    Meshlet* meshlets;
+    MeshletBounds* bounds;
+    u16* vertices;
+    u8* triangles;
+    u32 totalMeshlets;
+    u32 totalVertices;
+    u32 totalTriangles;
+};
+
+struct MeshletDataHeader {
+    u32 magic;
+    u32 totalMeshlets;
+    u32 totalVertices;
+    u32 totalTriangles;
+};
+
+struct MeshletCullStatistics {
+    u32 tested;
+    u32 frustumCulled;
+    u32 backfaceCulled;
+    u32 visible;
+};
+
+static u32 meshletCountBound(u32 indexCount){
+    u32 byTriangles = (indexCount / 3 + MESHLET_MAX_TRIANGLES - 1) / MESHLET_MAX_TRIANGLES;
+    u32 byVertices = (indexCount + MESHLET_MAX_VERTICES - 3) / (MESHLET_MAX_VERTICES - 2);
+    return byTriangles > byVertices ? byTriangles : byVertices;
+}
+
+static MeshletBounds computeMeshletBounds(MeshletData* data, Meshlet* meshlet, f32* vertices, u32 vertexStride,
+                                          bool frontCounterClockwise){
+    MeshletBounds bounds = {};
+    u16* meshletVertices = data->vertices + meshlet->vertexOffset;
+    u8* meshletTriangles = data->triangles + meshlet->triangleOffset * 3;
+
+    //Ritter's bounding sphere: start from the two points furthest apart along the widest axis, then grow
+    Vector3 minPoints[3];
+    Vector3 maxPoints[3];
+    for(u32 axis = 0; axis < 3; axis++){
+        minPoints[axis] = vertexPosition(vertices, vertexStride, meshletVertices[0]);
+        maxPoints[axis] = minPoints[axis];
+    }
+    for(u32 i = 1; i < meshlet->vertexCount; i++){
+        Vector3 p = vertexPosition(vertices, vertexStride, meshletVertices[i]);
+        for(u32 axis = 0; axis < 3; axis++){
+            if(p.va[axis] < minPoints[axis].va[axis]) minPoints[axis] = p;
+            if(p.va[axis] > maxPoints[axis].va[axis]) maxPoints[axis] = p;
+        }
+    }
+    u32 widestAxis = 0;
+    f32 widest = 0;
+    for(u32 axis = 0; axis < 3; axis++){
+        Vector3 d = maxPoints[axis] - minPoints[axis];
+        f32 distanceSquared = dot(d, d);
+        if(distanceSquared > widest){
+            widest = distanceSquared;
+            widestAxis = axis;
+        }
+    }
+    Vector3 center = (minPoints[widestAxis] + maxPoints[widestAxis]) * 0.5f;
+    f32 radius = (f32)sqrt(widest) * 0.5f;
+    for(u32 i = 0; i < meshlet->vertexCount; i++){
+        Vector3 p = vertexPosition(vertices, vertexStride, meshletVertices[i]);
+        f32 distance = length(p - center);
+        if(distance > radius){
+            f32 newRadius = (radius + distance) * 0.5f;
+            center = center + (p - center) * ((newRadius - radius) / distance);
+            radius = newRadius;
+        }
+    }
+
+    Vector3 axis(0);
+    Vector3 normals[MESHLET_MAX_TRIANGLES];
+    u32 normalCount = 0;
+    for(u32 t = 0; t < meshlet->triangleCount; t++){
+        Vector3 a = vertexPosition(vertices, vertexStride, meshletVertices[meshletTriangles[t * 3]]);
+        Vector3 b = vertexPosition(vertices, vertexStride, meshletVertices[meshletTriangles[t * 3 + 1]]);
+        Vector3 c = vertexPosition(vertices, vertexStride, meshletVertices[meshletTriangles[t * 3 + 2]]);
+        //the cross product points out of counter clockwise front faces and into clockwise ones
+        Vector3 n = frontCounterClockwise ? cross(b - a, c - a) : cross(c - a, b - a);
+        if(length(n) == 0) continue;
+        normals[normalCount] = normalOf(n);
+        axis = axis + normals[normalCount];
+        normalCount++;
+    }
+    axis = normalOf(axis);
+    f32 minDot = 1;
+    for(u32 i = 0; i < normalCount; i++){
+        f32 d = dot(normals[i], axis);
+        if(d < minDot) minDot = d;
+    }
+
+    bounds.center[0] = center.x;
+    bounds.center[1] = center.y;
+    bounds.center[2] = center.z;
+    bounds.radius = radius;
+    bounds.coneAxis[0] = axis.x;
+    bounds.coneAxis[1] = axis.y;
+    bounds.coneAxis[2] = axis.z;
+    //the cone test culls when the view direction is within 90 degrees minus the cone angle of the axis
+    bounds.coneCutoff = (normalCount == 0 || minDot <= 0) ? 1 : (f32)sqrt(1 - minDot * minDot);
+    return bounds;
+}
+
+static void finishMeshlet(MeshletData* data, Meshlet* meshlet, u8* localIndices, f32* vertices, u32 vertexStride,
+                          bool frontCounterClockwise){
+    data->bounds[data->totalMeshlets] = computeMeshletBounds(data, meshlet, vertices, vertexStride,
+                                                             frontCounterClockwise);
+    data->meshlets[data->totalMeshlets++] = *meshlet;
+    data->totalVertices += meshlet->vertexCount;
+    data->totalTriangles += meshlet->triangleCount;
+    for(u32 i = 0; i < meshlet->vertexCount; i++){
+        localIndices[data->vertices[meshlet->vertexOffset + i]] = 0xFF;
+    }
+    meshlet->vertexOffset = data->totalVertices;
+    meshlet->triangleOffset = data->totalTriangles;
+    meshlet->vertexCount = 0;
+    meshlet->triangleCount = 0;
+}
+
+//Meshlet arrays are allocated from arena and stay valid as long as it does. Triangles are grown greedily across
+//shared vertices so meshlets stay spatially compact; running optimizeVertexCache first improves the seeds.
+static bool buildMeshlets(MeshletData* data, u16* indices, u32 indexCount, f32* vertices, u32 vertexCount, u32 vertexStride,
+                          bool frontCounterClockwise, MemoryArena* arena, MemoryArena* scratch){
+    u32 maxMeshlets = meshletCountBound(indexCount);
+    data->meshlets = pushArray(arena, Meshlet, maxMeshlets);
+    data->bounds = pushArray(arena, MeshletBounds, maxMeshlets);
+    data->vertices = pushArray(arena, u16, indexCount);
+    data->triangles = pushArray(arena, u8, indexCount);
+    data->totalMeshlets = 0;
+    data->totalVertices = 0;
+    data->totalTriangles = 0;
+    if(!data->meshlets || !data->bounds || !data->vertices || !data->triangles){
+        return false;
+    }
+
+    u64 scratchMark = scratch->used;
+    u32 triangleCount = indexCount / 3;
+    TriangleAdjacency adjacency;
+    u8* localIndices = pushArray(scratch, u8, vertexCount);
+    u8* emitted = pushArray(scratch, u8, triangleCount);
+    if(!localIndices || !emitted || !buildTriangleAdjacency(&adjacency, indices, indexCount, vertexCount, scratch)){
+        scratch->used = scratchMark;
+        return false;
+    }
+    setMemory(localIndices, vertexCount, 0xFF);
+    setMemory(emitted, triangleCount, 0);
+
+    Meshlet meshlet = {};
+    u32 cursor = 0;
+    u32 remaining = triangleCount;
+    while(remaining > 0){
+        s32 best = -1;
+        u32 bestExtra = 4;
+        for(u32 i = 0; i < meshlet.vertexCount && bestExtra > 0; i++){
+            u32 v = data->vertices[meshlet.vertexOffset + i];
+            for(u32 j = 0; j < adjacency.counts[v]; j++){
+                u32 t = adjacency.triangles[adjacency.offsets[v] + j];
+                if(emitted[t]) continue;
+                u32 extra = (localIndices[indices[t * 3]] == 0xFF) + (localIndices[indices[t * 3 + 1]] == 0xFF) +
+                            (localIndices[indices[t * 3 + 2]] == 0xFF);
+                if(extra < bestExtra && meshlet.vertexCount + extra <= MESHLET_MAX_VERTICES){
+                    bestExtra = extra;
+                    best = (s32)t;
+                    if(extra == 0) break;
+                }
+            }
+        }
+
+        if(best < 0){
+            while(emitted[cursor]) cursor++;
+            best = (s32)cursor;
+            bestExtra = (localIndices[indices[best * 3]] == 0xFF) + (localIndices[indices[best * 3 + 1]] == 0xFF) +
+                        (localIndices[indices[best * 3 + 2]] == 0xFF);
+        }
+
+        if(meshlet.vertexCount + bestExtra > MESHLET_MAX_VERTICES || meshlet.triangleCount == MESHLET_MAX_TRIANGLES){
+            finishMeshlet(data, &meshlet, localIndices, vertices, vertexStride, frontCounterClockwise);
+            //the chosen triangle seeds the next meshlet, adjacent to the old one unless it came from the cursor
+        }
+
+        for(u32 j = 0; j < 3; j++){
+            u32 v = indices[best * 3 + j];
+            if(localIndices[v] == 0xFF){
+                localIndices[v] = (u8)meshlet.vertexCount;
+                data->vertices[meshlet.vertexOffset + meshlet.vertexCount++] = (u16)v;
+            }
+            data->triangles[(meshlet.triangleOffset + meshlet.triangleCount) * 3 + j] = localIndices[v];
+        }
+        meshlet.triangleCount++;
+        emitted[best] = 1;
+        remaining--;
+    }
+    if(meshlet.triangleCount > 0){
+        finishMeshlet(data, &meshlet, localIndices, vertices, vertexStride, frontCounterClockwise);
+    }
+
+    scratch->used = scratchMark;
+    return true;
+}
+
+static void extractFrustumPlanes(Matrix4* viewProjection, Vector4* planes){
+    Matrix4* m = viewProjection;
+    Vector4 row0(m->m2[0][0], m->m2[1][0], m->m2[2][0], m->m2[3][0]);
+    Vector4 row1(m->m2[0][1], m->m2[1][1], m->m2[2][1], m->m2[3][1]);
+    Vector4 row2(m->m2[0][2], m->m2[1][2], m->m2[2][2], m->m2[3][2]);
+    Vector4 row3(m->m2[0][3], m->m2[1][3], m->m2[2][3], m->m2[3][3]);
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+    for(u32 i = 0; i < 6; i++){
+        f32 len = length(Vector3(planes[i].x, planes[i].y, planes[i].z));
+        if(len > 0) planes[i] = planes[i] / len;
+    }
+}
+
+//Writes the indices of meshlets that survive frustum and backface cone culling for one instance of the model.
+//camera->view is expected to already include the projection, as set by Camera::updateCameraView.
+static u32 cullMeshlets(MeshletData* data, Model3D* model, Camera* camera, u32* visibleMeshlets, MeshletCullStatistics* stats = 0){
+    Vector4 planes[6];
+    extractFrustumPlanes(&camera->view, planes);
+    Matrix4 modelMatrix = buildModelMatrix(model->position, model->scale, model->orientation);
+    Matrix4 rotation = quaternionToMatrix4(model->orientation);
+    f32 scale = model->scale.x;
+    if(model->scale.y > scale) scale = model->scale.y;
+    if(model->scale.z > scale) scale = model->scale.z;
+
+    u32 visibleCount = 0;
+    for(u32 i = 0; i < data->totalMeshlets; i++){
+        MeshletBounds* b = &data->bounds[i];
+        Vector4 center = modelMatrix.v[0] * b->center[0] + modelMatrix.v[1] * b->center[1] + modelMatrix.v[2] * b->center[2] + modelMatrix.v[3];
+        center.w = 1;
+        f32 radius = b->radius * scale;
+        if(stats) stats->tested++;
+
+        bool outside = false;
+        for(u32 p = 0; p < 6; p++){
+            if(dot(planes[p], center) < -radius){
+                outside = true;
+                break;
+            }
+        }
+        if(outside){
+            if(stats) stats->frustumCulled++;
+            continue;
+        }
+
+        if(b->coneCutoff < 1){
+            Vector4 axis = rotation.v[0] * b->coneAxis[0] + rotation.v[1] * b->coneAxis[1] + rotation.v[2] * b->coneAxis[2];
+            Vector3 coneAxis(axis.x, axis.y, axis.z);
+            Vector3 toCenter = Vector3(center.x, center.y, center.z) - camera->position;
+            if(dot(toCenter, coneAxis) >= b->coneCutoff * length(toCenter) + radius){
+                if(stats) stats->backfaceCulled++;
+                continue;
+            }
+        }
+
+        visibleMeshlets[visibleCount++] = i;
+    }
+    if(stats) stats->visible += visibleCount;
+    return visibleCount;
+}
+
+//u64 so that the counts of a corrupt header can't wrap the size under the buffer size
+static u64 getMeshletDataSize(MeshletData* data){
+    return sizeof(MeshletDataHeader) + (u64)data->totalMeshlets * (sizeof(Meshlet) + sizeof(MeshletBounds)) +
+           (((u64)data->totalVertices * sizeof(u16) + 3) & ~(u64)3) + (u64)data->totalTriangles * 3;
+}
+
+//Serialized layout: header, meshlets, bounds, vertices (padded to 4 bytes), triangles.
+static u32 serializeMeshletData(MeshletData* data, void* buffer, u32 bufferSize){
+    u64 size = getMeshletDataSize(data);
+    if(size > bufferSize){
+        return 0;
+    }
+    MeshletDataHeader* header = (MeshletDataHeader*)buffer;
+    header->magic = MESHLET_DATA_MAGIC;
+    header->totalMeshlets = data->totalMeshlets;
+    header->totalVertices = data->totalVertices;
+    header->totalTriangles = data->totalTriangles;
+    u8* p = (u8*)(header + 1);
+    copyMemory(p, data->meshlets, data->totalMeshlets * sizeof(Meshlet));
+    p += data->totalMeshlets * sizeof(Meshlet);
+    copyMemory(p, data->bounds, data->totalMeshlets * sizeof(MeshletBounds));
+    p += data->totalMeshlets * sizeof(MeshletBounds);
+    copyMemory(p, data->vertices, data->totalVertices * sizeof(u16));
+    p += (data->totalVertices * sizeof(u16) + 3) & ~3;
+    copyMemory(p, data->triangles, data->totalTriangles * 3);
+    return (u32)size;
+}
+
+//Points data into buffer without copying, so buffer has to outlive it.
+static bool loadMeshletData(void* buffer, u32 bufferSize, MeshletData* data){
+    MeshletDataHeader* header = (MeshletDataHeader*)buffer;
+    if(bufferSize < sizeof(MeshletDataHeader) || header->magic != MESHLET_DATA_MAGIC){
+        return false;
+    }
+    data->totalMeshlets = header->totalMeshlets;
+    data->totalVertices = header->totalVertices;
+    data->totalTriangles = header->totalTriangles;
+    if(getMeshletDataSize(data) > bufferSize){
+        return false;
+    }
+    u8* p = (u8*)(header + 1);
+    data->meshlets = (Meshlet*)p;
+    p += data->totalMeshlets * sizeof(Meshlet);
+    data->bounds = (MeshletBounds*)p;
+    p += data->totalMeshlets * sizeof(MeshletBounds);
+    data->vertices = (u16*)p;
+    p += (data->totalVertices * sizeof(u16) + 3) & ~3;
+    data->triangles = p;
+    return true;
+}
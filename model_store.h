@@ -0,0 +1,458 @@
+#pragma once
+
+#include "upload_scheduler.h"
+#include "mesh_simplifier.h"
+#include "vertex_quantization.h"
+
+//Model store.
+//Keeps Model3D geometry in two GpuBufferPools, vertices in one and indices in the other, whose chunks are default heap
+//buffers created through the backend, so many models share a few buffers. createStoredModel3D copies the data it is
+//given, allocates the model's ranges and requests their uploads on the upload scheduler, so the caller may free its
+//data on return; the platform layers' createModel3D hooks are this call. Models with 16 bit indices are run through
+//optimizeModel3DData with the store's optimize settings on the copies before their ranges are allocated, so the ranges
+//are sized for the optimized data, and get a LOD chain appended after their indices in the same range, every level
+//drawing from the model's vertices; 32 bit models are stored as given, with the one level. With quantize set every
+//model in Model3D vertex layout is stored in the quantized format instead, half the size, for pipelines with the input
+//layout getQuantizedVertexAttributes gives, and bindStoredModel3D passes its bounds as graphics constants 0 to 7. A model is drawn from views
+//of its ranges once waitForStoredModel says its upload is on the way, at the level selectModel3DLod picks.
+//destroyStoredModel3D retires the ranges instead of freeing them. Retired ranges are chained through their allocation
+//ids, endModelStoreFrame tags the frame's chain with the fence value the frame will signal, and beginModelStoreFrame
+//gives back every chain the fence has reached whose uploads are done, so a range is never rewritten while a frame in
+//flight reads it or a copy is still headed for it. Chunks are only released empty, by allocateGpuBuffer when a fresh
+//chunk cannot hold the request, and the store never defragments, so a chunk is destroyed right away.
+//Model3D::vertexSize is the vertex stride in bytes and indexSize the size of an index, 2 or 4. indexOffset and
+//vertexOffset count from the start of the model's ranges. Everything here is for the main thread, apart from
+//getStoredModelBuffers and the bind and draw calls, which only read and may record on any thread.
+
+#define MODEL_STORE_MAX_FRAMES 16
+#define MODEL_STORE_VERTICES 0
+#define MODEL_STORE_INDICES 1
+#define MODEL_STORE_TOTAL_POOLS 2
+#define MODEL_STORE_VERTEX_ALIGNMENT 16
+#define MODEL_STORE_INDEX_ALIGNMENT 16
+#define MODEL_STORE_DEFAULT_LODS MODEL3D_MAX_LODS
+//each level keeps this much of the previous level's triangles, so the whole chain fits in twice the source indices
+#define MODEL_STORE_LOD_REDUCTION 0.5f
+
+struct ModelStorePool {
+    GpuBufferPool pool;
+    RenderBackend* backend;
+    RenderResource chunks[GPU_BUFFER_POOL_MAX_CHUNKS];
+    //the next retired allocation after each retired allocation id
+    u32* nextRetired;
+    u32 retiredHead;
+};
+
+struct ModelStoreFrame {
+    u64 fenceValue;
+    u64 uploadTicket;
+    u32 firstRetired[MODEL_STORE_TOTAL_POOLS];
+};
+
+struct ModelStoreStats {
+    u64 models;
+    u64 uploadedBytes;
+    u64 retiredModels;
+    u64 failedModels;
+    u64 sourceFlushes;
+};
+
+struct ModelStore {
+    RenderBackend* backend;
+    UploadScheduler* uploads;
+    ModelStorePool pools[MODEL_STORE_TOTAL_POOLS];
+
+    //copies of data waiting for its upload, emptied once the newest upload is done
+    MemoryArena sources;
+    //for the optimizer, a model too big for it is stored unoptimized
+    MemoryArena scratch;
+    MeshOptimizeSettings optimize;
+    //levels generated per model, counting the model as given, 1 for none
+    u32 totalLods;
+    //needs the scratch arena
+    bool quantize;
+    u64 lastTicket;
+    //the newest upload of a model retired this frame
+    u64 retiredTicket;
+
+    ModelStoreFrame frames[MODEL_STORE_MAX_FRAMES];
+    u32 firstFrame;
+    u32 totalFrames;
+
+    ModelStoreStats stats;
+};
+
+static void* createModelStoreChunk(u64 size, void* userData){
+    ModelStorePool* pool = (ModelStorePool*)userData;
+    for(u32 i = 0; i < GPU_BUFFER_POOL_MAX_CHUNKS; i++){
+        RenderResource* chunk = &pool->chunks[i];
+        if(chunk->handle){
+            continue;
+        }
+        if(!pool->backend->createBuffer(pool->backend, size, RENDER_HEAP_DEFAULT, RENDER_STATE_COMMON, chunk)){
+            chunk->handle = 0;
+            return 0;
+        }
+        return chunk;
+    }
+    return 0;
+}
+
+static void destroyModelStoreChunk(void* chunk, void* userData){
+    ModelStorePool* pool = (ModelStorePool*)userData;
+    pool->backend->destroyResource(pool->backend, (RenderResource*)chunk);
+    ((RenderResource*)chunk)->handle = 0;
+}
+
+static bool initializeModelStorePool(ModelStorePool* pool, RenderBackend* backend, u64 chunkSize, u32 maxAllocations,
+                                     MemoryArena* arena){
+    setMemory(pool, sizeof(ModelStorePool));
+    pool->backend = backend;
+    pool->retiredHead = GPU_ALLOCATION_INVALID;
+    pool->nextRetired = pushArray(arena, u32, maxAllocations);
+    if(!pool->nextRetired || !initializeGpuBufferPool(&pool->pool, chunkSize, maxAllocations, arena)){
+        return false;
+    }
+    pool->pool.createChunk = createModelStoreChunk;
+    pool->pool.destroyChunk = destroyModelStoreChunk;
+    pool->pool.userData = pool;
+    return true;
+}
+
+//maxModels bounds the live and retired models together, sourceSize the data waiting to be uploaded at once and
+//scratchSize the optimizer's working memory, 0 to store models as given
+static bool initializeModelStore(ModelStore* store, RenderBackend* backend, UploadScheduler* uploads,
+                                 u64 vertexChunkSize, u64 indexChunkSize, u32 maxModels, u32 sourceSize,
+                                 u32 scratchSize, MemoryArena* arena){
+    setMemory(store, sizeof(ModelStore));
+    store->backend = backend;
+    store->uploads = uploads;
+    store->optimize = defaultMeshOptimizeSettings();
+    store->totalLods = MODEL_STORE_DEFAULT_LODS;
+    void* sources = pushSize(arena, sourceSize);
+    void* scratch = scratchSize ? pushSize(arena, scratchSize) : 0;
+    if(!sources || (scratchSize && !scratch)){
+        return false;
+    }
+    store->sources = createMemoryArena(sources, sourceSize);
+    store->scratch = createMemoryArena(scratch, scratchSize);
+    return initializeModelStorePool(&store->pools[MODEL_STORE_VERTICES], backend, vertexChunkSize, maxModels, arena) &&
+           initializeModelStorePool(&store->pools[MODEL_STORE_INDICES], backend, indexChunkSize, maxModels, arena);
+}
+
+//A copy of data that lives until its upload is done, making room by finishing every upload when the copies fill up.
+//capacity is what the copy may grow to, at least size.
+static void* pushModelStoreSource(ModelStore* store, void* data, u32 size, u32 capacity){
+    u8* source = (u8*)pushSize(&store->sources, capacity);
+    if(!source && capacity <= store->sources.size){
+        flushUploadScheduler(store->uploads);
+        store->sources.used = 0;
+        store->stats.sourceFlushes++;
+        source = (u8*)pushSize(&store->sources, capacity);
+    }
+    if(source){
+        copyMemory(source, data, size);
+    }
+    return source;
+}
+
+//the allocation's bytes of its chunk, as a view setVertexBuffer and setIndexBuffer take
+static RenderResource getModelStoreRange(ModelStorePool* pool, u32 allocation){
+    GpuAllocationRecord* record = getGpuAllocation(&pool->pool, allocation);
+    RenderResource range = *(RenderResource*)getGpuAllocationChunk(&pool->pool, allocation);
+    range.gpuAddress += record->offset;
+    range.size = record->size;
+    return range;
+}
+
+//the queue a full scheduler leaves no room in is emptied once before giving up
+static u64 requestModelStoreUpload(ModelStore* store, ModelStorePool* pool, u32 allocation, void* data, u32 size){
+    GpuAllocationRecord* record = getGpuAllocation(&pool->pool, allocation);
+    RenderResource* chunk = (RenderResource*)getGpuAllocationChunk(&pool->pool, allocation);
+    u64 ticket = requestUpload(store->uploads, chunk, record->offset, data, size);
+    if(ticket == UPLOAD_TICKET_NONE){
+        flushUploadScheduler(store->uploads);
+        ticket = requestUpload(store->uploads, chunk, record->offset, data, size);
+    }
+    return ticket;
+}
+
+//Rewrites the float vertices in source in the quantized format, through scratch since the kernels read and write
+//strided streams that would overlap in place. false when scratch cannot hold them.
+static bool quantizeModelStoreVertices(ModelStore* store, f32* source, u32* size, Model3D* model){
+    VertexAttributeLayout layout = getModel3DVertexLayout();
+    u32 vertexCount = *size / MODEL3D_VERTEX_SIZE;
+    u32 quantizedSize = vertexCount * getQuantizedVertexSize(&layout);
+    u64 scratchMark = store->scratch.used;
+    u8* quantized = (u8*)pushSize(&store->scratch, quantizedSize);
+    if(!quantized){
+        return false;
+    }
+    QuantizationBounds bounds = computeQuantizationBounds(source, vertexCount, MODEL3D_VERTEX_SIZE);
+    quantizeVertices(source, vertexCount, &layout, &bounds, quantized);
+    copyMemory(source, quantized, quantizedSize);
+    store->scratch.used = scratchMark;
+    *size = quantizedSize;
+    model->vertexSize = getQuantizedVertexSize(&layout);
+    model->positionMin = Vector4(bounds.min[0], bounds.min[1], bounds.min[2], 0);
+    model->positionExtent = Vector4(bounds.extent[0], bounds.extent[1], bounds.extent[2], 0);
+    return true;
+}
+
+//A model whose indices are not whole triangles or name a vertex it does not have is refused, the optimizer and the
+//simplifier would read and write past their scratch arrays for it.
+static bool areModelStoreIndicesValid(void* iData, u32 iDataSize, u32 indexSize, u32 vertexCount){
+    if(iDataSize % indexSize){
+        return false;
+    }
+    if(indexSize == sizeof(u16)){
+        return areTriangleIndicesValid((u16*)iData, iDataSize / sizeof(u16), vertexCount);
+    }
+    u32* indices = (u32*)iData;
+    u32 indexCount = iDataSize / sizeof(u32);
+    for(u32 i = 0; i < indexCount; i++){
+        if(indices[i] >= vertexCount){
+            return false;
+        }
+    }
+    return indexCount % 3 == 0;
+}
+
+//Returns a model with vertexAllocation GPU_ALLOCATION_INVALID when the pools or the upload queue have no room, or the
+//data is malformed.
+//vDataSize and iDataSize are in bytes, vertexSize is the vertex stride in bytes and indexSize 2 or 4.
+static Model3D createStoredModel3D(ModelStore* store, f32* vData, u32 vDataSize, void* iData, u32 iDataSize,
+                                   u32 vertexSize, u32 indexSize){
+    Model3D model;
+    setMemory(&model, sizeof(Model3D));
+    model.scale = Vector3(1);
+    model.orientation = Quaternion();
+    model.vertexSize = vertexSize;
+    model.indexSize = indexSize;
+    model.vertexAllocation = GPU_ALLOCATION_INVALID;
+    model.indexAllocation = GPU_ALLOCATION_INVALID;
+    ModelStorePool* vertices = &store->pools[MODEL_STORE_VERTICES];
+    ModelStorePool* indices = &store->pools[MODEL_STORE_INDICES];
+    bool optimize = indexSize == sizeof(u16) && store->scratch.size;
+    u32 indexCapacity = optimize && store->totalLods > 1 ? iDataSize * 2 : iDataSize;
+    //The copies have to fit side by side in an empty sources arena. A model that only fits one at a time would have
+    //the index push flush the vertices away and the vertices pushed again land on the indices.
+    bool accepted = vDataSize && iDataSize &&
+                (u64)((vDataSize + 15) & ~15u) + ((indexCapacity + 15) & ~15u) <= store->sources.size &&
+                areModelStoreIndicesValid(iData, iDataSize, indexSize, vDataSize / vertexSize);
+    void* vertexSource = accepted ? pushModelStoreSource(store, vData, vDataSize, vDataSize) : 0;
+    void* indexSource = vertexSource ? pushModelStoreSource(store, iData, iDataSize, indexCapacity) : 0;
+    //the flush that made room for the indices may have emptied the copies under the vertices
+    if(indexSource && indexSource < vertexSource){
+        vertexSource = pushModelStoreSource(store, vData, vDataSize, vDataSize);
+    }
+    MeshLodChain lods;
+    lods.indexOffsets[0] = 0;
+    lods.totalIndices[0] = iDataSize / indexSize;
+    lods.errors[0] = 0;
+    lods.triangleReductions[0] = 0;
+    lods.totalLods = 1;
+    if(indexSource && vertexSource && optimize){
+        u16* lodIndices = (u16*)indexSource;
+        u32 vertexStride = vertexSize / sizeof(f32);
+        optimizeModel3DData((f32*)vertexSource, &vDataSize, lodIndices, iDataSize, vertexSize, &store->optimize,
+                            &store->scratch);
+        u32 totalIndices = generateLodChain(lodIndices, lods.totalIndices[0], indexCapacity / sizeof(u16),
+                                            (f32*)vertexSource, vDataSize / vertexSize, vertexStride, store->totalLods,
+                                            MODEL_STORE_LOD_REDUCTION, MAX_F32, &lods, &store->scratch);
+        //the levels share the vertices, which the first level already ordered, so only their own indices are sorted
+        for(u32 i = 1; i < lods.totalLods && store->optimize.optimizeVertexCache; i++){
+            optimizeVertexCache(lodIndices + lods.indexOffsets[i], lods.totalIndices[i], vDataSize / vertexSize,
+                                store->optimize.cacheSize, &store->scratch);
+        }
+        iDataSize = totalIndices * sizeof(u16);
+    }
+    //a model the quantized pipelines cannot draw is not stored
+    if(indexSource && vertexSource && store->quantize &&
+       (vertexSize != MODEL3D_VERTEX_SIZE || !quantizeModelStoreVertices(store, (f32*)vertexSource, &vDataSize, &model))){
+        vertexSource = 0;
+    }
+    u32 vertexAllocation = indexSource && vertexSource ?
+        allocateGpuBuffer(&vertices->pool, vDataSize, MODEL_STORE_VERTEX_ALIGNMENT) : GPU_ALLOCATION_INVALID;
+    u32 indexAllocation = vertexAllocation != GPU_ALLOCATION_INVALID ?
+        allocateGpuBuffer(&indices->pool, iDataSize, MODEL_STORE_INDEX_ALIGNMENT) : GPU_ALLOCATION_INVALID;
+    if(indexAllocation == GPU_ALLOCATION_INVALID){
+        if(vertexAllocation != GPU_ALLOCATION_INVALID){
+            freeGpuBuffer(&vertices->pool, vertexAllocation);
+        }
+        store->stats.failedModels++;
+        return model;
+    }
+    //tickets complete in order, so the later one covers both ranges
+    u64 ticket = requestModelStoreUpload(store, vertices, vertexAllocation, vertexSource, vDataSize);
+    if(ticket != UPLOAD_TICKET_NONE){
+        ticket = requestModelStoreUpload(store, indices, indexAllocation, indexSource, iDataSize);
+    }
+    if(ticket == UPLOAD_TICKET_NONE){
+        //a vertex upload already queued still writes its range, which stays out of the pool until it is done
+        flushUploadScheduler(store->uploads);
+        freeGpuBuffer(&vertices->pool, vertexAllocation);
+        freeGpuBuffer(&indices->pool, indexAllocation);
+        store->stats.failedModels++;
+        return model;
+    }
+    store->lastTicket = ticket;
+    model.vertexAllocation = vertexAllocation;
+    model.indexAllocation = indexAllocation;
+    model.totalIndices = lods.totalIndices[0];
+    model.uploadTicket = ticket;
+    setModel3DLodChain(&model, &lods);
+    store->stats.models++;
+    store->stats.uploadedBytes += vDataSize + iDataSize;
+    return model;
+}
+
+static bool isStoredModel3DValid(Model3D* model){
+    return model->vertexAllocation != GPU_ALLOCATION_INVALID && model->indexAllocation != GPU_ALLOCATION_INVALID;
+}
+
+static void retireModelStoreRange(ModelStorePool* pool, u32 allocation){
+    pool->nextRetired[allocation] = pool->retiredHead;
+    pool->retiredHead = allocation;
+}
+
+//the model's ranges go back to the pools once the fence passes the frame being recorded
+static void destroyStoredModel3D(ModelStore* store, Model3D* model){
+    if(!isStoredModel3DValid(model)){
+        return;
+    }
+    retireModelStoreRange(&store->pools[MODEL_STORE_VERTICES], model->vertexAllocation);
+    retireModelStoreRange(&store->pools[MODEL_STORE_INDICES], model->indexAllocation);
+    if(model->uploadTicket > store->retiredTicket){
+        store->retiredTicket = model->uploadTicket;
+    }
+    model->vertexAllocation = GPU_ALLOCATION_INVALID;
+    model->indexAllocation = GPU_ALLOCATION_INVALID;
+    model->totalIndices = 0;
+    store->stats.retiredModels++;
+}
+
+static void freeModelStoreRanges(ModelStorePool* pool, u32 first){
+    while(first != GPU_ALLOCATION_INVALID){
+        u32 next = pool->nextRetired[first];
+        freeGpuBuffer(&pool->pool, first);
+        first = next;
+    }
+}
+
+//frees the ranges of every frame the fence has reached, and the source copies once nothing waits on them
+static void beginModelStoreFrame(ModelStore* store, u64 completedFenceValue){
+    while(store->totalFrames){
+        ModelStoreFrame* frame = &store->frames[store->firstFrame];
+        if(frame->fenceValue > completedFenceValue || !isUploadComplete(store->uploads, frame->uploadTicket)){
+            break;
+        }
+        for(u32 i = 0; i < MODEL_STORE_TOTAL_POOLS; i++){
+            freeModelStoreRanges(&store->pools[i], frame->firstRetired[i]);
+        }
+        store->firstFrame = (store->firstFrame + 1) % MODEL_STORE_MAX_FRAMES;
+        store->totalFrames--;
+    }
+    if(store->sources.used && isUploadComplete(store->uploads, store->lastTicket)){
+        store->sources.used = 0;
+    }
+}
+
+static void appendModelStoreRanges(ModelStorePool* pool, u32 first, u32 rest){
+    if(first == GPU_ALLOCATION_INVALID){
+        return;
+    }
+    u32 last = first;
+    while(pool->nextRetired[last] != GPU_ALLOCATION_INVALID){
+        last = pool->nextRetired[last];
+    }
+    pool->nextRetired[last] = rest;
+}
+
+//hands the frame's retired ranges to fenceValue, a full frame list folds into the newest frame
+static void endModelStoreFrame(ModelStore* store, u64 fenceValue){
+    bool retired = false;
+    for(u32 i = 0; i < MODEL_STORE_TOTAL_POOLS; i++){
+        retired |= store->pools[i].retiredHead != GPU_ALLOCATION_INVALID;
+    }
+    if(!retired){
+        return;
+    }
+    ModelStoreFrame* frame;
+    if(store->totalFrames == MODEL_STORE_MAX_FRAMES){
+        frame = &store->frames[(store->firstFrame + store->totalFrames - 1) % MODEL_STORE_MAX_FRAMES];
+        for(u32 i = 0; i < MODEL_STORE_TOTAL_POOLS; i++){
+            appendModelStoreRanges(&store->pools[i], store->pools[i].retiredHead, frame->firstRetired[i]);
+            if(store->pools[i].retiredHead != GPU_ALLOCATION_INVALID){
+                frame->firstRetired[i] = store->pools[i].retiredHead;
+            }
+        }
+    }else{
+        frame = &store->frames[(store->firstFrame + store->totalFrames) % MODEL_STORE_MAX_FRAMES];
+        for(u32 i = 0; i < MODEL_STORE_TOTAL_POOLS; i++){
+            frame->firstRetired[i] = store->pools[i].retiredHead;
+        }
+        frame->uploadTicket = 0;
+        store->totalFrames++;
+    }
+    frame->fenceValue = fenceValue;
+    if(store->retiredTicket > frame->uploadTicket){
+        frame->uploadTicket = store->retiredTicket;
+    }
+    for(u32 i = 0; i < MODEL_STORE_TOTAL_POOLS; i++){
+        store->pools[i].retiredHead = GPU_ALLOCATION_INVALID;
+    }
+    store->retiredTicket = 0;
+}
+
+//false while the model's upload is still waiting for a batch, its draws have to be skipped until then
+static bool waitForStoredModel(ModelStore* store, u32 queue, Model3D* model){
+    return isStoredModel3DValid(model) && waitForUploadOnQueue(store->uploads, queue, model->uploadTicket);
+}
+
+static void getStoredModelBuffers(ModelStore* store, Model3D* model, RenderResource* vertices,
+                                  RenderResource* indices){
+    *vertices = getModelStoreRange(&store->pools[MODEL_STORE_VERTICES], model->vertexAllocation);
+    *indices = getModelStoreRange(&store->pools[MODEL_STORE_INDICES], model->indexAllocation);
+}
+
+static void bindStoredModel3D(RenderCommandList* list, ModelStore* store, Model3D* model){
+    RenderBackend* backend = list->backend;
+    RenderResource vertices;
+    RenderResource indices;
+    getStoredModelBuffers(store, model, &vertices, &indices);
+    backend->setVertexBuffer(list, &vertices, model->vertexSize);
+    backend->setIndexBuffer(list, &indices, model->indexSize == 4 ? RENDER_INDEX_U32 : RENDER_INDEX_U16);
+    if(model->positionExtent.x != 0){
+        backend->setGraphicsConstants(list, 0, 8, &model->positionMin);
+    }
+}
+
+//Binds the model's ranges and draws one of its levels, expects the pipeline bound. A level past the model's last draws
+//the last.
+static void drawStoredModel3D(RenderCommandList* list, ModelStore* store, Model3D* model, u32 totalInstances = 1,
+                              u32 lod = 0){
+    lod = lod < model->totalLods ? lod : model->totalLods - 1;
+    bindStoredModel3D(list, store, model);
+    list->backend->drawIndexed(list, model->lodTotalIndices[lod], totalInstances, model->lodIndexOffsets[lod],
+                               (s32)model->vertexOffset);
+}
+
+static GpuBufferPoolStatistics getModelStoreStatistics(ModelStore* store, u32 pool){
+    return getGpuBufferPoolStatistics(&store->pools[pool].pool);
+}
+
+//the gpu has to be done with every model, live or retired
+static void destroyModelStore(ModelStore* store){
+    for(u32 i = 0; i < MODEL_STORE_TOTAL_POOLS; i++){
+        ModelStorePool* pool = &store->pools[i];
+        for(u32 j = 0; j < GPU_BUFFER_POOL_MAX_CHUNKS; j++){
+            if(pool->chunks[j].handle){
+                pool->backend->destroyResource(pool->backend, &pool->chunks[j]);
+                pool->chunks[j].handle = 0;
+            }
+        }
+        setMemory(pool->pool.chunkHandles, sizeof(pool->pool.chunkHandles));
+    }
+    store->totalFrames = 0;
+}
@@ -0,0 +1,1604 @@
+#pragma once
+
+#include "render_backend.h"
+
+//Null render backend.
+//Records commands like a real backend but never draws. Each command is checked as it is recorded (list open, draw
+//state bound, copy in bounds) and again when the list is executed, against the resource states the GPU timeline
+//would see, the way the D3D12 debug layer does. Problems are counted in stats.errors and the last one is kept in
+//lastError, so a headless run fails loudly on the same mistakes that would crash or corrupt a real frame.
+//GPU timing is simulated per queue: a submission starts submitLatency after it is executed, or when the queue frees
+//up, and takes listCost plus commandCost per command, drawCost per draw and a copy's size over copyBandwidth bytes per
+//microsecond. Every buffer remembers when the last copies into it finish and which bytes they wrote, and a draw the GPU
+//would run before the copies into the ranges it reads are done, because nothing made its queue wait for the copy
+//queue, is an error. Copies the buffer can no longer keep track of count against the whole of it. A fence signal completes when the work
+//queued before it does, and timestamps read back the simulated time the gpu reached them. A present is displayed
+//once the work queued before it is done, on the next refreshInterval boundary when vsynced, and waitForPresent
+//holds the caller while the maximum frame latency of presents are still waiting for the display.
+//Time comes from getMicroseconds and waits sleep through sleepMicroseconds; with no clock the backend keeps a
+//virtual one that only moves on waits, sleeps and advanceNullRenderTime, which makes runs deterministic.
+//Buffers are backed by arena memory, copies happen when the list is executed, and nothing is ever given back to the
+//arena; destroyed resources are reused by later buffers that fit. Descriptor heaps keep what each slot was last
+//written with, so views are checked against their heap type and the rules D3D12 puts on their addresses.
+//Textures keep their levels packed one after the other in arena memory, which their gpuAddress points at like a
+//buffer's, and copies into them are checked against the level, the block size and the row pitch d3d12 asks for.
+//Placed buffers point into their memory heap's arena block. Creating one, or an aliasing barrier naming it, hands it
+//the memory and takes it from every placed buffer it overlaps, and any later use of those is an error until an
+//aliasing barrier hands the memory back. A resource between the halves of a split barrier is in no state at all, so
+//every use of it fails the state checks.
+//Pipelines are checked against what D3D12 would refuse to create and cost pipelineCompileCost microseconds of the
+//calling thread's time, slept through sleepMicroseconds, while loading one from a library is free. A library keeps
+//the key and desc hash of every pipeline stored in it and serializes to exactly that, so a load only succeeds for the
+//desc the pipeline was stored from. Pipelines and libraries take a lock, so any thread can use them at once.
+
+#define NULL_RENDER_MAX_RESOURCES 1024
+#define NULL_RENDER_MAX_FENCES 64
+#define NULL_RENDER_MAX_COMMAND_LISTS 64
+#define NULL_RENDER_MAX_COMMANDS 4096
+#define NULL_RENDER_MAX_SIGNALS 256
+#define NULL_RENDER_MAX_PRESENTS 16
+#define NULL_RENDER_MAX_DESCRIPTOR_HEAPS 16
+#define NULL_RENDER_MAX_MEMORY_HEAPS 16
+#define NULL_RENDER_MAX_PIPELINES 256
+#define NULL_RENDER_MAX_PIPELINE_LIBRARIES 4
+#define NULL_RENDER_MAX_LIBRARY_PIPELINES 256
+#define NULL_RENDER_PIPELINE_LIBRARY_MAGIC 0x4C50504E
+#define NULL_RENDER_TRACKED_WRITES 8
+
+#define NULL_RENDER_DESCRIPTOR_EMPTY 0
+#define NULL_RENDER_DESCRIPTOR_CONSTANT_BUFFER 1
+#define NULL_RENDER_DESCRIPTOR_BUFFER 2
+#define NULL_RENDER_DESCRIPTOR_RENDER_TARGET 3
+#define NULL_RENDER_DESCRIPTOR_SAMPLER 4
+#define NULL_RENDER_DESCRIPTOR_TEXTURE 5
+
+#define NULL_RENDER_COMMAND_TRANSITION 0
+#define NULL_RENDER_COMMAND_VIEWPORT 1
+#define NULL_RENDER_COMMAND_RENDER_TARGET 2
+#define NULL_RENDER_COMMAND_CLEAR 3
+#define NULL_RENDER_COMMAND_PIPELINE 4
+#define NULL_RENDER_COMMAND_VERTEX_BUFFER 5
+#define NULL_RENDER_COMMAND_INDEX_BUFFER 6
+#define NULL_RENDER_COMMAND_DRAW 7
+#define NULL_RENDER_COMMAND_COPY 8
+#define NULL_RENDER_COMMAND_TIMESTAMP 9
+#define NULL_RENDER_COMMAND_DESCRIPTOR_HEAPS 10
+#define NULL_RENDER_COMMAND_ALIASING 11
+#define NULL_RENDER_COMMAND_CONSTANTS 12
+#define NULL_RENDER_COMMAND_TEXTURE_COPY 13
+
+//the state of a resource between the halves of a split barrier
+#define NULL_RENDER_STATE_SPLIT RENDER_TOTAL_STATES
+
+struct NullRenderSettings {
+    u64 (*getMicroseconds)();
+    void (*sleepMicroseconds)(u64 microseconds);
+    u32 totalBackBuffers;
+    u32 width;
+    u32 height;
+    u64 submitLatency;
+    u64 listCost;
+    u64 commandCost;
+    u64 drawCost;
+    u64 copyBandwidth;
+    u64 refreshInterval;
+    u64 pipelineCompileCost;
+};
+
+struct NullRenderMemoryHeap {
+    u8* memory;
+    u64 size;
+    bool live;
+};
+
+struct NullRenderWrite {
+    u64 offset;
+    u64 size;
+    u64 until;
+};
+
+//writtenUntil covers the whole buffer, for copies that fell out of writes. mipLevels is 0 for buffers.
+struct NullRenderResource {
+    u8* memory;
+    u64 size;
+    u64 capacity;
+    NullRenderWrite writes[NULL_RENDER_TRACKED_WRITES];
+    u32 nextWrite;
+    u64 writtenUntil;
+    NullRenderMemoryHeap* placedHeap;
+    u32 heap;
+    u32 state;
+    u32 splitAfter;
+    u32 width;
+    u32 height;
+    u32 format;
+    u32 mipLevels;
+    bool live;
+    bool mapped;
+    bool aliasedAway;
+};
+
+struct NullRenderPipeline {
+    u64 descHash;
+    bool live;
+};
+
+struct NullRenderLibraryPipeline {
+    u64 key;
+    u64 descHash;
+};
+
+struct NullRenderPipelineLibraryHeader {
+    u32 magic;
+    u32 totalPipelines;
+};
+
+struct NullRenderPipelineLibrary {
+    NullRenderLibraryPipeline pipelines[NULL_RENDER_MAX_LIBRARY_PIPELINES];
+    u32 totalPipelines;
+    bool live;
+};
+
+struct NullRenderFence {
+    u64 completedValue;
+    u64 signaledValue;
+};
+
+//a texture copy is count rows of size bytes, read sourceOffset on every after bytes and written offset on every before
+struct NullRenderCommand {
+    u32 type;
+    u32 before;
+    u32 after;
+    u32 count;
+    NullRenderResource* resource;
+    NullRenderResource* source;
+    u64 offset;
+    u64 sourceOffset;
+    u64 size;
+};
+
+struct NullRenderCommandList {
+    NullRenderCommand* commands;
+    u64 allocatorBusyUntil[RENDER_MAX_FRAMES_IN_FLIGHT];
+    NullRenderResource* renderTarget;
+    NullRenderResource* vertexBuffer;
+    NullRenderResource* indexBuffer;
+    u32 totalCommands;
+    u32 totalDraws;
+    u64 indexBufferSize;
+    u32 indexSize;
+    u32 allocatorIndex;
+    u32 queue;
+    bool open;
+    bool pipelineSet;
+    bool viewportSet;
+};
+
+struct NullRenderSignal {
+    NullRenderFence* fence;
+    u64 value;
+    u64 time;
+};
+
+struct NullRenderDescriptor {
+    NullRenderResource* resource;
+    u64 gpuAddress;
+    u64 size;
+    u32 kind;
+    //the most detailed level a texture view shows
+    u32 firstLevel;
+};
+
+struct NullRenderDescriptorHeap {
+    NullRenderDescriptor* descriptors;
+    u32 capacity;
+    u32 type;
+};
+
+struct NullRenderStats {
+    u64 submissions;
+    u64 commands;
+    u64 draws;
+    u64 barriers;
+    u64 splitBarriers;
+    u64 aliasingBarriers;
+    u64 copies;
+    u64 presents;
+    u64 fenceWaits;
+    u64 fenceWaitTime;
+    u64 presentWaits;
+    u64 presentWaitTime;
+    u64 gpuBusyTime;
+    u64 pipelinesCreated;
+    u64 pipelinesLoaded;
+    u32 errors;
+};
+
+struct NullRenderDevice {
+    NullRenderSettings settings;
+    MemoryArena* arena;
+    NullRenderResource resources[NULL_RENDER_MAX_RESOURCES];
+    NullRenderFence fences[NULL_RENDER_MAX_FENCES];
+    NullRenderCommandList commandLists[NULL_RENDER_MAX_COMMAND_LISTS];
+    NullRenderSignal signals[NULL_RENDER_MAX_SIGNALS];
+    NullRenderDescriptorHeap descriptorHeaps[NULL_RENDER_MAX_DESCRIPTOR_HEAPS];
+    NullRenderMemoryHeap memoryHeaps[NULL_RENDER_MAX_MEMORY_HEAPS];
+    NullRenderPipeline pipelines[NULL_RENDER_MAX_PIPELINES];
+    NullRenderPipelineLibrary pipelineLibraries[NULL_RENDER_MAX_PIPELINE_LIBRARIES];
+    RenderResource backBuffers[RENDER_MAX_BACK_BUFFERS];
+    u64 timestamps[RENDER_MAX_TIMESTAMPS];
+    u64 displayTimes[NULL_RENDER_MAX_PRESENTS];
+    u64 queueBusyUntil[RENDER_TOTAL_QUEUES];
+    u64 lastDisplayTime;
+    u64 virtualTime;
+    u32 totalResources;
+    u32 totalFences;
+    u32 totalCommandLists;
+    u32 totalSignals;
+    u32 totalDescriptorHeaps;
+    u32 totalMemoryHeaps;
+    u32 totalPipelines;
+    u32 totalPipelineLibraries;
+    volatile u32 pipelineLock;
+    u32 backBufferIndex;
+    u32 totalQueuedPresents;
+    u32 maxFrameLatency;
+    NullRenderStats stats;
+    s8 lastError[256];
+};
+
+static void nullRenderError(NullRenderDevice* device, const s8* message){
+    device->stats.errors++;
+    u32 i = 0;
+    for(; message[i] && i < sizeof(device->lastError) - 1; i++){
+        device->lastError[i] = message[i];
+    }
+    device->lastError[i] = '\0';
+}
+
+static u64 getNullRenderTime(NullRenderDevice* device){
+    return device->settings.getMicroseconds ? device->settings.getMicroseconds() : device->virtualTime;
+}
+
+//completes every signal whose work is done by now, in the order they were queued
+static void retireNullRenderSignals(NullRenderDevice* device){
+    u64 now = getNullRenderTime(device);
+    u32 remaining = 0;
+    for(u32 i = 0; i < device->totalSignals; i++){
+        NullRenderSignal* signal = &device->signals[i];
+        if(signal->time <= now){
+            signal->fence->completedValue = signal->value;
+        }else{
+            device->signals[remaining++] = *signal;
+        }
+    }
+    device->totalSignals = remaining;
+}
+
+//only the clock moves, work finishing during the advance is retired on the next fence query
+static void advanceNullRenderTime(RenderBackend* backend, u64 microseconds){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    if(device->settings.getMicroseconds){
+        if(device->settings.sleepMicroseconds) device->settings.sleepMicroseconds(microseconds);
+    }else{
+        device->virtualTime += microseconds;
+    }
+}
+
+//returns how long the caller was held
+static u64 waitForNullRenderTime(NullRenderDevice* device, u64 time){
+    u64 start = getNullRenderTime(device);
+    u64 now = start;
+    if(device->settings.getMicroseconds){
+        while(now < time){
+            if(device->settings.sleepMicroseconds) device->settings.sleepMicroseconds(time - now);
+            now = device->settings.getMicroseconds();
+        }
+    }else if(device->virtualTime < time){
+        device->virtualTime = time;
+        now = time;
+    }
+    return now - start;
+}
+
+static void retireNullRenderPresents(NullRenderDevice* device){
+    u64 now = getNullRenderTime(device);
+    u32 remaining = 0;
+    for(u32 i = 0; i < device->totalQueuedPresents; i++){
+        if(device->displayTimes[i] > now){
+            device->displayTimes[remaining++] = device->displayTimes[i];
+        }
+    }
+    device->totalQueuedPresents = remaining;
+}
+
+static NullRenderResource* allocateNullRenderResource(NullRenderDevice* device, u64 size){
+    NullRenderResource* best = 0;
+    for(u32 i = 0; i < device->totalResources; i++){
+        NullRenderResource* resource = &device->resources[i];
+        if(!resource->live && !resource->placedHeap && resource->capacity >= size &&
+           (!best || resource->capacity < best->capacity)){
+            best = resource;
+        }
+    }
+    if(!best){
+        if(device->totalResources == NULL_RENDER_MAX_RESOURCES){
+            return 0;
+        }
+        best = &device->resources[device->totalResources];
+        //aligned so constant buffer views can start at the beginning of any buffer, as they can on d3d12
+        best->memory = size ? (u8*)pushSize(device->arena, size, RENDER_CONSTANT_BUFFER_ALIGNMENT) : 0;
+        if(size && !best->memory){
+            return 0;
+        }
+        best->capacity = size;
+        device->totalResources++;
+    }
+    best->size = size;
+    best->mipLevels = 0;
+    best->writtenUntil = 0;
+    best->nextWrite = 0;
+    setMemory(best->writes, sizeof(best->writes));
+    best->live = true;
+    best->mapped = false;
+    return best;
+}
+
+static bool nullCreateMemoryHeap(RenderBackend* backend, u64 size, RenderMemoryHeap* heap){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderMemoryHeap* nullHeap = 0;
+    for(u32 i = 0; i < device->totalMemoryHeaps; i++){
+        if(!device->memoryHeaps[i].live && device->memoryHeaps[i].size >= size){
+            nullHeap = &device->memoryHeaps[i];
+            break;
+        }
+    }
+    if(!nullHeap){
+        if(device->totalMemoryHeaps == NULL_RENDER_MAX_MEMORY_HEAPS || !size){
+            nullRenderError(device, "memory heap could not be created");
+            return false;
+        }
+        nullHeap = &device->memoryHeaps[device->totalMemoryHeaps];
+        nullHeap->memory = (u8*)pushSize(device->arena, size, RENDER_CONSTANT_BUFFER_ALIGNMENT);
+        if(!nullHeap->memory){
+            nullRenderError(device, "out of memory heap memory");
+            return false;
+        }
+        nullHeap->size = size;
+        device->totalMemoryHeaps++;
+    }
+    nullHeap->live = true;
+    heap->handle = nullHeap;
+    heap->size = size;
+    return true;
+}
+
+//the buffers placed in it have to be destroyed first
+static void nullDestroyMemoryHeap(RenderBackend* backend, RenderMemoryHeap* heap){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderMemoryHeap* nullHeap = (NullRenderMemoryHeap*)heap->handle;
+    if(!nullHeap){
+        return;
+    }
+    for(u32 i = 0; i < device->totalResources; i++){
+        if(device->resources[i].live && device->resources[i].placedHeap == nullHeap){
+            nullRenderError(device, "destroyed a memory heap with buffers still placed in it");
+            break;
+        }
+    }
+    nullHeap->live = false;
+    heap->handle = 0;
+}
+
+//gives resource the memory it covers, every other placed buffer overlapping it loses it
+static void aliasNullRenderResource(NullRenderDevice* device, NullRenderResource* resource){
+    for(u32 i = 0; i < device->totalResources; i++){
+        NullRenderResource* other = &device->resources[i];
+        if(other != resource && other->live && other->placedHeap == resource->placedHeap &&
+           other->memory < resource->memory + resource->size && resource->memory < other->memory + other->size){
+            other->aliasedAway = true;
+        }
+    }
+    resource->aliasedAway = false;
+}
+
+static bool nullCreatePlacedBuffer(RenderBackend* backend, RenderMemoryHeap* heap, u64 offset, u64 size,
+                                   u32 initialState, RenderResource* buffer){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderMemoryHeap* nullHeap = (NullRenderMemoryHeap*)heap->handle;
+    if(!nullHeap || !nullHeap->live || offset % RENDER_PLACEMENT_ALIGNMENT || !size || offset + size > nullHeap->size){
+        nullRenderError(device, "placed buffer outside its memory heap");
+        return false;
+    }
+    NullRenderResource* resource = 0;
+    for(u32 i = 0; i < device->totalResources; i++){
+        if(!device->resources[i].live && device->resources[i].placedHeap){
+            resource = &device->resources[i];
+            break;
+        }
+    }
+    if(!resource){
+        if(device->totalResources == NULL_RENDER_MAX_RESOURCES){
+            nullRenderError(device, "out of buffer memory");
+            return false;
+        }
+        resource = &device->resources[device->totalResources++];
+    }
+    setMemory(resource, sizeof(NullRenderResource));
+    resource->memory = nullHeap->memory + offset;
+    resource->size = size;
+    resource->placedHeap = nullHeap;
+    resource->heap = RENDER_HEAP_DEFAULT;
+    resource->state = initialState;
+    resource->live = true;
+    aliasNullRenderResource(device, resource);
+    buffer->handle = resource;
+    buffer->gpuAddress = (u64)resource->memory;
+    buffer->descriptor = 0;
+    buffer->size = size;
+    buffer->heap = RENDER_HEAP_DEFAULT;
+    return true;
+}
+
+static bool nullCreateBuffer(RenderBackend* backend, u64 size, u32 heap, u32 initialState, RenderResource* buffer){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderResource* resource = allocateNullRenderResource(device, size);
+    if(!resource){
+        nullRenderError(device, "out of buffer memory");
+        return false;
+    }
+    resource->heap = heap;
+    resource->state = initialState;
+    setMemory(resource->memory, (u32)size);
+    buffer->handle = resource;
+    buffer->gpuAddress = (u64)resource->memory;
+    buffer->descriptor = 0;
+    buffer->size = size;
+    buffer->heap = heap;
+    return true;
+}
+
+static bool nullCreateTexture2D(RenderBackend* backend, u32 width, u32 height, u32 format, u32 mipLevels,
+                                u32 initialState, RenderResource* texture){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    u32 largest = width > height ? width : height;
+    if(!width || !height || !mipLevels || mipLevels > findMostSignificantBit(largest) + 1 ||
+       format == RENDER_FORMAT_UNKNOWN || format == RENDER_FORMAT_D32_FLOAT || format >= RENDER_TOTAL_FORMATS ||
+       (isRenderFormatBlockCompressed(format) && (width % 4 || height % 4))){
+        nullRenderError(device, "texture with a bad size, format or mip count");
+        return false;
+    }
+    u64 size = getRenderTextureSize(format, width, height, mipLevels);
+    NullRenderResource* resource = allocateNullRenderResource(device, size);
+    if(!resource){
+        nullRenderError(device, "out of texture memory");
+        return false;
+    }
+    resource->heap = RENDER_HEAP_DEFAULT;
+    resource->state = initialState;
+    resource->width = width;
+    resource->height = height;
+    resource->format = format;
+    resource->mipLevels = mipLevels;
+    setMemory(resource->memory, size);
+    texture->handle = resource;
+    texture->gpuAddress = (u64)resource->memory;
+    texture->descriptor = 0;
+    texture->size = size;
+    texture->heap = RENDER_HEAP_DEFAULT;
+    return true;
+}
+
+static bool isNullRenderColorFormat(u32 format){
+    return format != RENDER_FORMAT_UNKNOWN && format != RENDER_FORMAT_D32_FLOAT && format < RENDER_TOTAL_FORMATS;
+}
+
+//call with the pipeline lock held
+static bool validateNullRenderPipelineDesc(NullRenderDevice* device, RenderPipelineDesc* desc){
+    if(!desc->vertexShader.code || !desc->vertexShader.size || !desc->pixelShader.code || !desc->pixelShader.size){
+        nullRenderError(device, "pipeline without shader bytecode");
+        return false;
+    }
+    if(desc->totalAttributes > RENDER_MAX_VERTEX_ATTRIBUTES || desc->totalRenderTargets > RENDER_MAX_RENDER_TARGETS){
+        nullRenderError(device, "pipeline with too many vertex attributes or render targets");
+        return false;
+    }
+    for(u32 i = 0; i < desc->totalAttributes; i++){
+        if(!desc->attributes[i].semantic || !isNullRenderColorFormat(desc->attributes[i].format)){
+            nullRenderError(device, "vertex attribute without a semantic or with a format vertex buffers cannot hold");
+            return false;
+        }
+    }
+    for(u32 i = 0; i < desc->totalRenderTargets; i++){
+        if(!isNullRenderColorFormat(desc->renderTargetFormats[i])){
+            nullRenderError(device, "render target format that cannot be rendered to");
+            return false;
+        }
+    }
+    if((desc->depthFormat != RENDER_FORMAT_UNKNOWN && desc->depthFormat != RENDER_FORMAT_D32_FLOAT) ||
+       (desc->depthTest && desc->depthFormat == RENDER_FORMAT_UNKNOWN)){
+        nullRenderError(device, "depth test without a depth format");
+        return false;
+    }
+    if(desc->cullMode > RENDER_CULL_BACK || desc->blendMode > RENDER_BLEND_ADDITIVE ||
+       desc->depthCompare > RENDER_COMPARE_ALWAYS){
+        nullRenderError(device, "pipeline with an unknown cull, blend or compare mode");
+        return false;
+    }
+    return true;
+}
+
+//call with the pipeline lock held
+static bool allocateNullRenderPipeline(NullRenderDevice* device, u64 descHash, RenderPipelineDesc* desc,
+                                       RenderPipeline* pipeline){
+    NullRenderPipeline* nullPipeline = 0;
+    for(u32 i = 0; i < device->totalPipelines && !nullPipeline; i++){
+        if(!device->pipelines[i].live){
+            nullPipeline = &device->pipelines[i];
+        }
+    }
+    if(!nullPipeline){
+        if(device->totalPipelines == NULL_RENDER_MAX_PIPELINES){
+            nullRenderError(device, "out of pipelines");
+            return false;
+        }
+        nullPipeline = &device->pipelines[device->totalPipelines++];
+    }
+    nullPipeline->descHash = descHash;
+    nullPipeline->live = true;
+    pipeline->handle = nullPipeline;
+    pipeline->rootSignature = desc->rootSignature;
+    return true;
+}
+
+static bool nullCreatePipeline(RenderBackend* backend, RenderPipelineDesc* desc, RenderPipeline* pipeline){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    beginSpinLock(&device->pipelineLock);
+    bool valid = validateNullRenderPipelineDesc(device, desc);
+    endSpinLock(&device->pipelineLock);
+    if(!valid){
+        return false;
+    }
+    if(device->settings.sleepMicroseconds && device->settings.pipelineCompileCost){
+        device->settings.sleepMicroseconds(device->settings.pipelineCompileCost);
+    }
+    u64 descHash = hashRenderPipelineDesc(desc);
+    beginSpinLock(&device->pipelineLock);
+    bool created = allocateNullRenderPipeline(device, descHash, desc, pipeline);
+    if(created){
+        device->stats.pipelinesCreated++;
+    }
+    endSpinLock(&device->pipelineLock);
+    return created;
+}
+
+static void nullDestroyPipeline(RenderBackend* backend, RenderPipeline* pipeline){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderPipeline* nullPipeline = (NullRenderPipeline*)pipeline->handle;
+    if(nullPipeline){
+        beginSpinLock(&device->pipelineLock);
+        nullPipeline->live = false;
+        endSpinLock(&device->pipelineLock);
+    }
+    pipeline->handle = 0;
+}
+
+//data that is not a library this backend wrote fails, the way a d3d12 library from another driver does
+static bool nullCreatePipelineLibrary(RenderBackend* backend, void* data, u64 size, RenderPipelineLibrary* library){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderPipelineLibraryHeader* header = (NullRenderPipelineLibraryHeader*)data;
+    if(size && (size < sizeof(NullRenderPipelineLibraryHeader) || header->magic != NULL_RENDER_PIPELINE_LIBRARY_MAGIC ||
+                header->totalPipelines > NULL_RENDER_MAX_LIBRARY_PIPELINES ||
+                size != sizeof(NullRenderPipelineLibraryHeader) +
+                        header->totalPipelines * sizeof(NullRenderLibraryPipeline))){
+        return false;
+    }
+    beginSpinLock(&device->pipelineLock);
+    NullRenderPipelineLibrary* nullLibrary = 0;
+    for(u32 i = 0; i < device->totalPipelineLibraries && !nullLibrary; i++){
+        if(!device->pipelineLibraries[i].live){
+            nullLibrary = &device->pipelineLibraries[i];
+        }
+    }
+    if(!nullLibrary && device->totalPipelineLibraries < NULL_RENDER_MAX_PIPELINE_LIBRARIES){
+        nullLibrary = &device->pipelineLibraries[device->totalPipelineLibraries++];
+    }
+    if(nullLibrary){
+        nullLibrary->totalPipelines = size ? header->totalPipelines : 0;
+        copyMemory(nullLibrary->pipelines, header + 1, nullLibrary->totalPipelines * sizeof(NullRenderLibraryPipeline));
+        nullLibrary->live = true;
+    }else{
+        nullRenderError(device, "out of pipeline libraries");
+    }
+    endSpinLock(&device->pipelineLock);
+    library->handle = nullLibrary;
+    return nullLibrary != 0;
+}
+
+static u64 nullSerializePipelineLibrary(RenderBackend* backend, RenderPipelineLibrary* library, void* data,
+                                        u64 capacity){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderPipelineLibrary* nullLibrary = (NullRenderPipelineLibrary*)library->handle;
+    beginSpinLock(&device->pipelineLock);
+    u64 size = sizeof(NullRenderPipelineLibraryHeader) + nullLibrary->totalPipelines * sizeof(NullRenderLibraryPipeline);
+    if(data){
+        if(capacity < size){
+            size = 0;
+        }else{
+            NullRenderPipelineLibraryHeader* header = (NullRenderPipelineLibraryHeader*)data;
+            header->magic = NULL_RENDER_PIPELINE_LIBRARY_MAGIC;
+            header->totalPipelines = nullLibrary->totalPipelines;
+            copyMemory(header + 1, nullLibrary->pipelines, nullLibrary->totalPipelines * sizeof(NullRenderLibraryPipeline));
+        }
+    }
+    endSpinLock(&device->pipelineLock);
+    return size;
+}
+
+static void nullDestroyPipelineLibrary(RenderBackend* backend, RenderPipelineLibrary* library){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderPipelineLibrary* nullLibrary = (NullRenderPipelineLibrary*)library->handle;
+    if(nullLibrary){
+        beginSpinLock(&device->pipelineLock);
+        nullLibrary->live = false;
+        endSpinLock(&device->pipelineLock);
+    }
+    library->handle = 0;
+}
+
+static bool nullLoadPipeline(RenderBackend* backend, RenderPipelineLibrary* library, u64 key, RenderPipelineDesc* desc,
+                             RenderPipeline* pipeline){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderPipelineLibrary* nullLibrary = (NullRenderPipelineLibrary*)library->handle;
+    u64 descHash = hashRenderPipelineDesc(desc);
+    bool loaded = false;
+    beginSpinLock(&device->pipelineLock);
+    for(u32 i = 0; i < nullLibrary->totalPipelines; i++){
+        if(nullLibrary->pipelines[i].key == key){
+            loaded = nullLibrary->pipelines[i].descHash == descHash && validateNullRenderPipelineDesc(device, desc) &&
+                     allocateNullRenderPipeline(device, descHash, desc, pipeline);
+            break;
+        }
+    }
+    if(loaded){
+        device->stats.pipelinesLoaded++;
+    }
+    endSpinLock(&device->pipelineLock);
+    return loaded;
+}
+
+//a key already in the library is refused, as d3d12 refuses a name it already has
+static bool nullStorePipeline(RenderBackend* backend, RenderPipelineLibrary* library, u64 key, RenderPipeline* pipeline){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderPipelineLibrary* nullLibrary = (NullRenderPipelineLibrary*)library->handle;
+    NullRenderPipeline* nullPipeline = (NullRenderPipeline*)pipeline->handle;
+    bool stored = false;
+    beginSpinLock(&device->pipelineLock);
+    if(!nullPipeline || !nullPipeline->live){
+        nullRenderError(device, "store of a pipeline that does not exist");
+    }else if(nullLibrary->totalPipelines < NULL_RENDER_MAX_LIBRARY_PIPELINES){
+        stored = true;
+        for(u32 i = 0; i < nullLibrary->totalPipelines && stored; i++){
+            stored = nullLibrary->pipelines[i].key != key;
+        }
+        if(stored){
+            NullRenderLibraryPipeline* entry = &nullLibrary->pipelines[nullLibrary->totalPipelines++];
+            entry->key = key;
+            entry->descHash = nullPipeline->descHash;
+        }
+    }
+    endSpinLock(&device->pipelineLock);
+    return stored;
+}
+
+static void nullDestroyResource(RenderBackend* backend, RenderResource* resource){
+    NullRenderResource* nullResource = (NullRenderResource*)resource->handle;
+    if(nullResource){
+        nullResource->live = false;
+    }
+    resource->handle = 0;
+}
+
+static void* nullMapResource(RenderBackend* backend, RenderResource* resource){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderResource* nullResource = (NullRenderResource*)resource->handle;
+    if(!nullResource || nullResource->heap == RENDER_HEAP_DEFAULT){
+        nullRenderError(device, "map of a resource the cpu cannot see");
+        return 0;
+    }
+    nullResource->mapped = true;
+    return nullResource->memory;
+}
+
+static void nullUnmapResource(RenderBackend* backend, RenderResource* resource){
+    NullRenderResource* nullResource = (NullRenderResource*)resource->handle;
+    if(nullResource){
+        nullResource->mapped = false;
+    }
+}
+
+static bool nullCreateFence(RenderBackend* backend, u64 initialValue, RenderFence* fence){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    if(device->totalFences == NULL_RENDER_MAX_FENCES){
+        return false;
+    }
+    NullRenderFence* nullFence = &device->fences[device->totalFences++];
+    nullFence->completedValue = initialValue;
+    nullFence->signaledValue = initialValue;
+    fence->handle = nullFence;
+    return true;
+}
+
+//lists are created closed, the first resetCommandList opens them
+static bool nullCreateCommandList(RenderBackend* backend, u32 queue, RenderCommandList* list){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    if(device->totalCommandLists == NULL_RENDER_MAX_COMMAND_LISTS || queue >= RENDER_TOTAL_QUEUES){
+        return false;
+    }
+    NullRenderCommandList* nullList = &device->commandLists[device->totalCommandLists];
+    nullList->commands = pushArray(device->arena, NullRenderCommand, NULL_RENDER_MAX_COMMANDS);
+    if(!nullList->commands){
+        return false;
+    }
+    device->totalCommandLists++;
+    nullList->queue = queue;
+    list->handle = nullList;
+    list->backend = backend;
+    list->queue = queue;
+    return true;
+}
+
+static RenderResource* nullGetBackBuffer(RenderBackend* backend, u32 index){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    return &device->backBuffers[index];
+}
+
+static u32 nullGetCurrentBackBufferIndex(RenderBackend* backend){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    return device->backBufferIndex;
+}
+
+//only the shader visible types get a gpuStart, descriptors are addressed through their index
+static bool nullCreateDescriptorHeap(RenderBackend* backend, u32 type, u32 capacity, RenderDescriptorHeap* heap){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    if(device->totalDescriptorHeaps == NULL_RENDER_MAX_DESCRIPTOR_HEAPS || type >= RENDER_TOTAL_DESCRIPTOR_TYPES ||
+       !capacity){
+        nullRenderError(device, "descriptor heap could not be created");
+        return false;
+    }
+    NullRenderDescriptorHeap* nullHeap = &device->descriptorHeaps[device->totalDescriptorHeaps];
+    nullHeap->descriptors = pushArray(device->arena, NullRenderDescriptor, capacity);
+    if(!nullHeap->descriptors){
+        nullRenderError(device, "out of descriptor memory");
+        return false;
+    }
+    setMemory(nullHeap->descriptors, sizeof(NullRenderDescriptor) * capacity);
+    nullHeap->capacity = capacity;
+    nullHeap->type = type;
+    device->totalDescriptorHeaps++;
+    heap->handle = nullHeap;
+    heap->cpuStart = (u64)nullHeap->descriptors;
+    heap->gpuStart = type == RENDER_DESCRIPTORS_RENDER_TARGET ? 0 : (u64)nullHeap->descriptors;
+    heap->increment = sizeof(NullRenderDescriptor);
+    heap->capacity = capacity;
+    heap->type = type;
+    return true;
+}
+
+//descriptor writes come from any thread, so errors are the only shared state they touch
+static NullRenderDescriptor* getNullRenderDescriptor(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index,
+                                                     u32 type){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderDescriptorHeap* nullHeap = (NullRenderDescriptorHeap*)heap->handle;
+    if(!nullHeap || nullHeap->type != type){
+        nullRenderError(device, "view written to the wrong type of descriptor heap");
+        return 0;
+    }
+    if(index >= nullHeap->capacity){
+        nullRenderError(device, "descriptor index past the end of its heap");
+        return 0;
+    }
+    return &nullHeap->descriptors[index];
+}
+
+static void nullCreateConstantBufferView(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index, u64 gpuAddress,
+                                         u32 size){
+    NullRenderDescriptor* descriptor = getNullRenderDescriptor(backend, heap, index, RENDER_DESCRIPTORS_RESOURCE);
+    if(!descriptor){
+        return;
+    }
+    if(gpuAddress % RENDER_CONSTANT_BUFFER_ALIGNMENT || size % RENDER_CONSTANT_BUFFER_ALIGNMENT || !size ||
+       size > RENDER_MAX_CONSTANT_BUFFER_SIZE){
+        nullRenderError((NullRenderDevice*)backend->data, "constant buffer view with a bad address or size");
+        return;
+    }
+    descriptor->resource = 0;
+    descriptor->gpuAddress = gpuAddress;
+    descriptor->size = size;
+    descriptor->kind = NULL_RENDER_DESCRIPTOR_CONSTANT_BUFFER;
+}
+
+static void nullCreateBufferShaderView(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index,
+                                       RenderResource* buffer, u64 firstElement, u32 totalElements, u32 stride){
+    NullRenderDescriptor* descriptor = getNullRenderDescriptor(backend, heap, index, RENDER_DESCRIPTORS_RESOURCE);
+    if(!descriptor){
+        return;
+    }
+    NullRenderResource* resource = (NullRenderResource*)buffer->handle;
+    if(!resource || resource->mipLevels || !stride || (firstElement + totalElements) * stride > resource->size){
+        nullRenderError((NullRenderDevice*)backend->data, "buffer view outside its buffer");
+        return;
+    }
+    descriptor->resource = resource;
+    descriptor->gpuAddress = buffer->gpuAddress + firstElement * stride;
+    descriptor->size = (u64)totalElements * stride;
+    descriptor->kind = NULL_RENDER_DESCRIPTOR_BUFFER;
+}
+
+static void nullCreateTextureShaderView(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index,
+                                        RenderResource* texture, u32 mostDetailedMip){
+    NullRenderDescriptor* descriptor = getNullRenderDescriptor(backend, heap, index, RENDER_DESCRIPTORS_RESOURCE);
+    if(!descriptor){
+        return;
+    }
+    NullRenderResource* resource = (NullRenderResource*)texture->handle;
+    if(!resource || !resource->mipLevels){
+        nullRenderError((NullRenderDevice*)backend->data, "texture view of a resource that is not a texture");
+        return;
+    }
+    if(mostDetailedMip >= resource->mipLevels){
+        nullRenderError((NullRenderDevice*)backend->data, "texture view starting past the texture's last level");
+        return;
+    }
+    u64 skipped = getRenderTextureSize(resource->format, resource->width, resource->height, mostDetailedMip);
+    descriptor->resource = resource;
+    descriptor->gpuAddress = 0;
+    descriptor->size = resource->size - skipped;
+    descriptor->kind = NULL_RENDER_DESCRIPTOR_TEXTURE;
+    descriptor->firstLevel = mostDetailedMip;
+}
+
+static void nullCreateRenderTargetView(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index,
+                                       RenderResource* target){
+    NullRenderDescriptor* descriptor = getNullRenderDescriptor(backend, heap, index, RENDER_DESCRIPTORS_RENDER_TARGET);
+    if(!descriptor){
+        return;
+    }
+    if(!target->handle){
+        nullRenderError((NullRenderDevice*)backend->data, "render target view of a resource that does not exist");
+        return;
+    }
+    descriptor->resource = (NullRenderResource*)target->handle;
+    descriptor->kind = NULL_RENDER_DESCRIPTOR_RENDER_TARGET;
+}
+
+static void nullCreateSampler(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index, u32 filter,
+                              u32 addressMode){
+    NullRenderDescriptor* descriptor = getNullRenderDescriptor(backend, heap, index, RENDER_DESCRIPTORS_SAMPLER);
+    if(!descriptor){
+        return;
+    }
+    if(filter > RENDER_FILTER_LINEAR || addressMode > RENDER_ADDRESS_CLAMP){
+        nullRenderError((NullRenderDevice*)backend->data, "sampler with an unknown filter or address mode");
+        return;
+    }
+    descriptor->resource = 0;
+    descriptor->kind = NULL_RENDER_DESCRIPTOR_SAMPLER;
+}
+
+static bool isNullRenderCopySource(u32 state){
+    return state == RENDER_STATE_COPY_SOURCE || state == RENDER_STATE_GENERIC_READ || state == RENDER_STATE_COMMON;
+}
+
+static bool isNullRenderCopyDest(u32 state){
+    return state == RENDER_STATE_COPY_DEST || state == RENDER_STATE_COMMON;
+}
+
+static bool isNullRenderVertexSource(u32 state){
+    return state == RENDER_STATE_GENERIC_READ || state == RENDER_STATE_COMMON;
+}
+
+//the oldest tracked copy makes room, folded into the whole buffer's time
+static void trackNullRenderWrite(NullRenderResource* resource, u64 offset, u64 size, u64 until){
+    NullRenderWrite* write = &resource->writes[resource->nextWrite];
+    if(write->until > resource->writtenUntil){
+        resource->writtenUntil = write->until;
+    }
+    write->offset = offset;
+    write->size = size;
+    write->until = until;
+    resource->nextWrite = (resource->nextWrite + 1) % NULL_RENDER_TRACKED_WRITES;
+}
+
+//when the copies into the bytes a vertex or index buffer command bound are done
+static u64 getNullRenderWrittenUntil(NullRenderCommand* command){
+    NullRenderResource* resource = command->resource;
+    u64 until = resource->writtenUntil;
+    for(u32 i = 0; i < NULL_RENDER_TRACKED_WRITES; i++){
+        NullRenderWrite* write = &resource->writes[i];
+        if(write->until > until && write->offset < command->offset + command->size &&
+           command->offset < write->offset + write->size){
+            until = write->until;
+        }
+    }
+    return until;
+}
+
+//Replays the list against the states the resources will be in when the gpu reaches it, starting at start.
+//Returns the time the gpu finishes the list.
+static u64 replayNullRenderCommands(NullRenderDevice* device, NullRenderCommandList* list, u64 start){
+    NullRenderSettings* settings = &device->settings;
+    u64 time = start + settings->listCost;
+    NullRenderResource* renderTarget = 0;
+    NullRenderCommand* vertexBuffer = 0;
+    NullRenderCommand* indexBuffer = 0;
+    for(u32 i = 0; i < list->totalCommands; i++){
+        NullRenderCommand* command = &list->commands[i];
+        NullRenderResource* resource = command->resource;
+        time += settings->commandCost;
+        if(resource && !resource->live){
+            nullRenderError(device, "executed a list that uses a destroyed resource");
+            continue;
+        }
+        if(resource && resource->aliasedAway && command->type != NULL_RENDER_COMMAND_ALIASING){
+            nullRenderError(device, "use of a placed buffer whose memory was aliased without an aliasing barrier");
+        }
+        switch(command->type){
+            case NULL_RENDER_COMMAND_TRANSITION: {
+                if(command->count == RENDER_SPLIT_END){
+                    if(resource->state != NULL_RENDER_STATE_SPLIT || resource->splitAfter != command->after){
+                        nullRenderError(device, "end of a split barrier that was never begun");
+                    }
+                    resource->state = command->after;
+                    device->stats.barriers++;
+                    break;
+                }
+                if(resource->state != command->before){
+                    nullRenderError(device, "transition from a state the resource is not in");
+                }
+                if(command->count == RENDER_SPLIT_BEGIN){
+                    resource->state = NULL_RENDER_STATE_SPLIT;
+                    resource->splitAfter = command->after;
+                    device->stats.splitBarriers++;
+                    break;
+                }
+                resource->state = command->after;
+                device->stats.barriers++;
+                break;
+            }
+            case NULL_RENDER_COMMAND_ALIASING: {
+                aliasNullRenderResource(device, resource);
+                device->stats.aliasingBarriers++;
+                break;
+            }
+            case NULL_RENDER_COMMAND_RENDER_TARGET: {
+                renderTarget = resource;
+                break;
+            }
+            case NULL_RENDER_COMMAND_CLEAR: {
+                if(resource->state != RENDER_STATE_RENDER_TARGET){
+                    nullRenderError(device, "clear of a target not in the render target state");
+                }
+                break;
+            }
+            case NULL_RENDER_COMMAND_VERTEX_BUFFER: {
+                vertexBuffer = command;
+                break;
+            }
+            case NULL_RENDER_COMMAND_INDEX_BUFFER: {
+                indexBuffer = command;
+                break;
+            }
+            case NULL_RENDER_COMMAND_DRAW: {
+                if(renderTarget->state != RENDER_STATE_RENDER_TARGET){
+                    nullRenderError(device, "draw into a target not in the render target state");
+                }
+                if(!isNullRenderVertexSource(vertexBuffer->resource->state) ||
+                   !isNullRenderVertexSource(indexBuffer->resource->state)){
+                    nullRenderError(device, "draw from a buffer not in the generic read state");
+                }
+                if(time < getNullRenderWrittenUntil(vertexBuffer) || time < getNullRenderWrittenUntil(indexBuffer)){
+                    nullRenderError(device, "draw from a buffer before the copy into it finished");
+                }
+                device->stats.draws++;
+                time += settings->drawCost;
+                break;
+            }
+            case NULL_RENDER_COMMAND_COPY:
+            case NULL_RENDER_COMMAND_TEXTURE_COPY: {
+                NullRenderResource* source = command->source;
+                if(!source->live){
+                    nullRenderError(device, "executed a list that uses a destroyed resource");
+                    break;
+                }
+                if(source->aliasedAway){
+                    nullRenderError(device, "use of a placed buffer whose memory was aliased without an aliasing barrier");
+                }
+                if(!isNullRenderCopyDest(resource->state) || !isNullRenderCopySource(source->state)){
+                    nullRenderError(device, "copy between buffers not in copy states");
+                }
+                u32 rows = command->type == NULL_RENDER_COMMAND_COPY ? 1 : command->count;
+                for(u32 row = 0; row < rows; row++){
+                    copyMemory(resource->memory + command->offset + (u64)row * command->before,
+                               source->memory + command->sourceOffset + (u64)row * command->after, command->size);
+                }
+                if(settings->copyBandwidth){
+                    time += command->size * rows / settings->copyBandwidth;
+                }
+                trackNullRenderWrite(resource, command->offset, (u64)(rows - 1) * command->before + command->size, time);
+                device->stats.copies++;
+                break;
+            }
+            case NULL_RENDER_COMMAND_TIMESTAMP: {
+                device->timestamps[command->count] = time;
+                break;
+            }
+        }
+    }
+    return time;
+}
+
+//one submission, the lists run back to back after a single submitLatency
+static void nullExecuteCommandLists(RenderBackend* backend, RenderCommandList** lists, u32 totalLists){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    if(!totalLists){
+        nullRenderError(device, "executed no lists");
+        return;
+    }
+    u32 queue = lists[0]->queue;
+    for(u32 i = 0; i < totalLists; i++){
+        NullRenderCommandList* nullList = (NullRenderCommandList*)lists[i]->handle;
+        if(nullList->open){
+            nullRenderError(device, "executed a list that is still open");
+            return;
+        }
+        if(nullList->queue != queue){
+            nullRenderError(device, "executed lists for different queues together");
+            return;
+        }
+    }
+    u64 start = getNullRenderTime(device) + device->settings.submitLatency;
+    u64* busyUntil = &device->queueBusyUntil[queue];
+    if(start < *busyUntil){
+        start = *busyUntil;
+    }
+    u64 time = start;
+    for(u32 i = 0; i < totalLists; i++){
+        NullRenderCommandList* nullList = (NullRenderCommandList*)lists[i]->handle;
+        time = replayNullRenderCommands(device, nullList, time);
+        device->stats.commands += nullList->totalCommands;
+    }
+    for(u32 i = 0; i < totalLists; i++){
+        NullRenderCommandList* nullList = (NullRenderCommandList*)lists[i]->handle;
+        nullList->allocatorBusyUntil[nullList->allocatorIndex] = time;
+    }
+    *busyUntil = time;
+    device->stats.submissions++;
+    device->stats.gpuBusyTime += time - start;
+}
+
+static void nullSignalFence(RenderBackend* backend, u32 queue, RenderFence* fence, u64 value){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderFence* nullFence = (NullRenderFence*)fence->handle;
+    retireNullRenderSignals(device);
+    if(device->totalSignals == NULL_RENDER_MAX_SIGNALS){
+        nullRenderError(device, "too many fence signals in flight");
+        return;
+    }
+    //the signal runs on the queue, after everything already submitted to it
+    u64 time = device->queueBusyUntil[queue];
+    u64 now = getNullRenderTime(device);
+    if(time < now + device->settings.submitLatency){
+        time = now + device->settings.submitLatency;
+        device->queueBusyUntil[queue] = time;
+    }
+    NullRenderSignal* signal = &device->signals[device->totalSignals++];
+    signal->fence = nullFence;
+    signal->value = value;
+    signal->time = time;
+    nullFence->signaledValue = value;
+}
+
+static u64 nullGetCompletedFenceValue(RenderBackend* backend, RenderFence* fence){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    retireNullRenderSignals(device);
+    return ((NullRenderFence*)fence->handle)->completedValue;
+}
+
+//the first queued signal reaching value, a wait on a value never signaled would hang a real gpu
+static NullRenderSignal* findNullRenderSignal(NullRenderDevice* device, NullRenderFence* fence, u64 value){
+    for(u32 i = 0; i < device->totalSignals; i++){
+        if(device->signals[i].fence == fence && device->signals[i].value >= value){
+            return &device->signals[i];
+        }
+    }
+    nullRenderError(device, "wait on a fence value that was never signaled");
+    return 0;
+}
+
+static void nullWaitForFence(RenderBackend* backend, RenderFence* fence, u64 value){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderFence* nullFence = (NullRenderFence*)fence->handle;
+    retireNullRenderSignals(device);
+    if(nullFence->completedValue >= value){
+        return;
+    }
+    NullRenderSignal* signal = findNullRenderSignal(device, nullFence, value);
+    if(!signal){
+        return;
+    }
+    device->stats.fenceWaits++;
+    device->stats.fenceWaitTime += waitForNullRenderTime(device, signal->time);
+    retireNullRenderSignals(device);
+}
+
+//nothing later on the queue starts before the signal completes
+static void nullWaitForFenceOnQueue(RenderBackend* backend, u32 queue, RenderFence* fence, u64 value){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderFence* nullFence = (NullRenderFence*)fence->handle;
+    retireNullRenderSignals(device);
+    if(nullFence->completedValue >= value){
+        return;
+    }
+    NullRenderSignal* signal = findNullRenderSignal(device, nullFence, value);
+    if(signal && device->queueBusyUntil[queue] < signal->time){
+        device->queueBusyUntil[queue] = signal->time;
+    }
+}
+
+//never blocks, a caller that skips waitForPresent just lets presents pile up
+static bool nullPresent(RenderBackend* backend, u32 syncInterval){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    NullRenderResource* backBuffer = (NullRenderResource*)device->backBuffers[device->backBufferIndex].handle;
+    if(backBuffer->state != RENDER_STATE_PRESENT){
+        nullRenderError(device, "present of a back buffer not in the present state");
+    }
+    retireNullRenderPresents(device);
+    if(device->totalQueuedPresents == NULL_RENDER_MAX_PRESENTS){
+        nullRenderError(device, "too many presents queued");
+        return false;
+    }
+    u64 displayTime = device->queueBusyUntil[RENDER_QUEUE_DIRECT];
+    u64 refresh = device->settings.refreshInterval;
+    if(refresh && syncInterval){
+        if(displayTime < device->lastDisplayTime + refresh * syncInterval){
+            displayTime = device->lastDisplayTime + refresh * syncInterval;
+        }
+        displayTime = (displayTime + refresh - 1) / refresh * refresh;
+    }
+    device->lastDisplayTime = displayTime;
+    device->displayTimes[device->totalQueuedPresents++] = displayTime;
+    device->backBufferIndex = (device->backBufferIndex + 1) % backend->totalBackBuffers;
+    device->stats.presents++;
+    return true;
+}
+
+static void nullSetMaximumFrameLatency(RenderBackend* backend, u32 maxLatency){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    device->maxFrameLatency = maxLatency ? maxLatency : 1;
+}
+
+static void nullWaitForPresent(RenderBackend* backend){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    retireNullRenderPresents(device);
+    if(device->totalQueuedPresents < device->maxFrameLatency){
+        return;
+    }
+    //presents display in order, so the one that frees a slot is the oldest still queued past the limit
+    u64 time = device->displayTimes[device->totalQueuedPresents - device->maxFrameLatency];
+    device->stats.presentWaits++;
+    device->stats.presentWaitTime += waitForNullRenderTime(device, time);
+    retireNullRenderPresents(device);
+}
+
+static u64 nullReadTimestamp(RenderBackend* backend, u32 index){
+    NullRenderDevice* device = (NullRenderDevice*)backend->data;
+    return index < RENDER_MAX_TIMESTAMPS ? device->timestamps[index] : 0;
+}
+
+static u64 nullGetMicroseconds(RenderBackend* backend){
+    return getNullRenderTime((NullRenderDevice*)backend->data);
+}
+
+//returns the command to fill in, or 0 when the list cannot take it
+static NullRenderCommand* recordNullRenderCommand(RenderCommandList* list, u32 type){
+    NullRenderDevice* device = (NullRenderDevice*)list->backend->data;
+    NullRenderCommandList* nullList = (NullRenderCommandList*)list->handle;
+    if(!nullList->open){
+        nullRenderError(device, "recorded into a closed list");
+        return 0;
+    }
+    if(nullList->totalCommands == NULL_RENDER_MAX_COMMANDS){
+        nullRenderError(device, "too many commands in one list");
+        return 0;
+    }
+    NullRenderCommand* command = &nullList->commands[nullList->totalCommands++];
+    setMemory(command, sizeof(NullRenderCommand));
+    command->type = type;
+    return command;
+}
+
+static bool isNullRenderGraphicsList(RenderCommandList* list, RenderResource* resource = 0){
+    NullRenderDevice* device = (NullRenderDevice*)list->backend->data;
+    if(list->queue != RENDER_QUEUE_DIRECT){
+        nullRenderError(device, "graphics command on a copy list");
+        return false;
+    }
+    if(resource && !resource->handle){
+        nullRenderError(device, "command on a resource that does not exist");
+        return false;
+    }
+    return true;
+}
+
+//the gpu may still be reading the commands last recorded with this allocator
+static void nullResetCommandList(RenderCommandList* list, u32 allocatorIndex, RenderPipeline* pipeline){
+    NullRenderDevice* device = (NullRenderDevice*)list->backend->data;
+    NullRenderCommandList* nullList = (NullRenderCommandList*)list->handle;
+    if(nullList->open){
+        nullRenderError(device, "reset of a list that is still open");
+    }
+    if(allocatorIndex >= RENDER_MAX_FRAMES_IN_FLIGHT){
+        nullRenderError(device, "reset with an allocator that does not exist");
+        allocatorIndex = 0;
+    }
+    if(getNullRenderTime(device) < nullList->allocatorBusyUntil[allocatorIndex]){
+        nullRenderError(device, "reset of an allocator the gpu is still using");
+    }
+    nullList->totalCommands = 0;
+    nullList->totalDraws = 0;
+    nullList->allocatorIndex = allocatorIndex;
+    nullList->renderTarget = 0;
+    nullList->vertexBuffer = 0;
+    nullList->indexBuffer = 0;
+    nullList->viewportSet = false;
+    nullList->pipelineSet = pipeline && pipeline->handle;
+    nullList->open = true;
+}
+
+static void nullCloseCommandList(RenderCommandList* list){
+    NullRenderCommandList* nullList = (NullRenderCommandList*)list->handle;
+    if(!nullList->open){
+        nullRenderError((NullRenderDevice*)list->backend->data, "close of a list that is not open");
+    }
+    nullList->open = false;
+}
+
+static void nullTransitionResource(RenderCommandList* list, RenderResource* resource, u32 before, u32 after){
+    NullRenderDevice* device = (NullRenderDevice*)list->backend->data;
+    if(!resource->handle || before == after || before >= RENDER_TOTAL_STATES || after >= RENDER_TOTAL_STATES){
+        nullRenderError(device, "invalid transition");
+        return;
+    }
+    NullRenderCommand* command = recordNullRenderCommand(list, NULL_RENDER_COMMAND_TRANSITION);
+    if(command){
+        command->resource = (NullRenderResource*)resource->handle;
+        command->before = before;
+        command->after = after;
+    }
+}
+
+static void nullInsertBarriers(RenderCommandList* list, RenderBarrier* barriers, u32 totalBarriers){
+    NullRenderDevice* device = (NullRenderDevice*)list->backend->data;
+    for(u32 i = 0; i < totalBarriers; i++){
+        RenderBarrier* barrier = &barriers[i];
+        NullRenderResource* resource = (NullRenderResource*)barrier->resource->handle;
+        if(barrier->type == RENDER_BARRIER_ALIASING){
+            if(!resource || !resource->placedHeap){
+                nullRenderError(device, "aliasing barrier on a buffer that is not placed");
+                continue;
+            }
+            NullRenderCommand* command = recordNullRenderCommand(list, NULL_RENDER_COMMAND_ALIASING);
+            if(command){
+                command->resource = resource;
+            }
+            continue;
+        }
+        if(!resource || barrier->type != RENDER_BARRIER_TRANSITION || barrier->before == barrier->after ||
+           barrier->before >= RENDER_TOTAL_STATES || barrier->after >= RENDER_TOTAL_STATES ||
+           barrier->split > RENDER_SPLIT_END){
+            nullRenderError(device, "invalid barrier");
+            continue;
+        }
+        NullRenderCommand* command = recordNullRenderCommand(list, NULL_RENDER_COMMAND_TRANSITION);
+        if(command){
+            command->resource = resource;
+            command->before = barrier->before;
+            command->after = barrier->after;
+            command->count = barrier->split;
+        }
+    }
+}
+
+static void nullSetDescriptorHeaps(RenderCommandList* list, RenderDescriptorHeap* resources,
+                                  RenderDescriptorHeap* samplers){
+    if(!isNullRenderGraphicsList(list) || !recordNullRenderCommand(list, NULL_RENDER_COMMAND_DESCRIPTOR_HEAPS)){
+        return;
+    }
+    if((resources && resources->type != RENDER_DESCRIPTORS_RESOURCE) ||
+       (samplers && samplers->type != RENDER_DESCRIPTORS_SAMPLER)){
+        nullRenderError((NullRenderDevice*)list->backend->data, "only resource and sampler heaps can be set on a list");
+    }
+}
+
+static void nullSetViewport(RenderCommandList* list, f32 x, f32 y, f32 width, f32 height){
+    if(!isNullRenderGraphicsList(list) || !recordNullRenderCommand(list, NULL_RENDER_COMMAND_VIEWPORT)){
+        return;
+    }
+    if(width <= 0 || height <= 0){
+        nullRenderError((NullRenderDevice*)list->backend->data, "empty viewport");
+        return;
+    }
+    ((NullRenderCommandList*)list->handle)->viewportSet = true;
+}
+
+static void nullSetRenderTarget(RenderCommandList* list, RenderResource* target){
+    if(!isNullRenderGraphicsList(list, target)){
+        return;
+    }
+    NullRenderCommand* command = recordNullRenderCommand(list, NULL_RENDER_COMMAND_RENDER_TARGET);
+    if(command){
+        command->resource = (NullRenderResource*)target->handle;
+        ((NullRenderCommandList*)list->handle)->renderTarget = command->resource;
+    }
+}
+
+static void nullClearRenderTarget(RenderCommandList* list, RenderResource* target, Vector4 color){
+    if(!isNullRenderGraphicsList(list, target)){
+        return;
+    }
+    NullRenderCommand* command = recordNullRenderCommand(list, NULL_RENDER_COMMAND_CLEAR);
+    if(command){
+        command->resource = (NullRenderResource*)target->handle;
+    }
+}
+
+static void nullSetPipeline(RenderCommandList* list, RenderPipeline* pipeline){
+    if(!isNullRenderGraphicsList(list) || !recordNullRenderCommand(list, NULL_RENDER_COMMAND_PIPELINE)){
+        return;
+    }
+    if(!pipeline || !pipeline->handle || !((NullRenderPipeline*)pipeline->handle)->live){
+        nullRenderError((NullRenderDevice*)list->backend->data, "set of a pipeline that does not exist");
+        return;
+    }
+    ((NullRenderCommandList*)list->handle)->pipelineSet = true;
+}
+
+//a view may narrow a buffer's gpuAddress and size to part of it, but not reach outside it
+static bool isNullRenderBufferView(RenderCommandList* list, RenderResource* buffer){
+    NullRenderResource* resource = (NullRenderResource*)buffer->handle;
+    u64 memory = (u64)resource->memory;
+    if(resource->mipLevels){
+        nullRenderError((NullRenderDevice*)list->backend->data, "texture bound as a buffer");
+        return false;
+    }
+    if(buffer->gpuAddress < memory || buffer->gpuAddress + buffer->size > memory + resource->size){
+        nullRenderError((NullRenderDevice*)list->backend->data, "buffer view outside its buffer");
+        return false;
+    }
+    return true;
+}
+
+static void nullSetVertexBuffer(RenderCommandList* list, RenderResource* buffer, u32 stride){
+    if(!isNullRenderGraphicsList(list, buffer) || !isNullRenderBufferView(list, buffer)){
+        return;
+    }
+    NullRenderCommand* command = recordNullRenderCommand(list, NULL_RENDER_COMMAND_VERTEX_BUFFER);
+    if(command){
+        command->resource = (NullRenderResource*)buffer->handle;
+        command->count = stride;
+        command->offset = buffer->gpuAddress - (u64)command->resource->memory;
+        command->size = buffer->size;
+        ((NullRenderCommandList*)list->handle)->vertexBuffer = command->resource;
+    }
+}
+
+static void nullSetIndexBuffer(RenderCommandList* list, RenderResource* buffer, u32 indexFormat){
+    if(!isNullRenderGraphicsList(list, buffer) || !isNullRenderBufferView(list, buffer)){
+        return;
+    }
+    NullRenderCommand* command = recordNullRenderCommand(list, NULL_RENDER_COMMAND_INDEX_BUFFER);
+    if(command){
+        command->resource = (NullRenderResource*)buffer->handle;
+        command->count = indexFormat == RENDER_INDEX_U32 ? 4 : 2;
+        command->offset = buffer->gpuAddress - (u64)command->resource->memory;
+        command->size = buffer->size;
+        ((NullRenderCommandList*)list->handle)->indexBuffer = command->resource;
+        ((NullRenderCommandList*)list->handle)->indexSize = command->count;
+        ((NullRenderCommandList*)list->handle)->indexBufferSize = buffer->size;
+    }
+}
+
+static void nullSetGraphicsConstants(RenderCommandList* list, u32 firstConstant, u32 totalConstants, void* data){
+    NullRenderDevice* device = (NullRenderDevice*)list->backend->data;
+    if(!isNullRenderGraphicsList(list)){
+        return;
+    }
+    if(!((NullRenderCommandList*)list->handle)->pipelineSet){
+        nullRenderError(device, "graphics constants set without a pipeline");
+        return;
+    }
+    if(!data || !totalConstants || firstConstant + totalConstants > RENDER_MAX_GRAPHICS_CONSTANTS){
+        nullRenderError(device, "graphics constants outside the root signature's");
+        return;
+    }
+    NullRenderCommand* command = recordNullRenderCommand(list, NULL_RENDER_COMMAND_CONSTANTS);
+    if(command){
+        command->offset = firstConstant;
+        command->count = totalConstants;
+    }
+}
+
+static void nullDrawIndexed(RenderCommandList* list, u32 totalIndices, u32 totalInstances, u32 firstIndex,
+                            s32 baseVertex){
+    NullRenderDevice* device = (NullRenderDevice*)list->backend->data;
+    NullRenderCommandList* nullList = (NullRenderCommandList*)list->handle;
+    if(!isNullRenderGraphicsList(list)){
+        return;
+    }
+    if(!nullList->pipelineSet || !nullList->renderTarget || !nullList->vertexBuffer || !nullList->indexBuffer ||
+       !nullList->viewportSet){
+        nullRenderError(device, "draw without a pipeline, render target, vertex buffer, index buffer and viewport");
+        return;
+    }
+    if(((u64)firstIndex + totalIndices) * nullList->indexSize > nullList->indexBufferSize){
+        nullRenderError(device, "draw reads past the end of the index buffer");
+        return;
+    }
+    if(recordNullRenderCommand(list, NULL_RENDER_COMMAND_DRAW)){
+        nullList->totalDraws++;
+    }
+}
+
+static void nullCopyBuffer(RenderCommandList* list, RenderResource* dst, u64 dstOffset, RenderResource* src,
+                           u64 srcOffset, u64 size){
+    NullRenderDevice* device = (NullRenderDevice*)list->backend->data;
+    if(!dst->handle || !src->handle || dstOffset + size > dst->size || srcOffset + size > src->size){
+        nullRenderError(device, "copy out of bounds");
+        return;
+    }
+    if(((NullRenderResource*)dst->handle)->mipLevels || ((NullRenderResource*)src->handle)->mipLevels){
+        nullRenderError(device, "buffer copy into or out of a texture");
+        return;
+    }
+    NullRenderCommand* command = recordNullRenderCommand(list, NULL_RENDER_COMMAND_COPY);
+    if(command){
+        command->resource = (NullRenderResource*)dst->handle;
+        command->source = (NullRenderResource*)src->handle;
+        command->offset = dstOffset;
+        command->sourceOffset = srcOffset;
+        command->size = size;
+    }
+}
+
+static void nullCopyBufferToTexture(RenderCommandList* list, RenderResource* dst, u32 mipLevel, u32 x, u32 y, u32 width,
+                                    u32 height, RenderResource* src, u64 srcOffset, u32 srcRowPitch){
+    NullRenderDevice* device = (NullRenderDevice*)list->backend->data;
+    NullRenderResource* texture = (NullRenderResource*)dst->handle;
+    NullRenderResource* source = (NullRenderResource*)src->handle;
+    if(!texture || !source || !texture->mipLevels || source->mipLevels){
+        nullRenderError(device, "texture copy needs a buffer source and a texture destination");
+        return;
+    }
+    u32 block = isRenderFormatBlockCompressed(texture->format) ? 4 : 1;
+    u32 levelWidth = getRenderTextureLevelDimension(texture->width, mipLevel);
+    u32 levelHeight = getRenderTextureLevelDimension(texture->height, mipLevel);
+    if(mipLevel >= texture->mipLevels || !width || !height || x + width > levelWidth || y + height > levelHeight ||
+       x % block || y % block || ((x + width) % block && x + width != levelWidth) ||
+       ((y + height) % block && y + height != levelHeight)){
+        nullRenderError(device, "texture copy outside its level or not on block boundaries");
+        return;
+    }
+    u32 rowSize = getRenderTextureRowSize(texture->format, width);
+    u32 rows = getRenderTextureRows(texture->format, height);
+    if(srcOffset % RENDER_TEXTURE_COPY_ALIGNMENT || srcRowPitch % RENDER_TEXTURE_ROW_ALIGNMENT || srcRowPitch < rowSize ||
+       srcOffset + (u64)srcRowPitch * (rows - 1) + rowSize > source->size){
+        nullRenderError(device, "texture copy source misaligned or out of bounds");
+        return;
+    }
+    NullRenderCommand* command = recordNullRenderCommand(list, NULL_RENDER_COMMAND_TEXTURE_COPY);
+    if(command){
+        u32 levelRowSize = getRenderTextureRowSize(texture->format, levelWidth);
+        command->resource = texture;
+        command->source = source;
+        command->offset = getRenderTextureSize(texture->format, texture->width, texture->height, mipLevel) +
+                          (u64)(y / block) * levelRowSize + (u64)(x / block) * getRenderFormatBytes(texture->format);
+        command->sourceOffset = srcOffset;
+        command->size = rowSize;
+        command->count = rows;
+        command->before = levelRowSize;
+        command->after = srcRowPitch;
+    }
+}
+
+static void nullWriteTimestamp(RenderCommandList* list, u32 index){
+    if(index >= RENDER_MAX_TIMESTAMPS){
+        nullRenderError((NullRenderDevice*)list->backend->data, "timestamp index out of range");
+        return;
+    }
+    NullRenderCommand* command = recordNullRenderCommand(list, NULL_RENDER_COMMAND_TIMESTAMP);
+    if(command){
+        command->count = index;
+    }
+}
+
+//back buffers start in the present state, like a swap chain's
+static bool initializeNullRenderBackend(RenderBackend* backend, NullRenderSettings* settings, MemoryArena* arena){
+    setMemory(backend, sizeof(RenderBackend));
+    NullRenderDevice* device = pushStruct(arena, NullRenderDevice);
+    if(!device || !settings->totalBackBuffers || settings->totalBackBuffers > RENDER_MAX_BACK_BUFFERS){
+        return false;
+    }
+    setMemory(device, sizeof(NullRenderDevice));
+    device->settings = *settings;
+    device->arena = arena;
+    device->maxFrameLatency = 3;
+    for(u32 i = 0; i < settings->totalBackBuffers; i++){
+        NullRenderResource* resource = allocateNullRenderResource(device, 0);
+        resource->heap = RENDER_HEAP_DEFAULT;
+        resource->state = RENDER_STATE_PRESENT;
+        resource->size = (u64)settings->width * settings->height * 4;
+        device->backBuffers[i].handle = resource;
+        device->backBuffers[i].descriptor = i;
+        device->backBuffers[i].size = resource->size;
+        device->backBuffers[i].heap = RENDER_HEAP_DEFAULT;
+    }
+
+    backend->createBuffer = nullCreateBuffer;
+    backend->destroyResource = nullDestroyResource;
+    backend->mapResource = nullMapResource;
+    backend->unmapResource = nullUnmapResource;
+    backend->createFence = nullCreateFence;
+    backend->createCommandList = nullCreateCommandList;
+    backend->getBackBuffer = nullGetBackBuffer;
+    backend->getCurrentBackBufferIndex = nullGetCurrentBackBufferIndex;
+    backend->createDescriptorHeap = nullCreateDescriptorHeap;
+    backend->createConstantBufferView = nullCreateConstantBufferView;
+    backend->createBufferShaderView = nullCreateBufferShaderView;
+    backend->createRenderTargetView = nullCreateRenderTargetView;
+    backend->createSampler = nullCreateSampler;
+    backend->createTexture2D = nullCreateTexture2D;
+    backend->createTextureShaderView = nullCreateTextureShaderView;
+    backend->createMemoryHeap = nullCreateMemoryHeap;
+    backend->createPlacedBuffer = nullCreatePlacedBuffer;
+    backend->destroyMemoryHeap = nullDestroyMemoryHeap;
+    backend->createPipeline = nullCreatePipeline;
+    backend->destroyPipeline = nullDestroyPipeline;
+    backend->createPipelineLibrary = nullCreatePipelineLibrary;
+    backend->serializePipelineLibrary = nullSerializePipelineLibrary;
+    backend->destroyPipelineLibrary = nullDestroyPipelineLibrary;
+    backend->loadPipeline = nullLoadPipeline;
+    backend->storePipeline = nullStorePipeline;
+    backend->executeCommandLists = nullExecuteCommandLists;
+    backend->signalFence = nullSignalFence;
+    backend->getCompletedFenceValue = nullGetCompletedFenceValue;
+    backend->waitForFence = nullWaitForFence;
+    backend->waitForFenceOnQueue = nullWaitForFenceOnQueue;
+    backend->present = nullPresent;
+    backend->setMaximumFrameLatency = nullSetMaximumFrameLatency;
+    backend->waitForPresent = nullWaitForPresent;
+    backend->readTimestamp = nullReadTimestamp;
+    backend->getMicroseconds = nullGetMicroseconds;
+    backend->sleepMicroseconds = advanceNullRenderTime;
+    backend->resetCommandList = nullResetCommandList;
+    backend->closeCommandList = nullCloseCommandList;
+    backend->transitionResource = nullTransitionResource;
+    backend->insertBarriers = nullInsertBarriers;
+    backend->setDescriptorHeaps = nullSetDescriptorHeaps;
+    backend->setViewport = nullSetViewport;
+    backend->setRenderTarget = nullSetRenderTarget;
+    backend->clearRenderTarget = nullClearRenderTarget;
+    backend->setPipeline = nullSetPipeline;
+    backend->setVertexBuffer = nullSetVertexBuffer;
+    backend->setIndexBuffer = nullSetIndexBuffer;
+    backend->setGraphicsConstants = nullSetGraphicsConstants;
+    backend->drawIndexed = nullDrawIndexed;
+    backend->copyBuffer = nullCopyBuffer;
+    backend->copyBufferToTexture = nullCopyBufferToTexture;
+    backend->writeTimestamp = nullWriteTimestamp;
+    backend->data = device;
+    backend->totalBackBuffers = settings->totalBackBuffers;
+    backend->width = settings->width;
+    backend->height = settings->height;
+    return true;
+}
@@ -1,11 +1,16 @@
 #pragma once
 
 #include "mathematics.h"
+#include "gpu_buffer_allocator.h"
 
 #define MOUSE_BUTTON_LEFT 0 
 #define MOUSE_BUTTON_MIDDLE 1 
 #define MOUSE_BUTTON_RIGHT 2 
 
+#define MODEL3D_MAX_LODS 4
+//createModel3D vertices are a position, a normal and a uv
+#define MODEL3D_VERTEX_SIZE (8 * sizeof(f32))
+
 struct FileHandle {
     void* handle;
 };
@@ -51,6 +56,17 @@ struct Model3D {
     u32 indexOffset;
     u32 vertexOffset;
     u32 vertexSize;
+    u32 indexSize;
+    u32 vertexAllocation;
+    u32 indexAllocation;
+    u64 uploadTicket;
+    //quantized vertices decode to positionMin + position * positionExtent, the extent is 0 for float vertices
+    Vector4 positionMin;
+    Vector4 positionExtent;
+    u32 lodIndexOffsets[MODEL3D_MAX_LODS];
+    u32 lodTotalIndices[MODEL3D_MAX_LODS];
+    f32 lodErrors[MODEL3D_MAX_LODS];
+    u32 totalLods;
 };
 
 struct Animesh {
@@ -143,8 +159,11 @@ struct Animation {
     u32 poseIndex;
 };
 
+struct GlyphCache;
+
 struct FontMap {
     Texture2D bitmap;
+    GlyphCache* glyphCache;
     f32 yOffsets[128];
     f32 widths[128];
     f32 heights[128];
@@ -246,13 +265,16 @@ struct OSInterface {
     u8* shortTermBuffer;
     u8* longTermBuffer;
 
-    f32* model3DVertexBufferPointer;
-    u16* model3DIndexBufferPointer;
+    GpuBufferPool* model3DVertexBufferPool;
+    GpuBufferPool* model3DIndexBufferPool;
 
     u32 longTermBufferOffset;
 
     bool (*readFileIntoBuffer)(const s8* fileName, void* data, u32* fileLength);
+    //fails without writing past capacity when the file is larger
+    bool (*readFileIntoBoundedBuffer)(const s8* fileName, void* data, u32 capacity, u32* fileLength);
     bool (*writeToFile)(const s8* fileName, void* data, u32 dataSize);
+    bool (*deleteFile)(const s8* fileName);
     u32 (*bindTexture2D)(Texture2D* texture);
     u32 (*bindTextureCube)(TextureCube* cube);
     u64 (*getSystemTime)();
@@ -269,6 +291,9 @@ struct OSInterface {
     void (*setAudioEmitterChannelVolumes)(AudioEmitter* ae, f32 left, f32 right);
     void (*setAudioEmitterVolume)(AudioEmitter* ae, f32 volume);
 
+    void* (*createFileWatcher)(const s8* directory);
+    u32 (*readFileWatcherChanges)(void* watcher, s8* names, u32 capacity);
+
     void (*setFileHandlePointer)(FileHandle* handle, u32 amount);
     void (*readFromFileHandle)(FileHandle* handle, u8* buffer, u32 amount);
     void (*closeFileHandle)(FileHandle* handle);
@@ -297,8 +322,12 @@ struct OSInterface {
     AudioEmitter (*createAudioEmitter)(u32 numberOfChannels, u32 sampleRate, u32 byteRate, u32 blockAlign, u32 bitsPerSample);
     Texture2D (*createTexture2D)(void* data, u32 width, u32 height, u32 format);
     Texture2D (*createTexture2DFromFile)(s8* fileName);
+    Texture2D (*createTexture2DMipmapped)(void* data, u32 width, u32 height, u32 format, u32 mipLevels);
+    void (*updateTexture2D)(Texture2D* texture, void* data, u32 x, u32 y, u32 width, u32 height);
     Model3D (*createModel3D)(f32* vData, u32 vDataSize, u16* iData, u32 iDataSize);
+    Model3D (*createModel3D32)(f32* vData, u32 vDataSize, u32* iData, u32 iDataSize);
     Model3D (*createModel3DFromFile)(s8* fileName);
+    void (*destroyModel3D)(Model3D* model);
     Animesh (*createAnimesh)(f32* vData, u32 vDataSize, u16* iData, u32 iDataSize);
     Animesh (*createAnimeshFromFile)(s8* file);
     TextureCube (*createTextureCube)(void* data, u32 width, u32 height, u32 format);
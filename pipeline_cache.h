@@ -0,0 +1,425 @@
+#pragma once
+
+#include "render_backend.h"
+
+//Pipeline cache.
+//Pipelines are requested by desc and looked up by hashRenderPipelineDesc, so asking for a pipeline the cache already
+//has, queued or compiled, hands back the same handle and never compiles twice. Two descs are taken to be the same
+//pipeline when their 64 bit hashes match. requestPipeline copies the shader bytecode and semantics into the cache's
+//arena and queues the compile on the work queue, returning right away; getPipeline gives the pipeline once it is
+//ready and the fallback until then, so a new permutation or a reloaded shader never stalls a frame. A request that
+//has to have its pipeline now, the first one nothing can stand in for, compiles it on the calling thread.
+//A compile first tries the pipeline library under the pipeline's hash and only compiles when the library misses,
+//storing what it compiled. The library is loaded from libraryFile when the cache is created and written back by
+//savePipelineCache, so pipelines compiled in one run load in the next. A library file from another driver or backend
+//is dropped for an empty library, and a cache whose backend has no libraries compiles everything.
+//The root signature is not part of the hash, a cache is meant for pipelines sharing one.
+//A pipeline nothing will ask for again, like the one a shader reload replaced, is handed to retirePipeline. It leaves
+//the table at once and is destroyed by the first beginPipelineCacheFrame after the gpu passed the fence of the frame
+//it was retired in, when its slot and bytecode storage go back to the cache for later requests.
+//Requests and getPipeline are for the main thread only; compiles run on the queue's threads. The queue must not be
+//shared with code that calls completeWorkQueueEntries.
+
+#define PIPELINE_CACHE_MAX_PIPELINES 128
+#define PIPELINE_CACHE_TABLE_SIZE (PIPELINE_CACHE_MAX_PIPELINES * 2)
+#define PIPELINE_CACHE_MAX_FRAMES 16
+#define PIPELINE_CACHE_NONE MAX_U32
+
+#define PIPELINE_QUEUED 0
+#define PIPELINE_COMPILING 1
+#define PIPELINE_READY 2
+#define PIPELINE_FAILED 3
+//free, or being filled in by a request, so no job can claim it
+#define PIPELINE_FREE 4
+
+struct PipelineCache;
+
+//storage holds the desc's bytecode and semantics and stays with the slot, a request reusing the slot copies into it
+//when it fits. next links the free and retired lists.
+struct PipelineCacheEntry {
+    PipelineCache* cache;
+    u64 key;
+    RenderPipelineDesc desc;
+    RenderPipeline pipeline;
+    u8* storage;
+    u32 storageSize;
+    u32 next;
+    bool retired;
+    volatile u32 state;
+};
+
+//the entries retired in one frame, given back once the gpu passed fenceValue
+struct PipelineCacheFrame {
+    u64 fenceValue;
+    u32 firstRetired;
+};
+
+//compileTime is summed over every compile, on whichever thread ran it, refused counts the requests turned away
+//because the entries or the arena were used up
+struct PipelineCacheStats {
+    u64 requests;
+    u64 deduplicated;
+    u64 fallbacks;
+    u64 refused;
+    u64 retired;
+    volatile u32 compiled;
+    volatile u32 loaded;
+    volatile u32 stored;
+    volatile u32 failed;
+    volatile u64 compileTime;
+};
+
+struct PipelineCache {
+    RenderBackend* backend;
+    OSInterface* os;
+    WorkQueue* workQueue;
+    MemoryArena* arena;
+    RenderPipelineLibrary library;
+    //pipelines stored in or retired from the library since it was last saved
+    volatile u32 unsavedPipelines;
+    PipelineCacheEntry entries[PIPELINE_CACHE_MAX_PIPELINES];
+    //entries ever used, the ones past it have never been handed out
+    u32 totalEntries;
+    u32 firstFree;
+    //retired since the last endPipelineCacheFrame
+    u32 retiredHead;
+    PipelineCacheFrame frames[PIPELINE_CACHE_MAX_FRAMES];
+    u32 firstFrame;
+    u32 totalFrames;
+    //open addressed on the key, PIPELINE_CACHE_NONE marks an empty slot
+    u32 table[PIPELINE_CACHE_TABLE_SIZE];
+    PipelineCacheStats stats;
+};
+
+//The library bytes stay in the arena for the cache's whole life, the backend reads them until the library is
+//destroyed. maxLibrarySize has to hold the whole file, libraryFile 0 starts from an empty library.
+static bool initializePipelineCache(PipelineCache* cache, RenderBackend* backend, OSInterface* os,
+                                    WorkQueue* workQueue, MemoryArena* arena, const s8* libraryFile,
+                                    u32 maxLibrarySize){
+    setMemory(cache, sizeof(PipelineCache));
+    cache->backend = backend;
+    cache->os = os;
+    cache->workQueue = workQueue;
+    cache->arena = arena;
+    cache->firstFree = PIPELINE_CACHE_NONE;
+    cache->retiredHead = PIPELINE_CACHE_NONE;
+    for(u32 i = 0; i < PIPELINE_CACHE_TABLE_SIZE; i++){
+        cache->table[i] = PIPELINE_CACHE_NONE;
+    }
+    u64 arenaMark = arena->used;
+    u8* data = libraryFile ? (u8*)pushSize(arena, maxLibrarySize) : 0;
+    u32 fileLength = 0;
+    if(!data || !os->readFileIntoBoundedBuffer(libraryFile, data, maxLibrarySize, &fileLength) ||
+       !backend->createPipelineLibrary(backend, data, fileLength, &cache->library)){
+        arena->used = arenaMark;
+        if(!backend->createPipelineLibrary(backend, 0, 0, &cache->library)){
+            cache->library.handle = 0;
+        }
+    }else{
+        //only what the file took stays pushed
+        arena->used = (u64)(data - arena->base) + fileLength;
+    }
+    return true;
+}
+
+static void compileCachedPipeline(PipelineCacheEntry* entry){
+    PipelineCache* cache = entry->cache;
+    RenderBackend* backend = cache->backend;
+    RenderPipelineLibrary* library = &cache->library;
+    u64 start = backend->getMicroseconds(backend);
+    u32 state = PIPELINE_READY;
+    if(library->handle && backend->loadPipeline(backend, library, entry->key, &entry->desc, &entry->pipeline)){
+        atomicAdd(&cache->stats.loaded, 1);
+    }else if(backend->createPipeline(backend, &entry->desc, &entry->pipeline)){
+        atomicAdd(&cache->stats.compiled, 1);
+        if(library->handle && backend->storePipeline(backend, library, entry->key, &entry->pipeline)){
+            atomicAdd(&cache->stats.stored, 1);
+            atomicAdd(&cache->unsavedPipelines, 1);
+        }
+    }else{
+        atomicAdd(&cache->stats.failed, 1);
+        state = PIPELINE_FAILED;
+    }
+    atomicAdd64(&cache->stats.compileTime, backend->getMicroseconds(backend) - start);
+    atomicCompareExchange(&entry->state, state, PIPELINE_COMPILING);
+}
+
+//Whoever moves the entry out of the queued state compiles it, the job or a request that cannot wait for the job.
+//A job whose entry was compiled by a request can outlive the entry and find its slot handed to a later request; it
+//then compiles that request's pipeline, which is just as good as the later job doing it.
+static bool claimCachedPipeline(PipelineCacheEntry* entry){
+    return atomicCompareExchange(&entry->state, PIPELINE_COMPILING, PIPELINE_QUEUED) == PIPELINE_QUEUED;
+}
+
+static void compilePipelineJob(void* data){
+    PipelineCacheEntry* entry = (PipelineCacheEntry*)data;
+    if(claimCachedPipeline(entry)){
+        compileCachedPipeline(entry);
+    }
+}
+
+static u32 getPipelineDescStorageSize(RenderPipelineDesc* desc){
+    u32 size = ((desc->vertexShader.size + 15) & ~15u) + ((desc->pixelShader.size + 15) & ~15u);
+    for(u32 i = 0; i < desc->totalAttributes && i < RENDER_MAX_VERTEX_ATTRIBUTES; i++){
+        const s8* semantic = desc->attributes[i].semantic;
+        u32 length = 0;
+        while(semantic && semantic[length]) length++;
+        size += length + 1;
+    }
+    return size;
+}
+
+//copies everything the desc points at into storage, so the caller can free its bytecode as soon as it has asked
+static void copyPipelineDesc(u8* storage, RenderPipelineDesc* source, RenderPipelineDesc* desc){
+    *desc = *source;
+    copyMemory(storage, source->vertexShader.code, source->vertexShader.size);
+    desc->vertexShader.code = storage;
+    storage += (source->vertexShader.size + 15) & ~15u;
+    copyMemory(storage, source->pixelShader.code, source->pixelShader.size);
+    desc->pixelShader.code = storage;
+    storage += (source->pixelShader.size + 15) & ~15u;
+    for(u32 i = 0; i < source->totalAttributes && i < RENDER_MAX_VERTEX_ATTRIBUTES; i++){
+        const s8* semantic = source->attributes[i].semantic;
+        u32 length = 0;
+        while(semantic && semantic[length]) length++;
+        copyMemory(storage, (void*)(semantic ? semantic : ""), length + 1);
+        desc->attributes[i].semantic = (s8*)storage;
+        storage += length + 1;
+    }
+}
+
+static u32 findPipelineCacheSlot(PipelineCache* cache, u64 key){
+    u32 slot = (u32)key & (PIPELINE_CACHE_TABLE_SIZE - 1);
+    while(cache->table[slot] != PIPELINE_CACHE_NONE && cache->entries[cache->table[slot]].key != key){
+        slot = (slot + 1) & (PIPELINE_CACHE_TABLE_SIZE - 1);
+    }
+    return slot;
+}
+
+//Takes the entry out of the table. Linear probing has no tombstones here, every entry after the hole that may sit
+//in it is shifted back instead, so lookups still stop at the first empty slot.
+static void removePipelineCacheSlot(PipelineCache* cache, u32 hole){
+    u32 mask = PIPELINE_CACHE_TABLE_SIZE - 1;
+    for(u32 slot = (hole + 1) & mask; cache->table[slot] != PIPELINE_CACHE_NONE; slot = (slot + 1) & mask){
+        u32 home = (u32)cache->entries[cache->table[slot]].key & mask;
+        //an entry whose home lies after the hole would no longer be found from it
+        if(((slot - home) & mask) >= ((slot - hole) & mask)){
+            cache->table[hole] = cache->table[slot];
+            hole = slot;
+        }
+    }
+    cache->table[hole] = PIPELINE_CACHE_NONE;
+}
+
+//an entry from the free list, or one never used, with room for storageSize bytes; PIPELINE_CACHE_NONE if there is none
+static u32 allocatePipelineCacheEntry(PipelineCache* cache, u32 storageSize){
+    u32 handle = cache->firstFree;
+    bool unused = handle == PIPELINE_CACHE_NONE;
+    if(unused){
+        if(cache->totalEntries == PIPELINE_CACHE_MAX_PIPELINES){
+            return PIPELINE_CACHE_NONE;
+        }
+        handle = cache->totalEntries;
+        setMemory(&cache->entries[handle], sizeof(PipelineCacheEntry));
+        cache->entries[handle].state = PIPELINE_FREE;
+    }
+    PipelineCacheEntry* entry = &cache->entries[handle];
+    if(entry->storageSize < storageSize){
+        //a reloaded shader tends to come back a little bigger, the slack lets the next reload reuse the storage
+        u32 size = storageSize + storageSize / 4;
+        u8* storage = (u8*)pushSize(cache->arena, size);
+        if(!storage){
+            return PIPELINE_CACHE_NONE;
+        }
+        entry->storage = storage;
+        entry->storageSize = size;
+    }
+    if(unused){
+        cache->totalEntries++;
+    }else{
+        cache->firstFree = entry->next;
+    }
+    return handle;
+}
+
+//Returns the handle of the pipeline desc describes, queueing its compile the first time it is asked for, or
+//PIPELINE_CACHE_NONE when the cache has no entry or arena left for it, counted in stats.refused. Retiring what is no
+//longer used keeps that from happening. With wait the pipeline is ready or failed on return.
+static u32 requestPipeline(PipelineCache* cache, RenderPipelineDesc* desc, bool wait = false){
+    u64 key = hashRenderPipelineDesc(desc);
+    cache->stats.requests++;
+    u32 slot = findPipelineCacheSlot(cache, key);
+    u32 handle = cache->table[slot];
+    if(handle != PIPELINE_CACHE_NONE){
+        cache->stats.deduplicated++;
+    }else{
+        handle = allocatePipelineCacheEntry(cache, getPipelineDescStorageSize(desc));
+        if(handle == PIPELINE_CACHE_NONE){
+            cache->stats.refused++;
+            return PIPELINE_CACHE_NONE;
+        }
+        PipelineCacheEntry* entry = &cache->entries[handle];
+        copyPipelineDesc(entry->storage, desc, &entry->desc);
+        entry->cache = cache;
+        entry->key = key;
+        entry->pipeline.handle = 0;
+        entry->retired = false;
+        //only now can a job claim it
+        atomicCompareExchange(&entry->state, PIPELINE_QUEUED, PIPELINE_FREE);
+        cache->table[slot] = handle;
+        if(!wait){
+            cache->os->addWorkQueueEntry(cache->workQueue, compilePipelineJob, entry);
+        }
+    }
+    PipelineCacheEntry* entry = &cache->entries[handle];
+    if(wait){
+        if(claimCachedPipeline(entry)){
+            compileCachedPipeline(entry);
+        }
+        //a job already compiling it is waited out
+        while(entry->state == PIPELINE_COMPILING){
+            spinPause();
+        }
+    }
+    return handle;
+}
+
+static bool isPipelineReady(PipelineCache* cache, u32 handle){
+    return handle != PIPELINE_CACHE_NONE && cache->entries[handle].state == PIPELINE_READY;
+}
+
+//the pipeline if it is ready, else the fallback if that is, else 0
+static RenderPipeline* getPipeline(PipelineCache* cache, u32 handle, u32 fallback = PIPELINE_CACHE_NONE){
+    if(isPipelineReady(cache, handle)){
+        return &cache->entries[handle].pipeline;
+    }
+    cache->stats.fallbacks++;
+    if(isPipelineReady(cache, fallback)){
+        return &cache->entries[fallback].pipeline;
+    }
+    return 0;
+}
+
+//Hands the given pipeline to the frame ending next. It must not be used in a frame recorded after that one, and its
+//handle may come back from a later request for another pipeline.
+static void retirePipeline(PipelineCache* cache, u32 handle){
+    if(handle == PIPELINE_CACHE_NONE || cache->entries[handle].retired){
+        return;
+    }
+    PipelineCacheEntry* entry = &cache->entries[handle];
+    u32 slot = findPipelineCacheSlot(cache, entry->key);
+    if(cache->table[slot] == handle){
+        removePipelineCacheSlot(cache, slot);
+    }
+    entry->retired = true;
+    entry->next = cache->retiredHead;
+    cache->retiredHead = handle;
+    cache->stats.retired++;
+    atomicAdd(&cache->unsavedPipelines, 1);
+}
+
+//Destroys the pipelines of every frame the gpu is done with and frees their entries. A frame holding a retired
+//pipeline whose compile has not finished waits for a later call, the job compiling it still uses the entry.
+static void beginPipelineCacheFrame(PipelineCache* cache, u64 completedFenceValue){
+    RenderBackend* backend = cache->backend;
+    while(cache->totalFrames){
+        PipelineCacheFrame* frame = &cache->frames[cache->firstFrame];
+        if(frame->fenceValue > completedFenceValue){
+            break;
+        }
+        u32 handle = frame->firstRetired;
+        while(handle != PIPELINE_CACHE_NONE && cache->entries[handle].state >= PIPELINE_READY){
+            handle = cache->entries[handle].next;
+        }
+        if(handle != PIPELINE_CACHE_NONE){
+            break;
+        }
+        handle = frame->firstRetired;
+        while(handle != PIPELINE_CACHE_NONE){
+            PipelineCacheEntry* entry = &cache->entries[handle];
+            u32 next = entry->next;
+            if(entry->state == PIPELINE_READY){
+                backend->destroyPipeline(backend, &entry->pipeline);
+            }
+            entry->state = PIPELINE_FREE;
+            entry->next = cache->firstFree;
+            cache->firstFree = handle;
+            handle = next;
+        }
+        cache->firstFrame = (cache->firstFrame + 1) % PIPELINE_CACHE_MAX_FRAMES;
+        cache->totalFrames--;
+    }
+}
+
+//hands the pipelines retired since the last call to fenceValue, a full frame list folds into the newest frame
+static void endPipelineCacheFrame(PipelineCache* cache, u64 fenceValue){
+    u32 first = cache->retiredHead;
+    if(first == PIPELINE_CACHE_NONE){
+        return;
+    }
+    cache->retiredHead = PIPELINE_CACHE_NONE;
+    if(cache->totalFrames == PIPELINE_CACHE_MAX_FRAMES){
+        PipelineCacheFrame* newest = &cache->frames[(cache->firstFrame + cache->totalFrames - 1) %
+                                                    PIPELINE_CACHE_MAX_FRAMES];
+        u32 last = first;
+        while(cache->entries[last].next != PIPELINE_CACHE_NONE){
+            last = cache->entries[last].next;
+        }
+        cache->entries[last].next = newest->firstRetired;
+        newest->fenceValue = fenceValue;
+        newest->firstRetired = first;
+        return;
+    }
+    PipelineCacheFrame* frame = &cache->frames[(cache->firstFrame + cache->totalFrames) % PIPELINE_CACHE_MAX_FRAMES];
+    frame->fenceValue = fenceValue;
+    frame->firstRetired = first;
+    cache->totalFrames++;
+}
+
+//Waits for every queued compile, then writes the library to libraryFile if anything was stored in it or retired.
+//What is written is a new library holding only the pipelines the cache still has, so pipelines retired or never
+//asked for in this run are dropped from the file instead of piling up in it run after run.
+//scratch only has to hold the library while it is written.
+static bool savePipelineCache(PipelineCache* cache, const s8* libraryFile, MemoryArena* scratch){
+    RenderBackend* backend = cache->backend;
+    cache->os->completeWorkQueueEntries(cache->workQueue);
+    if(!cache->library.handle || !cache->unsavedPipelines){
+        return true;
+    }
+    RenderPipelineLibrary library;
+    if(!backend->createPipelineLibrary(backend, 0, 0, &library)){
+        return false;
+    }
+    for(u32 i = 0; i < cache->totalEntries; i++){
+        PipelineCacheEntry* entry = &cache->entries[i];
+        if(entry->state == PIPELINE_READY && !entry->retired){
+            backend->storePipeline(backend, &library, entry->key, &entry->pipeline);
+        }
+    }
+    u64 size = backend->serializePipelineLibrary(backend, &library, 0, 0);
+    u64 scratchMark = scratch->used;
+    u8* data = size && size <= MAX_U32 ? (u8*)pushSize(scratch, size) : 0;
+    bool success = data && backend->serializePipelineLibrary(backend, &library, data, size) == size &&
+                   cache->os->writeToFile(libraryFile, data, (u32)size);
+    scratch->used = scratchMark;
+    backend->destroyPipelineLibrary(backend, &library);
+    if(success){
+        cache->unsavedPipelines = 0;
+    }
+    return success;
+}
+
+//the gpu has to be done with every pipeline the cache handed out, retired ones included
+static void destroyPipelineCache(PipelineCache* cache){
+    RenderBackend* backend = cache->backend;
+    cache->os->completeWorkQueueEntries(cache->workQueue);
+    for(u32 i = 0; i < cache->totalEntries; i++){
+        if(cache->entries[i].state == PIPELINE_READY){
+            backend->destroyPipeline(backend, &cache->entries[i].pipeline);
+        }
+    }
+    if(cache->library.handle){
+        backend->destroyPipelineLibrary(backend, &cache->library);
+    }
+    cache->totalEntries = 0;
+}
@@ -0,0 +1,367 @@
+#pragma once
+
+#include "os_interface.h"
+
+//Render backend interface.
+//The frame loop reaches the GPU only through a RenderBackend, a table of callbacks in the same spirit as OSInterface:
+//device calls create resources, fences and command lists, queue calls submit, signal, wait and present, and command
+//list calls record. dx12_scratch.cpp fills the table with D3D12, null_render_backend.h with a recorder that validates
+//every command and fakes GPU timing, so the same frame code runs headless on machines without a GPU.
+//Handles are plain structs whose pointers belong to the backend. Resource states are tracked by the caller and
+//passed to transitionResource, as with D3D12 barriers. Buffers in the common state are promoted implicitly, so the
+//copy queue, which only sees common resources, can write them and draws can read them without a barrier.
+//insertBarriers records several barriers as one batch. A split barrier is a begin half, after which the resource
+//cannot be used, and an end half with the same states, so the GPU can do the transition while other work runs.
+//Placed buffers share the memory of a RenderMemoryHeap; when one takes over memory another was using, an aliasing
+//barrier naming the new one has to come before its first use.
+//Textures are 2D with a full or partial mip chain and are filled by copyBufferToTexture from rows laid out at
+//RENDER_TEXTURE_ROW_ALIGNMENT in a buffer, one row of pixels or of 4x4 blocks for block compressed formats. Their
+//RenderResource size is the bytes of every level packed tightly, as getRenderTextureSize counts them.
+//Pipelines are created from a RenderPipelineDesc, which says what the pipeline is made of without any API types, and
+//can be stored in and loaded back from a RenderPipelineLibrary under a 64 bit key. A library is created from the bytes
+//serializePipelineLibrary wrote, which have to stay valid until it is destroyed. Creating, loading and storing
+//pipelines may happen on any thread at once.
+//waitForFenceOnQueue holds a queue on the GPU, not the caller, until a fence reaches a value another queue signals.
+//Descriptor heaps are arrays of views addressed by index. Views may be written from any thread into slots nobody
+//else is writing, and the resource and sampler heaps are shader visible so shaders can index them directly.
+//Each command list owns one allocator per frame in flight; resetCommandList picks one, and the caller guarantees
+//through its fences that the GPU is done with whatever that allocator recorded last. Different lists can be recorded
+//on different threads at once, one thread per list. executeCommandLists submits lists as one batch that runs in
+//array order, and no state carries from one list to the next apart from resource states.
+//waitForPresent blocks until fewer than the maximum frame latency presents are queued, so the next present will not.
+//Times are in microseconds on the backend's clock; timestamps written by a command list read back on that clock once
+//the list's fence has completed.
+
+#define RENDER_MAX_BACK_BUFFERS 4
+#define RENDER_MAX_FRAMES_IN_FLIGHT 4
+#define RENDER_MAX_TIMESTAMPS 64
+
+#define RENDER_QUEUE_DIRECT 0
+#define RENDER_QUEUE_COPY 1
+#define RENDER_TOTAL_QUEUES 2
+
+#define RENDER_HEAP_DEFAULT 0
+#define RENDER_HEAP_UPLOAD 1
+#define RENDER_HEAP_READBACK 2
+
+#define RENDER_STATE_COMMON 0
+#define RENDER_STATE_PRESENT 1
+#define RENDER_STATE_RENDER_TARGET 2
+#define RENDER_STATE_GENERIC_READ 3
+#define RENDER_STATE_COPY_SOURCE 4
+#define RENDER_STATE_COPY_DEST 5
+#define RENDER_STATE_SHADER_RESOURCE 6
+#define RENDER_TOTAL_STATES 7
+
+#define RENDER_INDEX_U16 0
+#define RENDER_INDEX_U32 1
+
+#define RENDER_DESCRIPTORS_RESOURCE 0
+#define RENDER_DESCRIPTORS_SAMPLER 1
+#define RENDER_DESCRIPTORS_RENDER_TARGET 2
+#define RENDER_TOTAL_DESCRIPTOR_TYPES 3
+
+#define RENDER_FILTER_POINT 0
+#define RENDER_FILTER_LINEAR 1
+
+#define RENDER_ADDRESS_WRAP 0
+#define RENDER_ADDRESS_CLAMP 1
+
+#define RENDER_BARRIER_TRANSITION 0
+#define RENDER_BARRIER_ALIASING 1
+
+#define RENDER_SPLIT_NONE 0
+#define RENDER_SPLIT_BEGIN 1
+#define RENDER_SPLIT_END 2
+
+#define RENDER_FORMAT_UNKNOWN 0
+#define RENDER_FORMAT_R8G8B8A8_UNORM 1
+#define RENDER_FORMAT_R16G16B16A16_FLOAT 2
+#define RENDER_FORMAT_R32G32_FLOAT 3
+#define RENDER_FORMAT_R32G32B32_FLOAT 4
+#define RENDER_FORMAT_D32_FLOAT 5
+#define RENDER_FORMAT_R16G16B16A16_UNORM 6
+#define RENDER_FORMAT_R16G16_SNORM 7
+#define RENDER_FORMAT_R16G16_FLOAT 8
+#define RENDER_FORMAT_R8G8B8A8_SNORM 9
+#define RENDER_FORMAT_R8_UNORM 10
+#define RENDER_FORMAT_R8G8_UNORM 11
+#define RENDER_FORMAT_R32_FLOAT 12
+#define RENDER_FORMAT_BC1_UNORM 13
+#define RENDER_FORMAT_BC4_UNORM 14
+#define RENDER_FORMAT_BC4_SNORM 15
+#define RENDER_FORMAT_BC5_UNORM 16
+#define RENDER_TOTAL_FORMATS 17
+
+#define RENDER_CULL_NONE 0
+#define RENDER_CULL_FRONT 1
+#define RENDER_CULL_BACK 2
+
+#define RENDER_BLEND_NONE 0
+#define RENDER_BLEND_ALPHA 1
+#define RENDER_BLEND_ADDITIVE 2
+
+#define RENDER_COMPARE_LESS 0
+#define RENDER_COMPARE_LESS_EQUAL 1
+#define RENDER_COMPARE_GREATER 2
+#define RENDER_COMPARE_ALWAYS 3
+
+#define RENDER_MAX_VERTEX_ATTRIBUTES 8
+#define RENDER_MAX_RENDER_TARGETS 8
+//root signatures start with this many 32 bit constants at b0, which setGraphicsConstants writes
+#define RENDER_MAX_GRAPHICS_CONSTANTS 16
+
+//placed buffers start at multiples of this in their heap
+#define RENDER_PLACEMENT_ALIGNMENT KILOBYTE(64)
+
+//copies into textures read rows this far apart, starting at RENDER_TEXTURE_COPY_ALIGNMENT in the source buffer
+#define RENDER_TEXTURE_ROW_ALIGNMENT 256
+#define RENDER_TEXTURE_COPY_ALIGNMENT 512
+
+//constant buffer views need 256 byte aligned addresses and sizes
+#define RENDER_CONSTANT_BUFFER_ALIGNMENT 256
+#define RENDER_MAX_CONSTANT_BUFFER_SIZE KILOBYTE(64)
+
+//descriptor is the backend's view of the resource, the render target view for back buffers.
+//A copy with gpuAddress and size narrowed to part of a buffer is a view of it that setVertexBuffer and
+//setIndexBuffer accept; copies take their offsets into the whole buffer.
+struct RenderResource {
+    void* handle;
+    u64 gpuAddress;
+    u64 descriptor;
+    u64 size;
+    u32 heap;
+};
+
+struct RenderFence {
+    void* handle;
+};
+
+struct RenderPipeline {
+    void* handle;
+    void* rootSignature;
+};
+
+//cpuStart and gpuStart address descriptor 0, each further one is increment bytes on; gpuStart is 0 when the heap is
+//not shader visible
+struct RenderDescriptorHeap {
+    void* handle;
+    u64 cpuStart;
+    u64 gpuStart;
+    u32 increment;
+    u32 capacity;
+    u32 type;
+};
+
+struct RenderShaderCode {
+    void* code;
+    u32 size;
+};
+
+struct RenderVertexAttribute {
+    const s8* semantic;
+    u32 semanticIndex;
+    u32 format;
+    u32 offset;
+};
+
+//depthWrite and depthCompare only count with depthTest on, and a sampleCount of 0 is 1. Front faces wind clockwise
+//unless frontCounterClockwise is set; code building geometry or bounds for a pipeline takes the winding from here.
+struct RenderPipelineDesc {
+    void* rootSignature;
+    RenderShaderCode vertexShader;
+    RenderShaderCode pixelShader;
+    RenderVertexAttribute attributes[RENDER_MAX_VERTEX_ATTRIBUTES];
+    u32 totalAttributes;
+    u32 cullMode;
+    u32 blendMode;
+    u32 depthCompare;
+    u32 renderTargetFormats[RENDER_MAX_RENDER_TARGETS];
+    u32 totalRenderTargets;
+    u32 depthFormat;
+    u32 sampleCount;
+    bool wireframe;
+    bool frontCounterClockwise;
+    bool depthTest;
+    bool depthWrite;
+};
+
+struct RenderPipelineLibrary {
+    void* handle;
+};
+
+//resource is the buffer taking over the memory for aliasing barriers, before and after are unused
+struct RenderBarrier {
+    RenderResource* resource;
+    u32 type;
+    u32 split;
+    u32 before;
+    u32 after;
+};
+
+struct RenderMemoryHeap {
+    void* handle;
+    u64 size;
+};
+
+struct RenderBackend;
+
+struct RenderCommandList {
+    void* handle;
+    RenderBackend* backend;
+    u32 queue;
+};
+
+struct RenderBackend {
+    bool (*createBuffer)(RenderBackend* backend, u64 size, u32 heap, u32 initialState, RenderResource* buffer);
+    void (*destroyResource)(RenderBackend* backend, RenderResource* resource);
+    void* (*mapResource)(RenderBackend* backend, RenderResource* resource);
+    void (*unmapResource)(RenderBackend* backend, RenderResource* resource);
+    bool (*createFence)(RenderBackend* backend, u64 initialValue, RenderFence* fence);
+    bool (*createCommandList)(RenderBackend* backend, u32 queue, RenderCommandList* list);
+    RenderResource* (*getBackBuffer)(RenderBackend* backend, u32 index);
+    u32 (*getCurrentBackBufferIndex)(RenderBackend* backend);
+    bool (*createDescriptorHeap)(RenderBackend* backend, u32 type, u32 capacity, RenderDescriptorHeap* heap);
+    void (*createConstantBufferView)(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index, u64 gpuAddress,
+                                     u32 size);
+    void (*createBufferShaderView)(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index,
+                                   RenderResource* buffer, u64 firstElement, u32 totalElements, u32 stride);
+    void (*createRenderTargetView)(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index,
+                                   RenderResource* target);
+    void (*createSampler)(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index, u32 filter, u32 addressMode);
+    bool (*createTexture2D)(RenderBackend* backend, u32 width, u32 height, u32 format, u32 mipLevels, u32 initialState,
+                            RenderResource* texture);
+    //views the levels from mostDetailedMip down to the smallest, the finer ones are never sampled
+    void (*createTextureShaderView)(RenderBackend* backend, RenderDescriptorHeap* heap, u32 index,
+                                    RenderResource* texture, u32 mostDetailedMip);
+    bool (*createMemoryHeap)(RenderBackend* backend, u64 size, RenderMemoryHeap* heap);
+    bool (*createPlacedBuffer)(RenderBackend* backend, RenderMemoryHeap* heap, u64 offset, u64 size, u32 initialState,
+                               RenderResource* buffer);
+    void (*destroyMemoryHeap)(RenderBackend* backend, RenderMemoryHeap* heap);
+    bool (*createPipeline)(RenderBackend* backend, RenderPipelineDesc* desc, RenderPipeline* pipeline);
+    void (*destroyPipeline)(RenderBackend* backend, RenderPipeline* pipeline);
+    bool (*createPipelineLibrary)(RenderBackend* backend, void* data, u64 size, RenderPipelineLibrary* library);
+    //returns the size written, or the size needed when data is 0, and 0 on failure
+    u64 (*serializePipelineLibrary)(RenderBackend* backend, RenderPipelineLibrary* library, void* data, u64 capacity);
+    void (*destroyPipelineLibrary)(RenderBackend* backend, RenderPipelineLibrary* library);
+    //false when the library has nothing under key or what it has was made from a different desc
+    bool (*loadPipeline)(RenderBackend* backend, RenderPipelineLibrary* library, u64 key, RenderPipelineDesc* desc,
+                         RenderPipeline* pipeline);
+    bool (*storePipeline)(RenderBackend* backend, RenderPipelineLibrary* library, u64 key, RenderPipeline* pipeline);
+
+    void (*executeCommandLists)(RenderBackend* backend, RenderCommandList** lists, u32 totalLists);
+    void (*signalFence)(RenderBackend* backend, u32 queue, RenderFence* fence, u64 value);
+    u64 (*getCompletedFenceValue)(RenderBackend* backend, RenderFence* fence);
+    void (*waitForFence)(RenderBackend* backend, RenderFence* fence, u64 value);
+    void (*waitForFenceOnQueue)(RenderBackend* backend, u32 queue, RenderFence* fence, u64 value);
+    bool (*present)(RenderBackend* backend, u32 syncInterval);
+    void (*setMaximumFrameLatency)(RenderBackend* backend, u32 maxLatency);
+    void (*waitForPresent)(RenderBackend* backend);
+    u64 (*readTimestamp)(RenderBackend* backend, u32 index);
+    u64 (*getMicroseconds)(RenderBackend* backend);
+    void (*sleepMicroseconds)(RenderBackend* backend, u64 microseconds);
+
+    void (*resetCommandList)(RenderCommandList* list, u32 allocatorIndex, RenderPipeline* pipeline);
+    void (*closeCommandList)(RenderCommandList* list);
+    void (*transitionResource)(RenderCommandList* list, RenderResource* resource, u32 before, u32 after);
+    void (*insertBarriers)(RenderCommandList* list, RenderBarrier* barriers, u32 totalBarriers);
+    void (*setDescriptorHeaps)(RenderCommandList* list, RenderDescriptorHeap* resources, RenderDescriptorHeap* samplers);
+    void (*setViewport)(RenderCommandList* list, f32 x, f32 y, f32 width, f32 height);
+    void (*setRenderTarget)(RenderCommandList* list, RenderResource* target);
+    void (*clearRenderTarget)(RenderCommandList* list, RenderResource* target, Vector4 color);
+    void (*setPipeline)(RenderCommandList* list, RenderPipeline* pipeline);
+    void (*setVertexBuffer)(RenderCommandList* list, RenderResource* buffer, u32 stride);
+    void (*setIndexBuffer)(RenderCommandList* list, RenderResource* buffer, u32 indexFormat);
+    //needs a pipeline set, the constants keep until the next pipeline
+    void (*setGraphicsConstants)(RenderCommandList* list, u32 firstConstant, u32 totalConstants, void* data);
+    void (*drawIndexed)(RenderCommandList* list, u32 totalIndices, u32 totalInstances, u32 firstIndex, s32 baseVertex);
+    void (*copyBuffer)(RenderCommandList* list, RenderResource* dst, u64 dstOffset, RenderResource* src, u64 srcOffset,
+                       u64 size);
+    //x, y, width and height are in pixels of the level and have to cover whole blocks, apart from where the level ends
+    void (*copyBufferToTexture)(RenderCommandList* list, RenderResource* dst, u32 mipLevel, u32 x, u32 y, u32 width,
+                                u32 height, RenderResource* src, u64 srcOffset, u32 srcRowPitch);
+    void (*writeTimestamp)(RenderCommandList* list, u32 index);
+
+    void* data;
+    u32 totalBackBuffers;
+    u32 width;
+    u32 height;
+};
+
+static bool isRenderFormatBlockCompressed(u32 format){
+    return format >= RENDER_FORMAT_BC1_UNORM && format <= RENDER_FORMAT_BC5_UNORM;
+}
+
+//bytes of one pixel, or of one 4x4 block for block compressed formats
+static u32 getRenderFormatBytes(u32 format){
+    static const u32 bytes[RENDER_TOTAL_FORMATS] = {0, 4, 8, 8, 12, 4, 8, 4, 4, 4, 1, 2, 4, 8, 8, 8, 16};
+    return format < RENDER_TOTAL_FORMATS ? bytes[format] : 0;
+}
+
+//a row of a texture region is one row of pixels or of blocks
+static u32 getRenderTextureRowSize(u32 format, u32 width){
+    u32 block = isRenderFormatBlockCompressed(format) ? 4 : 1;
+    return (width + block - 1) / block * getRenderFormatBytes(format);
+}
+
+static u32 getRenderTextureRows(u32 format, u32 height){
+    u32 block = isRenderFormatBlockCompressed(format) ? 4 : 1;
+    return (height + block - 1) / block;
+}
+
+static u32 getRenderTextureLevelDimension(u32 size, u32 level){
+    u32 dimension = size >> level;
+    return dimension ? dimension : 1;
+}
+
+static u64 getRenderTextureSize(u32 format, u32 width, u32 height, u32 mipLevels){
+    u64 size = 0;
+    for(u32 i = 0; i < mipLevels; i++){
+        u32 levelWidth = getRenderTextureLevelDimension(width, i);
+        u32 levelHeight = getRenderTextureLevelDimension(height, i);
+        size += (u64)getRenderTextureRowSize(format, levelWidth) * getRenderTextureRows(format, levelHeight);
+    }
+    return size;
+}
+
+//Hashes what the pipeline is made of rather than the bytes of the desc, so descs that make the same pipeline hash
+//the same in any run: unused slots, states that do not count and where the strings and shaders live are left out.
+//The root signature is left out too, a pointer to it means nothing to the next run.
+static u64 hashRenderPipelineDesc(RenderPipelineDesc* desc){
+    u32 state[13 + RENDER_MAX_RENDER_TARGETS + RENDER_MAX_VERTEX_ATTRIBUTES * 3];
+    u32 totalState = 0;
+    u32 totalRenderTargets = desc->totalRenderTargets < RENDER_MAX_RENDER_TARGETS ?
+                             desc->totalRenderTargets : RENDER_MAX_RENDER_TARGETS;
+    u32 totalAttributes = desc->totalAttributes < RENDER_MAX_VERTEX_ATTRIBUTES ?
+                          desc->totalAttributes : RENDER_MAX_VERTEX_ATTRIBUTES;
+    state[totalState++] = desc->cullMode;
+    state[totalState++] = desc->blendMode;
+    state[totalState++] = desc->wireframe;
+    state[totalState++] = desc->frontCounterClockwise;
+    state[totalState++] = desc->depthTest;
+    state[totalState++] = desc->depthTest ? desc->depthWrite : 0;
+    state[totalState++] = desc->depthTest ? desc->depthCompare : 0;
+    state[totalState++] = desc->depthFormat;
+    state[totalState++] = desc->sampleCount ? desc->sampleCount : 1;
+    state[totalState++] = desc->vertexShader.size;
+    state[totalState++] = desc->pixelShader.size;
+    state[totalState++] = totalRenderTargets;
+    for(u32 i = 0; i < totalRenderTargets; i++){
+        state[totalState++] = desc->renderTargetFormats[i];
+    }
+    state[totalState++] = totalAttributes;
+    for(u32 i = 0; i < totalAttributes; i++){
+        state[totalState++] = desc->attributes[i].semanticIndex;
+        state[totalState++] = desc->attributes[i].format;
+        state[totalState++] = desc->attributes[i].offset;
+    }
+    u64 hash = hashMemory(state, totalState * sizeof(u32));
+    for(u32 i = 0; i < totalAttributes; i++){
+        const s8* semantic = desc->attributes[i].semantic;
+        u32 length = 0;
+        while(semantic && semantic[length]) length++;
+        hash = hashMemory((void*)semantic, length, hash);
+    }
+    hash = hashMemory(desc->vertexShader.code, desc->vertexShader.size, hash);
+    return hashMemory(desc->pixelShader.code, desc->pixelShader.size, hash);
+}
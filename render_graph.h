@@ -0,0 +1,473 @@
+#pragma once
+
+#include "render_backend.h"
+
+//Render graph.
+//A frame described as passes that declare which resources they read and write and in which state, instead of
+//passes recording their own barriers. Resources are imported, buffers the caller owns with the state they are in
+//before the graph runs and must be in after, or transient, buffers that only live between the passes using them.
+//compileRenderGraph does all the planning on the CPU, touching no backend, so a graph can be built and checked
+//anywhere:
+//Passes are culled walking backwards from the ones with side effects and the ones writing imported resources;
+//anything else only survives if a surviving pass reads what it writes.
+//Every state change becomes one transition. A change that is needed passes after the last use of the old state is
+//split, begun right after that use and ended right before the new one, so the GPU has the passes in between to do it.
+//The transitions and aliasing barriers due before a pass are recorded as one batch.
+//Transients are placed in one memory heap, first fit by size, at offsets where they only overlap transients whose
+//first to last use does not overlap theirs. A transient sharing memory with another gets an aliasing barrier before
+//its first use each frame, and its state carries over from the previous frame, so it is created in the state its last
+//use leaves it in and every frame, the first included, runs the same barriers.
+//executeRenderGraph creates the heap and transients the first time it runs, then records the batches and passes.
+//The graph is compiled once and executed every frame; setRenderGraphImport swaps imported buffers, the back buffer for
+//instance, without compiling again.
+
+#define RENDER_GRAPH_MAX_PASSES 64
+#define RENDER_GRAPH_MAX_RESOURCES 64
+#define RENDER_GRAPH_MAX_PASS_ACCESSES 8
+#define RENDER_GRAPH_MAX_BARRIERS 256
+#define RENDER_GRAPH_NONE MAX_U32
+
+struct RenderGraphAccess {
+    u32 resource;
+    u32 state;
+    bool write;
+};
+
+struct RenderGraphPass {
+    const s8* name;
+    void (*execute)(RenderCommandList* list, void* userData);
+    void* userData;
+    RenderGraphAccess accesses[RENDER_GRAPH_MAX_PASS_ACCESSES];
+    u32 totalAccesses;
+    bool sideEffects;
+    bool culled;
+};
+
+//firstUse and lastUse count surviving passes in order, RENDER_GRAPH_NONE when no surviving pass uses the resource
+struct RenderGraphResource {
+    const s8* name;
+    RenderResource* imported;
+    RenderResource buffer;
+    u64 size;
+    u64 heapOffset;
+    u32 initialState;
+    u32 finalState;
+    u32 firstUse;
+    u32 lastUse;
+    bool aliased;
+};
+
+struct RenderGraphBarrier {
+    u32 resource;
+    u32 type;
+    u32 split;
+    u32 before;
+    u32 after;
+};
+
+//barriers counts whole transitions, split ones included once; batches counts the backend calls they take
+struct RenderGraphStats {
+    u32 passes;
+    u32 culledPasses;
+    u32 barriers;
+    u32 splitBarriers;
+    u32 aliasingBarriers;
+    u32 batches;
+    u32 transients;
+    u64 transientBytes;
+    u64 heapBytes;
+};
+
+struct RenderGraph {
+    RenderGraphPass passes[RENDER_GRAPH_MAX_PASSES];
+    u32 totalPasses;
+    RenderGraphResource resources[RENDER_GRAPH_MAX_RESOURCES];
+    u32 totalResources;
+
+    //surviving passes in order, batch k is recorded before order[k] and batch totalOrder after the last pass
+    u32 order[RENDER_GRAPH_MAX_PASSES];
+    u32 totalOrder;
+    RenderGraphBarrier barriers[RENDER_GRAPH_MAX_BARRIERS];
+    u32 totalBarriers;
+    u32 batchStarts[RENDER_GRAPH_MAX_PASSES + 2];
+
+    RenderMemoryHeap heap;
+    u64 heapSize;
+    bool compiled;
+    bool realized;
+    RenderGraphStats stats;
+};
+
+static void initializeRenderGraph(RenderGraph* graph){
+    setMemory(graph, sizeof(RenderGraph));
+}
+
+static u32 addRenderGraphResource(RenderGraph* graph, const s8* name){
+    if(graph->compiled || graph->totalResources == RENDER_GRAPH_MAX_RESOURCES){
+        return RENDER_GRAPH_NONE;
+    }
+    RenderGraphResource* resource = &graph->resources[graph->totalResources];
+    setMemory(resource, sizeof(RenderGraphResource));
+    resource->name = name;
+    return graph->totalResources++;
+}
+
+static u32 importRenderGraphResource(RenderGraph* graph, const s8* name, RenderResource* imported, u32 initialState,
+                                     u32 finalState){
+    u32 handle = addRenderGraphResource(graph, name);
+    if(handle != RENDER_GRAPH_NONE){
+        RenderGraphResource* resource = &graph->resources[handle];
+        resource->imported = imported;
+        resource->size = imported->size;
+        resource->initialState = initialState;
+        resource->finalState = finalState;
+    }
+    return handle;
+}
+
+static u32 createRenderGraphBuffer(RenderGraph* graph, const s8* name, u64 size){
+    if(!size){
+        return RENDER_GRAPH_NONE;
+    }
+    u32 handle = addRenderGraphResource(graph, name);
+    if(handle != RENDER_GRAPH_NONE){
+        graph->resources[handle].size = size;
+    }
+    return handle;
+}
+
+//the buffer has to be in the same states the import was declared with
+static void setRenderGraphImport(RenderGraph* graph, u32 handle, RenderResource* imported){
+    graph->resources[handle].imported = imported;
+}
+
+//valid inside pass callbacks once the graph has been executed
+static RenderResource* getRenderGraphBuffer(RenderGraph* graph, u32 handle){
+    RenderGraphResource* resource = &graph->resources[handle];
+    return resource->imported ? resource->imported : &resource->buffer;
+}
+
+//sideEffects keeps the pass even when nothing reads what it writes
+static u32 addRenderGraphPass(RenderGraph* graph, const s8* name, void (*execute)(RenderCommandList* list, void* userData),
+                              void* userData, bool sideEffects = false){
+    if(graph->compiled || graph->totalPasses == RENDER_GRAPH_MAX_PASSES){
+        return RENDER_GRAPH_NONE;
+    }
+    RenderGraphPass* pass = &graph->passes[graph->totalPasses];
+    setMemory(pass, sizeof(RenderGraphPass));
+    pass->name = name;
+    pass->execute = execute;
+    pass->userData = userData;
+    pass->sideEffects = sideEffects;
+    return graph->totalPasses++;
+}
+
+static bool addRenderGraphAccess(RenderGraph* graph, u32 pass, u32 resource, u32 state, bool write){
+    if(graph->compiled || pass >= graph->totalPasses || resource >= graph->totalResources || state >= RENDER_TOTAL_STATES){
+        return false;
+    }
+    RenderGraphPass* graphPass = &graph->passes[pass];
+    if(graphPass->totalAccesses == RENDER_GRAPH_MAX_PASS_ACCESSES){
+        return false;
+    }
+    RenderGraphAccess* access = &graphPass->accesses[graphPass->totalAccesses++];
+    access->resource = resource;
+    access->state = state;
+    access->write = write;
+    return true;
+}
+
+static bool readRenderGraphResource(RenderGraph* graph, u32 pass, u32 resource, u32 state){
+    return addRenderGraphAccess(graph, pass, resource, state, false);
+}
+
+//a pass that reads what it writes, like a blend into a render target, has to declare the read as well
+static bool writeRenderGraphResource(RenderGraph* graph, u32 pass, u32 resource, u32 state){
+    return addRenderGraphAccess(graph, pass, resource, state, true);
+}
+
+static void cullRenderGraphPasses(RenderGraph* graph){
+    bool needed[RENDER_GRAPH_MAX_RESOURCES];
+    for(u32 i = 0; i < graph->totalResources; i++){
+        needed[i] = graph->resources[i].imported != 0;
+    }
+    for(u32 p = graph->totalPasses; p-- > 0;){
+        RenderGraphPass* pass = &graph->passes[p];
+        bool kept = pass->sideEffects;
+        for(u32 i = 0; i < pass->totalAccesses; i++){
+            if(pass->accesses[i].write && needed[pass->accesses[i].resource]){
+                kept = true;
+            }
+        }
+        pass->culled = !kept;
+        if(!kept){
+            continue;
+        }
+        for(u32 i = 0; i < pass->totalAccesses; i++){
+            if(!pass->accesses[i].write){
+                needed[pass->accesses[i].resource] = true;
+            }
+        }
+    }
+    graph->totalOrder = 0;
+    for(u32 p = 0; p < graph->totalPasses; p++){
+        if(!graph->passes[p].culled){
+            graph->order[graph->totalOrder++] = p;
+        }
+    }
+}
+
+//the state the kth surviving pass needs the resource in, RENDER_GRAPH_NONE when it does not use it
+static u32 getRenderGraphPassState(RenderGraph* graph, u32 k, u32 resource){
+    RenderGraphPass* pass = &graph->passes[graph->order[k]];
+    for(u32 i = 0; i < pass->totalAccesses; i++){
+        if(pass->accesses[i].resource == resource){
+            return pass->accesses[i].state;
+        }
+    }
+    return RENDER_GRAPH_NONE;
+}
+
+static void placeRenderGraphTransients(RenderGraph* graph){
+    u32 placed[RENDER_GRAPH_MAX_RESOURCES];
+    u32 totalPlaced = 0;
+    RenderGraphStats* stats = &graph->stats;
+    graph->heapSize = 0;
+    for(u32 r = 0; r < graph->totalResources; r++){
+        RenderGraphResource* resource = &graph->resources[r];
+        if(resource->imported || resource->firstUse == RENDER_GRAPH_NONE){
+            continue;
+        }
+        resource->size = (resource->size + RENDER_PLACEMENT_ALIGNMENT - 1) & ~(u64)(RENDER_PLACEMENT_ALIGNMENT - 1);
+        //largest first, so the small ones fill the gaps they leave
+        u32 i = totalPlaced++;
+        while(i && graph->resources[placed[i - 1]].size < resource->size){
+            placed[i] = placed[i - 1];
+            i--;
+        }
+        placed[i] = r;
+        stats->transients++;
+        stats->transientBytes += resource->size;
+    }
+    for(u32 i = 0; i < totalPlaced; i++){
+        RenderGraphResource* resource = &graph->resources[placed[i]];
+        //the lowest offset clear of every transient live at the same time is 0 or the end of one of them, and past
+        //the end of all of them always is
+        u64 offset = MAX_U64;
+        for(u32 candidate = 0; candidate <= i; candidate++){
+            u64 start = 0;
+            if(candidate){
+                RenderGraphResource* other = &graph->resources[placed[candidate - 1]];
+                start = other->heapOffset + other->size;
+            }
+            bool clear = start < offset;
+            for(u32 j = 0; j < i && clear; j++){
+                RenderGraphResource* other = &graph->resources[placed[j]];
+                bool liveTogether = other->firstUse <= resource->lastUse && resource->firstUse <= other->lastUse;
+                bool overlaps = other->heapOffset < start + resource->size && start < other->heapOffset + other->size;
+                clear = !(liveTogether && overlaps);
+            }
+            if(clear){
+                offset = start;
+            }
+        }
+        resource->heapOffset = offset;
+        if(offset + resource->size > graph->heapSize){
+            graph->heapSize = offset + resource->size;
+        }
+    }
+    for(u32 i = 0; i < totalPlaced; i++){
+        RenderGraphResource* resource = &graph->resources[placed[i]];
+        for(u32 j = 0; j < totalPlaced; j++){
+            RenderGraphResource* other = &graph->resources[placed[j]];
+            if(i != j && other->heapOffset < resource->heapOffset + resource->size &&
+               resource->heapOffset < other->heapOffset + other->size){
+                resource->aliased = true;
+            }
+        }
+    }
+    stats->heapBytes = graph->heapSize;
+}
+
+//plans a transition from the use of the old state in pass lastUse to pass k, RENDER_GRAPH_NONE lastUse meaning the
+//resource is free from the start of the graph
+static bool addRenderGraphTransition(RenderGraph* graph, u32* batches, u32 resource, u32 lastUse, u32 k, u32 before,
+                                     u32 after){
+    u32 begin = lastUse == RENDER_GRAPH_NONE ? 0 : lastUse + 1;
+    u32 needed = begin < k ? 2 : 1;
+    if(graph->totalBarriers + needed > RENDER_GRAPH_MAX_BARRIERS){
+        return false;
+    }
+    RenderGraphBarrier barrier = {resource, RENDER_BARRIER_TRANSITION, RENDER_SPLIT_NONE, before, after};
+    if(needed == 2){
+        barrier.split = RENDER_SPLIT_BEGIN;
+        batches[graph->totalBarriers] = begin;
+        graph->barriers[graph->totalBarriers++] = barrier;
+        barrier.split = RENDER_SPLIT_END;
+        graph->stats.splitBarriers++;
+    }
+    batches[graph->totalBarriers] = k;
+    graph->barriers[graph->totalBarriers++] = barrier;
+    graph->stats.barriers++;
+    return true;
+}
+
+static bool planRenderGraphBarriers(RenderGraph* graph){
+    u32 batches[RENDER_GRAPH_MAX_BARRIERS];
+    graph->totalBarriers = 0;
+    for(u32 r = 0; r < graph->totalResources; r++){
+        RenderGraphResource* resource = &graph->resources[r];
+        if(!resource->imported && resource->firstUse == RENDER_GRAPH_NONE){
+            continue;
+        }
+        u32 state = resource->imported ? resource->initialState : resource->finalState;
+        u32 lastUse = RENDER_GRAPH_NONE;
+        if(resource->aliased){
+            if(graph->totalBarriers == RENDER_GRAPH_MAX_BARRIERS){
+                return false;
+            }
+            RenderGraphBarrier aliasing = {r, RENDER_BARRIER_ALIASING, RENDER_SPLIT_NONE, 0, 0};
+            batches[graph->totalBarriers] = resource->firstUse;
+            graph->barriers[graph->totalBarriers++] = aliasing;
+            graph->stats.aliasingBarriers++;
+            //the memory belongs to other transients until the aliasing barrier, nothing can start earlier
+            lastUse = resource->firstUse ? resource->firstUse - 1 : RENDER_GRAPH_NONE;
+        }
+        for(u32 k = 0; k < graph->totalOrder; k++){
+            u32 needed = getRenderGraphPassState(graph, k, r);
+            if(needed == RENDER_GRAPH_NONE){
+                continue;
+            }
+            if(needed != state && !addRenderGraphTransition(graph, batches, r, lastUse, k, state, needed)){
+                return false;
+            }
+            state = needed;
+            lastUse = k;
+        }
+        if(resource->imported && state != resource->finalState &&
+           !addRenderGraphTransition(graph, batches, r, lastUse, graph->totalOrder, state, resource->finalState)){
+            return false;
+        }
+    }
+
+    //stable bucket sort by batch, a resource's own barriers stay in the order they were planned
+    RenderGraphBarrier planned[RENDER_GRAPH_MAX_BARRIERS];
+    copyMemory(planned, graph->barriers, sizeof(RenderGraphBarrier) * graph->totalBarriers);
+    u32 totalBatches = graph->totalOrder + 1;
+    setMemory(graph->batchStarts, sizeof(graph->batchStarts));
+    for(u32 i = 0; i < graph->totalBarriers; i++){
+        graph->batchStarts[batches[i] + 1]++;
+    }
+    for(u32 k = 0; k < totalBatches; k++){
+        if(graph->batchStarts[k + 1]){
+            graph->stats.batches++;
+        }
+        graph->batchStarts[k + 1] += graph->batchStarts[k];
+    }
+    u32 cursors[RENDER_GRAPH_MAX_PASSES + 1];
+    copyMemory(cursors, graph->batchStarts, sizeof(u32) * totalBatches);
+    for(u32 i = 0; i < graph->totalBarriers; i++){
+        graph->barriers[cursors[batches[i]]++] = planned[i];
+    }
+    return true;
+}
+
+//false when a pass needs one resource in two states or the graph outgrows its limits
+static bool compileRenderGraph(RenderGraph* graph){
+    setMemory(&graph->stats, sizeof(RenderGraphStats));
+    cullRenderGraphPasses(graph);
+    for(u32 r = 0; r < graph->totalResources; r++){
+        RenderGraphResource* resource = &graph->resources[r];
+        resource->firstUse = RENDER_GRAPH_NONE;
+        resource->lastUse = RENDER_GRAPH_NONE;
+        resource->aliased = false;
+    }
+    for(u32 k = 0; k < graph->totalOrder; k++){
+        RenderGraphPass* pass = &graph->passes[graph->order[k]];
+        for(u32 i = 0; i < pass->totalAccesses; i++){
+            RenderGraphAccess* access = &pass->accesses[i];
+            RenderGraphResource* resource = &graph->resources[access->resource];
+            if(getRenderGraphPassState(graph, k, access->resource) != access->state){
+                return false;
+            }
+            if(resource->firstUse == RENDER_GRAPH_NONE){
+                resource->firstUse = k;
+            }
+            resource->lastUse = k;
+            //a transient starts every frame in the state the previous frame left it in
+            if(!resource->imported){
+                resource->finalState = access->state;
+            }
+        }
+    }
+    graph->stats.passes = graph->totalOrder;
+    graph->stats.culledPasses = graph->totalPasses - graph->totalOrder;
+    placeRenderGraphTransients(graph);
+    if(!planRenderGraphBarriers(graph)){
+        return false;
+    }
+    graph->compiled = true;
+    return true;
+}
+
+static bool realizeRenderGraph(RenderGraph* graph, RenderBackend* backend){
+    if(graph->heapSize && !backend->createMemoryHeap(backend, graph->heapSize, &graph->heap)){
+        return false;
+    }
+    for(u32 r = 0; r < graph->totalResources; r++){
+        RenderGraphResource* resource = &graph->resources[r];
+        if(resource->imported || resource->firstUse == RENDER_GRAPH_NONE){
+            continue;
+        }
+        if(!backend->createPlacedBuffer(backend, &graph->heap, resource->heapOffset, resource->size,
+                                        resource->finalState, &resource->buffer)){
+            return false;
+        }
+    }
+    graph->realized = true;
+    return true;
+}
+
+//the gpu has to be done with every frame that executed the graph
+static void destroyRenderGraph(RenderGraph* graph, RenderBackend* backend){
+    for(u32 r = 0; r < graph->totalResources; r++){
+        if(graph->resources[r].buffer.handle){
+            backend->destroyResource(backend, &graph->resources[r].buffer);
+        }
+    }
+    if(graph->heap.handle){
+        backend->destroyMemoryHeap(backend, &graph->heap);
+    }
+    graph->realized = false;
+}
+
+static void insertRenderGraphBatch(RenderGraph* graph, RenderCommandList* list, u32 batch){
+    RenderBarrier barriers[RENDER_GRAPH_MAX_BARRIERS];
+    u32 totalBarriers = 0;
+    for(u32 i = graph->batchStarts[batch]; i < graph->batchStarts[batch + 1]; i++){
+        RenderGraphBarrier* planned = &graph->barriers[i];
+        RenderBarrier* barrier = &barriers[totalBarriers++];
+        barrier->resource = getRenderGraphBuffer(graph, planned->resource);
+        barrier->type = planned->type;
+        barrier->split = planned->split;
+        barrier->before = planned->before;
+        barrier->after = planned->after;
+    }
+    if(totalBarriers){
+        list->backend->insertBarriers(list, barriers, totalBarriers);
+    }
+}
+
+//records the whole graph on list, false if the graph is not compiled or its transients could not be created
+static bool executeRenderGraph(RenderGraph* graph, RenderCommandList* list){
+    if(!graph->compiled || (!graph->realized && !realizeRenderGraph(graph, list->backend))){
+        return false;
+    }
+    for(u32 k = 0; k < graph->totalOrder; k++){
+        insertRenderGraphBatch(graph, list, k);
+        RenderGraphPass* pass = &graph->passes[graph->order[k]];
+        pass->execute(list, pass->userData);
+    }
+    insertRenderGraphBatch(graph, list, graph->totalOrder);
+    return true;
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "model_store.h"
+#include "texture_store.h"
+#include "image_loaders.h"
+#include "texture_streaming.h"
+#include "cubemap_prefilter.h"
+#include "asset_registry.h"
+
+//The scratch triangle, recorded through the backend interface so dx12_scratch.cpp and headless.cpp draw the same frame.
+//It is created through os->createModel3D like any other model, which puts it in the platform layer's model store.
+//It is drawn totalDraws times, so the draws can be spread over several command lists to load the CPU side of
+//recording; recordScratchDraws records any run of them onto a list that already has its target and pipeline bound.
+//A checker texture is made through the same path a loaded image takes, createTexture2DFromImage generating its mips
+//and encoding them to BC1 and os->createTexture2DMipmapped putting it in the platform layer's texture store, and the
+//scene waits for it too.
+//addScratchStreamedModels writes a row of BC1 DDS files and loads them through the asset registry's
+//acquireTexture2D, which calls os->createTexture2DFromFile the first time and streams them, onto copies of the triangle. streamScratchScene flies the scene's camera along the row and back and
+//gives the texture streaming manager their projected sizes as feedback, the way a renderer would for what it draws.
+//A gradient sky is made through os->createTextureCube, which bakes it into a StoredIBLEnvironment, and the triangle is
+//drawn with the sky's irradiance around its normal as graphics constants 8 to 11, red when there is no sky.
+
+//position, normal and uv, the layout os->createModel3D takes
+static f32 scratchVertices[] = {
+    -0.5, -0.5, 0, 0, 0, -1, 0, 1,
+    0.0, 0.5, 0, 0, 0, -1, 0.5, 0,
+    0.5, -0.5, 0, 0, 0, -1, 1, 1,
+};
+static u16 scratchIndices[] = { 0, 1, 2 };
+
+#define SCRATCH_TEXTURE_SIZE 64
+#define SCRATCH_TEXTURE_CHECKER 8
+#define SCRATCH_MAX_STREAMED_MODELS 32
+#define SCRATCH_STREAMED_TEXTURE_SIZE 256
+#define SCRATCH_STREAMED_SPACING 4.0f
+#define SCRATCH_STREAMED_DISTANCE 1.5f
+#define SCRATCH_CAMERA_SPEED 0.05f
+#define SCRATCH_STREAMED_NAME "scratch_streamed_00.dds"
+#define SCRATCH_STREAMED_NAME_DIGITS 17
+#define SCRATCH_SKY_SIZE 32
+
+struct ScratchScene {
+    ModelStore* models;
+    Model3D triangle;
+    Texture2D texture;
+    Vector4 clearColor;
+    u32 totalDraws;
+    Model3D streamedModels[SCRATCH_MAX_STREAMED_MODELS];
+    u32 totalStreamedModels;
+    Camera camera;
+    TextureCube sky;
+    Vector4 ambient;
+};
+
+//name has to hold sizeof(SCRATCH_STREAMED_NAME)
+static void getScratchStreamedTextureName(u32 index, s8* name){
+    copyMemory(name, (void*)SCRATCH_STREAMED_NAME, sizeof(SCRATCH_STREAMED_NAME));
+    name[SCRATCH_STREAMED_NAME_DIGITS] = (s8)('0' + index / 10 % 10);
+    name[SCRATCH_STREAMED_NAME_DIGITS + 1] = (s8)('0' + index % 10);
+}
+
+//a checker whose squares shrink with the index, with its mip chain encoded to BC1
+static bool writeScratchStreamedTexture(OSInterface* os, u32 index, MemoryArena* scratch){
+    u32 size = SCRATCH_STREAMED_TEXTURE_SIZE;
+    u32 levels = getMipLevelCount(size, size);
+    u64 scratchMark = scratch->used;
+    u8* pixels = pushArray(scratch, u8, size * size * 4);
+    u8* chain = pushArray(scratch, u8, getMipChainSize(size, size));
+    MipChainSettings settings = defaultMipChainSettings();
+    bool success = false;
+    if(pixels && chain){
+        u32 checker = 4 << (index % 4);
+        for(u32 i = 0; i < size * size; i++){
+            u8* pixel = pixels + i * 4;
+            bool light = (i % size / checker + i / size / checker) % 2;
+            pixel[0] = light ? 255 : 32;
+            pixel[1] = (u8)(index * 40);
+            pixel[2] = light ? 32 : 255;
+            pixel[3] = 255;
+        }
+        u8* blocks = generateMipChain(pixels, size, size, &settings, chain, scratch, os) ?
+                     compressImageChain(chain, size, size, levels, BLOCK_COMPRESSION_BC1,
+                                        BLOCK_COMPRESSION_QUALITY_FAST, scratch, os) : 0;
+        s8 name[sizeof(SCRATCH_STREAMED_NAME)];
+        getScratchStreamedTextureName(index, name);
+        success = blocks && writeDDSFile(os, name, size, size, BLOCK_COMPRESSION_BC1, levels, blocks, scratch);
+    }
+    scratch->used = scratchMark;
+    return success;
+}
+
+//Models whose texture could not be written or loaded are left out. The files stay for the streamer to read from, the
+//platform layer deletes them when it shuts down. The registry's Texture2Ds are pushed on arena.
+static void addScratchStreamedModels(ScratchScene* scene, OSInterface* os, AssetRegistry* registry, u32 count,
+                                     MemoryArena* arena, MemoryArena* scratch){
+    if(count > SCRATCH_MAX_STREAMED_MODELS){
+        count = SCRATCH_MAX_STREAMED_MODELS;
+    }
+    for(u32 i = 0; i < count; i++){
+        s8 name[sizeof(SCRATCH_STREAMED_NAME)];
+        getScratchStreamedTextureName(i, name);
+        Texture2D* texture = writeScratchStreamedTexture(os, i, scratch) ?
+                             acquireTexture2D(registry, os, name, arena) : 0;
+        if(!texture){
+            continue;
+        }
+        Model3D* model = &scene->streamedModels[scene->totalStreamedModels++];
+        *model = scene->triangle;
+        model->position = Vector3((f32)i * SCRATCH_STREAMED_SPACING, 0, 0);
+        model->scale = Vector3(1);
+        model->texture = *texture;
+    }
+    scene->camera.projection = createPerspectiveProjection(60, 16.0f / 9.0f, 0.1f, 100.0f);
+}
+
+//Once a frame before updateTextureStreaming. The camera runs along the row at a fixed distance and turns back at its
+//ends, so the textures near it want their finest levels and the ones behind it fall back to coarse ones.
+static void streamScratchScene(ScratchScene* scene, TextureStreamingManager* manager, u64 frame, f32 viewportHeight){
+    beginTextureStreamingFrame(manager);
+    if(!scene->totalStreamedModels){
+        return;
+    }
+    f32 rowLength = (f32)(scene->totalStreamedModels - 1) * SCRATCH_STREAMED_SPACING;
+    f32 travelled = (f32)frame * SCRATCH_CAMERA_SPEED;
+    f32 x = rowLength > 0 ? travelled - 2.0f * rowLength * floorf(travelled / (2.0f * rowLength)) : 0;
+    if(x > rowLength){
+        x = 2.0f * rowLength - x;
+    }
+    scene->camera.position = Vector3(x, 0, -SCRATCH_STREAMED_DISTANCE);
+    for(u32 i = 0; i < scene->totalStreamedModels; i++){
+        requestModel3DTextures(manager, &scene->streamedModels[i], &scene->camera, viewportHeight);
+    }
+}
+
+//a blue sky fading to white at the horizon over a brown ground, six RGBA8 faces in cubemap_prefilter.h's order
+static void writeScratchSky(u8* faces){
+    f32 texelSize = 2.0f / SCRATCH_SKY_SIZE;
+    for(u32 face = 0; face < 6; face++){
+        for(u32 y = 0; y < SCRATCH_SKY_SIZE; y++){
+            for(u32 x = 0; x < SCRATCH_SKY_SIZE; x++){
+                Vector3 d = cubeTexelDirection(face, (x + 0.5f) * texelSize - 1.0f, (y + 0.5f) * texelSize - 1.0f);
+                normalize(&d);
+                u8* pixel = faces + (((u64)face * SCRATCH_SKY_SIZE + y) * SCRATCH_SKY_SIZE + x) * 4;
+                f32 t = d.y > 0 ? sqrtf(d.y) : 0;
+                pixel[0] = d.y > 0 ? (u8)(230 - 170 * t) : 90;
+                pixel[1] = d.y > 0 ? (u8)(240 - 120 * t) : 70;
+                pixel[2] = d.y > 0 ? (u8)(255 - 25 * t) : 50;
+                pixel[3] = 255;
+            }
+        }
+    }
+}
+
+//The stores copy the data and fill their default memory through the copy queue in the background. scratch holds the
+//checker and its mip chain while the texture is created.
+static bool initializeScratchScene(ScratchScene* scene, OSInterface* os, ModelStore* models, MemoryArena* scratch){
+    scene->models = models;
+    scene->clearColor = Vector4(0, 1, 0, 1);
+    scene->totalDraws = 1;
+    scene->triangle = os->createModel3D(scratchVertices, sizeof(scratchVertices), scratchIndices,
+                                        sizeof(scratchIndices));
+    u64 scratchMark = scratch->used;
+    u8* pixels = pushArray(scratch, u8, SCRATCH_TEXTURE_SIZE * SCRATCH_TEXTURE_SIZE * 4);
+    if(pixels){
+        for(u32 y = 0; y < SCRATCH_TEXTURE_SIZE; y++){
+            for(u32 x = 0; x < SCRATCH_TEXTURE_SIZE; x++){
+                u8 c = (x / SCRATCH_TEXTURE_CHECKER + y / SCRATCH_TEXTURE_CHECKER) % 2 ? 255 : 32;
+                u8* pixel = pixels + (y * SCRATCH_TEXTURE_SIZE + x) * 4;
+                pixel[0] = pixel[1] = pixel[2] = c;
+                pixel[3] = 255;
+            }
+        }
+        ImageData image = {};
+        image.width = SCRATCH_TEXTURE_SIZE;
+        image.height = SCRATCH_TEXTURE_SIZE;
+        image.format = IMAGE_FORMAT_RGBA8;
+        image.totalLevels = 1;
+        image.totalFaces = 1;
+        image.levelData[0][0] = pixels;
+        image.levelSizes[0] = SCRATCH_TEXTURE_SIZE * SCRATCH_TEXTURE_SIZE * 4;
+        scene->texture = createTexture2DFromImage(os, &image, scratch, 0, 0, BLOCK_COMPRESSION_BC1);
+    }
+    scratch->used = scratchMark;
+    scene->ambient = Vector4(1, 0, 0, 1);
+    u8* sky = os->createTextureCube ? pushArray(scratch, u8, SCRATCH_SKY_SIZE * SCRATCH_SKY_SIZE * 6 * 4) : 0;
+    if(sky){
+        writeScratchSky(sky);
+        scene->sky = os->createTextureCube(sky, SCRATCH_SKY_SIZE, SCRATCH_SKY_SIZE, os->TEXTURE_FORMAT_RGBA8);
+        if(scene->sky.data1){
+            Vector3 ambient = getIBLAmbient((StoredIBLEnvironment*)scene->sky.data1, Vector3(0, 0, -1));
+            scene->ambient = Vector4(ambient.x, ambient.y, ambient.z, 1);
+        }
+    }
+    scratch->used = scratchMark;
+    return isStoredModel3DValid(&scene->triangle) && scene->texture.data1;
+}
+
+//clears the target and returns whether the models and the texture are on their way, draws have to be skipped until then
+static bool prepareScratchScene(ScratchScene* scene, RenderCommandList* list, RenderResource* target){
+    list->backend->clearRenderTarget(list, target, scene->clearColor);
+    return waitForStoredModel(scene->models, list->queue, &scene->triangle) &&
+           waitForStoredTexture((TextureStore*)scene->texture.data2, list->queue,
+                                (StoredTexture*)scene->texture.data1);
+}
+
+//userData is the scene, only reads it so several lists can record at once
+static void recordScratchDraws(RenderCommandList* list, u32 firstDraw, u32 totalDraws, void* userData){
+    ScratchScene* scene = (ScratchScene*)userData;
+    Model3D* triangle = &scene->triangle;
+    bindStoredModel3D(list, scene->models, triangle);
+    list->backend->setGraphicsConstants(list, 8, 4, &scene->ambient);
+    for(u32 i = 0; i < totalDraws; i++){
+        list->backend->drawIndexed(list, triangle->totalIndices, 1, triangle->indexOffset, (s32)triangle->vertexOffset);
+    }
+}
+
+//records the whole scene on one list, expects the target bound by beginRenderFrame
+static void drawScratchScene(ScratchScene* scene, RenderCommandList* list, RenderResource* target,
+                             RenderPipeline* pipeline){
+    if(!prepareScratchScene(scene, list, target)){
+        return;
+    }
+    list->backend->setPipeline(list, pipeline);
+    recordScratchDraws(list, 0, scene->totalDraws, scene);
+}
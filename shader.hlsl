@@ -2,6 +2,17 @@ struct VSInput {
     float3 position : POSITION;
 };
 
+struct VSQuantizedInput {
+    float4 position : POSITION;
+};
+
+//ambient is the skybox's irradiance around the surface, from scratch_scene.h
+cbuffer DrawConstants : register(b0) {
+    float4 positionMin;
+    float4 positionExtent;
+    float4 ambient;
+};
+
 struct PSInput {
     float4 position : SV_POSITION;
 };
@@ -16,9 +27,15 @@ PSInput VSMain(VSInput input){
     return output;
 }
 
+PSInput VSMainQuantized(VSQuantizedInput input){
+    PSInput output;
+    output.position = float4(positionMin.xyz + input.position.xyz * positionExtent.xyz, 1);
+    return output;
+}
+
 PSOutput PSMain(PSInput input){
     PSOutput output;
-    output.color = float4(1, 0, 0, 1);
+    output.color = float4(ambient.rgb, 1);
     return output;
 }
 
@@ -0,0 +1,310 @@
+#pragma once
+
+#include "glyph_cache.h"
+
+//Cached text layout and one draw per frame for all text.
+//drawText hashes the string together with its glyph cache, scale and wrap width. On a hit the glyph instances laid
+//out the first time are copied into the frame's batch with the position and color applied, so a static HUD string
+//costs a hash and a copy. On a miss the string is laid out with kerning and greedy word wrapping and kept.
+//Cached glyphs live in one pool; when the pool or the run table fills, runs not drawn in the last
+//TEXT_RUN_KEEP_FRAMES frames are dropped and the survivors are packed down, at most once a frame. Text that still does
+//not fit is laid out straight into the batch every time it is drawn, so too many unique strings only cost speed.
+//finishTextBatch uploads the glyph atlas; the renderer then draws the whole batch as one instanced draw of quads
+//expanded in its vertex shader, sampling the atlas texture. Atlas coordinates are in texels.
+//If the glyph atlas starts over part way through a frame, text drawn earlier that frame shows wrong glyphs for that
+//one frame; every run is laid out again on its next draw.
+
+#define TEXT_MAX_RUNS 1024
+#define TEXT_RUN_KEEP_FRAMES 2
+
+struct TextGlyphInstance {
+    f32 left;
+    f32 top;
+    f32 right;
+    f32 bottom;
+    u16 atlasLeft;
+    u16 atlasTop;
+    u16 atlasRight;
+    u16 atlasBottom;
+    u32 color;
+};
+
+struct TextRun {
+    u64 key;
+    u32 firstGlyph;
+    u32 totalGlyphs;
+    u32 atlasGeneration;
+    u32 lastUsedFrame;
+    f32 width;
+    f32 height;
+};
+
+struct TextLayoutCache {
+    TextRun runs[TEXT_MAX_RUNS];
+    TextGlyphInstance* glyphs;
+    u32 glyphCapacity;
+    u32 glyphsUsed;
+    u32 totalRuns;
+    u32 frame;
+    u32 compactedFrame;
+    TextRun uncachedRun;
+    u32 hits;
+    u32 misses;
+};
+
+struct TextBatch {
+    TextGlyphInstance* instances;
+    u32 capacity;
+    u32 totalInstances;
+};
+
+static bool initializeTextLayoutCache(TextLayoutCache* cache, u32 glyphCapacity, MemoryArena* arena){
+    setMemory(cache, sizeof(TextLayoutCache));
+    cache->glyphs = pushArray(arena, TextGlyphInstance, glyphCapacity);
+    cache->glyphCapacity = glyphCapacity;
+    cache->frame = TEXT_RUN_KEEP_FRAMES;
+    return cache->glyphs != 0;
+}
+
+static bool initializeTextBatch(TextBatch* batch, u32 capacity, MemoryArena* arena){
+    batch->instances = pushArray(arena, TextGlyphInstance, capacity);
+    batch->capacity = capacity;
+    batch->totalInstances = 0;
+    return batch->instances != 0;
+}
+
+static void beginTextFrame(TextLayoutCache* cache, TextBatch* batch){
+    cache->frame++;
+    batch->totalInstances = 0;
+}
+
+static u32 packTextColor(Vector4 color){
+    u32 r = (u32)(clamp(color.x, 0, 1) * 255.0f + 0.5f);
+    u32 g = (u32)(clamp(color.y, 0, 1) * 255.0f + 0.5f);
+    u32 b = (u32)(clamp(color.z, 0, 1) * 255.0f + 0.5f);
+    u32 a = (u32)(clamp(color.w, 0, 1) * 255.0f + 0.5f);
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+//Lays text out relative to its top left corner. Lines break at the last space once a glyph would cross wrapWidth,
+//or mid word when the word alone is wider; 0 disables wrapping. Returns the glyph count, MAX_U32 if out is too small.
+static u32 layoutTextRun(GlyphCache* font, const s8* text, f32 scale, f32 wrapWidth, TextGlyphInstance* out,
+                         u32 capacity, f32* width, f32* height){
+    f32 lineHeight = font->lineHeight * scale;
+    u32 generation = font->atlasGeneration;
+    bool restarted = false;
+    u32 count;
+    f32 y;
+    for(;;){
+        f32 x = 0;
+        y = 0;
+        count = 0;
+        u32 breakGlyph = MAX_U32;
+        f32 breakX = 0;
+        u32 previous = 0;
+        const u8* c = (const u8*)text;
+        while(*c){
+            u32 codepoint = decodeUTF8(&c);
+            if(codepoint == '\n'){
+                x = 0;
+                y += lineHeight;
+                breakGlyph = MAX_U32;
+                previous = 0;
+                continue;
+            }
+            if(previous && font->kernGlyphs){
+                x += font->kernGlyphs(font->userData, previous, codepoint) * scale;
+            }
+            previous = codepoint;
+            GlyphRecord* glyph = getGlyph(font, codepoint);
+            if(!glyph) continue;
+            if(font->atlasGeneration != generation && !restarted){
+                break;
+            }
+            if(codepoint == ' '){
+                x += glyph->advance * scale;
+                breakGlyph = count;
+                breakX = x;
+                continue;
+            }
+            if(!glyph->atlasWidth){
+                x += glyph->advance * scale;
+                continue;
+            }
+            f32 right = x + (glyph->xOffset + glyph->width) * scale;
+            if(wrapWidth > 0 && right > wrapWidth && x > 0){
+                if(breakGlyph != MAX_U32){
+                    for(u32 i = breakGlyph; i < count; i++){
+                        out[i].left -= breakX;
+                        out[i].right -= breakX;
+                        out[i].top += lineHeight;
+                        out[i].bottom += lineHeight;
+                    }
+                    x -= breakX;
+                }else{
+                    x = 0;
+                }
+                y += lineHeight;
+                breakGlyph = MAX_U32;
+            }
+            if(count == capacity){
+                return MAX_U32;
+            }
+            TextGlyphInstance* instance = &out[count++];
+            instance->left = x + glyph->xOffset * scale;
+            instance->top = y + glyph->yOffset * scale;
+            instance->right = instance->left + glyph->width * scale;
+            instance->bottom = instance->top + glyph->height * scale;
+            instance->atlasLeft = glyph->atlasX;
+            instance->atlasTop = glyph->atlasY;
+            instance->atlasRight = glyph->atlasX + glyph->atlasWidth;
+            instance->atlasBottom = glyph->atlasY + glyph->atlasHeight;
+            instance->color = 0;
+            x += glyph->advance * scale;
+        }
+        if(font->atlasGeneration == generation || restarted){
+            break;
+        }
+        //the atlas started over part way, lay out once more so every glyph points at the new atlas
+        generation = font->atlasGeneration;
+        restarted = true;
+    }
+
+    f32 maxRight = 0;
+    for(u32 i = 0; i < count; i++){
+        if(out[i].right > maxRight) maxRight = out[i].right;
+    }
+    *width = maxRight;
+    *height = y + lineHeight;
+    return count;
+}
+
+static u32 findTextRunSlot(TextLayoutCache* cache, u64 key){
+    u32 mask = TEXT_MAX_RUNS - 1;
+    u32 i = (u32)key & mask;
+    while(cache->runs[i].key && cache->runs[i].key != key){
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+//drops runs not drawn recently, then packs the surviving glyphs to the front of the pool and rehashes the runs
+static void compactTextLayoutCache(TextLayoutCache* cache){
+    TextRun survivors[TEXT_MAX_RUNS];
+    u32 totalSurvivors = 0;
+    for(u32 i = 0; i < TEXT_MAX_RUNS; i++){
+        TextRun* run = &cache->runs[i];
+        if(run->key && cache->frame - run->lastUsedFrame < TEXT_RUN_KEEP_FRAMES){
+            //insertion by firstGlyph so moving glyphs down never overwrites a run not yet moved
+            u32 j = totalSurvivors++;
+            for(; j > 0 && survivors[j - 1].firstGlyph > run->firstGlyph; j--){
+                survivors[j] = survivors[j - 1];
+            }
+            survivors[j] = *run;
+        }
+    }
+    setMemory(cache->runs, sizeof(cache->runs));
+    cache->glyphsUsed = 0;
+    for(u32 i = 0; i < totalSurvivors; i++){
+        TextRun* run = &survivors[i];
+        for(u32 g = 0; g < run->totalGlyphs; g++){
+            cache->glyphs[cache->glyphsUsed + g] = cache->glyphs[run->firstGlyph + g];
+        }
+        run->firstGlyph = cache->glyphsUsed;
+        cache->glyphsUsed += run->totalGlyphs;
+        cache->runs[findTextRunSlot(cache, run->key)] = *run;
+    }
+    cache->totalRuns = totalSurvivors;
+    cache->compactedFrame = cache->frame;
+}
+
+static u64 computeTextRunKey(GlyphCache* font, const s8* text, u32* length, f32 scale, f32 wrapWidth){
+    u32 textLength = 0;
+    while(text[textLength]) textLength++;
+    *length = textLength;
+    union { f32 f; u32 u; } s, w;
+    s.f = scale;
+    w.f = wrapWidth;
+    u64 seed = (u64)font ^ ((u64)s.u << 32) ^ w.u;
+    u64 key = hashMemory((void*)text, textLength, seed);
+    return key ? key : 1;
+}
+
+static void placeTextGlyphs(TextGlyphInstance* dst, TextGlyphInstance* src, u32 totalGlyphs, f32 x, f32 y, u32 color){
+    for(u32 i = 0; i < totalGlyphs; i++){
+        dst[i] = src[i];
+        dst[i].left += x;
+        dst[i].right += x;
+        dst[i].top += y;
+        dst[i].bottom += y;
+        dst[i].color = color;
+    }
+}
+
+static bool textRunFits(TextLayoutCache* cache, TextRun* run, u64 key, u32 length){
+    //a utf-8 string never has more glyphs than bytes
+    if(cache->glyphsUsed + length > cache->glyphCapacity){
+        return false;
+    }
+    return run->key == key || cache->totalRuns + 1 <= TEXT_MAX_RUNS - TEXT_MAX_RUNS / 4;
+}
+
+//Returns the run drawn, with its width and height, or 0 when the batch cannot hold the text. Text that could not be
+//cached comes back in a run that is only valid until the next drawText.
+static TextRun* drawText(TextBatch* batch, TextLayoutCache* cache, GlyphCache* font, const s8* text, f32 x, f32 y,
+                         f32 scale, Vector4 color, f32 wrapWidth = 0){
+    u32 length;
+    u64 key = computeTextRunKey(font, text, &length, scale, wrapWidth);
+    u32 slot = findTextRunSlot(cache, key);
+    TextRun* run = &cache->runs[slot];
+    u32 packedColor = packTextColor(color);
+    if(run->key != key || run->atlasGeneration != font->atlasGeneration){
+        cache->misses++;
+        if(!textRunFits(cache, run, key, length) && cache->compactedFrame != cache->frame){
+            compactTextLayoutCache(cache);
+            slot = findTextRunSlot(cache, key);
+            run = &cache->runs[slot];
+        }
+        if(!textRunFits(cache, run, key, length)){
+            run = &cache->uncachedRun;
+            TextGlyphInstance* dst = batch->instances + batch->totalInstances;
+            run->totalGlyphs = layoutTextRun(font, text, scale, wrapWidth, dst, batch->capacity - batch->totalInstances,
+                                             &run->width, &run->height);
+            if(run->totalGlyphs == MAX_U32){
+                return 0;
+            }
+            placeTextGlyphs(dst, dst, run->totalGlyphs, x, y, packedColor);
+            batch->totalInstances += run->totalGlyphs;
+            return run;
+        }
+        if(run->key != key){
+            cache->totalRuns++;
+        }
+        run->key = key;
+        run->firstGlyph = cache->glyphsUsed;
+        run->totalGlyphs = layoutTextRun(font, text, scale, wrapWidth, cache->glyphs + cache->glyphsUsed,
+                                         cache->glyphCapacity - cache->glyphsUsed, &run->width, &run->height);
+        run->atlasGeneration = font->atlasGeneration;
+        cache->glyphsUsed += run->totalGlyphs;
+    }else{
+        cache->hits++;
+    }
+    run->lastUsedFrame = cache->frame;
+
+    if(batch->totalInstances + run->totalGlyphs > batch->capacity){
+        return 0;
+    }
+    placeTextGlyphs(batch->instances + batch->totalInstances, cache->glyphs + run->firstGlyph, run->totalGlyphs, x, y,
+                    packedColor);
+    batch->totalInstances += run->totalGlyphs;
+    return run;
+}
+
+//Once a frame after the last drawText, returns the bytes of instances the frame's one text draw reads
+static u32 finishTextBatch(TextBatch* batch, GlyphCache* font, OSInterface* os){
+    if(!batch->totalInstances){
+        return 0;
+    }
+    flushGlyphAtlas(font, os);
+    return batch->totalInstances * sizeof(TextGlyphInstance);
+}
@@ -0,0 +1,649 @@
+#pragma once
+
+#include "os_interface.h"
+
+// CPU block compression of RGBA8 images into BC1, BC4 and BC5, plus decoders used to validate the result.
+// Images are encoded in 4x4 blocks; edge blocks of non multiple of 4 images repeat the last row/column.
+//   BC1    RGB, 1 bit alpha          8 bytes per block
+//   BC4U   R unorm                   8 bytes per block
+//   BC4S   R snorm, from unorm data  8 bytes per block
+//   BC5    RG unorm                 16 bytes per block
+
+#define BLOCK_COMPRESSION_BC1 0
+#define BLOCK_COMPRESSION_BC4U 1
+#define BLOCK_COMPRESSION_BC4S 2
+#define BLOCK_COMPRESSION_BC5 3
+
+//fast uses the bounding box of the block, normal its principal axis, high refines the endpoints by least squares
+#define BLOCK_COMPRESSION_QUALITY_FAST 0
+#define BLOCK_COMPRESSION_QUALITY_NORMAL 1
+#define BLOCK_COMPRESSION_QUALITY_HIGH 2
+
+struct BlockCompressionJob {
+    u8* source;
+    u8* destination;
+    u32 width;
+    u32 height;
+    u32 format;
+    u32 quality;
+    u32 firstBlockRow;
+    u32 endBlockRow;
+};
+
+static u32 getBlockCompressionBlockSize(u32 format){
+    return format == BLOCK_COMPRESSION_BC5 ? 16 : 8;
+}
+
+static u32 getBlockCompressedSize(u32 format, u32 width, u32 height){
+    return ((width + 3) / 4) * ((height + 3) / 4) * getBlockCompressionBlockSize(format);
+}
+
+static u32 getBlockCompressionTextureFormat(OSInterface* os, u32 format){
+    switch(format){
+        case BLOCK_COMPRESSION_BC1: return os->TEXTURE_FORMAT_BC1;
+        case BLOCK_COMPRESSION_BC4U: return os->TEXTURE_FORMAT_BC4U;
+        case BLOCK_COMPRESSION_BC4S: return os->TEXTURE_FORMAT_BC4S;
+        default: return os->TEXTURE_FORMAT_BC5;
+    }
+}
+
+static void loadRGBABlock(u8* image, u32 width, u32 height, u32 blockX, u32 blockY, u8* block){
+    for(u32 y = 0; y < 4; y++){
+        u32 py = blockY * 4 + y < height ? blockY * 4 + y : height - 1;
+        for(u32 x = 0; x < 4; x++){
+            u32 px = blockX * 4 + x < width ? blockX * 4 + x : width - 1;
+            copyMemory(block + (y * 4 + x) * 4, image + (py * width + px) * 4, 4);
+        }
+    }
+}
+
+static void storeRGBABlock(u8* image, u32 width, u32 height, u32 blockX, u32 blockY, u8* block){
+    for(u32 y = 0; y < 4 && blockY * 4 + y < height; y++){
+        for(u32 x = 0; x < 4 && blockX * 4 + x < width; x++){
+            copyMemory(image + ((blockY * 4 + y) * width + blockX * 4 + x) * 4, block + (y * 4 + x) * 4, 4);
+        }
+    }
+}
+
+static u16 packRGB565(f32 r, f32 g, f32 b){
+    s32 r5 = (s32)(clamp(r, 0, 255) * (31.0f / 255.0f) + 0.5f);
+    s32 g6 = (s32)(clamp(g, 0, 255) * (63.0f / 255.0f) + 0.5f);
+    s32 b5 = (s32)(clamp(b, 0, 255) * (31.0f / 255.0f) + 0.5f);
+    return (u16)((r5 << 11) | (g6 << 5) | b5);
+}
+
+static void unpackRGB565(u16 c, s32* rgb){
+    s32 r = (c >> 11) & 31;
+    s32 g = (c >> 5) & 63;
+    s32 b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+//palette entries are built the same way the decoder builds them so the index search sees the real colors
+static void buildBC1Palette(u16 c0, u16 c1, s32 palette[4][3]){
+    unpackRGB565(c0, palette[0]);
+    unpackRGB565(c1, palette[1]);
+    for(u32 i = 0; i < 3; i++){
+        if(c0 > c1){
+            palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+            palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+        }else{
+            palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+            palette[3][i] = 0;
+        }
+    }
+}
+
+//Picks the closest palette entry for 16 pixels stored as r[16], g[16], b[16]. Works on four pixels at a time.
+//Only the first paletteSize entries are considered. Returns the summed squared error.
+static f32 findBC1Indices(f32* r, f32* g, f32* b, s32 palette[4][3], u32 paletteSize, u32* indices){
+    __m128 error = _mm_setzero_ps();
+    u32 result = 0;
+    for(u32 i = 0; i < 16; i += 4){
+        __m128 pr = _mm_loadu_ps(r + i);
+        __m128 pg = _mm_loadu_ps(g + i);
+        __m128 pb = _mm_loadu_ps(b + i);
+        __m128 best = _mm_set1_ps(MAX_F32);
+        __m128i bestIndex = _mm_setzero_si128();
+        for(u32 j = 0; j < paletteSize; j++){
+            __m128 dr = _mm_sub_ps(pr, _mm_set1_ps((f32)palette[j][0]));
+            __m128 dg = _mm_sub_ps(pg, _mm_set1_ps((f32)palette[j][1]));
+            __m128 db = _mm_sub_ps(pb, _mm_set1_ps((f32)palette[j][2]));
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+            __m128 closer = _mm_cmplt_ps(d, best);
+            best = _mm_min_ps(d, best);
+            __m128i mask = _mm_castps_si128(closer);
+            bestIndex = _mm_or_si128(_mm_and_si128(mask, _mm_set1_epi32(j)), _mm_andnot_si128(mask, bestIndex));
+        }
+        error = _mm_add_ps(error, best);
+        u32 lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, bestIndex);
+        for(u32 j = 0; j < 4; j++){
+            result |= lanes[j] << ((i + j) * 2);
+        }
+    }
+    f32 errors[4];
+    _mm_storeu_ps(errors, error);
+    *indices = result;
+    return errors[0] + errors[1] + errors[2] + errors[3];
+}
+
+//principal axis of the block colors by power iteration on the covariance matrix
+static void findPrincipalAxis(f32* r, f32* g, f32* b, u32 count, f32* mean, f32* axis){
+    mean[0] = mean[1] = mean[2] = 0;
+    for(u32 i = 0; i < count; i++){
+        mean[0] += r[i];
+        mean[1] += g[i];
+        mean[2] += b[i];
+    }
+    for(u32 i = 0; i < 3; i++){
+        mean[i] /= (f32)count;
+    }
+    f32 cov[6] = {};
+    for(u32 i = 0; i < count; i++){
+        f32 dr = r[i] - mean[0];
+        f32 dg = g[i] - mean[1];
+        f32 db = b[i] - mean[2];
+        cov[0] += dr * dr;
+        cov[1] += dr * dg;
+        cov[2] += dr * db;
+        cov[3] += dg * dg;
+        cov[4] += dg * db;
+        cov[5] += db * db;
+    }
+    f32 v[3] = {1, 1, 1};
+    for(u32 i = 0; i < 8; i++){
+        f32 x = cov[0] * v[0] + cov[1] * v[1] + cov[2] * v[2];
+        f32 y = cov[1] * v[0] + cov[3] * v[1] + cov[4] * v[2];
+        f32 z = cov[2] * v[0] + cov[4] * v[1] + cov[5] * v[2];
+        f32 m = absoluteValue(x);
+        if(absoluteValue(y) > m) m = absoluteValue(y);
+        if(absoluteValue(z) > m) m = absoluteValue(z);
+        if(m < 1e-6f){
+            break;
+        }
+        v[0] = x / m;
+        v[1] = y / m;
+        v[2] = z / m;
+    }
+    axis[0] = v[0];
+    axis[1] = v[1];
+    axis[2] = v[2];
+}
+
+//Solves for the two endpoints that best reproduce the pixels under the given 4 color indices.
+//Returns false if every pixel uses the same weight, which leaves the system singular.
+static bool refineBC1Endpoints(f32* r, f32* g, f32* b, u32 indices, f32* e0, f32* e1){
+    const f32 weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    f32 aa = 0, ab = 0, bb = 0;
+    f32 ax[3] = {}, bx[3] = {};
+    for(u32 i = 0; i < 16; i++){
+        f32 a = weights[(indices >> (i * 2)) & 3];
+        f32 c = 1.0f - a;
+        aa += a * a;
+        ab += a * c;
+        bb += c * c;
+        ax[0] += a * r[i]; ax[1] += a * g[i]; ax[2] += a * b[i];
+        bx[0] += c * r[i]; bx[1] += c * g[i]; bx[2] += c * b[i];
+    }
+    f32 det = aa * bb - ab * ab;
+    if(absoluteValue(det) < 1e-6f){
+        return false;
+    }
+    f32 invDet = 1.0f / det;
+    for(u32 i = 0; i < 3; i++){
+        e0[i] = (ax[i] * bb - bx[i] * ab) * invDet;
+        e1[i] = (bx[i] * aa - ax[i] * ab) * invDet;
+    }
+    return true;
+}
+
+static f32 evaluateBC1Endpoints(f32* r, f32* g, f32* b, f32* e0, f32* e1, u16* c0, u16* c1, u32* indices){
+    u16 a = packRGB565(e0[0], e0[1], e0[2]);
+    u16 bc = packRGB565(e1[0], e1[1], e1[2]);
+    //4 color mode needs c0 > c1; swapping the endpoints swaps index pairs 0/1 and 2/3
+    if(a < bc){
+        u16 t = a;
+        a = bc;
+        bc = t;
+    }
+    s32 palette[4][3];
+    buildBC1Palette(a, bc, palette);
+    *c0 = a;
+    *c1 = bc;
+    if(a == bc){
+        *indices = 0;
+        f32 error = 0;
+        for(u32 i = 0; i < 16; i++){
+            f32 dr = r[i] - palette[0][0];
+            f32 dg = g[i] - palette[0][1];
+            f32 db = b[i] - palette[0][2];
+            error += dr * dr + dg * dg + db * db;
+        }
+        return error;
+    }
+    return findBC1Indices(r, g, b, palette, 4, indices);
+}
+
+//rgba is 16 pixels. Pixels with alpha below 128 switch the block to 3 color mode with transparent black.
+static void encodeBC1Block(u8* rgba, u8* out, u32 quality){
+    f32 r[16], g[16], b[16];
+    u32 transparentMask = 0;
+    u32 opaqueCount = 0;
+    f32 opaqueR[16], opaqueG[16], opaqueB[16];
+    for(u32 i = 0; i < 16; i++){
+        r[i] = rgba[i * 4 + 0];
+        g[i] = rgba[i * 4 + 1];
+        b[i] = rgba[i * 4 + 2];
+        if(rgba[i * 4 + 3] < 128){
+            transparentMask |= 1 << i;
+        }else{
+            opaqueR[opaqueCount] = r[i];
+            opaqueG[opaqueCount] = g[i];
+            opaqueB[opaqueCount] = b[i];
+            opaqueCount++;
+        }
+    }
+
+    u16 c0 = 0, c1 = 0;
+    u32 indices = 0;
+    if(opaqueCount == 0){
+        c1 = 0xFFFF;
+        indices = 0xFFFFFFFF;
+    }else{
+        f32 e0[3], e1[3];
+        if(quality == BLOCK_COMPRESSION_QUALITY_FAST){
+            f32 lo[3] = {255, 255, 255};
+            f32 hi[3] = {0, 0, 0};
+            for(u32 i = 0; i < opaqueCount; i++){
+                f32 c[3] = {opaqueR[i], opaqueG[i], opaqueB[i]};
+                for(u32 j = 0; j < 3; j++){
+                    if(c[j] < lo[j]) lo[j] = c[j];
+                    if(c[j] > hi[j]) hi[j] = c[j];
+                }
+            }
+            //inset by 1/16 of the range, the endpoints of a box are rarely hit exactly
+            for(u32 j = 0; j < 3; j++){
+                f32 inset = (hi[j] - lo[j]) / 16.0f;
+                e0[j] = hi[j] - inset;
+                e1[j] = lo[j] + inset;
+            }
+        }else{
+            f32 mean[3], axis[3];
+            findPrincipalAxis(opaqueR, opaqueG, opaqueB, opaqueCount, mean, axis);
+            f32 lo = MAX_F32;
+            f32 hi = -MAX_F32;
+            for(u32 i = 0; i < opaqueCount; i++){
+                f32 t = (opaqueR[i] - mean[0]) * axis[0] + (opaqueG[i] - mean[1]) * axis[1] + (opaqueB[i] - mean[2]) * axis[2];
+                if(t < lo) lo = t;
+                if(t > hi) hi = t;
+            }
+            for(u32 j = 0; j < 3; j++){
+                e0[j] = mean[j] + axis[j] * hi;
+                e1[j] = mean[j] + axis[j] * lo;
+            }
+        }
+
+        if(transparentMask){
+            //3 color mode requires c0 <= c1 and reserves index 3 for transparent pixels
+            c0 = packRGB565(e1[0], e1[1], e1[2]);
+            c1 = packRGB565(e0[0], e0[1], e0[2]);
+            if(c0 > c1){
+                u16 t = c0;
+                c0 = c1;
+                c1 = t;
+            }
+            s32 palette[4][3];
+            buildBC1Palette(c0, c1, palette);
+            findBC1Indices(r, g, b, palette, 3, &indices);
+            for(u32 i = 0; i < 16; i++){
+                if(transparentMask & (1 << i)){
+                    indices |= 3 << (i * 2);
+                }
+            }
+        }else{
+            f32 error = evaluateBC1Endpoints(r, g, b, e0, e1, &c0, &c1, &indices);
+            if(quality == BLOCK_COMPRESSION_QUALITY_HIGH){
+                for(u32 iteration = 0; iteration < 2 && error > 0; iteration++){
+                    f32 r0[3], r1[3];
+                    if(c0 == c1 || !refineBC1Endpoints(r, g, b, indices, r0, r1)){
+                        break;
+                    }
+                    u16 n0, n1;
+                    u32 nIndices;
+                    f32 nError = evaluateBC1Endpoints(r, g, b, r0, r1, &n0, &n1, &nIndices);
+                    if(nError >= error){
+                        break;
+                    }
+                    error = nError;
+                    c0 = n0;
+                    c1 = n1;
+                    indices = nIndices;
+                }
+            }
+        }
+    }
+
+    out[0] = (u8)c0;
+    out[1] = (u8)(c0 >> 8);
+    out[2] = (u8)c1;
+    out[3] = (u8)(c1 >> 8);
+    out[4] = (u8)indices;
+    out[5] = (u8)(indices >> 8);
+    out[6] = (u8)(indices >> 16);
+    out[7] = (u8)(indices >> 24);
+}
+
+static void decodeBC1Block(u8* block, u8* rgba){
+    u16 c0 = (u16)(block[0] | (block[1] << 8));
+    u16 c1 = (u16)(block[2] | (block[3] << 8));
+    u32 indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((u32)block[7] << 24);
+    s32 palette[4][3];
+    buildBC1Palette(c0, c1, palette);
+    for(u32 i = 0; i < 16; i++){
+        u32 index = (indices >> (i * 2)) & 3;
+        rgba[i * 4 + 0] = (u8)palette[index][0];
+        rgba[i * 4 + 1] = (u8)palette[index][1];
+        rgba[i * 4 + 2] = (u8)palette[index][2];
+        rgba[i * 4 + 3] = (c0 <= c1 && index == 3) ? 0 : 255;
+    }
+}
+
+//snorm blocks store values in [-127, 127] as two's complement bytes
+static void buildBC4Palette(s32 e0, s32 e1, bool isSigned, s32* palette){
+    palette[0] = e0;
+    palette[1] = e1;
+    if(e0 > e1){
+        for(s32 i = 2; i < 8; i++){
+            palette[i] = ((8 - i) * e0 + (i - 1) * e1) / 7;
+        }
+    }else{
+        for(s32 i = 2; i < 6; i++){
+            palette[i] = ((6 - i) * e0 + (i - 1) * e1) / 5;
+        }
+        palette[6] = isSigned ? -127 : 0;
+        palette[7] = isSigned ? 127 : 255;
+    }
+}
+
+static u32 findBC4Indices(s32* values, s32* palette, u64* indices){
+    __m128 error = _mm_setzero_ps();
+    u64 result = 0;
+    for(u32 i = 0; i < 16; i += 4){
+        __m128 v = _mm_cvtepi32_ps(_mm_loadu_si128((__m128i*)(values + i)));
+        __m128 best = _mm_set1_ps(MAX_F32);
+        __m128i bestIndex = _mm_setzero_si128();
+        for(u32 j = 0; j < 8; j++){
+            __m128 d = _mm_sub_ps(v, _mm_set1_ps((f32)palette[j]));
+            d = _mm_mul_ps(d, d);
+            __m128i mask = _mm_castps_si128(_mm_cmplt_ps(d, best));
+            best = _mm_min_ps(d, best);
+            bestIndex = _mm_or_si128(_mm_and_si128(mask, _mm_set1_epi32(j)), _mm_andnot_si128(mask, bestIndex));
+        }
+        error = _mm_add_ps(error, best);
+        u32 lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, bestIndex);
+        for(u32 j = 0; j < 4; j++){
+            result |= (u64)lanes[j] << ((i + j) * 3);
+        }
+    }
+    f32 errors[4];
+    _mm_storeu_ps(errors, error);
+    *indices = result;
+    return (u32)(errors[0] + errors[1] + errors[2] + errors[3]);
+}
+
+//values are 16 samples, in [0, 255] or [-127, 127] when isSigned
+static void encodeBC4Block(s32* values, bool isSigned, u8* out, u32 quality){
+    s32 lo = values[0];
+    s32 hi = values[0];
+    for(u32 i = 1; i < 16; i++){
+        if(values[i] < lo) lo = values[i];
+        if(values[i] > hi) hi = values[i];
+    }
+
+    s32 bestE0 = hi;
+    s32 bestE1 = lo;
+    s32 palette[8];
+    u64 indices;
+    buildBC4Palette(bestE0, bestE1, isSigned, palette);
+    u32 bestError = findBC4Indices(values, palette, &indices);
+
+    if(quality != BLOCK_COMPRESSION_QUALITY_FAST && bestError > 0){
+        //6 value mode: the extremes of the range come for free, so the endpoints only need to span the rest
+        s32 minValue = isSigned ? -127 : 0;
+        s32 maxValue = isSigned ? 127 : 255;
+        s32 innerLo = maxValue;
+        s32 innerHi = minValue;
+        for(u32 i = 0; i < 16; i++){
+            if(values[i] == minValue || values[i] == maxValue) continue;
+            if(values[i] < innerLo) innerLo = values[i];
+            if(values[i] > innerHi) innerHi = values[i];
+        }
+        if(innerLo <= innerHi){
+            u64 candidateIndices;
+            buildBC4Palette(innerLo, innerHi, isSigned, palette);
+            u32 error = findBC4Indices(values, palette, &candidateIndices);
+            if(error < bestError){
+                bestError = error;
+                bestE0 = innerLo;
+                bestE1 = innerHi;
+                indices = candidateIndices;
+            }
+        }
+    }
+
+    if(quality == BLOCK_COMPRESSION_QUALITY_HIGH && bestError > 0 && bestE0 > bestE1){
+        //small search around the 8 value endpoints
+        s32 baseE0 = bestE0;
+        s32 baseE1 = bestE1;
+        for(s32 d0 = -2; d0 <= 2; d0++){
+            for(s32 d1 = -2; d1 <= 2; d1++){
+                s32 e0 = baseE0 + d0;
+                s32 e1 = baseE1 + d1;
+                if(e0 <= e1 || e0 > (isSigned ? 127 : 255) || e1 < (isSigned ? -127 : 0)) continue;
+                u64 candidateIndices;
+                buildBC4Palette(e0, e1, isSigned, palette);
+                u32 error = findBC4Indices(values, palette, &candidateIndices);
+                if(error < bestError){
+                    bestError = error;
+                    bestE0 = e0;
+                    bestE1 = e1;
+                    indices = candidateIndices;
+                }
+            }
+        }
+    }
+
+    out[0] = (u8)bestE0;
+    out[1] = (u8)bestE1;
+    for(u32 i = 0; i < 6; i++){
+        out[2 + i] = (u8)(indices >> (i * 8));
+    }
+}
+
+static void decodeBC4Block(u8* block, bool isSigned, s32* values){
+    s32 e0 = isSigned ? (s32)(s8)block[0] : block[0];
+    s32 e1 = isSigned ? (s32)(s8)block[1] : block[1];
+    if(isSigned){
+        if(e0 < -127) e0 = -127;
+        if(e1 < -127) e1 = -127;
+    }
+    s32 palette[8];
+    buildBC4Palette(e0, e1, isSigned, palette);
+    u64 indices = 0;
+    for(u32 i = 0; i < 6; i++){
+        indices |= (u64)block[2 + i] << (i * 8);
+    }
+    for(u32 i = 0; i < 16; i++){
+        values[i] = palette[(indices >> (i * 3)) & 7];
+    }
+}
+
+static s32 unormToSnorm8(u8 v){
+    return ((s32)v * 254 + 127) / 255 - 127;
+}
+
+static u8 snormToUnorm8(s32 v){
+    return (u8)(((v + 127) * 255 + 127) / 254);
+}
+
+static void encodeTextureBlock(u8* rgba, u32 format, u32 quality, u8* out){
+    s32 values[16];
+    switch(format){
+        case BLOCK_COMPRESSION_BC1:{
+            encodeBC1Block(rgba, out, quality);
+            break;
+        }
+        case BLOCK_COMPRESSION_BC4U:
+        case BLOCK_COMPRESSION_BC4S:{
+            bool isSigned = format == BLOCK_COMPRESSION_BC4S;
+            for(u32 i = 0; i < 16; i++){
+                values[i] = isSigned ? unormToSnorm8(rgba[i * 4]) : rgba[i * 4];
+            }
+            encodeBC4Block(values, isSigned, out, quality);
+            break;
+        }
+        case BLOCK_COMPRESSION_BC5:{
+            for(u32 c = 0; c < 2; c++){
+                for(u32 i = 0; i < 16; i++){
+                    values[i] = rgba[i * 4 + c];
+                }
+                encodeBC4Block(values, false, out + c * 8, quality);
+            }
+            break;
+        }
+    }
+}
+
+//BC4 decodes to R and BC5 to RG, with the unused channels set to 0 and alpha to 255
+static void decodeTextureBlock(u8* block, u32 format, u8* rgba){
+    s32 values[16];
+    switch(format){
+        case BLOCK_COMPRESSION_BC1:{
+            decodeBC1Block(block, rgba);
+            break;
+        }
+        case BLOCK_COMPRESSION_BC4U:
+        case BLOCK_COMPRESSION_BC4S:{
+            bool isSigned = format == BLOCK_COMPRESSION_BC4S;
+            decodeBC4Block(block, isSigned, values);
+            for(u32 i = 0; i < 16; i++){
+                rgba[i * 4 + 0] = isSigned ? snormToUnorm8(values[i]) : (u8)values[i];
+                rgba[i * 4 + 1] = 0;
+                rgba[i * 4 + 2] = 0;
+                rgba[i * 4 + 3] = 255;
+            }
+            break;
+        }
+        case BLOCK_COMPRESSION_BC5:{
+            for(u32 c = 0; c < 2; c++){
+                decodeBC4Block(block + c * 8, false, values);
+                for(u32 i = 0; i < 16; i++){
+                    rgba[i * 4 + c] = (u8)values[i];
+                }
+            }
+            for(u32 i = 0; i < 16; i++){
+                rgba[i * 4 + 2] = 0;
+                rgba[i * 4 + 3] = 255;
+            }
+            break;
+        }
+    }
+}
+
+static void compressTextureBlockRows(void* data){
+    BlockCompressionJob* job = (BlockCompressionJob*)data;
+    u32 blocksX = (job->width + 3) / 4;
+    u32 blockSize = getBlockCompressionBlockSize(job->format);
+    u8 rgba[64];
+    for(u32 by = job->firstBlockRow; by < job->endBlockRow; by++){
+        u8* out = job->destination + (by * blocksX) * blockSize;
+        for(u32 bx = 0; bx < blocksX; bx++){
+            loadRGBABlock(job->source, job->width, job->height, bx, by, rgba);
+            encodeTextureBlock(rgba, job->format, job->quality, out);
+            out += blockSize;
+        }
+    }
+}
+
+static void decompressTextureBlockRows(void* data){
+    BlockCompressionJob* job = (BlockCompressionJob*)data;
+    u32 blocksX = (job->width + 3) / 4;
+    u32 blockSize = getBlockCompressionBlockSize(job->format);
+    u8 rgba[64];
+    for(u32 by = job->firstBlockRow; by < job->endBlockRow; by++){
+        u8* in = job->source + (by * blocksX) * blockSize;
+        for(u32 bx = 0; bx < blocksX; bx++){
+            decodeTextureBlock(in, job->format, rgba);
+            storeRGBABlock(job->destination, job->width, job->height, bx, by, rgba);
+            in += blockSize;
+        }
+    }
+}
+
+//splits the block rows over at most WorkQueue::MAX_ENTRIES - 1 jobs, or runs inline without a queue
+static void runBlockCompressionJobs(BlockCompressionJob* base, void (*function)(void*), OSInterface* os, WorkQueue* queue){
+    u32 blocksY = (base->height + 3) / 4;
+    if(!os || !queue || blocksY < 2){
+        base->firstBlockRow = 0;
+        base->endBlockRow = blocksY;
+        function(base);
+        return;
+    }
+    BlockCompressionJob jobs[WorkQueue::MAX_ENTRIES - 1];
+    u32 totalJobs = blocksY < WorkQueue::MAX_ENTRIES - 1 ? blocksY : WorkQueue::MAX_ENTRIES - 1;
+    u32 rowsPerJob = (blocksY + totalJobs - 1) / totalJobs;
+    u32 jobCount = 0;
+    for(u32 row = 0; row < blocksY; row += rowsPerJob){
+        jobs[jobCount] = *base;
+        jobs[jobCount].firstBlockRow = row;
+        jobs[jobCount].endBlockRow = row + rowsPerJob < blocksY ? row + rowsPerJob : blocksY;
+        os->addWorkQueueEntry(queue, function, &jobs[jobCount]);
+        jobCount++;
+    }
+    os->completeWorkQueueEntries(queue);
+}
+
+//source is width * height RGBA8 pixels; dst must hold getBlockCompressedSize bytes
+static void compressTexture(u8* source, u32 width, u32 height, u32 format, u32 quality, u8* dst,
+                            OSInterface* os = 0, WorkQueue* queue = 0){
+    BlockCompressionJob job = {};
+    job.source = source;
+    job.destination = dst;
+    job.width = width;
+    job.height = height;
+    job.format = format;
+    job.quality = quality;
+    runBlockCompressionJobs(&job, compressTextureBlockRows, os, queue);
+}
+
+static void decompressTexture(u8* source, u32 width, u32 height, u32 format, u8* dst,
+                              OSInterface* os = 0, WorkQueue* queue = 0){
+    BlockCompressionJob job = {};
+    job.source = source;
+    job.destination = dst;
+    job.width = width;
+    job.height = height;
+    job.format = format;
+    runBlockCompressionJobs(&job, decompressTextureBlockRows, os, queue);
+}
+
+//PSNR in dB over the channels the format stores (RGB for BC1, R for BC4, RG for BC5)
+static f32 computeTextureCompressionPSNR(u8* original, u8* decoded, u32 width, u32 height, u32 format){
+    u32 channels = format == BLOCK_COMPRESSION_BC1 ? 3 : format == BLOCK_COMPRESSION_BC5 ? 2 : 1;
+    f64 squaredError = 0;
+    for(u32 i = 0; i < width * height; i++){
+        for(u32 c = 0; c < channels; c++){
+            f64 d = (f64)original[i * 4 + c] - (f64)decoded[i * 4 + c];
+            squaredError += d * d;
+        }
+    }
+    f64 mse = squaredError / ((f64)width * height * channels);
+    if(mse == 0){
+        return 99.0f;
+    }
+    return (f32)(10.0 * log10((255.0 * 255.0) / mse));
+}
@@ -0,0 +1,354 @@
+#pragma once
+
+#include "os_interface.h"
+
+// Mip chain generation for RGBA8 textures. Levels are filtered in linear float space from the previous float
+// level and only quantized on output, so error doesn't accumulate down the chain. Non power of two levels
+// halve with rounding down (to a minimum of 1) and use an area weighted footprint, so odd sizes stay exact.
+// Each filter pass is split over rows on the work queue when one is given.
+
+#define MIP_FILTER_BOX 0
+#define MIP_FILTER_KAISER 1
+
+//kaiser window half width in destination pixels and its shape parameter
+#define MIP_KAISER_WIDTH 2.0f
+#define MIP_KAISER_ALPHA 4.0f
+#define MIP_MAX_TAPS 16
+#define MIP_SRGB_TABLE_SIZE 4096
+
+struct MipChainSettings {
+    u32 filter;
+    bool srgb;
+    bool preserveAlphaCoverage;
+    f32 alphaCutoff;
+};
+
+static MipChainSettings defaultMipChainSettings(){
+    MipChainSettings settings;
+    settings.filter = MIP_FILTER_BOX;
+    settings.srgb = true;
+    settings.preserveAlphaCoverage = false;
+    settings.alphaCutoff = 0.5f;
+    return settings;
+}
+
+struct MipFilterTaps {
+    s32 first;
+    u32 count;
+    f32 weights[MIP_MAX_TAPS];
+};
+
+struct MipFilterJob {
+    f32* source;
+    f32* destination;
+    u8* output;
+    MipFilterTaps* taps;
+    f32* srgbToLinear;
+    u8* linearToSrgb;
+    u32 sourceWidth;
+    u32 sourceHeight;
+    u32 destinationWidth;
+    u32 firstRow;
+    u32 endRow;
+    f32 alphaScale;
+};
+
+static u32 getMipLevelCount(u32 width, u32 height){
+    u32 largest = width > height ? width : height;
+    return findMostSignificantBit(largest) + 1;
+}
+
+static u32 getMipLevelDimension(u32 size, u32 level){
+    size >>= level;
+    return size ? size : 1;
+}
+
+//bytes of all RGBA8 levels stored back to back, largest first
+static u32 getMipChainSize(u32 width, u32 height){
+    u32 size = 0;
+    u32 levels = getMipLevelCount(width, height);
+    for(u32 i = 0; i < levels; i++){
+        size += getMipLevelDimension(width, i) * getMipLevelDimension(height, i) * 4;
+    }
+    return size;
+}
+
+static f32 besselI0(f32 x){
+    f32 sum = 1;
+    f32 term = 1;
+    f32 halfX = x * 0.5f;
+    for(u32 k = 1; k < 16; k++){
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+    }
+    return sum;
+}
+
+static f32 kaiserFilter(f32 t){
+    if(absoluteValue(t) >= MIP_KAISER_WIDTH){
+        return 0;
+    }
+    f32 x = t / MIP_KAISER_WIDTH;
+    f32 window = besselI0(MIP_KAISER_ALPHA * sqrtf(1.0f - x * x)) / besselI0(MIP_KAISER_ALPHA);
+    f32 sinc = t == 0 ? 1.0f : sinf((f32)PI * t) / ((f32)PI * t);
+    return sinc * window;
+}
+
+//Weights for reducing sourceSize texels to destinationSize. Box weights are the overlap of each source texel with
+//the destination footprint; kaiser samples the windowed sinc stretched by the reduction ratio.
+static void buildMipFilterTaps(u32 sourceSize, u32 destinationSize, u32 filter, MipFilterTaps* taps){
+    f32 ratio = (f32)sourceSize / (f32)destinationSize;
+    for(u32 i = 0; i < destinationSize; i++){
+        MipFilterTaps* t = &taps[i];
+        f32 total = 0;
+        if(filter == MIP_FILTER_BOX){
+            f32 start = i * ratio;
+            f32 end = start + ratio;
+            t->first = (s32)start;
+            t->count = 0;
+            for(s32 s = t->first; s < end && t->count < MIP_MAX_TAPS; s++){
+                f32 lo = s > start ? (f32)s : start;
+                f32 hi = s + 1 < end ? (f32)(s + 1) : end;
+                t->weights[t->count++] = hi - lo;
+                total += hi - lo;
+            }
+        }else{
+            f32 center = (i + 0.5f) * ratio;
+            f32 radius = MIP_KAISER_WIDTH * ratio;
+            t->first = (s32)floorf(center - radius + 0.5f);
+            s32 last = (s32)floorf(center + radius - 0.5f);
+            t->count = 0;
+            for(s32 s = t->first; s <= last && t->count < MIP_MAX_TAPS; s++){
+                f32 w = kaiserFilter((s + 0.5f - center) / ratio);
+                t->weights[t->count++] = w;
+                total += w;
+            }
+        }
+        for(u32 j = 0; j < t->count; j++){
+            t->weights[j] /= total;
+        }
+    }
+}
+
+static void convertMipSourceRows(void* data){
+    MipFilterJob* job = (MipFilterJob*)data;
+    f32 inv255 = 1.0f / 255.0f;
+    for(u32 y = job->firstRow; y < job->endRow; y++){
+        u8* src = job->output + y * job->sourceWidth * 4;
+        f32* dst = job->destination + y * job->sourceWidth * 4;
+        for(u32 x = 0; x < job->sourceWidth * 4; x += 4){
+            if(job->srgbToLinear){
+                dst[x + 0] = job->srgbToLinear[src[x + 0]];
+                dst[x + 1] = job->srgbToLinear[src[x + 1]];
+                dst[x + 2] = job->srgbToLinear[src[x + 2]];
+            }else{
+                dst[x + 0] = src[x + 0] * inv255;
+                dst[x + 1] = src[x + 1] * inv255;
+                dst[x + 2] = src[x + 2] * inv255;
+            }
+            dst[x + 3] = src[x + 3] * inv255;
+        }
+    }
+}
+
+//source rows of sourceWidth pixels into rows of destinationWidth pixels, same row count
+static void filterMipRowsHorizontal(void* data){
+    MipFilterJob* job = (MipFilterJob*)data;
+    s32 maxX = (s32)job->sourceWidth - 1;
+    for(u32 y = job->firstRow; y < job->endRow; y++){
+        f32* src = job->source + y * job->sourceWidth * 4;
+        f32* dst = job->destination + y * job->destinationWidth * 4;
+        for(u32 x = 0; x < job->destinationWidth; x++){
+            MipFilterTaps* t = &job->taps[x];
+            __m128 sum = _mm_setzero_ps();
+            for(u32 i = 0; i < t->count; i++){
+                s32 sx = t->first + (s32)i;
+                sx = sx < 0 ? 0 : sx > maxX ? maxX : sx;
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(src + sx * 4), _mm_set1_ps(t->weights[i])));
+            }
+            _mm_storeu_ps(dst + x * 4, sum);
+        }
+    }
+}
+
+//columns of destinationWidth pixels, sourceHeight rows in, one output row per tap set
+static void filterMipRowsVertical(void* data){
+    MipFilterJob* job = (MipFilterJob*)data;
+    s32 maxY = (s32)job->sourceHeight - 1;
+    u32 rowFloats = job->destinationWidth * 4;
+    for(u32 y = job->firstRow; y < job->endRow; y++){
+        MipFilterTaps* t = &job->taps[y];
+        f32* dst = job->destination + y * rowFloats;
+        for(u32 x = 0; x < rowFloats; x += 4){
+            _mm_storeu_ps(dst + x, _mm_setzero_ps());
+        }
+        for(u32 i = 0; i < t->count; i++){
+            s32 sy = t->first + (s32)i;
+            sy = sy < 0 ? 0 : sy > maxY ? maxY : sy;
+            f32* src = job->source + sy * rowFloats;
+            __m128 w = _mm_set1_ps(t->weights[i]);
+            for(u32 x = 0; x < rowFloats; x += 4){
+                _mm_storeu_ps(dst + x, _mm_add_ps(_mm_loadu_ps(dst + x), _mm_mul_ps(_mm_loadu_ps(src + x), w)));
+            }
+        }
+    }
+}
+
+static void quantizeMipRows(void* data){
+    MipFilterJob* job = (MipFilterJob*)data;
+    __m128 scale = _mm_set_ps(255.0f * job->alphaScale, 255.0f, 255.0f, 255.0f);
+    __m128 srgbScale = _mm_set1_ps(MIP_SRGB_TABLE_SIZE - 1);
+    __m128 zero = _mm_setzero_ps();
+    for(u32 y = job->firstRow; y < job->endRow; y++){
+        f32* src = job->source + y * job->sourceWidth * 4;
+        u8* dst = job->output + y * job->sourceWidth * 4;
+        for(u32 x = 0; x < job->sourceWidth; x++){
+            __m128 v = _mm_loadu_ps(src + x * 4);
+            __m128i q = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(v, scale), zero), _mm_set1_ps(255.0f)));
+            q = _mm_packs_epi32(q, q);
+            q = _mm_packus_epi16(q, q);
+            *(u32*)(dst + x * 4) = (u32)_mm_cvtsi128_si32(q);
+            if(job->linearToSrgb){
+                s32 lanes[4];
+                _mm_storeu_si128((__m128i*)lanes, _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(v, srgbScale), zero), srgbScale)));
+                dst[x * 4 + 0] = job->linearToSrgb[lanes[0]];
+                dst[x * 4 + 1] = job->linearToSrgb[lanes[1]];
+                dst[x * 4 + 2] = job->linearToSrgb[lanes[2]];
+            }
+        }
+    }
+}
+
+static void runMipFilterJobs(MipFilterJob* base, u32 rows, void (*function)(void*), OSInterface* os, WorkQueue* queue){
+    if(!os || !queue || rows < 16){
+        base->firstRow = 0;
+        base->endRow = rows;
+        function(base);
+        return;
+    }
+    MipFilterJob jobs[WorkQueue::MAX_ENTRIES - 1];
+    u32 totalJobs = rows < WorkQueue::MAX_ENTRIES - 1 ? rows : WorkQueue::MAX_ENTRIES - 1;
+    u32 rowsPerJob = (rows + totalJobs - 1) / totalJobs;
+    u32 jobCount = 0;
+    for(u32 row = 0; row < rows; row += rowsPerJob){
+        jobs[jobCount] = *base;
+        jobs[jobCount].firstRow = row;
+        jobs[jobCount].endRow = row + rowsPerJob < rows ? row + rowsPerJob : rows;
+        os->addWorkQueueEntry(queue, function, &jobs[jobCount]);
+        jobCount++;
+    }
+    os->completeWorkQueueEntries(queue);
+}
+
+static f32 computeAlphaCoverage(f32* pixels, u32 count, f32 cutoff, f32 alphaScale){
+    u32 covered = 0;
+    for(u32 i = 0; i < count; i++){
+        covered += pixels[i * 4 + 3] * alphaScale > cutoff;
+    }
+    return (f32)covered / (f32)count;
+}
+
+//finds the alpha scale that gives the level the same fraction of pixels above the cutoff as the top level
+static f32 findAlphaCoverageScale(f32* pixels, u32 count, f32 cutoff, f32 targetCoverage){
+    f32 lo = 0;
+    f32 hi = 4;
+    for(u32 i = 0; i < 12; i++){
+        f32 mid = (lo + hi) * 0.5f;
+        if(computeAlphaCoverage(pixels, count, cutoff, mid) < targetCoverage){
+            lo = mid;
+        }else{
+            hi = mid;
+        }
+    }
+    return (lo + hi) * 0.5f;
+}
+
+//Writes every level of source (width * height RGBA8) to dst, which must hold getMipChainSize bytes. Level 0 is
+//copied as is. Needs about 3 float copies of level 0 in scratch; returns false if scratch is too small.
+static bool generateMipChain(u8* source, u32 width, u32 height, MipChainSettings* settings, u8* dst,
+                             MemoryArena* scratch, OSInterface* os = 0, WorkQueue* queue = 0){
+    u64 scratchMark = scratch->used;
+    u32 levels = getMipLevelCount(width, height);
+    f32* current = pushArray(scratch, f32, (u64)width * height * 4);
+    f32* next = pushArray(scratch, f32, (u64)getMipLevelDimension(width, 1) * getMipLevelDimension(height, 1) * 4);
+    f32* intermediate = pushArray(scratch, f32, (u64)getMipLevelDimension(width, 1) * height * 4);
+    u32 largest = width > height ? width : height;
+    MipFilterTaps* taps = pushArray(scratch, MipFilterTaps, largest);
+    f32* srgbToLinear = 0;
+    u8* linearToSrgb = 0;
+    if(settings->srgb){
+        srgbToLinear = pushArray(scratch, f32, 256);
+        linearToSrgb = pushArray(scratch, u8, MIP_SRGB_TABLE_SIZE);
+    }
+    if(!current || !next || !intermediate || !taps || (settings->srgb && (!srgbToLinear || !linearToSrgb))){
+        scratch->used = scratchMark;
+        return false;
+    }
+    if(settings->srgb){
+        for(u32 i = 0; i < 256; i++){
+            f32 c = i / 255.0f;
+            srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for(u32 i = 0; i < MIP_SRGB_TABLE_SIZE; i++){
+            f32 c = i / (f32)(MIP_SRGB_TABLE_SIZE - 1);
+            c = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+            linearToSrgb[i] = (u8)(c * 255.0f + 0.5f);
+        }
+    }
+
+    copyMemory(dst, source, width * height * 4);
+
+    MipFilterJob job = {};
+    job.srgbToLinear = srgbToLinear;
+    job.linearToSrgb = linearToSrgb;
+    job.output = source;
+    job.destination = current;
+    job.sourceWidth = width;
+    runMipFilterJobs(&job, height, convertMipSourceRows, os, queue);
+
+    f32 targetCoverage = 0;
+    if(settings->preserveAlphaCoverage){
+        targetCoverage = computeAlphaCoverage(current, width * height, settings->alphaCutoff, 1);
+    }
+
+    u8* out = dst + width * height * 4;
+    u32 w = width;
+    u32 h = height;
+    for(u32 level = 1; level < levels; level++){
+        u32 nw = getMipLevelDimension(width, level);
+        u32 nh = getMipLevelDimension(height, level);
+
+        buildMipFilterTaps(w, nw, settings->filter, taps);
+        job.source = current;
+        job.destination = intermediate;
+        job.taps = taps;
+        job.sourceWidth = w;
+        job.destinationWidth = nw;
+        runMipFilterJobs(&job, h, filterMipRowsHorizontal, os, queue);
+
+        buildMipFilterTaps(h, nh, settings->filter, taps);
+        job.source = intermediate;
+        job.destination = next;
+        job.sourceHeight = h;
+        runMipFilterJobs(&job, nh, filterMipRowsVertical, os, queue);
+
+        job.alphaScale = 1;
+        if(settings->preserveAlphaCoverage){
+            job.alphaScale = findAlphaCoverageScale(next, nw * nh, settings->alphaCutoff, targetCoverage);
+        }
+        job.source = next;
+        job.output = out;
+        job.sourceWidth = nw;
+        runMipFilterJobs(&job, nh, quantizeMipRows, os, queue);
+
+        f32* t = current;
+        current = next;
+        next = t;
+        out += nw * nh * 4;
+        w = nw;
+        h = nh;
+    }
+
+    scratch->used = scratchMark;
+    return true;
+}
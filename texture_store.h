@@ -0,0 +1,300 @@
+#pragma once
+
+#include "upload_scheduler.h"
+#include "descriptor_allocator.h"
+
+//Texture store.
+//Keeps Texture2Ds in default heap textures filled on the copy queue, the way the model store keeps models.
+//createStoredTexture2D creates the texture with the mip levels it is given, writes a shader view of it into a
+//persistent slot of the store's descriptor allocator, copies the levels into the store's sources and requests an
+//upload per level, so the caller may free its data on return; the platform layers' createTexture2D hooks are this
+//call, with Texture2D::data1 the StoredTexture and data2 the store. Sources that fill up are emptied by finishing
+//every upload, and a texture bigger than all of them is uploaded from the caller's data and finished before returning.
+//A texture is sampled once waitForStoredTexture says its upload is on the way, through the bindless index in its
+//descriptor. Textures live until the store is destroyed. The scratch arena is for whoever loads textures into the
+//store, to read and decode files and generate mip chains in. Everything here is for the main thread.
+//A texture can be created with only its coarsest levels, from firstLevel on, for texture streaming to fill in the rest:
+//updateStoredTexture2DLevels uploads finer levels and beginTextureStoreFrame moves the view onto them once they are
+//copied, evictStoredTexture2DLevels moves the view back to coarser ones right away. The view is rewritten into a new
+//descriptor and the old one retired, so frames in flight keep sampling what they were recorded with. The texture's
+//memory holds every level from the start, only what is uploaded and sampled changes.
+//updateStoredTexture2D uploads a region of level 0 over what is there, for textures filled in piece by piece like a
+//glyph atlas.
+
+#define TEXTURE_STORE_NOT_STREAMED MAX_U32
+
+struct StoredTexture {
+    RenderResource resource;
+    u32 width;
+    u32 height;
+    u32 format;
+    u32 mipLevels;
+    u32 descriptor;
+    u64 uploadTicket;
+    //the most detailed level the view shows, and the one it moves to once levelTicket is copied
+    u32 viewLevel;
+    u32 loadedLevel;
+    u64 levelTicket;
+    //the texture streaming id, TEXTURE_STORE_NOT_STREAMED for textures created whole
+    u32 streamedTexture;
+};
+
+struct TextureStoreStats {
+    u64 textures;
+    u64 uploadedBytes;
+    u64 failedTextures;
+    u64 sourceFlushes;
+    u64 levelUpdates;
+    u64 regionUpdates;
+    u64 viewChanges;
+    u64 failedViewChanges;
+};
+
+struct TextureStore {
+    RenderBackend* backend;
+    UploadScheduler* uploads;
+    DescriptorAllocator* descriptors;
+    StoredTexture* textures;
+    u32 totalTextures;
+    u32 maxTextures;
+
+    //copies of levels waiting for their upload, emptied once the newest upload is done
+    MemoryArena sources;
+    MemoryArena scratch;
+    u64 lastTicket;
+
+    TextureStoreStats stats;
+};
+
+//sourceSize bounds the levels waiting to be uploaded at once, scratchSize the loaders' working memory
+static bool initializeTextureStore(TextureStore* store, RenderBackend* backend, UploadScheduler* uploads,
+                                   DescriptorAllocator* descriptors, u32 maxTextures, u32 sourceSize, u32 scratchSize,
+                                   MemoryArena* arena){
+    setMemory(store, sizeof(TextureStore));
+    store->backend = backend;
+    store->uploads = uploads;
+    store->descriptors = descriptors;
+    store->maxTextures = maxTextures;
+    store->textures = pushArray(arena, StoredTexture, maxTextures);
+    void* sources = pushSize(arena, sourceSize);
+    void* scratch = scratchSize ? pushSize(arena, scratchSize) : 0;
+    if(!store->textures || !sources || (scratchSize && !scratch)){
+        return false;
+    }
+    store->sources = createMemoryArena(sources, sourceSize);
+    store->scratch = createMemoryArena(scratch, scratchSize);
+    return true;
+}
+
+//a copy of data that lives until its upload is done, 0 when it is bigger than all the sources
+static u8* pushTextureStoreSource(TextureStore* store, void* data, u32 size){
+    u8* source = (u8*)pushSize(&store->sources, size);
+    if(!source && size <= store->sources.size){
+        flushUploadScheduler(store->uploads);
+        store->sources.used = 0;
+        store->stats.sourceFlushes++;
+        source = (u8*)pushSize(&store->sources, size);
+    }
+    if(source){
+        copyMemory(source, data, size);
+    }
+    return source;
+}
+
+//the queue a full scheduler leaves no room in is emptied once before giving up
+static u64 requestTextureStoreUpload(TextureStore* store, StoredTexture* texture, u32 level, void* data){
+    u32 width = getRenderTextureLevelDimension(texture->width, level);
+    u32 height = getRenderTextureLevelDimension(texture->height, level);
+    u64 ticket = requestTextureUpload(store->uploads, &texture->resource, level, 0, 0, width, height, texture->format,
+                                      data);
+    if(ticket == UPLOAD_TICKET_NONE){
+        flushUploadScheduler(store->uploads);
+        ticket = requestTextureUpload(store->uploads, &texture->resource, level, 0, 0, width, height, texture->format,
+                                      data);
+    }
+    return ticket;
+}
+
+//Requests the upload of levels firstLevel to endLevel - 1, which data holds back to back, and returns the ticket of the
+//last one or UPLOAD_TICKET_NONE, after the ones already requested are copied, when one could not be queued.
+static u64 uploadStoredTexture2DLevels(TextureStore* store, StoredTexture* texture, u32 firstLevel, u32 endLevel,
+                                       void* data){
+    u32 format = texture->format;
+    u64 skipped = getRenderTextureSize(format, texture->width, texture->height, firstLevel);
+    u64 size = getRenderTextureSize(format, texture->width, texture->height, endLevel) - skipped;
+    u8* source = pushTextureStoreSource(store, data, (u32)size);
+    bool direct = !source;
+    if(direct){
+        source = (u8*)data;
+    }
+    u64 ticket = UPLOAD_TICKET_NONE;
+    for(u32 level = firstLevel; level < endLevel; level++){
+        u64 offset = getRenderTextureSize(format, texture->width, texture->height, level) - skipped;
+        ticket = requestTextureStoreUpload(store, texture, level, source + offset);
+        if(ticket == UPLOAD_TICKET_NONE){
+            flushUploadScheduler(store->uploads);
+            return UPLOAD_TICKET_NONE;
+        }
+    }
+    if(direct){
+        flushUploadScheduler(store->uploads);
+    }
+    store->lastTicket = ticket;
+    store->stats.uploadedBytes += size;
+    return ticket;
+}
+
+//Returns 0 when the store, the descriptors or the upload queue have no room, or the backend cannot create the
+//texture. data holds levels firstLevel to mipLevels - 1 back to back, largest first, each as tightly packed rows of
+//texels or blocks, and the finer levels are left for updateStoredTexture2DLevels.
+static StoredTexture* createStoredTexture2D(TextureStore* store, void* data, u32 width, u32 height, u32 format,
+                                            u32 mipLevels, u32 firstLevel = 0){
+    RenderBackend* backend = store->backend;
+    StoredTexture* texture = &store->textures[store->totalTextures];
+    u64 size = getRenderTextureSize(format, width, height, mipLevels);
+    if(store->totalTextures == store->maxTextures || !size || size > MAX_U32 || firstLevel >= mipLevels ||
+       !backend->createTexture2D(backend, width, height, format, mipLevels, RENDER_STATE_COMMON, &texture->resource)){
+        store->stats.failedTextures++;
+        return 0;
+    }
+    texture->width = width;
+    texture->height = height;
+    texture->format = format;
+    texture->mipLevels = mipLevels;
+    texture->viewLevel = firstLevel;
+    texture->loadedLevel = firstLevel;
+    texture->streamedTexture = TEXTURE_STORE_NOT_STREAMED;
+    texture->descriptor = allocateDescriptor(store->descriptors);
+    if(texture->descriptor == DESCRIPTOR_INDEX_NONE){
+        backend->destroyResource(backend, &texture->resource);
+        store->stats.failedTextures++;
+        return 0;
+    }
+    backend->createTextureShaderView(backend, &store->descriptors->heap, texture->descriptor, &texture->resource,
+                                     firstLevel);
+    texture->uploadTicket = uploadStoredTexture2DLevels(store, texture, firstLevel, mipLevels, data);
+    texture->levelTicket = texture->uploadTicket;
+    if(texture->uploadTicket == UPLOAD_TICKET_NONE){
+        //the levels already requested were copied before the texture goes away
+        freeDescriptor(store->descriptors, texture->descriptor);
+        backend->destroyResource(backend, &texture->resource);
+        store->stats.failedTextures++;
+        return 0;
+    }
+    store->totalTextures++;
+    store->stats.textures++;
+    return texture;
+}
+
+//Uploads the finer levels firstLevel to endLevel - 1 of a texture created with only its coarser ones, the view takes
+//them in once they are copied. False when they could not all be queued, the view then stays where it is.
+static bool updateStoredTexture2DLevels(TextureStore* store, StoredTexture* texture, u32 firstLevel, u32 endLevel,
+                                        void* data){
+    if(firstLevel >= endLevel || endLevel > texture->mipLevels){
+        return false;
+    }
+    u64 ticket = uploadStoredTexture2DLevels(store, texture, firstLevel, endLevel, data);
+    if(ticket == UPLOAD_TICKET_NONE){
+        return false;
+    }
+    store->stats.levelUpdates++;
+    texture->levelTicket = ticket;
+    if(firstLevel < texture->loadedLevel){
+        texture->loadedLevel = firstLevel;
+    }
+    return true;
+}
+
+//Uploads width by height texels at x, y of level 0, which data holds as tightly packed rows, and has draws waiting on
+//the texture wait for it too. Frames in flight sampling the region may see the old texels or the new ones, so callers
+//write regions nothing drawn yet reads. False when the region is outside the texture or could not be queued.
+static bool updateStoredTexture2D(TextureStore* store, StoredTexture* texture, void* data, u32 x, u32 y, u32 width,
+                                  u32 height){
+    if(!width || !height || x + width > texture->width || y + height > texture->height){
+        return false;
+    }
+    u64 size = (u64)getRenderTextureRowSize(texture->format, width) * getRenderTextureRows(texture->format, height);
+    if(size > MAX_U32){
+        return false;
+    }
+    u8* source = pushTextureStoreSource(store, data, (u32)size);
+    bool direct = !source;
+    if(direct){
+        source = (u8*)data;
+    }
+    u64 ticket = requestTextureUpload(store->uploads, &texture->resource, 0, x, y, width, height, texture->format,
+                                      source);
+    if(ticket == UPLOAD_TICKET_NONE){
+        flushUploadScheduler(store->uploads);
+        ticket = requestTextureUpload(store->uploads, &texture->resource, 0, x, y, width, height, texture->format,
+                                      source);
+    }
+    if(direct){
+        flushUploadScheduler(store->uploads);
+    }
+    if(ticket == UPLOAD_TICKET_NONE){
+        return false;
+    }
+    texture->uploadTicket = ticket;
+    store->lastTicket = ticket;
+    store->stats.uploadedBytes += size;
+    store->stats.regionUpdates++;
+    return true;
+}
+
+//a view that could not get a descriptor stays as it was and is tried again next frame
+static void setStoredTexture2DViewLevel(TextureStore* store, StoredTexture* texture, u32 level){
+    RenderBackend* backend = store->backend;
+    u32 descriptor = allocateDescriptor(store->descriptors);
+    if(descriptor == DESCRIPTOR_INDEX_NONE){
+        store->stats.failedViewChanges++;
+        return;
+    }
+    backend->createTextureShaderView(backend, &store->descriptors->heap, descriptor, &texture->resource, level);
+    retireDescriptor(store->descriptors, texture->descriptor);
+    texture->descriptor = descriptor;
+    texture->viewLevel = level;
+    store->stats.viewChanges++;
+}
+
+//levels finer than level stop being sampled from the next frame recorded, their memory stays
+static void evictStoredTexture2DLevels(TextureStore* store, StoredTexture* texture, u32 level){
+    if(level >= texture->mipLevels){
+        return;
+    }
+    if(level > texture->loadedLevel){
+        texture->loadedLevel = level;
+    }
+    if(texture->viewLevel < level){
+        setStoredTexture2DViewLevel(store, texture, level);
+    }
+}
+
+//false while the texture's upload is still waiting for a batch, draws sampling it have to be skipped until then
+static bool waitForStoredTexture(TextureStore* store, u32 queue, StoredTexture* texture){
+    return waitForUploadOnQueue(store->uploads, queue, texture->uploadTicket);
+}
+
+//Once a frame, gives the sources back once every upload from them is done and moves views onto the levels whose
+//copy is done. Textures created whole never have a view to move.
+static void beginTextureStoreFrame(TextureStore* store){
+    if(store->sources.used && isUploadComplete(store->uploads, store->lastTicket)){
+        store->sources.used = 0;
+    }
+    for(u32 i = 0; i < store->totalTextures; i++){
+        StoredTexture* texture = &store->textures[i];
+        if(texture->loadedLevel < texture->viewLevel && isUploadComplete(store->uploads, texture->levelTicket)){
+            setStoredTexture2DViewLevel(store, texture, texture->loadedLevel);
+        }
+    }
+}
+
+//the gpu has to be done with every texture, and the uploads flushed
+static void destroyTextureStore(TextureStore* store){
+    RenderBackend* backend = store->backend;
+    for(u32 i = 0; i < store->totalTextures; i++){
+        freeDescriptor(store->descriptors, store->textures[i].descriptor);
+        backend->destroyResource(backend, &store->textures[i].resource);
+    }
+    store->totalTextures = 0;
+}
@@ -0,0 +1,482 @@
+#pragma once
+
+#include "image_loaders.h"
+#include "texture_store.h"
+
+// Mip level residency for Texture2Ds under a memory budget. Each frame the game reports which textures are used and
+// how large they appear on screen; updateTextureStreaming then loads missing levels, most visible first, and makes
+// room by evicting the finest levels of the least recently used textures. The coarsest levels of every texture
+// stay resident so something can always be sampled.
+// Reads go through the pool's readLevels callback, by default the os file handle functions run on a work queue,
+// and finished reads are picked up on a later update. Nothing here touches the GPU, so the policy can be run
+// headless by supplying callbacks that only pretend to load.
+// initializeTextureStreamingStore points the callbacks at a texture store, for the platform layers' texture path:
+// createStreamedTexture2DFromFile creates a file's texture in the store with only its coarsest levels uploaded,
+// finished reads are uploaded into it and evictions move its view back to coarser levels. requestModel3DTextures
+// is the feedback for a model about to be drawn.
+
+#define TEXTURE_STREAMING_MAX_PENDING_LOADS 32
+#define TEXTURE_STREAMING_NO_LOAD MAX_U32
+#define TEXTURE_STREAMING_MAX_NAME 256
+
+struct StreamedTexture {
+    Texture2D texture;
+    s8* fileName;
+    u32 width;
+    u32 height;
+    u32 format;
+    u32 totalLevels;
+    u32 levelSizes[IMAGE_MAX_LEVELS];
+    u64 levelFileOffsets[IMAGE_MAX_LEVELS];
+    //finest level resident; levels residentLevel..totalLevels-1 are in memory
+    u32 residentLevel;
+    u32 wantedLevel;
+    u32 pendingLoad;
+    f32 screenPixels;
+    u64 lastUsedFrame;
+};
+
+struct TextureLoadRequest {
+    OSInterface* os;
+    StreamedTexture* texture;
+    u8* destination;
+    u32 firstLevel;
+    u32 endLevel;
+    u64 size;
+    volatile u32 complete;
+    bool active;
+};
+
+struct TextureStreamingStatistics {
+    u64 requests;
+    u64 hits;
+    u64 bytesStreamed;
+    u64 bytesEvicted;
+    u64 loadsIssued;
+    u64 loadsDeferred;
+};
+
+struct TextureStreamingManager {
+    StreamedTexture* textures;
+    u32 totalTextures;
+    u32 maxTextures;
+
+    u64 budgetBytes;
+    u64 residentBytes;
+    u32 minResidentLevels;
+    u32 maxLoadsPerUpdate;
+    u64 maxBytesPerUpdate;
+    u64 frame;
+
+    TextureLoadRequest loads[TEXTURE_STREAMING_MAX_PENDING_LOADS];
+    OSInterface* os;
+    WorkQueue* queue;
+
+    //returns memory the levels firstLevel..endLevel-1 can be read into, or 0 to try again next update
+    u8* (*beginLevelLoad)(StreamedTexture* texture, u32 firstLevel, u32 endLevel, u64 size, void* userData);
+    //called on the updating thread once the read finished, so the backend can copy into the texture
+    void (*finishLevelLoad)(StreamedTexture* texture, u32 firstLevel, u32 endLevel, u8* data, void* userData);
+    void (*evictLevels)(StreamedTexture* texture, u32 newResidentLevel, void* userData);
+    //fills request->destination and sets request->complete; may run on a worker thread
+    void (*readLevels)(TextureLoadRequest* request);
+    void* userData;
+
+    TextureStreamingStatistics stats;
+};
+
+static u64 getStreamedTextureBytes(StreamedTexture* texture, u32 firstLevel, u32 endLevel){
+    u64 bytes = 0;
+    for(u32 i = firstLevel; i < endLevel; i++){
+        bytes += texture->levelSizes[i];
+    }
+    return bytes;
+}
+
+static u32 getStreamedTextureCoarsestLevel(TextureStreamingManager* manager, StreamedTexture* texture){
+    return texture->totalLevels > manager->minResidentLevels ? texture->totalLevels - manager->minResidentLevels : 0;
+}
+
+//default readLevels: reads each level of face 0 with the os file handle functions
+static void readTextureLevelsFromFile(TextureLoadRequest* request){
+    OSInterface* os = request->os;
+    StreamedTexture* texture = request->texture;
+    FileHandle handle = os->getFileHandleForReading(texture->fileName);
+    u8* dst = request->destination;
+    for(u32 i = request->firstLevel; i < request->endLevel; i++){
+        os->setFileHandlePointer(&handle, (u32)texture->levelFileOffsets[i]);
+        os->readFromFileHandle(&handle, dst, texture->levelSizes[i]);
+        dst += texture->levelSizes[i];
+    }
+    os->closeFileHandle(&handle);
+    request->complete = 1;
+}
+
+static void readTextureLevelsJob(void* data){
+    readTextureLevelsFromFile((TextureLoadRequest*)data);
+}
+
+//Reads are queued without waiting on the queue, so queue should be one that nothing else completes on the
+//main thread every frame. Without os and queue every read happens inline during updateTextureStreaming.
+static bool initializeTextureStreamingManager(TextureStreamingManager* manager, u32 maxTextures, u64 budgetBytes,
+                                              MemoryArena* arena, OSInterface* os = 0, WorkQueue* queue = 0){
+    setMemory(manager, sizeof(TextureStreamingManager), 0);
+    manager->textures = pushArray(arena, StreamedTexture, maxTextures);
+    if(!manager->textures) return false;
+    manager->maxTextures = maxTextures;
+    manager->budgetBytes = budgetBytes;
+    manager->minResidentLevels = 4;
+    manager->maxLoadsPerUpdate = 8;
+    manager->maxBytesPerUpdate = MEGABYTE(32);
+    manager->os = os;
+    manager->queue = queue;
+    manager->readLevels = readTextureLevelsFromFile;
+    return true;
+}
+
+//Registers a texture whose levels live in fileName. image is the parsed file (see decodeImage) and fileData the
+//buffer it was parsed from, which is only used to find the level offsets. Only the coarsest minResidentLevels
+//are counted as resident; the caller creates the texture with those. Returns the texture id.
+static u32 addStreamedTexture(TextureStreamingManager* manager, s8* fileName, ImageData* image, u8* fileData){
+    if(manager->totalTextures == manager->maxTextures) return MAX_U32;
+    u32 id = manager->totalTextures++;
+    StreamedTexture* texture = &manager->textures[id];
+    setMemory(texture, sizeof(StreamedTexture), 0);
+    texture->fileName = fileName;
+    texture->width = image->width;
+    texture->height = image->height;
+    texture->format = image->format;
+    texture->totalLevels = image->totalLevels;
+    for(u32 i = 0; i < image->totalLevels; i++){
+        texture->levelSizes[i] = image->levelSizes[i];
+        texture->levelFileOffsets[i] = (u64)(image->levelData[0][i] - fileData);
+    }
+    texture->residentLevel = getStreamedTextureCoarsestLevel(manager, texture);
+    texture->wantedLevel = texture->residentLevel;
+    texture->pendingLoad = TEXTURE_STREAMING_NO_LOAD;
+    manager->residentBytes += getStreamedTextureBytes(texture, texture->residentLevel, texture->totalLevels);
+    return id;
+}
+
+static void beginTextureStreamingFrame(TextureStreamingManager* manager){
+    manager->frame++;
+    for(u32 i = 0; i < manager->totalTextures; i++){
+        StreamedTexture* texture = &manager->textures[i];
+        texture->wantedLevel = getStreamedTextureCoarsestLevel(manager, texture);
+        texture->screenPixels = 0;
+    }
+}
+
+//the level whose texels map about 1:1 onto the pixels the texture covers
+static void requestStreamedTexture(TextureStreamingManager* manager, u32 id, f32 screenPixels){
+    StreamedTexture* texture = &manager->textures[id];
+    u32 largest = texture->width > texture->height ? texture->width : texture->height;
+    u32 level = 0;
+    if(screenPixels < 1){
+        screenPixels = 1;
+    }
+    while(level + 1 < texture->totalLevels && (f32)(largest >> (level + 1)) >= screenPixels){
+        level++;
+    }
+    if(level < texture->wantedLevel){
+        texture->wantedLevel = level;
+    }
+    if(screenPixels > texture->screenPixels){
+        texture->screenPixels = screenPixels;
+    }
+    texture->lastUsedFrame = manager->frame;
+}
+
+//Uses the projected diameter of the model, assuming the texture is mapped once over its largest scaled extent,
+//the same estimate selectModel3DLod makes for geometric error.
+static void requestStreamedTextureForModel(TextureStreamingManager* manager, u32 id, Model3D* model, Camera* camera, f32 viewportHeight){
+    f32 distance = length(model->position - camera->position);
+    f32 scale = model->scale.x;
+    if(model->scale.y > scale) scale = model->scale.y;
+    if(model->scale.z > scale) scale = model->scale.z;
+    f32 projectionScale = camera->projection.m2[1][1] * 0.5f * viewportHeight;
+    f32 screenPixels = distance > scale ? 2.0f * scale * projectionScale / distance : viewportHeight;
+    requestStreamedTexture(manager, id, screenPixels);
+}
+
+//the coarsest level a requester this visible may evict the texture down to. Textures used this frame only give up
+//levels finer than they want, unless the requester is more than twice as visible; the margin keeps similarly sized
+//textures from evicting each other back and forth.
+static u32 getStreamedTextureEvictionFloor(TextureStreamingManager* manager, StreamedTexture* texture,
+                                           f32 requesterPixels){
+    bool protect = texture->lastUsedFrame == manager->frame && texture->screenPixels * 2 >= requesterPixels;
+    return protect ? texture->wantedLevel : getStreamedTextureCoarsestLevel(manager, texture);
+}
+
+//what evictStreamedTextureLevel could free for a requester this visible
+static u64 getEvictableStreamedTextureBytes(TextureStreamingManager* manager, f32 requesterPixels){
+    u64 bytes = 0;
+    for(u32 i = 0; i < manager->totalTextures; i++){
+        StreamedTexture* texture = &manager->textures[i];
+        if(texture->pendingLoad != TEXTURE_STREAMING_NO_LOAD) continue;
+        u32 floor = getStreamedTextureEvictionFloor(manager, texture, requesterPixels);
+        if(texture->residentLevel < floor){
+            bytes += getStreamedTextureBytes(texture, texture->residentLevel, floor);
+        }
+    }
+    return bytes;
+}
+
+//drops the finest level of the least recently used texture holding more than it needs
+static bool evictStreamedTextureLevel(TextureStreamingManager* manager, f32 requesterPixels){
+    StreamedTexture* victim = 0;
+    for(u32 i = 0; i < manager->totalTextures; i++){
+        StreamedTexture* texture = &manager->textures[i];
+        if(texture->pendingLoad != TEXTURE_STREAMING_NO_LOAD) continue;
+        if(texture->residentLevel >= getStreamedTextureEvictionFloor(manager, texture, requesterPixels)) continue;
+        if(!victim || texture->lastUsedFrame < victim->lastUsedFrame ||
+           (texture->lastUsedFrame == victim->lastUsedFrame && texture->screenPixels < victim->screenPixels)){
+            victim = texture;
+        }
+    }
+    if(!victim) return false;
+    u32 size = victim->levelSizes[victim->residentLevel];
+    victim->residentLevel++;
+    manager->residentBytes -= size;
+    manager->stats.bytesEvicted += size;
+    if(manager->evictLevels){
+        manager->evictLevels(victim, victim->residentLevel, manager->userData);
+    }
+    return true;
+}
+
+static void completeTextureLoads(TextureStreamingManager* manager){
+    for(u32 i = 0; i < TEXTURE_STREAMING_MAX_PENDING_LOADS; i++){
+        TextureLoadRequest* request = &manager->loads[i];
+        if(!request->active || !request->complete) continue;
+        StreamedTexture* texture = request->texture;
+        if(manager->finishLevelLoad){
+            manager->finishLevelLoad(texture, request->firstLevel, request->endLevel, request->destination, manager->userData);
+        }
+        texture->residentLevel = request->firstLevel;
+        texture->pendingLoad = TEXTURE_STREAMING_NO_LOAD;
+        manager->stats.bytesStreamed += request->size;
+        request->active = false;
+    }
+}
+
+//Call after the frame's requests. Returns the number of loads issued.
+static u32 updateTextureStreaming(TextureStreamingManager* manager, MemoryArena* scratch){
+    completeTextureLoads(manager);
+
+    u64 scratchMark = scratch->used;
+    u32* order = pushArray(scratch, u32, manager->totalTextures);
+    f32* keys = pushArray(scratch, f32, manager->totalTextures);
+    if(!order || !keys){
+        scratch->used = scratchMark;
+        return 0;
+    }
+    u32 totalCandidates = 0;
+    for(u32 i = 0; i < manager->totalTextures; i++){
+        StreamedTexture* texture = &manager->textures[i];
+        keys[i] = texture->screenPixels;
+        if(texture->lastUsedFrame != manager->frame) continue;
+        manager->stats.requests++;
+        if(texture->residentLevel <= texture->wantedLevel){
+            manager->stats.hits++;
+        }else if(texture->pendingLoad == TEXTURE_STREAMING_NO_LOAD){
+            order[totalCandidates++] = i;
+        }
+    }
+    if(totalCandidates > 1){
+        sortIndicesByKeyDescending(order, keys, 0, totalCandidates - 1);
+    }
+
+    u32 loadsIssued = 0;
+    u64 bytesIssued = 0;
+    u32 slot = 0;
+    for(u32 c = 0; c < totalCandidates && loadsIssued < manager->maxLoadsPerUpdate; c++){
+        StreamedTexture* texture = &manager->textures[order[c]];
+        while(slot < TEXTURE_STREAMING_MAX_PENDING_LOADS && manager->loads[slot].active) slot++;
+        if(slot == TEXTURE_STREAMING_MAX_PENDING_LOADS) break;
+
+        //settle for a coarser level if the wanted one can't be made to fit, without evicting anything for a level
+        //that would not fit anyway
+        u32 firstLevel = texture->wantedLevel;
+        u64 size = 0;
+        u64 evictable = getEvictableStreamedTextureBytes(manager, texture->screenPixels);
+        for(; firstLevel < texture->residentLevel; firstLevel++){
+            size = getStreamedTextureBytes(texture, firstLevel, texture->residentLevel);
+            if(bytesIssued + size > manager->maxBytesPerUpdate && loadsIssued > 0) continue;
+            if(manager->residentBytes + size > manager->budgetBytes + evictable) continue;
+            while(manager->residentBytes + size > manager->budgetBytes && evictStreamedTextureLevel(manager, texture->screenPixels));
+            if(manager->residentBytes + size <= manager->budgetBytes) break;
+        }
+        if(firstLevel == texture->residentLevel){
+            manager->stats.loadsDeferred++;
+            continue;
+        }
+
+        u8* destination = manager->beginLevelLoad ? manager->beginLevelLoad(texture, firstLevel, texture->residentLevel, size, manager->userData) : 0;
+        if(!destination){
+            manager->stats.loadsDeferred++;
+            continue;
+        }
+        TextureLoadRequest* request = &manager->loads[slot];
+        request->os = manager->os;
+        request->texture = texture;
+        request->destination = destination;
+        request->firstLevel = firstLevel;
+        request->endLevel = texture->residentLevel;
+        request->size = size;
+        request->complete = 0;
+        request->active = true;
+        //the bytes count against the budget from the moment they are requested
+        manager->residentBytes += size;
+        texture->pendingLoad = slot;
+        loadsIssued++;
+        bytesIssued += size;
+        manager->stats.loadsIssued++;
+
+        if(manager->os && manager->queue && manager->readLevels == readTextureLevelsFromFile){
+            manager->os->addWorkQueueEntry(manager->queue, readTextureLevelsJob, request);
+        }else{
+            manager->readLevels(request);
+        }
+    }
+
+    scratch->used = scratchMark;
+    return loadsIssued;
+}
+
+static f32 getTextureStreamingHitRate(TextureStreamingManager* manager){
+    return manager->stats.requests ? (f32)manager->stats.hits / (f32)manager->stats.requests : 1.0f;
+}
+
+//The texture store side of streaming. Reads land in the reads arena, which is emptied once no read is in flight, and
+//a load waits for a later update while it is full. Names of the streamed files are kept in names.
+struct TextureStreamingStore {
+    TextureStore* store;
+    MemoryArena reads;
+    MemoryArena names;
+    u32 activeReads;
+    u64 failedUpdates;
+};
+
+static u8* beginStoredTextureLoad(StreamedTexture* texture, u32 firstLevel, u32 endLevel, u64 size, void* userData){
+    TextureStreamingStore* streaming = (TextureStreamingStore*)userData;
+    u8* destination = (u8*)pushSize(&streaming->reads, size);
+    if(destination){
+        streaming->activeReads++;
+    }
+    return destination;
+}
+
+//a failed upload leaves the view on the coarser levels, which are still right to sample
+static void finishStoredTextureLoad(StreamedTexture* texture, u32 firstLevel, u32 endLevel, u8* data, void* userData){
+    TextureStreamingStore* streaming = (TextureStreamingStore*)userData;
+    if(!updateStoredTexture2DLevels(streaming->store, (StoredTexture*)texture->texture.data1, firstLevel, endLevel,
+                                    data)){
+        streaming->failedUpdates++;
+    }
+    if(!--streaming->activeReads){
+        streaming->reads.used = 0;
+    }
+}
+
+static void evictStoredTextureLevels(StreamedTexture* texture, u32 newResidentLevel, void* userData){
+    TextureStreamingStore* streaming = (TextureStreamingStore*)userData;
+    evictStoredTexture2DLevels(streaming->store, (StoredTexture*)texture->texture.data1, newResidentLevel);
+}
+
+//readSize bounds the levels being read at once, at least the biggest level streamed has to fit
+static bool initializeTextureStreamingStore(TextureStreamingStore* streaming, TextureStreamingManager* manager,
+                                            TextureStore* store, u32 readSize, MemoryArena* arena){
+    setMemory(streaming, sizeof(TextureStreamingStore));
+    void* reads = pushSize(arena, readSize);
+    void* names = pushSize(arena, (u64)manager->maxTextures * TEXTURE_STREAMING_MAX_NAME);
+    if(!reads || !names){
+        return false;
+    }
+    streaming->store = store;
+    streaming->reads = createMemoryArena(reads, readSize);
+    streaming->names = createMemoryArena(names, (u64)manager->maxTextures * TEXTURE_STREAMING_MAX_NAME);
+    manager->beginLevelLoad = beginStoredTextureLoad;
+    manager->finishLevelLoad = finishStoredTextureLoad;
+    manager->evictLevels = evictStoredTextureLevels;
+    manager->userData = streaming;
+    return true;
+}
+
+//Streams the image's face 0 if it has levels to stream and they sit in fileData one after the other from the coarsest
+//resident one on, as they do in DDS files. Returns a texture with data1 0 otherwise, or when the manager or the store
+//are full.
+static Texture2D addStoredStreamedTexture(TextureStreamingManager* manager, TextureStreamingStore* streaming,
+                                          OSInterface* os, const s8* fileName, ImageData* image, u8* fileData){
+    Texture2D result = {};
+    u32 length = 0;
+    while(fileName[length]) length++;
+    if(image->totalFaces != 1 || image->totalLevels <= manager->minResidentLevels ||
+       manager->totalTextures == manager->maxTextures || length >= TEXTURE_STREAMING_MAX_NAME){
+        return result;
+    }
+    u32 firstLevel = image->totalLevels - manager->minResidentLevels;
+    u8* end = image->levelData[0][firstLevel];
+    for(u32 i = firstLevel; i < image->totalLevels; i++){
+        if(image->levelData[0][i] != end){
+            return result;
+        }
+        end += image->levelSizes[i];
+    }
+    u64 namesMark = streaming->names.used;
+    s8* name = (s8*)pushSize(&streaming->names, length + 1, 1);
+    u32 format = getImageTextureFormat(os, image->format);
+    StoredTexture* stored = name ? createStoredTexture2D(streaming->store, image->levelData[0][firstLevel],
+                                                         image->width, image->height, format, image->totalLevels,
+                                                         firstLevel) : 0;
+    if(!stored){
+        streaming->names.used = namesMark;
+        return result;
+    }
+    copyMemory(name, (void*)fileName, length + 1);
+    u32 id = addStreamedTexture(manager, name, image, fileData);
+    stored->streamedTexture = id;
+    result.data1 = stored;
+    result.data2 = streaming->store;
+    result.format = format;
+    manager->textures[id].texture = result;
+    return result;
+}
+
+//Reads and decodes the file in scratch the way createTexture2DFromImageFile does and streams it when
+//addStoredStreamedTexture can, else creates it whole through createTexture2DFromImage. For the platform layers'
+//createTexture2DFromFile hooks.
+static Texture2D createStreamedTexture2DFromFile(TextureStreamingManager* manager, TextureStreamingStore* streaming,
+                                                 OSInterface* os, const s8* fileName, MemoryArena* scratch,
+                                                 MipChainSettings* settings = 0, WorkQueue* queue = 0,
+                                                 u32 compression = IMAGE_FORMAT_RGBA8,
+                                                 u32 quality = BLOCK_COMPRESSION_QUALITY_NORMAL){
+    Texture2D texture = {};
+    u64 scratchMark = scratch->used;
+    u32 capacity = (u32)((scratch->size - scratch->used) / 2);
+    u8* data = (u8*)pushSize(scratch, capacity);
+    u32 fileLength = 0;
+    ImageData image = {};
+    if(data && os->readFileIntoBoundedBuffer(fileName, data, capacity, &fileLength)){
+        scratch->used = (u64)(data - scratch->base) + fileLength;
+        if(decodeImage(data, fileLength, &image, scratch)){
+            texture = addStoredStreamedTexture(manager, streaming, os, fileName, &image, data);
+            if(!texture.data1){
+                texture = createTexture2DFromImage(os, &image, scratch, settings, queue, compression, quality);
+            }
+        }
+    }
+    scratch->used = scratchMark;
+    return texture;
+}
+
+//the feedback for a model about to be drawn, its texture and normal map are requested if they are streamed
+static void requestModel3DTextures(TextureStreamingManager* manager, Model3D* model, Camera* camera,
+                                   f32 viewportHeight){
+    Texture2D* textures[2] = {&model->texture, &model->normalMap};
+    for(u32 i = 0; i < 2; i++){
+        StoredTexture* stored = (StoredTexture*)textures[i]->data1;
+        if(stored && stored->streamedTexture != TEXTURE_STORE_NOT_STREAMED){
+            requestStreamedTextureForModel(manager, stored->streamedTexture, model, camera, viewportHeight);
+        }
+    }
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "render_backend.h"
+
+//Upload ring.
+//One large upload buffer, mapped once for its whole life, that every frame suballocates linearly for constants,
+//dynamic vertex and index data and staging memory for copies into default heap buffers. Allocating is a compare
+//exchange on the frame's cursor, so any thread can allocate while the frame is recorded, and nothing is freed one
+//allocation at a time: endUploadRingFrame tags everything allocated since beginUploadRingFrame with the fence value
+//the frame will signal, and beginUploadRingFrame takes back the memory of every frame the fence has reached.
+//A frame's free space is the span from where the last frame ended up to the oldest frame still in flight. When that
+//span wraps past the end of the buffer an allocation that does not fit before the end skips to the start, and the
+//skipped bytes stay with the frame until it is reclaimed.
+//The ring itself only deals in offsets from a base pointer and in fence values, so initializeUploadRingMemory runs it
+//on plain memory with a counter standing in for the fence; initializeUploadRing puts it on a backend buffer.
+//Allocations are valid until the frame's fence value completes, and every thread must be done allocating and
+//writing before endUploadRingFrame. Allocating fails, and counts a failure, when the frames in flight hold the rest
+//of the ring, so it should be sized for the peak frame times the frames in flight.
+
+#define UPLOAD_RING_MAX_FRAMES 16
+#define UPLOAD_RING_TEXTURE_ALIGNMENT 512
+
+struct UploadAllocation {
+    u8* data;
+    u64 gpuAddress;
+    u32 offset;
+    u32 size;
+};
+
+struct UploadRingFrame {
+    u64 fenceValue;
+    u32 end;
+    u32 size;
+};
+
+struct UploadRingStats {
+    u64 frames;
+    u64 allocatedBytes;
+    u64 failedAllocations;
+    u32 peakFrameBytes;
+    u32 peakUsedBytes;
+};
+
+struct UploadRing {
+    RenderResource buffer;
+    u8* memory;
+    u64 gpuAddress;
+    u32 size;
+
+    //bytes of the frame's free span handed out so far, the only field written by more than one thread
+    volatile u32 cursor;
+    volatile u32 frameFailures;
+    u32 frameStart;
+    u32 firstSpanSize;
+    u32 secondSpanSize;
+
+    u32 head;
+    u32 tail;
+    u32 usedBytes;
+    UploadRingFrame frames[UPLOAD_RING_MAX_FRAMES];
+    u32 firstFrame;
+    u32 totalFrames;
+
+    UploadRingStats stats;
+};
+
+static void initializeUploadRingMemory(UploadRing* ring, u8* memory, u64 gpuAddress, u32 size){
+    setMemory(ring, sizeof(UploadRing));
+    ring->memory = memory;
+    ring->gpuAddress = gpuAddress;
+    ring->size = size;
+}
+
+//the buffer stays mapped until the ring is destroyed
+static bool initializeUploadRing(UploadRing* ring, RenderBackend* backend, u32 size){
+    RenderResource buffer;
+    if(!backend->createBuffer(backend, size, RENDER_HEAP_UPLOAD, RENDER_STATE_GENERIC_READ, &buffer)){
+        return false;
+    }
+    u8* memory = (u8*)backend->mapResource(backend, &buffer);
+    if(!memory){
+        backend->destroyResource(backend, &buffer);
+        return false;
+    }
+    initializeUploadRingMemory(ring, memory, buffer.gpuAddress, size);
+    ring->buffer = buffer;
+    return true;
+}
+
+static void destroyUploadRing(UploadRing* ring, RenderBackend* backend){
+    if(ring->buffer.handle){
+        backend->unmapResource(backend, &ring->buffer);
+        backend->destroyResource(backend, &ring->buffer);
+    }
+    setMemory(ring, sizeof(UploadRing));
+}
+
+//reclaims every frame the fence has reached and opens the free span for the next one
+static void beginUploadRingFrame(UploadRing* ring, u64 completedFenceValue){
+    while(ring->totalFrames){
+        UploadRingFrame* frame = &ring->frames[ring->firstFrame];
+        if(frame->fenceValue > completedFenceValue){
+            break;
+        }
+        ring->tail = frame->end;
+        ring->usedBytes -= frame->size;
+        ring->firstFrame = (ring->firstFrame + 1) % UPLOAD_RING_MAX_FRAMES;
+        ring->totalFrames--;
+    }
+    if(!ring->usedBytes){
+        //an empty ring starts over so the frame gets one unbroken span
+        ring->head = 0;
+        ring->tail = 0;
+        ring->firstSpanSize = ring->size;
+        ring->secondSpanSize = 0;
+    }else if(ring->head > ring->tail){
+        ring->firstSpanSize = ring->size - ring->head;
+        ring->secondSpanSize = ring->tail;
+    }else{
+        ring->firstSpanSize = ring->tail - ring->head;
+        ring->secondSpanSize = 0;
+    }
+    ring->frameStart = ring->head;
+    ring->cursor = 0;
+    ring->frameFailures = 0;
+}
+
+//alignment has to be a power of two, it is applied to the offset in the buffer
+static bool allocateUploadRing(UploadRing* ring, u32 size, u32 alignment, UploadAllocation* allocation){
+    if(!size || size > ring->size){
+        atomicAdd(&ring->frameFailures, 1);
+        return false;
+    }
+    u32 mask = alignment ? alignment - 1 : 0;
+    u32 firstSpanEnd = ring->frameStart + ring->firstSpanSize;
+    u32 offset;
+    for(;;){
+        u32 cursor = ring->cursor;
+        u32 next;
+        offset = (ring->frameStart + cursor + mask) & ~mask;
+        if(cursor < ring->firstSpanSize && offset <= firstSpanEnd && size <= firstSpanEnd - offset){
+            next = offset + size - ring->frameStart;
+        }else{
+            u32 secondCursor = cursor > ring->firstSpanSize ? cursor - ring->firstSpanSize : 0;
+            offset = (secondCursor + mask) & ~mask;
+            if(offset > ring->secondSpanSize || size > ring->secondSpanSize - offset){
+                atomicAdd(&ring->frameFailures, 1);
+                return false;
+            }
+            next = ring->firstSpanSize + offset + size;
+        }
+        if(atomicCompareExchange(&ring->cursor, next, cursor) == cursor){
+            break;
+        }
+    }
+    allocation->data = ring->memory + offset;
+    allocation->gpuAddress = ring->gpuAddress + offset;
+    allocation->offset = offset;
+    allocation->size = size;
+    return true;
+}
+
+//hands the frame's allocations to fenceValue, a full frame list folds the frame into the newest one
+static void endUploadRingFrame(UploadRing* ring, u64 fenceValue){
+    UploadRingStats* stats = &ring->stats;
+    u32 used = ring->cursor;
+    stats->frames++;
+    stats->allocatedBytes += used;
+    stats->failedAllocations += ring->frameFailures;
+    if(used > stats->peakFrameBytes){
+        stats->peakFrameBytes = used;
+    }
+    if(!used){
+        return;
+    }
+    u32 end = used <= ring->firstSpanSize ? ring->frameStart + used : used - ring->firstSpanSize;
+    ring->head = end == ring->size ? 0 : end;
+    ring->usedBytes += used;
+    if(ring->usedBytes > stats->peakUsedBytes){
+        stats->peakUsedBytes = ring->usedBytes;
+    }
+    if(ring->totalFrames == UPLOAD_RING_MAX_FRAMES){
+        UploadRingFrame* newest = &ring->frames[(ring->firstFrame + ring->totalFrames - 1) % UPLOAD_RING_MAX_FRAMES];
+        newest->fenceValue = fenceValue;
+        newest->end = ring->head;
+        newest->size += used;
+        return;
+    }
+    UploadRingFrame* frame = &ring->frames[(ring->firstFrame + ring->totalFrames) % UPLOAD_RING_MAX_FRAMES];
+    frame->fenceValue = fenceValue;
+    frame->end = ring->head;
+    frame->size = used;
+    ring->totalFrames++;
+}
+
+//rounded to what a constant buffer view can address
+static bool allocateUploadConstants(UploadRing* ring, u32 size, UploadAllocation* allocation){
+    size = (size + RENDER_CONSTANT_BUFFER_ALIGNMENT - 1) & ~(RENDER_CONSTANT_BUFFER_ALIGNMENT - 1);
+    return allocateUploadRing(ring, size, RENDER_CONSTANT_BUFFER_ALIGNMENT, allocation);
+}
+
+//copies data into the ring and narrows view to it, for vertex and index data the gpu reads straight from the ring
+static bool pushUploadBuffer(UploadRing* ring, void* data, u32 size, u32 alignment, RenderResource* view){
+    UploadAllocation allocation;
+    if(!allocateUploadRing(ring, size, alignment, &allocation)){
+        return false;
+    }
+    copyMemory(allocation.data, data, size);
+    *view = ring->buffer;
+    view->gpuAddress = allocation.gpuAddress;
+    view->size = size;
+    return true;
+}
+
+//stages data in the ring and records its copy into dst, which has to be in a copy destination state
+static bool stageUploadCopy(UploadRing* ring, RenderCommandList* list, RenderResource* dst, u64 dstOffset, void* data,
+                            u32 size){
+    UploadAllocation allocation;
+    if(!allocateUploadRing(ring, size, 16, &allocation)){
+        return false;
+    }
+    copyMemory(allocation.data, data, size);
+    list->backend->copyBuffer(list, dst, dstOffset, &ring->buffer, allocation.offset, size);
+    return true;
+}
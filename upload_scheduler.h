@@ -0,0 +1,353 @@
+#pragma once
+
+#include "upload_ring.h"
+
+//Upload scheduler.
+//Moves data into default heap buffers on the copy queue, so static geometry is read from video memory every frame
+//instead of across the bus from upload memory. requestUpload queues a copy and returns a ticket; once a frame
+//updateUploadScheduler stages queued data in its own upload ring and records the copies into one command list for
+//the copy queue, which signals the scheduler's fence when it is done. Requests are taken in order until the frame's
+//bytesPerFrame budget is spent, a large one is split across frames, and copies that continue the previous one into
+//the same buffer are merged into it. Staging memory goes back to the ring when the copy fence passes the batch.
+//A ticket is complete once its copy is done. waitForUploadOnQueue makes a queue wait on the GPU for a submitted
+//ticket, so a draw can be recorded as soon as the copy is on its way without the CPU waiting for it.
+//requestTextureUpload does the same for a region of one texture level. Its rows are staged at the row pitch and
+//offset alignment the copy needs, whole rows at a time (block rows for compressed formats), and are never merged.
+//Destinations have to be in the common state and untouched by other queues until their ticket completes, and the
+//source data has to stay alive until the ticket is submitted.
+
+#define UPLOAD_SCHEDULER_MAX_REQUESTS 1024
+#define UPLOAD_SCHEDULER_MAX_BATCHES RENDER_MAX_FRAMES_IN_FLIGHT
+#define UPLOAD_SCHEDULER_MAX_BATCH_COPIES 1024
+#define UPLOAD_SCHEDULER_STAGING_ALIGNMENT 4
+#define UPLOAD_TICKET_NONE 0
+
+//rowSize is 0 for buffers, for textures data is rowSize bytes per row without padding
+struct UploadRequest {
+    RenderResource* dst;
+    u64 dstOffset;
+    u8* data;
+    u32 size;
+    u32 uploadedBytes;
+    u64 ticket;
+    u64 requestFrame;
+    u32 rowSize;
+    u32 rowHeight;
+    u32 mipLevel;
+    u32 x;
+    u32 y;
+    u32 width;
+    u32 height;
+};
+
+struct UploadBatch {
+    u64 fenceValue;
+    u64 lastTicket;
+    u64 completedRequests;
+    u64 requestFrames;
+};
+
+struct UploadCopy {
+    RenderResource* dst;
+    u64 dstOffset;
+    u32 stagingOffset;
+    u32 size;
+};
+
+struct UploadSchedulerStats {
+    u64 requests;
+    u64 uploadedBytes;
+    u64 copies;
+    u64 mergedCopies;
+    u64 batches;
+    u64 budgetLimitedFrames;
+    u64 copyQueueBusyFrames;
+    u64 completedRequests;
+    u64 totalLatencyFrames;
+};
+
+struct UploadScheduler {
+    RenderBackend* backend;
+    RenderCommandList commandList;
+    RenderFence fence;
+    UploadRing staging;
+    u64 bytesPerFrame;
+    u64 frame;
+
+    UploadRequest requests[UPLOAD_SCHEDULER_MAX_REQUESTS];
+    u32 firstRequest;
+    u32 totalRequests;
+    u64 nextTicket;
+
+    UploadBatch batches[UPLOAD_SCHEDULER_MAX_BATCHES];
+    u32 firstBatch;
+    u32 totalBatches;
+    u64 submittedBatches;
+    u64 completedTicket;
+
+    UploadSchedulerStats stats;
+};
+
+static bool initializeUploadScheduler(UploadScheduler* scheduler, RenderBackend* backend, u32 stagingSize,
+                                      u64 bytesPerFrame){
+    setMemory(scheduler, sizeof(UploadScheduler));
+    scheduler->backend = backend;
+    scheduler->bytesPerFrame = bytesPerFrame;
+    scheduler->nextTicket = UPLOAD_TICKET_NONE + 1;
+    return backend->createCommandList(backend, RENDER_QUEUE_COPY, &scheduler->commandList) &&
+           backend->createFence(backend, 0, &scheduler->fence) &&
+           initializeUploadRing(&scheduler->staging, backend, stagingSize);
+}
+
+//returns UPLOAD_TICKET_NONE when too many requests are waiting, try again after the next update
+static u64 requestUpload(UploadScheduler* scheduler, RenderResource* dst, u64 dstOffset, void* data, u32 size){
+    if(scheduler->totalRequests == UPLOAD_SCHEDULER_MAX_REQUESTS || !size || dstOffset + size > dst->size){
+        return UPLOAD_TICKET_NONE;
+    }
+    UploadRequest* request = &scheduler->requests[(scheduler->firstRequest + scheduler->totalRequests) %
+                                                  UPLOAD_SCHEDULER_MAX_REQUESTS];
+    setMemory(request, sizeof(UploadRequest));
+    request->dst = dst;
+    request->dstOffset = dstOffset;
+    request->data = (u8*)data;
+    request->size = size;
+    request->ticket = scheduler->nextTicket++;
+    request->requestFrame = scheduler->frame;
+    scheduler->totalRequests++;
+    scheduler->stats.requests++;
+    return request->ticket;
+}
+
+//Queues a copy of width by height texels of format into the region at x, y of the texture's mipLevel, which has to
+//start and end on block boundaries or at the level's edge. Also returns UPLOAD_TICKET_NONE when one row of the
+//region does not fit in the staging ring.
+static u64 requestTextureUpload(UploadScheduler* scheduler, RenderResource* dst, u32 mipLevel, u32 x, u32 y, u32 width,
+                                u32 height, u32 format, void* data){
+    u32 rowSize = getRenderTextureRowSize(format, width);
+    u64 size = (u64)rowSize * getRenderTextureRows(format, height);
+    if(!rowSize || size > MAX_U32 ||
+       ((rowSize + RENDER_TEXTURE_ROW_ALIGNMENT - 1) & ~(RENDER_TEXTURE_ROW_ALIGNMENT - 1)) + RENDER_TEXTURE_COPY_ALIGNMENT > scheduler->staging.size){
+        return UPLOAD_TICKET_NONE;
+    }
+    u64 ticket = requestUpload(scheduler, dst, 0, data, (u32)size);
+    if(ticket != UPLOAD_TICKET_NONE){
+        UploadRequest* request = &scheduler->requests[(scheduler->firstRequest + scheduler->totalRequests - 1) %
+                                                      UPLOAD_SCHEDULER_MAX_REQUESTS];
+        request->rowSize = rowSize;
+        request->rowHeight = isRenderFormatBlockCompressed(format) ? 4 : 1;
+        request->mipLevel = mipLevel;
+        request->x = x;
+        request->y = y;
+        request->width = width;
+        request->height = height;
+    }
+    return ticket;
+}
+
+static void retireUploadBatches(UploadScheduler* scheduler){
+    RenderBackend* backend = scheduler->backend;
+    u64 completed = backend->getCompletedFenceValue(backend, &scheduler->fence);
+    while(scheduler->totalBatches){
+        UploadBatch* batch = &scheduler->batches[scheduler->firstBatch];
+        if(batch->fenceValue > completed){
+            break;
+        }
+        scheduler->completedTicket = batch->lastTicket;
+        scheduler->stats.completedRequests += batch->completedRequests;
+        scheduler->stats.totalLatencyFrames += batch->completedRequests * scheduler->frame - batch->requestFrames;
+        scheduler->firstBatch = (scheduler->firstBatch + 1) % UPLOAD_SCHEDULER_MAX_BATCHES;
+        scheduler->totalBatches--;
+    }
+}
+
+static bool isUploadComplete(UploadScheduler* scheduler, u64 ticket){
+    retireUploadBatches(scheduler);
+    return ticket <= scheduler->completedTicket;
+}
+
+//false while the ticket is still waiting for a batch, draws depending on it have to be skipped until then
+static bool waitForUploadOnQueue(UploadScheduler* scheduler, u32 queue, u64 ticket){
+    RenderBackend* backend = scheduler->backend;
+    if(isUploadComplete(scheduler, ticket)){
+        return true;
+    }
+    for(u32 i = 0; i < scheduler->totalBatches; i++){
+        UploadBatch* batch = &scheduler->batches[(scheduler->firstBatch + i) % UPLOAD_SCHEDULER_MAX_BATCHES];
+        if(batch->lastTicket >= ticket){
+            backend->waitForFenceOnQueue(backend, queue, &scheduler->fence, batch->fenceValue);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void recordUploadCopy(UploadScheduler* scheduler, UploadCopy* copy){
+    RenderBackend* backend = scheduler->backend;
+    backend->copyBuffer(&scheduler->commandList, copy->dst, copy->dstOffset, &scheduler->staging.buffer,
+                        copy->stagingOffset, copy->size);
+    scheduler->stats.copies++;
+}
+
+//Stages as many of the request's remaining rows as budget and the ring allow and records their copy, returning the
+//bytes taken from the request or 0 if nothing fit. A row larger than the budget goes alone when first is set.
+static u32 stageTextureUpload(UploadScheduler* scheduler, UploadRequest* request, u64 budget, bool first){
+    UploadRing* staging = &scheduler->staging;
+    u32 pitch = (request->rowSize + RENDER_TEXTURE_ROW_ALIGNMENT - 1) & ~(RENDER_TEXTURE_ROW_ALIGNMENT - 1);
+    u32 firstRow = request->uploadedBytes / request->rowSize;
+    u32 rows = (request->size - request->uploadedBytes) / request->rowSize;
+    if(rows > budget / request->rowSize){
+        rows = (u32)(budget / request->rowSize);
+    }
+    if(rows > (staging->size - request->rowSize) / pitch + 1){
+        rows = (staging->size - request->rowSize) / pitch + 1;
+    }
+    if(!rows && !first){
+        return 0;
+    }
+    rows = rows ? rows : 1;
+    UploadAllocation allocation;
+    while(!allocateUploadRing(staging, pitch * (rows - 1) + request->rowSize, UPLOAD_RING_TEXTURE_ALIGNMENT,
+                              &allocation)){
+        if(rows == 1){
+            return 0;
+        }
+        rows /= 2;
+    }
+    for(u32 row = 0; row < rows; row++){
+        copyMemory(allocation.data + row * pitch, request->data + request->uploadedBytes + row * request->rowSize,
+                   request->rowSize);
+    }
+    u32 y = request->y + firstRow * request->rowHeight;
+    u32 height = rows * request->rowHeight;
+    if(y + height > request->y + request->height){
+        height = request->y + request->height - y;
+    }
+    RenderBackend* backend = scheduler->backend;
+    backend->copyBufferToTexture(&scheduler->commandList, request->dst, request->mipLevel, request->x, y,
+                                 request->width, height, &staging->buffer, allocation.offset, pitch);
+    scheduler->stats.copies++;
+    return rows * request->rowSize;
+}
+
+//stages and copies queued requests until budget bytes are used, returns false if the copy queue has no free batch
+static bool submitUploadBatch(UploadScheduler* scheduler, u64 budget){
+    RenderBackend* backend = scheduler->backend;
+    RenderCommandList* list = &scheduler->commandList;
+    UploadRing* staging = &scheduler->staging;
+    retireUploadBatches(scheduler);
+    if(scheduler->totalBatches == UPLOAD_SCHEDULER_MAX_BATCHES){
+        return false;
+    }
+    u64 fenceValue = scheduler->submittedBatches + 1;
+    UploadBatch batch = {fenceValue, 0, 0, 0};
+    UploadCopy copy = {};
+    u32 totalCopies = 0;
+    beginUploadRingFrame(staging, backend->getCompletedFenceValue(backend, &scheduler->fence));
+    backend->resetCommandList(list, (u32)(scheduler->submittedBatches % UPLOAD_SCHEDULER_MAX_BATCHES), 0);
+    while(scheduler->totalRequests && budget && totalCopies < UPLOAD_SCHEDULER_MAX_BATCH_COPIES){
+        UploadRequest* request = &scheduler->requests[scheduler->firstRequest];
+        u32 size = request->size - request->uploadedBytes;
+        if(request->rowSize){
+            //texture copies keep the order of the buffer copy before them
+            if(copy.size){
+                recordUploadCopy(scheduler, &copy);
+                totalCopies++;
+                copy.size = 0;
+            }
+            size = stageTextureUpload(scheduler, request, budget, !totalCopies);
+            if(!size){
+                break;
+            }
+            totalCopies++;
+        }else{
+            if(size > budget){
+                size = (u32)budget;
+            }
+            if(size > staging->size){
+                size = staging->size;
+            }
+            UploadAllocation allocation;
+            if(!allocateUploadRing(staging, size, UPLOAD_SCHEDULER_STAGING_ALIGNMENT, &allocation)){
+                break;
+            }
+            copyMemory(allocation.data, request->data + request->uploadedBytes, size);
+            u64 dstOffset = request->dstOffset + request->uploadedBytes;
+            if(copy.size && copy.dst->handle == request->dst->handle && copy.dstOffset + copy.size == dstOffset &&
+               copy.stagingOffset + copy.size == allocation.offset){
+                copy.size += size;
+                scheduler->stats.mergedCopies++;
+            }else{
+                if(copy.size){
+                    recordUploadCopy(scheduler, &copy);
+                    totalCopies++;
+                }
+                copy.dst = request->dst;
+                copy.dstOffset = dstOffset;
+                copy.stagingOffset = allocation.offset;
+                copy.size = size;
+            }
+        }
+        budget = size < budget ? budget - size : 0;
+        request->uploadedBytes += size;
+        scheduler->stats.uploadedBytes += size;
+        if(request->uploadedBytes == request->size){
+            batch.lastTicket = request->ticket;
+            batch.completedRequests++;
+            batch.requestFrames += request->requestFrame;
+            scheduler->firstRequest = (scheduler->firstRequest + 1) % UPLOAD_SCHEDULER_MAX_REQUESTS;
+            scheduler->totalRequests--;
+        }
+    }
+    if(copy.size){
+        recordUploadCopy(scheduler, &copy);
+        totalCopies++;
+    }
+    backend->closeCommandList(list);
+    endUploadRingFrame(staging, fenceValue);
+    if(!totalCopies){
+        return true;
+    }
+    //a batch that only carried the start of a request completes no tickets
+    if(!batch.lastTicket){
+        batch.lastTicket = scheduler->totalBatches ?
+            scheduler->batches[(scheduler->firstBatch + scheduler->totalBatches - 1) % UPLOAD_SCHEDULER_MAX_BATCHES].lastTicket :
+            scheduler->completedTicket;
+    }
+    backend->executeCommandLists(backend, &list, 1);
+    backend->signalFence(backend, RENDER_QUEUE_COPY, &scheduler->fence, fenceValue);
+    scheduler->batches[(scheduler->firstBatch + scheduler->totalBatches) % UPLOAD_SCHEDULER_MAX_BATCHES] = batch;
+    scheduler->totalBatches++;
+    scheduler->submittedBatches++;
+    scheduler->stats.batches++;
+    return true;
+}
+
+//once per frame, submits at most bytesPerFrame and never waits for the copy queue
+static void updateUploadScheduler(UploadScheduler* scheduler){
+    scheduler->frame++;
+    if(!scheduler->totalRequests){
+        retireUploadBatches(scheduler);
+        return;
+    }
+    if(!submitUploadBatch(scheduler, scheduler->bytesPerFrame)){
+        scheduler->stats.copyQueueBusyFrames++;
+    }else if(scheduler->totalRequests){
+        scheduler->stats.budgetLimitedFrames++;
+    }
+}
+
+//submits everything regardless of the budget and waits until it is copied, for loading screens and shutdown
+static void flushUploadScheduler(UploadScheduler* scheduler){
+    RenderBackend* backend = scheduler->backend;
+    while(scheduler->totalRequests || scheduler->totalBatches){
+        u64 uploadedBytes = scheduler->stats.uploadedBytes;
+        if(scheduler->totalRequests && submitUploadBatch(scheduler, MAX_U32) &&
+           scheduler->stats.uploadedBytes != uploadedBytes){
+            continue;
+        }
+        if(scheduler->totalBatches){
+            backend->waitForFence(backend, &scheduler->fence, scheduler->batches[scheduler->firstBatch].fenceValue);
+            retireUploadBatches(scheduler);
+        }
+    }
+}
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <stdarg.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #define MAX_U32 4294967295
+#define MAX_U64 18446744073709551615ull
 #define MAX_F32 3.402823466e38
 #define MIN_F32 -1.175494351e38     
 
@@ -42,6 +46,193 @@ static void copyMemory(void* destination, void* source, u64 size){
     }
 }
 
+struct MemoryArena {
+    u8* base;
+    u64 size;
+    u64 used;
+};
+
+static MemoryArena createMemoryArena(void* memory, u64 size){
+    MemoryArena arena;
+    arena.base = (u8*)memory;
+    arena.size = size;
+    arena.used = 0;
+    return arena;
+}
+
+static void* pushSize(MemoryArena* arena, u64 size, u64 alignment = 16){
+    u64 address = (u64)(arena->base + arena->used);
+    u64 padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+    if(arena->used + padding + size > arena->size){
+        return 0;
+    }
+    void* result = arena->base + arena->used + padding;
+    arena->used += padding + size;
+    return result;
+}
+
+#define pushStruct(arena, type) (type*)pushSize(arena, sizeof(type))
+#define pushArray(arena, type, count) (type*)pushSize(arena, sizeof(type) * (count))
+
+static u32 nextPowerOfTwo(u32 v){
+    v--;
+    v |= v >> 1;
+    v |= v >> 2;
+    v |= v >> 4;
+    v |= v >> 8;
+    v |= v >> 16;
+    return v + 1;
+}
+
+//v must not be 0
+static u32 findMostSignificantBit(u64 v){
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return index;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+//v must not be 0
+static u32 findLeastSignificantBit(u64 v){
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return index;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+//returns the value held before the exchange, which equals comparand when the exchange happened
+static u32 atomicCompareExchange(volatile u32* value, u32 exchange, u32 comparand){
+#ifdef _MSC_VER
+    return (u32)_InterlockedCompareExchange((volatile long*)value, (long)exchange, (long)comparand);
+#else
+    return __sync_val_compare_and_swap(value, comparand, exchange);
+#endif
+}
+
+static u64 atomicCompareExchange64(volatile u64* value, u64 exchange, u64 comparand){
+#ifdef _MSC_VER
+    return (u64)_InterlockedCompareExchange64((volatile long long*)value, (long long)exchange, (long long)comparand);
+#else
+    return __sync_val_compare_and_swap(value, comparand, exchange);
+#endif
+}
+
+//returns the value after the add
+static u32 atomicAdd(volatile u32* value, u32 amount){
+#ifdef _MSC_VER
+    return (u32)_InterlockedExchangeAdd((volatile long*)value, (long)amount) + amount;
+#else
+    return __sync_add_and_fetch(value, amount);
+#endif
+}
+
+//returns the value after the add
+static u64 atomicAdd64(volatile u64* value, u64 amount){
+#ifdef _MSC_VER
+    return (u64)_InterlockedExchangeAdd64((volatile long long*)value, (long long)amount) + amount;
+#else
+    return __sync_add_and_fetch(value, amount);
+#endif
+}
+
+//for the body of a loop waiting on another thread
+static void spinPause(){
+#ifdef _MSC_VER
+    _mm_pause();
+#else
+    __builtin_ia32_pause();
+#endif
+}
+
+static void beginSpinLock(volatile u32* lock){
+    while(atomicCompareExchange(lock, 1, 0) != 0){
+        spinPause();
+    }
+}
+
+static void endSpinLock(volatile u32* lock){
+    atomicCompareExchange(lock, 0, 1);
+}
+
+static void sortIndicesByKeyDescending(u32* order, f32* keys, s32 low, s32 high){
+    while(low < high){
+        f32 pivot = keys[order[(low + high) / 2]];
+        s32 i = low;
+        s32 j = high;
+        while(i <= j){
+            while(keys[order[i]] > pivot) i++;
+            while(keys[order[j]] < pivot) j--;
+            if(i <= j){
+                u32 t = order[i];
+                order[i] = order[j];
+                order[j] = t;
+                i++;
+                j--;
+            }
+        }
+        if(j - low < high - i){
+            sortIndicesByKeyDescending(order, keys, low, j);
+            low = i;
+        }else{
+            sortIndicesByKeyDescending(order, keys, i, high);
+            high = j;
+        }
+    }
+}
+
+//64 bit hash of size bytes, 8 bytes per step with a multiply/rotate mix and a final avalanche
+static u64 hashMemory(void* data, u64 size, u64 seed = 0){
+    const u64 prime1 = 0x9E3779B185EBCA87ULL;
+    const u64 prime2 = 0xC2B2AE3D27D4EB4FULL;
+    u8* p = (u8*)data;
+    u64 h = seed ^ (size * prime1);
+    while(size >= 8){
+        u64 k = *(u64*)p * prime2;
+        k = (k << 31) | (k >> 33);
+        h ^= k * prime1;
+        h = ((h << 27) | (h >> 37)) * prime1 + prime2;
+        p += 8;
+        size -= 8;
+    }
+    u64 tail = 0;
+    for(u32 i = 0; i < size; i++){
+        tail |= (u64)p[i] << (i * 8);
+    }
+    h ^= tail * prime2;
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime1;
+    h ^= h >> 32;
+    return h;
+}
+
+//paths are compared case insensitively with either slash, the way the file system treats them. The name is folded
+//into a stack buffer and hashed 8 bytes per step; names over 256 bytes chain the chunks through the seed.
+static u64 hashAssetFileName(const s8* fileName){
+    u8 folded[256];
+    const u8* c = (const u8*)fileName;
+    u64 hash = 0;
+    for(;;){
+        u32 length = 0;
+        while(length < sizeof(folded) && c[length]){
+            u8 ch = c[length];
+            folded[length++] = ch == '\\' ? '/' : (u32)(ch - 'A') < 26 ? ch + ('a' - 'A') : ch;
+        }
+        hash = hashMemory(folded, length, hash);
+        if(length < sizeof(folded)){
+            return hash;
+        }
+        c += length;
+    }
+}
+
 static s32 binarySearch(u16* list, u16 value, u32 start, u32 end, s32 notFoundReturnValue = -1){
     while(end >= start){
         u32 mid = start + ((end - start) / 2);
@@ -0,0 +1,490 @@
+#pragma once
+
+#include "render_backend.h"
+
+// Compressed vertex formats and the SSE kernels that encode and decode them. Every kernel works on strided
+// streams so it can be pointed at one attribute of an interleaved vertex on either side.
+//   positions   R16G16B16A16_UNORM relative to the mesh bounds      8 bytes
+//   normals     R16G16_SNORM octahedral                              4 bytes
+//   tangents    R8G8B8A8_SNORM octahedral xy, handedness in z        4 bytes
+//   uvs         R16G16_FLOAT                                         4 bytes
+//   weights     R8G8B8A8_UNORM, always summing to 255                4 bytes
+// getQuantizedVertexAttributes gives the input layout a pipeline drawing quantized vertices needs; shader.hlsl's
+// VSMainQuantized decodes positions with the bounds passed as graphics constants.
+
+#define VERTEX_ATTRIBUTE_NONE -1
+
+struct VertexAttributeLayout {
+    u32 vertexStride;
+    s32 positionOffset;
+    s32 normalOffset;
+    s32 tangentOffset;
+    s32 uvOffset;
+    s32 weightsOffset;
+};
+
+struct QuantizationBounds {
+    f32 min[3];
+    f32 extent[3];
+};
+
+struct QuantizationReport {
+    u32 sourceBytesPerVertex;
+    u32 quantizedBytesPerVertex;
+    f32 maxPositionError;
+    f32 maxNormalErrorDegrees;
+    f32 maxTangentErrorDegrees;
+    f32 maxUVError;
+    f32 maxWeightError;
+};
+
+//packs the low 16 bits of each lane, without the signed saturation _mm_packs_epi32 would apply
+static __m128i packLow16(__m128i a, __m128i b){
+    a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+    b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+    return _mm_packs_epi32(a, b);
+}
+
+static __m128i floatToHalf4(__m128 f){
+    __m128i signMask = _mm_set1_epi32(0x80000000);
+    __m128i f16Max = _mm_set1_epi32((127 + 16) << 23);
+    __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+    __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    __m128i normalBias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+
+    __m128i bits = _mm_castps_si128(f);
+    __m128i sign = _mm_and_si128(bits, signMask);
+    __m128i absBits = _mm_xor_si128(bits, sign);
+    __m128 absF = _mm_castsi128_ps(absBits);
+
+    __m128i isNaN = _mm_castps_si128(_mm_cmpunord_ps(absF, absF));
+    __m128i isRegular = _mm_cmpgt_epi32(f16Max, absBits);
+    __m128i infOrNaN = _mm_or_si128(_mm_and_si128(isNaN, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7C00));
+
+    __m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absBits);
+    __m128 subnormal1 = _mm_add_ps(absF, _mm_castsi128_ps(subnormalMagic));
+    __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(subnormal1), subnormalMagic);
+
+    //round to nearest even by adding the bias minus one when the lowest kept mantissa bit is clear
+    __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+    __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absBits, normalBias), mantissaOdd), 13);
+
+    __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+    __m128i joined = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, infOrNaN));
+    return _mm_or_si128(joined, _mm_srli_epi32(sign, 16));
+}
+
+//h holds one half float in the low 16 bits of each lane
+static __m128 halfToFloat4(__m128i h){
+    __m128i expMantissa = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+    __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expMantissa), 16);
+    __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expMantissa, 13)), _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+    __m128i wasInfNaN = _mm_cmpgt_epi32(expMantissa, _mm_set1_epi32(0x7BFF));
+    __m128i infNaNExponent = _mm_and_si128(wasInfNaN, _mm_set1_epi32(255 << 23));
+    return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infNaNExponent)));
+}
+
+static u16 floatToHalf(f32 f){
+    return (u16)_mm_cvtsi128_si32(floatToHalf4(_mm_set1_ps(f)));
+}
+
+static f32 halfToFloat(u16 h){
+    return _mm_cvtss_f32(halfToFloat4(_mm_set1_epi32(h)));
+}
+
+static QuantizationBounds computeQuantizationBounds(f32* positions, u32 count, u32 stride){
+    QuantizationBounds bounds = {};
+    if(count == 0) return bounds;
+    __m128 minV = _mm_set1_ps(MAX_F32);
+    __m128 maxV = _mm_set1_ps(-MAX_F32);
+    for(u32 i = 0; i < count; i++){
+        f32* p = (f32*)((u8*)positions + i * stride);
+        __m128 v = _mm_set_ps(0, p[2], p[1], p[0]);
+        minV = _mm_min_ps(minV, v);
+        maxV = _mm_max_ps(maxV, v);
+    }
+    Vector4 mn(minV);
+    Vector4 ex(_mm_sub_ps(maxV, minV));
+    for(u32 i = 0; i < 3; i++){
+        bounds.min[i] = mn.va[i];
+        bounds.extent[i] = ex.va[i] > 0 ? ex.va[i] : 1;
+    }
+    return bounds;
+}
+
+static void encodePositionsUnorm16(f32* positions, u32 srcStride, u16* dst, u32 dstStride, u32 count, QuantizationBounds* bounds){
+    __m128 minV = _mm_set_ps(0, bounds->min[2], bounds->min[1], bounds->min[0]);
+    __m128 scale = _mm_set_ps(0, 65535.0f / bounds->extent[2], 65535.0f / bounds->extent[1], 65535.0f / bounds->extent[0]);
+    for(u32 i = 0; i < count; i++){
+        f32* p = (f32*)((u8*)positions + i * srcStride);
+        __m128 v = _mm_mul_ps(_mm_sub_ps(_mm_set_ps(0, p[2], p[1], p[0]), minV), scale);
+        v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(65535.0f));
+        __m128i q = packLow16(_mm_cvtps_epi32(v), _mm_setzero_si128());
+        _mm_storel_epi64((__m128i*)((u8*)dst + i * dstStride), q);
+    }
+}
+
+static void decodePositionsUnorm16(u16* src, u32 srcStride, f32* positions, u32 dstStride, u32 count, QuantizationBounds* bounds){
+    __m128 minV = _mm_set_ps(0, bounds->min[2], bounds->min[1], bounds->min[0]);
+    __m128 scale = _mm_set_ps(0, bounds->extent[2] / 65535.0f, bounds->extent[1] / 65535.0f, bounds->extent[0] / 65535.0f);
+    for(u32 i = 0; i < count; i++){
+        __m128i q = _mm_loadl_epi64((__m128i*)((u8*)src + i * srcStride));
+        q = _mm_unpacklo_epi16(q, _mm_setzero_si128());
+        Vector4 v(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(q), scale), minV));
+        f32* p = (f32*)((u8*)positions + i * dstStride);
+        p[0] = v.x;
+        p[1] = v.y;
+        p[2] = v.z;
+    }
+}
+
+static void loadVectors4(f32* src, u32 stride, u32 count, __m128* x, __m128* y, __m128* z){
+    Vector4 v[4];
+    for(u32 i = 0; i < 4; i++){
+        f32* p = (f32*)((u8*)src + (i < count ? i : 0) * stride);
+        v[i] = Vector4(p[0], p[1], p[2], 0);
+    }
+    _MM_TRANSPOSE4_PS(v[0].v, v[1].v, v[2].v, v[3].v);
+    *x = v[0].v;
+    *y = v[1].v;
+    *z = v[2].v;
+}
+
+//maps unit vectors onto the octahedron and unfolds the lower half, giving x and y in [-1, 1]
+static void octahedralEncode4(__m128 x, __m128 y, __m128 z, __m128* ox, __m128* oy){
+    __m128 l1 = _mm_add_ps(_mm_add_ps(absoluteValue4(x), absoluteValue4(y)), absoluteValue4(z));
+    l1 = _mm_max_ps(l1, _mm_set1_ps(1e-20f));
+    __m128 px = _mm_div_ps(x, l1);
+    __m128 py = _mm_div_ps(y, l1);
+    __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 foldedX = _mm_or_ps(_mm_sub_ps(one, absoluteValue4(py)), _mm_and_ps(px, signMask));
+    __m128 foldedY = _mm_or_ps(_mm_sub_ps(one, absoluteValue4(px)), _mm_and_ps(py, signMask));
+    __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+    *ox = select4(lower, foldedX, px);
+    *oy = select4(lower, foldedY, py);
+}
+
+static void octahedralDecode4(__m128 ox, __m128 oy, __m128* x, __m128* y, __m128* z){
+    __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 nz = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), absoluteValue4(ox)), absoluteValue4(oy));
+    __m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), nz), _mm_setzero_ps());
+    //x -= sign(x) * t
+    __m128 nx = _mm_sub_ps(ox, _mm_or_ps(t, _mm_and_ps(ox, signMask)));
+    __m128 ny = _mm_sub_ps(oy, _mm_or_ps(t, _mm_and_ps(oy, signMask)));
+    __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+    __m128 inverseLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lengthSquared));
+    *x = _mm_mul_ps(nx, inverseLength);
+    *y = _mm_mul_ps(ny, inverseLength);
+    *z = _mm_mul_ps(nz, inverseLength);
+}
+
+static void encodeOctahedralSnorm16(f32* normals, u32 srcStride, s16* dst, u32 dstStride, u32 count){
+    for(u32 i = 0; i < count; i += 4){
+        u32 n = count - i < 4 ? count - i : 4;
+        __m128 x, y, z, ox, oy;
+        loadVectors4((f32*)((u8*)normals + i * srcStride), srcStride, n, &x, &y, &z);
+        octahedralEncode4(x, y, z, &ox, &oy);
+        __m128 scale = _mm_set1_ps(32767.0f);
+        __m128i qx = _mm_cvtps_epi32(_mm_mul_ps(ox, scale));
+        __m128i qy = _mm_cvtps_epi32(_mm_mul_ps(oy, scale));
+        //interleave x and y into one 32 bit word per vertex
+        __m128i packed = _mm_or_si128(_mm_and_si128(qx, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(qy, 16));
+        u32 words[4];
+        _mm_storeu_si128((__m128i*)words, packed);
+        for(u32 j = 0; j < n; j++){
+            *(u32*)((u8*)dst + (i + j) * dstStride) = words[j];
+        }
+    }
+}
+
+static void decodeOctahedralSnorm16(s16* src, u32 srcStride, f32* normals, u32 dstStride, u32 count){
+    for(u32 i = 0; i < count; i += 4){
+        u32 n = count - i < 4 ? count - i : 4;
+        u32 words[4] = {};
+        for(u32 j = 0; j < n; j++){
+            words[j] = *(u32*)((u8*)src + (i + j) * srcStride);
+        }
+        __m128i packed = _mm_loadu_si128((__m128i*)words);
+        __m128 scale = _mm_set1_ps(1.0f / 32767.0f);
+        __m128 ox = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 16), 16)), scale);
+        __m128 oy = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(packed, 16)), scale);
+        ox = _mm_max_ps(ox, _mm_set1_ps(-1.0f));
+        oy = _mm_max_ps(oy, _mm_set1_ps(-1.0f));
+        Vector4 x, y, z;
+        octahedralDecode4(ox, oy, &x.v, &y.v, &z.v);
+        for(u32 j = 0; j < n; j++){
+            f32* p = (f32*)((u8*)normals + (i + j) * dstStride);
+            p[0] = x.va[j];
+            p[1] = y.va[j];
+            p[2] = z.va[j];
+        }
+    }
+}
+
+//tangents are xyz plus handedness in w
+static void encodeTangentsSnorm8(f32* tangents, u32 srcStride, s8* dst, u32 dstStride, u32 count){
+    for(u32 i = 0; i < count; i += 4){
+        u32 n = count - i < 4 ? count - i : 4;
+        __m128 x, y, z, ox, oy;
+        loadVectors4((f32*)((u8*)tangents + i * srcStride), srcStride, n, &x, &y, &z);
+        octahedralEncode4(x, y, z, &ox, &oy);
+        Vector4 qx(_mm_mul_ps(ox, _mm_set1_ps(127.0f)));
+        Vector4 qy(_mm_mul_ps(oy, _mm_set1_ps(127.0f)));
+        for(u32 j = 0; j < n; j++){
+            f32* t = (f32*)((u8*)tangents + (i + j) * srcStride);
+            s8* q = (s8*)((u8*)dst + (i + j) * dstStride);
+            q[0] = (s8)(s32)(qx.va[j] + (qx.va[j] < 0 ? -0.5f : 0.5f));
+            q[1] = (s8)(s32)(qy.va[j] + (qy.va[j] < 0 ? -0.5f : 0.5f));
+            q[2] = t[3] < 0 ? -127 : 127;
+            q[3] = 0;
+        }
+    }
+}
+
+static void decodeTangentsSnorm8(s8* src, u32 srcStride, f32* tangents, u32 dstStride, u32 count){
+    for(u32 i = 0; i < count; i += 4){
+        u32 n = count - i < 4 ? count - i : 4;
+        Vector4 qx(0);
+        Vector4 qy(0);
+        for(u32 j = 0; j < n; j++){
+            s8* q = (s8*)((u8*)src + (i + j) * srcStride);
+            qx.va[j] = q[0];
+            qy.va[j] = q[1];
+        }
+        __m128 scale = _mm_set1_ps(1.0f / 127.0f);
+        Vector4 x, y, z;
+        octahedralDecode4(_mm_mul_ps(qx.v, scale), _mm_mul_ps(qy.v, scale), &x.v, &y.v, &z.v);
+        for(u32 j = 0; j < n; j++){
+            s8* q = (s8*)((u8*)src + (i + j) * srcStride);
+            f32* t = (f32*)((u8*)tangents + (i + j) * dstStride);
+            t[0] = x.va[j];
+            t[1] = y.va[j];
+            t[2] = z.va[j];
+            t[3] = q[2] < 0 ? -1.0f : 1.0f;
+        }
+    }
+}
+
+static void encodeUVsHalf(f32* uvs, u32 srcStride, u16* dst, u32 dstStride, u32 count){
+    for(u32 i = 0; i < count; i += 2){
+        f32* a = (f32*)((u8*)uvs + i * srcStride);
+        f32* b = i + 1 < count ? (f32*)((u8*)uvs + (i + 1) * srcStride) : a;
+        u32 words[4];
+        _mm_storeu_si128((__m128i*)words, floatToHalf4(_mm_set_ps(b[1], b[0], a[1], a[0])));
+        u16* qa = (u16*)((u8*)dst + i * dstStride);
+        qa[0] = (u16)words[0];
+        qa[1] = (u16)words[1];
+        if(i + 1 < count){
+            u16* qb = (u16*)((u8*)dst + (i + 1) * dstStride);
+            qb[0] = (u16)words[2];
+            qb[1] = (u16)words[3];
+        }
+    }
+}
+
+static void decodeUVsHalf(u16* src, u32 srcStride, f32* uvs, u32 dstStride, u32 count){
+    for(u32 i = 0; i < count; i += 2){
+        u16* qa = (u16*)((u8*)src + i * srcStride);
+        u16* qb = i + 1 < count ? (u16*)((u8*)src + (i + 1) * srcStride) : qa;
+        Vector4 f(halfToFloat4(_mm_set_epi32(qb[1], qb[0], qa[1], qa[0])));
+        f32* a = (f32*)((u8*)uvs + i * dstStride);
+        a[0] = f.x;
+        a[1] = f.y;
+        if(i + 1 < count){
+            f32* b = (f32*)((u8*)uvs + (i + 1) * dstStride);
+            b[0] = f.z;
+            b[1] = f.w;
+        }
+    }
+}
+
+//weights are renormalized so the four bytes always sum to exactly 255
+static void encodeWeightsUnorm8(f32* weights, u32 srcStride, u8* dst, u32 dstStride, u32 count){
+    for(u32 i = 0; i < count; i++){
+        f32* w = (f32*)((u8*)weights + i * srcStride);
+        __m128 v = _mm_max_ps(_mm_loadu_ps(w), _mm_setzero_ps());
+        __m128 sum = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_max_ps(sum, _mm_set1_ps(1e-20f));
+        __m128i q = _mm_cvtps_epi32(_mm_mul_ps(_mm_div_ps(v, sum), _mm_set1_ps(255.0f)));
+        s32 qs[4];
+        _mm_storeu_si128((__m128i*)qs, q);
+        s32 total = qs[0] + qs[1] + qs[2] + qs[3];
+        u32 largest = 0;
+        for(u32 j = 1; j < 4; j++){
+            if(qs[j] > qs[largest]) largest = j;
+        }
+        qs[largest] += 255 - total;
+        u8* out = (u8*)dst + i * dstStride;
+        for(u32 j = 0; j < 4; j++){
+            out[j] = (u8)qs[j];
+        }
+    }
+}
+
+static void decodeWeightsUnorm8(u8* src, u32 srcStride, f32* weights, u32 dstStride, u32 count){
+    __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+    for(u32 i = 0; i < count; i++){
+        u32 word = *(u32*)((u8*)src + i * srcStride);
+        __m128i q = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((s32)word), _mm_setzero_si128()), _mm_setzero_si128());
+        _mm_storeu_ps((f32*)((u8*)weights + i * dstStride), _mm_mul_ps(_mm_cvtepi32_ps(q), scale));
+    }
+}
+
+static u32 getQuantizedVertexSize(VertexAttributeLayout* layout){
+    u32 size = 0;
+    if(layout->positionOffset != VERTEX_ATTRIBUTE_NONE) size += 8;
+    if(layout->normalOffset != VERTEX_ATTRIBUTE_NONE) size += 4;
+    if(layout->tangentOffset != VERTEX_ATTRIBUTE_NONE) size += 4;
+    if(layout->uvOffset != VERTEX_ATTRIBUTE_NONE) size += 4;
+    if(layout->weightsOffset != VERTEX_ATTRIBUTE_NONE) size += 4;
+    return size;
+}
+
+//the float vertices createModel3D takes: position, normal, uv
+static VertexAttributeLayout getModel3DVertexLayout(){
+    VertexAttributeLayout layout;
+    layout.vertexStride = MODEL3D_VERTEX_SIZE / sizeof(f32);
+    layout.positionOffset = 0;
+    layout.normalOffset = 3;
+    layout.tangentOffset = VERTEX_ATTRIBUTE_NONE;
+    layout.uvOffset = 6;
+    layout.weightsOffset = VERTEX_ATTRIBUTE_NONE;
+    return layout;
+}
+
+//Fills attributes with the input layout of the vertices quantizeVertices writes for layout and returns how many.
+//attributes needs room for 5.
+static u32 getQuantizedVertexAttributes(VertexAttributeLayout* layout, RenderVertexAttribute* attributes){
+    s32 offsets[5] = {layout->positionOffset, layout->normalOffset, layout->tangentOffset, layout->uvOffset,
+                      layout->weightsOffset};
+    const s8* semantics[5] = {"POSITION", "NORMAL", "TANGENT", "TEXCOORD", "BLENDWEIGHT"};
+    u32 formats[5] = {RENDER_FORMAT_R16G16B16A16_UNORM, RENDER_FORMAT_R16G16_SNORM, RENDER_FORMAT_R8G8B8A8_SNORM,
+                      RENDER_FORMAT_R16G16_FLOAT, RENDER_FORMAT_R8G8B8A8_UNORM};
+    u32 sizes[5] = {8, 4, 4, 4, 4};
+    u32 totalAttributes = 0;
+    u32 offset = 0;
+    for(u32 i = 0; i < 5; i++){
+        if(offsets[i] == VERTEX_ATTRIBUTE_NONE) continue;
+        RenderVertexAttribute* attribute = &attributes[totalAttributes++];
+        attribute->semantic = semantics[i];
+        attribute->semanticIndex = 0;
+        attribute->format = formats[i];
+        attribute->offset = offset;
+        offset += sizes[i];
+    }
+    return totalAttributes;
+}
+
+//Quantized attributes are written in the order position, normal, tangent, uv, weights.
+//vertexStride and offsets in the layout are counted in floats, Model3D::vertexSize is the stride in bytes.
+static void quantizeVertices(f32* vertices, u32 vertexCount, VertexAttributeLayout* layout, QuantizationBounds* bounds, u8* output){
+    u32 srcStride = layout->vertexStride * sizeof(f32);
+    u32 dstStride = getQuantizedVertexSize(layout);
+    u8* dst = output;
+    if(layout->positionOffset != VERTEX_ATTRIBUTE_NONE){
+        encodePositionsUnorm16(vertices + layout->positionOffset, srcStride, (u16*)dst, dstStride, vertexCount, bounds);
+        dst += 8;
+    }
+    if(layout->normalOffset != VERTEX_ATTRIBUTE_NONE){
+        encodeOctahedralSnorm16(vertices + layout->normalOffset, srcStride, (s16*)dst, dstStride, vertexCount);
+        dst += 4;
+    }
+    if(layout->tangentOffset != VERTEX_ATTRIBUTE_NONE){
+        encodeTangentsSnorm8(vertices + layout->tangentOffset, srcStride, (s8*)dst, dstStride, vertexCount);
+        dst += 4;
+    }
+    if(layout->uvOffset != VERTEX_ATTRIBUTE_NONE){
+        encodeUVsHalf(vertices + layout->uvOffset, srcStride, (u16*)dst, dstStride, vertexCount);
+        dst += 4;
+    }
+    if(layout->weightsOffset != VERTEX_ATTRIBUTE_NONE){
+        encodeWeightsUnorm8(vertices + layout->weightsOffset, srcStride, dst, dstStride, vertexCount);
+    }
+}
+
+//Decodes back into the float layout described by layout. Attributes absent from the layout are left untouched.
+static void dequantizeVertices(u8* input, u32 vertexCount, VertexAttributeLayout* layout, QuantizationBounds* bounds, f32* vertices){
+    u32 srcStride = getQuantizedVertexSize(layout);
+    u32 dstStride = layout->vertexStride * sizeof(f32);
+    u8* src = input;
+    if(layout->positionOffset != VERTEX_ATTRIBUTE_NONE){
+        decodePositionsUnorm16((u16*)src, srcStride, vertices + layout->positionOffset, dstStride, vertexCount, bounds);
+        src += 8;
+    }
+    if(layout->normalOffset != VERTEX_ATTRIBUTE_NONE){
+        decodeOctahedralSnorm16((s16*)src, srcStride, vertices + layout->normalOffset, dstStride, vertexCount);
+        src += 4;
+    }
+    if(layout->tangentOffset != VERTEX_ATTRIBUTE_NONE){
+        decodeTangentsSnorm8((s8*)src, srcStride, vertices + layout->tangentOffset, dstStride, vertexCount);
+        src += 4;
+    }
+    if(layout->uvOffset != VERTEX_ATTRIBUTE_NONE){
+        decodeUVsHalf((u16*)src, srcStride, vertices + layout->uvOffset, dstStride, vertexCount);
+        src += 4;
+    }
+    if(layout->weightsOffset != VERTEX_ATTRIBUTE_NONE){
+        decodeWeightsUnorm8(src, srcStride, vertices + layout->weightsOffset, dstStride, vertexCount);
+    }
+}
+
+static f32 angleBetweenDegrees(f32* a, f32* b){
+    f32 d = clamp(dot(normalOf(Vector3(a[0], a[1], a[2])), normalOf(Vector3(b[0], b[1], b[2]))), -1, 1);
+    return (f32)(acos(d) * 360.0 / TAU);
+}
+
+//Quantizes and decodes the vertices through scratch memory and reports the size saving and worst case error.
+static QuantizationReport measureQuantization(f32* vertices, u32 vertexCount, VertexAttributeLayout* layout, QuantizationBounds* bounds,
+                                              MemoryArena* scratch){
+    QuantizationReport report = {};
+    report.sourceBytesPerVertex = layout->vertexStride * sizeof(f32);
+    report.quantizedBytesPerVertex = getQuantizedVertexSize(layout);
+
+    u64 scratchMark = scratch->used;
+    u8* quantized = (u8*)pushSize(scratch, (u64)vertexCount * report.quantizedBytesPerVertex);
+    f32* decoded = pushArray(scratch, f32, (u64)vertexCount * layout->vertexStride);
+    if(!quantized || !decoded){
+        scratch->used = scratchMark;
+        return report;
+    }
+    copyMemory(decoded, vertices, (u64)vertexCount * report.sourceBytesPerVertex);
+    quantizeVertices(vertices, vertexCount, layout, bounds, quantized);
+    dequantizeVertices(quantized, vertexCount, layout, bounds, decoded);
+
+    for(u32 i = 0; i < vertexCount; i++){
+        f32* a = vertices + i * layout->vertexStride;
+        f32* b = decoded + i * layout->vertexStride;
+        if(layout->positionOffset != VERTEX_ATTRIBUTE_NONE){
+            f32* pa = a + layout->positionOffset;
+            f32* pb = b + layout->positionOffset;
+            f32 e = length(Vector3(pa[0], pa[1], pa[2]) - Vector3(pb[0], pb[1], pb[2]));
+            if(e > report.maxPositionError) report.maxPositionError = e;
+        }
+        if(layout->normalOffset != VERTEX_ATTRIBUTE_NONE){
+            f32 e = angleBetweenDegrees(a + layout->normalOffset, b + layout->normalOffset);
+            if(e > report.maxNormalErrorDegrees) report.maxNormalErrorDegrees = e;
+        }
+        if(layout->tangentOffset != VERTEX_ATTRIBUTE_NONE){
+            f32 e = angleBetweenDegrees(a + layout->tangentOffset, b + layout->tangentOffset);
+            if(e > report.maxTangentErrorDegrees) report.maxTangentErrorDegrees = e;
+        }
+        if(layout->uvOffset != VERTEX_ATTRIBUTE_NONE){
+            for(u32 j = 0; j < 2; j++){
+                f32 e = absoluteValue(a[layout->uvOffset + j] - b[layout->uvOffset + j]);
+                if(e > report.maxUVError) report.maxUVError = e;
+            }
+        }
+        if(layout->weightsOffset != VERTEX_ATTRIBUTE_NONE){
+            f32 sum = 0;
+            for(u32 j = 0; j < 4; j++) sum += a[layout->weightsOffset + j];
+            for(u32 j = 0; j < 4 && sum > 0; j++){
+                f32 e = absoluteValue(a[layout->weightsOffset + j] / sum - b[layout->weightsOffset + j]);
+                if(e > report.maxWeightError) report.maxWeightError = e;
+            }
+        }
+    }
+    scratch->used = scratchMark;
+    return report;
+}